@@ -0,0 +1,74 @@
+import struct
+import sys
+
+# Reader for the columnar traces produced by "picolog -f coltrace".
+# The format is described in loglib/coltrace.h. Only the blocks that may
+# contain values in the requested range are read, and only the requested
+# column is decoded, so plots do not have to parse text files.
+
+HEADER_SIZE = 48
+COLUMN_ENTRY_SIZE = 16
+
+class ColTrace:
+    def __init__(self, file_name):
+        self.file = open(file_name, 'rb')
+        header = self.file.read(HEADER_SIZE)
+        if len(header) != HEADER_SIZE or header[0:4] != b'pqct':
+            raise ValueError(file_name + " is not a columnar trace")
+        version, nb_columns, self.block_rows = struct.unpack_from('<HHI', header, 4)
+        if version != 1:
+            raise ValueError("unsupported columnar trace version " + str(version))
+        self.start_time = struct.unpack_from('<Q', header, 16)[0]
+        cid_len = header[24]
+        self.cid = header[25:25 + cid_len].hex()
+        self.widths = []
+        self.names = []
+        for i in range(nb_columns):
+            entry = self.file.read(COLUMN_ENTRY_SIZE)
+            self.widths.append(entry[0])
+            self.names.append(entry[1:].split(b'\0')[0].decode())
+        self.data_offset = HEADER_SIZE + nb_columns * COLUMN_ENTRY_SIZE
+
+    def close(self):
+        self.file.close()
+
+    def column(self, name, range_min=0, range_max=(1 << 64) - 1):
+        # Returns the list of (row, value) of the column within the range
+        column = self.names.index(name)
+        width = self.widths[column]
+        fmt = {1: 'B', 2: 'H', 4: 'I', 8: 'Q'}[width]
+        header_size = 8 + 16 * len(self.names)
+        row_width = sum(self.widths)
+        column_start = sum(self.widths[0:column])
+        offset = self.data_offset
+        row = 0
+        result = []
+        while True:
+            self.file.seek(offset)
+            block_header = self.file.read(header_size)
+            if len(block_header) < header_size:
+                break
+            nb_rows = struct.unpack_from('<I', block_header, 0)[0]
+            block_min, block_max = struct.unpack_from('<QQ', block_header, 8 + 16 * column)
+            if block_max >= range_min and block_min <= range_max:
+                self.file.seek(offset + header_size + column_start * nb_rows)
+                values = struct.unpack('<' + str(nb_rows) + fmt, self.file.read(width * nb_rows))
+                for r in range(nb_rows):
+                    if range_min <= values[r] <= range_max:
+                        result.append((row + r, values[r]))
+            row += nb_rows
+            offset += header_size + row_width * nb_rows
+        return result
+
+    def values(self, name):
+        return [v for (r, v) in self.column(name)]
+
+if __name__ == "__main__":
+    # Print a summary of the columns of a trace
+    trace = ColTrace(sys.argv[1])
+    print("connection " + trace.cid)
+    for name in trace.names:
+        v = trace.values(name)
+        if len(v) > 0:
+            print(name + ": " + str(len(v)) + " rows, min " + str(min(v)) + ", max " + str(max(v)))
+    trace.close()
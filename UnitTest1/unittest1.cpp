@@ -195,6 +195,13 @@ namespace UnitTest1
             Assert::AreEqual(ret, 0);
         }
 
+        TEST_METHOD(binlog_ring)
+        {
+            int ret = binlog_ring_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
         TEST_METHOD(app_message_overflow)
         {
             int ret = app_message_overflow_test();
@@ -318,6 +325,20 @@ namespace UnitTest1
 
             Assert::AreEqual(ret, 0);
         }
+
+        TEST_METHOD(crypto_provider)
+        {
+            int ret = crypto_provider_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(crypto_ring_provider)
+        {
+            int ret = crypto_ring_provider_test();
+
+            Assert::AreEqual(ret, 0);
+        }
         
         TEST_METHOD(test_pn_enc_1rtt)
         {
@@ -344,6 +365,13 @@ namespace UnitTest1
         {
             int ret = pacing_test();
 
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(pacing_wheel)
+        {
+            int ret = pacing_wheel_test();
+
             Assert::AreEqual(ret, 0);
         }
 
@@ -688,6 +716,34 @@ namespace UnitTest1
 
             Assert::AreEqual(ret, 0);
         }
+
+        TEST_METHOD(stateless_prefilter)
+        {
+            int ret = stateless_prefilter_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(async_sign)
+        {
+            int ret = async_sign_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(async_sign_client_auth)
+        {
+            int ret = async_sign_client_auth_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(async_sign_delete)
+        {
+            int ret = async_sign_delete_test();
+
+            Assert::AreEqual(ret, 0);
+        }
         
         TEST_METHOD(test_two_connections)
         {
@@ -788,6 +844,13 @@ namespace UnitTest1
             Assert::AreEqual(ret, 0);
         }
 
+        TEST_METHOD(ticket_cache)
+        {
+            int ret = ticket_cache_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
         TEST_METHOD(token_store)
         {
             int ret = token_store_test();
@@ -1347,6 +1410,20 @@ namespace UnitTest1
             Assert::AreEqual(ret, 0);
         }
 
+        TEST_METHOD(qlog_index)
+        {
+            int ret = qlog_index_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(coltrace)
+        {
+            int ret = coltrace_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
         TEST_METHOD(qlog_trace_auto)
         {
             int ret = qlog_trace_auto_test();
@@ -1368,6 +1445,69 @@ namespace UnitTest1
             Assert::AreEqual(ret, 0);
         }
 
+        TEST_METHOD(qlog_trace_async)
+        {
+            int ret = qlog_trace_async_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(log_trigger)
+        {
+            int ret = log_trigger_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(log_trigger_rto)
+        {
+            int ret = log_trigger_rto_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(log_trigger_idle)
+        {
+            int ret = log_trigger_idle_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(log_trigger_handshake)
+        {
+            int ret = log_trigger_handshake_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(log_trigger_throughput)
+        {
+            int ret = log_trigger_throughput_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(metrics)
+        {
+            int ret = metrics_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(profiler)
+        {
+            int ret = profiler_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(events)
+        {
+            int ret = events_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
         TEST_METHOD(path_packet_queue)
         {
             int ret = path_packet_queue_test();
@@ -1381,6 +1521,27 @@ namespace UnitTest1
 
             Assert::AreEqual(ret, 0);
         }
+
+        TEST_METHOD(limit_time)
+        {
+            int ret = limit_time_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(limit_time_flow_control)
+        {
+            int ret = limit_time_flow_control_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(limit_time_stream_flow_control)
+        {
+            int ret = limit_time_stream_flow_control_test();
+
+            Assert::AreEqual(ret, 0);
+        }
         TEST_METHOD(nat_rebinding_stress)
         {
             int ret = rebinding_stress_test();
@@ -1521,6 +1682,41 @@ namespace UnitTest1
             Assert::AreEqual(ret, 0);
         }
 
+        TEST_METHOD(bbr3)
+        {
+            int ret = bbr3_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(bbr3_jitter)
+        {
+            int ret = bbr3_jitter_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(bbr3_shallow)
+        {
+            int ret = bbr3_shallow_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(cc_ack_event)
+        {
+            int ret = cc_ack_event_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(prague)
+        {
+            int ret = prague_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
         TEST_METHOD(bbr_long)
         {
             int ret = bbr_long_test();
@@ -1577,6 +1773,20 @@ namespace UnitTest1
             Assert::AreEqual(ret, 0);
         }
 
+        TEST_METHOD(ack_autotune)
+        {
+            int ret = ack_autotune_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(loss_timer)
+        {
+            int ret = loss_timer_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
         TEST_METHOD(long_rtt)
         {
             int ret = long_rtt_test();
@@ -1713,6 +1923,24 @@ namespace UnitTest1
             Assert::AreEqual(ret, 0);
         }
 
+        TEST_METHOD(handshake_bench) {
+            int ret = handshake_bench_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(cc_bench) {
+            int ret = cc_bench_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(scale_bench) {
+            int ret = scale_bench_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
         TEST_METHOD(cert_verify_bad_cert) {
             int ret = cert_verify_bad_cert_test();
 
@@ -1863,6 +2091,30 @@ namespace UnitTest1
             Assert::AreEqual(ret, 0);
         }
 
+        TEST_METHOD(multipath_minrtt) {
+            int ret = multipath_minrtt_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(multipath_weighted) {
+            int ret = multipath_weighted_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(multipath_ecf) {
+            int ret = multipath_ecf_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(multipath_redundant) {
+            int ret = multipath_redundant_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
         TEST_METHOD(multipath_qlog) {
             int ret = multipath_qlog_test();
 
@@ -1970,6 +2222,18 @@ namespace UnitTest1
             Assert::AreEqual(ret, 0);
         }
 
+        TEST_METHOD(qpack_huffman_encode) {
+            int ret = qpack_huffman_encode_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(qpack_huffman_bench) {
+            int ret = qpack_huffman_bench_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
         TEST_METHOD(h3zero_parse_qpack) {
             int ret = h3zero_parse_qpack_test();
 
@@ -2006,6 +2270,12 @@ namespace UnitTest1
             Assert::AreEqual(ret, 0);
         }
 
+        TEST_METHOD(h3zero_qpack_dynamic) {
+            int ret = h3zero_qpack_dynamic_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
         TEST_METHOD(parse_demo_scenario) {
             int ret = parse_demo_scenario_test();
 
@@ -0,0 +1,639 @@
+/*
+* Columnar per packet trace: writer, reader, and conversion from the
+* binary log. The format is described in coltrace.h.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "picoquic_internal.h"
+#include "bytestream.h"
+#include "logreader.h"
+#include "coltrace.h"
+
+#define COLTRACE_PATH_STATE_MAX 16
+
+static const struct {
+    uint8_t width;
+    char const* name;
+} coltrace_columns[coltrace_nb_columns] = {
+    { 8, "time" },
+    { 4, "path" },
+    { 8, "pn" },
+    { 4, "size" },
+    { 8, "cwin" },
+    { 8, "bytes_in_flight" },
+    { 4, "rtt" },
+    { 8, "pacing_rate" },
+    { 1, "lost" }
+};
+
+static void coltrace_encode_le(uint8_t* bytes, uint64_t v, size_t width)
+{
+    for (size_t i = 0; i < width; i++) {
+        bytes[i] = (uint8_t)v;
+        v >>= 8;
+    }
+}
+
+static uint64_t coltrace_decode_le(const uint8_t* bytes, size_t width)
+{
+    uint64_t v = 0;
+
+    for (size_t i = width; i > 0; i--) {
+        v <<= 8;
+        v |= bytes[i - 1];
+    }
+
+    return v;
+}
+
+static size_t coltrace_row_width()
+{
+    size_t row_width = 0;
+
+    for (int i = 0; i < coltrace_nb_columns; i++) {
+        row_width += coltrace_columns[i].width;
+    }
+
+    return row_width;
+}
+
+/* Writer */
+
+coltrace_writer_t* coltrace_writer_open(FILE* F, const picoquic_connection_id_t* cid, uint64_t start_time)
+{
+    coltrace_writer_t* writer = (coltrace_writer_t*)malloc(sizeof(coltrace_writer_t));
+
+    if (writer != NULL) {
+        uint8_t header[COLTRACE_HEADER_SIZE + coltrace_nb_columns * COLTRACE_COLUMN_ENTRY_SIZE];
+        uint8_t* entry = header + COLTRACE_HEADER_SIZE;
+
+        memset(writer, 0, sizeof(coltrace_writer_t));
+        writer->F = F;
+        writer->values = (uint64_t*)malloc(sizeof(uint64_t) * coltrace_nb_columns * COLTRACE_BLOCK_ROWS);
+        writer->block = (uint8_t*)malloc(COLTRACE_BLOCK_HEADER_SIZE(coltrace_nb_columns) +
+            COLTRACE_BLOCK_ROWS * coltrace_row_width());
+
+        memset(header, 0, sizeof(header));
+        memcpy(header, "pqct", 4);
+        coltrace_encode_le(header + 4, COLTRACE_VERSION, 2);
+        coltrace_encode_le(header + 6, coltrace_nb_columns, 2);
+        coltrace_encode_le(header + 8, COLTRACE_BLOCK_ROWS, 4);
+        coltrace_encode_le(header + 16, start_time, 8);
+        if (cid != NULL) {
+            header[24] = cid->id_len;
+            memcpy(header + 25, cid->id, cid->id_len);
+        }
+        for (int i = 0; i < coltrace_nb_columns; i++) {
+            entry[0] = coltrace_columns[i].width;
+            memcpy(entry + 1, coltrace_columns[i].name, strlen(coltrace_columns[i].name));
+            entry += COLTRACE_COLUMN_ENTRY_SIZE;
+        }
+
+        if (writer->values == NULL || writer->block == NULL ||
+            fwrite(header, 1, sizeof(header), F) != sizeof(header)) {
+            free(writer->values);
+            free(writer->block);
+            free(writer);
+            writer = NULL;
+        }
+    }
+
+    return writer;
+}
+
+static int coltrace_writer_flush(coltrace_writer_t* writer)
+{
+    int ret = 0;
+
+    if (writer->nb_rows > 0) {
+        uint8_t* bytes = writer->block;
+        size_t length;
+
+        coltrace_encode_le(bytes, writer->nb_rows, 4);
+        coltrace_encode_le(bytes + 4, 0, 4);
+        bytes += 8;
+        for (int i = 0; i < coltrace_nb_columns; i++) {
+            coltrace_encode_le(bytes, writer->min_value[i], 8);
+            coltrace_encode_le(bytes + 8, writer->max_value[i], 8);
+            bytes += 16;
+        }
+        for (int i = 0; i < coltrace_nb_columns; i++) {
+            const uint64_t* column = writer->values + (size_t)i * COLTRACE_BLOCK_ROWS;
+            size_t width = coltrace_columns[i].width;
+
+            for (uint32_t r = 0; r < writer->nb_rows; r++) {
+                coltrace_encode_le(bytes, column[r], width);
+                bytes += width;
+            }
+        }
+        length = bytes - writer->block;
+        if (fwrite(writer->block, 1, length, writer->F) != length) {
+            ret = -1;
+        }
+        writer->nb_rows = 0;
+    }
+
+    return ret;
+}
+
+int coltrace_writer_add(coltrace_writer_t* writer, const uint64_t row[coltrace_nb_columns])
+{
+    int ret = 0;
+
+    for (int i = 0; i < coltrace_nb_columns; i++) {
+        uint64_t v = row[i];
+
+        if (coltrace_columns[i].width < 8) {
+            uint64_t v_max = (((uint64_t)1) << (8 * coltrace_columns[i].width)) - 1;
+            if (v > v_max) {
+                v = v_max;
+            }
+        }
+        if (writer->nb_rows == 0 || v < writer->min_value[i]) {
+            writer->min_value[i] = v;
+        }
+        if (writer->nb_rows == 0 || v > writer->max_value[i]) {
+            writer->max_value[i] = v;
+        }
+        writer->values[(size_t)i * COLTRACE_BLOCK_ROWS + writer->nb_rows] = v;
+    }
+
+    writer->nb_rows++;
+    if (writer->nb_rows >= COLTRACE_BLOCK_ROWS) {
+        ret = coltrace_writer_flush(writer);
+    }
+
+    return ret;
+}
+
+int coltrace_writer_close(coltrace_writer_t* writer)
+{
+    int ret = coltrace_writer_flush(writer);
+
+    free(writer->values);
+    free(writer->block);
+    free(writer);
+
+    return ret;
+}
+
+/* Reader */
+
+static int coltrace_seek(FILE* F, uint64_t offset)
+{
+#ifdef _WINDOWS
+    return _fseeki64(F, (__int64)offset, SEEK_SET);
+#else
+    return fseeko(F, (off_t)offset, SEEK_SET);
+#endif
+}
+
+coltrace_reader_t* coltrace_reader_open(char const* trace_name)
+{
+    int ret = 0;
+    uint8_t header[COLTRACE_HEADER_SIZE];
+    coltrace_reader_t* reader = (coltrace_reader_t*)malloc(sizeof(coltrace_reader_t));
+
+    if (reader == NULL) {
+        return NULL;
+    }
+
+    memset(reader, 0, sizeof(coltrace_reader_t));
+    if ((reader->F = picoquic_file_open(trace_name, "rb")) == NULL ||
+        fread(header, 1, sizeof(header), reader->F) != sizeof(header) ||
+        memcmp(header, "pqct", 4) != 0 ||
+        coltrace_decode_le(header + 4, 2) != COLTRACE_VERSION) {
+        DBG_PRINTF("File %s is not a supported columnar trace.\n", trace_name);
+        ret = -1;
+    }
+    else {
+        reader->nb_columns = (uint16_t)coltrace_decode_le(header + 6, 2);
+        reader->block_rows = (uint32_t)coltrace_decode_le(header + 8, 4);
+        reader->start_time = coltrace_decode_le(header + 16, 8);
+        reader->cid.id_len = header[24];
+        if (reader->nb_columns == 0 || reader->nb_columns > coltrace_nb_columns ||
+            reader->block_rows == 0 || reader->block_rows > COLTRACE_BLOCK_ROWS ||
+            reader->cid.id_len > PICOQUIC_CONNECTION_ID_MAX_SIZE) {
+            ret = -1;
+        }
+        else {
+            memcpy(reader->cid.id, header + 25, reader->cid.id_len);
+        }
+    }
+
+    for (int i = 0; ret == 0 && i < reader->nb_columns; i++) {
+        uint8_t entry[COLTRACE_COLUMN_ENTRY_SIZE];
+
+        if (fread(entry, 1, sizeof(entry), reader->F) != sizeof(entry) ||
+            entry[0] == 0 || entry[0] > 8) {
+            ret = -1;
+        }
+        else {
+            reader->width[i] = entry[0];
+            memcpy(reader->name[i], entry + 1, COLTRACE_COLUMN_NAME_MAX);
+            reader->name[i][COLTRACE_COLUMN_NAME_MAX] = 0;
+        }
+    }
+
+    if (ret == 0) {
+        reader->data_offset = COLTRACE_HEADER_SIZE + (uint64_t)reader->nb_columns * COLTRACE_COLUMN_ENTRY_SIZE;
+        if ((reader->buffer = (uint8_t*)malloc((size_t)reader->block_rows * 8)) == NULL) {
+            ret = -1;
+        }
+    }
+
+    if (ret != 0) {
+        coltrace_reader_close(reader);
+        reader = NULL;
+    }
+
+    return reader;
+}
+
+void coltrace_reader_close(coltrace_reader_t* reader)
+{
+    (void)picoquic_file_close(reader->F);
+    free(reader->buffer);
+    free(reader);
+}
+
+int coltrace_column_by_name(const coltrace_reader_t* reader, char const* name)
+{
+    for (int i = 0; i < reader->nb_columns; i++) {
+        if (strcmp(reader->name[i], name) == 0) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+int coltrace_scan_column(coltrace_reader_t* reader, int column, uint64_t range_min, uint64_t range_max,
+    coltrace_scan_fn cb, void* cbptr)
+{
+    int ret = 0;
+    uint8_t block_header[COLTRACE_BLOCK_HEADER_SIZE(coltrace_nb_columns)];
+    size_t header_size = COLTRACE_BLOCK_HEADER_SIZE(reader->nb_columns);
+    size_t row_width = 0;
+    size_t column_start = 0;
+    uint64_t offset = reader->data_offset;
+    uint64_t row = 0;
+
+    if (column < 0 || column >= reader->nb_columns) {
+        return -1;
+    }
+
+    for (int i = 0; i < reader->nb_columns; i++) {
+        if (i == column) {
+            column_start = row_width;
+        }
+        row_width += reader->width[i];
+    }
+
+    while (ret == 0) {
+        size_t nb_read;
+        uint32_t nb_rows;
+
+        if (coltrace_seek(reader->F, offset) != 0) {
+            ret = -1;
+            break;
+        }
+        nb_read = fread(block_header, 1, header_size, reader->F);
+        if (nb_read == 0) {
+            /* End of the trace */
+            break;
+        }
+        nb_rows = (uint32_t)coltrace_decode_le(block_header, 4);
+        if (nb_read != header_size || nb_rows == 0 || nb_rows > reader->block_rows) {
+            ret = -1;
+        }
+        else {
+            uint64_t block_min = coltrace_decode_le(block_header + 8 + 16 * column, 8);
+            uint64_t block_max = coltrace_decode_le(block_header + 16 + 16 * column, 8);
+
+            if (block_max >= range_min && block_min <= range_max) {
+                size_t width = reader->width[column];
+                size_t length = width * nb_rows;
+
+                if (coltrace_seek(reader->F, offset + header_size + column_start * nb_rows) != 0 ||
+                    fread(reader->buffer, 1, length, reader->F) != length) {
+                    ret = -1;
+                }
+                for (uint32_t r = 0; ret == 0 && r < nb_rows; r++) {
+                    uint64_t v = coltrace_decode_le(reader->buffer + r * width, width);
+                    if (v >= range_min && v <= range_max) {
+                        ret = cb(row + r, v, cbptr);
+                    }
+                }
+            }
+            row += nb_rows;
+            offset += header_size + row_width * nb_rows;
+        }
+    }
+
+    return ret;
+}
+
+typedef struct st_coltrace_column_array_t {
+    uint64_t* values;
+    size_t nb_values;
+    size_t nb_alloc;
+} coltrace_column_array_t;
+
+static int coltrace_read_column_cb(uint64_t row, uint64_t value, void* cbptr)
+{
+    int ret = 0;
+    coltrace_column_array_t* array = (coltrace_column_array_t*)cbptr;
+
+    if (array->nb_values >= array->nb_alloc) {
+        size_t new_alloc = (array->nb_alloc == 0) ? COLTRACE_BLOCK_ROWS : 2 * array->nb_alloc;
+        uint64_t* new_values = (uint64_t*)realloc(array->values, new_alloc * sizeof(uint64_t));
+
+        if (new_values == NULL) {
+            ret = -1;
+        }
+        else {
+            array->values = new_values;
+            array->nb_alloc = new_alloc;
+        }
+    }
+    if (ret == 0) {
+        array->values[array->nb_values++] = value;
+    }
+
+    return ret;
+}
+
+int coltrace_read_column(coltrace_reader_t* reader, int column, uint64_t** values, size_t* nb_values)
+{
+    coltrace_column_array_t array;
+    int ret;
+
+    memset(&array, 0, sizeof(array));
+    ret = coltrace_scan_column(reader, column, 0, UINT64_MAX, coltrace_read_column_cb, &array);
+    if (ret != 0) {
+        free(array.values);
+        array.values = NULL;
+        array.nb_values = 0;
+    }
+    *values = array.values;
+    *nb_values = array.nb_values;
+
+    return ret;
+}
+
+/* Conversion from the binary log */
+
+typedef struct st_coltrace_path_state_t {
+    uint64_t path_id;
+    uint64_t cwin;
+    uint64_t bytes_in_flight;
+    uint64_t rtt;
+    uint64_t pacing_rate;
+} coltrace_path_state_t;
+
+typedef struct st_coltrace_context_t {
+    FILE* f_trace;
+    picoquic_connection_id_t cid;
+    coltrace_writer_t* writer;
+    uint64_t start_time;
+    coltrace_path_state_t paths[COLTRACE_PATH_STATE_MAX];
+} coltrace_context_t;
+
+static int coltrace_start(coltrace_context_t* ctx, uint64_t time)
+{
+    int ret = 0;
+
+    if (ctx->writer == NULL) {
+        ctx->start_time = time;
+        if ((ctx->writer = coltrace_writer_open(ctx->f_trace, &ctx->cid, time)) == NULL) {
+            ret = -1;
+        }
+    }
+
+    return ret;
+}
+
+/* The state of the recent paths is kept in a small direct mapped table */
+static coltrace_path_state_t* coltrace_path_state(coltrace_context_t* ctx, uint64_t path_id)
+{
+    coltrace_path_state_t* state = &ctx->paths[path_id % COLTRACE_PATH_STATE_MAX];
+
+    if (state->path_id != path_id) {
+        memset(state, 0, sizeof(coltrace_path_state_t));
+        state->path_id = path_id;
+    }
+
+    return state;
+}
+
+static int coltrace_add_packet(coltrace_context_t* ctx, uint64_t time, uint64_t path_id,
+    uint64_t sequence, uint64_t size, int is_lost)
+{
+    int ret = coltrace_start(ctx, time);
+
+    if (ret == 0) {
+        coltrace_path_state_t* state = coltrace_path_state(ctx, path_id);
+        uint64_t row[coltrace_nb_columns];
+
+        row[coltrace_column_time] = (time > ctx->start_time) ? time - ctx->start_time : 0;
+        row[coltrace_column_path] = path_id;
+        row[coltrace_column_pn] = sequence;
+        row[coltrace_column_size] = size;
+        row[coltrace_column_cwin] = state->cwin;
+        row[coltrace_column_bytes_in_flight] = state->bytes_in_flight;
+        row[coltrace_column_rtt] = state->rtt;
+        row[coltrace_column_pacing_rate] = state->pacing_rate;
+        row[coltrace_column_lost] = is_lost;
+        ret = coltrace_writer_add(ctx->writer, row);
+    }
+
+    return ret;
+}
+
+static int coltrace_connection_start(uint64_t time, const picoquic_connection_id_t* cid, int client_mode,
+    uint32_t proposed_version, const picoquic_connection_id_t* remote_cnxid, void* ptr)
+{
+    return coltrace_start((coltrace_context_t*)ptr, time);
+}
+
+static int coltrace_connection_end(uint64_t time, void* ptr)
+{
+    return 0;
+}
+
+static int coltrace_ignore_event(uint64_t time, bytestream* s, void* ptr)
+{
+    return 0;
+}
+
+static int coltrace_ignore_path_event(uint64_t time, uint64_t path_id, bytestream* s, void* ptr)
+{
+    return 0;
+}
+
+static int coltrace_pdu(uint64_t time, int rxtx, bytestream* s, void* ptr)
+{
+    return 0;
+}
+
+static int coltrace_packet_start(uint64_t time, uint64_t path_id, uint64_t size, const picoquic_packet_header* ph, int rxtx, void* ptr)
+{
+    int ret = 0;
+
+    if (!rxtx) {
+        ret = coltrace_add_packet((coltrace_context_t*)ptr, time, path_id, ph->pn64, size, 0);
+    }
+
+    return ret;
+}
+
+static int coltrace_packet_frame(bytestream* s, void* ptr)
+{
+    return 0;
+}
+
+static int coltrace_packet_end(void* ptr)
+{
+    return 0;
+}
+
+static int coltrace_packet_lost(uint64_t time, uint64_t path_id, bytestream* s, void* ptr)
+{
+    uint64_t packet_type = 0;
+    uint64_t sequence = 0;
+    uint64_t trigger_length = 0;
+    uint8_t cid_len = 0;
+    uint64_t packet_size = 0;
+    int ret = 0;
+
+    ret |= byteread_vint(s, &packet_type);
+    ret |= byteread_vint(s, &sequence);
+    ret |= byteread_vint(s, &trigger_length);
+    ret |= bytestream_skip(s, (size_t)trigger_length);
+    ret |= byteread_int8(s, &cid_len);
+    ret |= bytestream_skip(s, cid_len);
+    ret |= byteread_vint(s, &packet_size);
+
+    if (ret == 0) {
+        ret = coltrace_add_packet((coltrace_context_t*)ptr, time, path_id, sequence, packet_size, 1);
+    }
+
+    return ret;
+}
+
+static int coltrace_cc_update(uint64_t time, uint64_t path_id, bytestream* s, void* ptr)
+{
+    coltrace_context_t* ctx = (coltrace_context_t*)ptr;
+    uint64_t v = 0;
+    uint64_t packet_rcvd = 0;
+    uint64_t cwin = 0;
+    uint64_t rtt_sample = 0;
+    uint64_t send_mtu = 0;
+    uint64_t pacing_packet_time = 0;
+    uint64_t bytes_in_transit = 0;
+    int ret = 0;
+
+    ret |= byteread_vint(s, &v); /* sequence */
+    ret |= byteread_vint(s, &packet_rcvd);
+    if (packet_rcvd != 0) {
+        ret |= byteread_vint(s, &v); /* highest ack */
+        ret |= byteread_vint(s, &v); /* high ack time */
+        ret |= byteread_vint(s, &v); /* last time ack */
+    }
+    ret |= byteread_vint(s, &cwin);
+    ret |= byteread_vint(s, &v); /* one way delay */
+    ret |= byteread_vint(s, &rtt_sample);
+    ret |= byteread_vint(s, &v); /* SRTT */
+    ret |= byteread_vint(s, &v); /* RTT min */
+    ret |= byteread_vint(s, &v); /* bandwidth estimate */
+    ret |= byteread_vint(s, &v); /* receive rate estimate */
+    ret |= byteread_vint(s, &send_mtu);
+    ret |= byteread_vint(s, &pacing_packet_time);
+    ret |= byteread_vint(s, &v); /* nb retrans */
+    ret |= byteread_vint(s, &v); /* nb spurious */
+    ret |= byteread_vint(s, &v); /* cwin blocked */
+    ret |= byteread_vint(s, &v); /* flow blocked */
+    ret |= byteread_vint(s, &v); /* stream blocked */
+    /* The last fields are absent in older logs */
+    if (ret == 0 && byteread_vint(s, &v) == 0 && /* cc state */
+        byteread_vint(s, &v) == 0 && /* cc param */
+        byteread_vint(s, &v) == 0) { /* bw max */
+        (void)byteread_vint(s, &bytes_in_transit);
+    }
+
+    if (ret == 0) {
+        coltrace_path_state_t* state = coltrace_path_state(ctx, path_id);
+
+        state->cwin = cwin;
+        state->rtt = rtt_sample;
+        state->bytes_in_flight = bytes_in_transit;
+        state->pacing_rate = (pacing_packet_time > 0) ? (send_mtu * 1000000) / pacing_packet_time : 0;
+    }
+
+    return ret;
+}
+
+static void coltrace_init_context(coltrace_context_t* coltrace, binlog_convert_cb_t* ctx, FILE* f_trace,
+    const picoquic_connection_id_t* cid)
+{
+    memset(coltrace, 0, sizeof(coltrace_context_t));
+    coltrace->f_trace = f_trace;
+    coltrace->cid = *cid;
+    for (int i = 0; i < COLTRACE_PATH_STATE_MAX; i++) {
+        coltrace->paths[i].path_id = i;
+    }
+
+    ctx->connection_start = coltrace_connection_start;
+    ctx->connection_end = coltrace_connection_end;
+    ctx->alpn_update = coltrace_ignore_event;
+    ctx->param_update = coltrace_ignore_event;
+    ctx->pdu = coltrace_pdu;
+    ctx->packet_start = coltrace_packet_start;
+    ctx->packet_frame = coltrace_packet_frame;
+    ctx->packet_end = coltrace_packet_end;
+    ctx->packet_lost = coltrace_packet_lost;
+    ctx->packet_dropped = coltrace_ignore_path_event;
+    ctx->packet_buffered = coltrace_ignore_path_event;
+    ctx->cc_update = coltrace_cc_update;
+    ctx->info_message = coltrace_ignore_event;
+    ctx->ptr = coltrace;
+}
+
+static int coltrace_finish(coltrace_context_t* coltrace, int ret)
+{
+    /* A connection without events still produces a valid, empty trace */
+    if (ret == 0) {
+        ret = coltrace_start(coltrace, 0);
+    }
+    if (coltrace->writer != NULL) {
+        int close_ret = coltrace_writer_close(coltrace->writer);
+        if (ret == 0) {
+            ret = close_ret;
+        }
+        coltrace->writer = NULL;
+    }
+
+    return ret;
+}
+
+int coltrace_convert(const picoquic_connection_id_t* cid, FILE* f_binlog, FILE* f_trace)
+{
+    coltrace_context_t coltrace;
+    binlog_convert_cb_t ctx;
+
+    coltrace_init_context(&coltrace, &ctx, f_trace, cid);
+
+    return coltrace_finish(&coltrace, binlog_convert(f_binlog, cid, &ctx));
+}
+
+int coltrace_convert_index(binlog_index_t* index, binlog_cnx_index_t* cnx, const binlog_filter_t* filter, FILE* f_trace)
+{
+    coltrace_context_t coltrace;
+    binlog_convert_cb_t ctx;
+
+    coltrace_init_context(&coltrace, &ctx, f_trace, &cnx->cid);
+
+    return coltrace_finish(&coltrace, binlog_index_convert(index, cnx, filter, &ctx));
+}
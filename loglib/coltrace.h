@@ -0,0 +1,120 @@
+/*
+* Columnar per packet trace.
+*
+* The csv and qlog files are text, and the binary log is a sequence of
+* variable length events. Both are slow to load in analysis tools when a
+* capture contains millions of packets. The columnar trace keeps one row
+* per packet sent or declared lost, with a fixed set of columns, and
+* stores the rows in blocks. Inside a block, the values of each column
+* are contiguous, little endian, with a fixed width per column. Each
+* block starts with the minimum and maximum value of every column, so a
+* reader can load a single column, or skip the blocks that are out of
+* the range of interest, without decoding the other columns.
+*
+* The trace is produced from the binary log, for one connection:
+*
+*   file header (COLTRACE_HEADER_SIZE bytes):
+*     magic "pqct", version (16 bits), number of columns (16 bits),
+*     maximum rows per block (32 bits), reserved (32 bits),
+*     connection start time (64 bits), cid length (8 bits), cid (20 bytes),
+*     3 bytes of padding.
+*   column table, one entry of COLTRACE_COLUMN_ENTRY_SIZE bytes per column:
+*     width in bytes (8 bits), name (15 bytes, zero padded).
+*   blocks:
+*     number of rows (32 bits), reserved (32 bits),
+*     min and max of each column (2 x 64 bits per column),
+*     column 0 values, column 1 values, etc.
+*
+* Times are in microseconds from the start of the connection. The cwin,
+* bytes in flight, rtt sample and pacing rate columns carry the last
+* congestion control state logged for the path before the packet. Lost
+* packets appear in a separate row, at the time the loss is detected,
+* with the lost column set to 1.
+*/
+#ifndef COLTRACE_H
+#define COLTRACE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "picoquic_internal.h"
+#include "logreader.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define COLTRACE_VERSION 1
+#define COLTRACE_BLOCK_ROWS 4096
+#define COLTRACE_HEADER_SIZE 48
+#define COLTRACE_COLUMN_ENTRY_SIZE 16
+#define COLTRACE_COLUMN_NAME_MAX 15
+#define COLTRACE_BLOCK_HEADER_SIZE(nb_columns) (8 + 16 * (size_t)(nb_columns))
+
+typedef enum {
+    coltrace_column_time = 0,
+    coltrace_column_path,
+    coltrace_column_pn,
+    coltrace_column_size,
+    coltrace_column_cwin,
+    coltrace_column_bytes_in_flight,
+    coltrace_column_rtt,
+    coltrace_column_pacing_rate,
+    coltrace_column_lost,
+    coltrace_nb_columns
+} coltrace_column_enum;
+
+/* Writer, one per connection */
+typedef struct st_coltrace_writer_t {
+    FILE* F;
+    uint32_t nb_rows;
+    uint64_t min_value[coltrace_nb_columns];
+    uint64_t max_value[coltrace_nb_columns];
+    uint64_t* values; /* nb_columns x COLTRACE_BLOCK_ROWS, column major */
+    uint8_t* block; /* encoding buffer */
+} coltrace_writer_t;
+
+/* The writer does not take ownership of the file, which the caller closes
+ * after coltrace_writer_close. The file shall be open in binary mode. */
+coltrace_writer_t* coltrace_writer_open(FILE* F, const picoquic_connection_id_t* cid, uint64_t start_time);
+/* Values that are larger than the width of their column are saturated */
+int coltrace_writer_add(coltrace_writer_t* writer, const uint64_t row[coltrace_nb_columns]);
+/* Write the last block and free the writer */
+int coltrace_writer_close(coltrace_writer_t* writer);
+
+/* Reader */
+typedef struct st_coltrace_reader_t {
+    FILE* F;
+    uint16_t nb_columns;
+    uint32_t block_rows;
+    uint64_t start_time;
+    picoquic_connection_id_t cid;
+    uint8_t width[coltrace_nb_columns];
+    char name[coltrace_nb_columns][COLTRACE_COLUMN_NAME_MAX + 1];
+    uint64_t data_offset; /* offset of the first block */
+    uint8_t* buffer;
+} coltrace_reader_t;
+
+coltrace_reader_t* coltrace_reader_open(char const* trace_name);
+void coltrace_reader_close(coltrace_reader_t* reader);
+/* Returns the column number, or -1 if there is no such column */
+int coltrace_column_by_name(const coltrace_reader_t* reader, char const* name);
+
+/* Call back cb for each value of the column between range_min and
+ * range_max included, in row order. The blocks that do not contain such
+ * values are skipped, and only the selected column is read. */
+typedef int (*coltrace_scan_fn)(uint64_t row, uint64_t value, void* cbptr);
+int coltrace_scan_column(coltrace_reader_t* reader, int column, uint64_t range_min, uint64_t range_max,
+    coltrace_scan_fn cb, void* cbptr);
+/* Read all the values of a column in an array allocated with malloc */
+int coltrace_read_column(coltrace_reader_t* reader, int column, uint64_t** values, size_t* nb_values);
+
+/* Produce the columnar trace of a connection, either from the binary log
+ * file or from its index. */
+int coltrace_convert(const picoquic_connection_id_t* cid, FILE* f_binlog, FILE* f_trace);
+int coltrace_convert_index(binlog_index_t* index, binlog_cnx_index_t* cnx, const binlog_filter_t* filter, FILE* f_trace);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COLTRACE_H */
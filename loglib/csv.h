@@ -21,6 +21,7 @@
 
 #include <stdio.h>
 #include <inttypes.h>
+#include "logreader.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -31,6 +32,7 @@ FILE * picoquic_open_cc_log_file_for_read(char const * bin_cc_log_name, uint16_t
 /* Extract all picoquic_log_event_cc_update events from the binary log file and write them into an csv file. */
 int picoquic_cc_log_file_to_csv(char const* bin_cc_log_name, char const* csv_cc_log_name);
 int picoquic_cc_bin_to_csv(FILE * f_binlog, FILE * f_csvlog);
+int picoquic_cc_index_to_csv(binlog_index_t* index, binlog_cnx_index_t* cnx, const binlog_filter_t* filter, FILE* f_csvlog);
 
 #ifdef __cplusplus
 }
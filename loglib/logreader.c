@@ -20,15 +20,23 @@
 */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <inttypes.h>
 #include <errno.h>
+#ifndef _WINDOWS
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #include "picoquic_internal.h"
 #include "bytestream.h"
 #include "logreader.h"
 #include "picoquic_binlog.h"
 #include "cidset.h"
+#include "picohash.h"
 
 static int byteread_packet_header(bytestream * s, picoquic_packet_header * ph);
 
@@ -209,6 +217,339 @@ int binlog_convert(FILE * f_binlog, const picoquic_connection_id_t * cid, binlog
     return fileread_binlog(f_binlog, binlog_convert_event, &ctx);
 }
 
+int binlog_event_category(uint64_t event_id)
+{
+    int category;
+
+    switch (event_id) {
+    case picoquic_log_event_pdu_sent:
+    case picoquic_log_event_pdu_recv:
+    case picoquic_log_event_packet_sent:
+    case picoquic_log_event_packet_recv:
+    case picoquic_log_event_frame_sent:
+    case picoquic_log_event_frame_recv:
+        category = BINLOG_CATEGORY_PACKET;
+        break;
+    case picoquic_log_event_packet_lost:
+    case picoquic_log_event_packet_dropped:
+    case picoquic_log_event_packet_buffered:
+        category = BINLOG_CATEGORY_RECOVERY;
+        break;
+    case picoquic_log_event_cc_update:
+        category = BINLOG_CATEGORY_CC;
+        break;
+    case picoquic_log_event_info_message:
+        category = BINLOG_CATEGORY_INFO;
+        break;
+    default:
+        category = BINLOG_CATEGORY_PARAM;
+        break;
+    }
+
+    return category;
+}
+
+void binlog_filter_init(binlog_filter_t* filter)
+{
+    memset(filter, 0, sizeof(binlog_filter_t));
+    filter->time_max = UINT64_MAX;
+    filter->category_mask = BINLOG_CATEGORY_ALL;
+}
+
+static int binlog_filter_pass(const binlog_filter_t* filter, uint64_t start_time, const uint8_t* bytes, size_t length)
+{
+    int pass = 1;
+    bytestream stream;
+    bytestream* s = bytestream_ref_init(&stream, bytes, length);
+    uint64_t time = 0;
+    uint64_t path_id = 0;
+    uint64_t id = 0;
+
+    if (byteskip_cid(s) == 0 && byteread_vint(s, &time) == 0 &&
+        byteread_vint(s, &path_id) == 0 && byteread_vint(s, &id) == 0 &&
+        id != picoquic_log_event_new_connection && id != picoquic_log_event_connection_close) {
+        int category = binlog_event_category(id);
+
+        time = (time > start_time) ? time - start_time : 0;
+        if (time < filter->time_min || time > filter->time_max ||
+            (filter->category_mask & category) == 0 ||
+            (filter->filter_path && path_id != filter->path_id &&
+            (category & (BINLOG_CATEGORY_PACKET | BINLOG_CATEGORY_RECOVERY | BINLOG_CATEGORY_CC)) != 0)) {
+            pass = 0;
+        }
+    }
+
+    return pass;
+}
+
+static binlog_cnx_index_t* binlog_index_add_cnx(binlog_index_t* index, picohash_table* cnx_table,
+    const picoquic_connection_id_t* cid, uint64_t start_time)
+{
+    binlog_cnx_index_t* cnx = NULL;
+    binlog_cnx_index_t** new_cnx = (binlog_cnx_index_t**)realloc(index->cnx, (index->nb_cnx + 1) * sizeof(binlog_cnx_index_t*));
+
+    if (new_cnx != NULL) {
+        index->cnx = new_cnx;
+        cnx = (binlog_cnx_index_t*)malloc(sizeof(binlog_cnx_index_t));
+        if (cnx != NULL) {
+            memset(cnx, 0, sizeof(binlog_cnx_index_t));
+            cnx->cid = *cid;
+            cnx->start_time = start_time;
+            if (picohash_insert(cnx_table, cnx) != 0) {
+                free(cnx);
+                cnx = NULL;
+            }
+            else {
+                index->cnx[index->nb_cnx++] = cnx;
+            }
+        }
+    }
+
+    return cnx;
+}
+
+static int binlog_index_add_event(binlog_cnx_index_t* cnx, uint64_t offset)
+{
+    int ret = 0;
+
+    if (cnx->nb_events >= cnx->events_max) {
+        size_t new_max = (cnx->events_max == 0) ? 256 : 2 * cnx->events_max;
+        uint64_t* new_offsets = (uint64_t*)realloc(cnx->event_offsets, new_max * sizeof(uint64_t));
+
+        if (new_offsets == NULL) {
+            ret = -1;
+        }
+        else {
+            cnx->event_offsets = new_offsets;
+            cnx->events_max = new_max;
+        }
+    }
+    if (ret == 0) {
+        cnx->event_offsets[cnx->nb_events++] = offset;
+    }
+
+    return ret;
+}
+
+/* Single pass over the mapped file, reading only the length, CID and time
+ * of each event. */
+static int binlog_index_build(binlog_index_t* index)
+{
+    int ret = 0;
+    size_t offset = 16;
+    picohash_table* cnx_table = cidset_create();
+    binlog_cnx_index_t* last_cnx = NULL;
+
+    if (cnx_table == NULL) {
+        ret = -1;
+    }
+
+    while (ret == 0 && offset + 4 <= index->data_length) {
+        const uint8_t* head = index->data + offset;
+        uint32_t len = (head[0] << 24) | (head[1] << 16) | (head[2] << 8) | head[3];
+
+        if (len > BYTESTREAM_MAX_BUFFER_SIZE || offset + 4 + len > index->data_length) {
+            DBG_PRINTF("Truncated or corrupted event at offset %zu\n", offset);
+            ret = -1;
+        }
+        else {
+            bytestream stream;
+            bytestream* s = bytestream_ref_init(&stream, head + 4, len);
+            picoquic_connection_id_t cid;
+            uint64_t time = 0;
+
+            ret = byteread_cid(s, &cid);
+            if (ret == 0) {
+                ret = byteread_vint(s, &time);
+            }
+            if (ret == 0 && (last_cnx == NULL || picoquic_compare_connection_id(&cid, &last_cnx->cid) != 0)) {
+                picohash_item* item = picohash_retrieve(cnx_table, &cid);
+
+                last_cnx = (item != NULL) ? (binlog_cnx_index_t*)item->key :
+                    binlog_index_add_cnx(index, cnx_table, &cid, time);
+                if (last_cnx == NULL) {
+                    ret = -1;
+                }
+            }
+            if (ret == 0) {
+                ret = binlog_index_add_event(last_cnx, offset);
+            }
+            offset += 4 + (size_t)len;
+        }
+    }
+
+    if (cnx_table != NULL) {
+        /* The connection contexts are owned by the index */
+        picohash_delete(cnx_table, 0);
+    }
+
+    return ret;
+}
+
+static int binlog_index_map(binlog_index_t* index, char const* binlog_name)
+{
+    int ret = 0;
+#ifdef _WINDOWS
+    LARGE_INTEGER file_size;
+
+    index->h_file = CreateFileA(binlog_name, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (index->h_file == INVALID_HANDLE_VALUE || !GetFileSizeEx(index->h_file, &file_size) || file_size.QuadPart < 16) {
+        ret = -1;
+    }
+    else {
+        index->data_length = (size_t)file_size.QuadPart;
+        index->h_map = CreateFileMappingA(index->h_file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (index->h_map == NULL) {
+            ret = -1;
+        }
+        else {
+            index->data = (const uint8_t*)MapViewOfFile(index->h_map, FILE_MAP_READ, 0, 0, 0);
+            if (index->data == NULL) {
+                ret = -1;
+            }
+        }
+    }
+#else
+    int fd = open(binlog_name, O_RDONLY);
+    struct stat st;
+
+    if (fd < 0 || fstat(fd, &st) != 0 || st.st_size < 16) {
+        ret = -1;
+    }
+    else {
+        void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (data == MAP_FAILED) {
+            ret = -1;
+        }
+        else {
+            (void)madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+            index->data = (const uint8_t*)data;
+            index->data_length = (size_t)st.st_size;
+        }
+    }
+    if (fd >= 0) {
+        /* The mapping stays valid after the file is closed */
+        (void)close(fd);
+    }
+#endif
+    if (ret == 0) {
+        index->is_mapped = 1;
+    }
+    return ret;
+}
+
+binlog_index_t* binlog_index_open(char const* binlog_name)
+{
+    int ret = 0;
+    binlog_index_t* index = (binlog_index_t*)malloc(sizeof(binlog_index_t));
+
+    if (index == NULL) {
+        ret = -1;
+    }
+    else {
+        memset(index, 0, sizeof(binlog_index_t));
+#ifdef _WINDOWS
+        index->h_file = INVALID_HANDLE_VALUE;
+#endif
+        ret = binlog_index_map(index, binlog_name);
+        if (ret != 0) {
+            DBG_PRINTF("Cannot map binary log %s.\n", binlog_name);
+        }
+        else {
+            bytestream stream;
+            bytestream* ps = bytestream_ref_init(&stream, index->data, 16);
+            uint32_t fcc = 0;
+            uint16_t version = 0;
+
+            if (byteread_int32(ps, &fcc) != 0 || fcc != FOURCC('q', 'l', 'o', 'g') ||
+                byteread_int16(ps, &index->flags) != 0 ||
+                byteread_int16(ps, &version) != 0 || version != 0x01 ||
+                byteread_int64(ps, &index->log_time) != 0) {
+                DBG_PRINTF("File %s is not a supported binary log.\n", binlog_name);
+                ret = -1;
+            }
+            else {
+                ret = binlog_index_build(index);
+            }
+        }
+    }
+
+    if (ret != 0 && index != NULL) {
+        binlog_index_close(index);
+        index = NULL;
+    }
+
+    return index;
+}
+
+void binlog_index_close(binlog_index_t* index)
+{
+    for (size_t i = 0; i < index->nb_cnx; i++) {
+        free(index->cnx[i]->event_offsets);
+        free(index->cnx[i]);
+    }
+    free(index->cnx);
+#ifdef _WINDOWS
+    if (index->data != NULL) {
+        UnmapViewOfFile(index->data);
+    }
+    if (index->h_map != NULL) {
+        CloseHandle(index->h_map);
+    }
+    if (index->h_file != INVALID_HANDLE_VALUE) {
+        CloseHandle(index->h_file);
+    }
+#else
+    if (index->data != NULL) {
+        (void)munmap((void*)index->data, index->data_length);
+    }
+#endif
+    free(index);
+}
+
+binlog_cnx_index_t* binlog_index_find(binlog_index_t* index, const picoquic_connection_id_t* cid)
+{
+    binlog_cnx_index_t* cnx = NULL;
+
+    for (size_t i = 0; i < index->nb_cnx; i++) {
+        if (picoquic_compare_connection_id(&index->cnx[i]->cid, cid) == 0) {
+            cnx = index->cnx[i];
+            break;
+        }
+    }
+
+    return cnx;
+}
+
+int binlog_index_read(binlog_index_t* index, binlog_cnx_index_t* cnx, const binlog_filter_t* filter,
+    int (*cb)(bytestream*, void*), void* cbptr)
+{
+    int ret = 0;
+
+    for (size_t i = 0; ret == 0 && i < cnx->nb_events; i++) {
+        const uint8_t* head = index->data + cnx->event_offsets[i];
+        uint32_t len = (head[0] << 24) | (head[1] << 16) | (head[2] << 8) | head[3];
+
+        if (filter == NULL || binlog_filter_pass(filter, cnx->start_time, head + 4, len)) {
+            bytestream stream;
+            ret = cb(bytestream_ref_init(&stream, head + 4, len), cbptr);
+        }
+    }
+
+    return ret;
+}
+
+int binlog_index_convert(binlog_index_t* index, binlog_cnx_index_t* cnx, const binlog_filter_t* filter,
+    binlog_convert_cb_t* callbacks)
+{
+    convert_log_file_event_t ctx;
+    ctx.cid = &cnx->cid;
+    ctx.callbacks = callbacks;
+
+    return binlog_index_read(index, cnx, filter, binlog_convert_event, &ctx);
+}
+
 static int binlog_list_cids_cb(bytestream * s, void * cbptr)
 {
     picoquic_connection_id_t cid;
@@ -104,6 +104,74 @@ FILE * open_outfile(const char * cid_name, const char * binlog_name, const char
 
 FILE * picoquic_open_cc_log_file_for_read(char const * bin_cc_log_name, uint16_t * flags, uint64_t * log_time);
 
+/*! \brief Event categories used for filtering indexed conversions.
+ */
+#define BINLOG_CATEGORY_PACKET 1 /* pdu, packet and frame events */
+#define BINLOG_CATEGORY_RECOVERY 2 /* lost, dropped and buffered packets */
+#define BINLOG_CATEGORY_CC 4 /* congestion control updates */
+#define BINLOG_CATEGORY_INFO 8 /* application and info messages */
+#define BINLOG_CATEGORY_PARAM 16 /* transport parameters, ALPN, versions, keys */
+#define BINLOG_CATEGORY_ALL 31
+
+int binlog_event_category(uint64_t event_id);
+
+/*! \brief Filter applied to the events of a connection. The connection
+ *         start and end events always pass, so the output stays well formed.
+ */
+typedef struct st_binlog_filter_t {
+    uint64_t time_min; /*!< Microseconds since the first event of the connection */
+    uint64_t time_max; /*!< Microseconds since the first event, UINT64_MAX if no limit */
+    uint32_t category_mask; /*!< Set of BINLOG_CATEGORY_XXX */
+    int filter_path; /*!< If set, only keep path specific events for path_id */
+    uint64_t path_id;
+} binlog_filter_t;
+
+void binlog_filter_init(binlog_filter_t* filter);
+
+/*! \brief Index of a binary log file. The file is mapped in memory and
+ *         scanned once, and the offsets of the events are listed per
+ *         connection. Conversions then only visit the events of their
+ *         connection, and can run in parallel on different connections
+ *         since the index is not modified after it is built.
+ */
+typedef struct st_binlog_cnx_index_t {
+    picoquic_connection_id_t cid; /*!< Must be first, used as hash key */
+    uint64_t start_time;
+    size_t nb_events;
+    size_t events_max;
+    uint64_t* event_offsets;
+} binlog_cnx_index_t;
+
+typedef struct st_binlog_index_t {
+    const uint8_t* data;
+    size_t data_length;
+    uint16_t flags;
+    uint64_t log_time;
+    size_t nb_cnx;
+    binlog_cnx_index_t** cnx;
+    int is_mapped;
+#ifdef _WINDOWS
+    HANDLE h_file;
+    HANDLE h_map;
+#endif
+} binlog_index_t;
+
+/*! \brief Map and index a binary log file.
+ *  \return the index, or NULL if the file cannot be read or is not a binary log.
+ */
+binlog_index_t* binlog_index_open(char const* binlog_name);
+void binlog_index_close(binlog_index_t* index);
+binlog_cnx_index_t* binlog_index_find(binlog_index_t* index, const picoquic_connection_id_t* cid);
+
+/*! \brief Call cb for each event of the connection that passes the filter.
+ *         The filter may be NULL. */
+int binlog_index_read(binlog_index_t* index, binlog_cnx_index_t* cnx, const binlog_filter_t* filter,
+    int (*cb)(bytestream*, void*), void* cbptr);
+
+/*! \brief Same as binlog_convert, using the index of the file. */
+int binlog_index_convert(binlog_index_t* index, binlog_cnx_index_t* cnx, const binlog_filter_t* filter,
+    binlog_convert_cb_t* callbacks);
+
 int picoquic_cc_log_file_to_csv(char const * bin_cc_log_name, char const * csv_cc_log_name);
 
 #ifdef __cplusplus
@@ -1464,6 +1464,33 @@ int qlog_connection_end(uint64_t time, void * ptr)
     return 0;
 }
 
+static void qlog_init_context(qlog_context_t* qlog, binlog_convert_cb_t* ctx, FILE* f_txtlog, const char* cid_name, uint16_t flags)
+{
+    memset(qlog, 0, sizeof(qlog_context_t));
+
+    qlog->f_txtlog = f_txtlog;
+    qlog->cid_name = cid_name;
+    qlog->start_time = 0;
+    qlog->packet_count = 0;
+    qlog->state = 0;
+    qlog->trace_flow_id = (flags & 1) ? 1 : 0;
+
+    ctx->connection_start = qlog_connection_start;
+    ctx->connection_end = qlog_connection_end;
+    ctx->alpn_update = qlog_alpn_update;
+    ctx->param_update = qlog_param_update;
+    ctx->pdu = qlog_pdu;
+    ctx->packet_start = qlog_packet_start;
+    ctx->packet_frame = qlog_packet_frame;
+    ctx->packet_end = qlog_packet_end;
+    ctx->packet_lost = qlog_packet_lost;
+    ctx->packet_dropped = qlog_packet_dropped;
+    ctx->packet_buffered = qlog_packet_buffered;
+    ctx->cc_update = qlog_cc_update;
+    ctx->info_message = qlog_info_message;
+    ctx->ptr = qlog;
+}
+
 int qlog_convert(const picoquic_connection_id_t* cid, FILE* f_binlog, const char* binlog_name, const char* txt_name, const char* out_dir, uint16_t flags)
 {
     int ret = 0;
@@ -1487,31 +1514,9 @@ int qlog_convert(const picoquic_connection_id_t* cid, FILE* f_binlog, const char
     else  if (ret == 0) {
 
         qlog_context_t qlog;
-
-        memset(&qlog, 0, sizeof(qlog_context_t));
-
-        qlog.f_txtlog = f_txtlog;
-        qlog.cid_name = cid_name;
-        qlog.start_time = 0;
-        qlog.packet_count = 0;
-        qlog.state = 0;
-        qlog.trace_flow_id = (flags & 1) ? 1 : 0;
-
         binlog_convert_cb_t ctx;
-        ctx.connection_start = qlog_connection_start;
-        ctx.connection_end = qlog_connection_end;
-        ctx.alpn_update = qlog_alpn_update;
-        ctx.param_update = qlog_param_update;
-        ctx.pdu = qlog_pdu;
-        ctx.packet_start = qlog_packet_start;
-        ctx.packet_frame = qlog_packet_frame;
-        ctx.packet_end = qlog_packet_end;
-        ctx.packet_lost = qlog_packet_lost;
-        ctx.packet_dropped = qlog_packet_dropped;
-        ctx.packet_buffered = qlog_packet_buffered;
-        ctx.cc_update = qlog_cc_update;
-        ctx.info_message = qlog_info_message;
-        ctx.ptr = &qlog;
+
+        qlog_init_context(&qlog, &ctx, f_txtlog, cid_name, flags);
 
         ret = binlog_convert(f_binlog, cid, &ctx);
 
@@ -1524,3 +1529,27 @@ int qlog_convert(const picoquic_connection_id_t* cid, FILE* f_binlog, const char
 
     return ret;
 }
+
+int qlog_convert_index(binlog_index_t* index, binlog_cnx_index_t* cnx, const binlog_filter_t* filter, FILE* f_txtlog)
+{
+    int ret = 0;
+    char cid_name[2 * PICOQUIC_CONNECTION_ID_MAX_SIZE + 1];
+
+    if (picoquic_print_connection_id_hexa(cid_name, sizeof(cid_name), &cnx->cid) != 0) {
+        ret = -1;
+    }
+    else {
+        qlog_context_t qlog;
+        binlog_convert_cb_t ctx;
+
+        qlog_init_context(&qlog, &ctx, f_txtlog, cid_name, index->flags);
+
+        ret = binlog_index_convert(index, cnx, filter, &ctx);
+
+        if (qlog.state == 1) {
+            qlog_connection_end(0, &qlog);
+        }
+    }
+
+    return ret;
+}
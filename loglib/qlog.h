@@ -23,6 +23,7 @@
 
 #include "picoquic_internal.h"
 #include "bytestream.h"
+#include "logreader.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -37,6 +38,10 @@ int qlog_connection_end(uint64_t time, void * ptr);
 
 int qlog_convert(const picoquic_connection_id_t* cid, FILE * f_binlog, const char * binlog_name, const char* txt_name, const char * out_dir, uint16_t flags);
 
+/* Convert one connection of an indexed binary log, writing to an open file.
+ * The events are selected by the filter, which may be NULL. */
+int qlog_convert_index(binlog_index_t* index, binlog_cnx_index_t* cnx, const binlog_filter_t* filter, FILE* f_txtlog);
+
 #ifdef __cplusplus
 }
 #endif
@@ -27,7 +27,9 @@
  * - Generate the corresponding document in memory
  * The "request" is expected to be an H3 request header frame, encoded with QPACK
  * The "response" will include a response header frame and one or several data frames.
- * QPACK encoding only uses the static dictionary.
+ * QPACK encoding only uses the static dictionary, unless the application
+ * manages QPACK encoder and decoder contexts and their streams, in which
+ * case the dynamic table is also used.
  * The server will start the connection by sending a setting frame, which will
  * specify a zero-length dynamic dictionary for QPACK.
  */
@@ -273,6 +275,400 @@ h3zero_qpack_static_t qpack_static[] = {
 
 size_t h3zero_qpack_nb_static = sizeof(qpack_static) / sizeof(h3zero_qpack_static_t);
 
+/* Names of the headers, in the order of http_header_enum_t */
+static char const* h3zero_header_name[http_header_max] = {
+    NULL,
+    ":authority",
+    ":path",
+    "age",
+    "content-disposition",
+    "content-length",
+    "cookie",
+    "date",
+    "etag",
+    "if-modified-since",
+    "if-none-match",
+    "last-modified",
+    "link",
+    "location",
+    "referer",
+    "set-cookie",
+    ":method",
+    ":scheme",
+    ":status",
+    "accept",
+    "accept-encoding",
+    "accept-ranges",
+    "access-control-allow-headers",
+    "access-control-allow-origin",
+    "cache-control",
+    "content-encoding",
+    "content-type",
+    "range",
+    "strict-transport-security",
+    "vary",
+    "x-content-type-options",
+    "x-xss-protection",
+    "accept-language",
+    "access-control-allow-credentials",
+    "access-control-allow-methods",
+    "access-control-expose-headers",
+    "access-control-request-headers",
+    "access-control-request-method",
+    "alt-svc",
+    "authorization",
+    "content-security-policy",
+    "early-data",
+    "expect-ct",
+    "forwarded",
+    "if-range",
+    "origin",
+    "purpose",
+    "server",
+    "timing-allow-origin",
+    "upgrade-insecure-requests",
+    "user-agent",
+    "x-forwarded-for",
+    "x-frame-options"
+};
+
+/*
+ * QPACK dynamic table.
+ *
+ * The entries are allocated with their name and value, and are kept in
+ * a ring of pointers sized for the smallest possible entries, so a
+ * table of max_capacity never needs more than max_capacity/32 slots.
+ * Absolute indices start at zero for the first insertion. The oldest
+ * entry has index insert_count - nb_entries.
+ */
+
+static uint32_t h3zero_qpack_hash(uint8_t const* bytes, size_t length, uint32_t h)
+{
+    /* FNV-1a */
+    for (size_t i = 0; i < length; i++) {
+        h ^= bytes[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static uint32_t h3zero_qpack_field_hash(uint32_t name_hash, uint8_t const* value, size_t value_length)
+{
+    /* Add a separator, so "ab"+"c" and "a"+"bc" do not collide */
+    return h3zero_qpack_hash(value, value_length, (name_hash ^ 0xFF) * 16777619u);
+}
+
+int h3zero_qpack_table_init(h3zero_qpack_table_t* table, uint64_t max_capacity)
+{
+    int ret = 0;
+
+    memset(table, 0, sizeof(h3zero_qpack_table_t));
+    table->max_capacity = max_capacity;
+    if (max_capacity > 0) {
+        table->nb_alloc = (size_t)(max_capacity / H3ZERO_QPACK_ENTRY_OVERHEAD) + 1;
+        table->entries = (h3zero_qpack_entry_t**)malloc(table->nb_alloc * sizeof(h3zero_qpack_entry_t*));
+        if (table->entries == NULL) {
+            table->nb_alloc = 0;
+            table->max_capacity = 0;
+            ret = -1;
+        }
+    }
+    return ret;
+}
+
+static void h3zero_qpack_table_unlink(h3zero_qpack_entry_t** pp, h3zero_qpack_entry_t* entry, int by_name)
+{
+    while (*pp != NULL) {
+        if (*pp == entry) {
+            *pp = (by_name) ? entry->next_by_name : entry->next_by_field;
+            break;
+        }
+        pp = (by_name) ? &(*pp)->next_by_name : &(*pp)->next_by_field;
+    }
+}
+
+static void h3zero_qpack_table_evict_oldest(h3zero_qpack_table_t* table)
+{
+    h3zero_qpack_entry_t* entry = table->entries[table->first];
+
+    h3zero_qpack_table_unlink(&table->by_name[entry->name_hash % H3ZERO_QPACK_HASH_SIZE], entry, 1);
+    h3zero_qpack_table_unlink(&table->by_field[entry->field_hash % H3ZERO_QPACK_HASH_SIZE], entry, 0);
+    table->size -= entry->name_length + entry->value_length + H3ZERO_QPACK_ENTRY_OVERHEAD;
+    table->first = (table->first + 1) % table->nb_alloc;
+    table->nb_entries--;
+    free(entry);
+}
+
+static int h3zero_qpack_table_evict(h3zero_qpack_table_t* table, uint64_t target_size, uint64_t evict_limit)
+{
+    int ret = 0;
+
+    while (table->size > target_size) {
+        if (table->insert_count - table->nb_entries >= evict_limit) {
+            ret = -1;
+            break;
+        }
+        h3zero_qpack_table_evict_oldest(table);
+    }
+    return ret;
+}
+
+void h3zero_qpack_table_release(h3zero_qpack_table_t* table)
+{
+    while (table->nb_entries > 0) {
+        h3zero_qpack_table_evict_oldest(table);
+    }
+    if (table->entries != NULL) {
+        free(table->entries);
+    }
+    memset(table, 0, sizeof(h3zero_qpack_table_t));
+}
+
+h3zero_qpack_entry_t* h3zero_qpack_table_get(h3zero_qpack_table_t* table, uint64_t absolute_index)
+{
+    h3zero_qpack_entry_t* entry = NULL;
+    uint64_t oldest = table->insert_count - table->nb_entries;
+
+    if (absolute_index >= oldest && absolute_index < table->insert_count) {
+        entry = table->entries[(table->first + (size_t)(absolute_index - oldest)) % table->nb_alloc];
+    }
+    return entry;
+}
+
+int h3zero_qpack_table_set_capacity(h3zero_qpack_table_t* table, uint64_t capacity, uint64_t evict_limit)
+{
+    int ret = -1;
+
+    if (capacity <= table->max_capacity &&
+        h3zero_qpack_table_evict(table, capacity, evict_limit) == 0) {
+        table->capacity = capacity;
+        ret = 0;
+    }
+    return ret;
+}
+
+int h3zero_qpack_table_insert(h3zero_qpack_table_t* table, uint8_t const* name, size_t name_length,
+    uint8_t const* value, size_t value_length, uint64_t evict_limit)
+{
+    int ret = 0;
+    uint64_t entry_size = (uint64_t)name_length + value_length + H3ZERO_QPACK_ENTRY_OVERHEAD;
+    h3zero_qpack_entry_t* entry = NULL;
+
+    if (entry_size > table->capacity) {
+        ret = -1;
+    }
+    else if ((entry = (h3zero_qpack_entry_t*)malloc(sizeof(h3zero_qpack_entry_t) + name_length + value_length)) == NULL) {
+        ret = -1;
+    }
+    else {
+        /* The name is copied before evicting, because it may come from an entry that is about to be evicted */
+        memset(entry, 0, sizeof(h3zero_qpack_entry_t));
+        entry->name = ((uint8_t*)entry) + sizeof(h3zero_qpack_entry_t);
+        entry->name_length = name_length;
+        entry->value = entry->name + name_length;
+        entry->value_length = value_length;
+        if (name_length > 0) {
+            memcpy(entry->name, name, name_length);
+        }
+        if (value_length > 0) {
+            memcpy(entry->value, value, value_length);
+        }
+        if (h3zero_qpack_table_evict(table, table->capacity - entry_size, evict_limit) != 0) {
+            free(entry);
+            ret = -1;
+        }
+        else {
+            size_t name_bucket;
+            size_t field_bucket;
+
+            entry->absolute_index = table->insert_count;
+            entry->name_hash = h3zero_qpack_hash(entry->name, name_length, 2166136261u);
+            entry->field_hash = h3zero_qpack_field_hash(entry->name_hash, entry->value, value_length);
+            name_bucket = entry->name_hash % H3ZERO_QPACK_HASH_SIZE;
+            field_bucket = entry->field_hash % H3ZERO_QPACK_HASH_SIZE;
+            entry->next_by_name = table->by_name[name_bucket];
+            table->by_name[name_bucket] = entry;
+            entry->next_by_field = table->by_field[field_bucket];
+            table->by_field[field_bucket] = entry;
+            table->entries[(table->first + table->nb_entries) % table->nb_alloc] = entry;
+            table->nb_entries++;
+            table->insert_count++;
+            table->size += entry_size;
+        }
+    }
+    return ret;
+}
+
+h3zero_qpack_entry_t* h3zero_qpack_table_find_field(h3zero_qpack_table_t* table, uint8_t const* name, size_t name_length,
+    uint8_t const* value, size_t value_length, uint64_t index_limit)
+{
+    uint32_t field_hash = h3zero_qpack_field_hash(h3zero_qpack_hash(name, name_length, 2166136261u), value, value_length);
+    h3zero_qpack_entry_t* entry = table->by_field[field_hash % H3ZERO_QPACK_HASH_SIZE];
+
+    /* Entries are chained from the most recent */
+    while (entry != NULL) {
+        if (entry->absolute_index < index_limit && entry->field_hash == field_hash &&
+            entry->name_length == name_length && entry->value_length == value_length &&
+            memcmp(entry->name, name, name_length) == 0 && memcmp(entry->value, value, value_length) == 0) {
+            break;
+        }
+        entry = entry->next_by_field;
+    }
+    return entry;
+}
+
+h3zero_qpack_entry_t* h3zero_qpack_table_find_name(h3zero_qpack_table_t* table, uint8_t const* name, size_t name_length,
+    uint64_t index_limit)
+{
+    uint32_t name_hash = h3zero_qpack_hash(name, name_length, 2166136261u);
+    h3zero_qpack_entry_t* entry = table->by_name[name_hash % H3ZERO_QPACK_HASH_SIZE];
+
+    while (entry != NULL) {
+        if (entry->absolute_index < index_limit && entry->name_hash == name_hash &&
+            entry->name_length == name_length && memcmp(entry->name, name, name_length) == 0) {
+            break;
+        }
+        entry = entry->next_by_name;
+    }
+    return entry;
+}
+
+/* Buffers of encoder or decoder stream instructions */
+static int h3zero_qpack_buffer_reserve(h3zero_qpack_buffer_t* buffer, size_t length)
+{
+    int ret = 0;
+
+    if (buffer->length + length > buffer->alloc) {
+        size_t new_alloc = (buffer->alloc == 0) ? 256 : 2 * buffer->alloc;
+        uint8_t* new_bytes;
+
+        while (new_alloc < buffer->length + length) {
+            new_alloc *= 2;
+        }
+        new_bytes = (uint8_t*)realloc(buffer->bytes, new_alloc);
+        if (new_bytes == NULL) {
+            ret = -1;
+        }
+        else {
+            buffer->bytes = new_bytes;
+            buffer->alloc = new_alloc;
+        }
+    }
+    return ret;
+}
+
+static int h3zero_qpack_buffer_append(h3zero_qpack_buffer_t* buffer, uint8_t const* bytes, size_t length)
+{
+    int ret = h3zero_qpack_buffer_reserve(buffer, length);
+
+    if (ret == 0 && length > 0) {
+        memcpy(buffer->bytes + buffer->length, bytes, length);
+        buffer->length += length;
+    }
+    return ret;
+}
+
+/* Append an instruction made of a prefixed integer, e.g., a section acknowledgement */
+static int h3zero_qpack_buffer_append_int(h3zero_qpack_buffer_t* buffer, uint8_t prefix, uint8_t mask, uint64_t val)
+{
+    uint8_t instruction[16];
+    uint8_t* bytes;
+
+    instruction[0] = prefix;
+    bytes = h3zero_qpack_int_encode(instruction, instruction + sizeof(instruction), mask, val);
+
+    return (bytes == NULL) ? -1 : h3zero_qpack_buffer_append(buffer, instruction, bytes - instruction);
+}
+
+/* Append a string, Huffman encoded if that is shorter. The H bit is
+ * just above the mask of the length prefix. */
+static int h3zero_qpack_buffer_append_string(h3zero_qpack_buffer_t* buffer, uint8_t prefix, uint8_t mask,
+    uint8_t const* val, size_t val_length)
+{
+    int ret;
+    size_t huffman_length = h3zero_qpack_huffman_length(val, val_length);
+
+    if (huffman_length < val_length) {
+        if ((ret = h3zero_qpack_buffer_append_int(buffer, prefix | (mask + 1), mask, huffman_length)) == 0 &&
+            (ret = h3zero_qpack_buffer_reserve(buffer, huffman_length)) == 0) {
+            (void)h3zero_qpack_huffman_encode(buffer->bytes + buffer->length,
+                buffer->bytes + buffer->length + huffman_length, val, val_length);
+            buffer->length += huffman_length;
+        }
+    }
+    else if ((ret = h3zero_qpack_buffer_append_int(buffer, prefix, mask, val_length)) == 0) {
+        ret = h3zero_qpack_buffer_append(buffer, val, val_length);
+    }
+    return ret;
+}
+
+size_t h3zero_qpack_buffer_take(h3zero_qpack_buffer_t* buffer, uint8_t* bytes, size_t bytes_max)
+{
+    size_t length = (buffer->length < bytes_max) ? buffer->length : bytes_max;
+
+    if (length > 0) {
+        memcpy(bytes, buffer->bytes, length);
+        buffer->length -= length;
+        if (buffer->length > 0) {
+            memmove(buffer->bytes, buffer->bytes + length, buffer->length);
+        }
+    }
+    return length;
+}
+
+void h3zero_qpack_buffer_release(h3zero_qpack_buffer_t* buffer)
+{
+    if (buffer->bytes != NULL) {
+        free(buffer->bytes);
+    }
+    memset(buffer, 0, sizeof(h3zero_qpack_buffer_t));
+}
+
+/*
+ * The Required Insert Count is encoded modulo twice the maximum number
+ * of entries, as specified in RFC 9204, section 4.5.1.1.
+ */
+static uint64_t h3zero_qpack_encode_required_insert_count(uint64_t required_insert_count, uint64_t max_capacity)
+{
+    uint64_t max_entries = max_capacity / H3ZERO_QPACK_ENTRY_OVERHEAD;
+
+    return (required_insert_count == 0) ? 0 : (required_insert_count % (2 * max_entries)) + 1;
+}
+
+static int h3zero_qpack_decode_required_insert_count(uint64_t encoded, uint64_t max_capacity,
+    uint64_t total_inserts, uint64_t* required_insert_count)
+{
+    int ret = 0;
+    uint64_t max_entries = max_capacity / H3ZERO_QPACK_ENTRY_OVERHEAD;
+    uint64_t full_range = 2 * max_entries;
+
+    *required_insert_count = 0;
+    if (encoded != 0) {
+        if (encoded > full_range) {
+            ret = -1;
+        }
+        else {
+            uint64_t max_value = total_inserts + max_entries;
+            uint64_t max_wrapped = (max_value / full_range) * full_range;
+            uint64_t ric = max_wrapped + encoded - 1;
+
+            if (ric > max_value) {
+                if (ric <= full_range) {
+                    ret = -1;
+                }
+                else {
+                    ric -= full_range;
+                }
+            }
+            if (ret == 0 && ric == 0) {
+                ret = -1;
+            }
+            *required_insert_count = ric;
+        }
+    }
+    return ret;
+}
+
 /* 
  * Minimal QPACK parsing.
  *
@@ -290,9 +686,11 @@ size_t h3zero_qpack_nb_static = sizeof(qpack_static) / sizeof(h3zero_qpack_stati
  * |      Compressed Headers     ...
  * +-------------------------------+
  *
- * Since H3zero only support static entries, we expect the required
- * Insert count to be zero, and we always ignore the Base delta.
- * The Base is encoded as sign-and-modulus integer (on 1 byte?)
+ * If the parser is not given a QPACK decoder, h3zero only supports static
+ * entries, we expect the required Insert count to be zero, and we always
+ * ignore the Base delta. The Base is encoded as sign-and-modulus integer.
+ * With a decoder, the Required Insert Count and the Base are decoded, and
+ * the sections can also refer to the dynamic table, see below.
  *
  * We expect the following types of compressed content:
  *
@@ -329,6 +727,28 @@ size_t h3zero_qpack_nb_static = sizeof(qpack_static) / sizeof(h3zero_qpack_stati
  * Literal Header Field Without Name Reference. The N bit is set to zero on write,
  * ignored on read. The H bit is always zero, since we do not implement Huffman
  * encoding.
+ *
+ * The references to the dynamic table use the same formats with the S bit
+ * set to 0, in which case the index is relative to the base, plus two
+ * formats for entries inserted after the base:
+ *
+ *   0   1   2   3   4   5   6   7
+ * +---+---+---+---+---+---+---+---+
+ * | 0 | 0 | 0 | 1 |  Index (4+)   |
+ * +---+---+---+---+---------------+
+ *
+ * Indexed field line with post-base index, and:
+ *
+ *   0   1   2   3   4   5   6   7
+ * +---+---+---+---+---+---+---+---+
+ * | 0 | 0 | 0 | 0 | N |NameIdx(3+)|
+ * +---+---+---+---+---+-----------+
+ * | H |     Value Length (7+)     |
+ * +---+---------------------------+
+ * |  Value String (Length bytes)  |
+ * +-------------------------------+
+ *
+ * Literal field line with post-base name reference.
  */
 
 h3zero_method_enum h3zero_get_method_by_name(uint8_t * name, size_t name_length) {
@@ -381,17 +801,19 @@ int h3zero_parse_status(uint8_t * content, size_t content_length)
     return val;
 }
 
-uint8_t* h3zero_parse_qpack_header_value_string(uint8_t * bytes, uint8_t* decoded,
+static int h3zero_parse_qpack_header_value_string(uint8_t* decoded,
     size_t decoded_length, const uint8_t ** field, size_t * length)
 {
+    int ret = 0;
+
     if (*field != NULL) {
         /* Duplicate field! */
-        bytes = NULL;
+        ret = -1;
     }
     else {
         *field = malloc(decoded_length + 1);
         if (*field == NULL) {
-            bytes = 0;
+            ret = -1;
             *length = 0;
         }
         else {
@@ -400,7 +822,53 @@ uint8_t* h3zero_parse_qpack_header_value_string(uint8_t * bytes, uint8_t* decode
             *length = (size_t)decoded_length;
         }
     }
-    return bytes;
+    return ret;
+}
+
+/* Document the interesting parts of the header, once the value is decoded */
+static int h3zero_parse_qpack_header_value_decoded(http_header_enum_t header, uint8_t* decoded,
+    size_t decoded_length, h3zero_header_parts_t* parts)
+{
+    int ret = 0;
+
+    switch (header) {
+    case http_pseudo_header_method:
+        if (parts->method != h3zero_method_none) {
+            /* Duplicate method! */
+            ret = -1;
+        }
+        else {
+            parts->method = h3zero_get_method_by_name(decoded, decoded_length);
+        }
+        break;
+    case http_header_content_type:
+        if (parts->content_type != h3zero_content_type_none) {
+            /* Duplicate content type! */
+            ret = -1;
+        }
+        else {
+            parts->content_type = h3zero_get_content_type_by_name(decoded, decoded_length);
+        }
+        break;
+    case http_pseudo_header_status:
+        if (parts->status != 0) {
+            /* Duplicate content type! */
+            ret = -1;
+        }
+        else {
+            /* TODO: decimal to binary */
+            parts->status = h3zero_parse_status(decoded, decoded_length);
+        }
+        break;
+    case http_pseudo_header_path:
+        ret = h3zero_parse_qpack_header_value_string(decoded,
+            decoded_length, &parts->path, &parts->path_length);
+        break;
+    default:
+        break;
+    }
+
+    return ret;
 }
 
 uint8_t * h3zero_parse_qpack_header_value(uint8_t * bytes, uint8_t * bytes_max,
@@ -411,6 +879,7 @@ uint8_t * h3zero_parse_qpack_header_value(uint8_t * bytes, uint8_t * bytes_max,
     uint8_t * decoded = NULL;
     size_t decoded_length;
     uint8_t deHuff[256];
+    uint8_t* allocated = NULL;
 
     is_huffman = (bytes[0] >> 7) & 1;
     bytes = h3zero_qpack_int_decode(bytes, bytes_max, 0x7F, &v_length);
@@ -418,60 +887,38 @@ uint8_t * h3zero_parse_qpack_header_value(uint8_t * bytes, uint8_t * bytes_max,
         if (bytes + v_length > bytes_max) {
             bytes = NULL;
         } else {
-            if (is_huffman && hzero_qpack_huffman_decode(
-                bytes, bytes + v_length, deHuff, sizeof(deHuff), &decoded_length) == 0)
-            {
+            if (is_huffman) {
+                /* The shortest Huffman codes have 5 bits */
+                size_t max_decoded = (size_t)(v_length * 8 / 5) + 1;
+
                 decoded = deHuff;
+                if (max_decoded > sizeof(deHuff)) {
+                    decoded = allocated = (uint8_t*)malloc(max_decoded);
+                }
+                if (decoded == NULL || hzero_qpack_huffman_decode(
+                    bytes, bytes + v_length, decoded, max_decoded, &decoded_length) != 0) {
+                    decoded = NULL;
+                }
             }
             else {
                 decoded = bytes;
                 decoded_length = (size_t) v_length;
             }
 
-            switch (header) {
-            case http_pseudo_header_method:
-                if (parts->method != h3zero_method_none) {
-                    /* Duplicate method! */
-                    bytes = 0;
-                }
-                else {
-                    parts->method = h3zero_get_method_by_name(decoded, decoded_length);
-                }
-                break;
-            case http_header_content_type:
-                if (parts->content_type != h3zero_content_type_none) {
-                    /* Duplicate content type! */
-                    bytes = 0;
-                }
-                else {
-                    parts->content_type = h3zero_get_content_type_by_name(decoded, decoded_length);
-                }
-                break;
-            case http_pseudo_header_status:
-                if (parts->status != 0) {
-                    /* Duplicate content type! */
-                    bytes = 0;
-                }
-                else {
-                    /* TODO: decimal to binary */
-                    parts->status = h3zero_parse_status(decoded, decoded_length);
-                }
-                break;
-            case http_pseudo_header_path:
-                bytes = h3zero_parse_qpack_header_value_string(bytes, decoded,
-                    decoded_length, &parts->path, &parts->path_length);
-                break;
-                break;
-            default:
-                break;
+            if (decoded == NULL ||
+                h3zero_parse_qpack_header_value_decoded(header, decoded, decoded_length, parts) != 0) {
+                bytes = NULL;
             }
-
-            if (bytes != NULL) {
+            else {
                 bytes += v_length;
             }
         }
     }
 
+    if (allocated != NULL) {
+        free(allocated);
+    }
+
     return bytes;
 }
 
@@ -504,23 +951,119 @@ int h3zero_get_interesting_header_type(uint8_t * name, size_t name_length, int i
     return val;
 }
 
-uint8_t * h3zero_parse_qpack_header_frame(uint8_t * bytes, uint8_t * bytes_max, 
-    h3zero_header_parts_t * parts)
+static int h3zero_parse_qpack_header_static(uint64_t s_index, h3zero_header_parts_t* parts)
+{
+    int ret = 0;
+
+    switch (qpack_static[s_index].header) {
+    case http_pseudo_header_method:
+        if (parts->method != h3zero_method_none) {
+            /* Duplicate method! */
+            ret = -1;
+        }
+        else {
+            parts->method = (h3zero_method_enum) qpack_static[s_index].enum_as_int;
+        }
+        break;
+    case http_header_content_type:
+        if (parts->content_type != h3zero_content_type_none) {
+            /* Duplicate content type! */
+            ret = -1;
+        }
+        else {
+            parts->content_type = (h3zero_content_type_enum)qpack_static[s_index].enum_as_int;
+        }
+        break;
+    case http_pseudo_header_status:
+        if (parts->status != 0) {
+            /* Duplicate content type! */
+            ret = -1;
+        }
+        else {
+            parts->status = qpack_static[s_index].enum_as_int;
+        }
+        break;
+    case http_pseudo_header_path:
+        ret = h3zero_parse_qpack_header_value_string((uint8_t*)qpack_static[s_index].content,
+            strlen(qpack_static[s_index].content), &parts->path, &parts->path_length);
+        break;
+    default:
+        break;
+    }
+
+    return ret;
+}
+
+/* Find the dynamic entry referenced by a field line. References must be
+ * lower than the Required Insert Count of the section. */
+static h3zero_qpack_entry_t* h3zero_parse_qpack_dynamic_ref(h3zero_qpack_decoder_t* decoder,
+    uint64_t absolute_index, uint64_t required_insert_count)
 {
+    return (absolute_index < required_insert_count) ? h3zero_qpack_table_get(&decoder->table, absolute_index) : NULL;
+}
+
+uint8_t* h3zero_parse_qpack_header_frame_ex(uint8_t* bytes, uint8_t* bytes_max,
+    h3zero_header_parts_t* parts, h3zero_qpack_decoder_t* decoder, uint64_t stream_id, int* is_blocked)
+{
+    uint64_t required_insert_count = 0;
+    uint64_t base = 0;
+
     memset(parts, 0, sizeof(h3zero_header_parts_t));
+    if (is_blocked != NULL) {
+        *is_blocked = 0;
+    }
 
     if (bytes == NULL || bytes >= bytes_max) {
         return NULL;
     }
 
-    /* parse base, expect 0 insert */
-    if (bytes[0] != 0) {
-        /* unexpected value */
-        bytes = NULL;
+    if (decoder == NULL) {
+        /* parse base, expect 0 insert */
+        if (bytes[0] != 0) {
+            /* unexpected value */
+            bytes = NULL;
+        }
+        else {
+            uint64_t delta_base;
+            bytes = h3zero_qpack_int_decode(bytes + 1, bytes_max, 0x7F, &delta_base);
+        }
     }
     else {
+        uint64_t encoded_insert_count;
         uint64_t delta_base;
-        bytes = h3zero_qpack_int_decode(bytes + 1, bytes_max, 0x7F, &delta_base);
+        int is_negative;
+
+        bytes = h3zero_qpack_int_decode(bytes, bytes_max, 0xFF, &encoded_insert_count);
+        if (bytes == NULL || bytes >= bytes_max ||
+            h3zero_qpack_decode_required_insert_count(encoded_insert_count, decoder->table.max_capacity,
+                decoder->table.insert_count, &required_insert_count) != 0) {
+            bytes = NULL;
+        }
+        else {
+            is_negative = (bytes[0] >> 7) & 1;
+            bytes = h3zero_qpack_int_decode(bytes, bytes_max, 0x7F, &delta_base);
+            if (bytes != NULL) {
+                if (!is_negative) {
+                    base = required_insert_count + delta_base;
+                }
+                else if (delta_base < required_insert_count) {
+                    base = required_insert_count - delta_base - 1;
+                }
+                else {
+                    bytes = NULL;
+                }
+            }
+        }
+        if (bytes != NULL && required_insert_count > decoder->table.insert_count) {
+            /* Wait until the encoder stream provides the missing entries */
+            if (is_blocked != NULL) {
+                *is_blocked = 1;
+            }
+            else {
+                bytes = NULL;
+            }
+            return bytes;
+        }
     }
 
     while (bytes != NULL && bytes < bytes_max) {
@@ -530,61 +1073,11 @@ uint8_t * h3zero_parse_qpack_header_frame(uint8_t * bytes, uint8_t * bytes_max,
 
             bytes = h3zero_qpack_int_decode(bytes, bytes_max, 0x3F, &s_index);
 
-            if (s_index > h3zero_qpack_nb_static) {
-                /* Index out of range */
+            if (bytes != NULL && (s_index >= h3zero_qpack_nb_static ||
+                h3zero_parse_qpack_header_static(s_index, parts) != 0)) {
+                /* Index out of range, or duplicate header */
                 bytes = NULL;
             }
-            else {
-                switch (qpack_static[s_index].header) {
-                case http_pseudo_header_method:
-                    if (parts->method != h3zero_method_none) {
-                        /* Duplicate method! */
-                        bytes = 0;
-                    }
-                    else {
-                        parts->method = (h3zero_method_enum) qpack_static[s_index].enum_as_int;
-                    }
-                    break;
-                case http_header_content_type:
-                    if (parts->content_type != h3zero_content_type_none) {
-                        /* Duplicate content type! */
-                        bytes = NULL;
-                    }
-                    else {
-                        parts->content_type = (h3zero_content_type_enum)qpack_static[s_index].enum_as_int;
-                    }
-                    break;
-                case http_pseudo_header_status:
-                    if (parts->status != 0) {
-                        /* Duplicate content type! */
-                        bytes = NULL;
-                    }
-                    else {
-                        parts->status = qpack_static[s_index].enum_as_int;
-                    }
-                    break;
-                case http_pseudo_header_path:
-                    if (parts->path != NULL) {
-                        /* Duplicate path! */
-                        bytes = NULL;
-                    }
-                    else {
-                        parts->path_length = strlen(qpack_static[s_index].content);
-                        parts->path = malloc(parts->path_length + 1);
-                        if (parts->path == NULL) {
-                            /* internal error */
-                            bytes = NULL;
-                        }
-                        else {
-                            memcpy((uint8_t *)parts->path, qpack_static[s_index].content, parts->path_length);
-                            ((uint8_t*)parts->path)[parts->path_length] = 0;
-                        }
-                    }
-                    break;
-                default:
-                    break;
-                }
-            }
         }
         else if ((bytes[0] & 0xD0) == 0x50) {
             /* Literal header field with name reference, static encoding */
@@ -592,7 +1085,7 @@ uint8_t * h3zero_parse_qpack_header_frame(uint8_t * bytes, uint8_t * bytes_max,
 
             bytes = h3zero_qpack_int_decode(bytes, bytes_max, 0x0F, &s_index);
             if (bytes != NULL) {
-                if (s_index > h3zero_qpack_nb_static) {
+                if (s_index >= h3zero_qpack_nb_static) {
                     /* Index out of range */
                     bytes = NULL;
                 } else {
@@ -619,15 +1112,81 @@ uint8_t * h3zero_parse_qpack_header_frame(uint8_t * bytes, uint8_t * bytes_max,
                 }
             }
         }
+        else if (decoder != NULL) {
+            /* References to the dynamic table, relative to the base or post base */
+            uint64_t d_index;
+            uint64_t absolute_index = UINT64_MAX;
+            int is_literal = 0;
+            h3zero_qpack_entry_t* entry = NULL;
+
+            if ((bytes[0] & 0xC0) == 0x80) {
+                /* Indexed field line, dynamic */
+                bytes = h3zero_qpack_int_decode(bytes, bytes_max, 0x3F, &d_index);
+                if (d_index < base) {
+                    absolute_index = base - 1 - d_index;
+                }
+            }
+            else if ((bytes[0] & 0xD0) == 0x40) {
+                /* Literal field line with dynamic name reference */
+                bytes = h3zero_qpack_int_decode(bytes, bytes_max, 0x0F, &d_index);
+                if (d_index < base) {
+                    absolute_index = base - 1 - d_index;
+                }
+                is_literal = 1;
+            }
+            else if ((bytes[0] & 0xF0) == 0x10) {
+                /* Indexed field line with post base index */
+                bytes = h3zero_qpack_int_decode(bytes, bytes_max, 0x0F, &d_index);
+                absolute_index = base + d_index;
+            }
+            else {
+                /* Literal field line with post base name reference */
+                bytes = h3zero_qpack_int_decode(bytes, bytes_max, 0x07, &d_index);
+                absolute_index = base + d_index;
+                is_literal = 1;
+            }
+
+            if (bytes != NULL) {
+                entry = h3zero_parse_qpack_dynamic_ref(decoder, absolute_index, required_insert_count);
+            }
+            if (entry == NULL) {
+                bytes = NULL;
+            }
+            else {
+                http_header_enum_t header_type = h3zero_get_interesting_header_type(entry->name, entry->name_length, 0);
+                if (is_literal) {
+                    bytes = h3zero_parse_qpack_header_value(bytes, bytes_max, header_type, parts);
+                }
+                else if (h3zero_parse_qpack_header_value_decoded(header_type, entry->value, entry->value_length, parts) != 0) {
+                    bytes = NULL;
+                }
+            }
+        }
         else {
             /* unexpected encoding */
             bytes = NULL;
         }
     }
 
+    if (bytes != NULL && required_insert_count > 0) {
+        /* Acknowledge the section, which also tells the encoder that the entries were received */
+        if (h3zero_qpack_buffer_append_int(&decoder->decoder_stream, 0x80, 0x7F, stream_id) != 0) {
+            bytes = NULL;
+        }
+        else if (required_insert_count > decoder->acknowledged_insert_count) {
+            decoder->acknowledged_insert_count = required_insert_count;
+        }
+    }
+
     return bytes;
 }
 
+uint8_t * h3zero_parse_qpack_header_frame(uint8_t * bytes, uint8_t * bytes_max,
+    h3zero_header_parts_t * parts)
+{
+    return h3zero_parse_qpack_header_frame_ex(bytes, bytes_max, parts, NULL, 0, NULL);
+}
+
 /*
  * Header frame.
  * The HEADERS frame (type=0x1) is used to carry a header block,
@@ -752,132 +1311,881 @@ uint8_t * h3zero_create_post_header_frame_ex(uint8_t * bytes, uint8_t * bytes_ma
     return bytes;
 }
 
-uint8_t* h3zero_create_post_header_frame(uint8_t* bytes, uint8_t* bytes_max,
-    uint8_t const* path, size_t path_length, char const* host, h3zero_content_type_enum content_type)
+uint8_t* h3zero_create_post_header_frame(uint8_t* bytes, uint8_t* bytes_max,
+    uint8_t const* path, size_t path_length, char const* host, h3zero_content_type_enum content_type)
+{
+    return h3zero_create_post_header_frame_ex(bytes, bytes_max, path, path_length, host,
+        content_type, H3ZERO_USER_AGENT_STRING);
+}
+
+uint8_t * h3zero_create_request_header_frame_ex(uint8_t * bytes, uint8_t * bytes_max,
+    uint8_t const * path, size_t path_length, char const * host, char const* ua_string)
+{
+    if (bytes == NULL || bytes + 2 > bytes_max) {
+        return NULL;
+    }
+    /* Push 2 NULL bytes for request header: base, and delta */
+    *bytes++ = 0;
+    *bytes++ = 0;
+    /* Method: GET */
+    bytes = h3zero_qpack_code_encode(bytes, bytes_max, 0xC0, 0x3F, H3ZERO_QPACK_CODE_GET);
+    /* Scheme: HTTPS */
+    bytes = h3zero_qpack_code_encode(bytes, bytes_max, 0xC0, 0x3F, H3ZERO_QPACK_SCHEME_HTTPS);
+    /* Path: doc_name. Use literal plus reference format */
+    bytes = h3zero_qpack_literal_plus_ref_encode(bytes, bytes_max, H3ZERO_QPACK_CODE_PATH, path, path_length);
+    /*Authority: host. Use literal plus reference format */
+    if (host != NULL) {
+        bytes = h3zero_qpack_literal_plus_ref_encode(bytes, bytes_max, H3ZERO_QPACK_AUTHORITY, (uint8_t const *)host, strlen(host));
+    }
+    /* User Agent */
+    if (ua_string != NULL) {
+        bytes = h3zero_qpack_literal_plus_ref_encode(bytes, bytes_max, H3ZERO_QPACK_USER_AGENT, (uint8_t const*)ua_string, strlen(ua_string));
+    }
+    return bytes;
+}
+
+uint8_t* h3zero_create_request_header_frame(uint8_t* bytes, uint8_t* bytes_max,
+    uint8_t const* path, size_t path_length, char const* host)
+{
+    return h3zero_create_request_header_frame_ex(bytes, bytes_max, path, path_length,
+        host, H3ZERO_USER_AGENT_STRING);
+}
+
+uint8_t * h3zero_create_response_header_frame_ex(uint8_t * bytes, uint8_t * bytes_max,
+    h3zero_content_type_enum doc_type, char const* server_string)
+{
+
+    if (bytes == NULL || bytes + 2 > bytes_max) {
+        return NULL;
+    }
+    /* Push 2 NULL bytes for request header: base, and delta */
+    *bytes++ = 0;
+    *bytes++ = 0;
+
+    /* Status = 200 */
+    bytes = h3zero_qpack_code_encode(bytes, bytes_max, 0xC0, 0x3F, H3ZERO_QPACK_CODE_200);
+
+    /* Server string */
+    if (server_string != NULL) {
+        bytes = h3zero_qpack_literal_plus_ref_encode(bytes, bytes_max, H3ZERO_QPACK_SERVER, (uint8_t const*)server_string, strlen(server_string));
+    }
+
+    /* Content type header */
+    bytes = h3zero_encode_content_type(bytes, bytes_max, doc_type);
+
+    return bytes;
+}
+
+uint8_t* h3zero_create_response_header_frame(uint8_t* bytes, uint8_t* bytes_max,
+    h3zero_content_type_enum doc_type)
+{
+    return h3zero_create_response_header_frame_ex(bytes, bytes_max, doc_type, H3ZERO_USER_AGENT_STRING);
+}
+
+uint8_t * h3zero_create_not_found_header_frame_ex(uint8_t * bytes, uint8_t * bytes_max, char const* server_string)
+{
+    if (bytes == NULL || bytes + 2 > bytes_max) {
+        return NULL;
+    }
+    /* Push 2 NULL bytes for request header: base, and delta */
+    *bytes++ = 0;
+    *bytes++ = 0;
+    /* Status = 404 */
+    bytes = h3zero_qpack_code_encode(bytes, bytes_max, 0xC0, 0x3F, H3ZERO_QPACK_CODE_404);
+
+    /* Server string */
+    if (server_string != NULL) {
+        bytes = h3zero_qpack_literal_plus_ref_encode(bytes, bytes_max, H3ZERO_QPACK_SERVER, (uint8_t const*)server_string, strlen(server_string));
+    }
+
+    return bytes;
+}
+
+uint8_t* h3zero_create_not_found_header_frame(uint8_t* bytes, uint8_t* bytes_max)
+{
+    return h3zero_create_not_found_header_frame_ex(bytes, bytes_max, H3ZERO_USER_AGENT_STRING);
+}
+
+uint8_t * h3zero_create_bad_method_header_frame_ex(uint8_t * bytes, uint8_t * bytes_max, char const* server_string)
+{
+    if (bytes == NULL || bytes + 2 > bytes_max) {
+        return NULL;
+    }
+    /* Push 2 NULL bytes for request header: base, and delta */
+    *bytes++ = 0;
+    *bytes++ = 0;
+    /* Status = 405 -- use 404 code to get reference to 'status' header */
+    bytes = h3zero_qpack_code_encode(bytes, bytes_max, 0x50, 0x0F, H3ZERO_QPACK_CODE_404);
+    if (bytes != NULL) {
+        *bytes++ = 3;
+        *bytes++ = '4';
+        *bytes++ = '0';
+        *bytes++ = '5';
+    }
+
+    /* Server string */
+    if (server_string != NULL) {
+        bytes = h3zero_qpack_literal_plus_ref_encode(bytes, bytes_max, H3ZERO_QPACK_SERVER, (uint8_t const*)server_string, strlen(server_string));
+    }
+
+    /* Allow GET and POST */
+    bytes = h3zero_qpack_literal_plus_ref_encode(bytes, bytes_max, H3ZERO_QPACK_ALLOW_GET, (uint8_t *)"GET, POST", 9);
+
+    return bytes;
+}
+
+uint8_t* h3zero_create_bad_method_header_frame(uint8_t* bytes, uint8_t* bytes_max)
+{
+    return h3zero_create_bad_method_header_frame_ex(bytes, bytes_max, H3ZERO_USER_AGENT_STRING);
+}
+
+/*
+ * QPACK encoder and decoder streams.
+ *
+ * The encoder inserts entries in its copy of the dynamic table, and sends
+ * the corresponding instructions on the encoder stream:
+ *
+ *   0   1   2   3   4   5   6   7
+ * +---+---+---+---+---+---+---+---+
+ * | 0 | 0 | 1 |   Capacity (5+)   |  Set Dynamic Table Capacity
+ * +---+---+---+-------------------+
+ * | 1 | T |    Name Index (6+)    |  Insert with Name Reference,
+ * +---+---+-----------------------+  followed by H and value length (7+)
+ * | 0 | 1 | H | Name Length (5+)  |  Insert with Literal Name,
+ * +---+---+---+-------------------+  followed by H and value length (7+)
+ * | 0 | 0 | 0 |    Index (5+)     |  Duplicate
+ * +---+---+---+-------------------+
+ *
+ * The decoder acknowledges sections and inserts on the decoder stream:
+ *
+ * +---+---------------------------+
+ * | 1 |      Stream ID (7+)       |  Section Acknowledgment
+ * +---+---+-----------------------+
+ * | 0 | 1 |     Stream ID (6+)    |  Stream Cancellation
+ * +---+---+-----------------------+
+ * | 0 | 0 |     Increment (6+)    |  Insert Count Increment
+ * +---+---+-----------------------+
+ *
+ * The encoder only evicts entries that the decoder has received and that
+ * are not referenced by unacknowledged sections. It references entries
+ * that the decoder has not acknowledged yet only if the peer allows
+ * enough blocked streams, otherwise it inserts the field for later use
+ * and sends it as a literal.
+ */
+
+#define H3ZERO_QPACK_INCOMPLETE 1
+
+/* Get an integer from an instruction that may not be fully received yet */
+static int h3zero_qpack_int_get(uint8_t** bytes, uint8_t* bytes_max, uint8_t mask, uint64_t* val)
+{
+    int ret = 0;
+    uint8_t* next = h3zero_qpack_int_decode(*bytes, bytes_max, mask, val);
+
+    if (next != NULL) {
+        *bytes = next;
+    }
+    else if (*bytes >= bytes_max) {
+        ret = H3ZERO_QPACK_INCOMPLETE;
+    }
+    else {
+        /* Truncated if all the continuation bytes received so far have the high bit set */
+        uint8_t* p = *bytes + 1;
+
+        while (p < bytes_max && (*p & 0x80) != 0) {
+            p++;
+        }
+        ret = (p >= bytes_max && bytes_max - *bytes < 10) ? H3ZERO_QPACK_INCOMPLETE : -1;
+    }
+    return ret;
+}
+
+static int h3zero_qpack_string_get(uint8_t** bytes, uint8_t* bytes_max, uint8_t h_bit, uint8_t mask,
+    uint64_t max_length, uint8_t** string, size_t* length, uint8_t** allocated)
+{
+    int ret = H3ZERO_QPACK_INCOMPLETE;
+
+    if (*bytes < bytes_max) {
+        uint64_t s_length;
+        int is_huffman = (**bytes & h_bit) != 0;
+
+        ret = h3zero_qpack_int_get(bytes, bytes_max, mask, &s_length);
+        if (ret == 0) {
+            if (s_length > max_length) {
+                ret = -1;
+            }
+            else if (*bytes + s_length > bytes_max) {
+                ret = H3ZERO_QPACK_INCOMPLETE;
+            }
+            else if (is_huffman) {
+                /* The shortest Huffman codes have 5 bits */
+                size_t max_decoded = (size_t)(s_length * 8 / 5) + 1;
+
+                if ((*allocated = (uint8_t*)malloc(max_decoded)) == NULL ||
+                    hzero_qpack_huffman_decode(*bytes, *bytes + s_length, *allocated, max_decoded, length) != 0) {
+                    ret = -1;
+                }
+                else {
+                    *string = *allocated;
+                    *bytes += s_length;
+                }
+            }
+            else {
+                *string = *bytes;
+                *length = (size_t)s_length;
+                *bytes += s_length;
+            }
+        }
+    }
+    return ret;
+}
+
+int h3zero_qpack_decoder_init(h3zero_qpack_decoder_t* decoder, uint64_t max_capacity, uint64_t max_blocked_streams)
+{
+    memset(decoder, 0, sizeof(h3zero_qpack_decoder_t));
+    decoder->max_blocked_streams = max_blocked_streams;
+
+    return h3zero_qpack_table_init(&decoder->table, max_capacity);
+}
+
+void h3zero_qpack_decoder_release(h3zero_qpack_decoder_t* decoder)
+{
+    h3zero_qpack_table_release(&decoder->table);
+    h3zero_qpack_buffer_release(&decoder->decoder_stream);
+    h3zero_qpack_buffer_release(&decoder->encoder_input);
+}
+
+/* Process one encoder instruction. Returns 0, H3ZERO_QPACK_INCOMPLETE, or -1 */
+static int h3zero_qpack_decode_instruction(h3zero_qpack_decoder_t* decoder, uint8_t** bytes, uint8_t* bytes_max)
+{
+    int ret = 0;
+    uint8_t* name = NULL;
+    size_t name_length = 0;
+    uint8_t* value = NULL;
+    size_t value_length = 0;
+    uint8_t* name_allocated = NULL;
+    uint8_t* value_allocated = NULL;
+    uint64_t index;
+    h3zero_qpack_entry_t* entry;
+    uint64_t max_length = decoder->table.capacity;
+
+    if ((**bytes & 0x80) != 0) {
+        /* Insert with name reference */
+        int is_static = (**bytes & 0x40) != 0;
+
+        if ((ret = h3zero_qpack_int_get(bytes, bytes_max, 0x3F, &index)) == 0) {
+            if (is_static) {
+                if (index >= h3zero_qpack_nb_static) {
+                    ret = -1;
+                }
+                else {
+                    name = (uint8_t*)h3zero_header_name[qpack_static[index].header];
+                    name_length = strlen(h3zero_header_name[qpack_static[index].header]);
+                }
+            }
+            else if (index >= decoder->table.insert_count ||
+                (entry = h3zero_qpack_table_get(&decoder->table, decoder->table.insert_count - 1 - index)) == NULL) {
+                ret = -1;
+            }
+            else {
+                name = entry->name;
+                name_length = entry->name_length;
+            }
+        }
+        if (ret == 0) {
+            ret = h3zero_qpack_string_get(bytes, bytes_max, 0x80, 0x7F, max_length, &value, &value_length, &value_allocated);
+        }
+        if (ret == 0) {
+            ret = h3zero_qpack_table_insert(&decoder->table, name, name_length, value, value_length, UINT64_MAX);
+        }
+    }
+    else if ((**bytes & 0x40) != 0) {
+        /* Insert with literal name */
+        ret = h3zero_qpack_string_get(bytes, bytes_max, 0x20, 0x1F, max_length, &name, &name_length, &name_allocated);
+        if (ret == 0) {
+            ret = h3zero_qpack_string_get(bytes, bytes_max, 0x80, 0x7F, max_length, &value, &value_length, &value_allocated);
+        }
+        if (ret == 0) {
+            ret = h3zero_qpack_table_insert(&decoder->table, name, name_length, value, value_length, UINT64_MAX);
+        }
+    }
+    else if ((**bytes & 0x20) != 0) {
+        /* Set dynamic table capacity */
+        if ((ret = h3zero_qpack_int_get(bytes, bytes_max, 0x1F, &index)) == 0) {
+            ret = h3zero_qpack_table_set_capacity(&decoder->table, index, UINT64_MAX);
+        }
+    }
+    else {
+        /* Duplicate */
+        if ((ret = h3zero_qpack_int_get(bytes, bytes_max, 0x1F, &index)) == 0) {
+            if (index >= decoder->table.insert_count ||
+                (entry = h3zero_qpack_table_get(&decoder->table, decoder->table.insert_count - 1 - index)) == NULL) {
+                ret = -1;
+            }
+            else {
+                ret = h3zero_qpack_table_insert(&decoder->table, entry->name, entry->name_length,
+                    entry->value, entry->value_length, UINT64_MAX);
+            }
+        }
+    }
+
+    if (name_allocated != NULL) {
+        free(name_allocated);
+    }
+    if (value_allocated != NULL) {
+        free(value_allocated);
+    }
+
+    return ret;
+}
+
+int h3zero_qpack_receive_encoder_stream(h3zero_qpack_decoder_t* decoder, uint8_t const* bytes, size_t length)
+{
+    int ret = h3zero_qpack_buffer_append(&decoder->encoder_input, bytes, length);
+    size_t consumed = 0;
+
+    while (ret == 0 && consumed < decoder->encoder_input.length) {
+        uint8_t* p = decoder->encoder_input.bytes + consumed;
+
+        ret = h3zero_qpack_decode_instruction(decoder, &p,
+            decoder->encoder_input.bytes + decoder->encoder_input.length);
+        if (ret == H3ZERO_QPACK_INCOMPLETE) {
+            /* Wait for the rest of the instruction */
+            ret = 0;
+            break;
+        }
+        else if (ret == 0) {
+            consumed = p - decoder->encoder_input.bytes;
+        }
+    }
+
+    if (ret == 0) {
+        if (consumed > 0) {
+            decoder->encoder_input.length -= consumed;
+            memmove(decoder->encoder_input.bytes, decoder->encoder_input.bytes + consumed, decoder->encoder_input.length);
+        }
+        if (decoder->table.insert_count > decoder->acknowledged_insert_count) {
+            ret = h3zero_qpack_buffer_append_int(&decoder->decoder_stream, 0x00, 0x3F,
+                decoder->table.insert_count - decoder->acknowledged_insert_count);
+            decoder->acknowledged_insert_count = decoder->table.insert_count;
+        }
+    }
+
+    return (ret == 0) ? 0 : H3ZERO_QPACK_ENCODER_STREAM_ERROR;
+}
+
+/* Encoder side. The static table is hashed when the encoder is created */
+static int h3zero_qpack_static_field_is(size_t s_index, uint8_t const* name, size_t name_length,
+    uint8_t const* value, size_t value_length)
+{
+    char const* s_name = h3zero_header_name[qpack_static[s_index].header];
+    char const* s_value = (qpack_static[s_index].content == NULL) ? "" : qpack_static[s_index].content;
+
+    return strlen(s_name) == name_length && memcmp(s_name, name, name_length) == 0 &&
+        (value == NULL || (strlen(s_value) == value_length && memcmp(s_value, value, value_length) == 0));
+}
+
+int h3zero_qpack_encoder_init(h3zero_qpack_encoder_t* encoder, uint64_t local_max_capacity)
+{
+    memset(encoder, 0, sizeof(h3zero_qpack_encoder_t));
+    encoder->local_max_capacity = local_max_capacity;
+
+    for (size_t i = 0; i < h3zero_qpack_nb_static; i++) {
+        char const* name = h3zero_header_name[qpack_static[i].header];
+        char const* value = (qpack_static[i].content == NULL) ? "" : qpack_static[i].content;
+        uint32_t name_hash = h3zero_qpack_hash((uint8_t const*)name, strlen(name), 2166136261u);
+        size_t slot = h3zero_qpack_field_hash(name_hash, (uint8_t const*)value, strlen(value)) % H3ZERO_QPACK_STATIC_HASH_SIZE;
+
+        while (encoder->static_by_field[slot] != 0) {
+            slot = (slot + 1) % H3ZERO_QPACK_STATIC_HASH_SIZE;
+        }
+        encoder->static_by_field[slot] = (uint8_t)(i + 1);
+
+        /* Only the first entry with a given name is kept */
+        slot = name_hash % H3ZERO_QPACK_STATIC_HASH_SIZE;
+        while (encoder->static_by_name[slot] != 0 &&
+            !h3zero_qpack_static_field_is(encoder->static_by_name[slot] - 1, (uint8_t const*)name, strlen(name), NULL, 0)) {
+            slot = (slot + 1) % H3ZERO_QPACK_STATIC_HASH_SIZE;
+        }
+        if (encoder->static_by_name[slot] == 0) {
+            encoder->static_by_name[slot] = (uint8_t)(i + 1);
+        }
+    }
+
+    return 0;
+}
+
+int h3zero_qpack_encoder_set_peer_settings(h3zero_qpack_encoder_t* encoder, const h3zero_settings_t* peer_settings)
+{
+    int ret = 0;
+    uint64_t capacity = (peer_settings->header_size < encoder->local_max_capacity) ?
+        peer_settings->header_size : encoder->local_max_capacity;
+
+    if (encoder->table.entries != NULL) {
+        /* Settings are only received once */
+        ret = -1;
+    }
+    else {
+        encoder->peer_max_capacity = peer_settings->header_size;
+        encoder->peer_blocked_streams = peer_settings->blocked_streams;
+        if (capacity > 0) {
+            ret = h3zero_qpack_table_init(&encoder->table, capacity);
+            if (ret == 0) {
+                ret = h3zero_qpack_table_set_capacity(&encoder->table, capacity, 0);
+            }
+            if (ret == 0) {
+                ret = h3zero_qpack_buffer_append_int(&encoder->encoder_stream, 0x20, 0x1F, capacity);
+            }
+        }
+    }
+    return ret;
+}
+
+void h3zero_qpack_encoder_release(h3zero_qpack_encoder_t* encoder)
+{
+    while (encoder->first_section != NULL) {
+        h3zero_qpack_section_t* section = encoder->first_section;
+        encoder->first_section = section->next;
+        free(section);
+    }
+    encoder->last_section = NULL;
+    h3zero_qpack_table_release(&encoder->table);
+    h3zero_qpack_buffer_release(&encoder->encoder_stream);
+}
+
+/* Remove the first section of the stream, or all of them */
+static int h3zero_qpack_encoder_remove_sections(h3zero_qpack_encoder_t* encoder, uint64_t stream_id, int remove_all)
+{
+    int nb_removed = 0;
+    h3zero_qpack_section_t* previous = NULL;
+    h3zero_qpack_section_t* section = encoder->first_section;
+
+    while (section != NULL) {
+        h3zero_qpack_section_t* next = section->next;
+
+        if (section->stream_id == stream_id) {
+            if (previous == NULL) {
+                encoder->first_section = next;
+            }
+            else {
+                previous->next = next;
+            }
+            if (encoder->last_section == section) {
+                encoder->last_section = previous;
+            }
+            if (!remove_all && section->required_insert_count > encoder->known_received_count) {
+                encoder->known_received_count = section->required_insert_count;
+            }
+            free(section);
+            nb_removed++;
+            if (!remove_all) {
+                break;
+            }
+        }
+        else {
+            previous = section;
+        }
+        section = next;
+    }
+    return nb_removed;
+}
+
+int h3zero_qpack_receive_decoder_stream(h3zero_qpack_encoder_t* encoder, uint8_t const* bytes, size_t length)
+{
+    int ret = 0;
+
+    for (size_t i = 0; ret == 0 && i < length; i++) {
+        uint8_t* p = encoder->decoder_input;
+        uint64_t val;
+        int is_ack;
+
+        if (encoder->decoder_input_length >= sizeof(encoder->decoder_input)) {
+            ret = -1;
+            break;
+        }
+        encoder->decoder_input[encoder->decoder_input_length++] = bytes[i];
+        is_ack = (encoder->decoder_input[0] & 0x80) != 0;
+        ret = h3zero_qpack_int_get(&p, encoder->decoder_input + encoder->decoder_input_length,
+            (is_ack) ? 0x7F : 0x3F, &val);
+        if (ret == H3ZERO_QPACK_INCOMPLETE) {
+            ret = 0;
+        }
+        else if (ret == 0) {
+            if (is_ack) {
+                /* Section acknowledgment */
+                if (h3zero_qpack_encoder_remove_sections(encoder, val, 0) == 0) {
+                    ret = -1;
+                }
+            }
+            else if ((encoder->decoder_input[0] & 0x40) != 0) {
+                /* Stream cancellation */
+                (void)h3zero_qpack_encoder_remove_sections(encoder, val, 1);
+            }
+            else if (val == 0 || encoder->known_received_count + val > encoder->table.insert_count) {
+                /* Invalid insert count increment */
+                ret = -1;
+            }
+            else {
+                encoder->known_received_count += val;
+            }
+            encoder->decoder_input_length = 0;
+        }
+    }
+
+    return (ret == 0) ? 0 : H3ZERO_QPACK_DECODER_STREAM_ERROR;
+}
+
+/* Find a field or a name in the static table. Returns the index or -1 */
+static int h3zero_qpack_static_find(h3zero_qpack_encoder_t* encoder, h3zero_qpack_field_t const* field, int name_only)
+{
+    int s_index = -1;
+
+    if (encoder == NULL) {
+        for (size_t i = 0; i < h3zero_qpack_nb_static; i++) {
+            if (h3zero_qpack_static_field_is(i, field->name, field->name_length,
+                (name_only) ? NULL : field->value, field->value_length)) {
+                s_index = (int)i;
+                break;
+            }
+        }
+    }
+    else {
+        uint8_t const* table = (name_only) ? encoder->static_by_name : encoder->static_by_field;
+        uint32_t hash = h3zero_qpack_hash(field->name, field->name_length, 2166136261u);
+        size_t slot = ((name_only) ? hash : h3zero_qpack_field_hash(hash, field->value, field->value_length)) %
+            H3ZERO_QPACK_STATIC_HASH_SIZE;
+
+        while (table[slot] != 0) {
+            if (h3zero_qpack_static_field_is(table[slot] - 1, field->name, field->name_length,
+                (name_only) ? NULL : field->value, field->value_length)) {
+                s_index = table[slot] - 1;
+                break;
+            }
+            slot = (slot + 1) % H3ZERO_QPACK_STATIC_HASH_SIZE;
+        }
+    }
+    return s_index;
+}
+
+typedef enum {
+    h3zero_qpack_line_static = 0,
+    h3zero_qpack_line_dynamic,
+    h3zero_qpack_line_literal_static_name,
+    h3zero_qpack_line_literal_dynamic_name,
+    h3zero_qpack_line_literal
+} h3zero_qpack_line_enum;
+
+typedef struct st_h3zero_qpack_line_t {
+    h3zero_qpack_line_enum line_type;
+    uint64_t index;
+} h3zero_qpack_line_t;
+
+/* A section may refer to entries not yet acknowledged if its stream is
+ * already blocking, or if the peer accepts one more blocked stream. */
+static int h3zero_qpack_encoder_may_block(h3zero_qpack_encoder_t* encoder, uint64_t stream_id)
+{
+    uint64_t nb_blocking = 0;
+    int may_block = 0;
+
+    for (h3zero_qpack_section_t* section = encoder->first_section; section != NULL; section = section->next) {
+        if (section->required_insert_count > encoder->known_received_count) {
+            if (section->stream_id == stream_id) {
+                may_block = 1;
+                break;
+            }
+            nb_blocking++;
+        }
+    }
+    return may_block || nb_blocking < encoder->peer_blocked_streams;
+}
+
+static uint64_t h3zero_qpack_encoder_evict_limit(h3zero_qpack_encoder_t* encoder, uint64_t min_index)
+{
+    uint64_t evict_limit = (min_index < encoder->known_received_count) ? min_index : encoder->known_received_count;
+
+    for (h3zero_qpack_section_t* section = encoder->first_section; section != NULL; section = section->next) {
+        if (section->min_index < evict_limit) {
+            evict_limit = section->min_index;
+        }
+    }
+    return evict_limit;
+}
+
+/* Insert the field in the dynamic table and send the instruction on the
+ * encoder stream. The :path is not inserted, because it changes with
+ * each request, and neither are fields that would take more than half
+ * of the table. */
+static int h3zero_qpack_encoder_insert(h3zero_qpack_encoder_t* encoder, h3zero_qpack_field_t const* field,
+    int s_name_index, uint64_t min_index)
+{
+    int ret = 0;
+    h3zero_qpack_entry_t* name_entry = NULL;
+    uint64_t name_relative_index = 0;
+
+    if ((uint64_t)field->name_length + field->value_length + H3ZERO_QPACK_ENTRY_OVERHEAD > encoder->table.capacity / 2 ||
+        (field->name_length == 5 && memcmp(field->name, ":path", 5) == 0)) {
+        ret = -1;
+    }
+    else {
+        if (s_name_index < 0 && (name_entry = h3zero_qpack_table_find_name(&encoder->table,
+            field->name, field->name_length, encoder->table.insert_count)) != NULL) {
+            name_relative_index = encoder->table.insert_count - 1 - name_entry->absolute_index;
+        }
+        ret = h3zero_qpack_table_insert(&encoder->table, field->name, field->name_length,
+            field->value, field->value_length, h3zero_qpack_encoder_evict_limit(encoder, min_index));
+    }
+
+    if (ret == 0) {
+        if (s_name_index >= 0) {
+            ret = h3zero_qpack_buffer_append_int(&encoder->encoder_stream, 0xC0, 0x3F, (uint64_t)s_name_index);
+        }
+        else if (name_entry != NULL) {
+            ret = h3zero_qpack_buffer_append_int(&encoder->encoder_stream, 0x80, 0x3F, name_relative_index);
+        }
+        else {
+            ret = h3zero_qpack_buffer_append_string(&encoder->encoder_stream, 0x40, 0x1F, field->name, field->name_length);
+        }
+        if (ret == 0) {
+            ret = h3zero_qpack_buffer_append_string(&encoder->encoder_stream, 0x00, 0x7F, field->value, field->value_length);
+        }
+        if (ret != 0) {
+            /* The decoder would not be in sync anymore */
+            ret = -2;
+        }
+    }
+    return ret;
+}
+
+static int h3zero_qpack_encode_choose(h3zero_qpack_encoder_t* encoder, h3zero_qpack_field_t const* field,
+    int may_block, uint64_t* min_index, h3zero_qpack_line_t* line)
 {
-    return h3zero_create_post_header_frame_ex(bytes, bytes_max, path, path_length, host,
-        content_type, H3ZERO_USER_AGENT_STRING);
-}
+    int ret = 0;
+    int s_index = h3zero_qpack_static_find(encoder, field, 0);
 
-uint8_t * h3zero_create_request_header_frame_ex(uint8_t * bytes, uint8_t * bytes_max,
-    uint8_t const * path, size_t path_length, char const * host, char const* ua_string)
-{
-    if (bytes == NULL || bytes + 2 > bytes_max) {
-        return NULL;
-    }
-    /* Push 2 NULL bytes for request header: base, and delta */
-    *bytes++ = 0;
-    *bytes++ = 0;
-    /* Method: GET */
-    bytes = h3zero_qpack_code_encode(bytes, bytes_max, 0xC0, 0x3F, H3ZERO_QPACK_CODE_GET);
-    /* Scheme: HTTPS */
-    bytes = h3zero_qpack_code_encode(bytes, bytes_max, 0xC0, 0x3F, H3ZERO_QPACK_SCHEME_HTTPS);
-    /* Path: doc_name. Use literal plus reference format */
-    bytes = h3zero_qpack_literal_plus_ref_encode(bytes, bytes_max, H3ZERO_QPACK_CODE_PATH, path, path_length);
-    /*Authority: host. Use literal plus reference format */
-    if (host != NULL) {
-        bytes = h3zero_qpack_literal_plus_ref_encode(bytes, bytes_max, H3ZERO_QPACK_AUTHORITY, (uint8_t const *)host, strlen(host));
+    if (s_index >= 0) {
+        line->line_type = h3zero_qpack_line_static;
+        line->index = (uint64_t)s_index;
     }
-    /* User Agent */
-    if (ua_string != NULL) {
-        bytes = h3zero_qpack_literal_plus_ref_encode(bytes, bytes_max, H3ZERO_QPACK_USER_AGENT, (uint8_t const*)ua_string, strlen(ua_string));
+    else {
+        int s_name_index = h3zero_qpack_static_find(encoder, field, 1);
+        h3zero_qpack_entry_t* entry = NULL;
+        int is_chosen = 0;
+
+        if (encoder != NULL && encoder->table.capacity > 0) {
+            uint64_t ref_limit = (may_block) ? encoder->table.insert_count : encoder->known_received_count;
+
+            if ((entry = h3zero_qpack_table_find_field(&encoder->table, field->name, field->name_length,
+                field->value, field->value_length, ref_limit)) != NULL) {
+                line->line_type = h3zero_qpack_line_dynamic;
+                line->index = entry->absolute_index;
+                is_chosen = 1;
+            }
+            else if (h3zero_qpack_table_find_field(&encoder->table, field->name, field->name_length,
+                field->value, field->value_length, encoder->table.insert_count) == NULL) {
+                /* Not inserted yet */
+                int insert_ret = h3zero_qpack_encoder_insert(encoder, field, s_name_index, *min_index);
+
+                if (insert_ret == -2) {
+                    ret = -1;
+                }
+                else if (insert_ret == 0 && may_block) {
+                    line->line_type = h3zero_qpack_line_dynamic;
+                    line->index = encoder->table.insert_count - 1;
+                    is_chosen = 1;
+                }
+            }
+            if (!is_chosen && s_name_index < 0 && (entry = h3zero_qpack_table_find_name(&encoder->table,
+                field->name, field->name_length, ref_limit)) != NULL) {
+                line->line_type = h3zero_qpack_line_literal_dynamic_name;
+                line->index = entry->absolute_index;
+                is_chosen = 1;
+            }
+        }
+        if (!is_chosen) {
+            if (s_name_index >= 0) {
+                line->line_type = h3zero_qpack_line_literal_static_name;
+                line->index = (uint64_t)s_name_index;
+            }
+            else {
+                line->line_type = h3zero_qpack_line_literal;
+            }
+        }
+        else if (line->index < *min_index) {
+            *min_index = line->index;
+        }
     }
-    return bytes;
+    return ret;
 }
 
-uint8_t* h3zero_create_request_header_frame(uint8_t* bytes, uint8_t* bytes_max,
-    uint8_t const* path, size_t path_length, char const* host)
+/* Encode a string, Huffman encoded if that is shorter. The H bit is just
+ * above the mask of the length prefix. */
+static uint8_t* h3zero_qpack_string_encode(uint8_t* bytes, uint8_t* bytes_max, uint8_t prefix, uint8_t mask,
+    uint8_t const* val, size_t val_length)
 {
-    return h3zero_create_request_header_frame_ex(bytes, bytes_max, path, path_length,
-        host, H3ZERO_USER_AGENT_STRING);
+    size_t huffman_length = h3zero_qpack_huffman_length(val, val_length);
+
+    if (huffman_length < val_length) {
+        bytes = h3zero_qpack_code_encode(bytes, bytes_max, prefix | (mask + 1), mask, huffman_length);
+        if (bytes != NULL) {
+            bytes = h3zero_qpack_huffman_encode(bytes, bytes_max, val, val_length);
+        }
+    }
+    else {
+        bytes = h3zero_qpack_code_encode(bytes, bytes_max, prefix, mask, val_length);
+        if (bytes != NULL && val_length > 0) {
+            if (bytes + val_length > bytes_max) {
+                bytes = NULL;
+            }
+            else {
+                memcpy(bytes, val, val_length);
+                bytes += val_length;
+            }
+        }
+    }
+    return bytes;
 }
 
-uint8_t * h3zero_create_response_header_frame_ex(uint8_t * bytes, uint8_t * bytes_max,
-    h3zero_content_type_enum doc_type, char const* server_string)
+uint8_t* h3zero_qpack_encode_fields(h3zero_qpack_encoder_t* encoder, uint64_t stream_id,
+    uint8_t* bytes, uint8_t* bytes_max, h3zero_qpack_field_t const* fields, size_t nb_fields)
 {
+    h3zero_qpack_line_t lines[H3ZERO_QPACK_MAX_FIELDS];
+    uint64_t required_insert_count = 0;
+    uint64_t min_index = UINT64_MAX;
+    int may_block = 0;
 
-    if (bytes == NULL || bytes + 2 > bytes_max) {
+    if (bytes == NULL || nb_fields > H3ZERO_QPACK_MAX_FIELDS) {
         return NULL;
     }
-    /* Push 2 NULL bytes for request header: base, and delta */
-    *bytes++ = 0;
-    *bytes++ = 0;
 
-    /* Status = 200 */
-    bytes = h3zero_qpack_code_encode(bytes, bytes_max, 0xC0, 0x3F, H3ZERO_QPACK_CODE_200);
+    if (encoder != NULL && encoder->table.capacity > 0) {
+        may_block = h3zero_qpack_encoder_may_block(encoder, stream_id);
+    }
 
-    /* Server string */
-    if (server_string != NULL) {
-        bytes = h3zero_qpack_literal_plus_ref_encode(bytes, bytes_max, H3ZERO_QPACK_SERVER, (uint8_t const*)server_string, strlen(server_string));
+    /* Choose the representation of each line first, because the prefix
+     * depends on the dynamic entries that are referenced. */
+    for (size_t i = 0; i < nb_fields; i++) {
+        if (h3zero_qpack_encode_choose(encoder, &fields[i], may_block, &min_index, &lines[i]) != 0) {
+            return NULL;
+        }
+        if ((lines[i].line_type == h3zero_qpack_line_dynamic ||
+            lines[i].line_type == h3zero_qpack_line_literal_dynamic_name) &&
+            lines[i].index >= required_insert_count) {
+            required_insert_count = lines[i].index + 1;
+        }
     }
 
-    /* Content type header */
-    bytes = h3zero_encode_content_type(bytes, bytes_max, doc_type);
+    /* Prefix: the base is equal to the required insert count, so the delta is zero */
+    bytes = h3zero_qpack_code_encode(bytes, bytes_max, 0x00, 0xFF, (encoder == NULL) ? 0 :
+        h3zero_qpack_encode_required_insert_count(required_insert_count, encoder->peer_max_capacity));
+    bytes = h3zero_qpack_code_encode(bytes, bytes_max, 0x00, 0x7F, 0);
+
+    for (size_t i = 0; bytes != NULL && i < nb_fields; i++) {
+        switch (lines[i].line_type) {
+        case h3zero_qpack_line_static:
+            bytes = h3zero_qpack_code_encode(bytes, bytes_max, 0xC0, 0x3F, lines[i].index);
+            break;
+        case h3zero_qpack_line_dynamic:
+            bytes = h3zero_qpack_code_encode(bytes, bytes_max, 0x80, 0x3F, required_insert_count - 1 - lines[i].index);
+            break;
+        case h3zero_qpack_line_literal_static_name:
+            bytes = h3zero_qpack_code_encode(bytes, bytes_max, 0x50, 0x0F, lines[i].index);
+            bytes = h3zero_qpack_string_encode(bytes, bytes_max, 0x00, 0x7F, fields[i].value, fields[i].value_length);
+            break;
+        case h3zero_qpack_line_literal_dynamic_name:
+            bytes = h3zero_qpack_code_encode(bytes, bytes_max, 0x40, 0x0F, required_insert_count - 1 - lines[i].index);
+            bytes = h3zero_qpack_string_encode(bytes, bytes_max, 0x00, 0x7F, fields[i].value, fields[i].value_length);
+            break;
+        default:
+            bytes = h3zero_qpack_string_encode(bytes, bytes_max, 0x20, 0x07, fields[i].name, fields[i].name_length);
+            bytes = h3zero_qpack_string_encode(bytes, bytes_max, 0x00, 0x7F, fields[i].value, fields[i].value_length);
+            break;
+        }
+    }
+
+    if (bytes != NULL && required_insert_count > 0) {
+        /* Remember the section until it is acknowledged */
+        h3zero_qpack_section_t* section = (h3zero_qpack_section_t*)malloc(sizeof(h3zero_qpack_section_t));
+
+        if (section == NULL) {
+            bytes = NULL;
+        }
+        else {
+            section->next = NULL;
+            section->stream_id = stream_id;
+            section->required_insert_count = required_insert_count;
+            section->min_index = min_index;
+            if (encoder->last_section == NULL) {
+                encoder->first_section = section;
+            }
+            else {
+                encoder->last_section->next = section;
+            }
+            encoder->last_section = section;
+        }
+    }
 
     return bytes;
 }
 
-uint8_t* h3zero_create_response_header_frame(uint8_t* bytes, uint8_t* bytes_max,
-    h3zero_content_type_enum doc_type)
+static void h3zero_qpack_field_set(h3zero_qpack_field_t* field, char const* name, uint8_t const* value, size_t value_length)
 {
-    return h3zero_create_response_header_frame_ex(bytes, bytes_max, doc_type, H3ZERO_USER_AGENT_STRING);
+    field->name = (uint8_t const*)name;
+    field->name_length = strlen(name);
+    field->value = value;
+    field->value_length = value_length;
 }
 
-uint8_t * h3zero_create_not_found_header_frame_ex(uint8_t * bytes, uint8_t * bytes_max, char const* server_string)
+uint8_t* h3zero_create_request_header_frame_qpack(h3zero_qpack_encoder_t* encoder, uint64_t stream_id,
+    uint8_t* bytes, uint8_t* bytes_max, uint8_t const* path, size_t path_length, char const* host,
+    char const* ua_string, h3zero_qpack_field_t const* extra_fields, size_t nb_extra_fields)
 {
-    if (bytes == NULL || bytes + 2 > bytes_max) {
+    h3zero_qpack_field_t fields[H3ZERO_QPACK_MAX_FIELDS];
+    size_t nb_fields = 0;
+
+    if (nb_extra_fields > H3ZERO_QPACK_MAX_FIELDS - 5) {
         return NULL;
     }
-    /* Push 2 NULL bytes for request header: base, and delta */
-    *bytes++ = 0;
-    *bytes++ = 0;
-    /* Status = 404 */
-    bytes = h3zero_qpack_code_encode(bytes, bytes_max, 0xC0, 0x3F, H3ZERO_QPACK_CODE_404);
-
-    /* Server string */
-    if (server_string != NULL) {
-        bytes = h3zero_qpack_literal_plus_ref_encode(bytes, bytes_max, H3ZERO_QPACK_SERVER, (uint8_t const*)server_string, strlen(server_string));
+    h3zero_qpack_field_set(&fields[nb_fields++], ":method", (uint8_t const*)"GET", 3);
+    h3zero_qpack_field_set(&fields[nb_fields++], ":scheme", (uint8_t const*)"https", 5);
+    h3zero_qpack_field_set(&fields[nb_fields++], ":path", path, path_length);
+    if (host != NULL) {
+        h3zero_qpack_field_set(&fields[nb_fields++], ":authority", (uint8_t const*)host, strlen(host));
+    }
+    if (ua_string != NULL) {
+        h3zero_qpack_field_set(&fields[nb_fields++], "user-agent", (uint8_t const*)ua_string, strlen(ua_string));
+    }
+    for (size_t i = 0; i < nb_extra_fields; i++) {
+        fields[nb_fields++] = extra_fields[i];
     }
 
-    return bytes;
+    return h3zero_qpack_encode_fields(encoder, stream_id, bytes, bytes_max, fields, nb_fields);
 }
 
-uint8_t* h3zero_create_not_found_header_frame(uint8_t* bytes, uint8_t* bytes_max)
+uint8_t* h3zero_create_response_header_frame_qpack(h3zero_qpack_encoder_t* encoder, uint64_t stream_id,
+    uint8_t* bytes, uint8_t* bytes_max, h3zero_content_type_enum doc_type, char const* server_string)
 {
-    return h3zero_create_not_found_header_frame_ex(bytes, bytes_max, H3ZERO_USER_AGENT_STRING);
-}
+    h3zero_qpack_field_t fields[3];
+    size_t nb_fields = 0;
+    char const* content_type = NULL;
+
+    for (size_t i = 0; i < h3zero_qpack_nb_static; i++) {
+        if (qpack_static[i].header == http_header_content_type &&
+            qpack_static[i].enum_as_int == doc_type) {
+            content_type = qpack_static[i].content;
+            break;
+        }
+    }
 
-uint8_t * h3zero_create_bad_method_header_frame_ex(uint8_t * bytes, uint8_t * bytes_max, char const* server_string)
-{
-    if (bytes == NULL || bytes + 2 > bytes_max) {
+    if (content_type == NULL) {
+        /* Error, no such content */
         return NULL;
     }
-    /* Push 2 NULL bytes for request header: base, and delta */
-    *bytes++ = 0;
-    *bytes++ = 0;
-    /* Status = 405 -- use 404 code to get reference to 'status' header */
-    bytes = h3zero_qpack_code_encode(bytes, bytes_max, 0x50, 0x0F, H3ZERO_QPACK_CODE_404);
-    if (bytes != NULL) {
-        *bytes++ = 3;
-        *bytes++ = '4';
-        *bytes++ = '0';
-        *bytes++ = '5';
-    }
-
-    /* Server string */
+    h3zero_qpack_field_set(&fields[nb_fields++], ":status", (uint8_t const*)"200", 3);
     if (server_string != NULL) {
-        bytes = h3zero_qpack_literal_plus_ref_encode(bytes, bytes_max, H3ZERO_QPACK_SERVER, (uint8_t const*)server_string, strlen(server_string));
+        h3zero_qpack_field_set(&fields[nb_fields++], "server", (uint8_t const*)server_string, strlen(server_string));
     }
+    h3zero_qpack_field_set(&fields[nb_fields++], "content-type", (uint8_t const*)content_type, strlen(content_type));
 
-    /* Allow GET and POST */
-    bytes = h3zero_qpack_literal_plus_ref_encode(bytes, bytes_max, H3ZERO_QPACK_ALLOW_GET, (uint8_t *)"GET, POST", 9);
-
-    return bytes;
-}
-
-uint8_t* h3zero_create_bad_method_header_frame(uint8_t* bytes, uint8_t* bytes_max)
-{
-    return h3zero_create_bad_method_header_frame_ex(bytes, bytes_max, H3ZERO_USER_AGENT_STRING);
+    return h3zero_qpack_encode_fields(encoder, stream_id, bytes, bytes_max, fields, nb_fields);
 }
 
 /* Parsing of a data stream. This is implemented as a filter, with a set of states:
@@ -896,6 +2204,39 @@ uint8_t* h3zero_create_bad_method_header_frame(uint8_t* bytes, uint8_t* bytes_ma
  * the bytes and treat them as data.
  */
 
+/* Parse the header frame once it is fully received. Returns 0 if parsed,
+ * 1 if blocked waiting for the encoder stream, -1 on error */
+static int h3zero_data_stream_parse_header(h3zero_data_stream_state_t* stream_state, uint16_t* error_found)
+{
+    int ret = 0;
+    int is_blocked = 0;
+    uint8_t* parsed;
+    h3zero_header_parts_t* parts = (stream_state->header_found) ?
+        &stream_state->trailer : &stream_state->header;
+
+    parsed = h3zero_parse_qpack_header_frame_ex(stream_state->current_frame,
+        stream_state->current_frame + stream_state->current_frame_length, parts,
+        stream_state->qpack_decoder, stream_state->stream_id, &is_blocked);
+    if (is_blocked) {
+        ret = 1;
+    }
+    else {
+        stream_state->trailer_found = stream_state->header_found;
+        stream_state->header_found = 1;
+        if (parsed == NULL || (size_t)(parsed - stream_state->current_frame) != stream_state->current_frame_length) {
+            /* protocol error */
+            *error_found = (stream_state->qpack_decoder == NULL) ? H3ZERO_FRAME_ERROR : H3ZERO_QPACK_DECOMPRESSION_FAILED;
+            ret = -1;
+        }
+        /* free resource */
+        stream_state->frame_header_parsed = 0;
+        stream_state->frame_header_read = 0;
+        free(stream_state->current_frame);
+        stream_state->current_frame = NULL;
+    }
+    return ret;
+}
+
 uint8_t * h3zero_parse_data_stream(uint8_t * bytes, uint8_t * bytes_max,
     h3zero_data_stream_state_t * stream_state, size_t * available_data, uint16_t * error_found)
 {
@@ -907,6 +2248,25 @@ uint8_t * h3zero_parse_data_stream(uint8_t * bytes, uint8_t * bytes_max,
         return NULL;
     }
 
+    if (stream_state->is_blocked) {
+        /* Keep the bytes until the header frame can be decoded */
+        size_t length = bytes_max - bytes;
+        uint8_t* blocked_data = NULL;
+
+        if (stream_state->blocked_data_length + length > 0x10000) {
+            *error_found = H3ZERO_EXCESSIVE_LOAD;
+            return NULL;
+        }
+        else if ((blocked_data = (uint8_t*)realloc(stream_state->blocked_data, stream_state->blocked_data_length + length)) == NULL) {
+            *error_found = H3ZERO_INTERNAL_ERROR;
+            return NULL;
+        }
+        memcpy(blocked_data + stream_state->blocked_data_length, bytes, length);
+        stream_state->blocked_data = blocked_data;
+        stream_state->blocked_data_length += length;
+        return bytes_max;
+    }
+
     if (!stream_state->frame_header_parsed) {
         size_t frame_type_length;
         size_t frame_header_length;
@@ -1002,24 +2362,22 @@ uint8_t * h3zero_parse_data_stream(uint8_t * bytes, uint8_t * bytes_max,
             bytes += available;
 
             if (stream_state->current_frame_read >= stream_state->current_frame_length) {
-                uint8_t *parsed;
-                h3zero_header_parts_t * parts = (stream_state->header_found) ?
-                    &stream_state->trailer : &stream_state->header;
-                stream_state->trailer_found = stream_state->header_found;
-                stream_state->header_found = 1;
-                /* parse */
-                parsed = h3zero_parse_qpack_header_frame(stream_state->current_frame,
-                    stream_state->current_frame + stream_state->current_frame_length, parts);
-                if (parsed == NULL || (size_t)(parsed - stream_state->current_frame) != stream_state->current_frame_length) {
-                    /* protocol error */
-                    *error_found = H3ZERO_FRAME_ERROR;
+                int parse_ret = h3zero_data_stream_parse_header(stream_state, error_found);
+
+                if (parse_ret < 0) {
                     bytes = NULL;
                 }
-                /* free resource */
-                stream_state->frame_header_parsed = 0;
-                stream_state->frame_header_read = 0;
-                free(stream_state->current_frame);
-                stream_state->current_frame = NULL;
+                else if (parse_ret > 0) {
+                    /* Keep the frame until the missing entries are received */
+                    if (stream_state->qpack_decoder->nb_blocked_streams >= stream_state->qpack_decoder->max_blocked_streams) {
+                        *error_found = H3ZERO_QPACK_DECOMPRESSION_FAILED;
+                        bytes = NULL;
+                    }
+                    else {
+                        stream_state->qpack_decoder->nb_blocked_streams++;
+                        stream_state->is_blocked = 1;
+                    }
+                }
             }
         }
         else if (stream_state->current_frame_type == h3zero_frame_data) {
@@ -1045,8 +2403,49 @@ uint8_t * h3zero_parse_data_stream(uint8_t * bytes, uint8_t * bytes_max,
     return bytes;
 }
 
+uint8_t* h3zero_data_stream_unblock(h3zero_data_stream_state_t* stream_state, size_t* length, uint16_t* error_found)
+{
+    uint8_t* blocked_data = NULL;
+
+    *length = 0;
+    *error_found = 0;
+
+    if (stream_state->is_blocked) {
+        int parse_ret = h3zero_data_stream_parse_header(stream_state, error_found);
+
+        if (parse_ret <= 0) {
+            stream_state->is_blocked = 0;
+            stream_state->qpack_decoder->nb_blocked_streams--;
+            if (parse_ret == 0) {
+                blocked_data = stream_state->blocked_data;
+                *length = stream_state->blocked_data_length;
+            }
+            else {
+                free(stream_state->blocked_data);
+            }
+            stream_state->blocked_data = NULL;
+            stream_state->blocked_data_length = 0;
+        }
+    }
+
+    return blocked_data;
+}
+
 void h3zero_delete_data_stream_state(h3zero_data_stream_state_t * stream_state)
 {
+    if (stream_state->is_blocked) {
+        /* Tell the encoder that the stream will not be decoded */
+        stream_state->qpack_decoder->nb_blocked_streams--;
+        (void)h3zero_qpack_buffer_append_int(&stream_state->qpack_decoder->decoder_stream, 0x40, 0x3F, stream_state->stream_id);
+        stream_state->is_blocked = 0;
+    }
+
+    if (stream_state->blocked_data != NULL) {
+        free(stream_state->blocked_data);
+        stream_state->blocked_data = NULL;
+        stream_state->blocked_data_length = 0;
+    }
+
     if (stream_state->header_found && stream_state->header.path != NULL) {
         free((uint8_t*)stream_state->header.path);
         *((uint8_t**)&stream_state->header.path) = NULL;
@@ -1082,663 +2481,958 @@ uint8_t const * h3zero_default_setting_frame = h3zero_default_setting_frame_val;
 
 const size_t h3zero_default_setting_frame_size = sizeof(h3zero_default_setting_frame_val);
 
-/* There is no way in QPACK to prevent sender from using Huffman 
- * encoding. We use a simple decoding function with two tables:
- * - h3zero_qpack_huffman_bit, 64 bytes, 512 bits
- * - h3zero_qpack_huffman_val, 512 bytes.
- * If the bit at position "i" is set in the "bit" table, the code decoded so
- * far is an index. Increase "i" by one if the input byte is zero, by the
- * value in the "val" table if 1.
- * If the bit at position "i" is set in the "bit" table, the code decoded so
- * far is a terminal. Add the value in "val" to the decoded octet list, and
- * reset the index "i" to zero.
+static uint8_t* h3zero_varint_encode(uint8_t* bytes, uint8_t* bytes_max, uint64_t n64)
+{
+    size_t length = (n64 < 0x40) ? 1 : (n64 < 0x4000) ? 2 : (n64 < 0x40000000) ? 4 : 8;
+    uint8_t length_bits = (length == 1) ? 0 : (length == 2) ? 0x40 : (length == 4) ? 0x80 : 0xC0;
+
+    if (bytes == NULL || bytes + length > bytes_max || n64 >= 0x4000000000000000ull) {
+        bytes = NULL;
+    }
+    else {
+        for (size_t i = length; i > 0; i--) {
+            bytes[i - 1] = (uint8_t)n64;
+            n64 >>= 8;
+        }
+        bytes[0] |= length_bits;
+        bytes += length;
+    }
+    return bytes;
+}
+
+uint8_t* h3zero_settings_encode(uint8_t* bytes, uint8_t* bytes_max, const h3zero_settings_t* settings)
+{
+    uint8_t content[32];
+    uint8_t* content_end = content;
+
+    content_end = h3zero_varint_encode(content_end, content + sizeof(content), h3zero_setting_header_table_size);
+    content_end = h3zero_varint_encode(content_end, content + sizeof(content), settings->header_size);
+    content_end = h3zero_varint_encode(content_end, content + sizeof(content), h3zero_qpack_blocked_streams);
+    content_end = h3zero_varint_encode(content_end, content + sizeof(content), settings->blocked_streams);
+
+    bytes = h3zero_varint_encode(bytes, bytes_max, h3zero_stream_type_control);
+    bytes = h3zero_varint_encode(bytes, bytes_max, h3zero_frame_settings);
+    bytes = h3zero_varint_encode(bytes, bytes_max, (content_end == NULL) ? 0 : content_end - content);
+    if (bytes != NULL && content_end != NULL && bytes + (content_end - content) <= bytes_max) {
+        memcpy(bytes, content, content_end - content);
+        bytes += content_end - content;
+    }
+    else {
+        bytes = NULL;
+    }
+    return bytes;
+}
+
+uint8_t* h3zero_settings_decode(uint8_t* bytes, uint8_t* bytes_max, h3zero_settings_t* settings)
+{
+    memset(settings, 0, sizeof(h3zero_settings_t));
+
+    while (bytes != NULL && bytes < bytes_max) {
+        uint64_t setting_id;
+        uint64_t value;
+        size_t l_id = h3zero_varint_decode(bytes, bytes_max - bytes, &setting_id);
+        size_t l_val = (l_id == 0 || bytes + l_id >= bytes_max) ? 0 :
+            h3zero_varint_decode(bytes + l_id, bytes_max - bytes - l_id, &value);
+
+        if (l_val == 0 || value > 0xFFFFFFFFull) {
+            bytes = NULL;
+        }
+        else {
+            bytes += l_id + l_val;
+            if (setting_id == h3zero_setting_header_table_size) {
+                settings->header_size = (unsigned int)value;
+            }
+            else if (setting_id == h3zero_qpack_blocked_streams) {
+                settings->blocked_streams = (unsigned int)value;
+            }
+        }
+    }
+    return bytes;
+}
+
+/* Huffman coding of QPACK strings, using the code of RFC 7541, appendix B.
+ *
+ * The encoder uses the table of codes, h3zero_qpack_huffman_code, indexed
+ * by the value of the octet. Codes are accumulated in a 64 bit register,
+ * and full bytes are written as soon as they are available. The last byte
+ * is padded with the most significant bits of the EOS code, i.e., ones.
+ *
+ * The decoder processes the input 4 bits at a time. The states of the
+ * decoder are the 256 internal nodes of the code tree, numbered in breadth
+ * first order, with the root as state 0. Each entry of the table
+ * h3zero_qpack_huffman_decode_table[state][nibble] encodes:
+ * - bits 0-7: the next state,
+ * - bits 8-15: the decoded octet, if H3ZERO_HUFFMAN_EMIT is set. Since the
+ *   shortest codes have 5 bits, a nibble produces at most one octet,
+ * - H3ZERO_HUFFMAN_ACCEPT: the bits read since the last octet are all ones,
+ *   so the input may end there,
+ * - H3ZERO_HUFFMAN_FAIL: the nibble completes the EOS code, which shall
+ *   not appear in a string.
+ * As in previous versions, padding longer than 7 bits is accepted, as long
+ * as it does not complete an EOS code.
  */
 
-const uint8_t h3zero_qpack_huffman_bit[64] = {
-    249,
-    50,
-    115,
-    39,
-    38,
-    79,
-    147,
-    39,
-    38,
-    100,
-    249,
-    50,
-    114,
-    100,
-    242,
-    100,
-    228,
-    228,
-    206,
-    77,
-    52,
-    228,
-    204,
-    203,
-    202,
-    114,
-    102,
-    79,
-    147,
-    39,
-    76,
-    156,
-    153,
-    62,
-    76,
-    156,
-    156,
-    153,
-    62,
-    76,
-    156,
-    153,
-    60,
-    154,
-    100,
-    242,
-    102,
-    79,
-    147,
-    39,
-    38,
-    83,
-    228,
-    201,
-    201,
-    147,
-    211,
-    39,
-    38,
-    79,
-    38,
-    78,
-    76,
-    178
+#define H3ZERO_HUFFMAN_EMIT 0x10000
+#define H3ZERO_HUFFMAN_ACCEPT 0x20000
+#define H3ZERO_HUFFMAN_FAIL 0x40000
+
+typedef struct st_h3zero_qpack_huffman_code_t {
+    uint32_t code;
+    uint8_t nb_bits;
+} h3zero_qpack_huffman_code_t;
+
+static const h3zero_qpack_huffman_code_t h3zero_qpack_huffman_code[256] = {
+    { 0x1ff8, 13 }, /* 0 */
+    { 0x7fffd8, 23 }, /* 1 */
+    { 0xfffffe2, 28 }, /* 2 */
+    { 0xfffffe3, 28 }, /* 3 */
+    { 0xfffffe4, 28 }, /* 4 */
+    { 0xfffffe5, 28 }, /* 5 */
+    { 0xfffffe6, 28 }, /* 6 */
+    { 0xfffffe7, 28 }, /* 7 */
+    { 0xfffffe8, 28 }, /* 8 */
+    { 0xffffea, 24 }, /* 9 */
+    { 0x3ffffffc, 30 }, /* 10 */
+    { 0xfffffe9, 28 }, /* 11 */
+    { 0xfffffea, 28 }, /* 12 */
+    { 0x3ffffffd, 30 }, /* 13 */
+    { 0xfffffeb, 28 }, /* 14 */
+    { 0xfffffec, 28 }, /* 15 */
+    { 0xfffffed, 28 }, /* 16 */
+    { 0xfffffee, 28 }, /* 17 */
+    { 0xfffffef, 28 }, /* 18 */
+    { 0xffffff0, 28 }, /* 19 */
+    { 0xffffff1, 28 }, /* 20 */
+    { 0xffffff2, 28 }, /* 21 */
+    { 0x3ffffffe, 30 }, /* 22 */
+    { 0xffffff3, 28 }, /* 23 */
+    { 0xffffff4, 28 }, /* 24 */
+    { 0xffffff5, 28 }, /* 25 */
+    { 0xffffff6, 28 }, /* 26 */
+    { 0xffffff7, 28 }, /* 27 */
+    { 0xffffff8, 28 }, /* 28 */
+    { 0xffffff9, 28 }, /* 29 */
+    { 0xffffffa, 28 }, /* 30 */
+    { 0xffffffb, 28 }, /* 31 */
+    { 0x14, 6 }, /* ' ' */
+    { 0x3f8, 10 }, /* '!' */
+    { 0x3f9, 10 }, /* '"' */
+    { 0xffa, 12 }, /* '#' */
+    { 0x1ff9, 13 }, /* '$' */
+    { 0x15, 6 }, /* '%' */
+    { 0xf8, 8 }, /* '&' */
+    { 0x7fa, 11 }, /* '\'' */
+    { 0x3fa, 10 }, /* '(' */
+    { 0x3fb, 10 }, /* ')' */
+    { 0xf9, 8 }, /* '*' */
+    { 0x7fb, 11 }, /* '+' */
+    { 0xfa, 8 }, /* ',' */
+    { 0x16, 6 }, /* '-' */
+    { 0x17, 6 }, /* '.' */
+    { 0x18, 6 }, /* '/' */
+    { 0x0, 5 }, /* '0' */
+    { 0x1, 5 }, /* '1' */
+    { 0x2, 5 }, /* '2' */
+    { 0x19, 6 }, /* '3' */
+    { 0x1a, 6 }, /* '4' */
+    { 0x1b, 6 }, /* '5' */
+    { 0x1c, 6 }, /* '6' */
+    { 0x1d, 6 }, /* '7' */
+    { 0x1e, 6 }, /* '8' */
+    { 0x1f, 6 }, /* '9' */
+    { 0x5c, 7 }, /* ':' */
+    { 0xfb, 8 }, /* ';' */
+    { 0x7ffc, 15 }, /* '<' */
+    { 0x20, 6 }, /* '=' */
+    { 0xffb, 12 }, /* '>' */
+    { 0x3fc, 10 }, /* '?' */
+    { 0x1ffa, 13 }, /* '@' */
+    { 0x21, 6 }, /* 'A' */
+    { 0x5d, 7 }, /* 'B' */
+    { 0x5e, 7 }, /* 'C' */
+    { 0x5f, 7 }, /* 'D' */
+    { 0x60, 7 }, /* 'E' */
+    { 0x61, 7 }, /* 'F' */
+    { 0x62, 7 }, /* 'G' */
+    { 0x63, 7 }, /* 'H' */
+    { 0x64, 7 }, /* 'I' */
+    { 0x65, 7 }, /* 'J' */
+    { 0x66, 7 }, /* 'K' */
+    { 0x67, 7 }, /* 'L' */
+    { 0x68, 7 }, /* 'M' */
+    { 0x69, 7 }, /* 'N' */
+    { 0x6a, 7 }, /* 'O' */
+    { 0x6b, 7 }, /* 'P' */
+    { 0x6c, 7 }, /* 'Q' */
+    { 0x6d, 7 }, /* 'R' */
+    { 0x6e, 7 }, /* 'S' */
+    { 0x6f, 7 }, /* 'T' */
+    { 0x70, 7 }, /* 'U' */
+    { 0x71, 7 }, /* 'V' */
+    { 0x72, 7 }, /* 'W' */
+    { 0xfc, 8 }, /* 'X' */
+    { 0x73, 7 }, /* 'Y' */
+    { 0xfd, 8 }, /* 'Z' */
+    { 0x1ffb, 13 }, /* '[' */
+    { 0x7fff0, 19 }, /* '\\' */
+    { 0x1ffc, 13 }, /* ']' */
+    { 0x3ffc, 14 }, /* '^' */
+    { 0x22, 6 }, /* '_' */
+    { 0x7ffd, 15 }, /* '`' */
+    { 0x3, 5 }, /* 'a' */
+    { 0x23, 6 }, /* 'b' */
+    { 0x4, 5 }, /* 'c' */
+    { 0x24, 6 }, /* 'd' */
+    { 0x5, 5 }, /* 'e' */
+    { 0x25, 6 }, /* 'f' */
+    { 0x26, 6 }, /* 'g' */
+    { 0x27, 6 }, /* 'h' */
+    { 0x6, 5 }, /* 'i' */
+    { 0x74, 7 }, /* 'j' */
+    { 0x75, 7 }, /* 'k' */
+    { 0x28, 6 }, /* 'l' */
+    { 0x29, 6 }, /* 'm' */
+    { 0x2a, 6 }, /* 'n' */
+    { 0x7, 5 }, /* 'o' */
+    { 0x2b, 6 }, /* 'p' */
+    { 0x76, 7 }, /* 'q' */
+    { 0x2c, 6 }, /* 'r' */
+    { 0x8, 5 }, /* 's' */
+    { 0x9, 5 }, /* 't' */
+    { 0x2d, 6 }, /* 'u' */
+    { 0x77, 7 }, /* 'v' */
+    { 0x78, 7 }, /* 'w' */
+    { 0x79, 7 }, /* 'x' */
+    { 0x7a, 7 }, /* 'y' */
+    { 0x7b, 7 }, /* 'z' */
+    { 0x7ffe, 15 }, /* '{' */
+    { 0x7fc, 11 }, /* '|' */
+    { 0x3ffd, 14 }, /* '}' */
+    { 0x1ffd, 13 }, /* '~' */
+    { 0xffffffc, 28 }, /* 127 */
+    { 0xfffe6, 20 }, /* 128 */
+    { 0x3fffd2, 22 }, /* 129 */
+    { 0xfffe7, 20 }, /* 130 */
+    { 0xfffe8, 20 }, /* 131 */
+    { 0x3fffd3, 22 }, /* 132 */
+    { 0x3fffd4, 22 }, /* 133 */
+    { 0x3fffd5, 22 }, /* 134 */
+    { 0x7fffd9, 23 }, /* 135 */
+    { 0x3fffd6, 22 }, /* 136 */
+    { 0x7fffda, 23 }, /* 137 */
+    { 0x7fffdb, 23 }, /* 138 */
+    { 0x7fffdc, 23 }, /* 139 */
+    { 0x7fffdd, 23 }, /* 140 */
+    { 0x7fffde, 23 }, /* 141 */
+    { 0xffffeb, 24 }, /* 142 */
+    { 0x7fffdf, 23 }, /* 143 */
+    { 0xffffec, 24 }, /* 144 */
+    { 0xffffed, 24 }, /* 145 */
+    { 0x3fffd7, 22 }, /* 146 */
+    { 0x7fffe0, 23 }, /* 147 */
+    { 0xffffee, 24 }, /* 148 */
+    { 0x7fffe1, 23 }, /* 149 */
+    { 0x7fffe2, 23 }, /* 150 */
+    { 0x7fffe3, 23 }, /* 151 */
+    { 0x7fffe4, 23 }, /* 152 */
+    { 0x1fffdc, 21 }, /* 153 */
+    { 0x3fffd8, 22 }, /* 154 */
+    { 0x7fffe5, 23 }, /* 155 */
+    { 0x3fffd9, 22 }, /* 156 */
+    { 0x7fffe6, 23 }, /* 157 */
+    { 0x7fffe7, 23 }, /* 158 */
+    { 0xffffef, 24 }, /* 159 */
+    { 0x3fffda, 22 }, /* 160 */
+    { 0x1fffdd, 21 }, /* 161 */
+    { 0xfffe9, 20 }, /* 162 */
+    { 0x3fffdb, 22 }, /* 163 */
+    { 0x3fffdc, 22 }, /* 164 */
+    { 0x7fffe8, 23 }, /* 165 */
+    { 0x7fffe9, 23 }, /* 166 */
+    { 0x1fffde, 21 }, /* 167 */
+    { 0x7fffea, 23 }, /* 168 */
+    { 0x3fffdd, 22 }, /* 169 */
+    { 0x3fffde, 22 }, /* 170 */
+    { 0xfffff0, 24 }, /* 171 */
+    { 0x1fffdf, 21 }, /* 172 */
+    { 0x3fffdf, 22 }, /* 173 */
+    { 0x7fffeb, 23 }, /* 174 */
+    { 0x7fffec, 23 }, /* 175 */
+    { 0x1fffe0, 21 }, /* 176 */
+    { 0x1fffe1, 21 }, /* 177 */
+    { 0x3fffe0, 22 }, /* 178 */
+    { 0x1fffe2, 21 }, /* 179 */
+    { 0x7fffed, 23 }, /* 180 */
+    { 0x3fffe1, 22 }, /* 181 */
+    { 0x7fffee, 23 }, /* 182 */
+    { 0x7fffef, 23 }, /* 183 */
+    { 0xfffea, 20 }, /* 184 */
+    { 0x3fffe2, 22 }, /* 185 */
+    { 0x3fffe3, 22 }, /* 186 */
+    { 0x3fffe4, 22 }, /* 187 */
+    { 0x7ffff0, 23 }, /* 188 */
+    { 0x3fffe5, 22 }, /* 189 */
+    { 0x3fffe6, 22 }, /* 190 */
+    { 0x7ffff1, 23 }, /* 191 */
+    { 0x3ffffe0, 26 }, /* 192 */
+    { 0x3ffffe1, 26 }, /* 193 */
+    { 0xfffeb, 20 }, /* 194 */
+    { 0x7fff1, 19 }, /* 195 */
+    { 0x3fffe7, 22 }, /* 196 */
+    { 0x7ffff2, 23 }, /* 197 */
+    { 0x3fffe8, 22 }, /* 198 */
+    { 0x1ffffec, 25 }, /* 199 */
+    { 0x3ffffe2, 26 }, /* 200 */
+    { 0x3ffffe3, 26 }, /* 201 */
+    { 0x3ffffe4, 26 }, /* 202 */
+    { 0x7ffffde, 27 }, /* 203 */
+    { 0x7ffffdf, 27 }, /* 204 */
+    { 0x3ffffe5, 26 }, /* 205 */
+    { 0xfffff1, 24 }, /* 206 */
+    { 0x1ffffed, 25 }, /* 207 */
+    { 0x7fff2, 19 }, /* 208 */
+    { 0x1fffe3, 21 }, /* 209 */
+    { 0x3ffffe6, 26 }, /* 210 */
+    { 0x7ffffe0, 27 }, /* 211 */
+    { 0x7ffffe1, 27 }, /* 212 */
+    { 0x3ffffe7, 26 }, /* 213 */
+    { 0x7ffffe2, 27 }, /* 214 */
+    { 0xfffff2, 24 }, /* 215 */
+    { 0x1fffe4, 21 }, /* 216 */
+    { 0x1fffe5, 21 }, /* 217 */
+    { 0x3ffffe8, 26 }, /* 218 */
+    { 0x3ffffe9, 26 }, /* 219 */
+    { 0xffffffd, 28 }, /* 220 */
+    { 0x7ffffe3, 27 }, /* 221 */
+    { 0x7ffffe4, 27 }, /* 222 */
+    { 0x7ffffe5, 27 }, /* 223 */
+    { 0xfffec, 20 }, /* 224 */
+    { 0xfffff3, 24 }, /* 225 */
+    { 0xfffed, 20 }, /* 226 */
+    { 0x1fffe6, 21 }, /* 227 */
+    { 0x3fffe9, 22 }, /* 228 */
+    { 0x1fffe7, 21 }, /* 229 */
+    { 0x1fffe8, 21 }, /* 230 */
+    { 0x7ffff3, 23 }, /* 231 */
+    { 0x3fffea, 22 }, /* 232 */
+    { 0x3fffeb, 22 }, /* 233 */
+    { 0x1ffffee, 25 }, /* 234 */
+    { 0x1ffffef, 25 }, /* 235 */
+    { 0xfffff4, 24 }, /* 236 */
+    { 0xfffff5, 24 }, /* 237 */
+    { 0x3ffffea, 26 }, /* 238 */
+    { 0x7ffff4, 23 }, /* 239 */
+    { 0x3ffffeb, 26 }, /* 240 */
+    { 0x7ffffe6, 27 }, /* 241 */
+    { 0x3ffffec, 26 }, /* 242 */
+    { 0x3ffffed, 26 }, /* 243 */
+    { 0x7ffffe7, 27 }, /* 244 */
+    { 0x7ffffe8, 27 }, /* 245 */
+    { 0x7ffffe9, 27 }, /* 246 */
+    { 0x7ffffea, 27 }, /* 247 */
+    { 0x7ffffeb, 27 }, /* 248 */
+    { 0xffffffe, 28 }, /* 249 */
+    { 0x7ffffec, 27 }, /* 250 */
+    { 0x7ffffed, 27 }, /* 251 */
+    { 0x7ffffee, 27 }, /* 252 */
+    { 0x7ffffef, 27 }, /* 253 */
+    { 0x7fffff0, 27 }, /* 254 */
+    { 0x3ffffee, 26 }  /* 255 */
 };
 
-const uint8_t h3zero_qpack_huffman_val[512] = {
-    /* 0: |  X: 44 */ 44,
-    /* 1: |0  X: 17 */ 16,
-    /* 2: |00  X: 10 */ 8,
-    /* 3: |000  X: 7 */ 4,
-    /* 4: |0000  X: 6 */ 2,
-    /* 5: |00000  V: 48 */ 48,
-    /* 6: |00001  V: 49 */ 49,
-    /* 7: |0001  X: 9 */ 2,
-    /* 8: |00010  V: 50 */ 50,
-    /* 9: |00011  V: 97 */ 97,
-    /* 10: |001  X: 14 */ 4,
-    /* 11: |0010  X: 13 */ 2,
-    /* 12: |00100  V: 99 */ 99,
-    /* 13: |00101  V: 101 */ 101,
-    /* 14: |0011  X: 16 */ 2,
-    /* 15: |00110  V: 105 */ 105,
-    /* 16: |00111  V: 111 */ 111,
-    /* 17: |01  X: 29 */ 12,
-    /* 18: |010  X: 22 */ 4,
-    /* 19: |0100  X: 21 */ 2,
-    /* 20: |01000  V: 115 */ 115,
-    /* 21: |01001  V: 116 */ 116,
-    /* 22: |0101  X: 26 */ 4,
-    /* 23: |01010  X: 25 */ 2,
-    /* 24: |010100  V: 32 */ 32,
-    /* 25: |010101  V: 37 */ 37,
-    /* 26: |01011  X: 28 */ 2,
-    /* 27: |010110  V: 45 */ 45,
-    /* 28: |010111  V: 46 */ 46,
-    /* 29: |011  X: 37 */ 8,
-    /* 30: |0110  X: 34 */ 4,
-    /* 31: |01100  X: 33 */ 2,
-    /* 32: |011000  V: 47 */ 47,
-    /* 33: |011001  V: 51 */ 51,
-    /* 34: |01101  X: 36 */ 2,
-    /* 35: |011010  V: 52 */ 52,
-    /* 36: |011011  V: 53 */ 53,
-    /* 37: |0111  X: 41 */ 4,
-    /* 38: |01110  X: 40 */ 2,
-    /* 39: |011100  V: 54 */ 54,
-    /* 40: |011101  V: 55 */ 55,
-    /* 41: |01111  X: 43 */ 2,
-    /* 42: |011110  V: 56 */ 56,
-    /* 43: |011111  V: 57 */ 57,
-    /* 44: |1  X: 80 */ 36,
-    /* 45: |10  X: 61 */ 16,
-    /* 46: |100  X: 54 */ 8,
-    /* 47: |1000  X: 51 */ 4,
-    /* 48: |10000  X: 50 */ 2,
-    /* 49: |100000  V: 61 */ 61,
-    /* 50: |100001  V: 65 */ 65,
-    /* 51: |10001  X: 53 */ 2,
-    /* 52: |100010  V: 95 */ 95,
-    /* 53: |100011  V: 98 */ 98,
-    /* 54: |1001  X: 58 */ 4,
-    /* 55: |10010  X: 57 */ 2,
-    /* 56: |100100  V: 100 */ 100,
-    /* 57: |100101  V: 102 */ 102,
-    /* 58: |10011  X: 60 */ 2,
-    /* 59: |100110  V: 103 */ 103,
-    /* 60: |100111  V: 104 */ 104,
-    /* 61: |101  X: 69 */ 8,
-    /* 62: |1010  X: 66 */ 4,
-    /* 63: |10100  X: 65 */ 2,
-    /* 64: |101000  V: 108 */ 108,
-    /* 65: |101001  V: 109 */ 109,
-    /* 66: |10101  X: 68 */ 2,
-    /* 67: |101010  V: 110 */ 110,
-    /* 68: |101011  V: 112 */ 112,
-    /* 69: |1011  X: 73 */ 4,
-    /* 70: |10110  X: 72 */ 2,
-    /* 71: |101100  V: 114 */ 114,
-    /* 72: |101101  V: 117 */ 117,
-    /* 73: |10111  X: 77 */ 4,
-    /* 74: |101110  X: 76 */ 2,
-    /* 75: |1011100  V: 58 */ 58,
-    /* 76: |1011101  V: 66 */ 66,
-    /* 77: |101111  X: 79 */ 2,
-    /* 78: |1011110  V: 67 */ 67,
-    /* 79: |1011111  V: 68 */ 68,
-    /* 80: |11  X: 112 */ 32,
-    /* 81: |110  X: 97 */ 16,
-    /* 82: |1100  X: 90 */ 8,
-    /* 83: |11000  X: 87 */ 4,
-    /* 84: |110000  X: 86 */ 2,
-    /* 85: |1100000  V: 69 */ 69,
-    /* 86: |1100001  V: 70 */ 70,
-    /* 87: |110001  X: 89 */ 2,
-    /* 88: |1100010  V: 71 */ 71,
-    /* 89: |1100011  V: 72 */ 72,
-    /* 90: |11001  X: 94 */ 4,
-    /* 91: |110010  X: 93 */ 2,
-    /* 92: |1100100  V: 73 */ 73,
-    /* 93: |1100101  V: 74 */ 74,
-    /* 94: |110011  X: 96 */ 2,
-    /* 95: |1100110  V: 75 */ 75,
-    /* 96: |1100111  V: 76 */ 76,
-    /* 97: |1101  X: 105 */ 8,
-    /* 98: |11010  X: 102 */ 4,
-    /* 99: |110100  X: 101 */ 2,
-    /* 100: |1101000  V: 77 */ 77,
-    /* 101: |1101001  V: 78 */ 78,
-    /* 102: |110101  X: 104 */ 2,
-    /* 103: |1101010  V: 79 */ 79,
-    /* 104: |1101011  V: 80 */ 80,
-    /* 105: |11011  X: 109 */ 4,
-    /* 106: |110110  X: 108 */ 2,
-    /* 107: |1101100  V: 81 */ 81,
-    /* 108: |1101101  V: 82 */ 82,
-    /* 109: |110111  X: 111 */ 2,
-    /* 110: |1101110  V: 83 */ 83,
-    /* 111: |1101111  V: 84 */ 84,
-    /* 112: |111  X: 128 */ 16,
-    /* 113: |1110  X: 121 */ 8,
-    /* 114: |11100  X: 118 */ 4,
-    /* 115: |111000  X: 117 */ 2,
-    /* 116: |1110000  V: 85 */ 85,
-    /* 117: |1110001  V: 86 */ 86,
-    /* 118: |111001  X: 120 */ 2,
-    /* 119: |1110010  V: 87 */ 87,
-    /* 120: |1110011  V: 89 */ 89,
-    /* 121: |11101  X: 125 */ 4,
-    /* 122: |111010  X: 124 */ 2,
-    /* 123: |1110100  V: 106 */ 106,
-    /* 124: |1110101  V: 107 */ 107,
-    /* 125: |111011  X: 127 */ 2,
-    /* 126: |1110110  V: 113 */ 113,
-    /* 127: |1110111  V: 118 */ 118,
-    /* 128: |1111  X: 136 */ 8,
-    /* 129: |11110  X: 133 */ 4,
-    /* 130: |111100  X: 132 */ 2,
-    /* 131: |1111000  V: 119 */ 119,
-    /* 132: |1111001  V: 120 */ 120,
-    /* 133: |111101  X: 135 */ 2,
-    /* 134: |1111010  V: 121 */ 121,
-    /* 135: |1111011  V: 122 */ 122,
-    /* 136: |11111  X: 144 */ 8,
-    /* 137: |111110  X: 141 */ 4,
-    /* 138: |1111100  X: 140 */ 2,
-    /* 139: |11111000  V: 38 */ 38,
-    /* 140: |11111001  V: 42 */ 42,
-    /* 141: |1111101  X: 143 */ 2,
-    /* 142: |11111010  V: 44 */ 44,
-    /* 143: |11111011  V: 59 */ 59,
-    /* 144: |111111  X: 148 */ 4,
-    /* 145: |1111110  X: 147 */ 2,
-    /* 146: |11111100  V: 88 */ 88,
-    /* 147: |11111101  V: 90 */ 90,
-    /* 148: |1111111  X: 156 */ 8,
-    /* 149: |11111110  X: 153 */ 4,
-    /* 150: |11111110|0  X: 152 */ 2,
-    /* 151: |11111110|00  V: 33 */ 33,
-    /* 152: |11111110|01  V: 34 */ 34,
-    /* 153: |11111110|1  X: 155 */ 2,
-    /* 154: |11111110|10  V: 40 */ 40,
-    /* 155: |11111110|11  V: 41 */ 41,
-    /* 156: |11111111|  X: 162 */ 6,
-    /* 157: |11111111|0  X: 159 */ 2,
-    /* 158: |11111111|00  V: 63 */ 63,
-    /* 159: |11111111|01  X: 161 */ 2,
-    /* 160: |11111111|010  V: 39 */ 39,
-    /* 161: |11111111|011  V: 43 */ 43,
-    /* 162: |11111111|1  X: 168 */ 6,
-    /* 163: |11111111|10  X: 165 */ 2,
-    /* 164: |11111111|100  V: 124 */ 124,
-    /* 165: |11111111|101  X: 167 */ 2,
-    /* 166: |11111111|1010  V: 35 */ 35,
-    /* 167: |11111111|1011  V: 62 */ 62,
-    /* 168: |11111111|11  X: 176 */ 8,
-    /* 169: |11111111|110  X: 173 */ 4,
-    /* 170: |11111111|1100  X: 172 */ 2,
-    /* 171: |11111111|11000  V: 0 */ 0,
-    /* 172: |11111111|11001  V: 36 */ 36,
-    /* 173: |11111111|1101  X: 175 */ 2,
-    /* 174: |11111111|11010  V: 64 */ 64,
-    /* 175: |11111111|11011  V: 91 */ 91,
-    /* 176: |11111111|111  X: 180 */ 4,
-    /* 177: |11111111|1110  X: 179 */ 2,
-    /* 178: |11111111|11100  V: 93 */ 93,
-    /* 179: |11111111|11101  V: 126 */ 126,
-    /* 180: |11111111|1111  X: 184 */ 4,
-    /* 181: |11111111|11110  X: 183 */ 2,
-    /* 182: |11111111|111100  V: 94 */ 94,
-    /* 183: |11111111|111101  V: 125 */ 125,
-    /* 184: |11111111|11111  X: 188 */ 4,
-    /* 185: |11111111|111110  X: 187 */ 2,
-    /* 186: |11111111|1111100  V: 60 */ 60,
-    /* 187: |11111111|1111101  V: 96 */ 96,
-    /* 188: |11111111|111111  X: 190 */ 2,
-    /* 189: |11111111|1111110  V: 123 */ 123,
-    /* 190: |11111111|1111111  X: 220 */ 30,
-    /* 191: |11111111|11111110|  X: 201 */ 10,
-    /* 192: |11111111|11111110|0  X: 196 */ 4,
-    /* 193: |11111111|11111110|00  X: 195 */ 2,
-    /* 194: |11111111|11111110|000  V: 92 */ 92,
-    /* 195: |11111111|11111110|001  V: 195 */ 195,
-    /* 196: |11111111|11111110|01  X: 198 */ 2,
-    /* 197: |11111111|11111110|010  V: 208 */ 208,
-    /* 198: |11111111|11111110|011  X: 200 */ 2,
-    /* 199: |11111111|11111110|0110  V: 128 */ 128,
-    /* 200: |11111111|11111110|0111  V: 130 */ 130,
-    /* 201: |11111111|11111110|1  X: 209 */ 8,
-    /* 202: |11111111|11111110|10  X: 206 */ 4,
-    /* 203: |11111111|11111110|100  X: 205 */ 2,
-    /* 204: |11111111|11111110|1000  V: 131 */ 131,
-    /* 205: |11111111|11111110|1001  V: 162 */ 162,
-    /* 206: |11111111|11111110|101  X: 208 */ 2,
-    /* 207: |11111111|11111110|1010  V: 184 */ 184,
-    /* 208: |11111111|11111110|1011  V: 194 */ 194,
-    /* 209: |11111111|11111110|11  X: 213 */ 4,
-    /* 210: |11111111|11111110|110  X: 212 */ 2,
-    /* 211: |11111111|11111110|1100  V: 224 */ 224,
-    /* 212: |11111111|11111110|1101  V: 226 */ 226,
-    /* 213: |11111111|11111110|111  X: 217 */ 4,
-    /* 214: |11111111|11111110|1110  X: 216 */ 2,
-    /* 215: |11111111|11111110|11100  V: 153 */ 153,
-    /* 216: |11111111|11111110|11101  V: 161 */ 161,
-    /* 217: |11111111|11111110|1111  X: 219 */ 2,
-    /* 218: |11111111|11111110|11110  V: 167 */ 167,
-    /* 219: |11111111|11111110|11111  V: 172 */ 172,
-    /* 220: |11111111|11111111|  X: 266 */ 46,
-    /* 221: |11111111|11111111|0  X: 237 */ 16,
-    /* 222: |11111111|11111111|00  X: 230 */ 8,
-    /* 223: |11111111|11111111|000  X: 227 */ 4,
-    /* 224: |11111111|11111111|0000  X: 226 */ 2,
-    /* 225: |11111111|11111111|00000  V: 176 */ 176,
-    /* 226: |11111111|11111111|00001  V: 177 */ 177,
-    /* 227: |11111111|11111111|0001  X: 229 */ 2,
-    /* 228: |11111111|11111111|00010  V: 179 */ 179,
-    /* 229: |11111111|11111111|00011  V: 209 */ 209,
-    /* 230: |11111111|11111111|001  X: 234 */ 4,
-    /* 231: |11111111|11111111|0010  X: 233 */ 2,
-    /* 232: |11111111|11111111|00100  V: 216 */ 216,
-    /* 233: |11111111|11111111|00101  V: 217 */ 217,
-    /* 234: |11111111|11111111|0011  X: 236 */ 2,
-    /* 235: |11111111|11111111|00110  V: 227 */ 227,
-    /* 236: |11111111|11111111|00111  V: 229 */ 229,
-    /* 237: |11111111|11111111|01  X: 251 */ 14,
-    /* 238: |11111111|11111111|010  X: 244 */ 6,
-    /* 239: |11111111|11111111|0100  X: 241 */ 2,
-    /* 240: |11111111|11111111|01000  V: 230 */ 230,
-    /* 241: |11111111|11111111|01001  X: 243 */ 2,
-    /* 242: |11111111|11111111|010010  V: 129 */ 129,
-    /* 243: |11111111|11111111|010011  V: 132 */ 132,
-    /* 244: |11111111|11111111|0101  X: 248 */ 4,
-    /* 245: |11111111|11111111|01010  X: 247 */ 2,
-    /* 246: |11111111|11111111|010100  V: 133 */ 133,
-    /* 247: |11111111|11111111|010101  V: 134 */ 134,
-    /* 248: |11111111|11111111|01011  X: 250 */ 2,
-    /* 249: |11111111|11111111|010110  V: 136 */ 136,
-    /* 250: |11111111|11111111|010111  V: 146 */ 146,
-    /* 251: |11111111|11111111|011  X: 259 */ 8,
-    /* 252: |11111111|11111111|0110  X: 256 */ 4,
-    /* 253: |11111111|11111111|01100  X: 255 */ 2,
-    /* 254: |11111111|11111111|011000  V: 154 */ 154,
-    /* 255: |11111111|11111111|011001  V: 156 */ 156,
-    /* 256: |11111111|11111111|01101  X: 257 */ 2,
-    /* 257: |11111111|11111111|011010  V: 160 */ 160,
-    /* 258: |11111111|11111111|011011  V: 163 */ 163,
-    /* 259: |11111111|11111111|0111  X: 263 */ 4,
-    /* 260: |11111111|11111111|01110  X: 262 */ 2,
-    /* 261: |11111111|11111111|011100  V: 164 */ 164,
-    /* 262: |11111111|11111111|011101  V: 169 */ 169,
-    /* 263: |11111111|11111111|01111  X: 265 */ 2,
-    /* 264: |11111111|11111111|011110  V: 170 */ 170,
-    /* 265: |11111111|11111111|011111  V: 173 */ 173,
-    /* 266: |11111111|11111111|1  X: 306 */ 40,
-    /* 267: |11111111|11111111|10  X: 283 */ 16,
-    /* 268: |11111111|11111111|100  X: 276 */ 8,
-    /* 269: |11111111|11111111|1000  X: 273 */ 4,
-    /* 270: |11111111|11111111|10000  X: 272 */ 2,
-    /* 271: |11111111|11111111|100000  V: 178 */ 178,
-    /* 272: |11111111|11111111|100001  V: 181 */ 181,
-    /* 273: |11111111|11111111|10001  X: 275 */ 2,
-    /* 274: |11111111|11111111|100010  V: 185 */ 185,
-    /* 275: |11111111|11111111|100011  V: 186 */ 186,
-    /* 276: |11111111|11111111|1001  X: 280 */ 4,
-    /* 277: |11111111|11111111|10010  X: 279 */ 2,
-    /* 278: |11111111|11111111|100100  V: 187 */ 187,
-    /* 279: |11111111|11111111|100101  V: 189 */ 189,
-    /* 280: |11111111|11111111|10011  X: 282 */ 2,
-    /* 281: |11111111|11111111|100110  V: 190 */ 190,
-    /* 282: |11111111|11111111|100111  V: 196 */ 196,
-    /* 283: |11111111|11111111|101  X: 291 */ 8,
-    /* 284: |11111111|11111111|1010  X: 288 */ 4,
-    /* 285: |11111111|11111111|10100  X: 287 */ 2,
-    /* 286: |11111111|11111111|101000  V: 198 */ 198,
-    /* 287: |11111111|11111111|101001  V: 228 */ 228,
-    /* 288: |11111111|11111111|10101  X: 290 */ 2,
-    /* 289: |11111111|11111111|101010  V: 232 */ 232,
-    /* 290: |11111111|11111111|101011  V: 233 */ 233,
-    /* 291: |11111111|11111111|1011  X: 299 */ 8,
-    /* 292: |11111111|11111111|10110  X: 296 */ 4,
-    /* 293: |11111111|11111111|101100  X: 295 */ 2,
-    /* 294: |11111111|11111111|1011000  V: 1 */ 1,
-    /* 295: |11111111|11111111|1011001  V: 135 */ 135,
-    /* 296: |11111111|11111111|101101  X: 298 */ 2,
-    /* 297: |11111111|11111111|1011010  V: 137 */ 137,
-    /* 298: |11111111|11111111|1011011  V: 138 */ 138,
-    /* 299: |11111111|11111111|10111  X: 303 */ 4,
-    /* 300: |11111111|11111111|101110  X: 302 */ 2,
-    /* 301: |11111111|11111111|1011100  V: 139 */ 139,
-    /* 302: |11111111|11111111|1011101  V: 140 */ 140,
-    /* 303: |11111111|11111111|101111  X: 305 */ 2,
-    /* 304: |11111111|11111111|1011110  V: 141 */ 141,
-    /* 305: |11111111|11111111|1011111  V: 143 */ 143,
-    /* 306: |11111111|11111111|11  X: 338 */ 32,
-    /* 307: |11111111|11111111|110  X: 323 */ 16,
-    /* 308: |11111111|11111111|1100  X: 316 */ 8,
-    /* 309: |11111111|11111111|11000  X: 313 */ 4,
-    /* 310: |11111111|11111111|110000  X: 312 */ 2,
-    /* 311: |11111111|11111111|1100000  V: 147 */ 147,
-    /* 312: |11111111|11111111|1100001  V: 149 */ 149,
-    /* 313: |11111111|11111111|110001  X: 315 */ 2,
-    /* 314: |11111111|11111111|1100010  V: 150 */ 150,
-    /* 315: |11111111|11111111|1100011  V: 151 */ 151,
-    /* 316: |11111111|11111111|11001  X: 320 */ 4,
-    /* 317: |11111111|11111111|110010  X: 319 */ 2,
-    /* 318: |11111111|11111111|1100100  V: 152 */ 152,
-    /* 319: |11111111|11111111|1100101  V: 155 */ 155,
-    /* 320: |11111111|11111111|110011  X: 322 */ 2,
-    /* 321: |11111111|11111111|1100110  V: 157 */ 157,
-    /* 322: |11111111|11111111|1100111  V: 158 */ 158,
-    /* 323: |11111111|11111111|1101  X: 331 */ 8,
-    /* 324: |11111111|11111111|11010  X: 328 */ 4,
-    /* 325: |11111111|11111111|110100  X: 327 */ 2,
-    /* 326: |11111111|11111111|1101000  V: 165 */ 165,
-    /* 327: |11111111|11111111|1101001  V: 166 */ 166,
-    /* 328: |11111111|11111111|110101  X: 330 */ 2,
-    /* 329: |11111111|11111111|1101010  V: 168 */ 168,
-    /* 330: |11111111|11111111|1101011  V: 174 */ 174,
-    /* 331: |11111111|11111111|11011  X: 335 */ 4,
-    /* 332: |11111111|11111111|110110  X: 334 */ 2,
-    /* 333: |11111111|11111111|1101100  V: 175 */ 175,
-    /* 334: |11111111|11111111|1101101  V: 180 */ 180,
-    /* 335: |11111111|11111111|110111  X: 337 */ 2,
-    /* 336: |11111111|11111111|1101110  V: 182 */ 182,
-    /* 337: |11111111|11111111|1101111  V: 183 */ 183,
-    /* 338: |11111111|11111111|111  X: 360 */ 22,
-    /* 339: |11111111|11111111|1110  X: 347 */ 8,
-    /* 340: |11111111|11111111|11100  X: 344 */ 4,
-    /* 341: |11111111|11111111|111000  X: 343 */ 2,
-    /* 342: |11111111|11111111|1110000  V: 188 */ 188,
-    /* 343: |11111111|11111111|1110001  V: 191 */ 191,
-    /* 344: |11111111|11111111|111001  X: 346 */ 2,
-    /* 345: |11111111|11111111|1110010  V: 197 */ 197,
-    /* 346: |11111111|11111111|1110011  V: 231 */ 231,
-    /* 347: |11111111|11111111|11101  X: 353 */ 6,
-    /* 348: |11111111|11111111|111010  X: 350 */ 2,
-    /* 349: |11111111|11111111|1110100  V: 239 */ 239,
-    /* 350: |11111111|11111111|1110101  X: 352 */ 2,
-    /* 351: |11111111|11111111|11101010  V: 9 */ 9,
-    /* 352: |11111111|11111111|11101011  V: 142 */ 142,
-    /* 353: |11111111|11111111|111011  X: 357 */ 4,
-    /* 354: |11111111|11111111|1110110  X: 356 */ 2,
-    /* 355: |11111111|11111111|11101100  V: 144 */ 144,
-    /* 356: |11111111|11111111|11101101  V: 145 */ 145,
-    /* 357: |11111111|11111111|1110111  X: 359 */ 2,
-    /* 358: |11111111|11111111|11101110  V: 148 */ 148,
-    /* 359: |11111111|11111111|11101111  V: 159 */ 159,
-    /* 360: |11111111|11111111|1111  X: 380 */ 20,
-    /* 361: |11111111|11111111|11110  X: 369 */ 8,
-    /* 362: |11111111|11111111|111100  X: 366 */ 4,
-    /* 363: |11111111|11111111|1111000  X: 365 */ 2,
-    /* 364: |11111111|11111111|11110000  V: 171 */ 171,
-    /* 365: |11111111|11111111|11110001  V: 206 */ 206,
-    /* 366: |11111111|11111111|1111001  X: 368 */ 2,
-    /* 367: |11111111|11111111|11110010  V: 215 */ 215,
-    /* 368: |11111111|11111111|11110011  V: 225 */ 225,
-    /* 369: |11111111|11111111|111101  X: 373 */ 4,
-    /* 370: |11111111|11111111|1111010  X: 372 */ 2,
-    /* 371: |11111111|11111111|11110100  V: 236 */ 236,
-    /* 372: |11111111|11111111|11110101  V: 237 */ 237,
-    /* 373: |11111111|11111111|1111011  X: 377 */ 4,
-    /* 374: |11111111|11111111|11110110|  X: 376 */ 2,
-    /* 375: |11111111|11111111|11110110|0  V: 199 */ 199,
-    /* 376: |11111111|11111111|11110110|1  V: 207 */ 207,
-    /* 377: |11111111|11111111|11110111|  X: 379 */ 2,
-    /* 378: |11111111|11111111|11110111|0  V: 234 */ 234,
-    /* 379: |11111111|11111111|11110111|1  V: 235 */ 235,
-    /* 380: |11111111|11111111|11111  X: 414 */ 34,
-    /* 381: |11111111|11111111|111110  X: 397 */ 16,
-    /* 382: |11111111|11111111|1111100  X: 390 */ 8,
-    /* 383: |11111111|11111111|11111000|  X: 387 */ 4,
-    /* 384: |11111111|11111111|11111000|0  X: 386 */ 2,
-    /* 385: |11111111|11111111|11111000|00  V: 192 */ 192,
-    /* 386: |11111111|11111111|11111000|01  V: 193 */ 193,
-    /* 387: |11111111|11111111|11111000|1  X: 389 */ 2,
-    /* 388: |11111111|11111111|11111000|10  V: 200 */ 200,
-    /* 389: |11111111|11111111|11111000|11  V: 201 */ 201,
-    /* 390: |11111111|11111111|11111001|  X: 394 */ 4,
-    /* 391: |11111111|11111111|11111001|0  X: 393 */ 2,
-    /* 392: |11111111|11111111|11111001|00  V: 202 */ 202,
-    /* 393: |11111111|11111111|11111001|01  V: 205 */ 205,
-    /* 394: |11111111|11111111|11111001|1  X: 396 */ 2,
-    /* 395: |11111111|11111111|11111001|10  V: 210 */ 210,
-    /* 396: |11111111|11111111|11111001|11  V: 213 */ 213,
-    /* 397: |11111111|11111111|1111101  X: 405 */ 8,
-    /* 398: |11111111|11111111|11111010|  X: 402 */ 4,
-    /* 399: |11111111|11111111|11111010|0  X: 401 */ 2,
-    /* 400: |11111111|11111111|11111010|00  V: 218 */ 218,
-    /* 401: |11111111|11111111|11111010|01  V: 219 */ 219,
-    /* 402: |11111111|11111111|11111010|1  X: 404 */ 2,
-    /* 403: |11111111|11111111|11111010|10  V: 238 */ 238,
-    /* 404: |11111111|11111111|11111010|11  V: 240 */ 240,
-    /* 405: |11111111|11111111|11111011|  X: 409 */ 4,
-    /* 406: |11111111|11111111|11111011|0  X: 408 */ 2,
-    /* 407: |11111111|11111111|11111011|00  V: 242 */ 242,
-    /* 408: |11111111|11111111|11111011|01  V: 243 */ 243,
-    /* 409: |11111111|11111111|11111011|1  X: 411 */ 2,
-    /* 410: |11111111|11111111|11111011|10  V: 255 */ 255,
-    /* 411: |11111111|11111111|11111011|11  X: 413 */ 2,
-    /* 412: |11111111|11111111|11111011|110  V: 203 */ 203,
-    /* 413: |11111111|11111111|11111011|111  V: 204 */ 204,
-    /* 414: |11111111|11111111|111111  X: 446 */ 32,
-    /* 415: |11111111|11111111|1111110  X: 431 */ 16,
-    /* 416: |11111111|11111111|11111100|  X: 424 */ 8,
-    /* 417: |11111111|11111111|11111100|0  X: 421 */ 4,
-    /* 418: |11111111|11111111|11111100|00  X: 420 */ 2,
-    /* 419: |11111111|11111111|11111100|000  V: 211 */ 211,
-    /* 420: |11111111|11111111|11111100|001  V: 212 */ 212,
-    /* 421: |11111111|11111111|11111100|01  X: 423 */ 2,
-    /* 422: |11111111|11111111|11111100|010  V: 214 */ 214,
-    /* 423: |11111111|11111111|11111100|011  V: 221 */ 221,
-    /* 424: |11111111|11111111|11111100|1  X: 428 */ 4,
-    /* 425: |11111111|11111111|11111100|10  X: 427 */ 2,
-    /* 426: |11111111|11111111|11111100|100  V: 222 */ 222,
-    /* 427: |11111111|11111111|11111100|101  V: 223 */ 223,
-    /* 428: |11111111|11111111|11111100|11  X: 430 */ 2,
-    /* 429: |11111111|11111111|11111100|110  V: 241 */ 241,
-    /* 430: |11111111|11111111|11111100|111  V: 244 */ 244,
-    /* 431: |11111111|11111111|11111101|  X: 439 */ 8,
-    /* 432: |11111111|11111111|11111101|0  X: 436 */ 4,
-    /* 433: |11111111|11111111|11111101|00  X: 435 */ 2,
-    /* 434: |11111111|11111111|11111101|000  V: 245 */ 245,
-    /* 435: |11111111|11111111|11111101|001  V: 246 */ 246,
-    /* 436: |11111111|11111111|11111101|01  X: 438 */ 2,
-    /* 437: |11111111|11111111|11111101|010  V: 247 */ 247,
-    /* 438: |11111111|11111111|11111101|011  V: 248 */ 248,
-    /* 439: |11111111|11111111|11111101|1  X: 443 */ 4,
-    /* 440: |11111111|11111111|11111101|10  X: 442 */ 2,
-    /* 441: |11111111|11111111|11111101|100  V: 250 */ 250,
-    /* 442: |11111111|11111111|11111101|101  V: 251 */ 251,
-    /* 443: |11111111|11111111|11111101|11  X: 445 */ 2,
-    /* 444: |11111111|11111111|11111101|110  V: 252 */ 252,
-    /* 445: |11111111|11111111|11111101|111  V: 253 */ 253,
-    /* 446: |11111111|11111111|1111111  X: 476 */ 30,
-    /* 447: |11111111|11111111|11111110|  X: 461 */ 14,
-    /* 448: |11111111|11111111|11111110|0  X: 454 */ 6,
-    /* 449: |11111111|11111111|11111110|00  X: 451 */ 2,
-    /* 450: |11111111|11111111|11111110|000  V: 254 */ 254,
-    /* 451: |11111111|11111111|11111110|001  X: 453 */ 2,
-    /* 452: |11111111|11111111|11111110|0010  V: 2 */ 2,
-    /* 453: |11111111|11111111|11111110|0011  V: 3 */ 3,
-    /* 454: |11111111|11111111|11111110|01  X: 458 */ 4,
-    /* 455: |11111111|11111111|11111110|010  X: 457 */ 2,
-    /* 456: |11111111|11111111|11111110|0100  V: 4 */ 4,
-    /* 457: |11111111|11111111|11111110|0101  V: 5 */ 5,
-    /* 458: |11111111|11111111|11111110|011  X: 460 */ 2,
-    /* 459: |11111111|11111111|11111110|0110  V: 6 */ 6,
-    /* 460: |11111111|11111111|11111110|0111  V: 7 */ 7,
-    /* 461: |11111111|11111111|11111110|1  X: 469 */ 8,
-    /* 462: |11111111|11111111|11111110|10  X: 466 */ 4,
-    /* 463: |11111111|11111111|11111110|100  X: 465 */ 2,
-    /* 464: |11111111|11111111|11111110|1000  V: 8 */ 8,
-    /* 465: |11111111|11111111|11111110|1001  V: 11 */ 11,
-    /* 466: |11111111|11111111|11111110|101  X: 468 */ 2,
-    /* 467: |11111111|11111111|11111110|1010  V: 12 */ 12,
-    /* 468: |11111111|11111111|11111110|1011  V: 14 */ 14,
-    /* 469: |11111111|11111111|11111110|11  X: 473 */ 4,
-    /* 470: |11111111|11111111|11111110|110  X: 472 */ 2,
-    /* 471: |11111111|11111111|11111110|1100  V: 15 */ 15,
-    /* 472: |11111111|11111111|11111110|1101  V: 16 */ 16,
-    /* 473: |11111111|11111111|11111110|111  X: 475 */ 2,
-    /* 474: |11111111|11111111|11111110|1110  V: 17 */ 17,
-    /* 475: |11111111|11111111|11111110|1111  V: 18 */ 18,
-    /* 476: |11111111|11111111|11111111|  X: 492 */ 16,
-    /* 477: |11111111|11111111|11111111|0  X: 485 */ 8,
-    /* 478: |11111111|11111111|11111111|00  X: 482 */ 4,
-    /* 479: |11111111|11111111|11111111|000  X: 481 */ 2,
-    /* 480: |11111111|11111111|11111111|0000  V: 19 */ 19,
-    /* 481: |11111111|11111111|11111111|0001  V: 20 */ 20,
-    /* 482: |11111111|11111111|11111111|001  X: 484 */ 2,
-    /* 483: |11111111|11111111|11111111|0010  V: 21 */ 21,
-    /* 484: |11111111|11111111|11111111|0011  V: 23 */ 23,
-    /* 485: |11111111|11111111|11111111|01  X: 489 */ 4,
-    /* 486: |11111111|11111111|11111111|010  X: 488 */ 2,
-    /* 487: |11111111|11111111|11111111|0100  V: 24 */ 24,
-    /* 488: |11111111|11111111|11111111|0101  V: 25 */ 25,
-    /* 489: |11111111|11111111|11111111|011  X: 491 */ 2,
-    /* 490: |11111111|11111111|11111111|0110  V: 26 */ 26,
-    /* 491: |11111111|11111111|11111111|0111  V: 27 */ 27,
-    /* 492: |11111111|11111111|11111111|1  X: 500 */ 8,
-    /* 493: |11111111|11111111|11111111|10  X: 497 */ 4,
-    /* 494: |11111111|11111111|11111111|100  X: 496 */ 2,
-    /* 495: |11111111|11111111|11111111|1000  V: 28 */ 28,
-    /* 496: |11111111|11111111|11111111|1001  V: 29 */ 29,
-    /* 497: |11111111|11111111|11111111|101  X: 499 */ 2,
-    /* 498: |11111111|11111111|11111111|1010  V: 30 */ 30,
-    /* 499: |11111111|11111111|11111111|1011  V: 31 */ 31,
-    /* 500: |11111111|11111111|11111111|11  X: 504 */ 4,
-    /* 501: |11111111|11111111|11111111|110  X: 503 */ 2,
-    /* 502: |11111111|11111111|11111111|1100  V: 127 */ 127,
-    /* 503: |11111111|11111111|11111111|1101  V: 220 */ 220,
-    /* 504: |11111111|11111111|11111111|111  X: 506 */ 2,
-    /* 505: |11111111|11111111|11111111|1110  V: 249 */ 249,
-    /* 506: |11111111|11111111|11111111|1111  X: 510 */ 4,
-    /* 507: |11111111|11111111|11111111|11110  X: 509 */ 2,
-    /* 508: |11111111|11111111|11111111|111100  V: 10 */ 10,
-    /* 509: |11111111|11111111|11111111|111101  V: 13 */ 13,
-    /* 510: |11111111|11111111|11111111|11111  X: 512 */ 2,
-    /* 511: |11111111|11111111|11111111|111110  V: 22 */ 22
+static const uint32_t h3zero_qpack_huffman_decode_table[256][16] = {
+    /* 0 */ { 0x0000f, 0x00010, 0x00011, 0x00012, 0x00013, 0x00014, 0x00015, 0x00016,
+        0x00017, 0x00018, 0x00019, 0x0001a, 0x0001b, 0x0001c, 0x0001d, 0x2001e },
+    /* 1 */ { 0x33000, 0x33100, 0x33200, 0x36100, 0x36300, 0x36500, 0x36900, 0x36f00,
+        0x37300, 0x37400, 0x0001f, 0x00020, 0x00021, 0x00022, 0x00023, 0x00024 },
+    /* 2 */ { 0x00025, 0x00026, 0x00027, 0x00028, 0x00029, 0x0002a, 0x0002b, 0x0002c,
+        0x0002d, 0x0002e, 0x0002f, 0x00030, 0x00031, 0x00032, 0x00033, 0x20034 },
+    /* 3 */ { 0x13001, 0x33002, 0x13101, 0x33102, 0x13201, 0x33202, 0x16101, 0x36102,
+        0x16301, 0x36302, 0x16501, 0x36502, 0x16901, 0x36902, 0x16f01, 0x36f02 },
+    /* 4 */ { 0x17301, 0x37302, 0x17401, 0x37402, 0x32000, 0x32500, 0x32d00, 0x32e00,
+        0x32f00, 0x33300, 0x33400, 0x33500, 0x33600, 0x33700, 0x33800, 0x33900 },
+    /* 5 */ { 0x33d00, 0x34100, 0x35f00, 0x36200, 0x36400, 0x36600, 0x36700, 0x36800,
+        0x36c00, 0x36d00, 0x36e00, 0x37000, 0x37200, 0x37500, 0x00035, 0x00036 },
+    /* 6 */ { 0x00037, 0x00038, 0x00039, 0x0003a, 0x0003b, 0x0003c, 0x0003d, 0x0003e,
+        0x0003f, 0x00040, 0x00041, 0x00042, 0x00043, 0x00044, 0x00045, 0x20046 },
+    /* 7 */ { 0x13003, 0x13004, 0x13005, 0x33006, 0x13103, 0x13104, 0x13105, 0x33106,
+        0x13203, 0x13204, 0x13205, 0x33206, 0x16103, 0x16104, 0x16105, 0x36106 },
+    /* 8 */ { 0x16303, 0x16304, 0x16305, 0x36306, 0x16503, 0x16504, 0x16505, 0x36506,
+        0x16903, 0x16904, 0x16905, 0x36906, 0x16f03, 0x16f04, 0x16f05, 0x36f06 },
+    /* 9 */ { 0x17303, 0x17304, 0x17305, 0x37306, 0x17403, 0x17404, 0x17405, 0x37406,
+        0x12001, 0x32002, 0x12501, 0x32502, 0x12d01, 0x32d02, 0x12e01, 0x32e02 },
+    /* 10 */ { 0x12f01, 0x32f02, 0x13301, 0x33302, 0x13401, 0x33402, 0x13501, 0x33502,
+        0x13601, 0x33602, 0x13701, 0x33702, 0x13801, 0x33802, 0x13901, 0x33902 },
+    /* 11 */ { 0x13d01, 0x33d02, 0x14101, 0x34102, 0x15f01, 0x35f02, 0x16201, 0x36202,
+        0x16401, 0x36402, 0x16601, 0x36602, 0x16701, 0x36702, 0x16801, 0x36802 },
+    /* 12 */ { 0x16c01, 0x36c02, 0x16d01, 0x36d02, 0x16e01, 0x36e02, 0x17001, 0x37002,
+        0x17201, 0x37202, 0x17501, 0x37502, 0x33a00, 0x34200, 0x34300, 0x34400 },
+    /* 13 */ { 0x34500, 0x34600, 0x34700, 0x34800, 0x34900, 0x34a00, 0x34b00, 0x34c00,
+        0x34d00, 0x34e00, 0x34f00, 0x35000, 0x35100, 0x35200, 0x35300, 0x35400 },
+    /* 14 */ { 0x35500, 0x35600, 0x35700, 0x35900, 0x36a00, 0x36b00, 0x37100, 0x37600,
+        0x37700, 0x37800, 0x37900, 0x37a00, 0x00047, 0x00048, 0x00049, 0x2004a },
+    /* 15 */ { 0x13007, 0x13008, 0x13009, 0x1300a, 0x1300b, 0x1300c, 0x1300d, 0x3300e,
+        0x13107, 0x13108, 0x13109, 0x1310a, 0x1310b, 0x1310c, 0x1310d, 0x3310e },
+    /* 16 */ { 0x13207, 0x13208, 0x13209, 0x1320a, 0x1320b, 0x1320c, 0x1320d, 0x3320e,
+        0x16107, 0x16108, 0x16109, 0x1610a, 0x1610b, 0x1610c, 0x1610d, 0x3610e },
+    /* 17 */ { 0x16307, 0x16308, 0x16309, 0x1630a, 0x1630b, 0x1630c, 0x1630d, 0x3630e,
+        0x16507, 0x16508, 0x16509, 0x1650a, 0x1650b, 0x1650c, 0x1650d, 0x3650e },
+    /* 18 */ { 0x16907, 0x16908, 0x16909, 0x1690a, 0x1690b, 0x1690c, 0x1690d, 0x3690e,
+        0x16f07, 0x16f08, 0x16f09, 0x16f0a, 0x16f0b, 0x16f0c, 0x16f0d, 0x36f0e },
+    /* 19 */ { 0x17307, 0x17308, 0x17309, 0x1730a, 0x1730b, 0x1730c, 0x1730d, 0x3730e,
+        0x17407, 0x17408, 0x17409, 0x1740a, 0x1740b, 0x1740c, 0x1740d, 0x3740e },
+    /* 20 */ { 0x12003, 0x12004, 0x12005, 0x32006, 0x12503, 0x12504, 0x12505, 0x32506,
+        0x12d03, 0x12d04, 0x12d05, 0x32d06, 0x12e03, 0x12e04, 0x12e05, 0x32e06 },
+    /* 21 */ { 0x12f03, 0x12f04, 0x12f05, 0x32f06, 0x13303, 0x13304, 0x13305, 0x33306,
+        0x13403, 0x13404, 0x13405, 0x33406, 0x13503, 0x13504, 0x13505, 0x33506 },
+    /* 22 */ { 0x13603, 0x13604, 0x13605, 0x33606, 0x13703, 0x13704, 0x13705, 0x33706,
+        0x13803, 0x13804, 0x13805, 0x33806, 0x13903, 0x13904, 0x13905, 0x33906 },
+    /* 23 */ { 0x13d03, 0x13d04, 0x13d05, 0x33d06, 0x14103, 0x14104, 0x14105, 0x34106,
+        0x15f03, 0x15f04, 0x15f05, 0x35f06, 0x16203, 0x16204, 0x16205, 0x36206 },
+    /* 24 */ { 0x16403, 0x16404, 0x16405, 0x36406, 0x16603, 0x16604, 0x16605, 0x36606,
+        0x16703, 0x16704, 0x16705, 0x36706, 0x16803, 0x16804, 0x16805, 0x36806 },
+    /* 25 */ { 0x16c03, 0x16c04, 0x16c05, 0x36c06, 0x16d03, 0x16d04, 0x16d05, 0x36d06,
+        0x16e03, 0x16e04, 0x16e05, 0x36e06, 0x17003, 0x17004, 0x17005, 0x37006 },
+    /* 26 */ { 0x17203, 0x17204, 0x17205, 0x37206, 0x17503, 0x17504, 0x17505, 0x37506,
+        0x13a01, 0x33a02, 0x14201, 0x34202, 0x14301, 0x34302, 0x14401, 0x34402 },
+    /* 27 */ { 0x14501, 0x34502, 0x14601, 0x34602, 0x14701, 0x34702, 0x14801, 0x34802,
+        0x14901, 0x34902, 0x14a01, 0x34a02, 0x14b01, 0x34b02, 0x14c01, 0x34c02 },
+    /* 28 */ { 0x14d01, 0x34d02, 0x14e01, 0x34e02, 0x14f01, 0x34f02, 0x15001, 0x35002,
+        0x15101, 0x35102, 0x15201, 0x35202, 0x15301, 0x35302, 0x15401, 0x35402 },
+    /* 29 */ { 0x15501, 0x35502, 0x15601, 0x35602, 0x15701, 0x35702, 0x15901, 0x35902,
+        0x16a01, 0x36a02, 0x16b01, 0x36b02, 0x17101, 0x37102, 0x17601, 0x37602 },
+    /* 30 */ { 0x17701, 0x37702, 0x17801, 0x37802, 0x17901, 0x37902, 0x17a01, 0x37a02,
+        0x32600, 0x32a00, 0x32c00, 0x33b00, 0x35800, 0x35a00, 0x0004b, 0x2004c },
+    /* 31 */ { 0x12007, 0x12008, 0x12009, 0x1200a, 0x1200b, 0x1200c, 0x1200d, 0x3200e,
+        0x12507, 0x12508, 0x12509, 0x1250a, 0x1250b, 0x1250c, 0x1250d, 0x3250e },
+    /* 32 */ { 0x12d07, 0x12d08, 0x12d09, 0x12d0a, 0x12d0b, 0x12d0c, 0x12d0d, 0x32d0e,
+        0x12e07, 0x12e08, 0x12e09, 0x12e0a, 0x12e0b, 0x12e0c, 0x12e0d, 0x32e0e },
+    /* 33 */ { 0x12f07, 0x12f08, 0x12f09, 0x12f0a, 0x12f0b, 0x12f0c, 0x12f0d, 0x32f0e,
+        0x13307, 0x13308, 0x13309, 0x1330a, 0x1330b, 0x1330c, 0x1330d, 0x3330e },
+    /* 34 */ { 0x13407, 0x13408, 0x13409, 0x1340a, 0x1340b, 0x1340c, 0x1340d, 0x3340e,
+        0x13507, 0x13508, 0x13509, 0x1350a, 0x1350b, 0x1350c, 0x1350d, 0x3350e },
+    /* 35 */ { 0x13607, 0x13608, 0x13609, 0x1360a, 0x1360b, 0x1360c, 0x1360d, 0x3360e,
+        0x13707, 0x13708, 0x13709, 0x1370a, 0x1370b, 0x1370c, 0x1370d, 0x3370e },
+    /* 36 */ { 0x13807, 0x13808, 0x13809, 0x1380a, 0x1380b, 0x1380c, 0x1380d, 0x3380e,
+        0x13907, 0x13908, 0x13909, 0x1390a, 0x1390b, 0x1390c, 0x1390d, 0x3390e },
+    /* 37 */ { 0x13d07, 0x13d08, 0x13d09, 0x13d0a, 0x13d0b, 0x13d0c, 0x13d0d, 0x33d0e,
+        0x14107, 0x14108, 0x14109, 0x1410a, 0x1410b, 0x1410c, 0x1410d, 0x3410e },
+    /* 38 */ { 0x15f07, 0x15f08, 0x15f09, 0x15f0a, 0x15f0b, 0x15f0c, 0x15f0d, 0x35f0e,
+        0x16207, 0x16208, 0x16209, 0x1620a, 0x1620b, 0x1620c, 0x1620d, 0x3620e },
+    /* 39 */ { 0x16407, 0x16408, 0x16409, 0x1640a, 0x1640b, 0x1640c, 0x1640d, 0x3640e,
+        0x16607, 0x16608, 0x16609, 0x1660a, 0x1660b, 0x1660c, 0x1660d, 0x3660e },
+    /* 40 */ { 0x16707, 0x16708, 0x16709, 0x1670a, 0x1670b, 0x1670c, 0x1670d, 0x3670e,
+        0x16807, 0x16808, 0x16809, 0x1680a, 0x1680b, 0x1680c, 0x1680d, 0x3680e },
+    /* 41 */ { 0x16c07, 0x16c08, 0x16c09, 0x16c0a, 0x16c0b, 0x16c0c, 0x16c0d, 0x36c0e,
+        0x16d07, 0x16d08, 0x16d09, 0x16d0a, 0x16d0b, 0x16d0c, 0x16d0d, 0x36d0e },
+    /* 42 */ { 0x16e07, 0x16e08, 0x16e09, 0x16e0a, 0x16e0b, 0x16e0c, 0x16e0d, 0x36e0e,
+        0x17007, 0x17008, 0x17009, 0x1700a, 0x1700b, 0x1700c, 0x1700d, 0x3700e },
+    /* 43 */ { 0x17207, 0x17208, 0x17209, 0x1720a, 0x1720b, 0x1720c, 0x1720d, 0x3720e,
+        0x17507, 0x17508, 0x17509, 0x1750a, 0x1750b, 0x1750c, 0x1750d, 0x3750e },
+    /* 44 */ { 0x13a03, 0x13a04, 0x13a05, 0x33a06, 0x14203, 0x14204, 0x14205, 0x34206,
+        0x14303, 0x14304, 0x14305, 0x34306, 0x14403, 0x14404, 0x14405, 0x34406 },
+    /* 45 */ { 0x14503, 0x14504, 0x14505, 0x34506, 0x14603, 0x14604, 0x14605, 0x34606,
+        0x14703, 0x14704, 0x14705, 0x34706, 0x14803, 0x14804, 0x14805, 0x34806 },
+    /* 46 */ { 0x14903, 0x14904, 0x14905, 0x34906, 0x14a03, 0x14a04, 0x14a05, 0x34a06,
+        0x14b03, 0x14b04, 0x14b05, 0x34b06, 0x14c03, 0x14c04, 0x14c05, 0x34c06 },
+    /* 47 */ { 0x14d03, 0x14d04, 0x14d05, 0x34d06, 0x14e03, 0x14e04, 0x14e05, 0x34e06,
+        0x14f03, 0x14f04, 0x14f05, 0x34f06, 0x15003, 0x15004, 0x15005, 0x35006 },
+    /* 48 */ { 0x15103, 0x15104, 0x15105, 0x35106, 0x15203, 0x15204, 0x15205, 0x35206,
+        0x15303, 0x15304, 0x15305, 0x35306, 0x15403, 0x15404, 0x15405, 0x35406 },
+    /* 49 */ { 0x15503, 0x15504, 0x15505, 0x35506, 0x15603, 0x15604, 0x15605, 0x35606,
+        0x15703, 0x15704, 0x15705, 0x35706, 0x15903, 0x15904, 0x15905, 0x35906 },
+    /* 50 */ { 0x16a03, 0x16a04, 0x16a05, 0x36a06, 0x16b03, 0x16b04, 0x16b05, 0x36b06,
+        0x17103, 0x17104, 0x17105, 0x37106, 0x17603, 0x17604, 0x17605, 0x37606 },
+    /* 51 */ { 0x17703, 0x17704, 0x17705, 0x37706, 0x17803, 0x17804, 0x17805, 0x37806,
+        0x17903, 0x17904, 0x17905, 0x37906, 0x17a03, 0x17a04, 0x17a05, 0x37a06 },
+    /* 52 */ { 0x12601, 0x32602, 0x12a01, 0x32a02, 0x12c01, 0x32c02, 0x13b01, 0x33b02,
+        0x15801, 0x35802, 0x15a01, 0x35a02, 0x0004d, 0x0004e, 0x0004f, 0x20050 },
+    /* 53 */ { 0x13a07, 0x13a08, 0x13a09, 0x13a0a, 0x13a0b, 0x13a0c, 0x13a0d, 0x33a0e,
+        0x14207, 0x14208, 0x14209, 0x1420a, 0x1420b, 0x1420c, 0x1420d, 0x3420e },
+    /* 54 */ { 0x14307, 0x14308, 0x14309, 0x1430a, 0x1430b, 0x1430c, 0x1430d, 0x3430e,
+        0x14407, 0x14408, 0x14409, 0x1440a, 0x1440b, 0x1440c, 0x1440d, 0x3440e },
+    /* 55 */ { 0x14507, 0x14508, 0x14509, 0x1450a, 0x1450b, 0x1450c, 0x1450d, 0x3450e,
+        0x14607, 0x14608, 0x14609, 0x1460a, 0x1460b, 0x1460c, 0x1460d, 0x3460e },
+    /* 56 */ { 0x14707, 0x14708, 0x14709, 0x1470a, 0x1470b, 0x1470c, 0x1470d, 0x3470e,
+        0x14807, 0x14808, 0x14809, 0x1480a, 0x1480b, 0x1480c, 0x1480d, 0x3480e },
+    /* 57 */ { 0x14907, 0x14908, 0x14909, 0x1490a, 0x1490b, 0x1490c, 0x1490d, 0x3490e,
+        0x14a07, 0x14a08, 0x14a09, 0x14a0a, 0x14a0b, 0x14a0c, 0x14a0d, 0x34a0e },
+    /* 58 */ { 0x14b07, 0x14b08, 0x14b09, 0x14b0a, 0x14b0b, 0x14b0c, 0x14b0d, 0x34b0e,
+        0x14c07, 0x14c08, 0x14c09, 0x14c0a, 0x14c0b, 0x14c0c, 0x14c0d, 0x34c0e },
+    /* 59 */ { 0x14d07, 0x14d08, 0x14d09, 0x14d0a, 0x14d0b, 0x14d0c, 0x14d0d, 0x34d0e,
+        0x14e07, 0x14e08, 0x14e09, 0x14e0a, 0x14e0b, 0x14e0c, 0x14e0d, 0x34e0e },
+    /* 60 */ { 0x14f07, 0x14f08, 0x14f09, 0x14f0a, 0x14f0b, 0x14f0c, 0x14f0d, 0x34f0e,
+        0x15007, 0x15008, 0x15009, 0x1500a, 0x1500b, 0x1500c, 0x1500d, 0x3500e },
+    /* 61 */ { 0x15107, 0x15108, 0x15109, 0x1510a, 0x1510b, 0x1510c, 0x1510d, 0x3510e,
+        0x15207, 0x15208, 0x15209, 0x1520a, 0x1520b, 0x1520c, 0x1520d, 0x3520e },
+    /* 62 */ { 0x15307, 0x15308, 0x15309, 0x1530a, 0x1530b, 0x1530c, 0x1530d, 0x3530e,
+        0x15407, 0x15408, 0x15409, 0x1540a, 0x1540b, 0x1540c, 0x1540d, 0x3540e },
+    /* 63 */ { 0x15507, 0x15508, 0x15509, 0x1550a, 0x1550b, 0x1550c, 0x1550d, 0x3550e,
+        0x15607, 0x15608, 0x15609, 0x1560a, 0x1560b, 0x1560c, 0x1560d, 0x3560e },
+    /* 64 */ { 0x15707, 0x15708, 0x15709, 0x1570a, 0x1570b, 0x1570c, 0x1570d, 0x3570e,
+        0x15907, 0x15908, 0x15909, 0x1590a, 0x1590b, 0x1590c, 0x1590d, 0x3590e },
+    /* 65 */ { 0x16a07, 0x16a08, 0x16a09, 0x16a0a, 0x16a0b, 0x16a0c, 0x16a0d, 0x36a0e,
+        0x16b07, 0x16b08, 0x16b09, 0x16b0a, 0x16b0b, 0x16b0c, 0x16b0d, 0x36b0e },
+    /* 66 */ { 0x17107, 0x17108, 0x17109, 0x1710a, 0x1710b, 0x1710c, 0x1710d, 0x3710e,
+        0x17607, 0x17608, 0x17609, 0x1760a, 0x1760b, 0x1760c, 0x1760d, 0x3760e },
+    /* 67 */ { 0x17707, 0x17708, 0x17709, 0x1770a, 0x1770b, 0x1770c, 0x1770d, 0x3770e,
+        0x17807, 0x17808, 0x17809, 0x1780a, 0x1780b, 0x1780c, 0x1780d, 0x3780e },
+    /* 68 */ { 0x17907, 0x17908, 0x17909, 0x1790a, 0x1790b, 0x1790c, 0x1790d, 0x3790e,
+        0x17a07, 0x17a08, 0x17a09, 0x17a0a, 0x17a0b, 0x17a0c, 0x17a0d, 0x37a0e },
+    /* 69 */ { 0x12603, 0x12604, 0x12605, 0x32606, 0x12a03, 0x12a04, 0x12a05, 0x32a06,
+        0x12c03, 0x12c04, 0x12c05, 0x32c06, 0x13b03, 0x13b04, 0x13b05, 0x33b06 },
+    /* 70 */ { 0x15803, 0x15804, 0x15805, 0x35806, 0x15a03, 0x15a04, 0x15a05, 0x35a06,
+        0x32100, 0x32200, 0x32800, 0x32900, 0x33f00, 0x00051, 0x00052, 0x20053 },
+    /* 71 */ { 0x12607, 0x12608, 0x12609, 0x1260a, 0x1260b, 0x1260c, 0x1260d, 0x3260e,
+        0x12a07, 0x12a08, 0x12a09, 0x12a0a, 0x12a0b, 0x12a0c, 0x12a0d, 0x32a0e },
+    /* 72 */ { 0x12c07, 0x12c08, 0x12c09, 0x12c0a, 0x12c0b, 0x12c0c, 0x12c0d, 0x32c0e,
+        0x13b07, 0x13b08, 0x13b09, 0x13b0a, 0x13b0b, 0x13b0c, 0x13b0d, 0x33b0e },
+    /* 73 */ { 0x15807, 0x15808, 0x15809, 0x1580a, 0x1580b, 0x1580c, 0x1580d, 0x3580e,
+        0x15a07, 0x15a08, 0x15a09, 0x15a0a, 0x15a0b, 0x15a0c, 0x15a0d, 0x35a0e },
+    /* 74 */ { 0x12101, 0x32102, 0x12201, 0x32202, 0x12801, 0x32802, 0x12901, 0x32902,
+        0x13f01, 0x33f02, 0x32700, 0x32b00, 0x37c00, 0x00054, 0x00055, 0x20056 },
+    /* 75 */ { 0x12103, 0x12104, 0x12105, 0x32106, 0x12203, 0x12204, 0x12205, 0x32206,
+        0x12803, 0x12804, 0x12805, 0x32806, 0x12903, 0x12904, 0x12905, 0x32906 },
+    /* 76 */ { 0x13f03, 0x13f04, 0x13f05, 0x33f06, 0x12701, 0x32702, 0x12b01, 0x32b02,
+        0x17c01, 0x37c02, 0x32300, 0x33e00, 0x00057, 0x00058, 0x00059, 0x2005a },
+    /* 77 */ { 0x12107, 0x12108, 0x12109, 0x1210a, 0x1210b, 0x1210c, 0x1210d, 0x3210e,
+        0x12207, 0x12208, 0x12209, 0x1220a, 0x1220b, 0x1220c, 0x1220d, 0x3220e },
+    /* 78 */ { 0x12807, 0x12808, 0x12809, 0x1280a, 0x1280b, 0x1280c, 0x1280d, 0x3280e,
+        0x12907, 0x12908, 0x12909, 0x1290a, 0x1290b, 0x1290c, 0x1290d, 0x3290e },
+    /* 79 */ { 0x13f07, 0x13f08, 0x13f09, 0x13f0a, 0x13f0b, 0x13f0c, 0x13f0d, 0x33f0e,
+        0x12703, 0x12704, 0x12705, 0x32706, 0x12b03, 0x12b04, 0x12b05, 0x32b06 },
+    /* 80 */ { 0x17c03, 0x17c04, 0x17c05, 0x37c06, 0x12301, 0x32302, 0x13e01, 0x33e02,
+        0x30000, 0x32400, 0x34000, 0x35b00, 0x35d00, 0x37e00, 0x0005b, 0x2005c },
+    /* 81 */ { 0x12707, 0x12708, 0x12709, 0x1270a, 0x1270b, 0x1270c, 0x1270d, 0x3270e,
+        0x12b07, 0x12b08, 0x12b09, 0x12b0a, 0x12b0b, 0x12b0c, 0x12b0d, 0x32b0e },
+    /* 82 */ { 0x17c07, 0x17c08, 0x17c09, 0x17c0a, 0x17c0b, 0x17c0c, 0x17c0d, 0x37c0e,
+        0x12303, 0x12304, 0x12305, 0x32306, 0x13e03, 0x13e04, 0x13e05, 0x33e06 },
+    /* 83 */ { 0x10001, 0x30002, 0x12401, 0x32402, 0x14001, 0x34002, 0x15b01, 0x35b02,
+        0x15d01, 0x35d02, 0x17e01, 0x37e02, 0x35e00, 0x37d00, 0x0005d, 0x2005e },
+    /* 84 */ { 0x12307, 0x12308, 0x12309, 0x1230a, 0x1230b, 0x1230c, 0x1230d, 0x3230e,
+        0x13e07, 0x13e08, 0x13e09, 0x13e0a, 0x13e0b, 0x13e0c, 0x13e0d, 0x33e0e },
+    /* 85 */ { 0x10003, 0x10004, 0x10005, 0x30006, 0x12403, 0x12404, 0x12405, 0x32406,
+        0x14003, 0x14004, 0x14005, 0x34006, 0x15b03, 0x15b04, 0x15b05, 0x35b06 },
+    /* 86 */ { 0x15d03, 0x15d04, 0x15d05, 0x35d06, 0x17e03, 0x17e04, 0x17e05, 0x37e06,
+        0x15e01, 0x35e02, 0x17d01, 0x37d02, 0x33c00, 0x36000, 0x37b00, 0x2005f },
+    /* 87 */ { 0x10007, 0x10008, 0x10009, 0x1000a, 0x1000b, 0x1000c, 0x1000d, 0x3000e,
+        0x12407, 0x12408, 0x12409, 0x1240a, 0x1240b, 0x1240c, 0x1240d, 0x3240e },
+    /* 88 */ { 0x14007, 0x14008, 0x14009, 0x1400a, 0x1400b, 0x1400c, 0x1400d, 0x3400e,
+        0x15b07, 0x15b08, 0x15b09, 0x15b0a, 0x15b0b, 0x15b0c, 0x15b0d, 0x35b0e },
+    /* 89 */ { 0x15d07, 0x15d08, 0x15d09, 0x15d0a, 0x15d0b, 0x15d0c, 0x15d0d, 0x35d0e,
+        0x17e07, 0x17e08, 0x17e09, 0x17e0a, 0x17e0b, 0x17e0c, 0x17e0d, 0x37e0e },
+    /* 90 */ { 0x15e03, 0x15e04, 0x15e05, 0x35e06, 0x17d03, 0x17d04, 0x17d05, 0x37d06,
+        0x13c01, 0x33c02, 0x16001, 0x36002, 0x17b01, 0x37b02, 0x00060, 0x20061 },
+    /* 91 */ { 0x15e07, 0x15e08, 0x15e09, 0x15e0a, 0x15e0b, 0x15e0c, 0x15e0d, 0x35e0e,
+        0x17d07, 0x17d08, 0x17d09, 0x17d0a, 0x17d0b, 0x17d0c, 0x17d0d, 0x37d0e },
+    /* 92 */ { 0x13c03, 0x13c04, 0x13c05, 0x33c06, 0x16003, 0x16004, 0x16005, 0x36006,
+        0x17b03, 0x17b04, 0x17b05, 0x37b06, 0x00062, 0x00063, 0x00064, 0x20065 },
+    /* 93 */ { 0x13c07, 0x13c08, 0x13c09, 0x13c0a, 0x13c0b, 0x13c0c, 0x13c0d, 0x33c0e,
+        0x16007, 0x16008, 0x16009, 0x1600a, 0x1600b, 0x1600c, 0x1600d, 0x3600e },
+    /* 94 */ { 0x17b07, 0x17b08, 0x17b09, 0x17b0a, 0x17b0b, 0x17b0c, 0x17b0d, 0x37b0e,
+        0x00066, 0x00067, 0x00068, 0x00069, 0x0006a, 0x0006b, 0x0006c, 0x2006d },
+    /* 95 */ { 0x35c00, 0x3c300, 0x3d000, 0x0006e, 0x0006f, 0x00070, 0x00071, 0x00072,
+        0x00073, 0x00074, 0x00075, 0x00076, 0x00077, 0x00078, 0x00079, 0x2007a },
+    /* 96 */ { 0x15c01, 0x35c02, 0x1c301, 0x3c302, 0x1d001, 0x3d002, 0x38000, 0x38200,
+        0x38300, 0x3a200, 0x3b800, 0x3c200, 0x3e000, 0x3e200, 0x0007b, 0x0007c },
+    /* 97 */ { 0x0007d, 0x0007e, 0x0007f, 0x00080, 0x00081, 0x00082, 0x00083, 0x00084,
+        0x00085, 0x00086, 0x00087, 0x00088, 0x00089, 0x0008a, 0x0008b, 0x2008c },
+    /* 98 */ { 0x15c03, 0x15c04, 0x15c05, 0x35c06, 0x1c303, 0x1c304, 0x1c305, 0x3c306,
+        0x1d003, 0x1d004, 0x1d005, 0x3d006, 0x18001, 0x38002, 0x18201, 0x38202 },
+    /* 99 */ { 0x18301, 0x38302, 0x1a201, 0x3a202, 0x1b801, 0x3b802, 0x1c201, 0x3c202,
+        0x1e001, 0x3e002, 0x1e201, 0x3e202, 0x39900, 0x3a100, 0x3a700, 0x3ac00 },
+    /* 100 */ { 0x3b000, 0x3b100, 0x3b300, 0x3d100, 0x3d800, 0x3d900, 0x3e300, 0x3e500,
+        0x3e600, 0x0008d, 0x0008e, 0x0008f, 0x00090, 0x00091, 0x00092, 0x00093 },
+    /* 101 */ { 0x00094, 0x00095, 0x00096, 0x00097, 0x00098, 0x00099, 0x0009a, 0x0009b,
+        0x0009c, 0x0009d, 0x0009e, 0x0009f, 0x000a0, 0x000a1, 0x000a2, 0x200a3 },
+    /* 102 */ { 0x15c07, 0x15c08, 0x15c09, 0x15c0a, 0x15c0b, 0x15c0c, 0x15c0d, 0x35c0e,
+        0x1c307, 0x1c308, 0x1c309, 0x1c30a, 0x1c30b, 0x1c30c, 0x1c30d, 0x3c30e },
+    /* 103 */ { 0x1d007, 0x1d008, 0x1d009, 0x1d00a, 0x1d00b, 0x1d00c, 0x1d00d, 0x3d00e,
+        0x18003, 0x18004, 0x18005, 0x38006, 0x18203, 0x18204, 0x18205, 0x38206 },
+    /* 104 */ { 0x18303, 0x18304, 0x18305, 0x38306, 0x1a203, 0x1a204, 0x1a205, 0x3a206,
+        0x1b803, 0x1b804, 0x1b805, 0x3b806, 0x1c203, 0x1c204, 0x1c205, 0x3c206 },
+    /* 105 */ { 0x1e003, 0x1e004, 0x1e005, 0x3e006, 0x1e203, 0x1e204, 0x1e205, 0x3e206,
+        0x19901, 0x39902, 0x1a101, 0x3a102, 0x1a701, 0x3a702, 0x1ac01, 0x3ac02 },
+    /* 106 */ { 0x1b001, 0x3b002, 0x1b101, 0x3b102, 0x1b301, 0x3b302, 0x1d101, 0x3d102,
+        0x1d801, 0x3d802, 0x1d901, 0x3d902, 0x1e301, 0x3e302, 0x1e501, 0x3e502 },
+    /* 107 */ { 0x1e601, 0x3e602, 0x38100, 0x38400, 0x38500, 0x38600, 0x38800, 0x39200,
+        0x39a00, 0x39c00, 0x3a000, 0x3a300, 0x3a400, 0x3a900, 0x3aa00, 0x3ad00 },
+    /* 108 */ { 0x3b200, 0x3b500, 0x3b900, 0x3ba00, 0x3bb00, 0x3bd00, 0x3be00, 0x3c400,
+        0x3c600, 0x3e400, 0x3e800, 0x3e900, 0x000a4, 0x000a5, 0x000a6, 0x000a7 },
+    /* 109 */ { 0x000a8, 0x000a9, 0x000aa, 0x000ab, 0x000ac, 0x000ad, 0x000ae, 0x000af,
+        0x000b0, 0x000b1, 0x000b2, 0x000b3, 0x000b4, 0x000b5, 0x000b6, 0x200b7 },
+    /* 110 */ { 0x18007, 0x18008, 0x18009, 0x1800a, 0x1800b, 0x1800c, 0x1800d, 0x3800e,
+        0x18207, 0x18208, 0x18209, 0x1820a, 0x1820b, 0x1820c, 0x1820d, 0x3820e },
+    /* 111 */ { 0x18307, 0x18308, 0x18309, 0x1830a, 0x1830b, 0x1830c, 0x1830d, 0x3830e,
+        0x1a207, 0x1a208, 0x1a209, 0x1a20a, 0x1a20b, 0x1a20c, 0x1a20d, 0x3a20e },
+    /* 112 */ { 0x1b807, 0x1b808, 0x1b809, 0x1b80a, 0x1b80b, 0x1b80c, 0x1b80d, 0x3b80e,
+        0x1c207, 0x1c208, 0x1c209, 0x1c20a, 0x1c20b, 0x1c20c, 0x1c20d, 0x3c20e },
+    /* 113 */ { 0x1e007, 0x1e008, 0x1e009, 0x1e00a, 0x1e00b, 0x1e00c, 0x1e00d, 0x3e00e,
+        0x1e207, 0x1e208, 0x1e209, 0x1e20a, 0x1e20b, 0x1e20c, 0x1e20d, 0x3e20e },
+    /* 114 */ { 0x19903, 0x19904, 0x19905, 0x39906, 0x1a103, 0x1a104, 0x1a105, 0x3a106,
+        0x1a703, 0x1a704, 0x1a705, 0x3a706, 0x1ac03, 0x1ac04, 0x1ac05, 0x3ac06 },
+    /* 115 */ { 0x1b003, 0x1b004, 0x1b005, 0x3b006, 0x1b103, 0x1b104, 0x1b105, 0x3b106,
+        0x1b303, 0x1b304, 0x1b305, 0x3b306, 0x1d103, 0x1d104, 0x1d105, 0x3d106 },
+    /* 116 */ { 0x1d803, 0x1d804, 0x1d805, 0x3d806, 0x1d903, 0x1d904, 0x1d905, 0x3d906,
+        0x1e303, 0x1e304, 0x1e305, 0x3e306, 0x1e503, 0x1e504, 0x1e505, 0x3e506 },
+    /* 117 */ { 0x1e603, 0x1e604, 0x1e605, 0x3e606, 0x18101, 0x38102, 0x18401, 0x38402,
+        0x18501, 0x38502, 0x18601, 0x38602, 0x18801, 0x38802, 0x19201, 0x39202 },
+    /* 118 */ { 0x19a01, 0x39a02, 0x19c01, 0x39c02, 0x1a001, 0x3a002, 0x1a301, 0x3a302,
+        0x1a401, 0x3a402, 0x1a901, 0x3a902, 0x1aa01, 0x3aa02, 0x1ad01, 0x3ad02 },
+    /* 119 */ { 0x1b201, 0x3b202, 0x1b501, 0x3b502, 0x1b901, 0x3b902, 0x1ba01, 0x3ba02,
+        0x1bb01, 0x3bb02, 0x1bd01, 0x3bd02, 0x1be01, 0x3be02, 0x1c401, 0x3c402 },
+    /* 120 */ { 0x1c601, 0x3c602, 0x1e401, 0x3e402, 0x1e801, 0x3e802, 0x1e901, 0x3e902,
+        0x30100, 0x38700, 0x38900, 0x38a00, 0x38b00, 0x38c00, 0x38d00, 0x38f00 },
+    /* 121 */ { 0x39300, 0x39500, 0x39600, 0x39700, 0x39800, 0x39b00, 0x39d00, 0x39e00,
+        0x3a500, 0x3a600, 0x3a800, 0x3ae00, 0x3af00, 0x3b400, 0x3b600, 0x3b700 },
+    /* 122 */ { 0x3bc00, 0x3bf00, 0x3c500, 0x3e700, 0x3ef00, 0x000b8, 0x000b9, 0x000ba,
+        0x000bb, 0x000bc, 0x000bd, 0x000be, 0x000bf, 0x000c0, 0x000c1, 0x200c2 },
+    /* 123 */ { 0x19907, 0x19908, 0x19909, 0x1990a, 0x1990b, 0x1990c, 0x1990d, 0x3990e,
+        0x1a107, 0x1a108, 0x1a109, 0x1a10a, 0x1a10b, 0x1a10c, 0x1a10d, 0x3a10e },
+    /* 124 */ { 0x1a707, 0x1a708, 0x1a709, 0x1a70a, 0x1a70b, 0x1a70c, 0x1a70d, 0x3a70e,
+        0x1ac07, 0x1ac08, 0x1ac09, 0x1ac0a, 0x1ac0b, 0x1ac0c, 0x1ac0d, 0x3ac0e },
+    /* 125 */ { 0x1b007, 0x1b008, 0x1b009, 0x1b00a, 0x1b00b, 0x1b00c, 0x1b00d, 0x3b00e,
+        0x1b107, 0x1b108, 0x1b109, 0x1b10a, 0x1b10b, 0x1b10c, 0x1b10d, 0x3b10e },
+    /* 126 */ { 0x1b307, 0x1b308, 0x1b309, 0x1b30a, 0x1b30b, 0x1b30c, 0x1b30d, 0x3b30e,
+        0x1d107, 0x1d108, 0x1d109, 0x1d10a, 0x1d10b, 0x1d10c, 0x1d10d, 0x3d10e },
+    /* 127 */ { 0x1d807, 0x1d808, 0x1d809, 0x1d80a, 0x1d80b, 0x1d80c, 0x1d80d, 0x3d80e,
+        0x1d907, 0x1d908, 0x1d909, 0x1d90a, 0x1d90b, 0x1d90c, 0x1d90d, 0x3d90e },
+    /* 128 */ { 0x1e307, 0x1e308, 0x1e309, 0x1e30a, 0x1e30b, 0x1e30c, 0x1e30d, 0x3e30e,
+        0x1e507, 0x1e508, 0x1e509, 0x1e50a, 0x1e50b, 0x1e50c, 0x1e50d, 0x3e50e },
+    /* 129 */ { 0x1e607, 0x1e608, 0x1e609, 0x1e60a, 0x1e60b, 0x1e60c, 0x1e60d, 0x3e60e,
+        0x18103, 0x18104, 0x18105, 0x38106, 0x18403, 0x18404, 0x18405, 0x38406 },
+    /* 130 */ { 0x18503, 0x18504, 0x18505, 0x38506, 0x18603, 0x18604, 0x18605, 0x38606,
+        0x18803, 0x18804, 0x18805, 0x38806, 0x19203, 0x19204, 0x19205, 0x39206 },
+    /* 131 */ { 0x19a03, 0x19a04, 0x19a05, 0x39a06, 0x19c03, 0x19c04, 0x19c05, 0x39c06,
+        0x1a003, 0x1a004, 0x1a005, 0x3a006, 0x1a303, 0x1a304, 0x1a305, 0x3a306 },
+    /* 132 */ { 0x1a403, 0x1a404, 0x1a405, 0x3a406, 0x1a903, 0x1a904, 0x1a905, 0x3a906,
+        0x1aa03, 0x1aa04, 0x1aa05, 0x3aa06, 0x1ad03, 0x1ad04, 0x1ad05, 0x3ad06 },
+    /* 133 */ { 0x1b203, 0x1b204, 0x1b205, 0x3b206, 0x1b503, 0x1b504, 0x1b505, 0x3b506,
+        0x1b903, 0x1b904, 0x1b905, 0x3b906, 0x1ba03, 0x1ba04, 0x1ba05, 0x3ba06 },
+    /* 134 */ { 0x1bb03, 0x1bb04, 0x1bb05, 0x3bb06, 0x1bd03, 0x1bd04, 0x1bd05, 0x3bd06,
+        0x1be03, 0x1be04, 0x1be05, 0x3be06, 0x1c403, 0x1c404, 0x1c405, 0x3c406 },
+    /* 135 */ { 0x1c603, 0x1c604, 0x1c605, 0x3c606, 0x1e403, 0x1e404, 0x1e405, 0x3e406,
+        0x1e803, 0x1e804, 0x1e805, 0x3e806, 0x1e903, 0x1e904, 0x1e905, 0x3e906 },
+    /* 136 */ { 0x10101, 0x30102, 0x18701, 0x38702, 0x18901, 0x38902, 0x18a01, 0x38a02,
+        0x18b01, 0x38b02, 0x18c01, 0x38c02, 0x18d01, 0x38d02, 0x18f01, 0x38f02 },
+    /* 137 */ { 0x19301, 0x39302, 0x19501, 0x39502, 0x19601, 0x39602, 0x19701, 0x39702,
+        0x19801, 0x39802, 0x19b01, 0x39b02, 0x19d01, 0x39d02, 0x19e01, 0x39e02 },
+    /* 138 */ { 0x1a501, 0x3a502, 0x1a601, 0x3a602, 0x1a801, 0x3a802, 0x1ae01, 0x3ae02,
+        0x1af01, 0x3af02, 0x1b401, 0x3b402, 0x1b601, 0x3b602, 0x1b701, 0x3b702 },
+    /* 139 */ { 0x1bc01, 0x3bc02, 0x1bf01, 0x3bf02, 0x1c501, 0x3c502, 0x1e701, 0x3e702,
+        0x1ef01, 0x3ef02, 0x30900, 0x38e00, 0x39000, 0x39100, 0x39400, 0x39f00 },
+    /* 140 */ { 0x3ab00, 0x3ce00, 0x3d700, 0x3e100, 0x3ec00, 0x3ed00, 0x000c3, 0x000c4,
+        0x000c5, 0x000c6, 0x000c7, 0x000c8, 0x000c9, 0x000ca, 0x000cb, 0x200cc },
+    /* 141 */ { 0x18107, 0x18108, 0x18109, 0x1810a, 0x1810b, 0x1810c, 0x1810d, 0x3810e,
+        0x18407, 0x18408, 0x18409, 0x1840a, 0x1840b, 0x1840c, 0x1840d, 0x3840e },
+    /* 142 */ { 0x18507, 0x18508, 0x18509, 0x1850a, 0x1850b, 0x1850c, 0x1850d, 0x3850e,
+        0x18607, 0x18608, 0x18609, 0x1860a, 0x1860b, 0x1860c, 0x1860d, 0x3860e },
+    /* 143 */ { 0x18807, 0x18808, 0x18809, 0x1880a, 0x1880b, 0x1880c, 0x1880d, 0x3880e,
+        0x19207, 0x19208, 0x19209, 0x1920a, 0x1920b, 0x1920c, 0x1920d, 0x3920e },
+    /* 144 */ { 0x19a07, 0x19a08, 0x19a09, 0x19a0a, 0x19a0b, 0x19a0c, 0x19a0d, 0x39a0e,
+        0x19c07, 0x19c08, 0x19c09, 0x19c0a, 0x19c0b, 0x19c0c, 0x19c0d, 0x39c0e },
+    /* 145 */ { 0x1a007, 0x1a008, 0x1a009, 0x1a00a, 0x1a00b, 0x1a00c, 0x1a00d, 0x3a00e,
+        0x1a307, 0x1a308, 0x1a309, 0x1a30a, 0x1a30b, 0x1a30c, 0x1a30d, 0x3a30e },
+    /* 146 */ { 0x1a407, 0x1a408, 0x1a409, 0x1a40a, 0x1a40b, 0x1a40c, 0x1a40d, 0x3a40e,
+        0x1a907, 0x1a908, 0x1a909, 0x1a90a, 0x1a90b, 0x1a90c, 0x1a90d, 0x3a90e },
+    /* 147 */ { 0x1aa07, 0x1aa08, 0x1aa09, 0x1aa0a, 0x1aa0b, 0x1aa0c, 0x1aa0d, 0x3aa0e,
+        0x1ad07, 0x1ad08, 0x1ad09, 0x1ad0a, 0x1ad0b, 0x1ad0c, 0x1ad0d, 0x3ad0e },
+    /* 148 */ { 0x1b207, 0x1b208, 0x1b209, 0x1b20a, 0x1b20b, 0x1b20c, 0x1b20d, 0x3b20e,
+        0x1b507, 0x1b508, 0x1b509, 0x1b50a, 0x1b50b, 0x1b50c, 0x1b50d, 0x3b50e },
+    /* 149 */ { 0x1b907, 0x1b908, 0x1b909, 0x1b90a, 0x1b90b, 0x1b90c, 0x1b90d, 0x3b90e,
+        0x1ba07, 0x1ba08, 0x1ba09, 0x1ba0a, 0x1ba0b, 0x1ba0c, 0x1ba0d, 0x3ba0e },
+    /* 150 */ { 0x1bb07, 0x1bb08, 0x1bb09, 0x1bb0a, 0x1bb0b, 0x1bb0c, 0x1bb0d, 0x3bb0e,
+        0x1bd07, 0x1bd08, 0x1bd09, 0x1bd0a, 0x1bd0b, 0x1bd0c, 0x1bd0d, 0x3bd0e },
+    /* 151 */ { 0x1be07, 0x1be08, 0x1be09, 0x1be0a, 0x1be0b, 0x1be0c, 0x1be0d, 0x3be0e,
+        0x1c407, 0x1c408, 0x1c409, 0x1c40a, 0x1c40b, 0x1c40c, 0x1c40d, 0x3c40e },
+    /* 152 */ { 0x1c607, 0x1c608, 0x1c609, 0x1c60a, 0x1c60b, 0x1c60c, 0x1c60d, 0x3c60e,
+        0x1e407, 0x1e408, 0x1e409, 0x1e40a, 0x1e40b, 0x1e40c, 0x1e40d, 0x3e40e },
+    /* 153 */ { 0x1e807, 0x1e808, 0x1e809, 0x1e80a, 0x1e80b, 0x1e80c, 0x1e80d, 0x3e80e,
+        0x1e907, 0x1e908, 0x1e909, 0x1e90a, 0x1e90b, 0x1e90c, 0x1e90d, 0x3e90e },
+    /* 154 */ { 0x10103, 0x10104, 0x10105, 0x30106, 0x18703, 0x18704, 0x18705, 0x38706,
+        0x18903, 0x18904, 0x18905, 0x38906, 0x18a03, 0x18a04, 0x18a05, 0x38a06 },
+    /* 155 */ { 0x18b03, 0x18b04, 0x18b05, 0x38b06, 0x18c03, 0x18c04, 0x18c05, 0x38c06,
+        0x18d03, 0x18d04, 0x18d05, 0x38d06, 0x18f03, 0x18f04, 0x18f05, 0x38f06 },
+    /* 156 */ { 0x19303, 0x19304, 0x19305, 0x39306, 0x19503, 0x19504, 0x19505, 0x39506,
+        0x19603, 0x19604, 0x19605, 0x39606, 0x19703, 0x19704, 0x19705, 0x39706 },
+    /* 157 */ { 0x19803, 0x19804, 0x19805, 0x39806, 0x19b03, 0x19b04, 0x19b05, 0x39b06,
+        0x19d03, 0x19d04, 0x19d05, 0x39d06, 0x19e03, 0x19e04, 0x19e05, 0x39e06 },
+    /* 158 */ { 0x1a503, 0x1a504, 0x1a505, 0x3a506, 0x1a603, 0x1a604, 0x1a605, 0x3a606,
+        0x1a803, 0x1a804, 0x1a805, 0x3a806, 0x1ae03, 0x1ae04, 0x1ae05, 0x3ae06 },
+    /* 159 */ { 0x1af03, 0x1af04, 0x1af05, 0x3af06, 0x1b403, 0x1b404, 0x1b405, 0x3b406,
+        0x1b603, 0x1b604, 0x1b605, 0x3b606, 0x1b703, 0x1b704, 0x1b705, 0x3b706 },
+    /* 160 */ { 0x1bc03, 0x1bc04, 0x1bc05, 0x3bc06, 0x1bf03, 0x1bf04, 0x1bf05, 0x3bf06,
+        0x1c503, 0x1c504, 0x1c505, 0x3c506, 0x1e703, 0x1e704, 0x1e705, 0x3e706 },
+    /* 161 */ { 0x1ef03, 0x1ef04, 0x1ef05, 0x3ef06, 0x10901, 0x30902, 0x18e01, 0x38e02,
+        0x19001, 0x39002, 0x19101, 0x39102, 0x19401, 0x39402, 0x19f01, 0x39f02 },
+    /* 162 */ { 0x1ab01, 0x3ab02, 0x1ce01, 0x3ce02, 0x1d701, 0x3d702, 0x1e101, 0x3e102,
+        0x1ec01, 0x3ec02, 0x1ed01, 0x3ed02, 0x3c700, 0x3cf00, 0x3ea00, 0x3eb00 },
+    /* 163 */ { 0x000cd, 0x000ce, 0x000cf, 0x000d0, 0x000d1, 0x000d2, 0x000d3, 0x000d4,
+        0x000d5, 0x000d6, 0x000d7, 0x000d8, 0x000d9, 0x000da, 0x000db, 0x200dc },
+    /* 164 */ { 0x10107, 0x10108, 0x10109, 0x1010a, 0x1010b, 0x1010c, 0x1010d, 0x3010e,
+        0x18707, 0x18708, 0x18709, 0x1870a, 0x1870b, 0x1870c, 0x1870d, 0x3870e },
+    /* 165 */ { 0x18907, 0x18908, 0x18909, 0x1890a, 0x1890b, 0x1890c, 0x1890d, 0x3890e,
+        0x18a07, 0x18a08, 0x18a09, 0x18a0a, 0x18a0b, 0x18a0c, 0x18a0d, 0x38a0e },
+    /* 166 */ { 0x18b07, 0x18b08, 0x18b09, 0x18b0a, 0x18b0b, 0x18b0c, 0x18b0d, 0x38b0e,
+        0x18c07, 0x18c08, 0x18c09, 0x18c0a, 0x18c0b, 0x18c0c, 0x18c0d, 0x38c0e },
+    /* 167 */ { 0x18d07, 0x18d08, 0x18d09, 0x18d0a, 0x18d0b, 0x18d0c, 0x18d0d, 0x38d0e,
+        0x18f07, 0x18f08, 0x18f09, 0x18f0a, 0x18f0b, 0x18f0c, 0x18f0d, 0x38f0e },
+    /* 168 */ { 0x19307, 0x19308, 0x19309, 0x1930a, 0x1930b, 0x1930c, 0x1930d, 0x3930e,
+        0x19507, 0x19508, 0x19509, 0x1950a, 0x1950b, 0x1950c, 0x1950d, 0x3950e },
+    /* 169 */ { 0x19607, 0x19608, 0x19609, 0x1960a, 0x1960b, 0x1960c, 0x1960d, 0x3960e,
+        0x19707, 0x19708, 0x19709, 0x1970a, 0x1970b, 0x1970c, 0x1970d, 0x3970e },
+    /* 170 */ { 0x19807, 0x19808, 0x19809, 0x1980a, 0x1980b, 0x1980c, 0x1980d, 0x3980e,
+        0x19b07, 0x19b08, 0x19b09, 0x19b0a, 0x19b0b, 0x19b0c, 0x19b0d, 0x39b0e },
+    /* 171 */ { 0x19d07, 0x19d08, 0x19d09, 0x19d0a, 0x19d0b, 0x19d0c, 0x19d0d, 0x39d0e,
+        0x19e07, 0x19e08, 0x19e09, 0x19e0a, 0x19e0b, 0x19e0c, 0x19e0d, 0x39e0e },
+    /* 172 */ { 0x1a507, 0x1a508, 0x1a509, 0x1a50a, 0x1a50b, 0x1a50c, 0x1a50d, 0x3a50e,
+        0x1a607, 0x1a608, 0x1a609, 0x1a60a, 0x1a60b, 0x1a60c, 0x1a60d, 0x3a60e },
+    /* 173 */ { 0x1a807, 0x1a808, 0x1a809, 0x1a80a, 0x1a80b, 0x1a80c, 0x1a80d, 0x3a80e,
+        0x1ae07, 0x1ae08, 0x1ae09, 0x1ae0a, 0x1ae0b, 0x1ae0c, 0x1ae0d, 0x3ae0e },
+    /* 174 */ { 0x1af07, 0x1af08, 0x1af09, 0x1af0a, 0x1af0b, 0x1af0c, 0x1af0d, 0x3af0e,
+        0x1b407, 0x1b408, 0x1b409, 0x1b40a, 0x1b40b, 0x1b40c, 0x1b40d, 0x3b40e },
+    /* 175 */ { 0x1b607, 0x1b608, 0x1b609, 0x1b60a, 0x1b60b, 0x1b60c, 0x1b60d, 0x3b60e,
+        0x1b707, 0x1b708, 0x1b709, 0x1b70a, 0x1b70b, 0x1b70c, 0x1b70d, 0x3b70e },
+    /* 176 */ { 0x1bc07, 0x1bc08, 0x1bc09, 0x1bc0a, 0x1bc0b, 0x1bc0c, 0x1bc0d, 0x3bc0e,
+        0x1bf07, 0x1bf08, 0x1bf09, 0x1bf0a, 0x1bf0b, 0x1bf0c, 0x1bf0d, 0x3bf0e },
+    /* 177 */ { 0x1c507, 0x1c508, 0x1c509, 0x1c50a, 0x1c50b, 0x1c50c, 0x1c50d, 0x3c50e,
+        0x1e707, 0x1e708, 0x1e709, 0x1e70a, 0x1e70b, 0x1e70c, 0x1e70d, 0x3e70e },
+    /* 178 */ { 0x1ef07, 0x1ef08, 0x1ef09, 0x1ef0a, 0x1ef0b, 0x1ef0c, 0x1ef0d, 0x3ef0e,
+        0x10903, 0x10904, 0x10905, 0x30906, 0x18e03, 0x18e04, 0x18e05, 0x38e06 },
+    /* 179 */ { 0x19003, 0x19004, 0x19005, 0x39006, 0x19103, 0x19104, 0x19105, 0x39106,
+        0x19403, 0x19404, 0x19405, 0x39406, 0x19f03, 0x19f04, 0x19f05, 0x39f06 },
+    /* 180 */ { 0x1ab03, 0x1ab04, 0x1ab05, 0x3ab06, 0x1ce03, 0x1ce04, 0x1ce05, 0x3ce06,
+        0x1d703, 0x1d704, 0x1d705, 0x3d706, 0x1e103, 0x1e104, 0x1e105, 0x3e106 },
+    /* 181 */ { 0x1ec03, 0x1ec04, 0x1ec05, 0x3ec06, 0x1ed03, 0x1ed04, 0x1ed05, 0x3ed06,
+        0x1c701, 0x3c702, 0x1cf01, 0x3cf02, 0x1ea01, 0x3ea02, 0x1eb01, 0x3eb02 },
+    /* 182 */ { 0x3c000, 0x3c100, 0x3c800, 0x3c900, 0x3ca00, 0x3cd00, 0x3d200, 0x3d500,
+        0x3da00, 0x3db00, 0x3ee00, 0x3f000, 0x3f200, 0x3f300, 0x3ff00, 0x000dd },
+    /* 183 */ { 0x000de, 0x000df, 0x000e0, 0x000e1, 0x000e2, 0x000e3, 0x000e4, 0x000e5,
+        0x000e6, 0x000e7, 0x000e8, 0x000e9, 0x000ea, 0x000eb, 0x000ec, 0x200ed },
+    /* 184 */ { 0x10907, 0x10908, 0x10909, 0x1090a, 0x1090b, 0x1090c, 0x1090d, 0x3090e,
+        0x18e07, 0x18e08, 0x18e09, 0x18e0a, 0x18e0b, 0x18e0c, 0x18e0d, 0x38e0e },
+    /* 185 */ { 0x19007, 0x19008, 0x19009, 0x1900a, 0x1900b, 0x1900c, 0x1900d, 0x3900e,
+        0x19107, 0x19108, 0x19109, 0x1910a, 0x1910b, 0x1910c, 0x1910d, 0x3910e },
+    /* 186 */ { 0x19407, 0x19408, 0x19409, 0x1940a, 0x1940b, 0x1940c, 0x1940d, 0x3940e,
+        0x19f07, 0x19f08, 0x19f09, 0x19f0a, 0x19f0b, 0x19f0c, 0x19f0d, 0x39f0e },
+    /* 187 */ { 0x1ab07, 0x1ab08, 0x1ab09, 0x1ab0a, 0x1ab0b, 0x1ab0c, 0x1ab0d, 0x3ab0e,
+        0x1ce07, 0x1ce08, 0x1ce09, 0x1ce0a, 0x1ce0b, 0x1ce0c, 0x1ce0d, 0x3ce0e },
+    /* 188 */ { 0x1d707, 0x1d708, 0x1d709, 0x1d70a, 0x1d70b, 0x1d70c, 0x1d70d, 0x3d70e,
+        0x1e107, 0x1e108, 0x1e109, 0x1e10a, 0x1e10b, 0x1e10c, 0x1e10d, 0x3e10e },
+    /* 189 */ { 0x1ec07, 0x1ec08, 0x1ec09, 0x1ec0a, 0x1ec0b, 0x1ec0c, 0x1ec0d, 0x3ec0e,
+        0x1ed07, 0x1ed08, 0x1ed09, 0x1ed0a, 0x1ed0b, 0x1ed0c, 0x1ed0d, 0x3ed0e },
+    /* 190 */ { 0x1c703, 0x1c704, 0x1c705, 0x3c706, 0x1cf03, 0x1cf04, 0x1cf05, 0x3cf06,
+        0x1ea03, 0x1ea04, 0x1ea05, 0x3ea06, 0x1eb03, 0x1eb04, 0x1eb05, 0x3eb06 },
+    /* 191 */ { 0x1c001, 0x3c002, 0x1c101, 0x3c102, 0x1c801, 0x3c802, 0x1c901, 0x3c902,
+        0x1ca01, 0x3ca02, 0x1cd01, 0x3cd02, 0x1d201, 0x3d202, 0x1d501, 0x3d502 },
+    /* 192 */ { 0x1da01, 0x3da02, 0x1db01, 0x3db02, 0x1ee01, 0x3ee02, 0x1f001, 0x3f002,
+        0x1f201, 0x3f202, 0x1f301, 0x3f302, 0x1ff01, 0x3ff02, 0x3cb00, 0x3cc00 },
+    /* 193 */ { 0x3d300, 0x3d400, 0x3d600, 0x3dd00, 0x3de00, 0x3df00, 0x3f100, 0x3f400,
+        0x3f500, 0x3f600, 0x3f700, 0x3f800, 0x3fa00, 0x3fb00, 0x3fc00, 0x3fd00 },
+    /* 194 */ { 0x3fe00, 0x000ee, 0x000ef, 0x000f0, 0x000f1, 0x000f2, 0x000f3, 0x000f4,
+        0x000f5, 0x000f6, 0x000f7, 0x000f8, 0x000f9, 0x000fa, 0x000fb, 0x200fc },
+    /* 195 */ { 0x1c707, 0x1c708, 0x1c709, 0x1c70a, 0x1c70b, 0x1c70c, 0x1c70d, 0x3c70e,
+        0x1cf07, 0x1cf08, 0x1cf09, 0x1cf0a, 0x1cf0b, 0x1cf0c, 0x1cf0d, 0x3cf0e },
+    /* 196 */ { 0x1ea07, 0x1ea08, 0x1ea09, 0x1ea0a, 0x1ea0b, 0x1ea0c, 0x1ea0d, 0x3ea0e,
+        0x1eb07, 0x1eb08, 0x1eb09, 0x1eb0a, 0x1eb0b, 0x1eb0c, 0x1eb0d, 0x3eb0e },
+    /* 197 */ { 0x1c003, 0x1c004, 0x1c005, 0x3c006, 0x1c103, 0x1c104, 0x1c105, 0x3c106,
+        0x1c803, 0x1c804, 0x1c805, 0x3c806, 0x1c903, 0x1c904, 0x1c905, 0x3c906 },
+    /* 198 */ { 0x1ca03, 0x1ca04, 0x1ca05, 0x3ca06, 0x1cd03, 0x1cd04, 0x1cd05, 0x3cd06,
+        0x1d203, 0x1d204, 0x1d205, 0x3d206, 0x1d503, 0x1d504, 0x1d505, 0x3d506 },
+    /* 199 */ { 0x1da03, 0x1da04, 0x1da05, 0x3da06, 0x1db03, 0x1db04, 0x1db05, 0x3db06,
+        0x1ee03, 0x1ee04, 0x1ee05, 0x3ee06, 0x1f003, 0x1f004, 0x1f005, 0x3f006 },
+    /* 200 */ { 0x1f203, 0x1f204, 0x1f205, 0x3f206, 0x1f303, 0x1f304, 0x1f305, 0x3f306,
+        0x1ff03, 0x1ff04, 0x1ff05, 0x3ff06, 0x1cb01, 0x3cb02, 0x1cc01, 0x3cc02 },
+    /* 201 */ { 0x1d301, 0x3d302, 0x1d401, 0x3d402, 0x1d601, 0x3d602, 0x1dd01, 0x3dd02,
+        0x1de01, 0x3de02, 0x1df01, 0x3df02, 0x1f101, 0x3f102, 0x1f401, 0x3f402 },
+    /* 202 */ { 0x1f501, 0x3f502, 0x1f601, 0x3f602, 0x1f701, 0x3f702, 0x1f801, 0x3f802,
+        0x1fa01, 0x3fa02, 0x1fb01, 0x3fb02, 0x1fc01, 0x3fc02, 0x1fd01, 0x3fd02 },
+    /* 203 */ { 0x1fe01, 0x3fe02, 0x30200, 0x30300, 0x30400, 0x30500, 0x30600, 0x30700,
+        0x30800, 0x30b00, 0x30c00, 0x30e00, 0x30f00, 0x31000, 0x31100, 0x31200 },
+    /* 204 */ { 0x31300, 0x31400, 0x31500, 0x31700, 0x31800, 0x31900, 0x31a00, 0x31b00,
+        0x31c00, 0x31d00, 0x31e00, 0x31f00, 0x37f00, 0x3dc00, 0x3f900, 0x200fd },
+    /* 205 */ { 0x1c007, 0x1c008, 0x1c009, 0x1c00a, 0x1c00b, 0x1c00c, 0x1c00d, 0x3c00e,
+        0x1c107, 0x1c108, 0x1c109, 0x1c10a, 0x1c10b, 0x1c10c, 0x1c10d, 0x3c10e },
+    /* 206 */ { 0x1c807, 0x1c808, 0x1c809, 0x1c80a, 0x1c80b, 0x1c80c, 0x1c80d, 0x3c80e,
+        0x1c907, 0x1c908, 0x1c909, 0x1c90a, 0x1c90b, 0x1c90c, 0x1c90d, 0x3c90e },
+    /* 207 */ { 0x1ca07, 0x1ca08, 0x1ca09, 0x1ca0a, 0x1ca0b, 0x1ca0c, 0x1ca0d, 0x3ca0e,
+        0x1cd07, 0x1cd08, 0x1cd09, 0x1cd0a, 0x1cd0b, 0x1cd0c, 0x1cd0d, 0x3cd0e },
+    /* 208 */ { 0x1d207, 0x1d208, 0x1d209, 0x1d20a, 0x1d20b, 0x1d20c, 0x1d20d, 0x3d20e,
+        0x1d507, 0x1d508, 0x1d509, 0x1d50a, 0x1d50b, 0x1d50c, 0x1d50d, 0x3d50e },
+    /* 209 */ { 0x1da07, 0x1da08, 0x1da09, 0x1da0a, 0x1da0b, 0x1da0c, 0x1da0d, 0x3da0e,
+        0x1db07, 0x1db08, 0x1db09, 0x1db0a, 0x1db0b, 0x1db0c, 0x1db0d, 0x3db0e },
+    /* 210 */ { 0x1ee07, 0x1ee08, 0x1ee09, 0x1ee0a, 0x1ee0b, 0x1ee0c, 0x1ee0d, 0x3ee0e,
+        0x1f007, 0x1f008, 0x1f009, 0x1f00a, 0x1f00b, 0x1f00c, 0x1f00d, 0x3f00e },
+    /* 211 */ { 0x1f207, 0x1f208, 0x1f209, 0x1f20a, 0x1f20b, 0x1f20c, 0x1f20d, 0x3f20e,
+        0x1f307, 0x1f308, 0x1f309, 0x1f30a, 0x1f30b, 0x1f30c, 0x1f30d, 0x3f30e },
+    /* 212 */ { 0x1ff07, 0x1ff08, 0x1ff09, 0x1ff0a, 0x1ff0b, 0x1ff0c, 0x1ff0d, 0x3ff0e,
+        0x1cb03, 0x1cb04, 0x1cb05, 0x3cb06, 0x1cc03, 0x1cc04, 0x1cc05, 0x3cc06 },
+    /* 213 */ { 0x1d303, 0x1d304, 0x1d305, 0x3d306, 0x1d403, 0x1d404, 0x1d405, 0x3d406,
+        0x1d603, 0x1d604, 0x1d605, 0x3d606, 0x1dd03, 0x1dd04, 0x1dd05, 0x3dd06 },
+    /* 214 */ { 0x1de03, 0x1de04, 0x1de05, 0x3de06, 0x1df03, 0x1df04, 0x1df05, 0x3df06,
+        0x1f103, 0x1f104, 0x1f105, 0x3f106, 0x1f403, 0x1f404, 0x1f405, 0x3f406 },
+    /* 215 */ { 0x1f503, 0x1f504, 0x1f505, 0x3f506, 0x1f603, 0x1f604, 0x1f605, 0x3f606,
+        0x1f703, 0x1f704, 0x1f705, 0x3f706, 0x1f803, 0x1f804, 0x1f805, 0x3f806 },
+    /* 216 */ { 0x1fa03, 0x1fa04, 0x1fa05, 0x3fa06, 0x1fb03, 0x1fb04, 0x1fb05, 0x3fb06,
+        0x1fc03, 0x1fc04, 0x1fc05, 0x3fc06, 0x1fd03, 0x1fd04, 0x1fd05, 0x3fd06 },
+    /* 217 */ { 0x1fe03, 0x1fe04, 0x1fe05, 0x3fe06, 0x10201, 0x30202, 0x10301, 0x30302,
+        0x10401, 0x30402, 0x10501, 0x30502, 0x10601, 0x30602, 0x10701, 0x30702 },
+    /* 218 */ { 0x10801, 0x30802, 0x10b01, 0x30b02, 0x10c01, 0x30c02, 0x10e01, 0x30e02,
+        0x10f01, 0x30f02, 0x11001, 0x31002, 0x11101, 0x31102, 0x11201, 0x31202 },
+    /* 219 */ { 0x11301, 0x31302, 0x11401, 0x31402, 0x11501, 0x31502, 0x11701, 0x31702,
+        0x11801, 0x31802, 0x11901, 0x31902, 0x11a01, 0x31a02, 0x11b01, 0x31b02 },
+    /* 220 */ { 0x11c01, 0x31c02, 0x11d01, 0x31d02, 0x11e01, 0x31e02, 0x11f01, 0x31f02,
+        0x17f01, 0x37f02, 0x1dc01, 0x3dc02, 0x1f901, 0x3f902, 0x000fe, 0x200ff },
+    /* 221 */ { 0x1cb07, 0x1cb08, 0x1cb09, 0x1cb0a, 0x1cb0b, 0x1cb0c, 0x1cb0d, 0x3cb0e,
+        0x1cc07, 0x1cc08, 0x1cc09, 0x1cc0a, 0x1cc0b, 0x1cc0c, 0x1cc0d, 0x3cc0e },
+    /* 222 */ { 0x1d307, 0x1d308, 0x1d309, 0x1d30a, 0x1d30b, 0x1d30c, 0x1d30d, 0x3d30e,
+        0x1d407, 0x1d408, 0x1d409, 0x1d40a, 0x1d40b, 0x1d40c, 0x1d40d, 0x3d40e },
+    /* 223 */ { 0x1d607, 0x1d608, 0x1d609, 0x1d60a, 0x1d60b, 0x1d60c, 0x1d60d, 0x3d60e,
+        0x1dd07, 0x1dd08, 0x1dd09, 0x1dd0a, 0x1dd0b, 0x1dd0c, 0x1dd0d, 0x3dd0e },
+    /* 224 */ { 0x1de07, 0x1de08, 0x1de09, 0x1de0a, 0x1de0b, 0x1de0c, 0x1de0d, 0x3de0e,
+        0x1df07, 0x1df08, 0x1df09, 0x1df0a, 0x1df0b, 0x1df0c, 0x1df0d, 0x3df0e },
+    /* 225 */ { 0x1f107, 0x1f108, 0x1f109, 0x1f10a, 0x1f10b, 0x1f10c, 0x1f10d, 0x3f10e,
+        0x1f407, 0x1f408, 0x1f409, 0x1f40a, 0x1f40b, 0x1f40c, 0x1f40d, 0x3f40e },
+    /* 226 */ { 0x1f507, 0x1f508, 0x1f509, 0x1f50a, 0x1f50b, 0x1f50c, 0x1f50d, 0x3f50e,
+        0x1f607, 0x1f608, 0x1f609, 0x1f60a, 0x1f60b, 0x1f60c, 0x1f60d, 0x3f60e },
+    /* 227 */ { 0x1f707, 0x1f708, 0x1f709, 0x1f70a, 0x1f70b, 0x1f70c, 0x1f70d, 0x3f70e,
+        0x1f807, 0x1f808, 0x1f809, 0x1f80a, 0x1f80b, 0x1f80c, 0x1f80d, 0x3f80e },
+    /* 228 */ { 0x1fa07, 0x1fa08, 0x1fa09, 0x1fa0a, 0x1fa0b, 0x1fa0c, 0x1fa0d, 0x3fa0e,
+        0x1fb07, 0x1fb08, 0x1fb09, 0x1fb0a, 0x1fb0b, 0x1fb0c, 0x1fb0d, 0x3fb0e },
+    /* 229 */ { 0x1fc07, 0x1fc08, 0x1fc09, 0x1fc0a, 0x1fc0b, 0x1fc0c, 0x1fc0d, 0x3fc0e,
+        0x1fd07, 0x1fd08, 0x1fd09, 0x1fd0a, 0x1fd0b, 0x1fd0c, 0x1fd0d, 0x3fd0e },
+    /* 230 */ { 0x1fe07, 0x1fe08, 0x1fe09, 0x1fe0a, 0x1fe0b, 0x1fe0c, 0x1fe0d, 0x3fe0e,
+        0x10203, 0x10204, 0x10205, 0x30206, 0x10303, 0x10304, 0x10305, 0x30306 },
+    /* 231 */ { 0x10403, 0x10404, 0x10405, 0x30406, 0x10503, 0x10504, 0x10505, 0x30506,
+        0x10603, 0x10604, 0x10605, 0x30606, 0x10703, 0x10704, 0x10705, 0x30706 },
+    /* 232 */ { 0x10803, 0x10804, 0x10805, 0x30806, 0x10b03, 0x10b04, 0x10b05, 0x30b06,
+        0x10c03, 0x10c04, 0x10c05, 0x30c06, 0x10e03, 0x10e04, 0x10e05, 0x30e06 },
+    /* 233 */ { 0x10f03, 0x10f04, 0x10f05, 0x30f06, 0x11003, 0x11004, 0x11005, 0x31006,
+        0x11103, 0x11104, 0x11105, 0x31106, 0x11203, 0x11204, 0x11205, 0x31206 },
+    /* 234 */ { 0x11303, 0x11304, 0x11305, 0x31306, 0x11403, 0x11404, 0x11405, 0x31406,
+        0x11503, 0x11504, 0x11505, 0x31506, 0x11703, 0x11704, 0x11705, 0x31706 },
+    /* 235 */ { 0x11803, 0x11804, 0x11805, 0x31806, 0x11903, 0x11904, 0x11905, 0x31906,
+        0x11a03, 0x11a04, 0x11a05, 0x31a06, 0x11b03, 0x11b04, 0x11b05, 0x31b06 },
+    /* 236 */ { 0x11c03, 0x11c04, 0x11c05, 0x31c06, 0x11d03, 0x11d04, 0x11d05, 0x31d06,
+        0x11e03, 0x11e04, 0x11e05, 0x31e06, 0x11f03, 0x11f04, 0x11f05, 0x31f06 },
+    /* 237 */ { 0x17f03, 0x17f04, 0x17f05, 0x37f06, 0x1dc03, 0x1dc04, 0x1dc05, 0x3dc06,
+        0x1f903, 0x1f904, 0x1f905, 0x3f906, 0x30a00, 0x30d00, 0x31600, 0x40000 },
+    /* 238 */ { 0x10207, 0x10208, 0x10209, 0x1020a, 0x1020b, 0x1020c, 0x1020d, 0x3020e,
+        0x10307, 0x10308, 0x10309, 0x1030a, 0x1030b, 0x1030c, 0x1030d, 0x3030e },
+    /* 239 */ { 0x10407, 0x10408, 0x10409, 0x1040a, 0x1040b, 0x1040c, 0x1040d, 0x3040e,
+        0x10507, 0x10508, 0x10509, 0x1050a, 0x1050b, 0x1050c, 0x1050d, 0x3050e },
+    /* 240 */ { 0x10607, 0x10608, 0x10609, 0x1060a, 0x1060b, 0x1060c, 0x1060d, 0x3060e,
+        0x10707, 0x10708, 0x10709, 0x1070a, 0x1070b, 0x1070c, 0x1070d, 0x3070e },
+    /* 241 */ { 0x10807, 0x10808, 0x10809, 0x1080a, 0x1080b, 0x1080c, 0x1080d, 0x3080e,
+        0x10b07, 0x10b08, 0x10b09, 0x10b0a, 0x10b0b, 0x10b0c, 0x10b0d, 0x30b0e },
+    /* 242 */ { 0x10c07, 0x10c08, 0x10c09, 0x10c0a, 0x10c0b, 0x10c0c, 0x10c0d, 0x30c0e,
+        0x10e07, 0x10e08, 0x10e09, 0x10e0a, 0x10e0b, 0x10e0c, 0x10e0d, 0x30e0e },
+    /* 243 */ { 0x10f07, 0x10f08, 0x10f09, 0x10f0a, 0x10f0b, 0x10f0c, 0x10f0d, 0x30f0e,
+        0x11007, 0x11008, 0x11009, 0x1100a, 0x1100b, 0x1100c, 0x1100d, 0x3100e },
+    /* 244 */ { 0x11107, 0x11108, 0x11109, 0x1110a, 0x1110b, 0x1110c, 0x1110d, 0x3110e,
+        0x11207, 0x11208, 0x11209, 0x1120a, 0x1120b, 0x1120c, 0x1120d, 0x3120e },
+    /* 245 */ { 0x11307, 0x11308, 0x11309, 0x1130a, 0x1130b, 0x1130c, 0x1130d, 0x3130e,
+        0x11407, 0x11408, 0x11409, 0x1140a, 0x1140b, 0x1140c, 0x1140d, 0x3140e },
+    /* 246 */ { 0x11507, 0x11508, 0x11509, 0x1150a, 0x1150b, 0x1150c, 0x1150d, 0x3150e,
+        0x11707, 0x11708, 0x11709, 0x1170a, 0x1170b, 0x1170c, 0x1170d, 0x3170e },
+    /* 247 */ { 0x11807, 0x11808, 0x11809, 0x1180a, 0x1180b, 0x1180c, 0x1180d, 0x3180e,
+        0x11907, 0x11908, 0x11909, 0x1190a, 0x1190b, 0x1190c, 0x1190d, 0x3190e },
+    /* 248 */ { 0x11a07, 0x11a08, 0x11a09, 0x11a0a, 0x11a0b, 0x11a0c, 0x11a0d, 0x31a0e,
+        0x11b07, 0x11b08, 0x11b09, 0x11b0a, 0x11b0b, 0x11b0c, 0x11b0d, 0x31b0e },
+    /* 249 */ { 0x11c07, 0x11c08, 0x11c09, 0x11c0a, 0x11c0b, 0x11c0c, 0x11c0d, 0x31c0e,
+        0x11d07, 0x11d08, 0x11d09, 0x11d0a, 0x11d0b, 0x11d0c, 0x11d0d, 0x31d0e },
+    /* 250 */ { 0x11e07, 0x11e08, 0x11e09, 0x11e0a, 0x11e0b, 0x11e0c, 0x11e0d, 0x31e0e,
+        0x11f07, 0x11f08, 0x11f09, 0x11f0a, 0x11f0b, 0x11f0c, 0x11f0d, 0x31f0e },
+    /* 251 */ { 0x17f07, 0x17f08, 0x17f09, 0x17f0a, 0x17f0b, 0x17f0c, 0x17f0d, 0x37f0e,
+        0x1dc07, 0x1dc08, 0x1dc09, 0x1dc0a, 0x1dc0b, 0x1dc0c, 0x1dc0d, 0x3dc0e },
+    /* 252 */ { 0x1f907, 0x1f908, 0x1f909, 0x1f90a, 0x1f90b, 0x1f90c, 0x1f90d, 0x3f90e,
+        0x10a01, 0x30a02, 0x10d01, 0x30d02, 0x11601, 0x31602, 0x40000, 0x40000 },
+    /* 253 */ { 0x10a03, 0x10a04, 0x10a05, 0x30a06, 0x10d03, 0x10d04, 0x10d05, 0x30d06,
+        0x11603, 0x11604, 0x11605, 0x31606, 0x40000, 0x40000, 0x40000, 0x40000 },
+    /* 254 */ { 0x10a07, 0x10a08, 0x10a09, 0x10a0a, 0x10a0b, 0x10a0c, 0x10a0d, 0x30a0e,
+        0x10d07, 0x10d08, 0x10d09, 0x10d0a, 0x10d0b, 0x10d0c, 0x10d0d, 0x30d0e },
+    /* 255 */ { 0x11607, 0x11608, 0x11609, 0x1160a, 0x1160b, 0x1160c, 0x1160d, 0x3160e,
+        0x40000, 0x40000, 0x40000, 0x40000, 0x40000, 0x40000, 0x40000, 0x40000 }
 };
 
 int hzero_qpack_huffman_decode(uint8_t* bytes, uint8_t* bytes_max, uint8_t* decoded, size_t max_decoded, size_t* nb_decoded)
 {
     int ret = 0;
-    uint64_t val_in = 0;
-    int bits_in = 0;
     size_t decoded_index = 0;
-    int index = 0;
-    int was_all_ones = 1;
-
-    while (1) {
-        /* Refill the registry */
-        int bit;
-        int index_64 = index >> 3;
-        int b_index = 7 - (index & 7);
-
-        while (bits_in < 57 && bytes < bytes_max) {
-            uint64_t added = *bytes++;
-            int shift = 64 - bits_in - 8;
-            added <<= shift;
-            val_in |= added;
-            bits_in += 8;
-        }
-
-        if ((h3zero_qpack_huffman_bit[index_64] >> b_index) & 1) {
-            /* This is an index location */
-            if (bits_in <= 0) {
-                /* Reached the end of the input! */
-                break;
-            }
-            bit = (val_in >> 63) & 1;
-            val_in <<= 1;
-            bits_in--;
-            if (bit) {
-                index += h3zero_qpack_huffman_val[index];
-            }
-            else {
-                index++;
-                was_all_ones = 0;
+    uint32_t step = H3ZERO_HUFFMAN_ACCEPT;
+
+    while (bytes < bytes_max) {
+        uint8_t byte = *bytes++;
+
+        for (int shift = 4; shift >= 0; shift -= 4) {
+            step = h3zero_qpack_huffman_decode_table[step & 0xFF][(byte >> shift) & 0x0F];
+            if ((step & H3ZERO_HUFFMAN_EMIT) != 0) {
+                if (decoded_index >= max_decoded) {
+                    /* input is too long */
+                    step = H3ZERO_HUFFMAN_FAIL;
+                    break;
+                }
+                decoded[decoded_index++] = (uint8_t)(step >> 8);
             }
-            if (index >= 512) {
-                /* End of string marked by all ones */
+            else if ((step & H3ZERO_HUFFMAN_FAIL) != 0) {
                 break;
             }
         }
-        else if (decoded_index < max_decoded){
-            decoded[decoded_index++] = h3zero_qpack_huffman_val[index];
-            index = 0;
-            was_all_ones = 1;
-        }
-        else
-        {
-            /* input is too long */
-            was_all_ones = 1;
+        if ((step & H3ZERO_HUFFMAN_FAIL) != 0) {
             break;
         }
     }
 
-    /* Error if break and not all ones before that */
-    if (!was_all_ones) {
+    /* Error if the input does not end with a complete code or with padding */
+    if ((step & H3ZERO_HUFFMAN_ACCEPT) == 0) {
         ret = -1;
     }
 
     *nb_decoded = decoded_index;
 
     return ret;
-}
\ No newline at end of file
+}
+
+size_t h3zero_qpack_huffman_length(uint8_t const* val, size_t val_length)
+{
+    uint64_t nb_bits = 0;
+
+    for (size_t i = 0; i < val_length; i++) {
+        nb_bits += h3zero_qpack_huffman_code[val[i]].nb_bits;
+    }
+
+    return (size_t)((nb_bits + 7) / 8);
+}
+
+uint8_t* h3zero_qpack_huffman_encode(uint8_t* bytes, uint8_t* bytes_max, uint8_t const* val, size_t val_length)
+{
+    uint64_t val_out = 0;
+    int bits_out = 0;
+
+    for (size_t i = 0; bytes != NULL && i < val_length; i++) {
+        h3zero_qpack_huffman_code_t const* code = &h3zero_qpack_huffman_code[val[i]];
+
+        val_out = (val_out << code->nb_bits) | code->code;
+        bits_out += code->nb_bits;
+        while (bits_out >= 8) {
+            if (bytes >= bytes_max) {
+                bytes = NULL;
+                break;
+            }
+            bits_out -= 8;
+            *bytes++ = (uint8_t)(val_out >> bits_out);
+        }
+    }
+
+    if (bytes != NULL && bits_out > 0) {
+        /* Pad with the first bits of EOS */
+        if (bytes >= bytes_max) {
+            bytes = NULL;
+        }
+        else {
+            *bytes++ = (uint8_t)((val_out << (8 - bits_out)) | (0xFF >> bits_out));
+        }
+    }
+
+    return bytes;
+}
@@ -42,6 +42,9 @@ extern "C" {
 #define H3ZERO_EARLY_RESPONSE 0x010E /* Remainder of request not needed */
 #define H3ZERO_CONNECT_ERROR 0x010F /* TCP reset or error on CONNECT request */
 #define H3ZERO_VERSION_FALLBACK 0x0110 /* Retry over  H3ZERO/1.1 */
+#define H3ZERO_QPACK_DECOMPRESSION_FAILED 0x0200 /* Decoder failed to interpret a field section */
+#define H3ZERO_QPACK_ENCODER_STREAM_ERROR 0x0201 /* Error in the encoder stream */
+#define H3ZERO_QPACK_DECODER_STREAM_ERROR 0x0202 /* Error in the decoder stream */
 #define H3ZERO_USER_AGENT_STRING "H3Zero/1.0"
 
 typedef enum {
@@ -58,13 +61,20 @@ typedef enum {
 
 typedef enum {
     h3zero_setting_reserved = 0x0,
-	h3zero_setting_header_table_size = 0x1,
+	h3zero_setting_header_table_size = 0x1, /* SETTINGS_QPACK_MAX_TABLE_CAPACITY */
     h3zero_setting_max_header_list_size = 0x6,
 	h3zero_qpack_blocked_streams = 0x07,
 	h3zero_setting_grease_signature =0x0a0a,
     h3zero_setting_grease_mask = 0x0f0f
 } h3zero_settings_enum_t;
 
+typedef enum {
+    h3zero_stream_type_control = 0,
+    h3zero_stream_type_push = 1,
+    h3zero_stream_type_qpack_encoder = 2,
+    h3zero_stream_type_qpack_decoder = 3
+} h3zero_stream_type_enum_t;
+
 typedef enum {
     http_header_unknown = 0,
     http_pseudo_header_authority,
@@ -142,10 +152,16 @@ typedef struct st_h3zero_qpack_static_t {
 } h3zero_qpack_static_t;
 
 typedef struct st_h3zero_settings_t {
-    unsigned int header_size;
+    unsigned int header_size; /* QPACK max table capacity */
     unsigned int blocked_streams;
 } h3zero_settings_t;
 
+/* Encode a control stream prefix and a setting frame with the QPACK settings.
+ * With both settings set to zero, this produces h3zero_default_setting_frame */
+uint8_t* h3zero_settings_encode(uint8_t* bytes, uint8_t* bytes_max, const h3zero_settings_t* settings);
+/* Decode the content of a setting frame. Unknown settings are ignored. */
+uint8_t* h3zero_settings_decode(uint8_t* bytes, uint8_t* bytes_max, h3zero_settings_t* settings);
+
 typedef enum {
     h3zero_content_type_none = 0,
     h3zero_content_type_not_supported,
@@ -191,8 +207,139 @@ uint8_t * h3zero_qpack_int_encode(uint8_t * bytes, uint8_t * bytes_max,
 uint8_t * h3zero_qpack_int_decode(uint8_t * bytes, uint8_t * bytes_max,
     uint8_t mask, uint64_t *val);
 
+/* QPACK dynamic table.
+ *
+ * The encoder and the decoder of a connection each maintain a copy of the
+ * table. Entries are kept in a ring, in insertion order, and evicted from
+ * the oldest when room is needed. Each entry is also chained in two hash
+ * tables, by name and by name plus value, so the encoder can find the
+ * most recent matching entry without scanning the table.
+ */
+#define H3ZERO_QPACK_ENTRY_OVERHEAD 32
+#define H3ZERO_QPACK_HASH_SIZE 128
+#define H3ZERO_QPACK_STATIC_HASH_SIZE 256
+#define H3ZERO_QPACK_MAX_FIELDS 64
+#define H3ZERO_QPACK_MAX_TABLE_CAPACITY_DEFAULT 4096
+#define H3ZERO_QPACK_BLOCKED_STREAMS_DEFAULT 16
+
+typedef struct st_h3zero_qpack_entry_t {
+    struct st_h3zero_qpack_entry_t* next_by_name;
+    struct st_h3zero_qpack_entry_t* next_by_field;
+    uint64_t absolute_index;
+    uint32_t name_hash;
+    uint32_t field_hash;
+    uint8_t* name;
+    size_t name_length;
+    uint8_t* value;
+    size_t value_length;
+} h3zero_qpack_entry_t;
+
+typedef struct st_h3zero_qpack_table_t {
+    h3zero_qpack_entry_t** entries;
+    size_t nb_alloc;
+    size_t first;
+    size_t nb_entries;
+    uint64_t insert_count;
+    uint64_t capacity;
+    uint64_t max_capacity;
+    uint64_t size;
+    h3zero_qpack_entry_t* by_name[H3ZERO_QPACK_HASH_SIZE];
+    h3zero_qpack_entry_t* by_field[H3ZERO_QPACK_HASH_SIZE];
+} h3zero_qpack_table_t;
+
+int h3zero_qpack_table_init(h3zero_qpack_table_t* table, uint64_t max_capacity);
+void h3zero_qpack_table_release(h3zero_qpack_table_t* table);
+h3zero_qpack_entry_t* h3zero_qpack_table_get(h3zero_qpack_table_t* table, uint64_t absolute_index);
+/* Insertion and capacity changes fail if that would evict an entry whose
+ * absolute index is not lower than evict_limit */
+int h3zero_qpack_table_set_capacity(h3zero_qpack_table_t* table, uint64_t capacity, uint64_t evict_limit);
+int h3zero_qpack_table_insert(h3zero_qpack_table_t* table, uint8_t const* name, size_t name_length,
+    uint8_t const* value, size_t value_length, uint64_t evict_limit);
+/* Find the most recent entry matching the field, or only the name, among entries below index_limit */
+h3zero_qpack_entry_t* h3zero_qpack_table_find_field(h3zero_qpack_table_t* table, uint8_t const* name, size_t name_length,
+    uint8_t const* value, size_t value_length, uint64_t index_limit);
+h3zero_qpack_entry_t* h3zero_qpack_table_find_name(h3zero_qpack_table_t* table, uint8_t const* name, size_t name_length,
+    uint64_t index_limit);
+
+/* Instructions to send on the encoder or decoder streams are accumulated
+ * in a buffer. The application copies them to the stream with
+ * h3zero_qpack_buffer_take. */
+typedef struct st_h3zero_qpack_buffer_t {
+    uint8_t* bytes;
+    size_t length;
+    size_t alloc;
+} h3zero_qpack_buffer_t;
+
+size_t h3zero_qpack_buffer_take(h3zero_qpack_buffer_t* buffer, uint8_t* bytes, size_t bytes_max);
+void h3zero_qpack_buffer_release(h3zero_qpack_buffer_t* buffer);
+
+/* Field sections sent by the encoder and not yet acknowledged. Entries
+ * referenced by these sections cannot be evicted. */
+typedef struct st_h3zero_qpack_section_t {
+    struct st_h3zero_qpack_section_t* next;
+    uint64_t stream_id;
+    uint64_t required_insert_count;
+    uint64_t min_index;
+} h3zero_qpack_section_t;
+
+typedef struct st_h3zero_qpack_encoder_t {
+    h3zero_qpack_table_t table;
+    uint64_t local_max_capacity;
+    uint64_t peer_max_capacity;
+    uint64_t peer_blocked_streams;
+    uint64_t known_received_count;
+    h3zero_qpack_section_t* first_section;
+    h3zero_qpack_section_t* last_section;
+    h3zero_qpack_buffer_t encoder_stream; /* Instructions to send on the encoder stream */
+    uint8_t decoder_input[16]; /* Partial instruction received on the decoder stream */
+    size_t decoder_input_length;
+    uint8_t static_by_name[H3ZERO_QPACK_STATIC_HASH_SIZE];
+    uint8_t static_by_field[H3ZERO_QPACK_STATIC_HASH_SIZE];
+} h3zero_qpack_encoder_t;
+
+typedef struct st_h3zero_qpack_decoder_t {
+    h3zero_qpack_table_t table;
+    uint64_t max_blocked_streams;
+    uint64_t nb_blocked_streams;
+    uint64_t acknowledged_insert_count;
+    h3zero_qpack_buffer_t decoder_stream; /* Instructions to send on the decoder stream */
+    h3zero_qpack_buffer_t encoder_input; /* Partial instruction received on the encoder stream */
+} h3zero_qpack_decoder_t;
+
+/* The encoder only uses the static table until the peer settings are known.
+ * The capacity of the dynamic table is then the smaller of the local
+ * maximum and of the peer's SETTINGS_QPACK_MAX_TABLE_CAPACITY. */
+int h3zero_qpack_encoder_init(h3zero_qpack_encoder_t* encoder, uint64_t local_max_capacity);
+int h3zero_qpack_encoder_set_peer_settings(h3zero_qpack_encoder_t* encoder, const h3zero_settings_t* peer_settings);
+void h3zero_qpack_encoder_release(h3zero_qpack_encoder_t* encoder);
+/* Process instructions received on the decoder stream. Returns 0 or H3ZERO_QPACK_DECODER_STREAM_ERROR. */
+int h3zero_qpack_receive_decoder_stream(h3zero_qpack_encoder_t* encoder, uint8_t const* bytes, size_t length);
+
+/* The decoder parameters are those announced in the local settings. */
+int h3zero_qpack_decoder_init(h3zero_qpack_decoder_t* decoder, uint64_t max_capacity, uint64_t max_blocked_streams);
+void h3zero_qpack_decoder_release(h3zero_qpack_decoder_t* decoder);
+/* Process instructions received on the encoder stream. Returns 0 or H3ZERO_QPACK_ENCODER_STREAM_ERROR. */
+int h3zero_qpack_receive_encoder_stream(h3zero_qpack_decoder_t* decoder, uint8_t const* bytes, size_t length);
+
+typedef struct st_h3zero_qpack_field_t {
+    uint8_t const* name;
+    size_t name_length;
+    uint8_t const* value;
+    size_t value_length;
+} h3zero_qpack_field_t;
+
+/* Encode a field section. If encoder is NULL, only the static table is used. */
+uint8_t* h3zero_qpack_encode_fields(h3zero_qpack_encoder_t* encoder, uint64_t stream_id,
+    uint8_t* bytes, uint8_t* bytes_max, h3zero_qpack_field_t const* fields, size_t nb_fields);
+
 uint8_t * h3zero_parse_qpack_header_frame(uint8_t * bytes, uint8_t * bytes_max,
     h3zero_header_parts_t * parts);
+/* Parse a field section that may refer to the dynamic table of the decoder.
+ * If the section refers to entries not yet received, *is_blocked is set, the
+ * parts are not documented, and the frame shall be parsed again after more
+ * instructions are received on the encoder stream. */
+uint8_t* h3zero_parse_qpack_header_frame_ex(uint8_t* bytes, uint8_t* bytes_max,
+    h3zero_header_parts_t* parts, h3zero_qpack_decoder_t* decoder, uint64_t stream_id, int* is_blocked);
 uint8_t * h3zero_create_request_header_frame(uint8_t * bytes, uint8_t * bytes_max,
     uint8_t const * path, size_t path_length, char const * host);
 uint8_t* h3zero_create_request_header_frame_ex(uint8_t* bytes, uint8_t* bytes_max,
@@ -210,6 +357,13 @@ uint8_t * h3zero_create_not_found_header_frame(uint8_t * bytes, uint8_t * bytes_
 uint8_t* h3zero_create_not_found_header_frame_ex(uint8_t* bytes, uint8_t* bytes_max, char const* server_string);
 uint8_t * h3zero_create_bad_method_header_frame(uint8_t * bytes, uint8_t * bytes_max);
 uint8_t* h3zero_create_bad_method_header_frame_ex(uint8_t* bytes, uint8_t* bytes_max, char const* server_string);
+/* Same as the _ex functions, but using the dynamic table of the encoder. The
+ * request may carry additional fields, e.g., authorization. */
+uint8_t* h3zero_create_request_header_frame_qpack(h3zero_qpack_encoder_t* encoder, uint64_t stream_id,
+    uint8_t* bytes, uint8_t* bytes_max, uint8_t const* path, size_t path_length, char const* host,
+    char const* ua_string, h3zero_qpack_field_t const* extra_fields, size_t nb_extra_fields);
+uint8_t* h3zero_create_response_header_frame_qpack(h3zero_qpack_encoder_t* encoder, uint64_t stream_id,
+    uint8_t* bytes, uint8_t* bytes_max, h3zero_content_type_enum doc_type, char const* server_string);
 
 /* Parsing of a data stream. This is implemented as a filter, with a set of states:
  *
@@ -234,19 +388,37 @@ typedef struct st_h3zero_data_stream_state_t {
     uint64_t current_frame_read;
     uint8_t frame_header[16];
     size_t frame_header_read;
+    h3zero_qpack_decoder_t* qpack_decoder; /* If NULL, only the static table is used */
+    uint64_t stream_id;
+    uint8_t* blocked_data;
+    size_t blocked_data_length;
     unsigned int frame_header_parsed : 1;
     unsigned int header_found : 1;
     unsigned int data_found : 1;
     unsigned int trailer_found : 1;
+    unsigned int is_blocked : 1;
 } h3zero_data_stream_state_t;
 
 uint8_t * h3zero_parse_data_stream(uint8_t * bytes, uint8_t * bytes_max,
     h3zero_data_stream_state_t * stream_state, size_t * available_data, uint16_t * error_found);
 
+/* When a header frame is blocked, the bytes that follow it are kept in the
+ * stream state. After new instructions are received on the encoder stream,
+ * the application retries the header frame. If it is not blocked anymore,
+ * the function returns the kept bytes, which the application shall
+ * process with h3zero_parse_data_stream and then free. */
+uint8_t* h3zero_data_stream_unblock(h3zero_data_stream_state_t* stream_state, size_t* length, uint16_t* error_found);
+
 void h3zero_delete_data_stream_state(h3zero_data_stream_state_t * stream_state);
 
+/* Huffman coding of strings. The decoder returns -1 if the input is not
+ * valid or if the decoded string does not fit in max_decoded bytes.
+ * h3zero_qpack_huffman_length returns the length of the encoded string,
+ * which the encoders compare to the plain length before using Huffman. */
 int hzero_qpack_huffman_decode(uint8_t * bytes, uint8_t * bytes_max,
     uint8_t * decoded, size_t max_decoded, size_t * nb_decoded);
+size_t h3zero_qpack_huffman_length(uint8_t const* val, size_t val_length);
+uint8_t* h3zero_qpack_huffman_encode(uint8_t* bytes, uint8_t* bytes_max, uint8_t const* val, size_t val_length);
 
 
 #ifdef __cplusplus
@@ -47,12 +47,15 @@ static const picoquic_test_def_t test_table[] = {
     { "h3zero_integer", h3zero_integer_test },
     { "qpack_huffman", qpack_huffman_test },
     { "qpack_huffman_base", qpack_huffman_base_test},
+    { "qpack_huffman_encode", qpack_huffman_encode_test },
+    { "qpack_huffman_bench", qpack_huffman_bench_test },
     { "h3zero_parse_qpack", h3zero_parse_qpack_test },
     { "h3zero_prepare_qpack", h3zero_prepare_qpack_test },
     { "h3zero_user_agent", h3zero_user_agent_test },
     { "h3zero_null_sni", h3zero_null_sni_test },
     { "h3zero_qpack_fuzz", h3zero_qpack_fuzz_test },
     { "h3zero_stream_test", h3zero_stream_test },
+    { "h3zero_qpack_dynamic", h3zero_qpack_dynamic_test },
     { "parse_demo_scenario", parse_demo_scenario_test },
     { "h3zero_server", h3zero_server_test },
     { "h09_server", h09_server_test },
@@ -128,6 +131,7 @@ int usage(char const * argv0)
     fprintf(stderr, "  -s nnn            Run stress for nnn clients.\n");
     fprintf(stderr, "  -f nnn            Run fuzz for nnn clients.\n");
     fprintf(stderr, "  -m nnn            Run multi file test with nnn files.\n");
+    fprintf(stderr, "  -q nnn            Run the QPACK Huffman benchmark for nnn rounds.\n");
     fprintf(stderr, "  -n                Disable debug prints.\n");
     fprintf(stderr, "  -r                Retry failed tests with debug print enabled.\n");
     fprintf(stderr, "  -h                Print this help message\n");
@@ -164,6 +168,7 @@ int main(int argc, char** argv)
     int nb_multi_file = 0;
     int disable_debug = 0;
     int retry_failed_test = 0;
+    uint64_t huffman_bench_rounds = 0;
 
     if (test_status == NULL)
     {
@@ -172,7 +177,7 @@ int main(int argc, char** argv)
     }
     else
     {
-        while (ret == 0 && (opt = getopt(argc, argv, "f:s:m:S:x:nrh")) != -1) {
+        while (ret == 0 && (opt = getopt(argc, argv, "f:s:m:q:S:x:nrh")) != -1) {
             switch (opt) {
             case 'x': {
                 int test_number = get_test_number(optarg);
@@ -211,6 +216,13 @@ int main(int argc, char** argv)
                     ret = usage(argv[0]);
                 }
                 break;
+            case 'q':
+                huffman_bench_rounds = (uint64_t)atoi(optarg);
+                if (huffman_bench_rounds == 0) {
+                    fprintf(stderr, "Incorrect number of rounds for the Huffman benchmark: %s\n", optarg);
+                    ret = usage(argv[0]);
+                }
+                break;
             case 'S':
                 picoquic_set_solution_dir(optarg);
                 break;
@@ -280,7 +292,15 @@ int main(int argc, char** argv)
             }
         }
 
-        if (ret == 0)
+        if (ret == 0 && huffman_bench_rounds > 0) {
+            nb_test_tried++;
+            if (qpack_huffman_bench_do_test(huffman_bench_rounds, stdout) != 0) {
+                fprintf(stdout, "QPACK Huffman benchmark fails.\n");
+                nb_test_failed++;
+                ret = -1;
+            }
+        }
+        else if (ret == 0)
         {
             if (optind >= argc) {
                 for (size_t i = 0; i < nb_tests; i++) {
@@ -27,6 +27,7 @@
 #include "picoquic_internal.h"
 #include "bytestream.h"
 #include "csv.h"
+#include "coltrace.h"
 #include "svg.h"
 #include "qlog.h"
 #include "cidset.h"
@@ -48,11 +49,31 @@ typedef struct app_conversion_context_st
 
     uint64_t log_time;
     uint16_t flags;
+
+    binlog_filter_t filter;
+    int nb_threads;
 } app_conversion_context_t;
 
-int convert_csv(const picoquic_connection_id_t * cid, void * ptr);
+/* Parallel conversion of an indexed log. Each thread picks the next
+ * connection to convert, until all selected connections are done. */
+typedef struct st_indexed_conversion_t {
+    const app_conversion_context_t* appctx;
+    binlog_index_t* index;
+    binlog_cnx_index_t** selected;
+    size_t nb_selected;
+    uint64_t next_rank;
+    picoquic_mutex_t mutex;
+    picoquic_event_t done_event;
+    int nb_done;
+    int ret;
+} indexed_conversion_t;
+
+#define PICOLOG_OUTPUT_BUFFER_SIZE (1 << 20)
+
 int convert_svg(const picoquic_connection_id_t * cid, void * ptr);
-int convert_qlog(const picoquic_connection_id_t * cid, void * ptr);
+int convert_indexed(app_conversion_context_t* appctx, const picoquic_connection_id_t* cid);
+int parse_time_window(const char* arg, binlog_filter_t* filter);
+int parse_categories(const char* arg, binlog_filter_t* filter);
 int filedump_binlog(FILE* bin_log, FILE* bin_dump);
 
 int usage();
@@ -81,9 +102,11 @@ int main(int argc, char ** argv)
 
     app_conversion_context_t appctx = { 0 };
     appctx.out_format = "csv";
+    appctx.nb_threads = 1;
+    binlog_filter_init(&appctx.filter);
 
     int opt;
-    while ((opt = getopt(argc, argv, "o:f:t:c:h")) != -1) {
+    while ((opt = getopt(argc, argv, "o:f:t:c:n:w:e:p:h")) != -1) {
         switch (opt) {
         case 'o':
             appctx.out_dir = optarg;
@@ -97,6 +120,28 @@ int main(int argc, char ** argv)
         case 'c':
             cid_name = optarg;
             break;
+        case 'n':
+            if ((appctx.nb_threads = atoi(optarg)) <= 0) {
+                fprintf(stderr, "Invalid number of threads: %s\n", optarg);
+                return usage();
+            }
+            break;
+        case 'w':
+            if (parse_time_window(optarg, &appctx.filter) != 0) {
+                fprintf(stderr, "Invalid time window: %s\n", optarg);
+                return usage();
+            }
+            break;
+        case 'e':
+            if (parse_categories(optarg, &appctx.filter) != 0) {
+                fprintf(stderr, "Invalid event list: %s\n", optarg);
+                return usage();
+            }
+            break;
+        case 'p':
+            appctx.filter.filter_path = 1;
+            appctx.filter.path_id = (uint64_t)strtoull(optarg, NULL, 10);
+            break;
         case 'h':
         default:
             return usage();
@@ -147,6 +192,10 @@ int main(int argc, char ** argv)
                 }
             }
         }
+        else if (strcmp(appctx.out_format, "csv") == 0 || strcmp(appctx.out_format, "qlog") == 0 ||
+            strcmp(appctx.out_format, "coltrace") == 0) {
+            ret = convert_indexed(&appctx, (cid_name == NULL) ? NULL : &cid);
+        }
         else {
             if (appctx.template_name != NULL) {
                 appctx.f_template = picoquic_file_open(appctx.template_name, "r");
@@ -182,10 +231,7 @@ int main(int argc, char ** argv)
             }
 
             if (ret == 0) {
-                if (strcmp(appctx.out_format, "csv") == 0) {
-                    ret = cidset_iterate(cids, convert_csv, &appctx);
-                }
-                else if (strcmp(appctx.out_format, "svg") == 0) {
+                if (strcmp(appctx.out_format, "svg") == 0) {
                     if (appctx.f_template == NULL) {
                         fprintf(stderr, "The svg format conversion requires a template file specified by parameter -t\n");
                         ret = -1;
@@ -194,9 +240,6 @@ int main(int argc, char ** argv)
                         ret = cidset_iterate(cids, convert_svg, &appctx);
                     }
                 }
-                else if (strcmp(appctx.out_format, "qlog") == 0) {
-                    ret = cidset_iterate(cids, convert_qlog, &appctx);
-                }
                 else {
                     fprintf(stderr, "Invalid output format '%s'. Valid formats are\n\n", appctx.out_format);
                     usage_formats();
@@ -224,6 +267,12 @@ int usage()
     usage_formats();
     fprintf(stderr, "  -t template-file      template file for svg format conversion\n");
     fprintf(stderr, "  -c connection-id      only convert logs of specified connection id\n");
+    fprintf(stderr, "  -n threads            number of connections converted in parallel, default 1\n");
+    fprintf(stderr, "  -w start,end          only convert events in the time window, in seconds\n");
+    fprintf(stderr, "                        from the start of the connection, e.g. -w 10.5,12\n");
+    fprintf(stderr, "  -e event[,event...]   only convert these events: packet, recovery, cc,\n");
+    fprintf(stderr, "                        info, param\n");
+    fprintf(stderr, "  -p path-id            only convert the packet, recovery and cc events of the path\n");
     fprintf(stderr, "\n");
     fprintf(stderr, "picolog converts binary log files into the format specified. Output files are\n");
     fprintf(stderr, "placed in the specified directory with their connection-id as file name.\n");
@@ -231,6 +280,11 @@ int usage()
     fprintf(stderr, "If no connection id is specified all connections contained in the binary file\n");
     fprintf(stderr, "are converted producing as many output files as connections are found in the\n");
     fprintf(stderr, "binary file.\n");
+    fprintf(stderr, "\n");
+    fprintf(stderr, "The csv, qlog and coltrace conversions map the binary file in memory and\n");
+    fprintf(stderr, "index it once. The filters and the parallel conversion only apply to these\n");
+    fprintf(stderr, "formats. The coltrace files are binary, and are written in the current\n");
+    fprintf(stderr, "directory if no output directory is specified.\n");
     return 1;
 }
 
@@ -240,37 +294,263 @@ void usage_formats()
     fprintf(stderr, "                        -f svg  : generate svg packet flow diagram.\n");
     fprintf(stderr, "                                  requires a template specified by -t\n");
     fprintf(stderr, "                        -f qlog : generate IETF QLOG file\n");
+    fprintf(stderr, "                        -f coltrace : generate columnar per packet trace\n");
 }
 
-int convert_csv(const picoquic_connection_id_t * cid, void * ptr)
+int convert_svg(const picoquic_connection_id_t * cid, void * ptr)
 {
     const app_conversion_context_t* appctx = (const app_conversion_context_t*)ptr;
+    return svg_convert(cid, appctx->f_binlog, appctx->f_template, appctx->binlog_name, appctx->out_dir);
+}
+
+int parse_time_window(const char* arg, binlog_filter_t* filter)
+{
+    int ret = 0;
+    char* end = NULL;
+    double t_start = strtod(arg, &end);
+    double t_end = -1.0;
+
+    if (end == arg || t_start < 0) {
+        ret = -1;
+    }
+    else if (*end == ',') {
+        const char* arg_end = end + 1;
+        t_end = strtod(arg_end, &end);
+        if (end == arg_end || t_end < t_start) {
+            ret = -1;
+        }
+    }
+    else if (*end != 0) {
+        ret = -1;
+    }
+
+    if (ret == 0) {
+        filter->time_min = (uint64_t)(t_start * 1000000.0);
+        filter->time_max = (t_end < 0) ? UINT64_MAX : (uint64_t)(t_end * 1000000.0);
+    }
+
+    return ret;
+}
+
+int parse_categories(const char* arg, binlog_filter_t* filter)
+{
+    static const struct {
+        const char* name;
+        uint32_t category;
+    } category_names[] = {
+        { "packet", BINLOG_CATEGORY_PACKET },
+        { "recovery", BINLOG_CATEGORY_RECOVERY },
+        { "cc", BINLOG_CATEGORY_CC },
+        { "info", BINLOG_CATEGORY_INFO },
+        { "param", BINLOG_CATEGORY_PARAM }
+    };
     int ret = 0;
 
+    filter->category_mask = 0;
+    while (ret == 0 && *arg != 0) {
+        size_t len = 0;
+        size_t i;
+
+        while (arg[len] != 0 && arg[len] != ',') {
+            len++;
+        }
+        for (i = 0; i < sizeof(category_names) / sizeof(category_names[0]); i++) {
+            if (strlen(category_names[i].name) == len && memcmp(category_names[i].name, arg, len) == 0) {
+                filter->category_mask |= category_names[i].category;
+                break;
+            }
+        }
+        if (i >= sizeof(category_names) / sizeof(category_names[0])) {
+            ret = -1;
+        }
+        arg += (arg[len] == ',') ? len + 1 : len;
+    }
+
+    return ret;
+}
+
+static int convert_one_indexed(const app_conversion_context_t* appctx, binlog_index_t* index, binlog_cnx_index_t* cnx)
+{
+    int ret = 0;
+    int is_qlog = (strcmp(appctx->out_format, "qlog") == 0);
+    int is_coltrace = (strcmp(appctx->out_format, "coltrace") == 0);
     char cid_name[2 * PICOQUIC_CONNECTION_ID_MAX_SIZE + 1];
-    if (picoquic_print_connection_id_hexa(cid_name, sizeof(cid_name), cid) != 0) {
+    FILE* f_out = NULL;
+
+    if (picoquic_print_connection_id_hexa(cid_name, sizeof(cid_name), &cnx->cid) != 0) {
         DBG_PRINTF("Cannot convert connection id for %s", appctx->binlog_name);
         ret = -1;
     }
+    else if (is_coltrace) {
+        /* Binary output, never written to stdout */
+        char trace_name[512];
 
-    if (ret == 0) {
-        ret = picoquic_cc_bin_to_csv(appctx->f_binlog,
-            open_outfile(cid_name, appctx->binlog_name, appctx->out_dir, "csv"));
+        if (picoquic_sprintf(trace_name, sizeof(trace_name), NULL, "%s%s%s.coltrace",
+            (appctx->out_dir == NULL) ? "." : appctx->out_dir, PICOQUIC_FILE_SEPARATOR, cid_name) != 0) {
+            ret = -1;
+        }
+        else if ((f_out = picoquic_file_open(trace_name, "wb")) == NULL) {
+            fprintf(stderr, "Could not open '%s' for writing (err=%d)", trace_name, errno);
+            ret = -1;
+        }
+        else {
+            (void)setvbuf(f_out, NULL, _IOFBF, PICOLOG_OUTPUT_BUFFER_SIZE);
+            ret = coltrace_convert_index(index, cnx, &appctx->filter, f_out);
+            (void)picoquic_file_close(f_out);
+        }
+    }
+    else if ((f_out = open_outfile(cid_name, appctx->binlog_name, appctx->out_dir, (is_qlog) ? "qlog" : "csv")) == NULL) {
+        ret = -1;
+    }
+    else {
+        /* Large output buffers, so formatting is not slowed down by file writes */
+        if (f_out != stdout) {
+            (void)setvbuf(f_out, NULL, _IOFBF, PICOLOG_OUTPUT_BUFFER_SIZE);
+        }
+        if (is_qlog) {
+            ret = qlog_convert_index(index, cnx, &appctx->filter, f_out);
+        }
+        else {
+            ret = picoquic_cc_index_to_csv(index, cnx, &appctx->filter, f_out);
+        }
+        if (f_out != stdout) {
+            (void)picoquic_file_close(f_out);
+        }
     }
 
     return ret;
 }
 
-int convert_svg(const picoquic_connection_id_t * cid, void * ptr)
+static picoquic_thread_return_t convert_indexed_worker(void* arg)
 {
-    const app_conversion_context_t* appctx = (const app_conversion_context_t*)ptr;
-    return svg_convert(cid, appctx->f_binlog, appctx->f_template, appctx->binlog_name, appctx->out_dir);
+    indexed_conversion_t* conv = (indexed_conversion_t*)arg;
+    int ret = 0;
+    uint64_t rank;
+
+    while (ret == 0 && (rank = PICOQUIC_ATOMIC_INC_64(&conv->next_rank) - 1) < conv->nb_selected) {
+        ret = convert_one_indexed(conv->appctx, conv->index, conv->selected[rank]);
+    }
+
+    (void)picoquic_lock_mutex(&conv->mutex);
+    if (ret != 0) {
+        conv->ret = ret;
+    }
+    conv->nb_done++;
+    (void)picoquic_unlock_mutex(&conv->mutex);
+    (void)picoquic_signal_event(&conv->done_event);
+
+    picoquic_thread_do_return;
 }
 
-int convert_qlog(const picoquic_connection_id_t * cid, void * ptr)
+/* Map and index the binary log, then convert the selected connections,
+ * possibly in parallel. The calling thread is one of the workers. */
+int convert_indexed(app_conversion_context_t* appctx, const picoquic_connection_id_t* cid)
 {
-    const app_conversion_context_t* appctx = (const app_conversion_context_t*)ptr;
-    return qlog_convert(cid, appctx->f_binlog, appctx->binlog_name, NULL, appctx->out_dir, appctx->flags);
+    int ret = 0;
+    indexed_conversion_t conv;
+    binlog_index_t* index = binlog_index_open(appctx->binlog_name);
+
+    memset(&conv, 0, sizeof(conv));
+
+    if (index == NULL) {
+        fprintf(stderr, "Could not index log file %s\n", appctx->binlog_name);
+        return -1;
+    }
+
+    fprintf(stderr, "%s contains %zu connection(s):\n\n", appctx->binlog_name, index->nb_cnx);
+    for (size_t i = 0; i < index->nb_cnx; i++) {
+        fprintf(stderr, "  <");
+        for (uint8_t x = 0; x < index->cnx[i]->cid.id_len; x++) {
+            fprintf(stderr, "%02x", index->cnx[i]->cid.id[x]);
+        }
+        fprintf(stderr, "> %zu events\n", index->cnx[i]->nb_events);
+    }
+    fprintf(stderr, "\n");
+
+    conv.appctx = appctx;
+    conv.index = index;
+    if (cid == NULL) {
+        conv.selected = index->cnx;
+        conv.nb_selected = index->nb_cnx;
+    }
+    else if ((conv.selected = (binlog_cnx_index_t**)malloc(sizeof(binlog_cnx_index_t*))) == NULL) {
+        ret = -1;
+    }
+    else if ((conv.selected[0] = binlog_index_find(index, cid)) == NULL) {
+        fprintf(stderr, "%s does not contain the requested connection\n", appctx->binlog_name);
+        ret = -1;
+    }
+    else {
+        conv.nb_selected = 1;
+    }
+
+    if (ret == 0) {
+        int nb_threads = appctx->nb_threads;
+        picoquic_thread_t* threads = NULL;
+        int nb_started = 0;
+        int to_stdout = (appctx->out_dir == NULL && strcmp(appctx->out_format, "coltrace") != 0);
+
+        if (to_stdout || (size_t)nb_threads > conv.nb_selected) {
+            /* Writing to stdout in parallel would mix the outputs */
+            nb_threads = (to_stdout || conv.nb_selected == 0) ? 1 : (int)conv.nb_selected;
+        }
+        if (nb_threads > 1) {
+            threads = (picoquic_thread_t*)malloc(sizeof(picoquic_thread_t) * (nb_threads - 1));
+            if (threads == NULL || picoquic_create_mutex(&conv.mutex) != 0) {
+                ret = -1;
+            }
+            else if (picoquic_create_event(&conv.done_event) != 0) {
+                (void)picoquic_delete_mutex(&conv.mutex);
+                ret = -1;
+            }
+            while (ret == 0 && nb_started < nb_threads - 1 &&
+                picoquic_create_thread(&threads[nb_started], convert_indexed_worker, &conv) == 0) {
+                nb_started++;
+            }
+        }
+
+        if (ret == 0) {
+            uint64_t rank;
+
+            while (ret == 0 && (rank = PICOQUIC_ATOMIC_INC_64(&conv.next_rank) - 1) < conv.nb_selected) {
+                ret = convert_one_indexed(appctx, index, conv.selected[rank]);
+            }
+
+            if (nb_started > 0) {
+                int nb_done = 0;
+
+                while (nb_done < nb_started) {
+                    (void)picoquic_lock_mutex(&conv.mutex);
+                    nb_done = conv.nb_done;
+                    (void)picoquic_unlock_mutex(&conv.mutex);
+                    if (nb_done < nb_started) {
+                        (void)picoquic_wait_for_event(&conv.done_event, 100000);
+                    }
+                }
+                for (int i = 0; i < nb_started; i++) {
+                    picoquic_delete_thread(&threads[i]);
+                }
+                if (ret == 0) {
+                    ret = conv.ret;
+                }
+            }
+            if (nb_threads > 1) {
+                picoquic_delete_event(&conv.done_event);
+                (void)picoquic_delete_mutex(&conv.mutex);
+            }
+        }
+
+        if (threads != NULL) {
+            free(threads);
+        }
+    }
+
+    if (cid != NULL && conv.selected != NULL) {
+        free(conv.selected);
+    }
+    binlog_index_close(index);
+
+    return ret;
 }
 
 int filedump_binlog(FILE* bin_log, FILE* bin_dump)
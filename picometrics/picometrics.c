@@ -0,0 +1,105 @@
+/*
+* picometrics: scrape the live metrics published by picoquic contexts.
+*
+* Each QUIC context for which metrics are enabled with a segment name
+* publishes its counters, gauges and histograms in a shared memory
+* segment. This tool maps the segments read only, takes a snapshot and
+* prints it, optionally at regular intervals. Nothing is written to the
+* segments, so scraping has no effect on the data path.
+*
+* Usage: picometrics [-i interval_ms] [-n count] segment_name [segment_name...]
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#ifdef _WINDOWS
+#include <Windows.h>
+#include "../picoquicfirst/getopt.h"
+#else
+#include <unistd.h>
+#endif
+
+#include "picoquic_metrics.h"
+
+static int usage()
+{
+    fprintf(stderr, "PicoQUIC metrics reader\n");
+    fprintf(stderr, "Usage: picometrics <options> segment_name [segment_name...]\n\n");
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  -i interval_ms      print the metrics every interval_ms milliseconds\n");
+    fprintf(stderr, "  -n count            number of times the metrics are printed, default 1\n");
+    fprintf(stderr, "  -h                  this help message\n");
+    return 1;
+}
+
+static void sleep_ms(unsigned int interval_ms)
+{
+#ifdef _WINDOWS
+    Sleep(interval_ms);
+#else
+    (void)usleep((useconds_t)interval_ms * 1000);
+#endif
+}
+
+int main(int argc, char** argv)
+{
+    int ret = 0;
+    int opt;
+    unsigned int interval_ms = 0;
+    int count = 1;
+
+    while ((opt = getopt(argc, argv, "i:n:h")) != -1) {
+        switch (opt) {
+        case 'i':
+            interval_ms = (unsigned int)atoi(optarg);
+            break;
+        case 'n':
+            count = atoi(optarg);
+            break;
+        case 'h':
+        default:
+            return usage();
+        }
+    }
+
+    if (optind >= argc) {
+        return usage();
+    }
+
+    if (interval_ms > 0 && count == 1) {
+        count = -1;
+    }
+
+    for (int i = 0; ret == 0 && (count < 0 || i < count); i++) {
+        if (i > 0) {
+            sleep_ms(interval_ms);
+        }
+        for (int j = optind; j < argc; j++) {
+            picoquic_metrics_segment_t const* segment = picoquic_metrics_open_segment(argv[j]);
+
+            if (segment == NULL) {
+                fprintf(stderr, "Cannot open metrics segment %s\n", argv[j]);
+                ret = -1;
+                break;
+            }
+            else {
+                picoquic_metrics_segment_t* snapshot = (picoquic_metrics_segment_t*)malloc(sizeof(picoquic_metrics_segment_t));
+
+                if (snapshot == NULL) {
+                    ret = -1;
+                }
+                else {
+                    picoquic_metrics_snapshot(segment, snapshot);
+                    printf("# segment %s pid %u\n", argv[j], snapshot->writer_pid);
+                    picoquic_metrics_print(stdout, snapshot);
+                    free(snapshot);
+                }
+                picoquic_metrics_close_segment(segment);
+            }
+        }
+        fflush(stdout);
+    }
+
+    return (ret == 0) ? 0 : 1;
+}
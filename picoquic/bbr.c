@@ -1157,12 +1157,22 @@ void picoquic_bbr_observe(picoquic_path_t* path_x, uint64_t* cc_state, uint64_t*
 
 #define picoquic_bbr_ID "bbr" /* BBR */
 
+/* The bytes acknowledged are summed and only used once the bandwidth is measured,
+ * so the aggregated ACK event replays as a single acknowledgement. */
+static void picoquic_bbr_notify_ack(picoquic_cnx_t* cnx, picoquic_path_t* path_x,
+    picoquic_per_ack_state_t const* ack_state, uint64_t current_time)
+{
+    picoquic_cc_replay_ack_event(picoquic_bbr_notify, cnx, path_x, ack_state, current_time);
+}
+
 picoquic_congestion_algorithm_t picoquic_bbr_algorithm_struct = {
     picoquic_bbr_ID, PICOQUIC_CC_ALGO_NUMBER_BBR,
     picoquic_bbr_init,
     picoquic_bbr_notify,
     picoquic_bbr_delete,
-    picoquic_bbr_observe
+    picoquic_bbr_observe,
+    0,
+    picoquic_bbr_notify_ack
 };
 
 picoquic_congestion_algorithm_t* picoquic_bbr_algorithm = &picoquic_bbr_algorithm_struct;
\ No newline at end of file
@@ -0,0 +1,766 @@
+/* BBRv3 congestion control.
+ *
+ * This follows the BBRv3 model: the max bandwidth is estimated from the
+ * delivery rate samples computed by picoquic_estimate_path_bandwidth, and the
+ * min RTT from the RTT samples. In addition to the BBRv1 model (see bbr.c),
+ * the algorithm keeps track of two bounds on the data in flight:
+ *
+ * - inflight_hi, the long term bound, is set when a bandwidth probe causes
+ *   a loss rate above 2% or a CE marking rate above 50%, and grows slowly
+ *   while probing up.
+ * - inflight_lo and bw_lo, the short term bounds, are reduced by a factor
+ *   beta = 0.7 in each round with excessive losses, and in proportion to the
+ *   smoothed fraction of CE marks when the peer reports them. They are reset
+ *   at the start of each bandwidth probe.
+ *
+ * ProbeBW cycles through DOWN, CRUISE, REFILL and UP. The wait between two
+ * probes is 2 to 3 seconds, or the number of rounds that Reno would need to
+ * grow its window by one BDP, if that is shorter. In CRUISE, the window
+ * leaves 15% of inflight_hi as headroom for competing flows. This is what
+ * keeps the loss rate low on shallow buffers, where BBRv1 keeps probing at
+ * 1.25 times the bandwidth every 8 round trips regardless of losses.
+ *
+ * The state is kept inline in the path context (congestion_alg_inline), so
+ * creating a path does not allocate memory, and the per ACK processing only
+ * uses integer arithmetic and a bounded number of operations: gains are
+ * expressed in units of 1/256, the max bandwidth filter has two slots, and
+ * losses and CE marks are accounted from the path and ACK_ECN counters
+ * instead of per packet samples.
+ */
+
+#include "picoquic_internal.h"
+#include <stdlib.h>
+#include <string.h>
+#include "cc_common.h"
+
+#define BBR3_UNIT_SHIFT 8
+#define BBR3_UNIT (1 << BBR3_UNIT_SHIFT)
+#define BBR3_STARTUP_PACING_GAIN 709 /* 2.77 */
+#define BBR3_STARTUP_CWND_GAIN 512 /* 2.0 */
+#define BBR3_DRAIN_PACING_GAIN 89 /* 0.35 */
+#define BBR3_CWND_GAIN 512 /* 2.0 */
+#define BBR3_PROBE_UP_PACING_GAIN 320 /* 1.25 */
+#define BBR3_PROBE_UP_CWND_GAIN 576 /* 2.25 */
+#define BBR3_PROBE_DOWN_PACING_GAIN 230 /* 0.90 */
+#define BBR3_PROBE_RTT_CWND_GAIN 128 /* 0.5 */
+#define BBR3_BETA 179 /* 0.7 */
+#define BBR3_HEADROOM 38 /* 0.15 */
+#define BBR3_LOSS_THRESH 5 /* 2% */
+#define BBR3_ECN_THRESH 128 /* 50% */
+#define BBR3_ECN_FACTOR 85 /* 1/3 */
+#define BBR3_ECN_ALPHA_G_SHIFT 4 /* ecn_alpha gain is 1/16 */
+#define BBR3_FULL_BW_THRESH 320 /* 1.25 */
+#define BBR3_FULL_BW_COUNT 3
+#define BBR3_PACING_MARGIN_PERCENT 1
+#define BBR3_MIN_RTT_FILTER_LEN 10000000 /* 10 seconds */
+#define BBR3_PROBE_RTT_INTERVAL 5000000 /* 5 seconds */
+#define BBR3_PROBE_RTT_DURATION 200000 /* 200 ms */
+#define BBR3_PROBE_WAIT_BASE 2000000 /* 2 seconds */
+#define BBR3_PROBE_WAIT_RAND 1000000 /* plus up to 1 second */
+#define BBR3_MAX_RENO_ROUNDS 63
+#define BBR3_MAX_PROBE_UP_ROUNDS 30
+#define BBR3_PACING_RATE_LOW 150000 /* 1.2 Mbps */
+#define BBR3_SEND_QUANTUM_MAX 0x10000
+#define BBR3_MIN_PIPE_CWND(mtu) (4*(uint64_t)(mtu))
+
+typedef enum {
+    picoquic_bbr3_alg_startup = 0,
+    picoquic_bbr3_alg_drain,
+    picoquic_bbr3_alg_probe_bw_down,
+    picoquic_bbr3_alg_probe_bw_cruise,
+    picoquic_bbr3_alg_probe_bw_refill,
+    picoquic_bbr3_alg_probe_bw_up,
+    picoquic_bbr3_alg_probe_rtt
+} picoquic_bbr3_alg_state_t;
+
+typedef struct st_picoquic_bbr3_state_t {
+    picoquic_bbr3_alg_state_t state;
+    uint32_t pacing_gain;
+    uint32_t cwnd_gain;
+    int full_bw_count;
+    /* Network model */
+    uint64_t max_bw;
+    uint64_t max_bw_filter[2];
+    uint64_t bw_lo;
+    uint64_t bw;
+    uint64_t bw_latest;
+    uint64_t inflight_hi;
+    uint64_t inflight_lo;
+    uint64_t inflight_latest;
+    uint64_t min_rtt;
+    uint64_t min_rtt_stamp;
+    uint64_t probe_rtt_min_delay;
+    uint64_t probe_rtt_min_stamp;
+    uint64_t probe_rtt_done_stamp;
+    uint64_t full_bw;
+    uint64_t ecn_alpha;
+    /* Round trip accounting */
+    uint64_t next_round_delivered;
+    uint64_t round_count;
+    uint64_t round_delivered_base;
+    uint64_t round_lost_base;
+    uint64_t round_ect_base;
+    uint64_t round_ce_base;
+    /* ProbeBW cycle */
+    uint64_t cycle_stamp;
+    uint64_t bw_probe_wait;
+    uint64_t rounds_since_bw_probe;
+    uint64_t bw_probe_up_cnt;
+    uint64_t bw_probe_up_acks;
+    uint64_t bw_probe_up_rounds;
+    /* Control parameters */
+    uint64_t bytes_delivered;
+    uint64_t prior_cwnd;
+    uint64_t pacing_rate;
+    uint64_t send_quantum;
+    uint64_t random_state;
+    unsigned int filled_pipe : 1;
+    unsigned int round_start : 1;
+    unsigned int probe_rtt_round_done : 1;
+    unsigned int probe_rtt_expired : 1;
+    unsigned int loss_in_round : 1;
+    unsigned int ecn_in_round : 1;
+    unsigned int inflight_hi_set_in_round : 1;
+} picoquic_bbr3_state_t;
+
+/* Compile time check that the state fits in the inline storage of the path */
+typedef char picoquic_bbr3_state_fits_inline[(sizeof(picoquic_bbr3_state_t) <=
+    sizeof(((picoquic_path_t*)0)->congestion_alg_inline)) ? 1 : -1];
+
+static uint64_t picoquic_bbr3_random(picoquic_bbr3_state_t* bbr3, uint64_t range)
+{
+    /* xorshift64, so simulations are reproducible */
+    bbr3->random_state ^= bbr3->random_state << 13;
+    bbr3->random_state ^= bbr3->random_state >> 7;
+    bbr3->random_state ^= bbr3->random_state << 17;
+    return (range == 0) ? 0 : bbr3->random_state % range;
+}
+
+static uint64_t picoquic_bbr3_bdp(picoquic_bbr3_state_t* bbr3, uint64_t bw, uint32_t gain)
+{
+    if (bbr3->min_rtt == UINT64_MAX) {
+        return (PICOQUIC_CWIN_INITIAL * (uint64_t)gain) >> BBR3_UNIT_SHIFT;
+    }
+    return ((bw * bbr3->min_rtt / 1000000) * gain) >> BBR3_UNIT_SHIFT;
+}
+
+static uint64_t picoquic_bbr3_inflight(picoquic_bbr3_state_t* bbr3, uint64_t bw, uint32_t gain)
+{
+    return picoquic_bbr3_bdp(bbr3, bw, gain) + 3 * bbr3->send_quantum;
+}
+
+static uint64_t picoquic_bbr3_inflight_with_headroom(picoquic_bbr3_state_t* bbr3, picoquic_path_t* path_x)
+{
+    uint64_t headroom;
+    uint64_t inflight;
+
+    if (bbr3->inflight_hi == UINT64_MAX) {
+        return UINT64_MAX;
+    }
+    headroom = (bbr3->inflight_hi * BBR3_HEADROOM) >> BBR3_UNIT_SHIFT;
+    if (headroom < path_x->send_mtu) {
+        headroom = path_x->send_mtu;
+    }
+    inflight = (bbr3->inflight_hi > headroom) ? bbr3->inflight_hi - headroom : 0;
+    if (inflight < BBR3_MIN_PIPE_CWND(path_x->send_mtu)) {
+        inflight = BBR3_MIN_PIPE_CWND(path_x->send_mtu);
+    }
+    return inflight;
+}
+
+static void picoquic_bbr3_set_gains(picoquic_bbr3_state_t* bbr3, picoquic_bbr3_alg_state_t state,
+    uint32_t pacing_gain, uint32_t cwnd_gain)
+{
+    bbr3->state = state;
+    bbr3->pacing_gain = pacing_gain;
+    bbr3->cwnd_gain = cwnd_gain;
+}
+
+static void picoquic_bbr3_start_round(picoquic_bbr3_state_t* bbr3, picoquic_path_t* path_x)
+{
+    bbr3->next_round_delivered = path_x->delivered;
+}
+
+static void picoquic_bbr3_reset_lower_bounds(picoquic_bbr3_state_t* bbr3)
+{
+    bbr3->bw_lo = UINT64_MAX;
+    bbr3->inflight_lo = UINT64_MAX;
+}
+
+static void picoquic_bbr3_reset_round_counters(picoquic_bbr3_state_t* bbr3, picoquic_cnx_t* cnx, picoquic_path_t* path_x)
+{
+    picoquic_packet_context_t* pkt_ctx = &cnx->pkt_ctx[picoquic_packet_context_application];
+
+    bbr3->round_delivered_base = path_x->delivered;
+    bbr3->round_lost_base = path_x->total_bytes_lost;
+    bbr3->round_ce_base = pkt_ctx->ecn_ce_total_remote;
+    bbr3->round_ect_base = pkt_ctx->ecn_ect0_total_remote + pkt_ctx->ecn_ect1_total_remote;
+    bbr3->bw_latest = 0;
+    bbr3->loss_in_round = 0;
+    bbr3->ecn_in_round = 0;
+    bbr3->inflight_hi_set_in_round = 0;
+}
+
+static void picoquic_bbr3_reset(picoquic_bbr3_state_t* bbr3, picoquic_cnx_t* cnx, picoquic_path_t* path_x, uint64_t current_time)
+{
+    memset(bbr3, 0, sizeof(picoquic_bbr3_state_t));
+    path_x->cwin = PICOQUIC_CWIN_INITIAL;
+    bbr3->random_state = current_time ^ 0x9e3779b97f4a7c15ull;
+    bbr3->min_rtt = UINT64_MAX;
+    bbr3->min_rtt_stamp = current_time;
+    bbr3->probe_rtt_min_delay = UINT64_MAX;
+    bbr3->probe_rtt_min_stamp = current_time;
+    bbr3->inflight_hi = UINT64_MAX;
+    bbr3->bw_probe_up_cnt = UINT64_MAX;
+    bbr3->send_quantum = 2 * (uint64_t)path_x->send_mtu;
+    picoquic_bbr3_reset_lower_bounds(bbr3);
+    picoquic_bbr3_start_round(bbr3, path_x);
+    if (cnx != NULL) {
+        picoquic_bbr3_reset_round_counters(bbr3, cnx, path_x);
+    }
+    picoquic_bbr3_set_gains(bbr3, picoquic_bbr3_alg_startup, BBR3_STARTUP_PACING_GAIN, BBR3_STARTUP_CWND_GAIN);
+}
+
+static void picoquic_bbr3_init(picoquic_path_t* path_x, uint64_t current_time)
+{
+    picoquic_bbr3_state_t* bbr3 = (picoquic_bbr3_state_t*)path_x->congestion_alg_inline;
+
+    picoquic_bbr3_reset(bbr3, NULL, path_x, current_time);
+    path_x->congestion_alg_state = (void*)bbr3;
+}
+
+static void picoquic_bbr3_delete(picoquic_path_t* path_x)
+{
+    /* The state is inline, there is nothing to free */
+    path_x->congestion_alg_state = NULL;
+}
+
+/* ProbeBW state transitions */
+
+static void picoquic_bbr3_advance_max_bw_filter(picoquic_bbr3_state_t* bbr3)
+{
+    bbr3->max_bw_filter[1] = bbr3->max_bw_filter[0];
+    bbr3->max_bw_filter[0] = 0;
+}
+
+static void picoquic_bbr3_start_probe_bw_down(picoquic_bbr3_state_t* bbr3, picoquic_path_t* path_x, uint64_t current_time)
+{
+    bbr3->bw_probe_up_cnt = UINT64_MAX;
+    bbr3->rounds_since_bw_probe = picoquic_bbr3_random(bbr3, 2);
+    bbr3->bw_probe_wait = BBR3_PROBE_WAIT_BASE + picoquic_bbr3_random(bbr3, BBR3_PROBE_WAIT_RAND);
+    bbr3->cycle_stamp = current_time;
+    picoquic_bbr3_advance_max_bw_filter(bbr3);
+    picoquic_bbr3_start_round(bbr3, path_x);
+    picoquic_bbr3_set_gains(bbr3, picoquic_bbr3_alg_probe_bw_down, BBR3_PROBE_DOWN_PACING_GAIN, BBR3_CWND_GAIN);
+}
+
+static void picoquic_bbr3_start_probe_bw_cruise(picoquic_bbr3_state_t* bbr3)
+{
+    picoquic_bbr3_set_gains(bbr3, picoquic_bbr3_alg_probe_bw_cruise, BBR3_UNIT, BBR3_CWND_GAIN);
+}
+
+static void picoquic_bbr3_start_probe_bw_refill(picoquic_bbr3_state_t* bbr3, picoquic_path_t* path_x)
+{
+    picoquic_bbr3_reset_lower_bounds(bbr3);
+    bbr3->bw_probe_up_rounds = 0;
+    bbr3->bw_probe_up_acks = 0;
+    picoquic_bbr3_start_round(bbr3, path_x);
+    picoquic_bbr3_set_gains(bbr3, picoquic_bbr3_alg_probe_bw_refill, BBR3_UNIT, BBR3_CWND_GAIN);
+}
+
+/* Grow inflight_hi exponentially in each round of probing: by one packet
+ * per round, then 2, 4, etc. */
+static void picoquic_bbr3_raise_inflight_hi_slope(picoquic_bbr3_state_t* bbr3, picoquic_path_t* path_x)
+{
+    uint64_t growth_this_round = ((uint64_t)path_x->send_mtu) << bbr3->bw_probe_up_rounds;
+
+    if (bbr3->bw_probe_up_rounds < BBR3_MAX_PROBE_UP_ROUNDS) {
+        bbr3->bw_probe_up_rounds++;
+    }
+    bbr3->bw_probe_up_cnt = path_x->cwin / growth_this_round;
+    if (bbr3->bw_probe_up_cnt == 0) {
+        bbr3->bw_probe_up_cnt = 1;
+    }
+}
+
+static void picoquic_bbr3_start_probe_bw_up(picoquic_bbr3_state_t* bbr3, picoquic_path_t* path_x, uint64_t current_time)
+{
+    bbr3->cycle_stamp = current_time;
+    picoquic_bbr3_start_round(bbr3, path_x);
+    picoquic_bbr3_raise_inflight_hi_slope(bbr3, path_x);
+    picoquic_bbr3_set_gains(bbr3, picoquic_bbr3_alg_probe_bw_up, BBR3_PROBE_UP_PACING_GAIN, BBR3_PROBE_UP_CWND_GAIN);
+}
+
+static void picoquic_bbr3_probe_inflight_hi_upward(picoquic_bbr3_state_t* bbr3, picoquic_path_t* path_x, uint64_t bytes_acked)
+{
+    if (bbr3->inflight_hi != UINT64_MAX && path_x->cwin >= bbr3->inflight_hi) {
+        bbr3->bw_probe_up_acks += bytes_acked;
+        if (bbr3->bw_probe_up_acks >= bbr3->bw_probe_up_cnt) {
+            uint64_t delta = bbr3->bw_probe_up_acks / bbr3->bw_probe_up_cnt;
+            bbr3->bw_probe_up_acks -= delta * bbr3->bw_probe_up_cnt;
+            bbr3->inflight_hi += delta * path_x->send_mtu;
+        }
+        if (bbr3->round_start) {
+            picoquic_bbr3_raise_inflight_hi_slope(bbr3, path_x);
+        }
+    }
+}
+
+/* Probe again when it is time, or when Reno would have grown its window by one BDP */
+static int picoquic_bbr3_is_time_to_probe_bw(picoquic_bbr3_state_t* bbr3, picoquic_path_t* path_x, uint64_t current_time)
+{
+    uint64_t reno_rounds = picoquic_bbr3_inflight(bbr3, bbr3->bw, BBR3_UNIT) / path_x->send_mtu;
+
+    if (reno_rounds > BBR3_MAX_RENO_ROUNDS) {
+        reno_rounds = BBR3_MAX_RENO_ROUNDS;
+    }
+    if (current_time - bbr3->cycle_stamp > bbr3->bw_probe_wait || bbr3->rounds_since_bw_probe >= reno_rounds) {
+        picoquic_bbr3_start_probe_bw_refill(bbr3, path_x);
+        return 1;
+    }
+    return 0;
+}
+
+static void picoquic_bbr3_update_probe_bw_cycle(picoquic_bbr3_state_t* bbr3, picoquic_path_t* path_x,
+    uint64_t bytes_acked, uint64_t current_time)
+{
+    if (!bbr3->filled_pipe) {
+        return;
+    }
+
+    switch (bbr3->state) {
+    case picoquic_bbr3_alg_probe_bw_down:
+        if (!picoquic_bbr3_is_time_to_probe_bw(bbr3, path_x, current_time) &&
+            path_x->bytes_in_transit <= picoquic_bbr3_inflight_with_headroom(bbr3, path_x) &&
+            path_x->bytes_in_transit <= picoquic_bbr3_inflight(bbr3, bbr3->max_bw, BBR3_UNIT)) {
+            picoquic_bbr3_start_probe_bw_cruise(bbr3);
+        }
+        break;
+    case picoquic_bbr3_alg_probe_bw_cruise:
+        (void)picoquic_bbr3_is_time_to_probe_bw(bbr3, path_x, current_time);
+        break;
+    case picoquic_bbr3_alg_probe_bw_refill:
+        if (bbr3->round_start) {
+            picoquic_bbr3_start_probe_bw_up(bbr3, path_x, current_time);
+        }
+        break;
+    case picoquic_bbr3_alg_probe_bw_up:
+        picoquic_bbr3_probe_inflight_hi_upward(bbr3, path_x, bytes_acked);
+        if (current_time - bbr3->cycle_stamp > bbr3->min_rtt &&
+            path_x->bytes_in_transit > picoquic_bbr3_inflight(bbr3, bbr3->max_bw, BBR3_PROBE_UP_PACING_GAIN)) {
+            picoquic_bbr3_start_probe_bw_down(bbr3, path_x, current_time);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/* Congestion signals: losses and CE marks are counted per round trip, from
+ * the path loss counter and the ECN counters reported by the peer. */
+
+static int picoquic_bbr3_is_probing_bw(picoquic_bbr3_state_t* bbr3)
+{
+    return bbr3->state == picoquic_bbr3_alg_startup || bbr3->state == picoquic_bbr3_alg_probe_bw_refill ||
+        bbr3->state == picoquic_bbr3_alg_probe_bw_up;
+}
+
+static void picoquic_bbr3_handle_inflight_too_high(picoquic_bbr3_state_t* bbr3, picoquic_path_t* path_x, uint64_t current_time)
+{
+    uint64_t target = (picoquic_bbr3_bdp(bbr3, bbr3->max_bw, BBR3_UNIT) * BBR3_BETA) >> BBR3_UNIT_SHIFT;
+
+    bbr3->inflight_hi = (path_x->bytes_in_transit > target) ? path_x->bytes_in_transit : target;
+    if (bbr3->inflight_hi < BBR3_MIN_PIPE_CWND(path_x->send_mtu)) {
+        bbr3->inflight_hi = BBR3_MIN_PIPE_CWND(path_x->send_mtu);
+    }
+    bbr3->inflight_hi_set_in_round = 1;
+
+    if (bbr3->state == picoquic_bbr3_alg_startup) {
+        bbr3->filled_pipe = 1;
+        picoquic_bbr3_set_gains(bbr3, picoquic_bbr3_alg_drain, BBR3_DRAIN_PACING_GAIN, BBR3_STARTUP_CWND_GAIN);
+    }
+    else if (bbr3->state == picoquic_bbr3_alg_probe_bw_up || bbr3->state == picoquic_bbr3_alg_probe_bw_refill) {
+        picoquic_bbr3_start_probe_bw_down(bbr3, path_x, current_time);
+    }
+}
+
+static void picoquic_bbr3_check_loss_too_high(picoquic_bbr3_state_t* bbr3, picoquic_path_t* path_x, uint64_t current_time)
+{
+    uint64_t lost = (path_x->total_bytes_lost > bbr3->round_lost_base) ? path_x->total_bytes_lost - bbr3->round_lost_base : 0;
+
+    if (lost > 0) {
+        /* Approximate the data in flight when the lost packets were sent by the
+         * data sent in the round, lost, delivered or still in transit */
+        uint64_t flight = lost + (path_x->delivered - bbr3->round_delivered_base) + path_x->bytes_in_transit;
+
+        if ((lost << BBR3_UNIT_SHIFT) > BBR3_LOSS_THRESH * flight) {
+            bbr3->loss_in_round = 1;
+            if (picoquic_bbr3_is_probing_bw(bbr3) && !bbr3->inflight_hi_set_in_round) {
+                picoquic_bbr3_handle_inflight_too_high(bbr3, path_x, current_time);
+            }
+        }
+    }
+}
+
+/* At the end of a round, update the ECN alpha and adapt the lower bounds
+ * if the round saw too many losses or CE marks. */
+static void picoquic_bbr3_end_of_round(picoquic_bbr3_state_t* bbr3, picoquic_cnx_t* cnx, picoquic_path_t* path_x, uint64_t current_time)
+{
+    picoquic_packet_context_t* pkt_ctx = &cnx->pkt_ctx[picoquic_packet_context_application];
+    uint64_t ce = pkt_ctx->ecn_ce_total_remote - bbr3->round_ce_base;
+    uint64_t ect = pkt_ctx->ecn_ect0_total_remote + pkt_ctx->ecn_ect1_total_remote - bbr3->round_ect_base;
+
+    bbr3->inflight_latest = path_x->delivered - bbr3->round_delivered_base;
+
+    if (ce + ect > 0) {
+        uint64_t ce_ratio = (ce << BBR3_UNIT_SHIFT) / (ce + ect);
+
+        if (ce_ratio >= bbr3->ecn_alpha) {
+            bbr3->ecn_alpha += (ce_ratio - bbr3->ecn_alpha) >> BBR3_ECN_ALPHA_G_SHIFT;
+        }
+        else {
+            bbr3->ecn_alpha -= (bbr3->ecn_alpha - ce_ratio) >> BBR3_ECN_ALPHA_G_SHIFT;
+        }
+        if (ce_ratio > BBR3_ECN_THRESH) {
+            bbr3->ecn_in_round = 1;
+            if (picoquic_bbr3_is_probing_bw(bbr3) && !bbr3->inflight_hi_set_in_round) {
+                picoquic_bbr3_handle_inflight_too_high(bbr3, path_x, current_time);
+            }
+        }
+    }
+
+    if ((bbr3->loss_in_round || ce > 0) && bbr3->filled_pipe && !picoquic_bbr3_is_probing_bw(bbr3)) {
+        if (bbr3->bw_lo == UINT64_MAX) {
+            bbr3->bw_lo = bbr3->max_bw;
+        }
+        if (bbr3->inflight_lo == UINT64_MAX) {
+            bbr3->inflight_lo = path_x->cwin;
+        }
+        if (bbr3->loss_in_round) {
+            uint64_t bw_lo = (bbr3->bw_lo * BBR3_BETA) >> BBR3_UNIT_SHIFT;
+            uint64_t inflight_lo = (bbr3->inflight_lo * BBR3_BETA) >> BBR3_UNIT_SHIFT;
+
+            bbr3->bw_lo = (bbr3->bw_latest > bw_lo) ? bbr3->bw_latest : bw_lo;
+            bbr3->inflight_lo = (bbr3->inflight_latest > inflight_lo) ? bbr3->inflight_latest : inflight_lo;
+        }
+        if (ce > 0) {
+            uint64_t reduction = (bbr3->ecn_alpha * BBR3_ECN_FACTOR) >> BBR3_UNIT_SHIFT;
+            bbr3->inflight_lo -= (bbr3->inflight_lo * reduction) >> BBR3_UNIT_SHIFT;
+        }
+        if (bbr3->inflight_lo < BBR3_MIN_PIPE_CWND(path_x->send_mtu)) {
+            bbr3->inflight_lo = BBR3_MIN_PIPE_CWND(path_x->send_mtu);
+        }
+    }
+
+    picoquic_bbr3_reset_round_counters(bbr3, cnx, path_x);
+}
+
+/* Model update, per ACK */
+
+static void picoquic_bbr3_update_round(picoquic_bbr3_state_t* bbr3, picoquic_path_t* path_x)
+{
+    bbr3->round_start = 0;
+    if (path_x->delivered_last_packet >= bbr3->next_round_delivered) {
+        picoquic_bbr3_start_round(bbr3, path_x);
+        bbr3->round_count++;
+        bbr3->rounds_since_bw_probe++;
+        bbr3->round_start = 1;
+    }
+}
+
+static void picoquic_bbr3_update_max_bw(picoquic_bbr3_state_t* bbr3, picoquic_path_t* path_x)
+{
+    uint64_t sample = path_x->bandwidth_estimate;
+
+    if (sample > bbr3->bw_latest) {
+        bbr3->bw_latest = sample;
+    }
+    if (sample >= bbr3->max_bw || !path_x->last_bw_estimate_path_limited) {
+        if (sample > bbr3->max_bw_filter[0]) {
+            bbr3->max_bw_filter[0] = sample;
+        }
+        bbr3->max_bw = (bbr3->max_bw_filter[0] > bbr3->max_bw_filter[1]) ? bbr3->max_bw_filter[0] : bbr3->max_bw_filter[1];
+    }
+}
+
+static void picoquic_bbr3_update_min_rtt(picoquic_bbr3_state_t* bbr3, uint64_t rtt_sample, uint64_t current_time)
+{
+    bbr3->probe_rtt_expired = current_time > bbr3->probe_rtt_min_stamp + BBR3_PROBE_RTT_INTERVAL;
+    if (rtt_sample > 0 && (rtt_sample <= bbr3->probe_rtt_min_delay || bbr3->probe_rtt_expired)) {
+        bbr3->probe_rtt_min_delay = rtt_sample;
+        bbr3->probe_rtt_min_stamp = current_time;
+    }
+    if (bbr3->probe_rtt_min_delay < bbr3->min_rtt || current_time > bbr3->min_rtt_stamp + BBR3_MIN_RTT_FILTER_LEN) {
+        bbr3->min_rtt = bbr3->probe_rtt_min_delay;
+        bbr3->min_rtt_stamp = bbr3->probe_rtt_min_stamp;
+    }
+}
+
+static void picoquic_bbr3_check_startup_done(picoquic_bbr3_state_t* bbr3, picoquic_path_t* path_x)
+{
+    if (!bbr3->filled_pipe && bbr3->round_start && !path_x->last_bw_estimate_path_limited) {
+        if (bbr3->max_bw >= ((bbr3->full_bw * BBR3_FULL_BW_THRESH) >> BBR3_UNIT_SHIFT)) {
+            bbr3->full_bw = bbr3->max_bw;
+            bbr3->full_bw_count = 0;
+        }
+        else if (++bbr3->full_bw_count >= BBR3_FULL_BW_COUNT) {
+            bbr3->filled_pipe = 1;
+        }
+    }
+    if (bbr3->state == picoquic_bbr3_alg_startup && bbr3->filled_pipe) {
+        picoquic_bbr3_set_gains(bbr3, picoquic_bbr3_alg_drain, BBR3_DRAIN_PACING_GAIN, BBR3_STARTUP_CWND_GAIN);
+    }
+}
+
+static void picoquic_bbr3_check_drain(picoquic_bbr3_state_t* bbr3, picoquic_path_t* path_x, uint64_t current_time)
+{
+    if (bbr3->state == picoquic_bbr3_alg_drain &&
+        path_x->bytes_in_transit <= picoquic_bbr3_inflight(bbr3, bbr3->max_bw, BBR3_UNIT)) {
+        picoquic_bbr3_start_probe_bw_down(bbr3, path_x, current_time);
+    }
+}
+
+static uint64_t picoquic_bbr3_probe_rtt_cwnd(picoquic_bbr3_state_t* bbr3, picoquic_path_t* path_x)
+{
+    uint64_t probe_rtt_cwnd = picoquic_bbr3_bdp(bbr3, bbr3->bw, BBR3_PROBE_RTT_CWND_GAIN);
+
+    if (probe_rtt_cwnd < BBR3_MIN_PIPE_CWND(path_x->send_mtu)) {
+        probe_rtt_cwnd = BBR3_MIN_PIPE_CWND(path_x->send_mtu);
+    }
+    return probe_rtt_cwnd;
+}
+
+static void picoquic_bbr3_check_probe_rtt(picoquic_bbr3_state_t* bbr3, picoquic_path_t* path_x, uint64_t current_time)
+{
+    if (bbr3->state != picoquic_bbr3_alg_probe_rtt && bbr3->probe_rtt_expired) {
+        bbr3->prior_cwnd = path_x->cwin;
+        bbr3->probe_rtt_done_stamp = 0;
+        picoquic_bbr3_set_gains(bbr3, picoquic_bbr3_alg_probe_rtt, BBR3_UNIT, BBR3_PROBE_RTT_CWND_GAIN);
+    }
+
+    if (bbr3->state == picoquic_bbr3_alg_probe_rtt) {
+        if (bbr3->probe_rtt_done_stamp == 0 && path_x->bytes_in_transit <= picoquic_bbr3_probe_rtt_cwnd(bbr3, path_x)) {
+            bbr3->probe_rtt_done_stamp = current_time + BBR3_PROBE_RTT_DURATION;
+            bbr3->probe_rtt_round_done = 0;
+            picoquic_bbr3_start_round(bbr3, path_x);
+        }
+        else if (bbr3->probe_rtt_done_stamp != 0) {
+            if (bbr3->round_start) {
+                bbr3->probe_rtt_round_done = 1;
+            }
+            if (bbr3->probe_rtt_round_done && current_time > bbr3->probe_rtt_done_stamp) {
+                bbr3->probe_rtt_min_stamp = current_time;
+                bbr3->probe_rtt_expired = 0;
+                if (path_x->cwin < bbr3->prior_cwnd) {
+                    path_x->cwin = bbr3->prior_cwnd;
+                }
+                picoquic_bbr3_reset_lower_bounds(bbr3);
+                if (bbr3->filled_pipe) {
+                    picoquic_bbr3_start_probe_bw_down(bbr3, path_x, current_time);
+                    picoquic_bbr3_start_probe_bw_cruise(bbr3);
+                }
+                else {
+                    picoquic_bbr3_set_gains(bbr3, picoquic_bbr3_alg_startup, BBR3_STARTUP_PACING_GAIN, BBR3_STARTUP_CWND_GAIN);
+                }
+            }
+        }
+    }
+}
+
+/* Control parameters: pacing rate, send quantum and congestion window */
+
+static void picoquic_bbr3_set_pacing_rate(picoquic_bbr3_state_t* bbr3, picoquic_path_t* path_x)
+{
+    uint64_t rate;
+
+    if (bbr3->bw == 0) {
+        /* No delivery rate sample yet, pace the initial window over the smoothed RTT */
+        uint64_t rtt = (path_x->smoothed_rtt > 0) ? path_x->smoothed_rtt : PICOQUIC_INITIAL_RTT;
+        rate = (path_x->cwin * 1000000) / rtt;
+    }
+    else {
+        rate = bbr3->bw;
+    }
+    rate = ((rate * bbr3->pacing_gain) >> BBR3_UNIT_SHIFT) * (100 - BBR3_PACING_MARGIN_PERCENT) / 100;
+
+    if (bbr3->filled_pipe || rate > bbr3->pacing_rate) {
+        bbr3->pacing_rate = rate;
+    }
+
+    if (bbr3->pacing_rate < BBR3_PACING_RATE_LOW) {
+        bbr3->send_quantum = path_x->send_mtu;
+    }
+    else {
+        bbr3->send_quantum = bbr3->pacing_rate / 1000;
+        if (bbr3->send_quantum > BBR3_SEND_QUANTUM_MAX) {
+            bbr3->send_quantum = BBR3_SEND_QUANTUM_MAX;
+        }
+        else if (bbr3->send_quantum < 2 * (uint64_t)path_x->send_mtu) {
+            bbr3->send_quantum = 2 * (uint64_t)path_x->send_mtu;
+        }
+    }
+}
+
+static void picoquic_bbr3_set_cwnd(picoquic_bbr3_state_t* bbr3, picoquic_path_t* path_x, uint64_t bytes_delivered)
+{
+    uint64_t target = picoquic_bbr3_inflight(bbr3, bbr3->bw, bbr3->cwnd_gain);
+    uint64_t cap = bbr3->inflight_hi;
+
+    if (bbr3->filled_pipe) {
+        path_x->cwin += bytes_delivered;
+        if (path_x->cwin > target) {
+            path_x->cwin = target;
+        }
+    }
+    else if (path_x->cwin < target || path_x->delivered < PICOQUIC_CWIN_INITIAL) {
+        path_x->cwin += bytes_delivered;
+    }
+
+    /* Bound the window by the model */
+    if (bbr3->state == picoquic_bbr3_alg_probe_bw_cruise) {
+        cap = picoquic_bbr3_inflight_with_headroom(bbr3, path_x);
+    }
+    if (cap > bbr3->inflight_lo) {
+        cap = bbr3->inflight_lo;
+    }
+    if (bbr3->state == picoquic_bbr3_alg_probe_rtt) {
+        uint64_t probe_rtt_cwnd = picoquic_bbr3_probe_rtt_cwnd(bbr3, path_x);
+        if (cap > probe_rtt_cwnd) {
+            cap = probe_rtt_cwnd;
+        }
+    }
+    if (cap < BBR3_MIN_PIPE_CWND(path_x->send_mtu)) {
+        cap = BBR3_MIN_PIPE_CWND(path_x->send_mtu);
+    }
+    if (path_x->cwin > cap) {
+        path_x->cwin = cap;
+    }
+    if (path_x->cwin < BBR3_MIN_PIPE_CWND(path_x->send_mtu)) {
+        path_x->cwin = BBR3_MIN_PIPE_CWND(path_x->send_mtu);
+    }
+}
+
+static void picoquic_bbr3_update_on_ack(picoquic_bbr3_state_t* bbr3, picoquic_cnx_t* cnx, picoquic_path_t* path_x,
+    uint64_t rtt_sample, uint64_t current_time)
+{
+    uint64_t bytes_delivered = bbr3->bytes_delivered;
+
+    bbr3->bytes_delivered = 0;
+
+    /* Model */
+    picoquic_bbr3_update_round(bbr3, path_x);
+    picoquic_bbr3_update_max_bw(bbr3, path_x);
+    picoquic_bbr3_check_loss_too_high(bbr3, path_x, current_time);
+    if (bbr3->round_start) {
+        picoquic_bbr3_end_of_round(bbr3, cnx, path_x, current_time);
+    }
+    bbr3->bw = (bbr3->max_bw < bbr3->bw_lo) ? bbr3->max_bw : bbr3->bw_lo;
+
+    /* State machine */
+    picoquic_bbr3_check_startup_done(bbr3, path_x);
+    picoquic_bbr3_check_drain(bbr3, path_x, current_time);
+    picoquic_bbr3_update_probe_bw_cycle(bbr3, path_x, bytes_delivered, current_time);
+    picoquic_bbr3_update_min_rtt(bbr3, rtt_sample, current_time);
+    picoquic_bbr3_check_probe_rtt(bbr3, path_x, current_time);
+
+    /* Control */
+    picoquic_bbr3_set_pacing_rate(bbr3, path_x);
+    picoquic_bbr3_set_cwnd(bbr3, path_x, bytes_delivered);
+}
+
+static void picoquic_bbr3_notify(
+    picoquic_cnx_t* cnx,
+    picoquic_path_t* path_x,
+    picoquic_congestion_notification_t notification,
+    uint64_t rtt_measurement,
+    uint64_t one_way_delay,
+    uint64_t nb_bytes_acknowledged,
+    uint64_t lost_packet_number,
+    uint64_t current_time)
+{
+#ifdef _WINDOWS
+    UNREFERENCED_PARAMETER(one_way_delay);
+    UNREFERENCED_PARAMETER(lost_packet_number);
+#endif
+    picoquic_bbr3_state_t* bbr3 = (picoquic_bbr3_state_t*)path_x->congestion_alg_state;
+
+    path_x->is_cc_data_updated = 1;
+
+    if (bbr3 != NULL) {
+        switch (notification) {
+        case picoquic_congestion_notification_acknowledgement:
+            bbr3->bytes_delivered += nb_bytes_acknowledged;
+            break;
+        case picoquic_congestion_notification_timeout:
+            /* All the data in flight is presumed lost. Restart from a minimal window,
+             * the model will let it grow back quickly. */
+            bbr3->prior_cwnd = path_x->cwin;
+            path_x->cwin = BBR3_MIN_PIPE_CWND(path_x->send_mtu);
+            break;
+        case picoquic_congestion_notification_bw_measurement:
+            picoquic_bbr3_update_on_ack(bbr3, cnx, path_x, rtt_measurement, current_time);
+            picoquic_update_pacing_rate_int(cnx, path_x, bbr3->pacing_rate, bbr3->send_quantum);
+            break;
+        case picoquic_congestion_notification_reset:
+            picoquic_bbr3_reset(bbr3, cnx, path_x, current_time);
+            break;
+        case picoquic_congestion_notification_seed_cwin:
+            if (bbr3->state == picoquic_bbr3_alg_startup && nb_bytes_acknowledged > path_x->cwin) {
+                path_x->cwin = nb_bytes_acknowledged;
+            }
+            break;
+        case picoquic_congestion_notification_repeat:
+        case picoquic_congestion_notification_ecn_ec:
+            /* Losses and CE marks are read from the path and ECN counters, once per ACK */
+        case picoquic_congestion_notification_spurious_repeat:
+        case picoquic_congestion_notification_rtt_measurement:
+        case picoquic_congestion_notification_cwin_blocked:
+        default:
+            break;
+        }
+    }
+}
+
+/* Aggregated ACK event: the model and the control parameters are updated once
+ * for all the packets acknowledged in the ACK.
+ */
+static void picoquic_bbr3_notify_ack(
+    picoquic_cnx_t* cnx,
+    picoquic_path_t* path_x,
+    picoquic_per_ack_state_t const* ack_state,
+    uint64_t current_time)
+{
+    picoquic_bbr3_state_t* bbr3 = (picoquic_bbr3_state_t*)path_x->congestion_alg_state;
+
+    path_x->is_cc_data_updated = 1;
+
+    if (bbr3 != NULL) {
+        bbr3->bytes_delivered += ack_state->nb_bytes_acknowledged;
+        if (ack_state->is_delivery_rate_sampled && ack_state->rtt_measurement > 0) {
+            picoquic_bbr3_update_on_ack(bbr3, cnx, path_x, ack_state->rtt_measurement, current_time);
+            picoquic_update_pacing_rate_int(cnx, path_x, bbr3->pacing_rate, bbr3->send_quantum);
+        }
+    }
+}
+
+/* The observed parameter is the bandwidth estimate */
+static void picoquic_bbr3_observe(picoquic_path_t* path_x, uint64_t* cc_state, uint64_t* cc_param)
+{
+    picoquic_bbr3_state_t* bbr3 = (picoquic_bbr3_state_t*)path_x->congestion_alg_state;
+    *cc_state = (uint64_t)bbr3->state;
+    *cc_param = bbr3->bw;
+}
+
+#define PICOQUIC_BBR3_ID "bbr3"
+
+picoquic_congestion_algorithm_t picoquic_bbr3_algorithm_struct = {
+    PICOQUIC_BBR3_ID, PICOQUIC_CC_ALGO_NUMBER_BBR3,
+    picoquic_bbr3_init,
+    picoquic_bbr3_notify,
+    picoquic_bbr3_delete,
+    picoquic_bbr3_observe,
+    0,
+    picoquic_bbr3_notify_ack
+};
+
+picoquic_congestion_algorithm_t* picoquic_bbr3_algorithm = &picoquic_bbr3_algorithm_struct;
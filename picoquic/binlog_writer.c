@@ -0,0 +1,322 @@
+/* Asynchronous writer for the binary logs.
+ *
+ * With synchronous logging, each event is written to the log file from the
+ * packet processing path, and the stdio calls (and the occasional disk write
+ * when the stdio buffer fills) add jitter to the packet processing. When the
+ * asynchronous writer is attached to a QUIC context, the binary log events
+ * are serialized in memory, as complete chunks whose length is known, and
+ * copied to a single producer, single consumer ring. A writer thread drains
+ * the ring and writes the chunks to the log files, using large stdio buffers
+ * so that the disk sees a few large writes instead of many small ones.
+ *
+ * There is one ring per QUIC context, i.e., per network thread. The network
+ * thread is the only producer, the writer thread is the only consumer. The
+ * positions are free running 32 bit counters: the producer owns "head", the
+ * consumer owns "tail", and each side reads the other's counter with acquire
+ * semantics. Records are aligned to PICOQUIC_BINLOG_RECORD_ALIGN bytes. A
+ * record never wraps around the end of the ring: if the contiguous space is
+ * too short, the producer fills it with a "skip" record and restarts at the
+ * beginning.
+ *
+ * Log files are owned by the writer thread once the connection starts using
+ * the ring. Closing the log of a connection queues a "close" record, so the
+ * file is closed after all its chunks are written. If the log file must be
+ * read after closing, e.g., to produce a qlog, the producer waits until the
+ * close record is processed.
+ *
+ * When the ring is full, the overflow policy applies:
+ * - drop: the chunk is discarded and counted. Chunks are dropped whole, so
+ *   the log files remain readable, they just miss some events.
+ * - block: the network thread waits until the writer thread frees space.
+ * Close records are never dropped.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "picoquic_internal.h"
+#include "picoquic_utils.h"
+#include "picoquic_binlog.h"
+
+#define PICOQUIC_BINLOG_RECORD_ALIGN 16
+#define PICOQUIC_BINLOG_RING_MIN 0x10000
+#define PICOQUIC_BINLOG_WRITER_WAIT_USEC 10000
+#define PICOQUIC_BINLOG_PRODUCER_WAIT_USEC 1000
+#define PICOQUIC_BINLOG_FILE_BUFFER_SIZE 0x10000
+
+typedef enum {
+    picoquic_binlog_record_chunk = 0,
+    picoquic_binlog_record_close,
+    picoquic_binlog_record_skip
+} picoquic_binlog_record_enum;
+
+typedef struct st_picoquic_binlog_record_t {
+    FILE* f;
+    uint32_t length;
+    uint32_t record_type;
+} picoquic_binlog_record_t;
+
+#define PICOQUIC_BINLOG_RECORD_SIZE(l) \
+    ((sizeof(picoquic_binlog_record_t) + (l) + PICOQUIC_BINLOG_RECORD_ALIGN - 1) & ~((size_t)PICOQUIC_BINLOG_RECORD_ALIGN - 1))
+
+typedef struct st_picoquic_binlog_writer_t {
+    uint8_t* ring;
+    uint32_t ring_size;
+    uint32_t ring_mask;
+    volatile uint32_t head; /* Written by the network thread */
+    volatile uint32_t tail; /* Written by the writer thread */
+    uint32_t reserved_head; /* End of the record being prepared by the network thread */
+    picoquic_binlog_overflow_enum overflow_policy;
+    uint64_t nb_chunks_dropped;
+    uint64_t nb_bytes_dropped;
+    picoquic_event_t wake_event;
+    picoquic_event_t drain_event;
+    picoquic_thread_t thread;
+    volatile uint32_t is_stopping;
+    unsigned int is_thread_started : 1;
+} picoquic_binlog_writer_t;
+
+/* Process the records queued in the ring. Returns the number of records processed. */
+size_t picoquic_binlog_writer_drain(picoquic_binlog_writer_t* writer)
+{
+    size_t nb_records = 0;
+    uint32_t head = PICOQUIC_ATOMIC_LOAD_32(&writer->head);
+    uint32_t tail = writer->tail;
+
+    while (tail != head) {
+        picoquic_binlog_record_t* record = (picoquic_binlog_record_t*)(writer->ring + (tail & writer->ring_mask));
+
+        switch (record->record_type) {
+        case picoquic_binlog_record_chunk:
+            (void)fwrite((uint8_t*)(record + 1), record->length, 1, record->f);
+            break;
+        case picoquic_binlog_record_close:
+            (void)picoquic_file_close(record->f);
+            break;
+        default:
+            break;
+        }
+        tail += (uint32_t)PICOQUIC_BINLOG_RECORD_SIZE(record->length);
+        /* Release the space early, so a blocked producer can resume */
+        PICOQUIC_ATOMIC_STORE_32(&writer->tail, tail);
+        nb_records++;
+    }
+
+    return nb_records;
+}
+
+static picoquic_thread_return_t picoquic_binlog_writer_thread(void* arg)
+{
+    picoquic_binlog_writer_t* writer = (picoquic_binlog_writer_t*)arg;
+
+    while (1) {
+        if (picoquic_binlog_writer_drain(writer) > 0) {
+            (void)picoquic_signal_event(&writer->drain_event);
+        }
+        else if (PICOQUIC_ATOMIC_LOAD_32(&writer->is_stopping)) {
+            /* The ring is empty, and no new record will be queued */
+            break;
+        }
+        else {
+            /* The event does not retain signals, so the wait is bounded. Waking up on the
+             * timer rather than on each record also batches the writes. */
+            (void)picoquic_wait_for_event(&writer->wake_event, PICOQUIC_BINLOG_WRITER_WAIT_USEC);
+        }
+    }
+
+    picoquic_thread_do_return;
+}
+
+/* Wait until the writer thread processes all the records queued so far */
+void picoquic_binlog_writer_flush(picoquic_binlog_writer_t* writer)
+{
+    uint32_t target = writer->head;
+
+    if (!writer->is_thread_started) {
+        (void)picoquic_binlog_writer_drain(writer);
+        return;
+    }
+    while ((int32_t)(PICOQUIC_ATOMIC_LOAD_32(&writer->tail) - target) < 0) {
+        (void)picoquic_signal_event(&writer->wake_event);
+        (void)picoquic_wait_for_event(&writer->drain_event, PICOQUIC_BINLOG_PRODUCER_WAIT_USEC);
+    }
+}
+
+/* Reserve space for a record of "length" bytes. Returns NULL if the ring is
+ * full and the record may be dropped. */
+static picoquic_binlog_record_t* picoquic_binlog_writer_reserve(picoquic_binlog_writer_t* writer,
+    size_t length, int may_drop)
+{
+    uint32_t record_size = (uint32_t)PICOQUIC_BINLOG_RECORD_SIZE(length);
+    uint32_t head = writer->head;
+    uint32_t contiguous = writer->ring_size - (head & writer->ring_mask);
+    uint32_t needed = record_size + ((contiguous < record_size) ? contiguous : 0);
+    picoquic_binlog_record_t* record;
+
+    while (writer->ring_size - (head - PICOQUIC_ATOMIC_LOAD_32(&writer->tail)) < needed) {
+        if (may_drop) {
+            return NULL;
+        }
+        else if (!writer->is_thread_started) {
+            (void)picoquic_binlog_writer_drain(writer);
+        }
+        else {
+            (void)picoquic_signal_event(&writer->wake_event);
+            (void)picoquic_wait_for_event(&writer->drain_event, PICOQUIC_BINLOG_PRODUCER_WAIT_USEC);
+        }
+    }
+
+    if (contiguous < record_size) {
+        record = (picoquic_binlog_record_t*)(writer->ring + (head & writer->ring_mask));
+        record->f = NULL;
+        record->length = contiguous - (uint32_t)sizeof(picoquic_binlog_record_t);
+        record->record_type = picoquic_binlog_record_skip;
+        head += contiguous;
+    }
+    record = (picoquic_binlog_record_t*)(writer->ring + (head & writer->ring_mask));
+    record->length = (uint32_t)length;
+    writer->reserved_head = head + record_size;
+
+    return record;
+}
+
+static void picoquic_binlog_writer_commit(picoquic_binlog_writer_t* writer, picoquic_binlog_record_t* record)
+{
+    uint32_t half_ring = writer->ring_size / 2;
+    uint32_t tail = PICOQUIC_ATOMIC_LOAD_32(&writer->tail);
+    int is_crossing_half = (writer->head - tail < half_ring && writer->reserved_head - tail >= half_ring);
+
+    PICOQUIC_ATOMIC_STORE_32(&writer->head, writer->reserved_head);
+
+    /* Wake up the writer when the ring gets half full, or when a file is closed */
+    if (writer->is_thread_started && (is_crossing_half || record->record_type == picoquic_binlog_record_close)) {
+        (void)picoquic_signal_event(&writer->wake_event);
+    }
+}
+
+int picoquic_binlog_writer_push(picoquic_binlog_writer_t* writer, FILE* f, const uint8_t* chunk, size_t length)
+{
+    picoquic_binlog_record_t* record = NULL;
+
+    if (PICOQUIC_BINLOG_RECORD_SIZE(length) <= writer->ring_size / 2) {
+        record = picoquic_binlog_writer_reserve(writer, length,
+            writer->overflow_policy == picoquic_binlog_overflow_drop);
+    }
+    if (record == NULL) {
+        writer->nb_chunks_dropped++;
+        writer->nb_bytes_dropped += length;
+        return -1;
+    }
+    record->f = f;
+    record->record_type = picoquic_binlog_record_chunk;
+    memcpy((uint8_t*)(record + 1), chunk, length);
+    picoquic_binlog_writer_commit(writer, record);
+
+    return 0;
+}
+
+void picoquic_binlog_writer_close_file(picoquic_binlog_writer_t* writer, FILE* f, int wait_until_closed)
+{
+    picoquic_binlog_record_t* record = picoquic_binlog_writer_reserve(writer, 0, 0);
+
+    record->f = f;
+    record->record_type = picoquic_binlog_record_close;
+    picoquic_binlog_writer_commit(writer, record);
+
+    if (wait_until_closed) {
+        picoquic_binlog_writer_flush(writer);
+    }
+}
+
+/* Set a large stdio buffer on files written by the writer thread */
+void picoquic_binlog_writer_set_file_buffer(FILE* f)
+{
+    (void)setvbuf(f, NULL, _IOFBF, PICOQUIC_BINLOG_FILE_BUFFER_SIZE);
+}
+
+uint64_t picoquic_binlog_writer_dropped(picoquic_binlog_writer_t* writer)
+{
+    return writer->nb_chunks_dropped;
+}
+
+void picoquic_binlog_writer_delete(picoquic_binlog_writer_t* writer)
+{
+    if (writer != NULL) {
+        if (writer->is_thread_started) {
+            PICOQUIC_ATOMIC_STORE_32(&writer->is_stopping, 1);
+            (void)picoquic_signal_event(&writer->wake_event);
+            picoquic_delete_thread(&writer->thread);
+        }
+        /* Write whatever the thread left behind, and close the files */
+        (void)picoquic_binlog_writer_drain(writer);
+        picoquic_delete_event(&writer->wake_event);
+        picoquic_delete_event(&writer->drain_event);
+        free(writer->ring);
+        free(writer);
+    }
+}
+
+picoquic_binlog_writer_t* picoquic_binlog_writer_create(size_t ring_size,
+    picoquic_binlog_overflow_enum overflow_policy, int start_thread)
+{
+    picoquic_binlog_writer_t* writer = (picoquic_binlog_writer_t*)malloc(sizeof(picoquic_binlog_writer_t));
+    uint32_t size = PICOQUIC_BINLOG_RING_MIN;
+
+    if (writer == NULL) {
+        return NULL;
+    }
+    /* Round up to a power of 2, so that the free running positions wrap cleanly */
+    while (size < ring_size && size < 0x40000000) {
+        size <<= 1;
+    }
+    memset(writer, 0, sizeof(picoquic_binlog_writer_t));
+    writer->ring_size = size;
+    writer->ring_mask = size - 1;
+    writer->overflow_policy = overflow_policy;
+
+    if ((writer->ring = (uint8_t*)malloc(size)) == NULL) {
+        free(writer);
+        return NULL;
+    }
+    if (picoquic_create_event(&writer->wake_event) != 0) {
+        free(writer->ring);
+        free(writer);
+        return NULL;
+    }
+    if (picoquic_create_event(&writer->drain_event) != 0) {
+        picoquic_delete_event(&writer->wake_event);
+        free(writer->ring);
+        free(writer);
+        return NULL;
+    }
+    if (start_thread) {
+        if (picoquic_create_thread(&writer->thread, picoquic_binlog_writer_thread, writer) != 0) {
+            DBG_PRINTF("%s", "Cannot create the binary log writer thread");
+            picoquic_binlog_writer_delete(writer);
+            return NULL;
+        }
+        writer->is_thread_started = 1;
+    }
+
+    return writer;
+}
+
+int picoquic_set_binlog_async(picoquic_quic_t* quic, size_t ring_size, picoquic_binlog_overflow_enum overflow_policy)
+{
+    /* Chunks already queued are written by the old writer before it is deleted */
+    picoquic_binlog_writer_delete(quic->binlog_writer);
+    quic->binlog_writer = NULL;
+
+    if (ring_size > 0) {
+        quic->binlog_writer = picoquic_binlog_writer_create(ring_size, overflow_policy, 1);
+        if (quic->binlog_writer == NULL) {
+            return PICOQUIC_ERROR_MEMORY;
+        }
+    }
+
+    return 0;
+}
+
+uint64_t picoquic_get_binlog_dropped(picoquic_quic_t* quic)
+{
+    return (quic->binlog_writer == NULL) ? 0 : picoquic_binlog_writer_dropped(quic->binlog_writer);
+}
@@ -158,4 +158,28 @@ uint64_t picoquic_cc_increased_window(picoquic_cnx_t* cnx, uint64_t previous_win
         new_window = (uint64_t)w;
     }
     return new_window;
-}
\ No newline at end of file
+}
+/* Controllers that do not have specific processing for the aggregated ACK event
+ * can replay it as the sequence of notifications that the per packet path would
+ * have produced, with all the acknowledged bytes passed in a single call.
+ */
+void picoquic_cc_replay_ack_event(picoquic_congestion_algorithm_notify notify,
+    picoquic_cnx_t* cnx, picoquic_path_t* path_x, picoquic_per_ack_state_t const* ack_state, uint64_t current_time)
+{
+    if (ack_state->nb_bytes_acknowledged > 0) {
+        notify(cnx, path_x, picoquic_congestion_notification_acknowledgement,
+            0, 0, ack_state->nb_bytes_acknowledged, 0, current_time);
+    }
+    if (ack_state->ecn_ce_delta > 0) {
+        notify(cnx, path_x, picoquic_congestion_notification_ecn_ec,
+            0, 0, 0, ack_state->ecn_packet_number, current_time);
+    }
+    if (ack_state->is_rtt_updated) {
+        notify(cnx, path_x, picoquic_congestion_notification_rtt_measurement,
+            ack_state->rtt_measurement, ack_state->one_way_delay, 0, 0, current_time);
+    }
+    if (ack_state->is_delivery_rate_sampled && ack_state->rtt_measurement > 0) {
+        notify(cnx, path_x, picoquic_congestion_notification_bw_measurement,
+            ack_state->rtt_measurement, ack_state->one_way_delay, 0, 0, current_time);
+    }
+}
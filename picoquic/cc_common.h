@@ -58,6 +58,9 @@ int picoquic_hystart_test(picoquic_min_max_rtt_t* rtt_track, uint64_t rtt_measur
 
 void picoquic_hystart_increase(picoquic_path_t* path_x, picoquic_min_max_rtt_t* rtt_filter, uint64_t nb_delivered);
 
+void picoquic_cc_replay_ack_event(picoquic_congestion_algorithm_notify notify,
+    picoquic_cnx_t* cnx, picoquic_path_t* path_x, picoquic_per_ack_state_t const* ack_state, uint64_t current_time);
+
 /* Many congestion control algorithms run a parallel version of new reno in order
  * to provide a lower bound estimate of either the congestion window or the
  * the minimal bandwidth. This implementation of new reno does not directly
@@ -33,6 +33,8 @@
 #include "picoquic_logger.h"
 #include "picoquic_unified_log.h"
 #include "picoquic_config.h"
+#include "picoquic_profiler.h"
+#include "picoquic_events.h"
 
 typedef struct st_option_param_t {
     char const * param;
@@ -94,6 +96,8 @@ static option_table_line_t option_table[] = {
     { picoquic_option_Version_Upgrade, 'U', "version_upgrade", 1, "", "Version upgrade if server agrees, e.g. -U FF020000" },
     { picoquic_option_No_GSO, '0', "no_gso", 0, "", "Do not use UDP GSO or equivalent" },
     { picoquic_option_BDP_frame, 'j', "bdp", 1, "number", "use bdp extension frame(1) or don\'t (0). Default=0" },
+    { picoquic_option_Profile, 'Y', "profile", 1, "interval_ms",
+    "Print the hot path cycle profile every interval_ms. Requires a build with ENABLE_PROFILER." },
     { picoquic_option_HELP, 'h', "help", 0, "This help message" }
 };
 
@@ -496,6 +500,17 @@ static int config_set_option(option_table_line_t* option_desc, option_param_t* p
         }
         break;
     }
+    case picoquic_option_Profile: {
+        int v = config_atoi(params, nb_params, 0, &ret);
+        if (ret != 0 || v <= 0) {
+            fprintf(stderr, "Invalid profile interval: %s\n", config_optval_param_string(opval_buffer, 256, params, nb_params, 0));
+            ret = (ret == 0) ? -1 : ret;
+        }
+        else {
+            config->profile_interval_ms = v;
+        }
+        break;
+    }
     case picoquic_option_HELP:
         ret = -1;
         break;
@@ -843,6 +858,18 @@ picoquic_quic_t* picoquic_create_and_configure(picoquic_quic_config_t* config,
 
         picoquic_set_default_bdp_frame_option(quic, config->bdp_frame_option);
 
+        /* Keep the connection and packet loop events visible, without blocking the worker */
+        picoquic_events_set_text(quic, stdout, PICOQUIC_EVENT_TEXT_MAX_DEFAULT);
+
+        if (config->profile_interval_ms > 0) {
+            if (picoquic_profiler_enable(quic) != 0) {
+                fprintf(stderr, "Could not enable the profiler, was the stack compiled with ENABLE_PROFILER?\n");
+            }
+            else {
+                picoquic_profiler_set_print_interval(quic, stdout, ((uint64_t)config->profile_interval_ms) * 1000);
+            }
+        }
+
         if (ret != 0) {
             /* Something went wrong */
             DBG_PRINTF("QUIC configuration fails, ret = %d (0x%x)", ret, ret);
@@ -0,0 +1,181 @@
+/* Ring based packet protection provider.
+ *
+ * This is the reference asynchronous implementation of the packet protection
+ * provider API. AEAD jobs are submitted in batches to a DPDK ring, processed by
+ * a crypto loop running on a dedicated lcore (or on a plain thread if no lcore
+ * is specified), and returned on a completion ring that the worker polls.
+ * The same structure can be used to front a DPDK cryptodev queue pair, e.g.,
+ * with the "crypto_aesni_mb" or "crypto_null" virtual PMDs, by replacing the
+ * call to "picoquic_software_crypto_process" in the crypto loop.
+ *
+ * The submission ring is single producer, single consumer: a provider context
+ * is attached to one picoquic_quic_t, which is served by a single worker.
+ *
+ * The stack submits the protection of 1-RTT packets through "submit", one
+ * batch per prepared datagram train, and one job per received packet. The
+ * synchronous "process" entry point executes the job inline: it is only used
+ * for handshake packets, and as fallback if the submission ring is full.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "picoquic_internal.h"
+#include "picoquic_utils.h"
+#include "tls_api.h"
+#include <rte_ring.h>
+#include <rte_lcore.h>
+#include <rte_launch.h>
+#include <rte_cycles.h>
+
+#define PICOQUIC_CRYPTO_RING_SIZE 1024
+#define PICOQUIC_CRYPTO_RING_BURST 32
+
+typedef struct st_picoquic_crypto_ring_ctx_t {
+    struct rte_ring* submit_ring;
+    struct rte_ring* complete_ring;
+    unsigned int lcore_id;
+    picoquic_thread_t thread;
+    volatile int is_stopping;
+    uint64_t nb_jobs_processed;
+    unsigned int is_lcore : 1;
+    unsigned int is_thread : 1;
+} picoquic_crypto_ring_ctx_t;
+
+static void picoquic_crypto_ring_loop(picoquic_crypto_ring_ctx_t* ring_ctx)
+{
+    void* jobs[PICOQUIC_CRYPTO_RING_BURST];
+
+    while (!ring_ctx->is_stopping) {
+        unsigned int nb_jobs = rte_ring_dequeue_burst(ring_ctx->submit_ring, jobs, PICOQUIC_CRYPTO_RING_BURST, NULL);
+
+        if (nb_jobs == 0) {
+            rte_pause();
+            continue;
+        }
+        for (unsigned int i = 0; i < nb_jobs; i++) {
+            (void)picoquic_software_crypto_process(NULL, (picoquic_aead_job_t*)jobs[i]);
+        }
+        ring_ctx->nb_jobs_processed += nb_jobs;
+        /* The completion ring is as large as the submission ring, so it can only be
+         * full if the worker does not poll. Wait rather than lose the jobs. */
+        unsigned int nb_done = 0;
+        while (nb_done < nb_jobs && !ring_ctx->is_stopping) {
+            nb_done += rte_ring_enqueue_burst(ring_ctx->complete_ring, jobs + nb_done, nb_jobs - nb_done, NULL);
+            if (nb_done < nb_jobs) {
+                rte_pause();
+            }
+        }
+    }
+}
+
+static int picoquic_crypto_ring_lcore_main(void* arg)
+{
+    picoquic_crypto_ring_loop((picoquic_crypto_ring_ctx_t*)arg);
+    return 0;
+}
+
+static picoquic_thread_return_t picoquic_crypto_ring_thread_main(void* arg)
+{
+    picoquic_crypto_ring_loop((picoquic_crypto_ring_ctx_t*)arg);
+    picoquic_thread_do_return;
+}
+
+static void picoquic_crypto_ring_delete(void* provider_ctx)
+{
+    picoquic_crypto_ring_ctx_t* ring_ctx = (picoquic_crypto_ring_ctx_t*)provider_ctx;
+
+    ring_ctx->is_stopping = 1;
+    if (ring_ctx->is_lcore) {
+        (void)rte_eal_wait_lcore(ring_ctx->lcore_id);
+    }
+    else if (ring_ctx->is_thread) {
+        picoquic_delete_thread(&ring_ctx->thread);
+    }
+    if (ring_ctx->submit_ring != NULL) {
+        rte_ring_free(ring_ctx->submit_ring);
+    }
+    if (ring_ctx->complete_ring != NULL) {
+        rte_ring_free(ring_ctx->complete_ring);
+    }
+    free(ring_ctx);
+}
+
+static void* picoquic_crypto_ring_create(picoquic_quic_t* quic, char const* param)
+{
+    picoquic_crypto_ring_ctx_t* ring_ctx = (picoquic_crypto_ring_ctx_t*)malloc(sizeof(picoquic_crypto_ring_ctx_t));
+
+    if (ring_ctx != NULL) {
+        char ring_name[32];
+        int ret = 0;
+
+        memset(ring_ctx, 0, sizeof(picoquic_crypto_ring_ctx_t));
+        (void)picoquic_sprintf(ring_name, sizeof(ring_name), NULL, "pq_crypto_s_%p", (void*)quic);
+        ring_ctx->submit_ring = rte_ring_create(ring_name, PICOQUIC_CRYPTO_RING_SIZE, rte_socket_id(),
+            RING_F_SP_ENQ | RING_F_SC_DEQ);
+        (void)picoquic_sprintf(ring_name, sizeof(ring_name), NULL, "pq_crypto_c_%p", (void*)quic);
+        ring_ctx->complete_ring = rte_ring_create(ring_name, PICOQUIC_CRYPTO_RING_SIZE, rte_socket_id(),
+            RING_F_SP_ENQ | RING_F_SC_DEQ);
+
+        if (ring_ctx->submit_ring == NULL || ring_ctx->complete_ring == NULL) {
+            DBG_PRINTF("Cannot create crypto rings: %s", rte_strerror(rte_errno));
+            ret = -1;
+        }
+        else if (param != NULL) {
+            ring_ctx->lcore_id = (unsigned int)atoi(param);
+            if (rte_eal_remote_launch(picoquic_crypto_ring_lcore_main, ring_ctx, ring_ctx->lcore_id) != 0) {
+                DBG_PRINTF("Cannot launch crypto loop on lcore %u", ring_ctx->lcore_id);
+                ret = -1;
+            }
+            else {
+                ring_ctx->is_lcore = 1;
+            }
+        }
+        else if (picoquic_create_thread(&ring_ctx->thread, picoquic_crypto_ring_thread_main, ring_ctx) != 0) {
+            DBG_PRINTF("%s", "Cannot create crypto thread");
+            ret = -1;
+        }
+        else {
+            ring_ctx->is_thread = 1;
+        }
+
+        if (ret != 0) {
+            picoquic_crypto_ring_delete(ring_ctx);
+            ring_ctx = NULL;
+        }
+    }
+
+    return ring_ctx;
+}
+
+static size_t picoquic_crypto_ring_process(void* provider_ctx, picoquic_aead_job_t* job)
+{
+    return picoquic_software_crypto_process(provider_ctx, job);
+}
+
+static size_t picoquic_crypto_ring_submit(void* provider_ctx, picoquic_aead_job_t** jobs, size_t nb_jobs)
+{
+    picoquic_crypto_ring_ctx_t* ring_ctx = (picoquic_crypto_ring_ctx_t*)provider_ctx;
+
+    return (size_t)rte_ring_enqueue_burst(ring_ctx->submit_ring, (void* const*)jobs, (unsigned int)nb_jobs, NULL);
+}
+
+static size_t picoquic_crypto_ring_poll(void* provider_ctx, picoquic_aead_job_t** jobs, size_t max_jobs)
+{
+    picoquic_crypto_ring_ctx_t* ring_ctx = (picoquic_crypto_ring_ctx_t*)provider_ctx;
+
+    return (size_t)rte_ring_dequeue_burst(ring_ctx->complete_ring, (void**)jobs, (unsigned int)max_jobs, NULL);
+}
+
+#define PICOQUIC_RING_CRYPTO_PROVIDER_ID "ring"
+
+picoquic_crypto_provider_t picoquic_ring_crypto_provider_struct = {
+    PICOQUIC_RING_CRYPTO_PROVIDER_ID,
+    picoquic_crypto_ring_create,
+    picoquic_crypto_ring_delete,
+    picoquic_crypto_ring_process,
+    picoquic_crypto_ring_submit,
+    picoquic_crypto_ring_poll
+};
+
+picoquic_crypto_provider_t* picoquic_ring_crypto_provider = &picoquic_ring_crypto_provider_struct;
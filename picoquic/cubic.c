@@ -701,12 +701,29 @@ void picoquic_cubic_observe(picoquic_path_t* path_x, uint64_t* cc_state, uint64_
 #define picoquic_cubic_ID "cubic" /* CBIC */
 #define picoquic_dcubic_ID "dcubic" /* DBIC */
 
+/* The cubic window is computed for the current time, so a single acknowledgement
+ * of all the bytes in the ACK frame has almost the same effect as one per packet,
+ * and the window and pacing updates run once per ACK instead of once per packet. */
+static void picoquic_cubic_notify_ack(picoquic_cnx_t* cnx, picoquic_path_t* path_x,
+    picoquic_per_ack_state_t const* ack_state, uint64_t current_time)
+{
+    picoquic_cc_replay_ack_event(picoquic_cubic_notify, cnx, path_x, ack_state, current_time);
+}
+
+static void picoquic_dcubic_notify_ack(picoquic_cnx_t* cnx, picoquic_path_t* path_x,
+    picoquic_per_ack_state_t const* ack_state, uint64_t current_time)
+{
+    picoquic_cc_replay_ack_event(picoquic_dcubic_notify, cnx, path_x, ack_state, current_time);
+}
+
 picoquic_congestion_algorithm_t picoquic_cubic_algorithm_struct = {
     picoquic_cubic_ID, PICOQUIC_CC_ALGO_NUMBER_CUBIC,
     picoquic_cubic_init,
     picoquic_cubic_notify,
     picoquic_cubic_delete,
-    picoquic_cubic_observe
+    picoquic_cubic_observe,
+    0,
+    picoquic_cubic_notify_ack
 };
 
 picoquic_congestion_algorithm_t picoquic_dcubic_algorithm_struct = {
@@ -714,7 +731,9 @@ picoquic_congestion_algorithm_t picoquic_dcubic_algorithm_struct = {
     picoquic_cubic_init,
     picoquic_dcubic_notify,
     picoquic_cubic_delete,
-    picoquic_cubic_observe
+    picoquic_cubic_observe,
+    0,
+    picoquic_dcubic_notify_ack
 };
 
 picoquic_congestion_algorithm_t* picoquic_cubic_algorithm = &picoquic_cubic_algorithm_struct;
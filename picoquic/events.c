@@ -0,0 +1,124 @@
+/*
+* Structured events: counters per event type and rate limited text.
+*/
+
+#include <stdarg.h>
+#include <inttypes.h>
+#include "picoquic_internal.h"
+#include "picoquic_unified_log.h"
+#include "picoquic_events.h"
+
+static char const* picoquic_event_names[picoquic_event_max] = {
+    "cnx_closed",
+    "icmp_received",
+    "icmpv6_received",
+    "arp_received",
+    "arp_reply_sent",
+    "unknown_ip_protocol",
+    "unknown_ipv6_protocol",
+    "unknown_ethertype",
+    "tx_dropped"
+};
+
+char const* picoquic_event_name(picoquic_event_enum event)
+{
+    return ((unsigned int)event < picoquic_event_max) ? picoquic_event_names[event] : "unknown";
+}
+
+void picoquic_events_set_text(picoquic_quic_t* quic, FILE* F, uint32_t max_per_period)
+{
+    quic->events.F_text = (max_per_period > 0) ? F : NULL;
+    quic->events.text_max = max_per_period;
+}
+
+uint64_t picoquic_events_get_count(picoquic_quic_t* quic, picoquic_event_enum event)
+{
+    return ((unsigned int)event < picoquic_event_max) ? quic->events.counters[event] : 0;
+}
+
+void picoquic_event_count(picoquic_quic_t* quic, picoquic_event_enum event, uint64_t nb_events)
+{
+    quic->events.counters[event] += nb_events;
+}
+
+/* Check the rate limit of the event type. When a new period starts, the
+ * number of lines suppressed in the previous period is reported. */
+static int picoquic_event_text_allowed(picoquic_quic_t* quic, picoquic_event_enum event, uint64_t current_time)
+{
+    picoquic_events_t* events = &quic->events;
+    uint32_t text_max = (events->text_max > 0) ? events->text_max : PICOQUIC_EVENT_TEXT_MAX_DEFAULT;
+    int allowed = 0;
+
+    if (current_time < events->period_start[event] ||
+        current_time >= events->period_start[event] + PICOQUIC_EVENT_TEXT_PERIOD) {
+        if (events->nb_suppressed[event] > 0 && events->F_text != NULL) {
+            fprintf(events->F_text, "%s: %" PRIu64 " messages suppressed\n",
+                picoquic_event_names[event], events->nb_suppressed[event]);
+        }
+        events->period_start[event] = current_time;
+        events->nb_text[event] = 0;
+        events->nb_suppressed[event] = 0;
+    }
+
+    if (events->nb_text[event] < text_max) {
+        events->nb_text[event]++;
+        allowed = 1;
+    }
+    else {
+        events->nb_suppressed[event]++;
+    }
+
+    return allowed;
+}
+
+static void picoquic_event_text_v(picoquic_quic_t* quic, picoquic_event_enum event, const picoquic_connection_id_t* cid,
+    uint64_t current_time, const char* fmt, va_list vargs)
+{
+    if (picoquic_event_text_allowed(quic, event, current_time)) {
+        if (quic->events.F_text != NULL) {
+            va_list args;
+            va_copy(args, vargs);
+            if (cid != NULL) {
+                fprintf(quic->events.F_text, "%s %016" PRIx64 ": ", picoquic_event_names[event],
+                    picoquic_val64_connection_id(*cid));
+            }
+            else {
+                fprintf(quic->events.F_text, "%s: ", picoquic_event_names[event]);
+            }
+            (void)vfprintf(quic->events.F_text, fmt, args);
+            fputc('\n', quic->events.F_text);
+            va_end(args);
+        }
+        /* Events of a connection are already in the logs of that connection */
+        if (quic->F_log != NULL && cid == NULL) {
+            va_list args;
+            va_copy(args, vargs);
+            quic->text_log_fns->log_quic_app_message(quic, &picoquic_null_connection_id, fmt, args);
+            va_end(args);
+        }
+    }
+}
+
+void picoquic_event_text(picoquic_quic_t* quic, picoquic_event_enum event, const picoquic_connection_id_t* cid,
+    uint64_t current_time, const char* fmt, ...)
+{
+    if (quic->events.F_text != NULL || (quic->F_log != NULL && cid == NULL)) {
+        va_list args;
+        va_start(args, fmt);
+        picoquic_event_text_v(quic, event, cid, current_time, fmt, args);
+        va_end(args);
+    }
+}
+
+void picoquic_event_signal(picoquic_quic_t* quic, picoquic_event_enum event, const picoquic_connection_id_t* cid,
+    uint64_t current_time, const char* fmt, ...)
+{
+    quic->events.counters[event]++;
+
+    if (quic->events.F_text != NULL || (quic->F_log != NULL && cid == NULL)) {
+        va_list args;
+        va_start(args, fmt);
+        picoquic_event_text_v(quic, event, cid, current_time, fmt, args);
+        va_end(args);
+    }
+}
@@ -331,12 +331,20 @@ void picoquic_fastcc_observe(picoquic_path_t* path_x, uint64_t* cc_state, uint64
 
 #define picoquic_fastcc_ID "fast" 
 
+static void picoquic_fastcc_notify_ack(picoquic_cnx_t* cnx, picoquic_path_t* path_x,
+    picoquic_per_ack_state_t const* ack_state, uint64_t current_time)
+{
+    picoquic_cc_replay_ack_event(picoquic_fastcc_notify, cnx, path_x, ack_state, current_time);
+}
+
 picoquic_congestion_algorithm_t picoquic_fastcc_algorithm_struct = {
     picoquic_fastcc_ID, PICOQUIC_CC_ALGO_NUMBER_FAST,
     picoquic_fastcc_init,
     picoquic_fastcc_notify,
     picoquic_fastcc_delete,
-    picoquic_fastcc_observe
+    picoquic_fastcc_observe,
+    0,
+    picoquic_fastcc_notify_ack
 };
 
 picoquic_congestion_algorithm_t* picoquic_fastcc_algorithm = &picoquic_fastcc_algorithm_struct;
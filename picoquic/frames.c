@@ -24,6 +24,9 @@
 #include <string.h>
 #include "picoquic_internal.h"
 #include "tls_api.h"
+#include "picoquic_unified_log.h"
+#include "picoquic_metrics.h"
+#include "picoquic_profiler.h"
 
 static const size_t challenge_length = 8;
 
@@ -2030,6 +2033,8 @@ picoquic_packet_t* picoquic_check_spurious_retransmission(picoquic_cnx_t* cnx,
             }
 
             cnx->nb_spurious++;
+            PICOQUIC_METRICS_INC(cnx->quic, picoquic_metric_spurious_losses);
+            picoquic_log_trigger(cnx, picoquic_log_trigger_spurious_burst, current_time);
             should_delete = p;
         }
 
@@ -2270,6 +2275,79 @@ uint64_t picoquic_compute_ack_delay_max(picoquic_cnx_t* cnx, uint64_t rtt, uint6
     return ack_delay_max;
 }
 
+/* ACK frequency autotuning.
+ * The default computation aims at about 4 ACKs per congestion window, with the gap
+ * capped at 32 or 64 packets. At high packet rates, generating and processing
+ * ACKs becomes a significant part of the CPU load on both ends. The autotuner
+ * doubles the gap when the packet rate exceeds PICOQUIC_ACK_AUTOTUNE_PACKET_RATE,
+ * and if a CPU budget is set raises it until the measured cost of processing ACKs
+ * fits in that budget. In all cases it keeps at least PICOQUIC_ACK_AUTOTUNE_ACKS_PER_RTT
+ * ACKs per RTT, or twice that if reordering was observed, so that the RACK timers
+ * can still separate late packets from lost ones. The default gap is used in
+ * slow start and for one RTT after a loss, to not slow down the recovery.
+ */
+static uint64_t picoquic_autotune_ack_gap(picoquic_cnx_t* cnx, uint64_t data_rate, uint64_t nb_packets, uint64_t ack_gap)
+{
+    picoquic_path_t* path_x = cnx->path[0];
+    uint64_t current_time = picoquic_get_quic_time(cnx->quic);
+    uint64_t packet_rate = data_rate / path_x->send_mtu;
+    uint64_t acks_per_rtt = PICOQUIC_ACK_AUTOTUNE_ACKS_PER_RTT;
+    uint64_t target_gap = ack_gap;
+    uint64_t ack_gap_max;
+
+    if (path_x->nb_losses_found != cnx->ack_autotune_nb_losses) {
+        cnx->ack_autotune_nb_losses = path_x->nb_losses_found;
+        cnx->ack_autotune_hold_until = current_time + path_x->smoothed_rtt;
+    }
+
+    if (!path_x->is_ssthresh_initialized || current_time < cnx->ack_autotune_hold_until ||
+        cnx->is_simple_multipath_enabled || cnx->is_multipath_enabled) {
+        return ack_gap;
+    }
+
+    if (path_x->max_reorder_gap > 0 || path_x->nb_spurious > 0) {
+        acks_per_rtt = PICOQUIC_ACK_AUTOTUNE_ACKS_PER_RTT_REORDER;
+    }
+
+    if (packet_rate > PICOQUIC_ACK_AUTOTUNE_PACKET_RATE) {
+        target_gap = 2 * ack_gap;
+    }
+
+    if (cnx->ack_autotune_cycles_budget > 0 && cnx->ack_autotune_cycles_per_ack > 0) {
+        uint64_t max_ack_rate = cnx->ack_autotune_cycles_budget / cnx->ack_autotune_cycles_per_ack;
+        uint64_t budget_gap;
+
+        if (max_ack_rate == 0) {
+            max_ack_rate = 1;
+        }
+        budget_gap = (packet_rate + max_ack_rate - 1) / max_ack_rate;
+        if (budget_gap > target_gap) {
+            target_gap = budget_gap;
+        }
+    }
+
+    ack_gap_max = nb_packets / acks_per_rtt;
+    if (ack_gap_max > PICOQUIC_ACK_AUTOTUNE_GAP_MAX) {
+        ack_gap_max = PICOQUIC_ACK_AUTOTUNE_GAP_MAX;
+    }
+    if (target_gap > ack_gap_max) {
+        target_gap = ack_gap_max;
+    }
+
+    return (target_gap > ack_gap) ? target_gap : ack_gap;
+}
+
+/* Measure the CPU cost of processing an ACK frame, if autotuning within a CPU budget */
+static void picoquic_autotune_record_ack_cycles(picoquic_cnx_t* cnx, uint64_t cycles)
+{
+    if (cnx->ack_autotune_cycles_per_ack == 0) {
+        cnx->ack_autotune_cycles_per_ack = cycles;
+    }
+    else {
+        cnx->ack_autotune_cycles_per_ack = (7 * cnx->ack_autotune_cycles_per_ack + cycles) / 8;
+    }
+}
+
 void picoquic_compute_ack_gap_and_delay(picoquic_cnx_t* cnx, uint64_t rtt, uint64_t remote_min_ack_delay,
     uint64_t data_rate, uint64_t* ack_gap, uint64_t* ack_delay_max)
 {
@@ -2330,26 +2408,32 @@ void picoquic_compute_ack_gap_and_delay(picoquic_cnx_t* cnx, uint64_t rtt, uint6
             }
         }
     }
+
+    if (cnx->is_ack_autotune_enabled && cnx->is_ack_frequency_negotiated) {
+        *ack_gap = picoquic_autotune_ack_gap(cnx, data_rate, nb_packets, *ack_gap);
+    }
 }
 
 /* In a multipath environment, a packet can accry acknowledgements for multiple paths.
  * The packet_data context collects information about updates received for each of
- * these paths. */
-void picoquic_record_ack_packet_data(picoquic_packet_data_t* packet_data, picoquic_packet_t* acked_packet)
+ * these paths. Returns the index of the path in the packet data, or -1 if the
+ * packet could not be recorded. */
+int picoquic_record_ack_packet_data(picoquic_packet_data_t* packet_data, picoquic_packet_t* acked_packet)
 {
     picoquic_path_t* old_path = acked_packet->send_path;
+    int path_i = -1;
 
     if (old_path != NULL) {
         /* Find the path index in the packet data structure */
-        int path_i = 0;
+        path_i = 0;
         while (path_i < packet_data->nb_path_ack &&
             packet_data->path_ack[path_i].acked_path != old_path) {
             path_i++;
         }
         if (path_i == packet_data->nb_path_ack) {
-            if (path_i > PICOQUIC_NB_PATH_TARGET) {
+            if (path_i >= PICOQUIC_NB_PATH_TARGET) {
                 /* Too many ACKs in this packet -- do not update path status. */
-                return;
+                return -1;
             }
             packet_data->nb_path_ack++;
             packet_data->path_ack[path_i].acked_path = old_path;
@@ -2365,6 +2449,8 @@ void picoquic_record_ack_packet_data(picoquic_packet_data_t* packet_data, picoqu
         }
         packet_data->path_ack[path_i].data_acked += acked_packet->length;
     }
+
+    return path_i;
 }
 
 /* In a multipath environment, the acknowledgement packets will not always travel on the
@@ -2427,10 +2513,16 @@ static void picoquic_update_rtt_from_one_way(picoquic_cnx_t * cnx, picoquic_path
     old_path->rtt_sample = rtt_estimate;
 
     if (cnx->congestion_alg != NULL) {
-        cnx->congestion_alg->alg_notify(cnx, old_path,
-            picoquic_congestion_notification_rtt_measurement,
-            rtt_estimate, (cnx->is_time_stamp_enabled)?one_way_delay_estimate:0,
-            0, 0, current_time);
+        if (cnx->congestion_alg->alg_notify_ack != NULL) {
+            /* The sample will be passed in the aggregated ACK event */
+            old_path->is_rtt_sample_pending = 1;
+        }
+        else {
+            cnx->congestion_alg->alg_notify(cnx, old_path,
+                picoquic_congestion_notification_rtt_measurement,
+                rtt_estimate, (cnx->is_time_stamp_enabled) ? one_way_delay_estimate : 0,
+                0, 0, current_time);
+        }
     }
 }
 
@@ -2440,7 +2532,10 @@ void picoquic_update_path_rtt(picoquic_cnx_t* cnx, picoquic_path_t* old_path, pi
     uint64_t acknowledged_time = current_time - ack_delay;
     int64_t rtt_estimate = acknowledged_time - send_time;
 
+    cnx->loss_detection_epoch++;
+
     if (rtt_estimate > 0 && old_path != NULL && path_x != NULL) {
+        PICOQUIC_METRICS_RECORD(cnx->quic, picoquic_metric_rtt_usec, (uint64_t)rtt_estimate);
         int64_t one_way_delay_sample = 0;
         int64_t one_way_return_sample = 0;
         int is_old_path_valid = 1;
@@ -2558,6 +2653,31 @@ void picoquic_update_path_rtt(picoquic_cnx_t* cnx, picoquic_path_t* old_path, pi
     }
 }
 
+/* Deliver the aggregated ACK event, with the RTT sample pending on the path if any.
+ */
+static void picoquic_notify_ack_event(picoquic_cnx_t* cnx, picoquic_path_t* path_x,
+    picoquic_per_ack_state_t* ack_state, uint64_t current_time)
+{
+    ack_state->rtt_measurement = path_x->rtt_sample;
+    ack_state->one_way_delay = (cnx->is_time_stamp_enabled) ? path_x->one_way_delay_sample : 0;
+    ack_state->rtt_min = path_x->rtt_min;
+    ack_state->is_rtt_updated = path_x->is_rtt_sample_pending;
+    path_x->is_rtt_sample_pending = 0;
+
+    cnx->congestion_alg->alg_notify_ack(cnx, path_x, ack_state, current_time);
+}
+
+void picoquic_notify_pending_rtt(picoquic_cnx_t* cnx, picoquic_path_t* path_x, uint64_t current_time)
+{
+    if (path_x->is_rtt_sample_pending && cnx->congestion_alg != NULL &&
+        cnx->congestion_alg->alg_notify_ack != NULL) {
+        picoquic_per_ack_state_t ack_state;
+
+        memset(&ack_state, 0, sizeof(ack_state));
+        picoquic_notify_ack_event(cnx, path_x, &ack_state, current_time);
+    }
+}
+
 /* Once all frames in a packet have been received, update the delays and congestion
  * control varaibles for the path for which data was acknowledged.
  */
@@ -2565,6 +2685,8 @@ void picoquic_update_path_rtt(picoquic_cnx_t* cnx, picoquic_path_t* old_path, pi
 void process_decoded_packet_data(picoquic_cnx_t* cnx, picoquic_path_t * path_x,
     uint64_t current_time, picoquic_packet_data_t* packet_data)
 {
+    int is_ecn_delivered = (packet_data->ecn_ect0_delta | packet_data->ecn_ect1_delta | packet_data->ecn_ce_delta) == 0;
+
     for (int i = 0; i < packet_data->nb_path_ack; i++) {
         picoquic_update_path_rtt(cnx, packet_data->path_ack[i].acked_path, path_x,
             packet_data->path_ack[i].largest_sent_time, current_time, packet_data->last_ack_delay,
@@ -2579,7 +2701,28 @@ void process_decoded_packet_data(picoquic_cnx_t* cnx, picoquic_path_t * path_x,
             (packet_data->last_time_stamp_received == 0) ? current_time : packet_data->last_time_stamp_received,
             current_time);
 
-        if (cnx->congestion_alg != NULL && packet_data->path_ack[i].acked_path->rtt_sample > 0) {
+        if (cnx->congestion_alg == NULL) {
+            continue;
+        }
+        else if (cnx->congestion_alg->alg_notify_ack != NULL) {
+            picoquic_per_ack_state_t ack_state;
+
+            memset(&ack_state, 0, sizeof(ack_state));
+            ack_state.nb_bytes_acknowledged = packet_data->path_ack[i].cc_bytes_acked;
+            ack_state.nb_packets_acknowledged = packet_data->path_ack[i].cc_packets_acked;
+            ack_state.delivery_rate = packet_data->path_ack[i].acked_path->bandwidth_estimate;
+            ack_state.is_delivery_rate_sampled = 1;
+            ack_state.is_app_limited = (packet_data->path_ack[i].rs_is_path_limited) ? 1 : 0;
+            if (packet_data->path_ack[i].acked_path == cnx->path[0] && !is_ecn_delivered) {
+                ack_state.ecn_ect0_delta = packet_data->ecn_ect0_delta;
+                ack_state.ecn_ect1_delta = packet_data->ecn_ect1_delta;
+                ack_state.ecn_ce_delta = packet_data->ecn_ce_delta;
+                ack_state.ecn_packet_number = packet_data->ecn_packet_number;
+                is_ecn_delivered = 1;
+            }
+            picoquic_notify_ack_event(cnx, packet_data->path_ack[i].acked_path, &ack_state, current_time);
+        }
+        else if (packet_data->path_ack[i].acked_path->rtt_sample > 0) {
             cnx->congestion_alg->alg_notify(cnx, packet_data->path_ack[i].acked_path,
                 picoquic_congestion_notification_bw_measurement,
                 packet_data->path_ack[i].acked_path->rtt_sample,
@@ -2588,6 +2731,18 @@ void process_decoded_packet_data(picoquic_cnx_t* cnx, picoquic_path_t * path_x,
         }
     }
 
+    if (!is_ecn_delivered && cnx->congestion_alg != NULL && cnx->congestion_alg->alg_notify_ack != NULL) {
+        /* ECN counters increased in an ACK that did not acknowledge new data on the default path */
+        picoquic_per_ack_state_t ack_state;
+
+        memset(&ack_state, 0, sizeof(ack_state));
+        ack_state.ecn_ect0_delta = packet_data->ecn_ect0_delta;
+        ack_state.ecn_ect1_delta = packet_data->ecn_ect1_delta;
+        ack_state.ecn_ce_delta = packet_data->ecn_ce_delta;
+        ack_state.ecn_packet_number = packet_data->ecn_packet_number;
+        picoquic_notify_ack_event(cnx, cnx->path[0], &ack_state, current_time);
+    }
+
     if (cnx->path[0]->is_ssthresh_initialized && !cnx->path[0]->is_ticket_seeded) {
         picoquic_seed_ticket(cnx, cnx->path[0], current_time);
     }
@@ -3145,6 +3300,8 @@ static int picoquic_process_ack_range(
                 }
 
                 if (old_path != NULL) {
+                    int path_i;
+
                     old_path->delivered += p->length;
                     /* Reset the flags tracking loss of ack only packets and corresponding ping */
                     old_path->is_ack_lost = 0;
@@ -3157,13 +3314,18 @@ static int picoquic_process_ack_range(
                         old_path->nb_retransmit = 0;
                     }
 
-                    picoquic_record_ack_packet_data(packet_data, p);
+                    path_i = picoquic_record_ack_packet_data(packet_data, p);
 
-                    /* In theory this is not needed, the congestion window increases could just
-                     * as well be performed once per packet. However, we keep this code here in
-                     * order to maintain the same schedule of CWIN increase as the previous
-                     * non-1WD version */
-                    if (cnx->congestion_alg != NULL) {
+                    if (cnx->congestion_alg != NULL && cnx->congestion_alg->alg_notify_ack != NULL && path_i >= 0) {
+                        /* Acknowledged data will be reported once, in the aggregated ACK event */
+                        packet_data->path_ack[path_i].cc_bytes_acked += p->length;
+                        packet_data->path_ack[path_i].cc_packets_acked++;
+                    }
+                    else if (cnx->congestion_alg != NULL) {
+                        /* In theory this is not needed, the congestion window increases could just
+                         * as well be performed once per packet. However, we keep this code here in
+                         * order to maintain the same schedule of CWIN increase as the previous
+                         * non-1WD version */
                         cnx->congestion_alg->alg_notify(cnx, old_path,
                             picoquic_congestion_notification_acknowledgement,
                             0, 0, p->length, 0, current_time);
@@ -3215,6 +3377,9 @@ const uint8_t* picoquic_decode_ack_frame(picoquic_cnx_t* cnx, const uint8_t* byt
     picoquic_packet_context_enum pc = picoquic_context_from_epoch(epoch);
     uint64_t ecnx3[3] = { 0, 0, 0 };
     uint8_t first_byte = bytes[0];
+    uint64_t cycles_start = (cnx->ack_autotune_cycles_budget > 0 || cnx->quic->metrics != NULL) ? picoquic_cpu_cycles() : 0;
+
+    cnx->loss_detection_epoch++;
 
     if (picoquic_parse_ack_header(bytes, bytes_max-bytes, &num_block,
         (has_path_id)?&path_id:NULL,
@@ -3329,20 +3494,38 @@ const uint8_t* picoquic_decode_ack_frame(picoquic_cnx_t* cnx, const uint8_t* byt
 
     if (bytes != 0 && is_ecn) {
         if (ecnx3[0] > cnx->pkt_ctx[pc].ecn_ect0_total_remote) {
+            packet_data->ecn_ect0_delta += ecnx3[0] - cnx->pkt_ctx[pc].ecn_ect0_total_remote;
             cnx->pkt_ctx[pc].ecn_ect0_total_remote = ecnx3[0];
         }
         if (ecnx3[1] > cnx->pkt_ctx[pc].ecn_ect1_total_remote) {
+            packet_data->ecn_ect1_delta += ecnx3[1] - cnx->pkt_ctx[pc].ecn_ect1_total_remote;
             cnx->pkt_ctx[pc].ecn_ect1_total_remote = ecnx3[1];
         }
         if (ecnx3[2] > cnx->pkt_ctx[pc].ecn_ce_total_remote) {
-            cnx->pkt_ctx[pc].ecn_ce_total_remote = ecnx3[2];
+            if (cnx->congestion_alg->alg_notify_ack != NULL) {
+                packet_data->ecn_ce_delta += ecnx3[2] - cnx->pkt_ctx[pc].ecn_ce_total_remote;
+                packet_data->ecn_packet_number = picoquic_sack_list_last(&cnx->ack_ctx[pc].sack_list);
+                cnx->pkt_ctx[pc].ecn_ce_total_remote = ecnx3[2];
+            }
+            else {
+                cnx->pkt_ctx[pc].ecn_ce_total_remote = ecnx3[2];
 
-            cnx->congestion_alg->alg_notify(cnx, cnx->path[0],
-                picoquic_congestion_notification_ecn_ec,
-                0, 0, 0, picoquic_sack_list_last(&cnx->ack_ctx[pc].sack_list), current_time);
+                cnx->congestion_alg->alg_notify(cnx, cnx->path[0],
+                    picoquic_congestion_notification_ecn_ec,
+                    0, 0, 0, picoquic_sack_list_last(&cnx->ack_ctx[pc].sack_list), current_time);
+            }
         }
     }
 
+    if (cycles_start != 0) {
+        uint64_t ack_cycles = picoquic_cpu_cycles() - cycles_start;
+
+        if (cnx->ack_autotune_cycles_budget > 0) {
+            picoquic_autotune_record_ack_cycles(cnx, ack_cycles);
+        }
+        PICOQUIC_METRICS_RECORD(cnx->quic, picoquic_metric_ack_cycles, ack_cycles);
+    }
+
     return bytes;
 }
 
@@ -4149,6 +4332,7 @@ const uint8_t* picoquic_decode_path_challenge_frame(picoquic_cnx_t* cnx, const u
             (addr_to == NULL || picoquic_compare_addr(addr_to, (struct sockaddr *)&path_x->local_addr) == 0)) {
             path_x->challenge_response = challenge_response;
             path_x->response_required = 1;
+            cnx->is_path_sched_cache_valid = 0;
         } else {
             DBG_PRINTF("%s", "Path challenge ignored, wrong addresses\n");
         }
@@ -4194,11 +4378,13 @@ const uint8_t* picoquic_decode_path_response_frame(picoquic_cnx_t* cnx, const ui
             if (found_challenge && !path_x->challenge_verified){
                 /* TODO: update the RTT if using initial value */
                 path_x->challenge_verified = 1;
+                cnx->is_path_sched_cache_valid = 0;
 
                 if (path_x->smoothed_rtt == PICOQUIC_INITIAL_RTT
                     && path_x->rtt_variant == 0) {
                     /* We received a first packet from the peer! */
                     picoquic_update_path_rtt(cnx, path_x, path_x, path_x->challenge_time_first, current_time, 0, 0);
+                    picoquic_notify_pending_rtt(cnx, path_x, current_time);
                 }
             }
         }
@@ -4433,6 +4619,79 @@ uint8_t * picoquic_format_first_datagram_frame(picoquic_cnx_t* cnx, uint8_t* byt
     return bytes;
 }
 
+/* Copies of datagram frames, for the redundant multipath scheduler.
+ * The frames found in "bytes" were just sent on some path, and are queued for sending
+ * on "path_x". The frames are reencoded with an explicit length, because the original
+ * encoding may extend to the end of the packet. Padding bytes are skipped. The copies
+ * beyond PICOQUIC_REDUNDANT_DATAGRAM_MAX per path are dropped, since a late copy
+ * defeats the purpose of redundancy.
+ */
+int picoquic_queue_redundant_datagrams(picoquic_cnx_t* cnx, picoquic_path_t* path_x, const uint8_t* bytes, size_t length)
+{
+    int ret = 0;
+    uint8_t* bytes_next = (uint8_t*)bytes;
+    const uint8_t* bytes_max = bytes + length;
+
+    while (ret == 0 && bytes_next != NULL && bytes_next < bytes_max) {
+        if (*bytes_next == picoquic_frame_type_padding) {
+            bytes_next++;
+        }
+        else {
+            uint8_t frame_id;
+            uint64_t dg_length = 0;
+            uint8_t* dg_bytes = picoquic_decode_datagram_frame_header(bytes_next, bytes_max, &frame_id, &dg_length);
+
+            if (dg_bytes == NULL ||
+                !PICOQUIC_IN_RANGE(frame_id, picoquic_frame_type_datagram, picoquic_frame_type_datagram_l)) {
+                ret = PICOQUIC_ERROR_UNEXPECTED_ERROR;
+            }
+            else {
+                if (path_x->nb_redundant_datagrams < PICOQUIC_REDUNDANT_DATAGRAM_MAX) {
+                    uint8_t frame_buffer[PICOQUIC_MAX_PACKET_SIZE];
+                    int more_data = 0;
+                    int is_pure_ack = 1;
+                    uint8_t* frame_next = picoquic_format_datagram_frame(frame_buffer, frame_buffer + sizeof(frame_buffer),
+                        &more_data, &is_pure_ack, (size_t)dg_length, dg_bytes);
+
+                    if (frame_next > frame_buffer &&
+                        (ret = picoquic_queue_misc_or_dg_frame(cnx, &path_x->first_redundant_datagram, &path_x->last_redundant_datagram,
+                            frame_buffer, frame_next - frame_buffer, 0)) == 0) {
+                        path_x->nb_redundant_datagrams++;
+                    }
+                }
+                bytes_next = dg_bytes + dg_length;
+            }
+        }
+    }
+
+    return ret;
+}
+
+uint8_t* picoquic_format_redundant_datagram_frames(picoquic_path_t* path_x, uint8_t* bytes, uint8_t* bytes_max, int* more_data, int* is_pure_ack)
+{
+    while (path_x->first_redundant_datagram != NULL) {
+        uint8_t* bytes0 = bytes;
+
+        bytes = picoquic_format_first_misc_or_dg_frame(bytes, bytes_max, more_data, is_pure_ack,
+            &path_x->first_redundant_datagram, &path_x->last_redundant_datagram);
+        if (bytes == bytes0) {
+            break;
+        }
+        path_x->nb_redundant_datagrams--;
+    }
+
+    return bytes;
+}
+
+void picoquic_delete_redundant_datagrams(picoquic_path_t* path_x)
+{
+    while (path_x->first_redundant_datagram != NULL) {
+        picoquic_delete_misc_or_dg(&path_x->first_redundant_datagram, &path_x->last_redundant_datagram,
+            path_x->first_redundant_datagram);
+    }
+    path_x->nb_redundant_datagrams = 0;
+}
+
 /* Provide a datagram buffer for the length specified by the application.
  * The stack called with a pointer to the available space, which may extend
  * to the end of the packet. There are several interesting cases:
@@ -4610,14 +4869,17 @@ uint8_t* picoquic_format_ack_frequency_frame(picoquic_cnx_t* cnx, uint8_t* bytes
     picoquic_compute_ack_gap_and_delay(cnx, cnx->path[0]->rtt_min, cnx->remote_parameters.min_ack_delay,
         cnx->path[0]->bandwidth_estimate, &ack_gap, &ack_delay_max);
     
-    if (ack_gap <= cnx->ack_gap_local &&
+    if (ack_gap < cnx->ack_gap_local &&
+        (!cnx->is_ack_autotune_enabled || 4 * ack_gap > 3 * cnx->ack_gap_local)) {
+        /* Only the autotuner lowers the gap, and only for significant changes */
+        ack_gap = cnx->ack_gap_local;
+    }
+
+    if (ack_gap == cnx->ack_gap_local &&
         ack_delay_max == cnx->ack_frequency_delay_local) {
         cnx->is_ack_frequency_updated = 0;
     }
     else {
-        if (ack_gap < cnx->ack_gap_local) {
-            ack_gap = cnx->ack_gap_local;
-        }
         if ((bytes = picoquic_frames_varint_encode(bytes, bytes_max, picoquic_frame_type_ack_frequency)) != NULL &&
             (bytes = picoquic_frames_varint_encode(bytes, bytes_max, seq)) != NULL &&
             (bytes = picoquic_frames_varint_encode(bytes, bytes_max, ack_gap)) != NULL &&
@@ -4931,9 +5193,7 @@ uint8_t* picoquic_format_bdp_frame(picoquic_cnx_t* cnx, uint8_t* bytes, uint8_t*
     }
     else {
         /* Client sends bdp back to the server */
-        picoquic_stored_ticket_t* stored_ticket = picoquic_get_stored_ticket(cnx->quic->p_first_ticket,
-            current_time, cnx->sni, (uint16_t)strlen(cnx->sni), cnx->alpn, (uint16_t)strlen(cnx->alpn),
-            picoquic_supported_versions[cnx->version_index].version, 1, 0);
+        picoquic_stored_ticket_t* stored_ticket = picoquic_get_cnx_stored_ticket(cnx, current_time);
         if (stored_ticket != NULL) {
             recon_bytes_in_flight = stored_ticket->tp_0rtt[picoquic_tp_0rtt_cwin_remote];
             recon_min_rtt = stored_ticket->tp_0rtt[picoquic_tp_0rtt_rtt_remote];
@@ -4979,6 +5239,7 @@ int picoquic_decode_frames(picoquic_cnx_t* cnx, picoquic_path_t * path_x, const
     int is_path_validating_packet = 1; /* Will be set to zero if non validating frame received */
     picoquic_packet_context_enum pc = picoquic_context_from_epoch(epoch);
     picoquic_packet_data_t packet_data;
+    PICOQUIC_PROFILE_BEGIN(cnx->quic, profile_start);
 
     memset(&packet_data, 0, sizeof(packet_data));
 
@@ -5217,6 +5478,8 @@ int picoquic_decode_frames(picoquic_cnx_t* cnx, picoquic_path_t * path_x, const
         }
     }
 
+    PICOQUIC_PROFILE_END(cnx->quic, profile_start, picoquic_profile_decode_frames);
+
     return bytes != NULL ? 0 : PICOQUIC_ERROR_DETECTED;
 }
 
@@ -2310,6 +2310,15 @@ void textlog_cc_dump(picoquic_cnx_t* cnx, uint64_t current_time)
     }
 }
 
+void textlog_log_trigger(picoquic_cnx_t* cnx, char const* trigger_name, uint64_t current_time)
+{
+    if (cnx->quic->F_log != NULL) {
+        picoquic_log_prefix_initial_cid64(cnx->quic->F_log, picoquic_val64_connection_id(cnx->initial_cnxid));
+        fprintf(cnx->quic->F_log, "Log trigger: %s at T=%fs\n", trigger_name,
+            (double)(current_time - cnx->start_time) / 1000000.0);
+    }
+}
+
 struct st_picoquic_unified_logging_t textlog_functions = {
     /* Per context log function */
     txtlog_context_free_app_message,
@@ -2327,7 +2336,8 @@ struct st_picoquic_unified_logging_t textlog_functions = {
     textlog_tls_ticket,
     textlog_new_connection,
     textlog_close_connection,
-    textlog_cc_dump
+    textlog_cc_dump,
+    textlog_log_trigger
 };
 
 int picoquic_set_textlog(picoquic_quic_t* quic, char const* textlog_file)
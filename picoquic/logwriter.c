@@ -31,6 +31,9 @@
 #include "picoquic_unified_log.h"
 #include "picoquic_binlog.h"
 
+/* Worst case size of a packet chunk: each frame is preceded by its length */
+#define BINLOG_PACKET_CHUNK_MAX (2 * PICOQUIC_MAX_PACKET_SIZE + 256)
+
 static const uint8_t* picoquic_log_fixed_skip(const uint8_t* bytes, const uint8_t* bytes_max, size_t size)
 {
     return bytes == NULL ? NULL : ((bytes += size) <= bytes_max ? bytes : NULL);
@@ -58,18 +61,20 @@ static const uint8_t* picoquic_log_length(const uint8_t* bytes, const uint8_t* b
     return (len == 0 || *nsz != n64) ? NULL : bytes + len;
 }
 
-static void picoquic_binlog_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+/* Frames are only logged if they fit in the chunk, so that a truncated chunk remains well formed */
+static void picoquic_binlog_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     if (bytes != NULL && bytes_max != NULL) {
         size_t len = bytes_max - bytes;
-        uint8_t varlen[8];
-        size_t l_varlen = picoquic_varint_encode(varlen, 8, len);
-        fwrite(varlen, 1, l_varlen, f);
-        fwrite(bytes, 1, len, f);
+
+        if (bytestream_vint_len(len) + len <= bytestream_remain(s)) {
+            (void)bytewrite_vint(s, len);
+            (void)bytewrite_buffer(s, bytes, len);
+        }
     }
 }
 
-static const uint8_t* picoquic_log_stream_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_stream_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     const uint8_t* bytes_begin = bytes;
     uint8_t ftype = bytes[0];
@@ -101,7 +106,7 @@ static const uint8_t* picoquic_log_stream_frame(FILE* f, const uint8_t* bytes, c
             extra_bytes = length;
         }
         if (has_length) {
-            picoquic_binlog_frame(f, bytes_begin, bytes + extra_bytes);
+            picoquic_binlog_frame(s, bytes_begin, bytes + extra_bytes);
         }
         else {
             uint8_t* log_next = log_buffer;
@@ -112,10 +117,10 @@ static const uint8_t* picoquic_log_stream_frame(FILE* f, const uint8_t* bytes, c
             if ((log_next = picoquic_frames_varint_encode(log_next, log_buffer + 256, length)) != NULL) {
                 memcpy(log_next, bytes, extra_bytes);
                 log_next += extra_bytes;
-                picoquic_binlog_frame(f, log_buffer, log_next);
+                picoquic_binlog_frame(s, log_buffer, log_next);
             }
             else {
-                picoquic_binlog_frame(f, log_buffer, log_buffer + l_head);
+                picoquic_binlog_frame(s, log_buffer, log_buffer + l_head);
             }
         }
 
@@ -127,12 +132,12 @@ static const uint8_t* picoquic_log_stream_frame(FILE* f, const uint8_t* bytes, c
         if (length > 26) {
             length = 26;
         }
-        picoquic_binlog_frame(f, bytes_begin, bytes_begin + length);
+        picoquic_binlog_frame(s, bytes_begin, bytes_begin + length);
     }
     return bytes;
 }
 
-static const uint8_t* picoquic_log_ack_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_ack_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     const uint8_t* bytes_begin = bytes;
     uint64_t ftype = 0;
@@ -163,11 +168,11 @@ static const uint8_t* picoquic_log_ack_frame(FILE* f, const uint8_t* bytes, cons
         bytes = picoquic_log_varint_skip(bytes, bytes_max);
     }
 
-    picoquic_binlog_frame(f, bytes_begin, bytes);
+    picoquic_binlog_frame(s, bytes_begin, bytes);
     return bytes;
 }
 
-static const uint8_t* picoquic_log_reset_stream_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_reset_stream_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     const uint8_t * bytes_begin = bytes;
 
@@ -176,11 +181,11 @@ static const uint8_t* picoquic_log_reset_stream_frame(FILE* f, const uint8_t* by
     bytes = picoquic_log_varint_skip(bytes, bytes_max);
     bytes = picoquic_log_varint_skip(bytes, bytes_max);
 
-    picoquic_binlog_frame(f, bytes_begin, bytes);
+    picoquic_binlog_frame(s, bytes_begin, bytes);
     return bytes;
 }
 
-static const uint8_t* picoquic_log_stop_sending_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_stop_sending_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     const uint8_t* bytes_begin = bytes;
 
@@ -188,11 +193,11 @@ static const uint8_t* picoquic_log_stop_sending_frame(FILE* f, const uint8_t* by
     bytes = picoquic_log_varint_skip(bytes, bytes_max);
     bytes = picoquic_log_varint_skip(bytes, bytes_max);
 
-    picoquic_binlog_frame(f, bytes_begin, bytes);
+    picoquic_binlog_frame(s, bytes_begin, bytes);
     return bytes;
 }
 
-static const uint8_t* picoquic_log_close_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_close_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     const uint8_t* bytes_begin = bytes;
     size_t length = 0;
@@ -203,11 +208,11 @@ static const uint8_t* picoquic_log_close_frame(FILE* f, const uint8_t* bytes, co
     bytes = picoquic_log_length(bytes, bytes_max, &length);
     bytes = picoquic_log_fixed_skip(bytes, bytes_max, length);
 
-    picoquic_binlog_frame(f, bytes_begin, bytes);
+    picoquic_binlog_frame(s, bytes_begin, bytes);
     return bytes;
 }
 
-static const uint8_t* picoquic_log_app_close_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_app_close_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     const uint8_t* bytes_begin = bytes;
     size_t length = 0;
@@ -217,22 +222,22 @@ static const uint8_t* picoquic_log_app_close_frame(FILE* f, const uint8_t* bytes
     bytes = picoquic_log_length(bytes, bytes_max, &length);
     bytes = picoquic_log_fixed_skip(bytes, bytes_max, length);
 
-    picoquic_binlog_frame(f, bytes_begin, bytes);
+    picoquic_binlog_frame(s, bytes_begin, bytes);
     return bytes;
 }
 
-static const uint8_t* picoquic_log_max_data_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_max_data_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     const uint8_t* bytes_begin = bytes;
 
     bytes = picoquic_log_fixed_skip(bytes, bytes_max, 1);
     bytes = picoquic_log_varint_skip(bytes, bytes_max);
 
-    picoquic_binlog_frame(f, bytes_begin, bytes);
+    picoquic_binlog_frame(s, bytes_begin, bytes);
     return bytes;
 }
 
-static const uint8_t* picoquic_log_max_stream_data_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_max_stream_data_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     const uint8_t* bytes_begin = bytes;
 
@@ -240,33 +245,33 @@ static const uint8_t* picoquic_log_max_stream_data_frame(FILE* f, const uint8_t*
     bytes = picoquic_log_varint_skip(bytes, bytes_max);
     bytes = picoquic_log_varint_skip(bytes, bytes_max);
 
-    picoquic_binlog_frame(f, bytes_begin, bytes);
+    picoquic_binlog_frame(s, bytes_begin, bytes);
     return bytes;
 }
 
-static const uint8_t* picoquic_log_max_stream_id_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_max_stream_id_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     const uint8_t* bytes_begin = bytes;
 
     bytes = picoquic_log_fixed_skip(bytes, bytes_max, 1);
     bytes = picoquic_log_varint_skip(bytes, bytes_max);
 
-    picoquic_binlog_frame(f, bytes_begin, bytes);
+    picoquic_binlog_frame(s, bytes_begin, bytes);
     return bytes;
 }
 
-static const uint8_t* picoquic_log_blocked_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_blocked_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     const uint8_t* bytes_begin = bytes;
 
     bytes = picoquic_log_fixed_skip(bytes, bytes_max, 1);
     bytes = picoquic_log_varint_skip(bytes, bytes_max);
 
-    picoquic_binlog_frame(f, bytes_begin, bytes);
+    picoquic_binlog_frame(s, bytes_begin, bytes);
     return bytes;
 }
 
-static const uint8_t* picoquic_log_stream_blocked_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_stream_blocked_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     const uint8_t* bytes_begin = bytes;
 
@@ -274,22 +279,22 @@ static const uint8_t* picoquic_log_stream_blocked_frame(FILE* f, const uint8_t*
     bytes = picoquic_log_varint_skip(bytes, bytes_max);
     bytes = picoquic_log_varint_skip(bytes, bytes_max);
 
-    picoquic_binlog_frame(f, bytes_begin, bytes);
+    picoquic_binlog_frame(s, bytes_begin, bytes);
     return bytes;
 }
 
-static const uint8_t* picoquic_log_streams_blocked_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_streams_blocked_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     const uint8_t* bytes_begin = bytes;
 
     bytes = picoquic_log_fixed_skip(bytes, bytes_max, 1);
     bytes = picoquic_log_varint_skip(bytes, bytes_max);
 
-    picoquic_binlog_frame(f, bytes_begin, bytes);
+    picoquic_binlog_frame(s, bytes_begin, bytes);
     return bytes;
 }
 
-static const uint8_t* picoquic_log_new_connection_id_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_new_connection_id_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     const uint8_t* bytes_begin = bytes;
 
@@ -302,22 +307,22 @@ static const uint8_t* picoquic_log_new_connection_id_frame(FILE* f, const uint8_
 
     bytes = picoquic_log_fixed_skip(bytes, bytes_max, PICOQUIC_RESET_SECRET_SIZE);
 
-    picoquic_binlog_frame(f, bytes_begin, bytes);
+    picoquic_binlog_frame(s, bytes_begin, bytes);
     return bytes;
 }
 
-static const uint8_t* picoquic_log_retire_connection_id_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_retire_connection_id_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     const uint8_t* bytes_begin = bytes;
 
     bytes = picoquic_log_fixed_skip(bytes, bytes_max, 1);
     bytes = picoquic_log_varint_skip(bytes, bytes_max);
 
-    picoquic_binlog_frame(f, bytes_begin, bytes);
+    picoquic_binlog_frame(s, bytes_begin, bytes);
     return bytes;
 }
 
-static const uint8_t* picoquic_log_new_token_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_new_token_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     const uint8_t* bytes_begin = bytes;
     size_t length = 0;
@@ -327,21 +332,21 @@ static const uint8_t* picoquic_log_new_token_frame(FILE* f, const uint8_t* bytes
 
     bytes = picoquic_log_fixed_skip(bytes, bytes_max, length);
 
-    picoquic_binlog_frame(f, bytes_begin, bytes);
+    picoquic_binlog_frame(s, bytes_begin, bytes);
     return bytes;
 }
 
-static const uint8_t* picoquic_log_path_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_path_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     const uint8_t* bytes_begin = bytes;
 
     bytes = picoquic_log_fixed_skip(bytes, bytes_max, 1 + 8);
 
-    picoquic_binlog_frame(f, bytes_begin, bytes);
+    picoquic_binlog_frame(s, bytes_begin, bytes);
     return bytes;
 }
 
-static const uint8_t* picoquic_log_crypto_hs_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_crypto_hs_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     const uint8_t* bytes_begin = bytes;
     size_t length = 0;
@@ -350,24 +355,24 @@ static const uint8_t* picoquic_log_crypto_hs_frame(FILE* f, const uint8_t* bytes
     bytes = picoquic_log_varint_skip(bytes, bytes_max);
     bytes = picoquic_log_length(bytes, bytes_max, &length);
 
-    picoquic_binlog_frame(f, bytes_begin, bytes);
+    picoquic_binlog_frame(s, bytes_begin, bytes);
 
     bytes = picoquic_log_fixed_skip(bytes, bytes_max, length);
     return bytes;
 }
 
 
-static const uint8_t* picoquic_log_handshake_done_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_handshake_done_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     const uint8_t* bytes_begin = bytes;
 
     bytes = picoquic_log_fixed_skip(bytes, bytes_max, 1);
 
-    picoquic_binlog_frame(f, bytes_begin, bytes);
+    picoquic_binlog_frame(s, bytes_begin, bytes);
     return bytes;
 }
 
-static const uint8_t* picoquic_log_datagram_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_datagram_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     const uint8_t* bytes_begin = bytes;
     uint8_t ftype = bytes[0];
@@ -381,36 +386,36 @@ static const uint8_t* picoquic_log_datagram_frame(FILE* f, const uint8_t* bytes,
         length = bytes_max - bytes;
     }
 
-    picoquic_binlog_frame(f, bytes_begin, bytes);
+    picoquic_binlog_frame(s, bytes_begin, bytes);
 
     bytes = picoquic_log_fixed_skip(bytes, bytes_max, length);
     return bytes;
 }
 
-static const uint8_t* picoquic_log_time_stamp_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_time_stamp_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     const uint8_t* bytes_begin = bytes;
 
     bytes = picoquic_log_varint_skip(bytes, bytes_max); /* frame type as varint */
     bytes = picoquic_log_varint_skip(bytes, bytes_max); /* time stamp as varint */
 
-    picoquic_binlog_frame(f, bytes_begin, bytes);
+    picoquic_binlog_frame(s, bytes_begin, bytes);
 
     return bytes;
 }
 
-static const uint8_t* picoquic_log_path_abandon_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_path_abandon_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     const uint8_t* bytes_begin = bytes;
     bytes = picoquic_log_varint_skip(bytes, bytes_max); /* frame type as varint */
     bytes = picoquic_skip_path_abandon_frame(bytes, bytes_max); /* skip abandon frame */
-    picoquic_binlog_frame(f, bytes_begin, bytes);
+    picoquic_binlog_frame(s, bytes_begin, bytes);
 
     return bytes;
 }
 
 
-static const uint8_t* picoquic_log_ack_frequency_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_ack_frequency_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     const uint8_t* bytes_begin = bytes;
 
@@ -420,24 +425,24 @@ static const uint8_t* picoquic_log_ack_frequency_frame(FILE* f, const uint8_t* b
     bytes = picoquic_log_varint_skip(bytes, bytes_max); /* Max ACK delay */
     bytes = picoquic_log_fixed_skip(bytes, bytes_max, 1); /* Ignore order */
 
-    picoquic_binlog_frame(f, bytes_begin, bytes);
+    picoquic_binlog_frame(s, bytes_begin, bytes);
 
     return bytes;
 }
 
-static const uint8_t* picoquic_log_erroring_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_erroring_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     size_t frame_size = bytes_max - bytes;
     size_t copied = (frame_size > 8) ? 8 : frame_size;
 
-    picoquic_binlog_frame(f, bytes, bytes + copied);
+    picoquic_binlog_frame(s, bytes, bytes + copied);
 
     return NULL;
 }
 
-static const uint8_t* picoquic_log_padding(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_padding(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
-    picoquic_binlog_frame(f, bytes, bytes + 1);
+    picoquic_binlog_frame(s, bytes, bytes + 1);
 
     uint8_t ftype = bytes[0];
     while (bytes < bytes_max && bytes[0] == ftype) {
@@ -447,7 +452,7 @@ static const uint8_t* picoquic_log_padding(FILE* f, const uint8_t* bytes, const
     return bytes;
 }
 
-static const uint8_t* picoquic_log_bdp_frame(FILE* f, const uint8_t* bytes, const uint8_t* bytes_max)
+static const uint8_t* picoquic_log_bdp_frame(bytestream* s, const uint8_t* bytes, const uint8_t* bytes_max)
 {
     const uint8_t* bytes_begin = bytes;
     size_t ip_len = 0;
@@ -459,12 +464,12 @@ static const uint8_t* picoquic_log_bdp_frame(FILE* f, const uint8_t* bytes, cons
     bytes = picoquic_log_length(bytes, bytes_max, &ip_len); /*  IP Address length */
     bytes = picoquic_log_fixed_skip(bytes, bytes_max, ip_len); /* IP address value */
 
-    picoquic_binlog_frame(f, bytes_begin, bytes);
+    picoquic_binlog_frame(s, bytes_begin, bytes);
 
     return bytes;
 }
 
-void picoquic_binlog_frames(FILE * f, const uint8_t* bytes, size_t length)
+static void binlog_compose_frames(bytestream* s, const uint8_t* bytes, size_t length)
 {
     const uint8_t* bytes_max = bytes + length;
 
@@ -484,7 +489,7 @@ void picoquic_binlog_frames(FILE * f, const uint8_t* bytes, size_t length)
         }
 
         if (PICOQUIC_IN_RANGE(ftype, picoquic_frame_type_stream_range_min, picoquic_frame_type_stream_range_max)) {
-            bytes = picoquic_log_stream_frame(f, bytes, bytes_max);
+            bytes = picoquic_log_stream_frame(s, bytes, bytes_max);
             continue;
         }
 
@@ -493,86 +498,96 @@ void picoquic_binlog_frames(FILE * f, const uint8_t* bytes, size_t length)
         case picoquic_frame_type_ack_ecn:
         case picoquic_frame_type_ack_mp:
         case picoquic_frame_type_ack_mp_ecn:
-            bytes = picoquic_log_ack_frame(f, bytes, bytes_max);
+            bytes = picoquic_log_ack_frame(s, bytes, bytes_max);
             break;
         case picoquic_frame_type_retire_connection_id:
-            bytes = picoquic_log_retire_connection_id_frame(f, bytes, bytes_max);
+            bytes = picoquic_log_retire_connection_id_frame(s, bytes, bytes_max);
             break;
         case picoquic_frame_type_padding:
         case picoquic_frame_type_ping:
-            bytes = picoquic_log_padding(f, bytes, bytes_max);
+            bytes = picoquic_log_padding(s, bytes, bytes_max);
             break;
         case picoquic_frame_type_reset_stream:
-            bytes = picoquic_log_reset_stream_frame(f, bytes, bytes_max);
+            bytes = picoquic_log_reset_stream_frame(s, bytes, bytes_max);
             break;
         case picoquic_frame_type_connection_close:
-            bytes = picoquic_log_close_frame(f, bytes, bytes_max);
+            bytes = picoquic_log_close_frame(s, bytes, bytes_max);
             break;
         case picoquic_frame_type_application_close:
-            bytes = picoquic_log_app_close_frame(f, bytes, bytes_max);
+            bytes = picoquic_log_app_close_frame(s, bytes, bytes_max);
             break;
         case picoquic_frame_type_max_data:
-            bytes = picoquic_log_max_data_frame(f, bytes, bytes_max);
+            bytes = picoquic_log_max_data_frame(s, bytes, bytes_max);
             break;
         case picoquic_frame_type_max_stream_data:
-            bytes = picoquic_log_max_stream_data_frame(f, bytes, bytes_max);
+            bytes = picoquic_log_max_stream_data_frame(s, bytes, bytes_max);
             break;
         case picoquic_frame_type_max_streams_bidir:
         case picoquic_frame_type_max_streams_unidir:
-            bytes = picoquic_log_max_stream_id_frame(f, bytes, bytes_max);
+            bytes = picoquic_log_max_stream_id_frame(s, bytes, bytes_max);
             break;
         case picoquic_frame_type_data_blocked:
-            bytes = picoquic_log_blocked_frame(f, bytes, bytes_max);
+            bytes = picoquic_log_blocked_frame(s, bytes, bytes_max);
             break;
         case picoquic_frame_type_stream_data_blocked:
-            bytes = picoquic_log_stream_blocked_frame(f, bytes, bytes_max);
+            bytes = picoquic_log_stream_blocked_frame(s, bytes, bytes_max);
             break;
         case picoquic_frame_type_streams_blocked_bidir:
         case picoquic_frame_type_streams_blocked_unidir:
-            bytes = picoquic_log_streams_blocked_frame(f, bytes, bytes_max);
+            bytes = picoquic_log_streams_blocked_frame(s, bytes, bytes_max);
             break;
         case picoquic_frame_type_new_connection_id:
-            bytes = picoquic_log_new_connection_id_frame(f, bytes, bytes_max);
+            bytes = picoquic_log_new_connection_id_frame(s, bytes, bytes_max);
             break;
         case picoquic_frame_type_stop_sending:
-            bytes = picoquic_log_stop_sending_frame(f, bytes, bytes_max);
+            bytes = picoquic_log_stop_sending_frame(s, bytes, bytes_max);
             break;
         case picoquic_frame_type_path_challenge:
         case picoquic_frame_type_path_response:
-            bytes = picoquic_log_path_frame(f, bytes, bytes_max);
+            bytes = picoquic_log_path_frame(s, bytes, bytes_max);
             break;
         case picoquic_frame_type_crypto_hs:
-            bytes = picoquic_log_crypto_hs_frame(f, bytes, bytes_max);
+            bytes = picoquic_log_crypto_hs_frame(s, bytes, bytes_max);
             break;
         case picoquic_frame_type_new_token:
-            bytes = picoquic_log_new_token_frame(f, bytes, bytes_max);
+            bytes = picoquic_log_new_token_frame(s, bytes, bytes_max);
             break;
         case picoquic_frame_type_handshake_done:
-            bytes = picoquic_log_handshake_done_frame(f, bytes, bytes_max);
+            bytes = picoquic_log_handshake_done_frame(s, bytes, bytes_max);
             break;
         case picoquic_frame_type_datagram:
         case picoquic_frame_type_datagram_l:
-            bytes = picoquic_log_datagram_frame(f, bytes, bytes_max);
+            bytes = picoquic_log_datagram_frame(s, bytes, bytes_max);
             break;
         case picoquic_frame_type_ack_frequency:
-            bytes = picoquic_log_ack_frequency_frame(f, bytes, bytes_max);
+            bytes = picoquic_log_ack_frequency_frame(s, bytes, bytes_max);
             break;
         case picoquic_frame_type_time_stamp:
-            bytes = picoquic_log_time_stamp_frame(f, bytes, bytes_max);
+            bytes = picoquic_log_time_stamp_frame(s, bytes, bytes_max);
             break;
         case picoquic_frame_type_path_abandon:
-            bytes = picoquic_log_path_abandon_frame(f, bytes, bytes_max);
+            bytes = picoquic_log_path_abandon_frame(s, bytes, bytes_max);
             break;
         case picoquic_frame_type_bdp:
-            bytes = picoquic_log_bdp_frame(f, bytes, bytes_max);
+            bytes = picoquic_log_bdp_frame(s, bytes, bytes_max);
             break;
         default:
-            bytes = picoquic_log_erroring_frame(f, bytes, bytes_max);
+            bytes = picoquic_log_erroring_frame(s, bytes, bytes_max);
             break;
         }
     }
 }
 
+void picoquic_binlog_frames(FILE* f, const uint8_t* bytes, size_t length)
+{
+    uint8_t chunk[BINLOG_PACKET_CHUNK_MAX];
+    bytestream stream_msg;
+    bytestream* msg = bytestream_ref_init(&stream_msg, chunk, sizeof(chunk));
+
+    binlog_compose_frames(msg, bytes, length);
+    (void)fwrite(bytestream_data(msg), bytestream_length(msg), 1, f);
+}
+
 static void binlog_compose_event_header(bytestream* msg, const picoquic_connection_id_t* cid, uint64_t current_time,
     uint64_t path_id, picoquic_log_event_type event_type)
 {
@@ -599,12 +614,180 @@ static uint64_t binlog_get_path_id(picoquic_cnx_t* cnx, picoquic_path_t* path_x)
     return path_id;
 }
 
-void binlog_pdu(FILE* f, const picoquic_connection_id_t* cid, int receiving, uint64_t current_time,
-    const struct sockaddr* addr_peer, const struct sockaddr* addr_local, size_t packet_length)
+/* Chunks are composed in memory, starting with a reserved 32 bit length field,
+ * so they can be written with a single call. If the asynchronous writer is
+ * enabled, the chunk is queued and written by the writer thread.
+ */
+static void binlog_write_chunk_to_file(FILE* f, bytestream* msg)
 {
-    bytestream_buf stream_msg;
-    bytestream* msg = bytestream_buf_init(&stream_msg, BYTESTREAM_MAX_BUFFER_SIZE);
+    picoformat_32(msg->data, (uint32_t)(msg->ptr - 4));
+    (void)fwrite(bytestream_data(msg), bytestream_length(msg), 1, f);
+}
 
+static void binlog_write_bytes(picoquic_cnx_t* cnx, const uint8_t* bytes, size_t length)
+{
+    if (cnx->quic->binlog_writer != NULL) {
+        (void)picoquic_binlog_writer_push(cnx->quic->binlog_writer, cnx->f_binlog, bytes, length);
+    }
+    else {
+        (void)fwrite(bytes, length, 1, cnx->f_binlog);
+    }
+}
+
+/* Flight recorder. Connections that are not selected by the sampling policy
+ * keep their most recent chunks in a circular buffer, and only write them
+ * to the log file if a trigger fires. The new connection chunk is kept
+ * apart, so the file can always be decoded. After a trigger, the next
+ * max_events chunks are written directly, then the connection goes back
+ * to recording until the next trigger.
+ */
+#define BINLOG_FLIGHT_RECORDER_AVG_CHUNK 256
+
+typedef struct st_picoquic_flight_recorder_t {
+    uint8_t* start_chunk;
+    size_t start_chunk_length;
+    uint8_t* ring;
+    size_t ring_size;
+    size_t ring_start;
+    size_t ring_used;
+    size_t nb_events;
+    size_t max_events;
+    size_t nb_events_after;
+    uint64_t creation_time;
+} picoquic_flight_recorder_t;
+
+static picoquic_flight_recorder_t* binlog_flight_recorder_create(size_t max_events, uint64_t creation_time,
+    const uint8_t* start_chunk, size_t start_chunk_length)
+{
+    picoquic_flight_recorder_t* rec = (picoquic_flight_recorder_t*)malloc(sizeof(picoquic_flight_recorder_t));
+
+    if (rec != NULL) {
+        memset(rec, 0, sizeof(picoquic_flight_recorder_t));
+        rec->max_events = max_events;
+        rec->creation_time = creation_time;
+        rec->ring_size = max_events * BINLOG_FLIGHT_RECORDER_AVG_CHUNK;
+        if (rec->ring_size < BINLOG_PACKET_CHUNK_MAX) {
+            rec->ring_size = BINLOG_PACKET_CHUNK_MAX;
+        }
+        rec->ring = (uint8_t*)malloc(rec->ring_size);
+        rec->start_chunk = (uint8_t*)malloc(start_chunk_length);
+        if (rec->ring == NULL || rec->start_chunk == NULL) {
+            free(rec->ring);
+            free(rec->start_chunk);
+            free(rec);
+            rec = NULL;
+        }
+        else {
+            memcpy(rec->start_chunk, start_chunk, start_chunk_length);
+            rec->start_chunk_length = start_chunk_length;
+        }
+    }
+
+    return rec;
+}
+
+static void binlog_flight_recorder_delete(picoquic_cnx_t* cnx)
+{
+    if (cnx->flight_recorder != NULL) {
+        free(cnx->flight_recorder->ring);
+        free(cnx->flight_recorder->start_chunk);
+        free(cnx->flight_recorder);
+        cnx->flight_recorder = NULL;
+    }
+}
+
+static void binlog_flight_recorder_copy_out(picoquic_flight_recorder_t* rec, size_t offset, uint8_t* bytes, size_t length)
+{
+    size_t first = rec->ring_size - offset;
+
+    if (first >= length) {
+        memcpy(bytes, rec->ring + offset, length);
+    }
+    else {
+        memcpy(bytes, rec->ring + offset, first);
+        memcpy(bytes + first, rec->ring, length - first);
+    }
+}
+
+/* Return the length of the oldest chunk, including the 32 bit length field */
+static size_t binlog_flight_recorder_oldest_length(picoquic_flight_recorder_t* rec)
+{
+    uint8_t length_bytes[4];
+
+    binlog_flight_recorder_copy_out(rec, rec->ring_start, length_bytes, 4);
+
+    return 4 + (size_t)PICOPARSE_32(length_bytes);
+}
+
+static void binlog_flight_recorder_evict(picoquic_flight_recorder_t* rec)
+{
+    size_t length = binlog_flight_recorder_oldest_length(rec);
+
+    rec->ring_start = (rec->ring_start + length) % rec->ring_size;
+    rec->ring_used -= length;
+    rec->nb_events--;
+}
+
+static void binlog_flight_recorder_add(picoquic_flight_recorder_t* rec, const uint8_t* bytes, size_t length)
+{
+    if (length <= rec->ring_size && rec->max_events > 0) {
+        size_t offset;
+        size_t first;
+
+        while (rec->nb_events >= rec->max_events || rec->ring_size - rec->ring_used < length) {
+            binlog_flight_recorder_evict(rec);
+        }
+        offset = (rec->ring_start + rec->ring_used) % rec->ring_size;
+        first = rec->ring_size - offset;
+        if (first >= length) {
+            memcpy(rec->ring + offset, bytes, length);
+        }
+        else {
+            memcpy(rec->ring + offset, bytes, first);
+            memcpy(rec->ring, bytes + first, length - first);
+        }
+        rec->ring_used += length;
+        rec->nb_events++;
+    }
+}
+
+/* Write the recorded chunks to the log file, oldest first */
+static void binlog_flight_recorder_flush(picoquic_cnx_t* cnx)
+{
+    picoquic_flight_recorder_t* rec = cnx->flight_recorder;
+    uint8_t chunk[BINLOG_PACKET_CHUNK_MAX];
+
+    while (rec->nb_events > 0) {
+        size_t length = binlog_flight_recorder_oldest_length(rec);
+
+        binlog_flight_recorder_copy_out(rec, rec->ring_start, chunk, length);
+        binlog_write_bytes(cnx, chunk, length);
+        binlog_flight_recorder_evict(rec);
+    }
+    rec->ring_start = 0;
+}
+
+static void binlog_write_chunk(picoquic_cnx_t* cnx, bytestream* msg)
+{
+    picoformat_32(msg->data, (uint32_t)(msg->ptr - 4));
+
+    if (cnx->flight_recorder != NULL) {
+        if (cnx->flight_recorder->nb_events_after == 0) {
+            binlog_flight_recorder_add(cnx->flight_recorder, bytestream_data(msg), bytestream_length(msg));
+            return;
+        }
+        cnx->flight_recorder->nb_events_after--;
+        if (cnx->f_binlog == NULL) {
+            return;
+        }
+    }
+    binlog_write_bytes(cnx, bytestream_data(msg), bytestream_length(msg));
+}
+
+static void binlog_compose_pdu(bytestream* msg, const picoquic_connection_id_t* cid, int receiving, uint64_t current_time,
+    const struct sockaddr* addr_peer, const struct sockaddr* addr_local, size_t packet_length)
+{
+    bytewrite_int32(msg, 0);
     /* Common chunk header */
     binlog_compose_event_header(msg, cid, current_time, 0, picoquic_log_event_pdu_sent + receiving);
 
@@ -612,33 +795,34 @@ void binlog_pdu(FILE* f, const picoquic_connection_id_t* cid, int receiving, uin
     bytewrite_addr(msg, addr_peer);
     bytewrite_vint(msg, packet_length);
     bytewrite_addr(msg, addr_local);
+}
 
-    uint8_t head[4] = { 0 };
-    picoformat_32(head, (uint32_t)bytestream_length(msg));
+void binlog_pdu(FILE* f, const picoquic_connection_id_t* cid, int receiving, uint64_t current_time,
+    const struct sockaddr* addr_peer, const struct sockaddr* addr_local, size_t packet_length)
+{
+    bytestream_buf stream_msg;
+    bytestream* msg = bytestream_buf_init(&stream_msg, BYTESTREAM_MAX_BUFFER_SIZE);
 
-    (void)fwrite(head, sizeof(head), 1, f);
-    (void)fwrite(bytestream_data(msg), bytestream_length(msg), 1, f);
+    binlog_compose_pdu(msg, cid, receiving, current_time, addr_peer, addr_local, packet_length);
+    binlog_write_chunk_to_file(f, msg);
 }
 
 static void binlog_pdu_ex(picoquic_cnx_t* cnx, int receiving, uint64_t current_time,
     const struct sockaddr* addr_peer, const struct sockaddr* addr_local, size_t packet_length)
 {
-    if (cnx != NULL && cnx->f_binlog != NULL && picoquic_cnx_is_still_logging(cnx)) {
-        binlog_pdu(cnx->f_binlog, &cnx->initial_cnxid, receiving, current_time, addr_peer, addr_local, packet_length);
+    if (cnx != NULL && PICOQUIC_CNX_HAS_BINLOG(cnx) && picoquic_cnx_is_still_logging(cnx)) {
+        bytestream_buf stream_msg;
+        bytestream* msg = bytestream_buf_init(&stream_msg, BYTESTREAM_MAX_BUFFER_SIZE);
+
+        binlog_compose_pdu(msg, &cnx->initial_cnxid, receiving, current_time, addr_peer, addr_local, packet_length);
+        binlog_write_chunk(cnx, msg);
     }
 }
 
-void binlog_packet(FILE* f, const picoquic_connection_id_t* cid, uint64_t path_id, int receiving, uint64_t current_time,
-    const picoquic_packet_header* ph, const uint8_t* bytes, size_t bytes_max)
+static void binlog_compose_packet(bytestream* msg, const picoquic_connection_id_t* cid, uint64_t path_id, int receiving,
+    uint64_t current_time, const picoquic_packet_header* ph, const uint8_t* bytes, size_t bytes_max)
 {
-    long fpos0 = ftell(f);
-
-    uint8_t head[4] = { 0 };
-    (void)fwrite(head, 4, 1, f);
-
-    bytestream_buf stream_msg;
-    bytestream* msg = bytestream_buf_init(&stream_msg, BYTESTREAM_MAX_BUFFER_SIZE);
-
+    bytewrite_int32(msg, 0);
     /* Common chunk header */
     binlog_compose_event_header(msg, cid, current_time, path_id, picoquic_log_event_packet_sent + receiving);
 
@@ -664,32 +848,37 @@ void binlog_packet(FILE* f, const picoquic_connection_id_t* cid, uint64_t path_i
         bytewrite_buffer(msg, ph->token_bytes, ph->token_length);
     }
 
-    (void)fwrite(bytestream_data(msg), bytestream_length(msg), 1, f);
-
     /* frame information */
     if (ph->ptype == picoquic_packet_version_negotiation || ph->ptype == picoquic_packet_retry) {
-        picoquic_binlog_frame(f, bytes + ph->offset, bytes + bytes_max);
+        picoquic_binlog_frame(msg, bytes + ph->offset, bytes + bytes_max);
     }
     else if (ph->ptype != picoquic_packet_error) {
-        picoquic_binlog_frames(f, bytes + ph->offset, ph->payload_length);
+        binlog_compose_frames(msg, bytes + ph->offset, ph->payload_length);
     }
+}
 
-    /* re-write chunk size field */
-    long fpos1 = ftell(f);
-
-    picoformat_32(head, (uint32_t)(fpos1 - fpos0 - 4));
+void binlog_packet(FILE* f, const picoquic_connection_id_t* cid, uint64_t path_id, int receiving, uint64_t current_time,
+    const picoquic_packet_header* ph, const uint8_t* bytes, size_t bytes_max)
+{
+    uint8_t chunk[BINLOG_PACKET_CHUNK_MAX];
+    bytestream stream_msg;
+    bytestream* msg = bytestream_ref_init(&stream_msg, chunk, sizeof(chunk));
 
-    (void)fseek(f, fpos0, SEEK_SET);
-    (void)fwrite(head, 4, 1, f);
-    (void)fseek(f, 0, SEEK_END);
+    binlog_compose_packet(msg, cid, path_id, receiving, current_time, ph, bytes, bytes_max);
+    binlog_write_chunk_to_file(f, msg);
 }
 
 static void binlog_packet_ex(picoquic_cnx_t* cnx, picoquic_path_t * path_x, int receiving, uint64_t current_time,
     picoquic_packet_header* ph, const uint8_t* bytes, size_t bytes_max)
 {
-    if (cnx != NULL && cnx->f_binlog != NULL && picoquic_cnx_is_still_logging(cnx)) {
-        binlog_packet(cnx->f_binlog, &cnx->initial_cnxid, binlog_get_path_id(cnx, path_x),
+    if (cnx != NULL && PICOQUIC_CNX_HAS_BINLOG(cnx) && picoquic_cnx_is_still_logging(cnx)) {
+        uint8_t chunk[BINLOG_PACKET_CHUNK_MAX];
+        bytestream stream_msg;
+        bytestream* msg = bytestream_ref_init(&stream_msg, chunk, sizeof(chunk));
+
+        binlog_compose_packet(msg, &cnx->initial_cnxid, binlog_get_path_id(cnx, path_x),
             receiving, current_time, ph, bytes, bytes_max);
+        binlog_write_chunk(cnx, msg);
     }
 }
 
@@ -697,7 +886,6 @@ void binlog_dropped_packet(picoquic_cnx_t* cnx, picoquic_path_t* path_x,
     picoquic_packet_header* ph,  size_t packet_size, int err,
     uint8_t * raw_data, uint64_t current_time)
 {
-    FILE* f = cnx->f_binlog;
     size_t raw_size = packet_size;
     bytestream_buf stream_msg;
     bytestream* msg = bytestream_buf_init(&stream_msg, BYTESTREAM_MAX_BUFFER_SIZE);
@@ -720,15 +908,12 @@ void binlog_dropped_packet(picoquic_cnx_t* cnx, picoquic_path_t* path_x,
     bytewrite_vint(msg, raw_size);
     (void)bytewrite_buffer(msg, raw_data, raw_size);
 
-    /* write the frame length at the reserved spot, and save to log file*/
-    picoformat_32(msg->data, (uint32_t)(msg->ptr - 4));
-    (void)fwrite(bytestream_data(msg), bytestream_length(msg), 1, f);
+    binlog_write_chunk(cnx, msg);
 }
 
 void binlog_buffered_packet(picoquic_cnx_t* cnx, picoquic_path_t* path_x, 
     picoquic_packet_type_enum ptype, uint64_t current_time)
 {
-    FILE* f = cnx->f_binlog;
     bytestream_buf stream_msg;
     bytestream* msg = bytestream_buf_init(&stream_msg, BYTESTREAM_MAX_BUFFER_SIZE);
 
@@ -740,9 +925,7 @@ void binlog_buffered_packet(picoquic_cnx_t* cnx, picoquic_path_t* path_x,
     bytewrite_vint(msg, ptype);
     (void)bytewrite_cstr(msg, "keys_unavailable");
 
-    /* write the frame length at the reserved spot, and save to log file*/
-    picoformat_32(msg->data, (uint32_t)(msg->ptr - 4));
-    (void)fwrite(bytestream_data(msg), bytestream_length(msg), 1, f);
+    binlog_write_chunk(cnx, msg);
 }
 
 
@@ -750,8 +933,6 @@ void binlog_outgoing_packet(picoquic_cnx_t* cnx, picoquic_path_t * path_x,
     uint8_t * bytes, uint64_t sequence_number, size_t pn_length, size_t length,
     uint8_t* send_buffer, size_t send_length, uint64_t current_time)
 {
-    FILE* f = cnx->f_binlog;
-
     picoquic_cnx_t* pcnx = cnx;
     picoquic_packet_header ph;
     size_t checksum_length = 16;
@@ -792,7 +973,12 @@ void binlog_outgoing_packet(picoquic_cnx_t* cnx, picoquic_path_t * path_x,
         }
     }
 
-    binlog_packet(f, cnxid, binlog_get_path_id(cnx, path_x),  0, current_time, &ph, bytes, length);
+    uint8_t chunk[BINLOG_PACKET_CHUNK_MAX];
+    bytestream stream_msg;
+    bytestream* msg = bytestream_ref_init(&stream_msg, chunk, sizeof(chunk));
+
+    binlog_compose_packet(msg, cnxid, binlog_get_path_id(cnx, path_x), 0, current_time, &ph, bytes, length);
+    binlog_write_chunk(cnx, msg);
 }
 
 void binlog_packet_lost(picoquic_cnx_t* cnx, picoquic_path_t* path_x,
@@ -800,8 +986,6 @@ void binlog_packet_lost(picoquic_cnx_t* cnx, picoquic_path_t* path_x,
     picoquic_connection_id_t * dcid, size_t packet_size,
     uint64_t current_time)
 {
-    FILE* f = cnx->f_binlog;
-
     bytestream_buf stream_msg;
     bytestream* msg = bytestream_buf_init(&stream_msg, BYTESTREAM_MAX_BUFFER_SIZE);
 
@@ -820,9 +1004,7 @@ void binlog_packet_lost(picoquic_cnx_t* cnx, picoquic_path_t* path_x,
     }
     bytewrite_vint(msg, packet_size);
 
-    /* write the frame length at the reserved spot, and save to log file*/
-    picoformat_32(msg->data, (uint32_t)(msg->ptr - 4));
-    (void)fwrite(bytestream_data(msg), bytestream_length(msg), 1, f);
+    binlog_write_chunk(cnx, msg);
 }
 
 
@@ -830,10 +1012,10 @@ void binlog_negotiated_alpn(picoquic_cnx_t* cnx, int is_local,
     uint8_t const * sni, size_t sni_len, uint8_t const* alpn, size_t alpn_len,
     const ptls_iovec_t* alpn_list, size_t alpn_count)
 {
-    FILE* f = cnx->f_binlog;
-
     bytestream_buf stream_msg;
     bytestream* msg = bytestream_buf_init(&stream_msg, BYTESTREAM_MAX_BUFFER_SIZE);
+
+    bytewrite_int32(msg, 0);
     /* Common chunk header */
     binlog_compose_event_header(msg, &cnx->initial_cnxid, picoquic_get_quic_time(cnx->quic), 0, picoquic_log_event_alpn_update);
     /* Event header */
@@ -856,21 +1038,16 @@ void binlog_negotiated_alpn(picoquic_cnx_t* cnx, int is_local,
         bytewrite_buffer(msg, alpn, alpn_len);
     }
 
-    bytestream_buf stream_head;
-    bytestream* head = bytestream_buf_init(&stream_head, 4);
-    bytewrite_int32(head, (uint32_t)bytestream_length(msg));
-
-    (void)fwrite(bytestream_data(head), bytestream_length(head), 1, f);
-    (void)fwrite(bytestream_data(msg), bytestream_length(msg), 1, f);
+    binlog_write_chunk(cnx, msg);
 }
 
 void binlog_transport_extension(picoquic_cnx_t* cnx, int is_local,
     size_t param_length, uint8_t* params)
 {
-    FILE* f = cnx->f_binlog;
-
     bytestream_buf stream_msg;
     bytestream* msg = bytestream_buf_init(&stream_msg, BYTESTREAM_MAX_BUFFER_SIZE);
+
+    bytewrite_int32(msg, 0);
     /* Common chunk header */
     binlog_compose_event_header(msg, &cnx->initial_cnxid, picoquic_get_quic_time(cnx->quic), 0, picoquic_log_event_param_update);
     /* Event header */
@@ -881,59 +1058,70 @@ void binlog_transport_extension(picoquic_cnx_t* cnx, int is_local,
         bytewrite_buffer(msg, params, param_length);
     }
 
-    bytestream_buf stream_head;
-    bytestream* head = bytestream_buf_init(&stream_head, 4);
-    bytewrite_int32(head, (uint32_t)bytestream_length(msg));
-
-    (void)fwrite(bytestream_data(head), bytestream_length(head), 1, f);
-    (void)fwrite(bytestream_data(msg), bytestream_length(msg), 1, f);
+    binlog_write_chunk(cnx, msg);
 }
 
-void binlog_picotls_ticket(FILE* f, picoquic_connection_id_t cnx_id,
+static void binlog_compose_picotls_ticket(bytestream* msg, picoquic_connection_id_t cnx_id,
     uint8_t* ticket, uint16_t ticket_length)
 {
-    bytestream_buf stream_msg;
-    bytestream * msg = bytestream_buf_init(&stream_msg, BYTESTREAM_MAX_BUFFER_SIZE);
+    bytewrite_int32(msg, 0);
     /* Common chunk header */
     binlog_compose_event_header(msg, &cnx_id, 0, 0, picoquic_log_event_tls_key_update);
 
     bytewrite_vint(msg, ticket_length);
     bytewrite_buffer(msg, ticket, ticket_length);
+}
 
-    bytestream_buf stream_head;
-    bytestream * head = bytestream_buf_init(&stream_head, 8);
-    bytewrite_int32(head, (uint32_t)bytestream_length(msg));
+void binlog_picotls_ticket(FILE* f, picoquic_connection_id_t cnx_id,
+    uint8_t* ticket, uint16_t ticket_length)
+{
+    bytestream_buf stream_msg;
+    bytestream * msg = bytestream_buf_init(&stream_msg, BYTESTREAM_MAX_BUFFER_SIZE);
 
-    (void)fwrite(bytestream_data(head), bytestream_length(head), 1, f);
-    (void)fwrite(bytestream_data(msg), bytestream_length(msg), 1, f);
+    binlog_compose_picotls_ticket(msg, cnx_id, ticket, ticket_length);
+    binlog_write_chunk_to_file(f, msg);
 }
 
 static void binlog_picotls_ticket_ex(picoquic_cnx_t* cnx,
     uint8_t* ticket, uint16_t ticket_length)
 {
-    if (cnx != NULL && cnx->f_binlog != NULL && picoquic_cnx_is_still_logging(cnx)) {
-        binlog_picotls_ticket(cnx->f_binlog, cnx->initial_cnxid, ticket, ticket_length);
+    if (cnx != NULL && PICOQUIC_CNX_HAS_BINLOG(cnx) && picoquic_cnx_is_still_logging(cnx)) {
+        bytestream_buf stream_msg;
+        bytestream* msg = bytestream_buf_init(&stream_msg, BYTESTREAM_MAX_BUFFER_SIZE);
+
+        binlog_compose_picotls_ticket(msg, cnx->initial_cnxid, ticket, ticket_length);
+        binlog_write_chunk(cnx, msg);
     }
 }
 
-FILE* create_binlog(char const* binlog_file, uint64_t creation_time, unsigned int multipath_enabled);
+static FILE* create_binlog(char const* binlog_file, uint64_t creation_time, unsigned int is_multipath_supported, int is_async);
 
-void binlog_new_connection(picoquic_cnx_t * cnx)
+/* With the asynchronous writer, the file is closed by the writer thread once
+ * the queued chunks are written. */
+static void binlog_close_file(picoquic_cnx_t* cnx, int wait_until_closed)
 {
-    char const* bin_dir = (cnx->quic->binlog_dir == NULL) ? cnx->quic->qlog_dir : cnx->quic->binlog_dir;
-
-    if (bin_dir == NULL) {
-        return;
+    if (cnx->f_binlog != NULL) {
+        if (cnx->quic->binlog_writer != NULL) {
+            picoquic_binlog_writer_close_file(cnx->quic->binlog_writer, cnx->f_binlog, wait_until_closed);
+            cnx->f_binlog = NULL;
+        }
+        else {
+            fflush(cnx->f_binlog);
+            cnx->f_binlog = picoquic_file_close(cnx->f_binlog);
+        }
     }
+}
+
+/* Open the log file of the connection, within the limit of simultaneously open logs */
+static int binlog_open_file(picoquic_cnx_t* cnx, uint64_t creation_time)
+{
+    char const* bin_dir = (cnx->quic->binlog_dir == NULL) ? cnx->quic->qlog_dir : cnx->quic->binlog_dir;
+    int ret = 0;
 
     if (cnx->quic->current_number_of_open_logs >= cnx->quic->max_simultaneous_logs) {
-        return;
+        return -1;
     }
 
-    int ret = 0;
-
-    cnx->f_binlog = picoquic_file_close(cnx->f_binlog);
-    
     char cid_name[2 * PICOQUIC_CONNECTION_ID_MAX_SIZE + 1];
     if (picoquic_print_connection_id_hexa(cid_name, sizeof(cid_name), &cnx->initial_cnxid) != 0) {
         ret = -1;
@@ -962,8 +1150,8 @@ void binlog_new_connection(picoquic_cnx_t * cnx)
     }
 
     if (ret == 0) {
-        cnx->f_binlog = create_binlog(log_filename, picoquic_get_quic_time(cnx->quic),
-            cnx->local_parameters.enable_multipath);
+        cnx->f_binlog = create_binlog(log_filename, creation_time,
+            cnx->local_parameters.enable_multipath, cnx->quic->binlog_writer != NULL);
         if (cnx->f_binlog == NULL) {
             cnx->binlog_file_name = picoquic_string_free(cnx->binlog_file_name);
             ret = -1;
@@ -973,51 +1161,105 @@ void binlog_new_connection(picoquic_cnx_t * cnx)
         }
     }
 
-    if (ret == 0) {
-        bytestream_buf stream_msg;
-        bytestream * msg = bytestream_buf_init(&stream_msg, BYTESTREAM_MAX_BUFFER_SIZE);
-        /* Common chunk header */
-        binlog_compose_event_header(msg, &cnx->initial_cnxid, cnx->start_time, 0, picoquic_log_event_new_connection);
+    return ret;
+}
 
-        bytewrite_int8(msg, cnx->client_mode != 0);
-        bytewrite_int32(msg, cnx->proposed_version);
-        bytewrite_cid(msg, &cnx->path[0]->p_remote_cnxid->cnx_id);
+static void binlog_compose_new_connection(bytestream* msg, picoquic_cnx_t* cnx)
+{
+    bytewrite_int32(msg, 0);
+    /* Common chunk header */
+    binlog_compose_event_header(msg, &cnx->initial_cnxid, cnx->start_time, 0, picoquic_log_event_new_connection);
+
+    bytewrite_int8(msg, cnx->client_mode != 0);
+    bytewrite_int32(msg, cnx->proposed_version);
+    bytewrite_cid(msg, &cnx->path[0]->p_remote_cnxid->cnx_id);
+
+    /* Algorithms used */
+    bytewrite_cstr(msg, cnx->congestion_alg->congestion_algorithm_id);
+    bytewrite_vint(msg, cnx->spin_policy);
+    picoformat_32(msg->data, (uint32_t)(msg->ptr - 4));
+}
+
+void binlog_new_connection(picoquic_cnx_t * cnx)
+{
+    char const* bin_dir = (cnx->quic->binlog_dir == NULL) ? cnx->quic->qlog_dir : cnx->quic->binlog_dir;
+
+    if (bin_dir == NULL) {
+        return;
+    }
+
+    binlog_close_file(cnx, 0);
+    binlog_flight_recorder_delete(cnx);
+
+    bytestream_buf stream_msg;
+    bytestream * msg = bytestream_buf_init(&stream_msg, BYTESTREAM_MAX_BUFFER_SIZE);
+
+    binlog_compose_new_connection(msg, cnx);
+
+    if (picoquic_log_is_sampled(cnx)) {
+        if (binlog_open_file(cnx, picoquic_get_quic_time(cnx->quic)) == 0) {
+            binlog_write_bytes(cnx, bytestream_data(msg), bytestream_length(msg));
+        }
+    }
+    else if (cnx->quic->flight_recorder_events > 0) {
+        cnx->flight_recorder = binlog_flight_recorder_create(cnx->quic->flight_recorder_events,
+            picoquic_get_quic_time(cnx->quic), bytestream_data(msg), bytestream_length(msg));
+    }
+}
+
+void picoquic_binlog_message_v(picoquic_cnx_t* cnx, const char* fmt, va_list vargs);
 
-        /* Algorithms used */
-        bytewrite_cstr(msg, cnx->congestion_alg->congestion_algorithm_id);
-        bytewrite_vint(msg, cnx->spin_policy);
+static void binlog_trigger_message(picoquic_cnx_t* cnx, const char* fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    picoquic_binlog_message_v(cnx, fmt, args);
+    va_end(args);
+}
 
-        bytestream_buf stream_head;
-        bytestream * head = bytestream_buf_init(&stream_head, 8);
-        bytewrite_int32(head, (uint32_t)bytestream_length(msg));
+/* On trigger, the log file is created if this was not done yet, and the
+ * content of the flight recorder is written to it */
+void binlog_log_trigger(picoquic_cnx_t* cnx, char const* trigger_name, uint64_t current_time)
+{
+    picoquic_flight_recorder_t* rec = cnx->flight_recorder;
 
-        (void)fwrite(bytestream_data(head), bytestream_length(head), 1, cnx->f_binlog);
-        (void)fwrite(bytestream_data(msg), bytestream_length(msg), 1, cnx->f_binlog);
+    if (rec != NULL) {
+        if (cnx->f_binlog == NULL) {
+            if (binlog_open_file(cnx, rec->creation_time) != 0) {
+                return;
+            }
+            binlog_write_bytes(cnx, rec->start_chunk, rec->start_chunk_length);
+        }
+        binlog_flight_recorder_flush(cnx);
+        rec->nb_events_after = rec->max_events;
+    }
+
+    if (cnx->f_binlog != NULL) {
+        binlog_trigger_message(cnx, "Log trigger: %s at T=%fs", trigger_name,
+            (double)(current_time - cnx->start_time) / 1000000.0);
     }
 }
 
 void binlog_close_connection(picoquic_cnx_t * cnx)
 {
-    FILE * f = cnx->f_binlog;
-    if (f == NULL) {
+    /* Events recorded since the last trigger, if any, are not logged */
+    binlog_flight_recorder_delete(cnx);
+
+    if (cnx->f_binlog == NULL) {
         return;
     }
 
     bytestream_buf stream_msg;
     bytestream * msg = bytestream_buf_init(&stream_msg, BYTESTREAM_MAX_BUFFER_SIZE);
+
+    bytewrite_int32(msg, 0);
     /* Common chunk header */
     binlog_compose_event_header(msg, &cnx->initial_cnxid, picoquic_get_quic_time(cnx->quic), 0, picoquic_log_event_connection_close);
 
-    bytestream_buf stream_head;
-    bytestream * head = bytestream_buf_init(&stream_head, 8);
-    bytewrite_int32(head, (uint32_t)bytestream_length(msg));
+    binlog_write_chunk(cnx, msg);
 
-    (void)fwrite(bytestream_data(head), bytestream_length(head), 1, f);
-    (void)fwrite(bytestream_data(msg), bytestream_length(msg), 1, f);
-
-    fflush(f);
-
-    cnx->f_binlog = picoquic_file_close(cnx->f_binlog);
+    /* The qlog conversion reads the complete file */
+    binlog_close_file(cnx, cnx->quic->qlog_dir != NULL && cnx->quic->autoqlog_fn != NULL);
 
     if (cnx->quic->qlog_dir != NULL && cnx->quic->autoqlog_fn != NULL) {
         (void)cnx->quic->autoqlog_fn(cnx);
@@ -1028,13 +1270,16 @@ void binlog_close_connection(picoquic_cnx_t * cnx)
     }
 }
 
-FILE* create_binlog(char const* binlog_file, uint64_t creation_time, unsigned int is_multipath_supported)
+static FILE* create_binlog(char const* binlog_file, uint64_t creation_time, unsigned int is_multipath_supported, int is_async)
 {
     FILE* f_binlog = picoquic_file_open(binlog_file, "wb");
     if (f_binlog == NULL) {
         DBG_PRINTF("Cannot open file %s for write.\n", binlog_file);
     }
     else {
+        if (is_async) {
+            picoquic_binlog_writer_set_file_buffer(f_binlog);
+        }
         /* Write a header text with version identifier and current date  */
         bytestream_buf stream;
         bytestream* ps = bytestream_buf_init(&stream, 16);
@@ -1060,7 +1305,7 @@ FILE* create_binlog(char const* binlog_file, uint64_t creation_time, unsigned in
 
 void binlog_cc_dump(picoquic_cnx_t* cnx, uint64_t current_time)
 {
-    if (cnx->f_binlog == NULL) {
+    if (!PICOQUIC_CNX_HAS_BINLOG(cnx)) {
         return;
     }
 
@@ -1068,6 +1313,8 @@ void binlog_cc_dump(picoquic_cnx_t* cnx, uint64_t current_time)
     bytestream* ps_msg = bytestream_buf_init(&stream_msg, BYTESTREAM_MAX_BUFFER_SIZE);
     int path_max = (cnx->is_multipath_enabled || cnx->is_simple_multipath_enabled) ? cnx->nb_paths : 1;
 
+    bytewrite_int32(ps_msg, 0);
+
     for (int path_id = 0; path_id < path_max; path_id++)
     {
         picoquic_path_t* path = cnx->path[path_id];
@@ -1140,13 +1387,7 @@ void binlog_cc_dump(picoquic_cnx_t* cnx, uint64_t current_time)
         bytewrite_vint(ps_msg, path->max_bandwidth_estimate);
         bytewrite_vint(ps_msg, path->bytes_in_transit);
 
-        bytestream_buf stream_head;
-        bytestream* ps_head = bytestream_buf_init(&stream_head, BYTESTREAM_MAX_BUFFER_SIZE);
-
-        bytewrite_int32(ps_head, (uint32_t)bytestream_length(ps_msg));
-
-        (void)fwrite(bytestream_data(ps_head), bytestream_length(ps_head), 1, cnx->f_binlog);
-        (void)fwrite(bytestream_data(ps_msg), bytestream_length(ps_msg), 1, cnx->f_binlog);
+        binlog_write_chunk(cnx, ps_msg);
     }
 }
 
@@ -1156,7 +1397,7 @@ void binlog_cc_dump(picoquic_cnx_t* cnx, uint64_t current_time)
 
 void picoquic_binlog_message_v(picoquic_cnx_t* cnx, const char* fmt, va_list vargs)
 {
-    if (cnx->f_binlog == NULL) {
+    if (!PICOQUIC_CNX_HAS_BINLOG(cnx)) {
         return;
     }
     bytestream_buf stream_msg;
@@ -1164,6 +1405,8 @@ void picoquic_binlog_message_v(picoquic_cnx_t* cnx, const char* fmt, va_list var
     size_t message_len;
     char* message_text;
     int written = -1;
+
+    bytewrite_int32(ps_msg, 0);
     /* Common chunk header */
     binlog_compose_event_header(ps_msg, &cnx->initial_cnxid, picoquic_get_quic_time(cnx->quic), 0, picoquic_log_event_info_message);
 
@@ -1182,13 +1425,7 @@ void picoquic_binlog_message_v(picoquic_cnx_t* cnx, const char* fmt, va_list var
 #endif
     ps_msg->ptr += message_len;
 
-    bytestream_buf stream_head;
-    bytestream* ps_head = bytestream_buf_init(&stream_head, BYTESTREAM_MAX_BUFFER_SIZE);
-
-    bytewrite_int32(ps_head, (uint32_t)bytestream_length(ps_msg));
-
-    (void)fwrite(bytestream_data(ps_head), bytestream_length(ps_head), 1, cnx->f_binlog);
-    (void)fwrite(bytestream_data(ps_msg), bytestream_length(ps_msg), 1, cnx->f_binlog);
+    binlog_write_chunk(cnx, ps_msg);
 }
 
 /* Log an event that cannot be attached to a specific connection */
@@ -1218,7 +1455,7 @@ void binlog_ignore_quic_pdu(picoquic_quic_t* quic, int receiving, uint64_t curre
 /* Log an event relating to a specific connection */
 static void binlog_app_message(picoquic_cnx_t* cnx, const char* fmt, va_list vargs)
 {
-    if (cnx->f_binlog != NULL) {
+    if (PICOQUIC_CNX_HAS_BINLOG(cnx)) {
         picoquic_binlog_message_v(cnx, fmt, vargs);
     }
 }
@@ -1240,7 +1477,8 @@ struct st_picoquic_unified_logging_t binlog_functions = {
     binlog_picotls_ticket_ex,
     binlog_new_connection,
     binlog_close_connection,
-    binlog_cc_dump
+    binlog_cc_dump,
+    binlog_log_trigger
 };
 
 int picoquic_set_binlog(picoquic_quic_t* quic, char const* binlog_dir)
@@ -0,0 +1,357 @@
+/*
+* Live metrics of a QUIC context, published in a memory segment.
+*
+* The segment is either a named shared memory object, that external tools
+* can map read only, or a private memory allocation. The data path updates
+* the segment through the macros defined in picoquic_metrics.h, which do
+* nothing if metrics are not enabled. The gauges are refreshed once per
+* call to picoquic_prepare_next_packet.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WINDOWS
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "picoquic_internal.h"
+#include "picoquic_utils.h"
+#include "picoquic_metrics.h"
+
+static char const* picoquic_metrics_counter_names[picoquic_metric_counter_max] = {
+    "packets_in",
+    "packets_out",
+    "bytes_in",
+    "bytes_out",
+    "drop_decrypt",
+    "drop_version",
+    "drop_malformed",
+    "drop_duplicate",
+    "drop_unexpected",
+    "drop_blocked",
+    "drop_other",
+    "handshakes_completed",
+    "handshakes_failed",
+    "retransmits",
+    "spurious_losses",
+    "stateless_packets",
+    "pool_exhausted"
+};
+
+static char const* picoquic_metrics_gauge_names[picoquic_metric_gauge_max] = {
+    "connections",
+    "streams",
+    "packets_in_pool"
+};
+
+static char const* picoquic_metrics_histogram_names[picoquic_metric_histogram_max] = {
+    "rtt_usec",
+    "handshake_usec",
+    "ack_cycles",
+    "send_loop_cycles"
+};
+
+char const* picoquic_metrics_counter_name(picoquic_metric_counter_enum counter)
+{
+    return ((unsigned int)counter < picoquic_metric_counter_max) ? picoquic_metrics_counter_names[counter] : "unknown";
+}
+
+char const* picoquic_metrics_gauge_name(picoquic_metric_gauge_enum gauge)
+{
+    return ((unsigned int)gauge < picoquic_metric_gauge_max) ? picoquic_metrics_gauge_names[gauge] : "unknown";
+}
+
+char const* picoquic_metrics_histogram_name(picoquic_metric_histogram_enum histogram)
+{
+    return ((unsigned int)histogram < picoquic_metric_histogram_max) ? picoquic_metrics_histogram_names[histogram] : "unknown";
+}
+
+/* Histogram buckets */
+unsigned int picoquic_metrics_bucket_index(uint64_t value)
+{
+    unsigned int bucket_index;
+
+    if (value < PICOQUIC_METRICS_SUB_COUNT) {
+        bucket_index = (unsigned int)value;
+    }
+    else {
+        unsigned int msb = PICOQUIC_METRICS_SUB_BITS;
+
+        while (msb < 63 && (value >> (msb + 1)) != 0) {
+            msb++;
+        }
+        bucket_index = ((msb - PICOQUIC_METRICS_SUB_BITS + 1) << PICOQUIC_METRICS_SUB_BITS) +
+            (unsigned int)((value >> (msb - PICOQUIC_METRICS_SUB_BITS)) & (PICOQUIC_METRICS_SUB_COUNT - 1));
+    }
+
+    return bucket_index;
+}
+
+/* Lowest value that falls in the bucket */
+uint64_t picoquic_metrics_bucket_value(unsigned int bucket_index)
+{
+    uint64_t value;
+
+    if (bucket_index < PICOQUIC_METRICS_SUB_COUNT) {
+        value = bucket_index;
+    }
+    else {
+        unsigned int shift = (bucket_index >> PICOQUIC_METRICS_SUB_BITS) - 1;
+        uint64_t sub = bucket_index & (PICOQUIC_METRICS_SUB_COUNT - 1);
+
+        value = (PICOQUIC_METRICS_SUB_COUNT + sub) << shift;
+    }
+
+    return value;
+}
+
+void picoquic_metrics_histogram_add(picoquic_metrics_histogram_t* h, uint64_t value)
+{
+    h->buckets[picoquic_metrics_bucket_index(value)]++;
+    h->sum += value;
+    if (value > h->max) {
+        h->max = value;
+    }
+    h->count++;
+}
+
+void picoquic_metrics_record(picoquic_metrics_segment_t* segment, picoquic_metric_histogram_enum histogram, uint64_t value)
+{
+    picoquic_metrics_histogram_add(&segment->histograms[histogram], value);
+}
+
+/* Returns the highest value of the bucket in which the percentile falls,
+ * capped by the largest recorded value. */
+uint64_t picoquic_metrics_percentile(picoquic_metrics_histogram_t const* histogram, double percentile)
+{
+    uint64_t value = 0;
+    uint64_t total = 0;
+
+    for (unsigned int i = 0; i < PICOQUIC_METRICS_NB_BUCKETS; i++) {
+        total += histogram->buckets[i];
+    }
+
+    if (total > 0) {
+        uint64_t target = (uint64_t)((percentile * (double)total) / 100.0);
+        uint64_t cumulated = 0;
+
+        if (target < 1) {
+            target = 1;
+        }
+        else if (target > total) {
+            target = total;
+        }
+
+        for (unsigned int i = 0; i < PICOQUIC_METRICS_NB_BUCKETS; i++) {
+            cumulated += histogram->buckets[i];
+            if (cumulated >= target) {
+                value = (i + 1 < PICOQUIC_METRICS_NB_BUCKETS) ? picoquic_metrics_bucket_value(i + 1) - 1 : UINT64_MAX;
+                break;
+            }
+        }
+        if (value > histogram->max) {
+            value = histogram->max;
+        }
+    }
+
+    return value;
+}
+
+/* Segment management */
+static void picoquic_metrics_init_segment(picoquic_metrics_segment_t* segment, uint64_t current_time)
+{
+    memset(segment, 0, sizeof(picoquic_metrics_segment_t));
+    segment->version = PICOQUIC_METRICS_VERSION;
+    segment->segment_size = (uint32_t)sizeof(picoquic_metrics_segment_t);
+    segment->nb_counters = picoquic_metric_counter_max;
+    segment->nb_gauges = picoquic_metric_gauge_max;
+    segment->nb_histograms = picoquic_metric_histogram_max;
+    segment->nb_events = picoquic_event_max;
+#ifdef _WINDOWS
+    segment->writer_pid = (uint32_t)GetCurrentProcessId();
+#else
+    segment->writer_pid = (uint32_t)getpid();
+#endif
+    segment->start_time = current_time;
+    segment->last_update_time = current_time;
+    /* Readers check the magic number last */
+    PICOQUIC_MEMORY_FENCE();
+    segment->magic = PICOQUIC_METRICS_MAGIC;
+}
+
+static picoquic_metrics_segment_t* picoquic_metrics_map_segment(char const* segment_name, int is_writer)
+{
+    picoquic_metrics_segment_t* segment = NULL;
+#ifdef _WINDOWS
+    HANDLE h_map;
+
+    if (is_writer) {
+        h_map = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0,
+            (DWORD)sizeof(picoquic_metrics_segment_t), segment_name);
+    }
+    else {
+        h_map = OpenFileMappingA(FILE_MAP_READ, FALSE, segment_name);
+    }
+    if (h_map != NULL) {
+        /* The view keeps a reference to the mapping */
+        segment = (picoquic_metrics_segment_t*)MapViewOfFile(h_map,
+            (is_writer) ? FILE_MAP_ALL_ACCESS : FILE_MAP_READ, 0, 0, sizeof(picoquic_metrics_segment_t));
+        CloseHandle(h_map);
+    }
+#else
+    int fd = shm_open(segment_name, (is_writer) ? (O_CREAT | O_RDWR) : O_RDONLY, 0644);
+
+    if (fd >= 0) {
+        if (!is_writer || ftruncate(fd, sizeof(picoquic_metrics_segment_t)) == 0) {
+            void* addr = mmap(NULL, sizeof(picoquic_metrics_segment_t), (is_writer) ? (PROT_READ | PROT_WRITE) : PROT_READ,
+                MAP_SHARED, fd, 0);
+            if (addr != MAP_FAILED) {
+                segment = (picoquic_metrics_segment_t*)addr;
+            }
+        }
+        (void)close(fd);
+    }
+#endif
+    if (segment == NULL) {
+        DBG_PRINTF("Cannot map metrics segment %s\n", segment_name);
+    }
+
+    return segment;
+}
+
+static void picoquic_metrics_unmap_segment(picoquic_metrics_segment_t const* segment)
+{
+#ifdef _WINDOWS
+    (void)UnmapViewOfFile((LPCVOID)segment);
+#else
+    (void)munmap((void*)segment, sizeof(picoquic_metrics_segment_t));
+#endif
+}
+
+int picoquic_metrics_enable(picoquic_quic_t* quic, char const* segment_name)
+{
+    int ret = 0;
+
+    picoquic_metrics_disable(quic);
+
+    if (segment_name == NULL) {
+        quic->metrics = (picoquic_metrics_segment_t*)malloc(sizeof(picoquic_metrics_segment_t));
+    }
+    else if ((quic->metrics_segment_name = picoquic_string_duplicate(segment_name)) != NULL) {
+        quic->metrics = picoquic_metrics_map_segment(segment_name, 1);
+        if (quic->metrics == NULL) {
+            quic->metrics_segment_name = picoquic_string_free(quic->metrics_segment_name);
+        }
+    }
+
+    if (quic->metrics == NULL) {
+        ret = PICOQUIC_ERROR_MEMORY;
+    }
+    else {
+        picoquic_metrics_init_segment(quic->metrics, picoquic_get_quic_time(quic));
+        picoquic_metrics_publish(quic, picoquic_get_quic_time(quic));
+    }
+
+    return ret;
+}
+
+void picoquic_metrics_disable(picoquic_quic_t* quic)
+{
+    if (quic->metrics != NULL) {
+        if (quic->metrics_segment_name == NULL) {
+            free(quic->metrics);
+        }
+        else {
+            /* Tell the readers that the segment is no longer updated */
+            quic->metrics->magic = 0;
+            picoquic_metrics_unmap_segment(quic->metrics);
+#ifndef _WINDOWS
+            (void)shm_unlink(quic->metrics_segment_name);
+#endif
+            quic->metrics_segment_name = picoquic_string_free(quic->metrics_segment_name);
+        }
+        quic->metrics = NULL;
+    }
+}
+
+picoquic_metrics_segment_t* picoquic_metrics_get_segment(picoquic_quic_t* quic)
+{
+    return quic->metrics;
+}
+
+void picoquic_metrics_publish(picoquic_quic_t* quic, uint64_t current_time)
+{
+    picoquic_metrics_segment_t* segment = quic->metrics;
+
+    segment->gauges[picoquic_metric_connections] = (int64_t)quic->current_number_connections;
+    segment->gauges[picoquic_metric_packets_in_pool] = (int64_t)quic->nb_packets_in_pool;
+    memcpy(segment->events, quic->events.counters, sizeof(segment->events));
+    segment->last_update_time = current_time;
+}
+
+/* Reader side */
+picoquic_metrics_segment_t const* picoquic_metrics_open_segment(char const* segment_name)
+{
+    picoquic_metrics_segment_t const* segment = picoquic_metrics_map_segment(segment_name, 0);
+
+    if (segment != NULL && (segment->magic != PICOQUIC_METRICS_MAGIC ||
+        segment->version != PICOQUIC_METRICS_VERSION ||
+        segment->segment_size != sizeof(picoquic_metrics_segment_t))) {
+        DBG_PRINTF("Metrics segment %s has an unexpected format\n", segment_name);
+        picoquic_metrics_unmap_segment(segment);
+        segment = NULL;
+    }
+
+    return segment;
+}
+
+void picoquic_metrics_close_segment(picoquic_metrics_segment_t const* segment)
+{
+    if (segment != NULL) {
+        picoquic_metrics_unmap_segment(segment);
+    }
+}
+
+/* Copy the segment one 64 bit word at a time, so that each value is read
+ * as a whole even if the compiler would otherwise use byte copies. */
+void picoquic_metrics_snapshot(picoquic_metrics_segment_t const* segment, picoquic_metrics_segment_t* snapshot)
+{
+    volatile uint64_t const* src = (volatile uint64_t const*)segment;
+    uint64_t* dst = (uint64_t*)snapshot;
+    size_t nb_words = sizeof(picoquic_metrics_segment_t) / sizeof(uint64_t);
+
+    for (size_t i = 0; i < nb_words; i++) {
+        dst[i] = src[i];
+    }
+}
+
+void picoquic_metrics_print(FILE* F, picoquic_metrics_segment_t const* segment)
+{
+    static const double percentiles[] = { 50.0, 90.0, 99.0, 99.9 };
+
+    fprintf(F, "uptime_usec %" PRIu64 "\n", segment->last_update_time - segment->start_time);
+    for (int i = 0; i < picoquic_metric_counter_max; i++) {
+        fprintf(F, "%s %" PRIu64 "\n", picoquic_metrics_counter_names[i], segment->counters[i]);
+    }
+    for (int i = 0; i < picoquic_metric_gauge_max; i++) {
+        fprintf(F, "%s %" PRId64 "\n", picoquic_metrics_gauge_names[i], segment->gauges[i]);
+    }
+    for (int i = 0; i < picoquic_metric_histogram_max; i++) {
+        picoquic_metrics_histogram_t const* h = &segment->histograms[i];
+
+        fprintf(F, "%s_count %" PRIu64 "\n", picoquic_metrics_histogram_names[i], h->count);
+        fprintf(F, "%s_sum %" PRIu64 "\n", picoquic_metrics_histogram_names[i], h->sum);
+        fprintf(F, "%s_max %" PRIu64 "\n", picoquic_metrics_histogram_names[i], h->max);
+        for (size_t j = 0; j < sizeof(percentiles) / sizeof(double); j++) {
+            fprintf(F, "%s_p%g %" PRIu64 "\n", picoquic_metrics_histogram_names[i], percentiles[j],
+                picoquic_metrics_percentile(h, percentiles[j]));
+        }
+    }
+    for (int i = 0; i < picoquic_event_max; i++) {
+        fprintf(F, "event_%s %" PRIu64 "\n", picoquic_event_name((picoquic_event_enum)i), segment->events[i]);
+    }
+}
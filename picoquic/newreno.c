@@ -337,7 +337,9 @@ picoquic_congestion_algorithm_t picoquic_newreno_algorithm_struct = {
     picoquic_newreno_init,
     picoquic_newreno_notify,
     picoquic_newreno_delete,
-    picoquic_newreno_observe
+    picoquic_newreno_observe,
+    0,
+    NULL /* Per packet acknowledgements, which the reference traces depend on */
 };
 
 picoquic_congestion_algorithm_t* picoquic_newreno_algorithm = &picoquic_newreno_algorithm_struct;
@@ -0,0 +1,261 @@
+/* Timing wheel for the context wide pacing scheduler.
+ *
+ * With per path pacing, each paced connection moves its wake time forward
+ * by one packet interval after each transmission, and is reinserted in the
+ * wake time splay tree. With thousands of paced connections, this means a
+ * tree rebalancing for every packet, and the sending loop has to come back
+ * at the exact microsecond of each wake time.
+ *
+ * The wheel bins connections by wake time in slots of "slot_usec". Insertion
+ * and removal are O(1). When the loop runs, all the slots whose start time
+ * is passed are appended to the "due" list, which is then served in order,
+ * so the loop can fill a transmit batch with everything that is due at
+ * once. Wake times beyond the horizon of the wheel stay in the splay tree,
+ * which keeps handling idle timers and long delays.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "picoquic_internal.h"
+
+static size_t picoquic_pacing_wheel_lowest_bit(uint64_t bits)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return (size_t)__builtin_ctzll(bits);
+#else
+    size_t index = 0;
+    while ((bits & 1) == 0) {
+        bits >>= 1;
+        index++;
+    }
+    return index;
+#endif
+}
+
+picoquic_pacing_wheel_t* picoquic_pacing_wheel_create(uint64_t slot_usec, size_t nb_slots)
+{
+    picoquic_pacing_wheel_t* wheel = NULL;
+
+    if (slot_usec == 0) {
+        return NULL;
+    }
+    nb_slots = (nb_slots < 64) ? 64 : ((nb_slots + 63) & ~((size_t)63));
+
+    if ((wheel = (picoquic_pacing_wheel_t*)malloc(sizeof(picoquic_pacing_wheel_t))) != NULL) {
+        memset(wheel, 0, sizeof(picoquic_pacing_wheel_t));
+        wheel->slot_usec = slot_usec;
+        wheel->nb_slots = nb_slots;
+        wheel->slot_first = (picoquic_cnx_t**)calloc(nb_slots, sizeof(picoquic_cnx_t*));
+        wheel->slot_last = (picoquic_cnx_t**)calloc(nb_slots, sizeof(picoquic_cnx_t*));
+        wheel->occupancy = (uint64_t*)calloc(nb_slots / 64, sizeof(uint64_t));
+        if (wheel->slot_first == NULL || wheel->slot_last == NULL || wheel->occupancy == NULL) {
+            picoquic_pacing_wheel_delete(wheel);
+            wheel = NULL;
+        }
+    }
+
+    return wheel;
+}
+
+void picoquic_pacing_wheel_delete(picoquic_pacing_wheel_t* wheel)
+{
+    if (wheel != NULL) {
+        if (wheel->slot_first != NULL) {
+            free(wheel->slot_first);
+        }
+        if (wheel->slot_last != NULL) {
+            free(wheel->slot_last);
+        }
+        if (wheel->occupancy != NULL) {
+            free(wheel->occupancy);
+        }
+        free(wheel);
+    }
+}
+
+static void picoquic_pacing_wheel_append(picoquic_cnx_t** first, picoquic_cnx_t** last, picoquic_cnx_t* cnx)
+{
+    cnx->wheel_next = NULL;
+    cnx->wheel_previous = *last;
+    if (*last == NULL) {
+        *first = cnx;
+    }
+    else {
+        (*last)->wheel_next = cnx;
+    }
+    *last = cnx;
+}
+
+/* Insert the connection according to cnx->next_wake_time.
+ * Returns -1 if the wake time is beyond the horizon of the wheel, in which
+ * case the connection shall be kept in the wake time tree.
+ */
+int picoquic_pacing_wheel_insert(picoquic_pacing_wheel_t* wheel, picoquic_cnx_t* cnx)
+{
+    uint64_t slot;
+
+    if (cnx->next_wake_time > UINT64_MAX - wheel->slot_usec) {
+        return -1;
+    }
+    slot = (cnx->next_wake_time + wheel->slot_usec - 1) / wheel->slot_usec;
+
+    if (slot < wheel->current_slot) {
+        picoquic_pacing_wheel_append(&wheel->due_first, &wheel->due_last, cnx);
+        cnx->is_wheel_due = 1;
+    }
+    else if (slot - wheel->current_slot >= wheel->nb_slots) {
+        return -1;
+    }
+    else {
+        size_t index = (size_t)(slot % wheel->nb_slots);
+        picoquic_pacing_wheel_append(&wheel->slot_first[index], &wheel->slot_last[index], cnx);
+        wheel->occupancy[index / 64] |= ((uint64_t)1) << (index % 64);
+        cnx->is_wheel_due = 0;
+    }
+    cnx->wheel_slot = slot;
+    cnx->is_in_pacing_wheel = 1;
+    wheel->nb_cnx++;
+    wheel->stats.nb_scheduled++;
+
+    return 0;
+}
+
+void picoquic_pacing_wheel_remove(picoquic_pacing_wheel_t* wheel, picoquic_cnx_t* cnx)
+{
+    picoquic_cnx_t** first;
+    picoquic_cnx_t** last;
+    size_t index = 0;
+
+    if (cnx->is_wheel_due) {
+        first = &wheel->due_first;
+        last = &wheel->due_last;
+    }
+    else {
+        index = (size_t)(cnx->wheel_slot % wheel->nb_slots);
+        first = &wheel->slot_first[index];
+        last = &wheel->slot_last[index];
+    }
+
+    if (cnx->wheel_previous == NULL) {
+        *first = cnx->wheel_next;
+    }
+    else {
+        cnx->wheel_previous->wheel_next = cnx->wheel_next;
+    }
+    if (cnx->wheel_next == NULL) {
+        *last = cnx->wheel_previous;
+    }
+    else {
+        cnx->wheel_next->wheel_previous = cnx->wheel_previous;
+    }
+    if (!cnx->is_wheel_due && *first == NULL) {
+        wheel->occupancy[index / 64] &= ~(((uint64_t)1) << (index % 64));
+    }
+
+    cnx->wheel_next = NULL;
+    cnx->wheel_previous = NULL;
+    cnx->is_in_pacing_wheel = 0;
+    cnx->is_wheel_due = 0;
+    wheel->nb_cnx--;
+}
+
+/* Find the first non empty slot at or after the current slot.
+ * Returns UINT64_MAX if all slots are empty.
+ */
+static uint64_t picoquic_pacing_wheel_next_slot(picoquic_pacing_wheel_t* wheel)
+{
+    size_t nb_words = wheel->nb_slots / 64;
+    size_t start = (size_t)(wheel->current_slot % wheel->nb_slots);
+    size_t word = start / 64;
+    uint64_t bits = wheel->occupancy[word] & (UINT64_MAX << (start % 64));
+
+    /* The start word is visited twice, to find the slots that wrapped around */
+    for (size_t k = 0; k <= nb_words; k++) {
+        if (bits != 0) {
+            size_t index = word * 64 + picoquic_pacing_wheel_lowest_bit(bits);
+            return wheel->current_slot + (index + wheel->nb_slots - start) % wheel->nb_slots;
+        }
+        word = (word + 1) % nb_words;
+        bits = wheel->occupancy[word];
+    }
+
+    return UINT64_MAX;
+}
+
+/* Move all the slots starting at or before the current time to the due list */
+void picoquic_pacing_wheel_drain(picoquic_pacing_wheel_t* wheel, uint64_t current_time)
+{
+    uint64_t target = current_time / wheel->slot_usec;
+
+    while (wheel->current_slot <= target) {
+        uint64_t slot = picoquic_pacing_wheel_next_slot(wheel);
+
+        if (slot > target) {
+            wheel->current_slot = target + 1;
+        }
+        else {
+            size_t index = (size_t)(slot % wheel->nb_slots);
+
+            for (picoquic_cnx_t* cnx = wheel->slot_first[index]; cnx != NULL; cnx = cnx->wheel_next) {
+                cnx->is_wheel_due = 1;
+            }
+            if (wheel->due_last == NULL) {
+                wheel->due_first = wheel->slot_first[index];
+            }
+            else {
+                wheel->due_last->wheel_next = wheel->slot_first[index];
+                wheel->slot_first[index]->wheel_previous = wheel->due_last;
+            }
+            wheel->due_last = wheel->slot_last[index];
+            wheel->slot_first[index] = NULL;
+            wheel->slot_last[index] = NULL;
+            wheel->occupancy[index / 64] &= ~(((uint64_t)1) << (index % 64));
+            wheel->current_slot = slot + 1;
+        }
+    }
+}
+
+/* Return the next connection to serve: the head of the due list if there is one,
+ * or else the head of the first non empty slot. The wake time is set to the
+ * time at which that connection will be served.
+ */
+picoquic_cnx_t* picoquic_pacing_wheel_first(picoquic_pacing_wheel_t* wheel, uint64_t* wake_time)
+{
+    picoquic_cnx_t* cnx = NULL;
+
+    if (wheel->due_first != NULL) {
+        cnx = wheel->due_first;
+        *wake_time = cnx->next_wake_time;
+    }
+    else if (wheel->nb_cnx > 0) {
+        uint64_t slot = picoquic_pacing_wheel_next_slot(wheel);
+
+        if (slot != UINT64_MAX) {
+            cnx = wheel->slot_first[slot % wheel->nb_slots];
+            *wake_time = slot * wheel->slot_usec;
+        }
+    }
+
+    return cnx;
+}
+
+void picoquic_pacing_wheel_departure(picoquic_pacing_wheel_t* wheel, uint64_t scheduled_time, uint64_t current_time)
+{
+    if (current_time < scheduled_time) {
+        wheel->stats.nb_early++;
+    }
+    else {
+        uint64_t lateness = current_time - scheduled_time;
+        int bucket = 0;
+
+        wheel->stats.nb_departures++;
+        wheel->stats.lateness_sum += lateness;
+        if (lateness > wheel->stats.lateness_max) {
+            wheel->stats.lateness_max = lateness;
+        }
+        while (bucket < PICOQUIC_PACING_WHEEL_HISTOGRAM_SIZE - 1 && lateness >= (wheel->slot_usec << bucket)) {
+            bucket++;
+        }
+        wheel->stats.lateness_histogram[bucket]++;
+    }
+}
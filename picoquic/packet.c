@@ -30,6 +30,8 @@
 #include "picoquic_internal.h"
 #include "picoquic_binlog.h"
 #include "picoquic_unified_log.h"
+#include "picoquic_metrics.h"
+#include "picoquic_profiler.h"
 #include "tls_api.h"
 #include <stdint.h>
 #include <stdlib.h>
@@ -411,7 +413,7 @@ uint64_t picoquic_get_packet_number64(uint64_t highest, uint64_t mask, uint32_t
 
 void picoquic_log_pn_dec_trial(picoquic_cnx_t* cnx)
 {
-    if (cnx->quic->log_pn_dec && (cnx->quic->F_log != NULL || cnx->f_binlog != NULL)){
+    if (cnx->quic->log_pn_dec && (cnx->quic->F_log != NULL || PICOQUIC_CNX_HAS_BINLOG(cnx))){
         void* pn_dec = cnx->crypto_context[picoquic_epoch_1rtt].pn_dec;
         void* pn_enc = cnx->crypto_context[picoquic_epoch_1rtt].pn_enc;
         uint8_t test_iv[32] = {
@@ -570,14 +572,14 @@ size_t picoquic_remove_packet_protection(picoquic_cnx_t* cnx,
             /* AEAD Decrypt, in place */
 
             if (cnx->is_multipath_enabled && ph->ptype) {
-                decoded = picoquic_aead_decrypt_mp(decoded_bytes + ph->offset,
+                decoded = picoquic_aead_decrypt_packet(cnx->quic, decoded_bytes + ph->offset,
                     bytes + ph->offset,
-                    ph->payload_length, 
+                    ph->payload_length, 1,
                     ph->l_cid->sequence, ph->pn64, decoded_bytes, ph->offset,
                     cnx->crypto_context[picoquic_epoch_1rtt].aead_decrypt);
             } else {
-                decoded = picoquic_aead_decrypt_generic(decoded_bytes + ph->offset,
-                    bytes + ph->offset, ph->payload_length, ph->pn64, decoded_bytes, ph->offset, 
+                decoded = picoquic_aead_decrypt_packet(cnx->quic, decoded_bytes + ph->offset,
+                    bytes + ph->offset, ph->payload_length, 0, 0, ph->pn64, decoded_bytes, ph->offset, 
                     cnx->crypto_context[picoquic_epoch_1rtt].aead_decrypt);
             }
             if (decoded <= ph->payload_length && ph->pn64 < ack_ctx->crypto_rotation_sequence) {
@@ -594,13 +596,13 @@ size_t picoquic_remove_packet_protection(picoquic_cnx_t* cnx,
             }
             else if (cnx->crypto_context_old.aead_decrypt != NULL) {
                 if (cnx->is_multipath_enabled) {
-                    decoded = picoquic_aead_decrypt_mp(decoded_bytes + ph->offset, bytes + ph->offset, ph->payload_length,
-                        ph->l_cid->sequence, ph->pn64, decoded_bytes, ph->offset, cnx->crypto_context_old.aead_decrypt);
+                    decoded = picoquic_aead_decrypt_packet(cnx->quic, decoded_bytes + ph->offset, bytes + ph->offset, ph->payload_length,
+                        1, ph->l_cid->sequence, ph->pn64, decoded_bytes, ph->offset, cnx->crypto_context_old.aead_decrypt);
 
                 }
                 else {
-                    decoded = picoquic_aead_decrypt_generic(decoded_bytes + ph->offset, bytes + ph->offset, ph->payload_length,
-                        ph->pn64, decoded_bytes, ph->offset, cnx->crypto_context_old.aead_decrypt);
+                    decoded = picoquic_aead_decrypt_packet(cnx->quic, decoded_bytes + ph->offset, bytes + ph->offset, ph->payload_length,
+                        0, 0, ph->pn64, decoded_bytes, ph->offset, cnx->crypto_context_old.aead_decrypt);
                 }
             }
             else {
@@ -620,13 +622,13 @@ size_t picoquic_remove_packet_protection(picoquic_cnx_t* cnx,
             /* if decoding succeeds, the rotation should be validated */
             if (ret == 0 && cnx->crypto_context_new.aead_decrypt != NULL) {
                 if (cnx->is_multipath_enabled) {
-                    decoded = picoquic_aead_decrypt_mp(decoded_bytes + ph->offset, bytes + ph->offset, ph->payload_length,
-                        ph->l_cid->sequence, ph->pn64, decoded_bytes, ph->offset, cnx->crypto_context_new.aead_decrypt);
+                    decoded = picoquic_aead_decrypt_packet(cnx->quic, decoded_bytes + ph->offset, bytes + ph->offset, ph->payload_length,
+                        1, ph->l_cid->sequence, ph->pn64, decoded_bytes, ph->offset, cnx->crypto_context_new.aead_decrypt);
 
                 }
                 else {
-                    decoded = picoquic_aead_decrypt_generic(decoded_bytes + ph->offset,
-                        bytes + ph->offset, ph->payload_length, ph->pn64, decoded_bytes, ph->offset, cnx->crypto_context_new.aead_decrypt);
+                    decoded = picoquic_aead_decrypt_packet(cnx->quic, decoded_bytes + ph->offset,
+                        bytes + ph->offset, ph->payload_length, 0, 0, ph->pn64, decoded_bytes, ph->offset, cnx->crypto_context_new.aead_decrypt);
                 }
                 if (decoded <= ph->payload_length) {
                     /* Rotation only if the packet was correctly decrypted with the new key */
@@ -668,14 +670,14 @@ size_t picoquic_remove_packet_protection(picoquic_cnx_t* cnx,
         /* For all the other epochs, there is a single crypto context and no key rotation */
         if (cnx->crypto_context[ph->epoch].aead_decrypt != NULL) {
             if (cnx->is_multipath_enabled && ph->ptype == picoquic_packet_1rtt_protected) {
-                decoded = picoquic_aead_decrypt_mp(decoded_bytes + ph->offset, 
-                    bytes + ph->offset, ph->payload_length,
+                decoded = picoquic_aead_decrypt_packet(cnx->quic, decoded_bytes + ph->offset, 
+                    bytes + ph->offset, ph->payload_length, 1,
                     ph->l_cid->sequence, ph->pn64, decoded_bytes, ph->offset,
                     cnx->crypto_context[picoquic_epoch_1rtt].aead_decrypt);
             }
             else {
-                decoded = picoquic_aead_decrypt_generic(decoded_bytes + ph->offset,
-                    bytes + ph->offset, ph->payload_length, ph->pn64, decoded_bytes, ph->offset, cnx->crypto_context[ph->epoch].aead_decrypt);
+                decoded = picoquic_aead_decrypt_packet(cnx->quic, decoded_bytes + ph->offset,
+                    bytes + ph->offset, ph->payload_length, 0, 0, ph->pn64, decoded_bytes, ph->offset, cnx->crypto_context[ph->epoch].aead_decrypt);
             }
         }
         else {
@@ -779,7 +781,15 @@ int picoquic_parse_header_and_decrypt(
                         ret = picoquic_remove_header_protection(*pcnx, (uint8_t*)bytes, decrypted_data->data, ph);
                     }
 
-                    if (ret == 0) {
+                    if (ret == 0 && ph->ptype == picoquic_packet_1rtt_protected && picoquic_crypto_async_is_enabled(quic) &&
+                        ((ph->key_phase == (*pcnx)->key_phase_dec &&
+                        (*pcnx)->crypto_context[picoquic_epoch_1rtt].aead_decrypt != NULL) ||
+                        (*pcnx)->nb_pending_decryptions > 0)) {
+                        /* Decryption with the current key is submitted to the async provider. The
+                         * other packets wait behind the pending ones, to keep the arrival order. */
+                        ret = PICOQUIC_ERROR_DECRYPTION_PENDING;
+                    }
+                    else if (ret == 0) {
                         decoded_length = picoquic_remove_packet_protection(*pcnx, (uint8_t*)bytes,
                             decrypted_data->data, ph, current_time, &already_received);
                     }
@@ -787,7 +797,10 @@ int picoquic_parse_header_and_decrypt(
                         decoded_length = ph->payload_length + 1;
                     }
 
-                    if (decoded_length > (length - ph->offset)) {
+                    if (ret == PICOQUIC_ERROR_DECRYPTION_PENDING) {
+                        /* The decryption checks are performed when the job completes */
+                    }
+                    else if (decoded_length > (length - ph->offset)) {
                         if (ph->ptype == picoquic_packet_1rtt_protected &&
                             length >= PICOQUIC_RESET_PACKET_MIN_SIZE &&
                             memcmp(bytes + length - PICOQUIC_RESET_SECRET_SIZE,
@@ -923,6 +936,49 @@ int picoquic_incoming_version_negotiation(
     return ret;
 }
 
+/*
+ * Format a version negotiation packet. The buffer shall be at least
+ * PICOQUIC_VN_PACKET_MAX bytes long.
+ */
+#define PICOQUIC_VN_PACKET_MAX (1 + 4 + 1 + 255 + 1 + 255 + 4 * 16 + 4)
+
+static size_t picoquic_format_version_negotiation(uint8_t* bytes,
+    const uint8_t* dcid, uint8_t dcid_length, const uint8_t* scid, uint8_t scid_length,
+    uint32_t proposed_version)
+{
+    size_t byte_index = 0;
+    uint32_t rand_vn;
+
+    /* Packet type set to random value for version negotiation */
+    picoquic_public_random(bytes + byte_index, 1);
+    bytes[byte_index++] |= 0x80;
+    /* Set the version number to zero */
+    picoformat_32(bytes + byte_index, 0);
+    byte_index += 4;
+
+    /* Copy the connection identifiers */
+    bytes[byte_index++] = scid_length;
+    memcpy(bytes + byte_index, scid, scid_length);
+    byte_index += scid_length;
+    bytes[byte_index++] = dcid_length;
+    memcpy(bytes + byte_index, dcid, dcid_length);
+    byte_index += dcid_length;
+
+    /* Set the payload to the list of versions */
+    for (size_t i = 0; i < picoquic_nb_supported_versions; i++) {
+        picoformat_32(bytes + byte_index, picoquic_supported_versions[i].version);
+        byte_index += 4;
+    }
+    /* Add random reserved value as grease, but be careful to not match proposed version */
+    do {
+        rand_vn = (((uint32_t)picoquic_public_random_64()) & 0xF0F0F0F0) | 0x0A0A0A0A;
+    } while (rand_vn == proposed_version);
+    picoformat_32(bytes + byte_index, rand_vn);
+    byte_index += 4;
+
+    return byte_index;
+}
+
 /*
  * Send a version negotiation packet in response to an incoming packet
  * sporting the wrong version number. This assumes that the original packet
@@ -965,36 +1021,8 @@ void picoquic_prepare_version_negotiation(
         picoquic_stateless_packet_t* sp = picoquic_create_stateless_packet(quic);
 
         if (sp != NULL) {
-            uint8_t* bytes = sp->bytes;
-            size_t byte_index = 0;
-            uint32_t rand_vn;
-
-            /* Packet type set to random value for version negotiation */
-            picoquic_public_random(bytes + byte_index, 1);
-            bytes[byte_index++] |= 0x80;
-            /* Set the version number to zero */
-            picoformat_32(bytes + byte_index, 0);
-            byte_index += 4;
-
-            /* Copy the connection identifiers */
-            bytes[byte_index++] = scid_length;
-            memcpy(bytes + byte_index, scid, scid_length);
-            byte_index += scid_length;
-            bytes[byte_index++] = dcid_length;
-            memcpy(bytes + byte_index, dcid, dcid_length);
-            byte_index += dcid_length;
-
-            /* Set the payload to the list of versions */
-            for (size_t i = 0; i < picoquic_nb_supported_versions; i++) {
-                picoformat_32(bytes + byte_index, picoquic_supported_versions[i].version);
-                byte_index += 4;
-            }
-            /* Add random reserved value as grease, but be careful to not match proposed version */
-            do {
-                rand_vn = (((uint32_t)picoquic_public_random_64()) & 0xF0F0F0F0) | 0x0A0A0A0A;
-            } while (rand_vn == ph->vn);
-            picoformat_32(bytes + byte_index, rand_vn);
-            byte_index += 4;
+            size_t byte_index = picoquic_format_version_negotiation(sp->bytes, dcid, dcid_length,
+                scid, scid_length, ph->vn);
 
             /* Set length and addresses, and queue. */
             sp->length = byte_index;
@@ -1012,6 +1040,38 @@ void picoquic_prepare_version_negotiation(
     }
 }
 
+/*
+ * Format a stateless reset in response to a packet of the specified length.
+ * The reset is shorter than the incoming packet, and at least
+ * PICOQUIC_RESET_PACKET_PAD_SIZE + PICOQUIC_RESET_SECRET_SIZE + 1 bytes long.
+ */
+static size_t picoquic_format_stateless_reset(picoquic_quic_t* quic, uint8_t* bytes, size_t length,
+    picoquic_connection_id_t* dest_cnx_id)
+{
+    size_t pad_size = length - PICOQUIC_RESET_SECRET_SIZE - 1;
+    size_t byte_index = 0;
+
+    if (pad_size > PICOQUIC_RESET_PACKET_PAD_SIZE) {
+        pad_size = (size_t)picoquic_public_uniform_random(pad_size - PICOQUIC_RESET_PACKET_PAD_SIZE)
+            + PICOQUIC_RESET_PACKET_PAD_SIZE;
+    }
+    else {
+        pad_size = PICOQUIC_RESET_PACKET_PAD_SIZE;
+    }
+
+    /* Packet type set to short header, randomize the 5 lower bits */
+    bytes[byte_index++] = 0x30 | (uint8_t)(picoquic_public_random_64() & 0x1F);
+
+    /* Add the random bytes */
+    picoquic_public_random(bytes + byte_index, pad_size);
+    byte_index += pad_size;
+    /* Add the public reset secret */
+    (void)picoquic_create_cnxid_reset_secret(quic, dest_cnx_id, bytes + byte_index);
+    byte_index += PICOQUIC_RESET_SECRET_SIZE;
+
+    return byte_index;
+}
+
 /*
  * Process an unexpected connection ID. This could be an old packet from a 
  * previous connection. If the packet type correspond to an encrypted value,
@@ -1035,27 +1095,8 @@ void picoquic_process_unexpected_cnxid(
         quic->stateless_reset_next_time <= current_time) {
         picoquic_stateless_packet_t* sp = picoquic_create_stateless_packet(quic);
         if (sp != NULL) {
-            size_t pad_size = length - PICOQUIC_RESET_SECRET_SIZE -1;
-            uint8_t* bytes = sp->bytes;
-            size_t byte_index = 0;
-
-            if (pad_size > PICOQUIC_RESET_PACKET_PAD_SIZE) {
-                pad_size = (size_t)picoquic_public_uniform_random(pad_size - PICOQUIC_RESET_PACKET_PAD_SIZE)
-                    + PICOQUIC_RESET_PACKET_PAD_SIZE;
-            }
-            else {
-                pad_size = PICOQUIC_RESET_PACKET_PAD_SIZE;
-            }
-
-            /* Packet type set to short header, randomize the 5 lower bits */
-            bytes[byte_index++] = 0x30 | (uint8_t)(picoquic_public_random_64() & 0x1F);
+            size_t byte_index = picoquic_format_stateless_reset(quic, sp->bytes, length, &ph->dest_cnx_id);
 
-            /* Add the random bytes */
-            picoquic_public_random(bytes + byte_index, pad_size);
-            byte_index += pad_size;
-            /* Add the public reset secret */
-            (void)picoquic_create_cnxid_reset_secret(quic, &ph->dest_cnx_id, bytes + byte_index);
-            byte_index += PICOQUIC_RESET_SECRET_SIZE;
             sp->length = byte_index;
             sp->ptype = picoquic_packet_1rtt_protected;
             picoquic_store_addr(&sp->addr_to, addr_from);
@@ -1152,6 +1193,313 @@ void picoquic_queue_immediate_close(picoquic_cnx_t* cnx, uint64_t current_time)
     }
 }
 
+/*
+ * Stateless pre-filter.
+ *
+ * When the server is requiring retry tokens, e.g., during a handshake flood,
+ * the pre-filter handles the packets that do not belong to existing connections
+ * directly from the receive loop. It only parses the invariant header and the
+ * token of Initial packets, verifies the tokens, and formats the Retry, Version
+ * Negotiation or Stateless Reset responses without creating a connection context.
+ * The tokens are verified without the packet number and reuse checks, which
+ * require decrypting the packet. These checks are performed as usual when the
+ * packet is passed to picoquic_incoming_packet_ex.
+ */
+
+static int picoquic_stateless_rate_check(picoquic_quic_t* quic, const struct sockaddr* addr_from, uint64_t current_time)
+{
+    int is_allowed = 1;
+
+    if (quic->stateless_rate_per_second > 0) {
+        uint64_t h;
+        picoquic_stateless_rate_bucket_t* bucket;
+
+        if (addr_from->sa_family == AF_INET) {
+            h = picohash_bytes((uint8_t*)&((struct sockaddr_in*)addr_from)->sin_addr, 4);
+        }
+        else {
+            h = picohash_bytes((uint8_t*)&((struct sockaddr_in6*)addr_from)->sin6_addr, 16);
+        }
+        h = picohash_hash_mix(h, quic->stateless_rate_seed);
+        bucket = &quic->stateless_rate_buckets[h % PICOQUIC_STATELESS_RATE_BUCKETS];
+
+        if (bucket->refill_time == 0) {
+            bucket->refill_time = current_time;
+            bucket->credits = quic->stateless_rate_burst;
+        }
+        else if (current_time > bucket->refill_time) {
+            uint64_t refill = ((current_time - bucket->refill_time) * quic->stateless_rate_per_second) / 1000000ull;
+            if (refill > 0) {
+                if (bucket->credits + refill >= quic->stateless_rate_burst) {
+                    bucket->credits = quic->stateless_rate_burst;
+                    bucket->refill_time = current_time;
+                }
+                else {
+                    bucket->credits += (uint32_t)refill;
+                    bucket->refill_time += (refill * 1000000ull) / quic->stateless_rate_per_second;
+                }
+            }
+        }
+
+        if (bucket->credits == 0) {
+            is_allowed = 0;
+        }
+        else {
+            bucket->credits--;
+        }
+    }
+
+    return is_allowed;
+}
+
+static size_t picoquic_format_stateless_retry(picoquic_quic_t* quic, int version_index,
+    uint8_t* bytes, size_t bytes_max, const picoquic_connection_id_t* odcid,
+    const picoquic_connection_id_t* client_cid, const picoquic_connection_id_t* retry_cid,
+    const uint8_t* token, size_t token_length)
+{
+    void* integrity_aead = picoquic_find_retry_protection_context_by_version(quic, version_index, 1);
+    size_t checksum_length = (integrity_aead == NULL) ? 0 : picoquic_aead_get_checksum_length(integrity_aead);
+    size_t byte_index = 0;
+
+    if (1 + 4 + 2 + client_cid->id_len + retry_cid->id_len + 1 + odcid->id_len + token_length + checksum_length > bytes_max) {
+        return 0;
+    }
+
+    bytes[byte_index++] = picoquic_create_long_packet_type(picoquic_packet_retry, version_index);
+    picoformat_32(bytes + byte_index, picoquic_supported_versions[version_index].version);
+    byte_index += 4;
+    bytes[byte_index++] = client_cid->id_len;
+    byte_index += picoquic_format_connection_id(bytes + byte_index, bytes_max - byte_index, *client_cid);
+    bytes[byte_index++] = retry_cid->id_len;
+    byte_index += picoquic_format_connection_id(bytes + byte_index, bytes_max - byte_index, *retry_cid);
+    if (integrity_aead == NULL) {
+        bytes[byte_index++] = odcid->id_len;
+        byte_index += picoquic_format_connection_id(bytes + byte_index, bytes_max - byte_index, *odcid);
+    }
+    memcpy(bytes + byte_index, token, token_length);
+    byte_index += token_length;
+
+    return picoquic_encode_retry_protection(integrity_aead, bytes, bytes_max, byte_index, odcid);
+}
+
+/* Return the buffer in which to format the response, either the caller's buffer
+ * or a packet from the preallocated pool. */
+static uint8_t* picoquic_prefilter_response_buffer(picoquic_quic_t* quic,
+    uint8_t* send_buffer, size_t send_buffer_max, size_t* bytes_max, picoquic_stateless_packet_t** p_sp)
+{
+    uint8_t* bytes = NULL;
+
+    *p_sp = NULL;
+    if (send_buffer != NULL) {
+        bytes = send_buffer;
+        *bytes_max = send_buffer_max;
+    }
+    else if ((*p_sp = picoquic_get_pooled_stateless_packet(quic)) != NULL) {
+        bytes = (*p_sp)->bytes;
+        *bytes_max = PICOQUIC_MAX_PACKET_SIZE;
+    }
+
+    return bytes;
+}
+
+static void picoquic_prefilter_response_done(picoquic_quic_t* quic, picoquic_stateless_packet_t* sp,
+    size_t length, picoquic_packet_type_enum ptype, const picoquic_connection_id_t* log_cid,
+    const struct sockaddr* addr_from, const struct sockaddr* addr_to, int if_index_to, size_t* send_length)
+{
+    if (sp == NULL) {
+        if (send_length != NULL) {
+            *send_length = length;
+        }
+    }
+    else if (length == 0) {
+        picoquic_delete_stateless_packet(sp);
+    }
+    else {
+        sp->length = length;
+        sp->ptype = ptype;
+        picoquic_store_addr(&sp->addr_to, addr_from);
+        picoquic_store_addr(&sp->addr_local, addr_to);
+        sp->if_index_local = if_index_to;
+        sp->initial_cid = *log_cid;
+        sp->cnxid_log64 = picoquic_val64_connection_id(sp->initial_cid);
+        picoquic_queue_stateless_packet(quic, sp);
+    }
+}
+
+int picoquic_stateless_prefilter(picoquic_quic_t* quic, const uint8_t* bytes, size_t length,
+    const struct sockaddr* addr_from, const struct sockaddr* addr_to, int if_index_to,
+    uint64_t current_time, uint8_t* send_buffer, size_t send_buffer_max, size_t* send_length)
+{
+    int ret = PICOQUIC_PREFILTER_PASS;
+    const uint8_t* bytes_max = bytes + length;
+    picoquic_connection_id_t dcid;
+    picoquic_connection_id_t scid;
+    picoquic_stateless_packet_t* sp = NULL;
+    uint8_t* response = NULL;
+    size_t response_max = 0;
+    size_t response_length = 0;
+
+    if (send_length != NULL) {
+        *send_length = 0;
+    }
+
+    if (!quic->check_token || length == 0 || quic->local_cnxid_length == 0) {
+        /* Fast path only used under load, and only if connections are identified by CID */
+        quic->prefilter_stats.nb_passed++;
+        return PICOQUIC_PREFILTER_PASS;
+    }
+
+    if ((bytes[0] & 0x80) == 0) {
+        /* Short header. Pass if the CID is known, or if this could be a stateless reset
+         * for a client connection. Otherwise, reply with a stateless reset. */
+        if (length <= PICOQUIC_RESET_PACKET_MIN_SIZE ||
+            picoquic_parse_connection_id(bytes + 1, quic->local_cnxid_length, &dcid) == 0 ||
+            picoquic_cnx_by_id(quic, dcid, NULL) != NULL ||
+            picoquic_cnx_by_secret(quic, bytes + length - PICOQUIC_RESET_SECRET_SIZE, addr_from) != NULL) {
+            ret = PICOQUIC_PREFILTER_PASS;
+        }
+        else {
+            ret = PICOQUIC_PREFILTER_CONSUMED;
+            if (quic->stateless_reset_next_time > current_time || !picoquic_stateless_rate_check(quic, addr_from, current_time)) {
+                quic->prefilter_stats.nb_rate_limited++;
+            }
+            else if ((response = picoquic_prefilter_response_buffer(quic, send_buffer, send_buffer_max, &response_max, &sp)) != NULL &&
+                response_max >= length) {
+                response_length = picoquic_format_stateless_reset(quic, response, length, &dcid);
+                picoquic_prefilter_response_done(quic, sp, response_length, picoquic_packet_1rtt_protected, &dcid,
+                    addr_from, addr_to, if_index_to, send_length);
+                quic->stateless_reset_next_time = current_time + quic->stateless_reset_min_interval;
+                quic->prefilter_stats.nb_stateless_reset++;
+            }
+            else {
+                if (sp != NULL) {
+                    picoquic_delete_stateless_packet(sp);
+                }
+                quic->prefilter_stats.nb_dropped++;
+            }
+        }
+    }
+    else {
+        uint32_t vn = 0;
+        int version_index = -1;
+        size_t token_length = 0;
+        const uint8_t* token = NULL;
+        const uint8_t* next_bytes = bytes + 1;
+
+        if ((next_bytes = picoquic_frames_uint32_decode(next_bytes, bytes_max, &vn)) == NULL ||
+            (next_bytes = picoquic_frames_cid_decode(next_bytes, bytes_max, &dcid)) == NULL ||
+            (next_bytes = picoquic_frames_cid_decode(next_bytes, bytes_max, &scid)) == NULL) {
+            /* Malformed, including CID longer than 20 bytes. Let the regular code decide. */
+            ret = PICOQUIC_PREFILTER_PASS;
+        }
+        else if (vn == 0 ||
+            (dcid.id_len == quic->local_cnxid_length && picoquic_cnx_by_id(quic, dcid, NULL) != NULL) ||
+            picoquic_cnx_by_icid(quic, &dcid, addr_from) != NULL) {
+            /* Version negotiation for a client connection, or packet for an existing connection */
+            ret = PICOQUIC_PREFILTER_PASS;
+        }
+        else if ((version_index = picoquic_get_version_index(vn)) < 0) {
+            ret = PICOQUIC_PREFILTER_CONSUMED;
+            if (length < PICOQUIC_ENFORCED_INITIAL_MTU) {
+                quic->prefilter_stats.nb_dropped++;
+            }
+            else if (!picoquic_stateless_rate_check(quic, addr_from, current_time)) {
+                quic->prefilter_stats.nb_rate_limited++;
+            }
+            else if ((response = picoquic_prefilter_response_buffer(quic, send_buffer, send_buffer_max, &response_max, &sp)) != NULL &&
+                response_max >= PICOQUIC_VN_PACKET_MAX) {
+                response_length = picoquic_format_version_negotiation(response, dcid.id, dcid.id_len, scid.id, scid.id_len, vn);
+                picoquic_prefilter_response_done(quic, sp, response_length, picoquic_packet_version_negotiation, &dcid,
+                    addr_from, addr_to, if_index_to, send_length);
+                quic->prefilter_stats.nb_version_negotiation++;
+            }
+            else {
+                if (sp != NULL) {
+                    picoquic_delete_stateless_packet(sp);
+                }
+                quic->prefilter_stats.nb_dropped++;
+            }
+        }
+        else if (picoquic_parse_long_packet_type(bytes[0], version_index) != picoquic_packet_initial) {
+            /* Not a connection attempt, and no matching connection: drop */
+            ret = PICOQUIC_PREFILTER_CONSUMED;
+            quic->prefilter_stats.nb_dropped++;
+        }
+        else if (length < PICOQUIC_ENFORCED_INITIAL_MTU || dcid.id_len < PICOQUIC_ENFORCED_INITIAL_CID_LENGTH ||
+            quic->enforce_client_only || quic->server_busy ||
+            (next_bytes = picoquic_frames_varlen_decode(next_bytes, bytes_max, &token_length)) == NULL ||
+            token_length > (size_t)(bytes_max - next_bytes)) {
+            /* These packets would be rejected by the regular code. Busy servers reply
+             * with a connection close, which requires a context. */
+            ret = (quic->server_busy && !quic->enforce_client_only) ? PICOQUIC_PREFILTER_PASS : PICOQUIC_PREFILTER_CONSUMED;
+            if (ret == PICOQUIC_PREFILTER_CONSUMED) {
+                quic->prefilter_stats.nb_dropped++;
+            }
+        }
+        else {
+            int is_new_token = 0;
+            int is_valid_token = 0;
+
+            token = next_bytes;
+            if (token_length > 0) {
+                picoquic_connection_id_t odcid;
+                is_valid_token = (picoquic_verify_retry_token(quic, addr_from, current_time, &is_new_token,
+                    &odcid, &dcid, UINT32_MAX, token, token_length, 0) == 0);
+            }
+
+            if (is_valid_token) {
+                ret = PICOQUIC_PREFILTER_PASS;
+            }
+            else if (token_length > 0 && !is_new_token) {
+                ret = PICOQUIC_PREFILTER_CONSUMED;
+                quic->prefilter_stats.nb_invalid_token++;
+            }
+            else {
+                ret = PICOQUIC_PREFILTER_CONSUMED;
+                if (!picoquic_stateless_rate_check(quic, addr_from, current_time)) {
+                    quic->prefilter_stats.nb_rate_limited++;
+                }
+                else if ((response = picoquic_prefilter_response_buffer(quic, send_buffer, send_buffer_max, &response_max, &sp)) != NULL) {
+                    picoquic_connection_id_t retry_cid;
+                    uint8_t token_buffer[256];
+                    size_t token_size = 0;
+
+                    picoquic_crypto_random(quic, retry_cid.id, quic->local_cnxid_length);
+                    memset(retry_cid.id + quic->local_cnxid_length, 0, sizeof(retry_cid.id) - quic->local_cnxid_length);
+                    retry_cid.id_len = quic->local_cnxid_length;
+                    if (quic->cnx_id_callback_fn) {
+                        quic->cnx_id_callback_fn(quic, retry_cid, dcid, quic->cnx_id_callback_ctx, &retry_cid);
+                    }
+                    /* The packet number is not decrypted. Binding the token to PN 0 only
+                     * requires that the client does not reset its packet numbers after Retry. */
+                    if (picoquic_prepare_retry_token(quic, addr_from, current_time + PICOQUIC_TOKEN_DELAY_SHORT,
+                        &dcid, &retry_cid, 0, token_buffer, sizeof(token_buffer), &token_size) == 0) {
+                        response_length = picoquic_format_stateless_retry(quic, version_index, response, response_max,
+                            &dcid, &scid, &retry_cid, token_buffer, token_size);
+                    }
+                    picoquic_prefilter_response_done(quic, sp, response_length, picoquic_packet_retry, &dcid,
+                        addr_from, addr_to, if_index_to, send_length);
+                    if (response_length > 0) {
+                        quic->prefilter_stats.nb_retry++;
+                    }
+                    else {
+                        quic->prefilter_stats.nb_dropped++;
+                    }
+                }
+                else {
+                    quic->prefilter_stats.nb_dropped++;
+                }
+            }
+        }
+    }
+
+    if (ret == PICOQUIC_PREFILTER_PASS) {
+        quic->prefilter_stats.nb_passed++;
+    }
+
+    return ret;
+}
+
 /*
  * Processing of initial or handshake messages when they are not expected
  * any more. These messages could be used in a DOS attack against the
@@ -2051,7 +2399,7 @@ int picoquic_incoming_1rtt(
                 ret = picoquic_tls_stream_process(cnx, NULL, current_time);
             }
 
-            if (ret == 0 && picoquic_cnx_is_still_logging(cnx)) {
+            if (ret == 0) {
                 picoquic_log_cc_dump(cnx, current_time);
             }
         }
@@ -2085,6 +2433,7 @@ int  picoquic_incoming_not_decrypted(
                 current_time - cnx->start_time < cnx->path[0]->smoothed_rtt) {
                 /* We received a first packet from the peer! */
                 picoquic_update_path_rtt(cnx, cnx->path[0], cnx->path[0], cnx->start_time, current_time, 0, 0);
+                picoquic_notify_pending_rtt(cnx, cnx->path[0], current_time);
             }
 
             if (length <= PICOQUIC_MAX_PACKET_SIZE &&
@@ -2112,142 +2461,139 @@ int  picoquic_incoming_not_decrypted(
     return buffered;
 }
 
-/*
-* Processing of the packet that was just received from the network.
-*/
+/* Classify the dropped packets for the metrics */
+static void picoquic_metrics_count_drop(picoquic_quic_t* quic, int ret)
+{
+    picoquic_metric_counter_enum reason;
 
-int picoquic_incoming_segment(
+    switch (ret) {
+    case PICOQUIC_ERROR_AEAD_CHECK:
+    case PICOQUIC_ERROR_AEAD_NOT_READY:
+        reason = picoquic_metric_drop_decrypt;
+        break;
+    case PICOQUIC_ERROR_PACKET_WRONG_VERSION:
+    case PICOQUIC_ERROR_VERSION_NOT_SUPPORTED:
+        reason = picoquic_metric_drop_version;
+        break;
+    case PICOQUIC_ERROR_INITIAL_TOO_SHORT:
+    case PICOQUIC_ERROR_INITIAL_CID_TOO_SHORT:
+    case PICOQUIC_ERROR_CNXID_SEGMENT:
+    case PICOQUIC_ERROR_PACKET_TOO_LONG:
+        reason = picoquic_metric_drop_malformed;
+        break;
+    case PICOQUIC_ERROR_DUPLICATE:
+        reason = picoquic_metric_drop_duplicate;
+        break;
+    case PICOQUIC_ERROR_UNEXPECTED_PACKET:
+    case PICOQUIC_ERROR_CNXID_CHECK:
+    case PICOQUIC_ERROR_DETECTED:
+    case PICOQUIC_ERROR_CONNECTION_DELETED:
+        reason = picoquic_metric_drop_unexpected;
+        break;
+    case PICOQUIC_ERROR_PORT_BLOCKED:
+        reason = picoquic_metric_drop_blocked;
+        break;
+    default:
+        reason = picoquic_metric_drop_other;
+        break;
+    }
+    quic->metrics->counters[reason]++;
+}
+
+/*
+ * Processing of a segment once it has been decrypted, or once decryption failed.
+ */
+static int picoquic_incoming_decrypted_segment(
     picoquic_quic_t* quic,
+    picoquic_cnx_t* cnx,
+    int ret,
+    picoquic_packet_header* ph,
+    picoquic_stream_data_node_t* decrypted_data,
     uint8_t* raw_bytes,
     size_t length,
     size_t packet_length,
-    size_t* consumed,
+    size_t consumed,
     struct sockaddr* addr_from,
     struct sockaddr* addr_to,
     int if_index_to,
     unsigned char received_ecn,
     uint64_t current_time,
     uint64_t receive_time,
-    picoquic_connection_id_t* previous_dest_id,
+    int is_first_segment,
+    int new_context_created,
     picoquic_cnx_t** first_cnx)
 {
-    int ret = 0;
-    picoquic_cnx_t* cnx = NULL;
-    picoquic_packet_header ph;
-    int new_context_created = 0;
-    int is_first_segment = 0;
     int is_buffered = 0;
     int path_id = -1;
     int path_is_not_allocated = 0;
-    uint8_t* bytes = NULL;
-    picoquic_stream_data_node_t* decrypted_data = picoquic_stream_data_node_alloc(quic);
-
-    if (decrypted_data == NULL) {
-        return -1;
-    }
-    /* Parse the header and decrypt the segment */
-    ret = picoquic_parse_header_and_decrypt(quic, raw_bytes, length, packet_length, addr_from,
-        current_time, decrypted_data, &ph, &cnx, consumed, &new_context_created);
-    bytes = decrypted_data->data;
-
-    /* Verify that the segment coalescing is for the same destination ID */
-    if (picoquic_is_connection_id_null(previous_dest_id)) {
-        /* This is the first segment in the incoming packet */
-        *previous_dest_id = ph.dest_cnx_id;
-        is_first_segment = 1;
-        *first_cnx = cnx;
-
-
-        /* if needed, log that the packet is received */
-        if (cnx != NULL) {
-            picoquic_log_pdu(cnx, 1, current_time, addr_from, addr_to, packet_length);
-        }
-        else {
-            picoquic_log_quic_pdu(quic, 1, current_time, picoquic_val64_connection_id(ph.dest_cnx_id),
-                addr_from, addr_to, packet_length);
-        }
-    }
-    else {
-        if (ret == 0 && picoquic_compare_connection_id(previous_dest_id, &ph.dest_cnx_id) != 0) {
-            ret = PICOQUIC_ERROR_CNXID_SEGMENT;
-        }
-        else if (ret == PICOQUIC_ERROR_VERSION_NOT_SUPPORTED) {
-            /* A coalesced packet with unknown version is likely some kind of padding */
-            ret = PICOQUIC_ERROR_CNXID_SEGMENT;
-        }
-
-        if (ret == PICOQUIC_ERROR_CNXID_SEGMENT && *first_cnx != cnx && *first_cnx != NULL) {
-            /* Log the drop segment information in the context of the first connection */
-            picoquic_log_dropped_packet(*first_cnx, NULL, &ph, length, ret, bytes, current_time);
-        }
-    }
+    uint8_t* bytes = decrypted_data->data;
 
     /* Store packet if received in advance of encryption keys */
     if (ret == PICOQUIC_ERROR_AEAD_NOT_READY &&
         cnx != NULL) {
-        is_buffered = picoquic_incoming_not_decrypted(cnx, &ph, current_time, bytes, length, addr_from, addr_to, if_index_to, received_ecn);
+        is_buffered = picoquic_incoming_not_decrypted(cnx, ph, current_time, bytes, length, addr_from, addr_to, if_index_to, received_ecn);
     }
 
     /* Find the path and if required log the incoming packet */
     if (cnx != NULL) {
-        if (ret == 0 && ph.ptype == picoquic_packet_1rtt_protected) {
-            if (ph.payload_length == 0) {
+        if (ret == 0 && ph->ptype == picoquic_packet_1rtt_protected) {
+            if (ph->payload_length == 0) {
                 /* empty payload! */
                 ret = picoquic_connection_error(cnx, PICOQUIC_TRANSPORT_PROTOCOL_VIOLATION, 0);
             }
-            else if (ph.has_reserved_bit_set) {
+            else if (ph->has_reserved_bit_set) {
                 /* Reserved bits were not set to zero */
                 ret = picoquic_connection_error(cnx, PICOQUIC_TRANSPORT_PROTOCOL_VIOLATION, 0);
             }
             else {
                 /* Find the arrival path and update its state */
-                ret = picoquic_find_incoming_path(cnx, &ph, addr_from, addr_to, current_time, &path_id, &path_is_not_allocated);
+                ret = picoquic_find_incoming_path(cnx, ph, addr_from, addr_to, current_time, &path_id, &path_is_not_allocated);
             }
         }
 
         if (ret == 0) {
             /* TODO: identify incoming path */
-            picoquic_log_packet(cnx, (path_id < 0)?NULL:cnx->path[path_id], 1, current_time, &ph, bytes, *consumed);
+            picoquic_log_packet(cnx, (path_id < 0)?NULL:cnx->path[path_id], 1, current_time, ph, bytes, consumed);
         }
         else if (is_buffered) {
-            picoquic_log_buffered_packet(cnx, (path_id < 0) ? NULL : cnx->path[path_id], ph.ptype, current_time);
+            picoquic_log_buffered_packet(cnx, (path_id < 0) ? NULL : cnx->path[path_id], ph->ptype, current_time);
         } else {
-            picoquic_log_dropped_packet(cnx, (path_id < 0) ? NULL : cnx->path[path_id], &ph, length, ret, bytes, current_time);
+            picoquic_log_dropped_packet(cnx, (path_id < 0) ? NULL : cnx->path[path_id], ph, length, ret, bytes, current_time);
         }
     }
 
     if (ret == PICOQUIC_ERROR_VERSION_NOT_SUPPORTED) {
         if (packet_length >= PICOQUIC_ENFORCED_INITIAL_MTU) {
             /* use the result of parsing to consider version negotiation */
-            picoquic_prepare_version_negotiation(quic, addr_from, addr_to, if_index_to, &ph, raw_bytes);
+            picoquic_prepare_version_negotiation(quic, addr_from, addr_to, if_index_to, ph, raw_bytes);
         }
     } else if (ret == 0) {
         if (cnx == NULL) {
             /* Unexpected packet. Reject, drop and log. */
-            if (!picoquic_is_connection_id_null(&ph.dest_cnx_id)) {
-                picoquic_process_unexpected_cnxid(quic, length, addr_from, addr_to, if_index_to, &ph, current_time);
+            if (!picoquic_is_connection_id_null(&ph->dest_cnx_id)) {
+                picoquic_process_unexpected_cnxid(quic, length, addr_from, addr_to, if_index_to, ph, current_time);
             }
             ret = PICOQUIC_ERROR_DETECTED;
         }
         else {
-            cnx->quic_bit_received_0 |= ph.quic_bit_is_zero;
-            switch (ph.ptype) {
+            cnx->quic_bit_received_0 |= ph->quic_bit_is_zero;
+            switch (ph->ptype) {
             case picoquic_packet_version_negotiation:
                 ret = picoquic_incoming_version_negotiation(
-                    cnx, bytes, length, addr_from, &ph, current_time);
+                    cnx, bytes, length, addr_from, ph, current_time);
                 break;
             case picoquic_packet_initial:
                 /* Initial packet: either crypto handshakes or acks. */
-                if (ph.has_reserved_bit_set) {
+                if (ph->has_reserved_bit_set) {
                     ret = PICOQUIC_ERROR_PACKET_HEADER_PARSING;
-                } else if ((!cnx->client_mode && picoquic_compare_connection_id(&ph.dest_cnx_id, &cnx->initial_cnxid) == 0) ||
-                    picoquic_compare_connection_id(&ph.dest_cnx_id, &cnx->path[0]->p_local_cnxid->cnx_id) == 0) {
+                } else if ((!cnx->client_mode && picoquic_compare_connection_id(&ph->dest_cnx_id, &cnx->initial_cnxid) == 0) ||
+                    picoquic_compare_connection_id(&ph->dest_cnx_id, &cnx->path[0]->p_local_cnxid->cnx_id) == 0) {
                     /* Verify that the source CID matches expectation */
                     if (picoquic_is_connection_id_null(&cnx->path[0]->p_remote_cnxid->cnx_id)) {
-                        cnx->path[0]->p_remote_cnxid->cnx_id = ph.srce_cnx_id;
-                    } else if (picoquic_compare_connection_id(&cnx->path[0]->p_remote_cnxid->cnx_id, &ph.srce_cnx_id) != 0) {
+                        cnx->path[0]->p_remote_cnxid->cnx_id = ph->srce_cnx_id;
+                    } else if (picoquic_compare_connection_id(&cnx->path[0]->p_remote_cnxid->cnx_id, &ph->srce_cnx_id) != 0) {
                         DBG_PRINTF("Error wrong srce cnxid (%d), type: %d, epoch: %d, pc: %d, pn: %d\n",
-                            cnx->client_mode, ph.ptype, ph.epoch, ph.pc, (int)ph.pn);
+                            cnx->client_mode, ph->ptype, ph->epoch, ph->pc, (int)ph->pn);
                         ret = PICOQUIC_ERROR_UNEXPECTED_PACKET;
                     }
                     if (ret == 0) {
@@ -2265,43 +2611,43 @@ int picoquic_incoming_segment(
                                 cnx->initial_data_received += packet_length;
                             }
                             ret = picoquic_incoming_client_initial(&cnx, bytes, packet_length, decrypted_data,
-                                addr_from, addr_to, if_index_to, &ph, current_time, new_context_created);
+                                addr_from, addr_to, if_index_to, ph, current_time, new_context_created);
                             /* Reset the value of first_cnx, as the context may have been deleted */
                             *first_cnx = cnx;
                         }
                         else {
                             /* TODO: this really depends on the current receive epoch */
                             ret = picoquic_incoming_server_initial(cnx, bytes, packet_length,
-                                decrypted_data, addr_to, if_index_to, &ph, current_time);
+                                decrypted_data, addr_to, if_index_to, ph, current_time);
                         }
                     }
                 } else {
                     DBG_PRINTF("Error detected (%d), type: %d, epoch: %d, pc: %d, pn: %d\n",
-                        cnx->client_mode, ph.ptype, ph.epoch, ph.pc, (int)ph.pn);
+                        cnx->client_mode, ph->ptype, ph->epoch, ph->pc, (int)ph->pn);
                     ret = PICOQUIC_ERROR_DETECTED;
                 }
                 break;
             case picoquic_packet_retry:
-                ret = picoquic_incoming_retry(cnx, raw_bytes, &ph, current_time);
+                ret = picoquic_incoming_retry(cnx, raw_bytes, ph, current_time);
                 break;
             case picoquic_packet_handshake:
-                if (ph.has_reserved_bit_set) {
+                if (ph->has_reserved_bit_set) {
                     ret = picoquic_connection_error(cnx, PICOQUIC_TRANSPORT_PROTOCOL_VIOLATION, 0);
                 }
-                else if (ph.has_reserved_bit_set) {
+                else if (ph->has_reserved_bit_set) {
                     ret = PICOQUIC_ERROR_PACKET_HEADER_PARSING;
                 }
                 else if (cnx->client_mode)
                 {
-                    ret = picoquic_incoming_server_handshake(cnx, bytes, decrypted_data, addr_to, if_index_to, &ph, current_time);
+                    ret = picoquic_incoming_server_handshake(cnx, bytes, decrypted_data, addr_to, if_index_to, ph, current_time);
                 }
                 else
                 {
-                    ret = picoquic_incoming_client_handshake(cnx, bytes, decrypted_data, &ph, current_time);
+                    ret = picoquic_incoming_client_handshake(cnx, bytes, decrypted_data, ph, current_time);
                 }
                 break;
             case picoquic_packet_0rtt_protected:
-                if (ph.has_reserved_bit_set) {
+                if (ph->has_reserved_bit_set) {
                     ret = picoquic_connection_error(cnx, PICOQUIC_TRANSPORT_PROTOCOL_VIOLATION, 0);
                 }
                 else {
@@ -2311,18 +2657,18 @@ int picoquic_incoming_segment(
                          * the first segment in packet */
                         cnx->initial_data_received += packet_length;
                     }
-                    ret = picoquic_incoming_0rtt(cnx, bytes, decrypted_data, &ph, current_time);
+                    ret = picoquic_incoming_0rtt(cnx, bytes, decrypted_data, ph, current_time);
                 }
                 break;
             case picoquic_packet_1rtt_protected:
                 ret = picoquic_incoming_1rtt(cnx, path_id, bytes, decrypted_data,
-                    &ph, addr_from, addr_to, if_index_to, received_ecn,
+                    ph, addr_from, addr_to, if_index_to, received_ecn,
                     path_is_not_allocated, current_time);
                 break;
             default:
                 /* Packet type error. Log and ignore */
                 DBG_PRINTF("Unexpected packet type (%d), type: %d, epoch: %d, pc: %d, pn: %d\n",
-                    cnx->client_mode, ph.ptype, ph.epoch, ph.pc, (int) ph.pn);
+                    cnx->client_mode, ph->ptype, ph->epoch, ph->pc, (int) ph->pn);
                 ret = PICOQUIC_ERROR_DETECTED;
                 break;
             }
@@ -2331,7 +2677,7 @@ int picoquic_incoming_segment(
         ret = picoquic_incoming_stateless_reset(cnx);
     }
     else if (ret == PICOQUIC_ERROR_AEAD_CHECK &&
-        ph.ptype == picoquic_packet_handshake &&
+        ph->ptype == picoquic_packet_handshake &&
         cnx != NULL &&
         (cnx->cnx_state == picoquic_state_client_init_sent || cnx->cnx_state == picoquic_state_client_init_resent))
     {
@@ -2341,18 +2687,19 @@ int picoquic_incoming_segment(
             /* Reset the retransmit timer to start retransmission immediately */
             cnx->path[0]->retransmit_timer = current_time -
                 cnx->pkt_ctx[picoquic_packet_context_initial].retransmit_oldest->send_time;
+            cnx->loss_detection_epoch++;
         }
     }
 
     if (ret == 0) {
         if (cnx != NULL && cnx->cnx_state != picoquic_state_disconnected &&
-            ph.ptype != picoquic_packet_version_negotiation) {
+            ph->ptype != picoquic_packet_version_negotiation) {
             cnx->nb_packets_received++;
             cnx->latest_receive_time = current_time;
             /* Mark the sequence number as received */
-            ret = picoquic_record_pn_received(cnx, ph.pc, ph.l_cid, ph.pn64, receive_time);
+            ret = picoquic_record_pn_received(cnx, ph->pc, ph->l_cid, ph->pn64, receive_time);
             /* Perform ECN accounting */
-            picoquic_ecn_accounting(cnx, received_ecn, ph.pc, ph.l_cid);
+            picoquic_ecn_accounting(cnx, received_ecn, ph->pc, ph->l_cid);
         }
         if (cnx != NULL) {
             picoquic_reinsert_by_wake_time(cnx->quic, cnx, current_time);
@@ -2371,6 +2718,9 @@ int picoquic_incoming_segment(
         ret == PICOQUIC_ERROR_DUPLICATE ||
         ret == PICOQUIC_ERROR_AEAD_NOT_READY) {
         /* Bad packets are dropped silently */
+        if (quic->metrics != NULL) {
+            picoquic_metrics_count_drop(quic, ret);
+        }
         if (ret == PICOQUIC_ERROR_AEAD_CHECK ||
             ret == PICOQUIC_ERROR_PACKET_WRONG_VERSION ||
             ret == PICOQUIC_ERROR_AEAD_NOT_READY ||
@@ -2387,12 +2737,12 @@ int picoquic_incoming_segment(
     } else if (ret == 1) {
         /* wonder what happened ! */
         DBG_PRINTF("Packet (%d) get ret=1, t: %d, e: %d, pc: %d, pn: %d, l: %zu\n",
-            (cnx == NULL) ? -1 : cnx->client_mode, ph.ptype, ph.epoch, ph.pc, (int)ph.pn, length);
+            (cnx == NULL) ? -1 : cnx->client_mode, ph->ptype, ph->epoch, ph->pc, (int)ph->pn, length);
         ret = -1;
     }
     else if (ret != 0) {
         DBG_PRINTF("Packet (%d) error, t: %d, e: %d, pc: %d, pn: %d, l: %zu, ret : 0x%x\n",
-            (cnx == NULL) ? -1 : cnx->client_mode, ph.ptype, ph.epoch, ph.pc, (int)ph.pn, length, ret);
+            (cnx == NULL) ? -1 : cnx->client_mode, ph->ptype, ph->epoch, ph->pc, (int)ph->pn, length, ret);
         ret = -1;
     }
 
@@ -2403,6 +2753,276 @@ int picoquic_incoming_segment(
     return ret;
 }
 
+/*
+ * Asynchronous decryption of 1-RTT packets.
+ * The header was already decoded in the decrypted data node. The payload is
+ * copied after it, and decrypted in place by the provider. The packet is
+ * processed after the job completes, in arrival order. Packets that do not
+ * use the current key are not submitted. They are decrypted in line once
+ * they reach the head of the queue, with the key rotation rules of
+ * "picoquic_remove_packet_protection".
+ */
+static int picoquic_submit_pending_decryption(picoquic_cnx_t* cnx, const uint8_t* raw_bytes,
+    picoquic_packet_header* ph, picoquic_stream_data_node_t* decrypted_data,
+    struct sockaddr* addr_from, struct sockaddr* addr_to, int if_index_to, unsigned char received_ecn,
+    size_t packet_length, uint64_t current_time, uint64_t receive_time)
+{
+    int ret = 0;
+    picoquic_quic_t* quic = cnx->quic;
+    picoquic_pending_decryption_t* pending = (picoquic_pending_decryption_t*)malloc(sizeof(picoquic_pending_decryption_t));
+
+    if (pending == NULL) {
+        DBG_PRINTF("%s", "Cannot allocate pending decryption");
+        picoquic_stream_data_node_recycle(decrypted_data);
+        ret = -1;
+    }
+    else {
+        picoquic_aead_job_t* job = &pending->job;
+
+        memset(pending, 0, sizeof(picoquic_pending_decryption_t));
+        memcpy(decrypted_data->data + ph->offset, raw_bytes + ph->offset, ph->payload_length);
+        pending->cnx = cnx;
+        pending->decrypted_data = decrypted_data;
+        pending->ph = *ph;
+        picoquic_store_addr(&pending->addr_from, addr_from);
+        picoquic_store_addr(&pending->addr_to, addr_to);
+        pending->if_index_to = if_index_to;
+        pending->received_ecn = received_ecn;
+        pending->packet_length = packet_length;
+        pending->receive_time = receive_time;
+
+        job->output = decrypted_data->data + ph->offset;
+        job->input = job->output;
+        job->input_length = ph->payload_length;
+        job->auth_data = decrypted_data->data;
+        job->auth_data_length = ph->offset;
+        job->seq_num = ph->pn64;
+        job->aead_context = cnx->crypto_context[picoquic_epoch_1rtt].aead_decrypt;
+        if (cnx->is_multipath_enabled) {
+            job->is_multipath = 1;
+            job->path_id = ph->l_cid->sequence;
+        }
+        job->job_ctx = pending;
+
+        if (quic->last_pending_decryption == NULL) {
+            quic->first_pending_decryption = pending;
+        }
+        else {
+            quic->last_pending_decryption->next_pending = pending;
+        }
+        quic->last_pending_decryption = pending;
+        cnx->nb_pending_decryptions++;
+        pending->key_rotations = cnx->nb_crypto_key_rotations;
+
+        if (ph->key_phase != cnx->key_phase_dec || job->aead_context == NULL) {
+            pending->is_deferred = 1;
+            pending->is_done = 1;
+        }
+        else if (picoquic_crypto_async_submit(cnx, &job, 1) == 0) {
+            /* Processed in line */
+            pending->is_done = 1;
+        }
+        picoquic_reinsert_by_wake_time(quic, cnx, current_time);
+    }
+
+    return ret;
+}
+
+/* Processing of a 1-RTT packet after its asynchronous decryption. This
+ * performs the checks that "picoquic_remove_packet_protection" and
+ * "picoquic_parse_header_and_decrypt" perform after a synchronous decryption.
+ * If the keys rotated after the job was submitted, the packet was decrypted
+ * with what is now the old key, and is only accepted under the same rules
+ * as packets decrypted synchronously with the old key.
+ */
+static int picoquic_incoming_pending_decryption(picoquic_pending_decryption_t* pending, uint64_t current_time)
+{
+    int ret = 0;
+    int already_received = 0;
+    int need_integrity_check = 1;
+    picoquic_cnx_t* cnx = pending->cnx;
+    picoquic_cnx_t* first_cnx = cnx;
+    picoquic_packet_header* ph = &pending->ph;
+    uint8_t* bytes = pending->decrypted_data->data;
+    size_t length = ph->offset + ph->payload_length;
+    size_t decoded = pending->job.result;
+
+    if (ph->l_cid != NULL) {
+        /* The local CID may have been retired while the job was pending */
+        ph->l_cid = picoquic_find_local_cnxid(cnx, &ph->dest_cnx_id);
+        if (ph->l_cid == NULL) {
+            ret = PICOQUIC_ERROR_CNXID_CHECK;
+        }
+    }
+
+    if (ret == 0 && pending->is_deferred) {
+        /* Packets queued after this one may have jobs that use the same keys */
+        picoquic_crypto_async_wait_cnx(cnx);
+        decoded = picoquic_remove_packet_protection(cnx, bytes, bytes, ph, current_time, &already_received);
+        /* Integrity failures are counted by "picoquic_remove_packet_protection" */
+        need_integrity_check = 0;
+    }
+    else if (ret == 0) {
+        picoquic_ack_context_t* ack_ctx = (cnx->is_multipath_enabled) ?
+            &ph->l_cid->ack_ctx : &cnx->ack_ctx[picoquic_packet_context_application];
+
+        if (pending->key_rotations == cnx->nb_crypto_key_rotations) {
+            if (decoded <= ph->payload_length && ph->pn64 < ack_ctx->crypto_rotation_sequence) {
+                ack_ctx->crypto_rotation_sequence = ph->pn64;
+            }
+        }
+        else if (pending->key_rotations + 1 != cnx->nb_crypto_key_rotations ||
+            current_time > cnx->crypto_rotation_time_guard ||
+            (ack_ctx->crypto_rotation_sequence != UINT64_MAX && ph->pn64 >= ack_ctx->crypto_rotation_sequence)) {
+            /* Not acceptable with the old key. Ignore the packet. */
+            decoded = ph->payload_length + 1;
+            need_integrity_check = 0;
+        }
+
+        if (decoded <= ph->payload_length) {
+            already_received = picoquic_is_pn_already_received(cnx, ph->pc, ph->l_cid, ph->pn64);
+        }
+    }
+
+    if (ret == 0) {
+        if (decoded <= ph->payload_length) {
+            if (already_received != 0) {
+                ret = PICOQUIC_ERROR_DUPLICATE;
+            }
+            else {
+                ph->payload_length = (uint16_t)decoded;
+            }
+        }
+        else {
+            if (need_integrity_check) {
+                cnx->crypto_failure_count++;
+                if (cnx->crypto_failure_count > picoquic_aead_integrity_limit(cnx->crypto_context[picoquic_epoch_1rtt].aead_decrypt)) {
+                    picoquic_log_app_message(cnx, "AEAD Integrity limit reached after 0x%" PRIx64 " failed decryptions.", cnx->crypto_failure_count);
+                    (void)picoquic_connection_error(cnx, PICOQUIC_TRANSPORT_AEAD_LIMIT_REACHED, 0);
+                }
+                picoquic_log_pn_dec_trial(cnx);
+            }
+
+            /* The checksum is not overwritten by the decryption in place */
+            if (length >= PICOQUIC_RESET_PACKET_MIN_SIZE &&
+                memcmp(bytes + length - PICOQUIC_RESET_SECRET_SIZE,
+                    cnx->path[0]->p_remote_cnxid->reset_secret, PICOQUIC_RESET_SECRET_SIZE) == 0) {
+                ret = PICOQUIC_ERROR_STATELESS_RESET;
+                picoquic_log_app_message(cnx, "Decrypt error, matching reset secret, ret = %d", ret);
+            }
+            else {
+                ret = PICOQUIC_ERROR_AEAD_CHECK;
+            }
+        }
+    }
+
+    return picoquic_incoming_decrypted_segment(cnx->quic, cnx, ret, ph, pending->decrypted_data, bytes, length,
+        pending->packet_length, length, (struct sockaddr*)&pending->addr_from, (struct sockaddr*)&pending->addr_to,
+        pending->if_index_to, pending->received_ecn, current_time, pending->receive_time, 0, 0, &first_cnx);
+}
+
+/* Process the packets whose decryption completed, in arrival order */
+void picoquic_process_pending_decryptions(picoquic_quic_t* quic, uint64_t current_time)
+{
+    (void)picoquic_crypto_async_collect(quic);
+
+    while (quic->first_pending_decryption != NULL && quic->first_pending_decryption->is_done) {
+        picoquic_pending_decryption_t* pending = quic->first_pending_decryption;
+
+        quic->first_pending_decryption = pending->next_pending;
+        if (quic->first_pending_decryption == NULL) {
+            quic->last_pending_decryption = NULL;
+        }
+        pending->cnx->nb_pending_decryptions--;
+        (void)picoquic_incoming_pending_decryption(pending, current_time);
+        free(pending);
+    }
+}
+
+/*
+* Processing of the packet that was just received from the network.
+*/
+
+int picoquic_incoming_segment(
+    picoquic_quic_t* quic,
+    uint8_t* raw_bytes,
+    size_t length,
+    size_t packet_length,
+    size_t* consumed,
+    struct sockaddr* addr_from,
+    struct sockaddr* addr_to,
+    int if_index_to,
+    unsigned char received_ecn,
+    uint64_t current_time,
+    uint64_t receive_time,
+    picoquic_connection_id_t* previous_dest_id,
+    picoquic_cnx_t** first_cnx)
+{
+    int ret = 0;
+    picoquic_cnx_t* cnx = NULL;
+    picoquic_packet_header ph;
+    int new_context_created = 0;
+    int is_first_segment = 0;
+    uint8_t* bytes = NULL;
+    picoquic_stream_data_node_t* decrypted_data = picoquic_stream_data_node_alloc(quic);
+    PICOQUIC_PROFILE_BEGIN(quic, profile_start);
+
+    if (decrypted_data == NULL) {
+        return -1;
+    }
+    /* Parse the header and decrypt the segment */
+    ret = picoquic_parse_header_and_decrypt(quic, raw_bytes, length, packet_length, addr_from,
+        current_time, decrypted_data, &ph, &cnx, consumed, &new_context_created);
+    bytes = decrypted_data->data;
+
+    /* Verify that the segment coalescing is for the same destination ID */
+    if (picoquic_is_connection_id_null(previous_dest_id)) {
+        /* This is the first segment in the incoming packet */
+        *previous_dest_id = ph.dest_cnx_id;
+        is_first_segment = 1;
+        *first_cnx = cnx;
+
+
+        /* if needed, log that the packet is received */
+        if (cnx != NULL) {
+            picoquic_log_pdu(cnx, 1, current_time, addr_from, addr_to, packet_length);
+        }
+        else {
+            picoquic_log_quic_pdu(quic, 1, current_time, picoquic_val64_connection_id(ph.dest_cnx_id),
+                addr_from, addr_to, packet_length);
+        }
+    }
+    else {
+        if (ret == 0 && picoquic_compare_connection_id(previous_dest_id, &ph.dest_cnx_id) != 0) {
+            ret = PICOQUIC_ERROR_CNXID_SEGMENT;
+        }
+        else if (ret == PICOQUIC_ERROR_VERSION_NOT_SUPPORTED) {
+            /* A coalesced packet with unknown version is likely some kind of padding */
+            ret = PICOQUIC_ERROR_CNXID_SEGMENT;
+        }
+
+        if (ret == PICOQUIC_ERROR_CNXID_SEGMENT && *first_cnx != cnx && *first_cnx != NULL) {
+            /* Log the drop segment information in the context of the first connection */
+            picoquic_log_dropped_packet(*first_cnx, NULL, &ph, length, ret, bytes, current_time);
+        }
+    }
+
+    if (ret == PICOQUIC_ERROR_DECRYPTION_PENDING) {
+        /* The 1-RTT packet will be processed once the provider has decrypted it */
+        ret = picoquic_submit_pending_decryption(cnx, raw_bytes, &ph, decrypted_data, addr_from, addr_to,
+            if_index_to, received_ecn, packet_length, current_time, receive_time);
+    }
+    else {
+        ret = picoquic_incoming_decrypted_segment(quic, cnx, ret, &ph, decrypted_data, raw_bytes, length, packet_length,
+            *consumed, addr_from, addr_to, if_index_to, received_ecn, current_time, receive_time, is_first_segment,
+            new_context_created, first_cnx);
+    }
+
+    PICOQUIC_PROFILE_END(quic, profile_start, picoquic_profile_incoming_segment);
+
+    return ret;
+}
+
 int picoquic_incoming_packet_ex(
     picoquic_quic_t* quic,
     uint8_t* bytes,
@@ -2417,12 +3037,23 @@ int picoquic_incoming_packet_ex(
     size_t consumed_index = 0;
     int ret = 0;
     picoquic_connection_id_t previous_destid = picoquic_null_connection_id;
+    PICOQUIC_PROFILE_BEGIN(quic, profile_start);
+
+    PICOQUIC_METRICS_INC(quic, picoquic_metric_packets_in);
+    PICOQUIC_METRICS_ADD(quic, picoquic_metric_bytes_in, packet_length);
+    PICOQUIC_PROFILE_PACKETS_IN(quic, 1);
 
     if (!quic->is_port_blocking_disabled && picoquic_check_addr_blocked(addr_from)) {
         /* if the port is blocked, do not process the packet */
+        PICOQUIC_METRICS_INC(quic, picoquic_metric_drop_blocked);
         return 0;
     }
 
+    if (quic->first_pending_decryption != NULL) {
+        /* Process the packets that arrived earlier first */
+        picoquic_process_pending_decryptions(quic, current_time);
+    }
+
 
     while (consumed_index < packet_length) {
         size_t consumed = 0;
@@ -2448,6 +3079,8 @@ int picoquic_incoming_packet_ex(
         (*first_cnx)->max_mtu_received = packet_length;
     }
 
+    PICOQUIC_PROFILE_END(quic, profile_start, picoquic_profile_incoming_packet);
+
     return ret;
 }
 
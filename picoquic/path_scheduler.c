@@ -0,0 +1,265 @@
+/* Multipath schedulers.
+ *
+ * The stack calls the scheduler of the connection each time a packet is prepared
+ * while several paths are in use. The candidate paths are those that are validated,
+ * not demoted, and at the highest priority level; for each of them, the stack tells
+ * whether pacing and congestion control allow sending. The scheduler returns the
+ * index of the candidate on which the next packet shall be sent.
+ *
+ * If no candidate can send data, most schedulers still return a path that is not
+ * blocked by pacing, so that acknowledgements and control frames can be sent.
+ *
+ * - lru: the least recently used path among those that can send, with the lowest
+ *   RTT path preferred if an ACK is needed. This was the only policy before
+ *   schedulers were pluggable, and it remains the default.
+ * - minrtt: the path with the lowest smoothed RTT among those that can send.
+ *   Good for interactive traffic when one path is much faster than the others.
+ * - weighted: round robin, weighted by the bandwidth estimate of each path. Each
+ *   path carries a virtual finish time, advanced by the transmission time of a
+ *   full size packet at the path rate, and the path with the lowest start time is
+ *   served. This spreads bulk transfers in proportion to the path capacities.
+ * - redundant: minrtt for the data, but every datagram frame is also queued on all
+ *   the other candidate paths. The receiver gets the copy that arrives first (and
+ *   the others, which the application must ignore). Used for latency critical
+ *   datagrams over unreliable links.
+ * - ecf: earliest completion first. Estimates when a full size packet would reach
+ *   the peer on each path, including the wait for the congestion window to open,
+ *   and picks the earliest even if that path is currently blocked. This avoids
+ *   sending the tail of a transfer on a slow path while a fast one is about to be
+ *   available.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "picoquic_internal.h"
+
+#define PICOQUIC_LRU_SCHEDULER_ID "lru"
+#define PICOQUIC_MINRTT_SCHEDULER_ID "minrtt"
+#define PICOQUIC_WEIGHTED_SCHEDULER_ID "weighted"
+#define PICOQUIC_REDUNDANT_SCHEDULER_ID "redundant"
+#define PICOQUIC_ECF_SCHEDULER_ID "ecf"
+
+/* Estimate the data rate of a path in bytes per second */
+static uint64_t picoquic_path_scheduler_rate(picoquic_path_t* path_x)
+{
+    uint64_t rate = path_x->bandwidth_estimate;
+
+    if (rate == 0) {
+        rate = path_x->pacing_rate;
+    }
+    if (rate == 0 && path_x->smoothed_rtt > 0) {
+        rate = (path_x->cwin * 1000000) / path_x->smoothed_rtt;
+    }
+    if (rate == 0) {
+        rate = 1;
+    }
+
+    return rate;
+}
+
+/* Lowest smoothed RTT among the candidates that can send data, or if there are none,
+ * among the candidates that are not blocked by pacing.
+ */
+static int picoquic_minrtt_pick(picoquic_path_candidate_t const* candidates, int nb_candidates)
+{
+    int selected_cwin = -1;
+    int selected_pacing = -1;
+
+    for (int k = 0; k < nb_candidates; k++) {
+        if (candidates[k].is_cwin_ok) {
+            if (selected_cwin < 0 ||
+                candidates[k].path_x->smoothed_rtt < candidates[selected_cwin].path_x->smoothed_rtt) {
+                selected_cwin = k;
+            }
+        }
+        else if (candidates[k].is_pacing_ok) {
+            if (selected_pacing < 0 ||
+                candidates[k].path_x->smoothed_rtt < candidates[selected_pacing].path_x->smoothed_rtt) {
+                selected_pacing = k;
+            }
+        }
+    }
+
+    return (selected_cwin >= 0) ? selected_cwin : selected_pacing;
+}
+
+static int picoquic_lru_select(picoquic_cnx_t* cnx, picoquic_path_candidate_t const* candidates, int nb_candidates,
+    int is_ack_needed, uint64_t current_time)
+{
+    int data_path_cwin = -1;
+    int data_path_pacing = -1;
+    int i_min_rtt = -1;
+    int is_min_rtt_pacing_ok = 0;
+    uint64_t last_sent_pacing = UINT64_MAX;
+    uint64_t last_sent_cwin = UINT64_MAX;
+    int selected;
+
+    for (int k = 0; k < nb_candidates; k++) {
+        picoquic_path_t* path_x = candidates[k].path_x;
+
+        if (i_min_rtt < 0 || path_x->rtt_min < candidates[i_min_rtt].path_x->rtt_min) {
+            i_min_rtt = k;
+            is_min_rtt_pacing_ok = 0;
+        }
+        if (candidates[k].is_pacing_ok) {
+            if (path_x->last_sent_time < last_sent_pacing) {
+                last_sent_pacing = path_x->last_sent_time;
+                data_path_pacing = k;
+                if (k == i_min_rtt) {
+                    is_min_rtt_pacing_ok = 1;
+                }
+            }
+            if (candidates[k].is_cwin_ok && path_x->last_sent_time < last_sent_cwin) {
+                last_sent_cwin = path_x->last_sent_time;
+                data_path_cwin = k;
+            }
+        }
+    }
+
+    if (is_ack_needed && is_min_rtt_pacing_ok) {
+        selected = i_min_rtt;
+    }
+    else if (data_path_cwin >= 0) {
+        selected = data_path_cwin;
+    }
+    else {
+        selected = data_path_pacing;
+    }
+
+    return selected;
+}
+
+static int picoquic_minrtt_select(picoquic_cnx_t* cnx, picoquic_path_candidate_t const* candidates, int nb_candidates,
+    int is_ack_needed, uint64_t current_time)
+{
+    return picoquic_minrtt_pick(candidates, nb_candidates);
+}
+
+static int picoquic_weighted_select(picoquic_cnx_t* cnx, picoquic_path_candidate_t const* candidates, int nb_candidates,
+    int is_ack_needed, uint64_t current_time)
+{
+    int selected = -1;
+    uint64_t selected_start = UINT64_MAX;
+
+    for (int k = 0; k < nb_candidates; k++) {
+        if (candidates[k].is_cwin_ok) {
+            /* A path that was idle restarts from the current virtual clock, instead of claiming its past share */
+            uint64_t start = candidates[k].path_x->sched_virtual_time;
+            if (start < cnx->path_sched_virtual_clock) {
+                start = cnx->path_sched_virtual_clock;
+            }
+            if (start < selected_start) {
+                selected_start = start;
+                selected = k;
+            }
+        }
+    }
+
+    if (selected >= 0) {
+        picoquic_path_t* path_x = candidates[selected].path_x;
+        uint64_t rate = picoquic_path_scheduler_rate(path_x);
+
+        cnx->path_sched_virtual_clock = selected_start;
+        path_x->sched_virtual_time = selected_start + (path_x->send_mtu * 1000000) / rate;
+    }
+    else {
+        selected = picoquic_minrtt_pick(candidates, nb_candidates);
+    }
+
+    return selected;
+}
+
+static int picoquic_redundant_select(picoquic_cnx_t* cnx, picoquic_path_candidate_t const* candidates, int nb_candidates,
+    int is_ack_needed, uint64_t current_time)
+{
+    /* Serve the pending copies first, they are only useful if they arrive early */
+    for (int k = 0; k < nb_candidates; k++) {
+        if (candidates[k].is_cwin_ok && candidates[k].path_x->first_redundant_datagram != NULL) {
+            return k;
+        }
+    }
+
+    return picoquic_minrtt_pick(candidates, nb_candidates);
+}
+
+static void picoquic_redundant_datagram_sent(picoquic_cnx_t* cnx, picoquic_path_t* path_x,
+    const uint8_t* bytes, size_t length, uint64_t current_time)
+{
+    for (int k = 0; k < cnx->nb_path_sched_candidates; k++) {
+        picoquic_path_t* other_path = cnx->path[cnx->path_sched_candidates[k]];
+
+        if (other_path != path_x) {
+            if (picoquic_queue_redundant_datagrams(cnx, other_path, bytes, length) != 0) {
+                DBG_PRINTF("Cannot queue %zu bytes of datagrams on path %d", length, cnx->path_sched_candidates[k]);
+            }
+        }
+    }
+}
+
+static int picoquic_ecf_select(picoquic_cnx_t* cnx, picoquic_path_candidate_t const* candidates, int nb_candidates,
+    int is_ack_needed, uint64_t current_time)
+{
+    int selected = -1;
+    uint64_t selected_completion = UINT64_MAX;
+
+    for (int k = 0; k < nb_candidates; k++) {
+        if (candidates[k].is_pacing_ok) {
+            picoquic_path_t* path_x = candidates[k].path_x;
+            uint64_t rate = picoquic_path_scheduler_rate(path_x);
+            uint64_t completion = path_x->smoothed_rtt / 2 + (path_x->send_mtu * 1000000) / rate;
+
+            if (!candidates[k].is_cwin_ok) {
+                /* Wait until enough data is acknowledged to open the window */
+                uint64_t excess = path_x->bytes_in_transit + path_x->send_mtu - path_x->cwin;
+                completion += (excess * 1000000) / rate;
+            }
+            if (completion < selected_completion) {
+                selected_completion = completion;
+                selected = k;
+            }
+        }
+    }
+
+    if (selected >= 0 && !candidates[selected].is_cwin_ok && is_ack_needed) {
+        /* Acknowledgements cannot wait for the window to open */
+        selected = picoquic_minrtt_pick(candidates, nb_candidates);
+    }
+
+    return selected;
+}
+
+picoquic_path_scheduler_t picoquic_lru_path_scheduler_struct = {
+    PICOQUIC_LRU_SCHEDULER_ID, PICOQUIC_PATH_SCHEDULER_NUMBER_LRU,
+    picoquic_lru_select,
+    NULL
+};
+
+picoquic_path_scheduler_t picoquic_minrtt_path_scheduler_struct = {
+    PICOQUIC_MINRTT_SCHEDULER_ID, PICOQUIC_PATH_SCHEDULER_NUMBER_MINRTT,
+    picoquic_minrtt_select,
+    NULL
+};
+
+picoquic_path_scheduler_t picoquic_weighted_path_scheduler_struct = {
+    PICOQUIC_WEIGHTED_SCHEDULER_ID, PICOQUIC_PATH_SCHEDULER_NUMBER_WEIGHTED,
+    picoquic_weighted_select,
+    NULL
+};
+
+picoquic_path_scheduler_t picoquic_redundant_path_scheduler_struct = {
+    PICOQUIC_REDUNDANT_SCHEDULER_ID, PICOQUIC_PATH_SCHEDULER_NUMBER_REDUNDANT,
+    picoquic_redundant_select,
+    picoquic_redundant_datagram_sent
+};
+
+picoquic_path_scheduler_t picoquic_ecf_path_scheduler_struct = {
+    PICOQUIC_ECF_SCHEDULER_ID, PICOQUIC_PATH_SCHEDULER_NUMBER_ECF,
+    picoquic_ecf_select,
+    NULL
+};
+
+picoquic_path_scheduler_t* picoquic_lru_path_scheduler = &picoquic_lru_path_scheduler_struct;
+picoquic_path_scheduler_t* picoquic_minrtt_path_scheduler = &picoquic_minrtt_path_scheduler_struct;
+picoquic_path_scheduler_t* picoquic_weighted_path_scheduler = &picoquic_weighted_path_scheduler_struct;
+picoquic_path_scheduler_t* picoquic_redundant_path_scheduler = &picoquic_redundant_path_scheduler_struct;
+picoquic_path_scheduler_t* picoquic_ecf_path_scheduler = &picoquic_ecf_path_scheduler_struct;
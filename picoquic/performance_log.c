@@ -64,6 +64,7 @@ typedef struct st_picoquic_performance_log_ctx_t {
     struct st_picoquic_performance_log_item_t* first;
     struct st_picoquic_performance_log_item_t* last;
     char const* perflog_file_name;
+    int log_limit_time;
 } picoquic_performance_log_ctx_t;
 
 void picoquic_perflog_item_free(picoquic_performance_log_item_t* perflog_item)
@@ -91,7 +92,8 @@ int picoquic_perflog_save(picoquic_performance_log_ctx_t* perflog_ctx)
                 perflog_ctx->last = NULL;
             }
             /* Print version identifiers */
-            fprintf(F, "%d, %s, ", PICOQUIC_PER_LOG_VERSION, PICOQUIC_VERSION);
+            fprintf(F, "%d, %s, ", (perflog_ctx->log_limit_time) ? PICOQUIC_PER_LOG_VERSION_LIMIT_TIME : PICOQUIC_PER_LOG_VERSION,
+                PICOQUIC_VERSION);
             /* Print the key performance data */
             fprintf(F, "%f, %" PRIu64 ", %" PRIu64 ", %f, %f",
                 perflog_item->duration_sec,
@@ -157,7 +159,7 @@ int picoquic_perflog_record(picoquic_cnx_t* cnx, picoquic_performance_log_ctx_t*
         perflog_item->cnxid = picoquic_get_logging_cnxid(cnx);
         perflog_item->cnx_time_64 = start_time;
         /* Store additional parameters */
-        perflog_item->nb_values = PICOQUIC_PERF_LOG_MAX_ITEMS;
+        perflog_item->nb_values = (perflog_ctx->log_limit_time) ? PICOQUIC_PERF_LOG_MAX_ITEMS : PICOQUIC_PERF_LOG_V1_ITEMS;
         perflog_item->v[picoquic_perflog_is_client] = cnx->client_mode;
         perflog_item->v[picoquic_perflog_nb_packets_received] = cnx->nb_packets_received;
         perflog_item->v[picoquic_perflog_nb_trains_sent] = cnx->nb_trains_sent;
@@ -166,6 +168,10 @@ int picoquic_perflog_record(picoquic_cnx_t* cnx, picoquic_performance_log_ctx_t*
         perflog_item->v[picoquic_perflog_nb_trains_blocked_pacing] = cnx->nb_trains_blocked_pacing;
         perflog_item->v[picoquic_perflog_nb_trains_blocked_others] = cnx->nb_trains_blocked_others;
         perflog_item->v[picoquic_perflog_nb_packets_sent] = cnx->nb_packets_sent;
+        perflog_item->v[picoquic_perflog_nb_trains_built] = cnx->nb_trains_built;
+        perflog_item->v[picoquic_perflog_nb_train_packets] = cnx->nb_train_packets;
+        perflog_item->v[picoquic_perflog_nb_train_packets_planned] = cnx->nb_train_packets_planned;
+        perflog_item->v[picoquic_perflog_train_length_max] = cnx->train_length_max;
         perflog_item->v[picoquic_perflog_nb_retransmission_total] = cnx->nb_retransmission_total;
         perflog_item->v[picoquic_perflog_nb_spurious] = cnx->nb_spurious;
         perflog_item->v[picoquic_perflog_delayed_ack_option] = cnx->is_ack_frequency_negotiated;
@@ -189,6 +195,10 @@ int picoquic_perflog_record(picoquic_cnx_t* cnx, picoquic_performance_log_ctx_t*
         if (cnx->congestion_alg != NULL) {
             perflog_item->v[picoquic_perflog_ccalgo] = cnx->congestion_alg->congestion_algorithm_number;
         }
+        for (int i = 0; i < picoquic_limit_max; i++) {
+            perflog_item->v[picoquic_perflog_time_handshake + i] =
+                picoquic_get_limit_time(cnx, (picoquic_limit_state_enum)i, close_time);
+        }
         
         if (perflog_ctx->first == NULL) {
             perflog_ctx->first = perflog_item;
@@ -270,6 +280,19 @@ const char* picoquic_perflog_param_name(picoquic_perflog_column_enum rank)
     case picoquic_perflog_bwe_max: return("bwe_max");
     case picoquic_perflog_pacing_quantum_max: return("p_quantum");
     case picoquic_perflog_pacing_rate: return("p_rate");
+    case picoquic_perflog_nb_trains_built: return("trains_b");
+    case picoquic_perflog_nb_train_packets: return("train_pkts");
+    case picoquic_perflog_nb_train_packets_planned: return("train_plan");
+    case picoquic_perflog_train_length_max: return("train_max");
+    case picoquic_perflog_time_handshake: return("t_handshake");
+    case picoquic_perflog_time_amplification: return("t_amplif");
+    case picoquic_perflog_time_not_limited: return("t_not_lim");
+    case picoquic_perflog_time_app_limited: return("t_app");
+    case picoquic_perflog_time_cwin_limited: return("t_cwin");
+    case picoquic_perflog_time_pacing_limited: return("t_pacing");
+    case picoquic_perflog_time_flow_limited: return("t_flow");
+    case picoquic_perflog_time_stream_limited: return("t_stream");
+    case picoquic_perflog_time_closing: return("t_closing");
     default:
         break;
     }
@@ -295,7 +318,7 @@ int picoquic_perflog_file_is_empty(char const* perflog_file_name)
     return (is_empty);
 }
 
-void picoquic_perflog_file_set_header(char const* perflog_file_name)
+void picoquic_perflog_file_set_header(char const* perflog_file_name, size_t nb_values)
 {
     FILE* F = picoquic_file_open(perflog_file_name, "w");
 
@@ -303,7 +326,7 @@ void picoquic_perflog_file_set_header(char const* perflog_file_name)
         fprintf(F, "Log_v, PQ_v, Duration, Sent, Received, Mpbs_S, Mbps_R");
         fprintf(F, ", QUIC_v, ALPN, CNX_ID, T64");
         /* Print the additional values */
-        for (size_t i = 0; i < PICOQUIC_PERF_LOG_MAX_ITEMS; i++) {
+        for (size_t i = 0; i < nb_values; i++) {
             char buf[16];
             char const* s = picoquic_perflog_param_name((picoquic_perflog_column_enum)i);
             if (s == NULL) {
@@ -317,7 +340,7 @@ void picoquic_perflog_file_set_header(char const* perflog_file_name)
     }
 }
 
-int picoquic_perflog_setup(picoquic_quic_t* quic, char const * perflog_file_name)
+int picoquic_perflog_setup_ex(picoquic_quic_t* quic, char const * perflog_file_name, int log_limit_time)
 {
     int ret = 0;
     picoquic_performance_log_ctx_t* perflog_ctx = (picoquic_performance_log_ctx_t*)
@@ -327,6 +350,7 @@ int picoquic_perflog_setup(picoquic_quic_t* quic, char const * perflog_file_name
     }
     else {
         memset(perflog_ctx, 0, sizeof(picoquic_performance_log_ctx_t));
+        perflog_ctx->log_limit_time = log_limit_time;
         perflog_ctx->perflog_file_name = picoquic_string_duplicate(perflog_file_name);
         if (perflog_ctx->perflog_file_name == NULL) {
             free(perflog_ctx);
@@ -334,7 +358,8 @@ int picoquic_perflog_setup(picoquic_quic_t* quic, char const * perflog_file_name
         } else {
             /* If the file is empty, add a description string, so CSV looks good */
             if (picoquic_perflog_file_is_empty(perflog_file_name)) {
-                picoquic_perflog_file_set_header(perflog_file_name);
+                picoquic_perflog_file_set_header(perflog_file_name,
+                    (log_limit_time) ? PICOQUIC_PERF_LOG_MAX_ITEMS : PICOQUIC_PERF_LOG_V1_ITEMS);
             }
             /* Program the QUIC context to produce performance logs */
             quic->perflog_fn = picoquic_perflog;
@@ -342,4 +367,9 @@ int picoquic_perflog_setup(picoquic_quic_t* quic, char const * perflog_file_name
         }
     }
     return ret;
-}
\ No newline at end of file
+}
+
+int picoquic_perflog_setup(picoquic_quic_t* quic, char const* perflog_file_name)
+{
+    return picoquic_perflog_setup_ex(quic, perflog_file_name, 0);
+}
@@ -26,7 +26,9 @@ extern "C" {
 #endif
 
 #define PICOQUIC_PER_LOG_VERSION 1
-#define PICOQUIC_PERF_LOG_MAX_ITEMS 27
+#define PICOQUIC_PER_LOG_VERSION_LIMIT_TIME 2
+#define PICOQUIC_PERF_LOG_V1_ITEMS 27
+#define PICOQUIC_PERF_LOG_MAX_ITEMS 40
 
 typedef enum {
     picoquic_perflog_is_client = 0,
@@ -55,12 +57,33 @@ typedef enum {
     picoquic_perflog_ccalgo = 23,
     picoquic_perflog_bwe_max = 24,
     picoquic_perflog_pacing_quantum_max = 25,
-    picoquic_perflog_pacing_rate = 26
+    picoquic_perflog_pacing_rate = 26,
+    picoquic_perflog_nb_trains_built = 27,
+    picoquic_perflog_nb_train_packets = 28,
+    picoquic_perflog_nb_train_packets_planned = 29,
+    picoquic_perflog_train_length_max = 30,
+    picoquic_perflog_time_handshake = 31,
+    picoquic_perflog_time_amplification = 32,
+    picoquic_perflog_time_not_limited = 33,
+    picoquic_perflog_time_app_limited = 34,
+    picoquic_perflog_time_cwin_limited = 35,
+    picoquic_perflog_time_pacing_limited = 36,
+    picoquic_perflog_time_flow_limited = 37,
+    picoquic_perflog_time_stream_limited = 38,
+    picoquic_perflog_time_closing = 39
 } picoquic_perflog_column_enum;
 
 const char* picoquic_perflog_param_name(picoquic_perflog_column_enum rank);
 
 int picoquic_perflog_setup(picoquic_quic_t* quic, char const* perflog_file_name);
+/* Same, but if log_limit_time is set the log uses version 2 of the format.
+ * Version 2 adds the packet train statistics in columns 27 to 30, and the
+ * time in microseconds spent in each of the limiting states of the sender
+ * in columns 31 to 39. The header of the file is only written when the file
+ * is empty, so the version 1 format remains the default, and files that were
+ * started with it are not broken.
+ */
+int picoquic_perflog_setup_ex(picoquic_quic_t* quic, char const* perflog_file_name, int log_limit_time);
 
 #ifdef __cplusplus
 }
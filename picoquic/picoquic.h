@@ -102,6 +102,7 @@ extern "C" {
 #define PICOQUIC_ERROR_PACKET_WRONG_VERSION (PICOQUIC_ERROR_CLASS + 57)
 #define PICOQUIC_ERROR_PORT_BLOCKED (PICOQUIC_ERROR_CLASS + 58)
 #define PICOQUIC_ERROR_DATAGRAM_TOO_LONG (PICOQUIC_ERROR_CLASS + 59)
+#define PICOQUIC_ERROR_DECRYPTION_PENDING (PICOQUIC_ERROR_CLASS + 60)
 
 /*
  * Protocol errors defined in the QUIC spec
@@ -326,6 +327,7 @@ typedef struct st_picoquic_tp_t {
 */
 
 uint64_t picoquic_current_time(); /* wall time */
+uint64_t picoquic_cpu_cycles(); /* CPU cycle counter, for profiling */
 uint64_t picoquic_get_quic_time(picoquic_quic_t* quic); /* connection time, compatible with simulations */
 
 /* Callback function for providing stream data to the application,
@@ -502,6 +504,59 @@ int picoquic_set_low_memory_mode(picoquic_quic_t* quic, int low_memory_mode);
  * By default, the threshold is set to 128 connections.
  */
 void picoquic_set_cookie_mode(picoquic_quic_t* quic, int cookie_mode);
+void picoquic_set_max_half_open_retry_threshold(picoquic_quic_t* quic, uint32_t max_half_open_before_retry);
+uint32_t picoquic_get_max_half_open_retry_threshold(picoquic_quic_t* quic);
+
+/* Stateless pre-filter.
+ * Packet loops can call the pre-filter on each received datagram, before
+ * calling picoquic_incoming_packet_ex. The pre-filter is only active when
+ * the server requires retry tokens, either because of the cookie mode or
+ * because the number of half open connections exceeds the threshold. It
+ * then handles the packets that do not belong to an existing connection
+ * without creating connection contexts:
+ * - Initial packets without a token get a Retry,
+ * - Initial packets with an invalid token are dropped,
+ * - Long header packets with an unsupported version get a Version Negotiation,
+ * - Short header packets with an unknown CID get a Stateless Reset.
+ * Responses are subject to a per source address rate limit.
+ *
+ * If send_buffer is not NULL, the response is written in that buffer, and
+ * *send_length is set to its length, or 0 if there is no response. Otherwise,
+ * the response is queued in a preallocated ring of stateless packets, and
+ * dropped if the ring is full.
+ *
+ * Returns PICOQUIC_PREFILTER_PASS if the packet shall be processed by
+ * picoquic_incoming_packet_ex, PICOQUIC_PREFILTER_CONSUMED otherwise.
+ */
+#define PICOQUIC_PREFILTER_PASS 0
+#define PICOQUIC_PREFILTER_CONSUMED 1
+
+int picoquic_stateless_prefilter(picoquic_quic_t* quic, const uint8_t* bytes, size_t length,
+    const struct sockaddr* addr_from, const struct sockaddr* addr_to, int if_index_to,
+    uint64_t current_time, uint8_t* send_buffer, size_t send_buffer_max, size_t* send_length);
+
+/* Set the per source rate limit of stateless responses. Sources are identified
+ * by their IP address, hashed in a fixed size table, so sources that collide share
+ * the same budget. A rate of 0 disables the limit.
+ * The limit is disabled by default. Many legitimate clients can share a single
+ * address behind a NAT or a carrier grade NAT, and each of them needs a Retry
+ * before it can connect, so a low limit would drop their Initial packets.
+ * Servers that enable the limit should size it for the largest client population
+ * expected behind one address, e.g., several hundred responses per second.
+ */
+void picoquic_set_stateless_rate_limit(picoquic_quic_t* quic, uint32_t max_per_second, uint32_t max_burst);
+
+typedef struct st_picoquic_prefilter_stats_t {
+    uint64_t nb_passed;
+    uint64_t nb_retry;
+    uint64_t nb_version_negotiation;
+    uint64_t nb_stateless_reset;
+    uint64_t nb_invalid_token;
+    uint64_t nb_rate_limited;
+    uint64_t nb_dropped;
+} picoquic_prefilter_stats_t;
+
+void picoquic_get_prefilter_stats(picoquic_quic_t* quic, picoquic_prefilter_stats_t* stats);
 
 /* Set cipher suite, for tests. 
  * 0: default values
@@ -590,6 +645,37 @@ int picoquic_load_retry_tokens(picoquic_quic_t* quic, char const* token_store_fi
 int picoquic_save_session_tickets(picoquic_quic_t* quic, char const* ticket_store_filename);
 int picoquic_save_retry_tokens(picoquic_quic_t* quic, char const* token_store_filename);
 
+/* Shared session resumption cache.
+ * The cache can be shared by several QUIC contexts, e.g., one per lcore or one
+ * per process, so that resumption and 0-RTT work when a connection lands
+ * on a different shard than the one that issued the ticket. Servers use it to
+ * share the RTT and CWIN remembered for issued tickets; clients use it instead
+ * of the ticket list to store the tickets received from servers.
+ *
+ * The cache is a set associative hash table with LRU eviction in each set,
+ * allocated in shared memory. If shm_name is NULL, the memory is anonymous and can
+ * be shared by threads, or by processes forked after the creation. Otherwise, the
+ * named segment is created, or attached if another process already created it.
+ * The handle that created the named segment unlinks it when it is deleted.
+ * Lookups do not take locks; updates are serialized by a spin lock in the segment.
+ *
+ * If a log file is opened, each update is appended to the file, and the content
+ * of the file is replayed when it is opened. The file is written after the
+ * shared memory is updated and the spin lock released, so disk writes do not
+ * block the other users of the cache. The log is compacted when it becomes
+ * much larger than the cache.
+ *
+ * The cache is owned by the application, and must be deleted after all the
+ * QUIC contexts that use it.
+ */
+typedef struct st_picoquic_ticket_cache_t picoquic_ticket_cache_t;
+
+picoquic_ticket_cache_t* picoquic_ticket_cache_create(size_t nb_entries, char const* shm_name);
+void picoquic_ticket_cache_delete(picoquic_ticket_cache_t* cache);
+int picoquic_ticket_cache_open_log(picoquic_ticket_cache_t* cache, char const* log_file_name, uint64_t current_time);
+int picoquic_ticket_cache_compact_log(picoquic_ticket_cache_t* cache, uint64_t current_time);
+void picoquic_set_ticket_cache(picoquic_quic_t* quic, picoquic_ticket_cache_t* cache);
+
 /* Manage bdps */
 void picoquic_set_default_bdp_frame_option(picoquic_quic_t* quic, int enable_bdp_frame);
 
@@ -640,6 +726,33 @@ void picoquic_set_default_stateless_reset_min_interval(picoquic_quic_t* quic, ui
 void picoquic_set_max_simultaneous_logs(picoquic_quic_t* quic, uint32_t max_simultaneous_logs);
 uint32_t picoquic_get_max_simultaneous_logs(picoquic_quic_t* quic);
 
+/* Sampled and triggered logging of connections. These policies apply to the
+ * binary log, and to the qlog files derived from it.
+ * With sampling set to N > 1, only 1 in N connections is logged, selected
+ * by a hash of the initial connection ID so that client and server logs
+ * of the same connection are both kept or both dropped. The default is 1,
+ * log all connections. Setting 0 means that no connection is sampled,
+ * which is useful if only the flight recorder is wanted.
+ * Connections that are not sampled can still keep a "flight recorder" of
+ * their last nb_events log records in memory. These records are written
+ * to the log file only if one of the triggers in trigger_mask fires, after
+ * which the next nb_events records are logged as well. The low throughput
+ * trigger fires if the connection is congestion window limited while
+ * delivering less than min_throughput bytes per second.
+ * Setting nb_events to zero disables the flight recorder.
+ */
+typedef enum {
+    picoquic_log_trigger_spurious_burst = 1,
+    picoquic_log_trigger_rto = 2,
+    picoquic_log_trigger_idle_timeout = 4,
+    picoquic_log_trigger_handshake_failure = 8,
+    picoquic_log_trigger_low_throughput = 16,
+    picoquic_log_trigger_all = 31
+} picoquic_log_trigger_enum;
+
+void picoquic_set_log_sampling(picoquic_quic_t* quic, uint32_t one_in_n);
+void picoquic_set_flight_recorder(picoquic_quic_t* quic, size_t nb_events, uint32_t trigger_mask, uint64_t min_throughput);
+
 /* Connection context creation and registration */
 picoquic_cnx_t* picoquic_create_cnx(picoquic_quic_t* quic,
     picoquic_connection_id_t initial_cnx_id, picoquic_connection_id_t remote_cnx_id,
@@ -726,6 +839,34 @@ picoquic_cnx_t* picoquic_get_earliest_cnx_to_wake(picoquic_quic_t* quic, uint64_
 
 uint64_t picoquic_get_next_wake_time(picoquic_quic_t* quic, uint64_t current_time);
 
+/* Context wide pacing scheduler.
+ * When enabled, connections that must wake up within the wheel horizon
+ * (nb_slots * slot_usec) are binned in a timing wheel instead of the wake
+ * time tree. Each call to picoquic_prepare_next_packet_ex drains the slots
+ * that are due, and serves the connections in slot order. Connections are
+ * never served before their wake time, and at most one slot late unless the
+ * loop itself is late. The departure statistics compare the scheduled wake
+ * time with the actual time at which a packet was prepared.
+ * Setting slot_usec to 0 disables the wheel. The number of slots is rounded
+ * up to a multiple of 64.
+ */
+#define PICOQUIC_PACING_WHEEL_SLOT_USEC_DEFAULT 16
+#define PICOQUIC_PACING_WHEEL_NB_SLOTS_DEFAULT 4096
+#define PICOQUIC_PACING_WHEEL_HISTOGRAM_SIZE 8
+
+typedef struct st_picoquic_pacing_wheel_stats_t {
+    uint64_t nb_scheduled; /* Number of insertions in the wheel */
+    uint64_t nb_departures; /* Packets prepared for connections that were due */
+    uint64_t nb_early; /* Packets prepared before the scheduled time, e.g., after a packet arrival */
+    uint64_t lateness_sum; /* Sum of (departure - scheduled), microseconds */
+    uint64_t lateness_max;
+    /* Bucket i counts the departures with lateness < (slot_usec << i), last bucket counts the others */
+    uint64_t lateness_histogram[PICOQUIC_PACING_WHEEL_HISTOGRAM_SIZE];
+} picoquic_pacing_wheel_stats_t;
+
+int picoquic_enable_pacing_wheel(picoquic_quic_t* quic, uint64_t slot_usec, size_t nb_slots);
+void picoquic_get_pacing_wheel_stats(picoquic_quic_t* quic, picoquic_pacing_wheel_stats_t* stats);
+
 picoquic_state_enum picoquic_get_cnx_state(picoquic_cnx_t* cnx);
 
 void picoquic_cnx_set_padding_policy(picoquic_cnx_t * cnx, uint32_t padding_multiple, uint32_t padding_minsize);
@@ -1019,6 +1160,17 @@ void picoquic_set_optimistic_ack_policy(picoquic_quic_t* quic, uint32_t sequence
 void picoquic_set_preemptive_repeat_policy(picoquic_quic_t* quic, int do_repeat);
 void picoquic_set_preemptive_repeat_per_cnx(picoquic_cnx_t* cnx, int do_repeat);
 
+/* Enable or disable ACK frequency autotuning. When the ACK frequency extension is
+ * negotiated, the ACK gap requested from the peer is increased at high packet rates,
+ * as long as there are enough ACKs per RTT for loss recovery. More ACKs per RTT are
+ * kept after reordering was observed, and the default gap is used in slow start and
+ * for one RTT after a loss. If "ack_cycles_budget" is not zero, the CPU cycles spent
+ * processing each ACK are measured, and the gap is set so ACK processing does not
+ * use more than that many cycles per second.
+ */
+void picoquic_set_default_ack_autotune(picoquic_quic_t* quic, int is_enabled, uint64_t ack_cycles_budget);
+void picoquic_set_ack_autotune(picoquic_cnx_t* cnx, int is_enabled, uint64_t ack_cycles_budget);
+
 /* Enables keep alive for a connection.
  * Keep alive interval is expressed in microseconds.
  * If `interval` is `0`, it is set to `idle_timeout / 2`.
@@ -1047,6 +1199,32 @@ uint64_t picoquic_get_data_sent(picoquic_cnx_t * cnx);
 
 uint64_t picoquic_get_data_received(picoquic_cnx_t * cnx);
 
+/* Time accounting of the sender. Each time the connection is polled for
+ * sending, the time since the previous poll is attributed to the state
+ * that was limiting the sender after that poll: no limit (data was sent),
+ * nothing queued by the application, congestion window full, pacing,
+ * connection or stream flow control, amplification limit before the
+ * path is validated, handshake not complete, or connection closing.
+ * Comparing these values tells whether a slow transfer should be fixed
+ * by tuning congestion control, buffer sizes, or the application.
+ */
+typedef enum {
+    picoquic_limit_handshake = 0,
+    picoquic_limit_amplification,
+    picoquic_limit_none,
+    picoquic_limit_application,
+    picoquic_limit_cwin,
+    picoquic_limit_pacing,
+    picoquic_limit_flow_control,
+    picoquic_limit_stream_flow_control,
+    picoquic_limit_closing,
+    picoquic_limit_max
+} picoquic_limit_state_enum;
+
+/* Returns the time in microseconds spent in the specified state, up to current_time */
+uint64_t picoquic_get_limit_time(picoquic_cnx_t* cnx, picoquic_limit_state_enum state, uint64_t current_time);
+char const* picoquic_limit_state_name(picoquic_limit_state_enum state);
+
 int picoquic_cnx_is_still_logging(picoquic_cnx_t* cnx);
 
 /* Congestion algorithm definition */
@@ -1074,6 +1252,33 @@ typedef void (*picoquic_congestion_algorithm_notify)(
     uint64_t nb_bytes_acknowledged,
     uint64_t lost_packet_number,
     uint64_t current_time);
+/* Aggregated acknowledgement event. When the algorithm provides "alg_notify_ack",
+ * the stack delivers one such event per path after processing all the ACK frames
+ * in a received packet, instead of one "acknowledgement" notification per acked
+ * packet followed by "ecn_ec", "rtt_measurement" and "bw_measurement". The other
+ * notifications (losses, timeouts, spurious repeats, etc.) still use alg_notify.
+ */
+typedef struct st_picoquic_per_ack_state_t {
+    uint64_t rtt_measurement; /* latest RTT sample of the path, may be from a previous ACK */
+    uint64_t one_way_delay; /* latest one way delay sample, if time stamps are enabled */
+    uint64_t rtt_min;
+    uint64_t nb_bytes_acknowledged;
+    uint64_t nb_packets_acknowledged;
+    uint64_t delivery_rate; /* bytes per second */
+    uint64_t ecn_ect0_delta;
+    uint64_t ecn_ect1_delta;
+    uint64_t ecn_ce_delta;
+    uint64_t ecn_packet_number; /* last packet number received when the CE count increased */
+    unsigned int is_rtt_updated : 1; /* a new RTT sample was obtained from this ACK */
+    unsigned int is_delivery_rate_sampled : 1; /* delivery rate was estimated from this ACK */
+    unsigned int is_app_limited : 1;
+} picoquic_per_ack_state_t;
+
+typedef void (*picoquic_congestion_algorithm_notify_ack)(
+    picoquic_cnx_t* cnx,
+    picoquic_path_t* path_x,
+    picoquic_per_ack_state_t const* ack_state,
+    uint64_t current_time);
 typedef void (*picoquic_congestion_algorithm_delete)(picoquic_path_t* cnx);
 typedef void (*picoquic_congestion_algorithm_observe)(
     picoquic_path_t* path_x, uint64_t * cc_state, uint64_t * cc_param);
@@ -1085,6 +1290,8 @@ typedef struct st_picoquic_congestion_algorithm_t {
     picoquic_congestion_algorithm_notify alg_notify;
     picoquic_congestion_algorithm_delete alg_delete;
     picoquic_congestion_algorithm_observe alg_observe;
+    int use_l4s_ecn; /* Packets are marked ECT(1) instead of ECT(0) */
+    picoquic_congestion_algorithm_notify_ack alg_notify_ack; /* Optional, NULL for per event notifications */
 } picoquic_congestion_algorithm_t;
 
 extern picoquic_congestion_algorithm_t* picoquic_newreno_algorithm;
@@ -1092,6 +1299,21 @@ extern picoquic_congestion_algorithm_t* picoquic_cubic_algorithm;
 extern picoquic_congestion_algorithm_t* picoquic_dcubic_algorithm;
 extern picoquic_congestion_algorithm_t* picoquic_fastcc_algorithm;
 extern picoquic_congestion_algorithm_t* picoquic_bbr_algorithm;
+extern picoquic_congestion_algorithm_t* picoquic_prague_algorithm;
+extern picoquic_congestion_algorithm_t* picoquic_bbr3_algorithm;
+
+/* ECN codepoints, as set in the two low order bits of the IPv4 TOS or IPv6 traffic class */
+#define PICOQUIC_ECN_NOT_ECT 0x00
+#define PICOQUIC_ECN_ECT_0 0x02
+#define PICOQUIC_ECN_ECT_1 0x01
+#define PICOQUIC_ECN_CE 0x03
+
+/* ECN codepoint to set on the packets sent for the connection, typically the
+ * last connection returned by picoquic_prepare_next_packet_ex. Scalable
+ * congestion controllers such as Prague use ECT(1), the others ECT(0).
+ * Stateless packets (cnx == NULL) use ECT(0).
+ */
+uint8_t picoquic_get_ecn_codepoint(picoquic_cnx_t* cnx);
 
 #define PICOQUIC_DEFAULT_CONGESTION_ALGORITHM picoquic_newreno_algorithm;
 
@@ -1103,6 +1325,67 @@ void picoquic_set_default_congestion_algorithm_by_name(picoquic_quic_t* quic, ch
 
 void picoquic_set_congestion_algorithm(picoquic_cnx_t* cnx, picoquic_congestion_algorithm_t const* algo);
 
+/* Multipath schedulers.
+ * When several paths are usable, the scheduler picks the path on which the next
+ * packet is sent. The stack handles path challenges, demotions and priorities, and
+ * presents the scheduler with the candidate paths at the highest priority level,
+ * each marked with whether pacing and congestion control allow sending now. The
+ * list of candidates is cached between packets, and only recomputed when the state
+ * of a path changes.
+ *
+ * The "sched_select" function returns the index of the selected candidate, or -1
+ * if no path should be used now. It may return a path that is blocked by congestion
+ * control, e.g., if waiting for a fast path is better than using a slow one.
+ *
+ * The optional "sched_datagram_sent" function is called when datagram frames are
+ * sent on a path, which allows for duplicating them on other paths.
+ */
+typedef struct st_picoquic_path_candidate_t {
+    picoquic_path_t* path_x;
+    int path_index;
+    unsigned int is_pacing_ok : 1;
+    unsigned int is_cwin_ok : 1;
+} picoquic_path_candidate_t;
+
+typedef int (*picoquic_path_scheduler_select)(
+    picoquic_cnx_t* cnx,
+    picoquic_path_candidate_t const* candidates,
+    int nb_candidates,
+    int is_ack_needed,
+    uint64_t current_time);
+typedef void (*picoquic_path_scheduler_datagram_sent)(
+    picoquic_cnx_t* cnx,
+    picoquic_path_t* path_x,
+    const uint8_t* bytes,
+    size_t length,
+    uint64_t current_time);
+
+typedef struct st_picoquic_path_scheduler_t {
+    char const* path_scheduler_id;
+    uint8_t path_scheduler_number;
+    picoquic_path_scheduler_select sched_select;
+    picoquic_path_scheduler_datagram_sent sched_datagram_sent; /* Optional */
+} picoquic_path_scheduler_t;
+
+/* Least recently used path, the default */
+extern picoquic_path_scheduler_t* picoquic_lru_path_scheduler;
+/* Lowest RTT path with available congestion window */
+extern picoquic_path_scheduler_t* picoquic_minrtt_path_scheduler;
+/* Round robin weighted by the bandwidth estimate of each path */
+extern picoquic_path_scheduler_t* picoquic_weighted_path_scheduler;
+/* Minimum RTT, with datagrams duplicated on all the candidate paths */
+extern picoquic_path_scheduler_t* picoquic_redundant_path_scheduler;
+/* Path on which the next packet is expected to arrive first */
+extern picoquic_path_scheduler_t* picoquic_ecf_path_scheduler;
+
+#define PICOQUIC_DEFAULT_PATH_SCHEDULER picoquic_lru_path_scheduler
+
+picoquic_path_scheduler_t const* picoquic_get_path_scheduler(char const* scheduler_name);
+
+void picoquic_set_default_path_scheduler(picoquic_quic_t* quic, picoquic_path_scheduler_t const* scheduler);
+
+void picoquic_set_path_scheduler(picoquic_cnx_t* cnx, picoquic_path_scheduler_t const* scheduler);
+
 /* Bandwidth update and congestion control parameters value.
  * Congestion control in picoquic is characterized by three values:
  * - pacing rate, expressed in bytes per second (for example, 10Mbps would be noted as 1250000)
@@ -1134,6 +1417,104 @@ uint64_t picoquic_get_rtt(picoquic_cnx_t* cnx);
 int picoquic_probe_new_path_ex(picoquic_cnx_t* cnx, const struct sockaddr* addr_from,
         const struct sockaddr* addr_to, int if_index, uint64_t current_time, int to_preferred_address);
 
+/* Packet protection providers.
+ * By default, packet protection calls the picotls AEAD functions inline.
+ * A packet protection provider can be set per QUIC context to redirect
+ * that work, e.g., to a dedicated crypto thread or lcore, or to an inline
+ * accelerator. Each operation is described by an AEAD job. The "aead_context"
+ * is the picotls AEAD context used by the stack, and "is_multipath" indicates
+ * that the path_id shall be xor-ed into the IV, as in "picoquic_aead_encrypt_mp".
+ *
+ * Providers must implement the synchronous "process" function. Providers may
+ * also implement the asynchronous "submit" and "poll" functions. Jobs are
+ * submitted in batches, and are returned by "poll" once completed, in any order.
+ * If these functions are present, the stack uses them for the protection of
+ * 1-RTT packets: the datagrams are returned by "picoquic_prepare_packet_ex"
+ * once their encryption and header protection are complete, and the received
+ * packets are processed once decrypted. The "process" function is used for
+ * the handshake packets, and when the provider queue is full. On completion, "result"
+ * holds the length of the output, or a value larger than the input length
+ * if the operation failed, following the convention of the AEAD functions.
+ * The submitter owns the job descriptors and the buffers that they point to
+ * until the job is returned by poll.
+ */
+typedef struct st_picoquic_aead_job_t {
+    uint8_t* output;
+    const uint8_t* input;
+    size_t input_length;
+    const uint8_t* auth_data;
+    size_t auth_data_length;
+    uint64_t seq_num;
+    uint64_t path_id;
+    void* aead_context;
+    void* job_ctx; /* Opaque pointer for use by the submitter */
+    size_t result;
+    unsigned int is_encrypt : 1;
+    unsigned int is_multipath : 1;
+    unsigned int is_complete : 1;
+} picoquic_aead_job_t;
+
+typedef void* (*picoquic_crypto_provider_create)(picoquic_quic_t* quic, char const* param);
+typedef void (*picoquic_crypto_provider_delete)(void* provider_ctx);
+typedef size_t (*picoquic_crypto_provider_process)(void* provider_ctx, picoquic_aead_job_t* job);
+typedef size_t (*picoquic_crypto_provider_submit)(void* provider_ctx, picoquic_aead_job_t** jobs, size_t nb_jobs);
+typedef size_t (*picoquic_crypto_provider_poll)(void* provider_ctx, picoquic_aead_job_t** jobs, size_t max_jobs);
+
+typedef struct st_picoquic_crypto_provider_t {
+    char const* provider_id;
+    picoquic_crypto_provider_create provider_create;
+    picoquic_crypto_provider_delete provider_delete;
+    picoquic_crypto_provider_process provider_process;
+    picoquic_crypto_provider_submit provider_submit; /* NULL if async mode is not supported */
+    picoquic_crypto_provider_poll provider_poll; /* NULL if async mode is not supported */
+} picoquic_crypto_provider_t;
+
+extern picoquic_crypto_provider_t* picoquic_software_crypto_provider;
+extern picoquic_crypto_provider_t* picoquic_ring_crypto_provider;
+
+picoquic_crypto_provider_t const* picoquic_get_crypto_provider(char const* provider_name);
+
+/* Set the packet protection provider for the QUIC context. The "param" string
+ * is passed to the provider's create function; for the ring provider it
+ * holds the number of the lcore on which the crypto loop runs, or NULL to run
+ * it on a plain thread. Setting a NULL provider restores the inline default.
+ * Returns 0 on success, -1 if the provider context could not be created.
+ */
+int picoquic_set_crypto_provider(picoquic_quic_t* quic, picoquic_crypto_provider_t const* provider, char const* param);
+
+/* Asynchronous job submission. If the provider does not support async mode,
+ * the jobs are processed inline and marked complete before the function returns.
+ * The function returns the number of jobs accepted, which may be lower than
+ * nb_jobs if the provider queue is full.
+ */
+size_t picoquic_crypto_provider_submit_jobs(picoquic_quic_t* quic, picoquic_aead_job_t** jobs, size_t nb_jobs);
+size_t picoquic_crypto_provider_poll_jobs(picoquic_quic_t* quic, picoquic_aead_job_t** jobs, size_t max_jobs);
+
+/* With an asynchronous provider, connections with jobs in flight are scheduled
+ * to wake up immediately, and the completed jobs are collected on the next call
+ * to "picoquic_prepare_next_packet_ex", "picoquic_prepare_packet_ex" or
+ * "picoquic_incoming_packet_ex". Applications that need all submitted work to
+ * be complete, e.g., simulations that do not advance time while the provider
+ * runs, can call "picoquic_crypto_provider_wait". It waits until the provider
+ * returns all the jobs in flight, then processes the received packets that
+ * were decrypted.
+ */
+void picoquic_crypto_provider_wait(picoquic_quic_t* quic, uint64_t current_time);
+
+/* Asynchronous certificate signing.
+ * When enabled, the server certificate signatures are computed by a pool of
+ * "nb_threads" signing threads instead of the packet processing path. Each
+ * thread takes up to "max_batch" pending signatures at a time. Handshakes that
+ * wait for a signature are parked; they resume when the worker calls
+ * picoquic_poll_async_signatures, which picoquic_prepare_next_packet_ex does
+ * on each call. Applications driving connections directly must call it.
+ * The function returns the number of handshakes resumed.
+ * Async signing must be enabled after the server key is loaded. Setting
+ * nb_threads to 0 restores synchronous signing.
+ */
+int picoquic_set_async_signing(picoquic_quic_t* quic, int nb_threads, size_t max_batch);
+int picoquic_poll_async_signatures(picoquic_quic_t* quic, uint64_t current_time);
+
 #ifdef __cplusplus
 }
 #endif
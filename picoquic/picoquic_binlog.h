@@ -112,6 +112,35 @@ int picoquic_set_binlog(picoquic_quic_t* quic, char const* binlog_dir);
 /* Enable binary logs, e.g. if autoqlog is requests */
 void picoquic_enable_binlog(picoquic_quic_t* quic);
 
+/* Asynchronous binary logs.
+ * When enabled, the binary log events are queued in a ring of "ring_size" bytes,
+ * and written to the log files by a background thread. If the ring is full, the
+ * events are either dropped and counted, or the network thread waits for the
+ * writer thread to catch up. The log files have the same format as with
+ * synchronous logging. Setting ring_size to 0 restores synchronous logging.
+ */
+typedef enum {
+    picoquic_binlog_overflow_drop = 0,
+    picoquic_binlog_overflow_block
+} picoquic_binlog_overflow_enum;
+
+int picoquic_set_binlog_async(picoquic_quic_t* quic, size_t ring_size, picoquic_binlog_overflow_enum overflow_policy);
+uint64_t picoquic_get_binlog_dropped(picoquic_quic_t* quic);
+
+/* Ring buffer used by the asynchronous logs. If "start_thread" is not set, the
+ * records are only written when picoquic_binlog_writer_drain is called. */
+typedef struct st_picoquic_binlog_writer_t picoquic_binlog_writer_t;
+
+picoquic_binlog_writer_t* picoquic_binlog_writer_create(size_t ring_size,
+    picoquic_binlog_overflow_enum overflow_policy, int start_thread);
+void picoquic_binlog_writer_delete(picoquic_binlog_writer_t* writer);
+int picoquic_binlog_writer_push(picoquic_binlog_writer_t* writer, FILE* f, const uint8_t* chunk, size_t length);
+void picoquic_binlog_writer_close_file(picoquic_binlog_writer_t* writer, FILE* f, int wait_until_closed);
+void picoquic_binlog_writer_flush(picoquic_binlog_writer_t* writer);
+size_t picoquic_binlog_writer_drain(picoquic_binlog_writer_t* writer);
+void picoquic_binlog_writer_set_file_buffer(FILE* f);
+uint64_t picoquic_binlog_writer_dropped(picoquic_binlog_writer_t* writer);
+
 #ifdef __cplusplus
 }
 #endif
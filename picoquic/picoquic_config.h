@@ -72,6 +72,7 @@ typedef enum {
     picoquic_option_Version_Upgrade,
     picoquic_option_No_GSO,
     picoquic_option_BDP_frame,
+    picoquic_option_Profile,
     picoquic_option_HELP
 }  picoquic_option_enum_t;
 
@@ -126,6 +127,7 @@ typedef struct st_picoquic_quic_config_t {
     unsigned int force_zero_share : 1;
     unsigned int no_disk : 1;
     unsigned int large_client_hello : 1;
+    int profile_interval_ms;
 } picoquic_quic_config_t;
 
 int picoquic_config_option_letters(char* option_string, size_t string_max, size_t* string_length);
@@ -0,0 +1,74 @@
+/*
+* Structured events of the packet loops and of the stack.
+*
+* Routine events such as connection closures, or ICMP, ARP and unknown
+* frames received by the DPDK loop, used to be reported with printf on
+* the data path. When stdout is a terminal or a pipe, a burst of such
+* messages blocks the worker. Instead, each event type has a counter in
+* the QUIC context, which is always updated and is published in the
+* metrics segment if metrics are enabled. A text line may also be written
+* to a file, typically stdout, and for events that are not attached to a
+* connection, to the text log of the context. The text is limited
+* to a few lines per event type and per second, and the number of
+* suppressed lines is reported when the period ends.
+*
+* By default, no text is written. Applications choose the file and the
+* rate with picoquic_events_set_text.
+*/
+#ifndef PICOQUIC_EVENTS_H
+#define PICOQUIC_EVENTS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "picoquic.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    picoquic_event_cnx_closed = 0,
+    picoquic_event_icmp_received,
+    picoquic_event_icmpv6_received,
+    picoquic_event_arp_received,
+    picoquic_event_arp_reply_sent,
+    picoquic_event_unknown_ip_protocol,
+    picoquic_event_unknown_ipv6_protocol,
+    picoquic_event_unknown_ethertype,
+    picoquic_event_tx_dropped,
+    picoquic_event_max
+} picoquic_event_enum;
+
+#define PICOQUIC_EVENT_TEXT_PERIOD 1000000ull /* microseconds */
+#define PICOQUIC_EVENT_TEXT_MAX_DEFAULT 5 /* lines per event type and period */
+
+typedef struct st_picoquic_events_t {
+    uint64_t counters[picoquic_event_max];
+    FILE* F_text;
+    uint32_t text_max;
+    uint32_t nb_text[picoquic_event_max];
+    uint64_t nb_suppressed[picoquic_event_max];
+    uint64_t period_start[picoquic_event_max];
+} picoquic_events_t;
+
+/* Write up to max_per_period lines per event type and per second to F.
+ * F == NULL or max_per_period == 0 disables the text output. */
+void picoquic_events_set_text(picoquic_quic_t* quic, FILE* F, uint32_t max_per_period);
+uint64_t picoquic_events_get_count(picoquic_quic_t* quic, picoquic_event_enum event);
+char const* picoquic_event_name(picoquic_event_enum event);
+
+/* Count the event, and write the text if the rate limit allows it. The
+ * text has no trailing new line. The cid may be NULL. */
+void picoquic_event_signal(picoquic_quic_t* quic, picoquic_event_enum event, const picoquic_connection_id_t* cid,
+    uint64_t current_time, const char* fmt, ...);
+/* Same, as separate steps, when one text line reports several events,
+ * e.g., all the packets dropped in a burst */
+void picoquic_event_count(picoquic_quic_t* quic, picoquic_event_enum event, uint64_t nb_events);
+void picoquic_event_text(picoquic_quic_t* quic, picoquic_event_enum event, const picoquic_connection_id_t* cid,
+    uint64_t current_time, const char* fmt, ...);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PICOQUIC_EVENTS_H */
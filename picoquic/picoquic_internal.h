@@ -30,6 +30,7 @@
 #include "picosplay.h"
 #include "picoquic.h"
 #include "picoquic_utils.h"
+#include "picoquic_events.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -71,6 +72,10 @@ extern "C" {
 #define PICOQUIC_BANDWIDTH_ESTIMATE_MAX 10000000000ull /* 10 GB per second */
 #define PICOQUIC_BANDWIDTH_TIME_INTERVAL_MIN 1000
 #define PICOQUIC_BANDWIDTH_MEDIUM 2000000 /* 16 Mbps, threshold for coalescing 10 packets per ACK with long delays */
+#define PICOQUIC_ACK_AUTOTUNE_PACKET_RATE 5000 /* packets per second, above which ACK gap autotuning kicks in */
+#define PICOQUIC_ACK_AUTOTUNE_ACKS_PER_RTT 8 /* minimum number of ACKs per RTT, to preserve loss recovery */
+#define PICOQUIC_ACK_AUTOTUNE_ACKS_PER_RTT_REORDER 16 /* same, if reordering was observed on the path */
+#define PICOQUIC_ACK_AUTOTUNE_GAP_MAX 256
 #define PICOQUIC_MAX_BANDWIDTH_TIME_INTERVAL_MIN 1000
 #define PICOQUIC_MAX_BANDWIDTH_TIME_INTERVAL_MAX 15000
 
@@ -81,6 +86,7 @@ extern "C" {
 #define PICOQUIC_MICROSEC_WAIT_MAX 10000000ull /* 10 seconds for now */
 
 #define PICOQUIC_MICROSEC_STATELESS_RESET_INTERVAL_DEFAULT 100000ull /* max 10 stateless reset by second by default */
+#define PICOQUIC_SIGN_OFFLOAD_POLL_INTERVAL 1000 /* Poll for completed asynchronous signatures every ms */
 
 #define PICOQUIC_CWIN_INITIAL (10 * PICOQUIC_MAX_PACKET_SIZE)
 #define PICOQUIC_CWIN_MINIMUM (2 * PICOQUIC_MAX_PACKET_SIZE)
@@ -89,6 +95,8 @@ extern "C" {
 
 #define PICOQUIC_DEFAULT_SIMULTANEOUS_LOGS 32
 #define PICOQUIC_DEFAULT_HALF_OPEN_RETRY_THRESHOLD 64
+#define PICOQUIC_STATELESS_PACKET_POOL_SIZE 64
+#define PICOQUIC_STATELESS_RATE_BUCKETS 1024
 
 #define PICOQUIC_PN_RANDOM_MIN 0xffff
 #define PICOQUIC_PN_RANDOM_RANGE 0x10000
@@ -104,6 +112,20 @@ extern "C" {
 #define PICOQUIC_CC_ALGO_NUMBER_DCUBIC 3
 #define PICOQUIC_CC_ALGO_NUMBER_FAST 4
 #define PICOQUIC_CC_ALGO_NUMBER_BBR 5
+#define PICOQUIC_CC_ALGO_NUMBER_PRAGUE 6
+#define PICOQUIC_CC_ALGO_NUMBER_BBR3 7
+
+#define PICOQUIC_PATH_SCHEDULER_NUMBER_LRU 1
+#define PICOQUIC_PATH_SCHEDULER_NUMBER_MINRTT 2
+#define PICOQUIC_PATH_SCHEDULER_NUMBER_WEIGHTED 3
+#define PICOQUIC_PATH_SCHEDULER_NUMBER_REDUNDANT 4
+#define PICOQUIC_PATH_SCHEDULER_NUMBER_ECF 5
+
+#define PICOQUIC_REDUNDANT_DATAGRAM_MAX 16 /* Max number of datagram copies waiting on a path */
+
+/* Size of the congestion control state kept inline in the path context, for
+ * algorithms that do not allocate their state (see bbr3.c) */
+#define PICOQUIC_CC_INLINE_STATE_WORDS 40
 
 #define PICOQUIC_MAX_ACK_RANGE_REPEAT 4
 #define PICOQUIC_MIN_ACK_RANGE_REPEAT 2
@@ -330,16 +352,68 @@ typedef struct st_picoquic_stateless_packet_t {
     uint64_t cnxid_log64;
     picoquic_connection_id_t initial_cid;
     picoquic_packet_type_enum ptype;
+    picoquic_quic_t* pool_quic; /* NULL if the packet was not taken from the pool */
 
     uint8_t bytes[PICOQUIC_MAX_PACKET_SIZE];
 } picoquic_stateless_packet_t;
 
-/* Handling of stateless packets */
+/* Handling of stateless packets.
+ * Stateless packets are taken from a preallocated pool. If the pool is empty,
+ * picoquic_create_stateless_packet allocates a new one, while
+ * picoquic_get_pooled_stateless_packet returns NULL, so that packet floods
+ * cannot cause unbounded allocations.
+ */
+typedef struct st_picoquic_stateless_rate_bucket_t {
+    uint64_t refill_time;
+    uint32_t credits;
+} picoquic_stateless_rate_bucket_t;
+
 picoquic_stateless_packet_t* picoquic_create_stateless_packet(picoquic_quic_t* quic);
+picoquic_stateless_packet_t* picoquic_get_pooled_stateless_packet(picoquic_quic_t* quic);
 void picoquic_queue_stateless_packet(picoquic_quic_t* quic, picoquic_stateless_packet_t* sp);
 picoquic_stateless_packet_t* picoquic_dequeue_stateless_packet(picoquic_quic_t* quic);
 void picoquic_delete_stateless_packet(picoquic_stateless_packet_t* sp);
 
+/* Profile of the connection setup cost, used by the handshake benchmark.
+ * Cycles are only counted if quic->setup_profile is set. The context
+ * creation count excludes the hash table insertions, counted separately.
+ */
+typedef struct st_picoquic_setup_profile_t {
+    uint64_t cnx_create_cycles;
+    uint64_t nb_cnx_create;
+    uint64_t hash_insert_cycles;
+    uint64_t nb_hash_insert;
+} picoquic_setup_profile_t;
+
+/* Timing wheel used by the context wide pacing scheduler.
+ * Slot numbers are absolute: a connection waking at time t is placed in
+ * slot ceil(t / slot_usec), so that it is never drained before t. Slots
+ * below "current_slot" have been drained; connections scheduled in the past
+ * go directly to the "due" list, which is served in FIFO order.
+ * The occupancy bitmap has one bit per slot, and is used to find the next
+ * non empty slot without scanning empty slots.
+ */
+typedef struct st_picoquic_pacing_wheel_t {
+    uint64_t slot_usec;
+    size_t nb_slots; /* multiple of 64 */
+    uint64_t current_slot;
+    struct st_picoquic_cnx_t** slot_first;
+    struct st_picoquic_cnx_t** slot_last;
+    uint64_t* occupancy;
+    struct st_picoquic_cnx_t* due_first;
+    struct st_picoquic_cnx_t* due_last;
+    size_t nb_cnx;
+    picoquic_pacing_wheel_stats_t stats;
+} picoquic_pacing_wheel_t;
+
+picoquic_pacing_wheel_t* picoquic_pacing_wheel_create(uint64_t slot_usec, size_t nb_slots);
+void picoquic_pacing_wheel_delete(picoquic_pacing_wheel_t* wheel);
+int picoquic_pacing_wheel_insert(picoquic_pacing_wheel_t* wheel, struct st_picoquic_cnx_t* cnx);
+void picoquic_pacing_wheel_remove(picoquic_pacing_wheel_t* wheel, struct st_picoquic_cnx_t* cnx);
+void picoquic_pacing_wheel_drain(picoquic_pacing_wheel_t* wheel, uint64_t current_time);
+struct st_picoquic_cnx_t* picoquic_pacing_wheel_first(picoquic_pacing_wheel_t* wheel, uint64_t* wake_time);
+void picoquic_pacing_wheel_departure(picoquic_pacing_wheel_t* wheel, uint64_t scheduled_time, uint64_t current_time);
+
 /* Data structure used to hold chunk of stream data before in sequence delivery */
 typedef struct st_picoquic_stream_data_node_t {
     picosplay_node_t stream_data_node;
@@ -351,6 +425,68 @@ typedef struct st_picoquic_stream_data_node_t {
     uint8_t data[PICOQUIC_MAX_PACKET_SIZE];
 } picoquic_stream_data_node_t;
 
+/* Asynchronous packet protection.
+ * If the crypto provider implements "submit" and "poll", the AEAD operations
+ * for 1-RTT packets are submitted to the provider instead of being executed
+ * in line. While a batch of packets is prepared, the protection of each 1-RTT
+ * packet is recorded in the QUIC context. At the end of the batch, the
+ * content of the send buffer is copied to a protected datagram, the jobs are
+ * submitted, and the datagram is queued in the connection context. Header
+ * protection is applied when the job completes, and the datagram is returned
+ * to the application by the next call to "picoquic_prepare_packet_ex" once
+ * all its jobs are complete, in queue order.
+ * Received 1-RTT packets are held in a pending decryption record until the
+ * job completes, and then processed as if they had just arrived. Once a
+ * connection has pending decryptions, all its 1-RTT packets are queued, so
+ * that they are processed in arrival order. Packets that do not use the
+ * current key are not submitted, and are decrypted in line when they reach
+ * the head of the queue.
+ */
+#define PICOQUIC_CRYPTO_ASYNC_MAX_JOBS 64
+#define PICOQUIC_CRYPTO_ASYNC_MAX_DATAGRAMS 64
+
+typedef struct st_picoquic_async_protection_t {
+    picoquic_aead_job_t job; /* Job pointers refer to the datagram bytes once submitted */
+    struct st_picoquic_protected_datagram_t* datagram;
+    uint8_t* packet; /* Start of the packet, in the send buffer or in the datagram */
+    size_t pn_offset;
+    size_t expected_length; /* Length of the encrypted payload, including checksum */
+    void* pn_enc;
+    uint8_t first_mask;
+} picoquic_async_protection_t;
+
+typedef struct st_picoquic_protected_datagram_t {
+    struct st_picoquic_protected_datagram_t* next_datagram;
+    struct st_picoquic_cnx_t* cnx;
+    struct sockaddr_storage addr_to;
+    struct sockaddr_storage addr_from;
+    int if_index;
+    size_t send_msg_size;
+    size_t length;
+    size_t nb_jobs;
+    size_t nb_pending;
+    unsigned int is_failed : 1;
+    picoquic_async_protection_t* protection;
+    uint8_t* bytes;
+} picoquic_protected_datagram_t;
+
+typedef struct st_picoquic_pending_decryption_t {
+    picoquic_aead_job_t job;
+    struct st_picoquic_pending_decryption_t* next_pending;
+    struct st_picoquic_cnx_t* cnx;
+    picoquic_stream_data_node_t* decrypted_data;
+    picoquic_packet_header ph;
+    struct sockaddr_storage addr_from;
+    struct sockaddr_storage addr_to;
+    int if_index_to;
+    unsigned char received_ecn;
+    size_t packet_length;
+    uint64_t receive_time;
+    uint64_t key_rotations; /* Number of key rotations when the job was submitted */
+    unsigned int is_done : 1;
+    unsigned int is_deferred : 1; /* Not submitted, decrypted in line when at the head of the queue */
+} picoquic_pending_decryption_t;
+
 /* Data structure used to hold chunk of stream data queued by application */
 typedef struct st_picoquic_stream_queue_node_t {
     picoquic_quic_t* quic;
@@ -533,6 +669,28 @@ int picoquic_remember_issued_ticket(picoquic_quic_t* quic,
 picoquic_issued_ticket_t* picoquic_retrieve_issued_ticket(picoquic_quic_t* quic,
     uint64_t ticket_id);
 
+/* Shared ticket cache, see picoquic_ticket_cache_create().
+ * Keys and values are opaque byte strings. Server entries are keyed by 'S' and the
+ * ticket ID, client entries by 'C', version, SNI and ALPN.
+ */
+#define PICOQUIC_TICKET_CACHE_KEY_MAX 256
+#define PICOQUIC_TICKET_CACHE_VALUE_MAX 1024
+#define PICOQUIC_TICKET_CACHE_ISSUED_TTL (7ull * 24ull * 3600ull * 1000000ull)
+
+int picoquic_ticket_cache_put(picoquic_ticket_cache_t* cache, const uint8_t* key, size_t key_length,
+    const uint8_t* value, size_t value_length, uint64_t expiry_time, uint64_t current_time);
+int picoquic_ticket_cache_get(picoquic_ticket_cache_t* cache, const uint8_t* key, size_t key_length,
+    uint8_t* value, size_t value_max, size_t* value_length, uint64_t current_time);
+int picoquic_ticket_cache_remove(picoquic_ticket_cache_t* cache, const uint8_t* key, size_t key_length);
+
+int picoquic_cache_client_ticket(picoquic_ticket_cache_t* cache, uint64_t current_time,
+    char const* sni, uint16_t sni_length, char const* alpn, uint16_t alpn_length,
+    uint32_t version, uint8_t* ticket, uint16_t ticket_length, picoquic_tp_t const* tp);
+picoquic_stored_ticket_t* picoquic_get_cached_client_ticket(picoquic_ticket_cache_t* cache,
+    uint64_t current_time, char const* sni, uint16_t sni_length,
+    char const* alpn, uint16_t alpn_length, uint32_t version, uint64_t ticket_id);
+picoquic_stored_ticket_t* picoquic_get_cnx_stored_ticket(picoquic_cnx_t* cnx, uint64_t current_time);
+
 /*
  * Transport parameters, as defined by the QUIC transport specification.
  * The initial code defined the type as an enum, but the binary representation
@@ -611,6 +769,10 @@ typedef struct st_picoquic_quic_t {
     uint64_t crypto_epoch_length_max; /* Default packet interval between key rotations */
     uint32_t max_simultaneous_logs;
     uint32_t current_number_of_open_logs;
+    uint32_t log_sample_one_in;
+    uint32_t log_trigger_mask;
+    size_t flight_recorder_events;
+    uint64_t log_trigger_min_throughput;
     uint32_t max_half_open_before_retry;
     uint32_t current_number_half_open;
     uint32_t current_number_connections;
@@ -643,14 +805,36 @@ typedef struct st_picoquic_quic_t {
     unsigned int is_flow_control_limited : 1; /* Enforce flow control limit for tests */
     unsigned int test_large_server_flight : 1; /* Use TP to ensure server flight is at least 8K */
     unsigned int is_port_blocking_disabled : 1; /* Do not check client port on incoming connections */
+    unsigned int is_ack_autotune_enabled : 1; /* Autotune the ACK frequency on new connections */
+    unsigned int is_crypto_async_recording : 1; /* Record 1-RTT packet protection for async submission */
 
     picoquic_stateless_packet_t* pending_stateless_packet;
+    picoquic_stateless_packet_t* pending_stateless_last;
+    picoquic_stateless_packet_t* stateless_packet_pool;
+    picoquic_stateless_packet_t* stateless_packet_free;
+    picoquic_stateless_rate_bucket_t* stateless_rate_buckets;
+    uint64_t stateless_rate_seed;
+    uint32_t stateless_rate_per_second;
+    uint32_t stateless_rate_burst;
+    picoquic_prefilter_stats_t prefilter_stats;
 
     picoquic_congestion_algorithm_t const* default_congestion_alg;
+    picoquic_path_scheduler_t const* default_path_scheduler;
+    uint64_t ack_autotune_cycles_budget; /* Default budget for ACK processing, CPU cycles per second */
+
+    picoquic_crypto_provider_t const* crypto_provider;
+    void* crypto_provider_ctx;
+    picoquic_async_protection_t* crypto_async_records; /* Protections recorded in the current batch */
+    size_t nb_crypto_async_records;
+    uint64_t nb_crypto_jobs_in_flight;
+    picoquic_pending_decryption_t* first_pending_decryption;
+    picoquic_pending_decryption_t* last_pending_decryption;
+    struct st_picoquic_sign_offload_t* sign_offload;
 
     struct st_picoquic_cnx_t* cnx_list;
     struct st_picoquic_cnx_t* cnx_last;
     picosplay_tree_t cnx_wake_tree;
+    picoquic_pacing_wheel_t* pacing_wheel;
 
     struct st_picoquic_cnx_t* cnx_in_progress;
 
@@ -663,6 +847,8 @@ typedef struct st_picoquic_quic_t {
     picoquic_issued_ticket_t* table_issued_tickets_first;
     picoquic_issued_ticket_t* table_issued_tickets_last;
     size_t table_issued_tickets_nb;
+    picoquic_ticket_cache_t* ticket_cache; /* shared with other contexts, not owned */
+    picoquic_setup_profile_t* setup_profile; /* NULL unless profiling, not owned */
 
     picoquic_packet_t * p_first_packet;
     int nb_packets_in_pool;
@@ -697,6 +883,11 @@ typedef struct st_picoquic_quic_t {
     struct st_picoquic_unified_logging_t* text_log_fns;
     struct st_picoquic_unified_logging_t* bin_log_fns;
     struct st_picoquic_unified_logging_t* qlog_fns;
+    struct st_picoquic_binlog_writer_t* binlog_writer;
+    struct st_picoquic_metrics_segment_t* metrics; /* NULL unless metrics are enabled */
+    char* metrics_segment_name;
+    struct st_picoquic_profiler_t* profiler; /* NULL unless the cycle profiler is enabled */
+    picoquic_events_t events; /* Event counters and rate limited text */
     picoquic_performance_log_fn perflog_fn;
     void* v_perflog_ctx;
 } picoquic_quic_t;
@@ -834,6 +1025,16 @@ typedef struct st_picoquic_misc_frame_header_t {
 * resending of packets.
 */
 
+/* Loss detection timer.
+ * Earliest time at which the oldest packet of a retransmit queue may be declared lost.
+ * The value remains valid as long as cnx->loss_detection_epoch does not change.
+ */
+typedef struct st_picoquic_loss_timer_t {
+    uint64_t check_time;
+    uint64_t epoch;
+    picoquic_packet_context_enum pc;
+} picoquic_loss_timer_t;
+
 typedef struct st_picoquic_packet_context_t {
     uint64_t send_sequence; /* picoquic_decode_ack_frame */
     uint64_t next_sequence_hole;
@@ -846,6 +1047,7 @@ typedef struct st_picoquic_packet_context_t {
     picoquic_packet_t* retransmitted_newest;
     picoquic_packet_t* retransmitted_oldest;
     picoquic_packet_t* preemptive_repeat_ptr;
+    picoquic_loss_timer_t loss_timer;
     /* ECN Counters */
     uint64_t ecn_ect0_total_remote;
     uint64_t ecn_ect1_total_remote;
@@ -966,6 +1168,7 @@ typedef struct st_picoquic_path_t {
     /* The packet list holds unkacknowledged packets sent on this path.*/
     picoquic_packet_t* path_packet_first;
     picoquic_packet_t* path_packet_last;
+    picoquic_loss_timer_t loss_timer; /* Loss timer for the path packet list, simple multipath */
     /* flags */
     unsigned int mtu_probe_sent : 1;
     unsigned int path_is_published : 1;
@@ -991,10 +1194,17 @@ typedef struct st_picoquic_path_t {
     unsigned int is_nominal_ack_path : 1;
     unsigned int is_ack_lost : 1;
     unsigned int is_ack_expected : 1;
+    unsigned int is_rtt_sample_pending : 1; /* RTT updated, not yet passed to the aggregated ACK event */
+    unsigned int is_sched_candidate : 1; /* In the cached list of multipath scheduler candidates */
 
 
     /* Path priority, for multipath management */
     int path_priority;
+    /* Multipath scheduler data */
+    uint64_t sched_virtual_time; /* Weighted round robin finish time */
+    picoquic_misc_frame_header_t* first_redundant_datagram; /* Datagram copies to send on this path */
+    picoquic_misc_frame_header_t* last_redundant_datagram;
+    int nb_redundant_datagrams;
 
     /* Management of retransmissions in a path.
      * The "path_packet" variables are used for the RACK algorithm, per path, to avoid
@@ -1060,6 +1270,7 @@ typedef struct st_picoquic_path_t {
     uint64_t last_sender_limited_time;
     uint64_t last_time_acked_data_frame_sent;
     void* congestion_alg_state;
+    uint64_t congestion_alg_inline[PICOQUIC_CC_INLINE_STATE_WORDS];
 
     /*
     * Pacing uses a set of per path variables:
@@ -1179,6 +1390,9 @@ typedef struct st_picoquic_cnx_t {
     unsigned int quic_bit_greased : 1; /* Indicate whether the quic bit was greased at least once */
     unsigned int quic_bit_received_0 : 1; /* Indicate whether the quic bit was received as zero at least once */
     unsigned int is_half_open : 1; /* for server side connections, created but not yet complete */
+    unsigned int is_in_pacing_wheel : 1; /* Wake time managed by the pacing wheel instead of the wake tree */
+    unsigned int is_wheel_due : 1; /* Connection is in the due list of the pacing wheel */
+    unsigned int is_signature_pending : 1; /* Handshake parked until the asynchronous certificate signature completes */
     unsigned int did_receive_short_initial : 1; /* whether peer sent unpadded initial packet */
     unsigned int ack_ignore_order_local : 1; /* Request peer to not generate immediate ack if out of order packet received */
     unsigned int ack_ignore_order_remote : 1; /* Peer requested no immediate ack if out of order packet received */
@@ -1190,6 +1404,8 @@ typedef struct st_picoquic_cnx_t {
     unsigned int send_receive_bdp_frame : 1; /* enable sending and receiving BDP frame */
     unsigned int cwin_notified_from_seed : 1; /* cwin was reset from a seeded value */
     unsigned int is_datagram_ready : 1; /* Active polling for datagrams */
+    unsigned int is_ack_autotune_enabled : 1; /* Adapt ACK gap to packet rate, reordering and CPU budget */
+    unsigned int is_path_sched_cache_valid : 1; /* Reset when the state of a path changes */
     /* PMTUD policy */
     picoquic_pmtud_policy_enum pmtud_policy;
     /* Spin bit policy */
@@ -1214,6 +1430,8 @@ typedef struct st_picoquic_cnx_t {
      */
     uint64_t issued_ticket_id;
     uint64_t resumed_ticket_id;
+    /* On clients using a shared ticket cache, copy of the ticket retrieved from the cache */
+    picoquic_stored_ticket_t* cached_ticket;
 
     /* On clients, document the SNI and ALPN expected from the server */
     /* TODO: there may be a need to propose multiple ALPN */
@@ -1245,6 +1463,10 @@ typedef struct st_picoquic_cnx_t {
     /* Next time sending data is expected */
     uint64_t next_wake_time;
     picosplay_node_t cnx_wake_node;
+    /* Links in the pacing wheel slot or due list, if is_in_pacing_wheel */
+    struct st_picoquic_cnx_t* wheel_next;
+    struct st_picoquic_cnx_t* wheel_previous;
+    uint64_t wheel_slot;
 
     /* TLS context, TLS Send Buffer, streams, epochs */
     void* tls_ctx;
@@ -1282,9 +1504,23 @@ typedef struct st_picoquic_cnx_t {
     uint64_t nb_trains_blocked_cwin;
     uint64_t nb_trains_blocked_pacing;
     uint64_t nb_trains_blocked_others;
+    /* Time spent in each of the limiting states of the sender */
+    picoquic_limit_state_enum limit_state;
+    uint64_t limit_state_time;
+    uint64_t limit_time[picoquic_limit_max];
+    /* Packet train builder: budget of the current batch, computed once per wakeup */
+    uint64_t train_budget;
+    uint64_t nb_trains_built;
+    uint64_t nb_train_packets;
+    uint64_t nb_train_packets_planned;
+    uint64_t train_length_max;
     uint64_t nb_packets_sent;
     uint64_t nb_packets_logged;
     uint64_t nb_retransmission_total;
+    /* Loss detection: the epoch changes when ACKs or RTT updates can make packets lost sooner */
+    uint64_t loss_detection_epoch;
+    uint64_t nb_loss_checks;
+    uint64_t nb_loss_checks_skipped;
     uint64_t nb_preemptive_repeat;
     uint64_t nb_spurious;
     uint64_t nb_crypto_key_rotations;
@@ -1302,6 +1538,8 @@ typedef struct st_picoquic_cnx_t {
     unsigned int stream_blocked : 1;
     /* Congestion algorithm */
     picoquic_congestion_algorithm_t const* congestion_alg;
+    /* Multipath scheduler */
+    picoquic_path_scheduler_t const* path_scheduler;
     uint64_t pacing_rate_signalled;
     uint64_t pacing_increase_threshold;
     uint64_t pacing_decrease_threshold;
@@ -1353,6 +1591,11 @@ typedef struct st_picoquic_cnx_t {
     int nb_paths;
     int nb_path_alloc;
     int last_path_polled;
+    /* Candidate paths for the multipath scheduler, cached while is_path_sched_cache_valid */
+    int nb_path_sched_candidates;
+    int path_sched_candidates[PICOQUIC_NB_PATH_TARGET];
+    uint64_t path_sched_virtual_clock;
+    uint64_t nb_path_sched_refresh;
     uint64_t path_sequence_next;
     picoquic_path_t* nominal_path_for_ack;
 
@@ -1373,6 +1616,11 @@ typedef struct st_picoquic_cnx_t {
     uint64_t ack_gap_local;
     uint64_t ack_frequency_delay_local;
     uint64_t ack_frequency_sequence_remote;
+    /* ACK frequency autotuning, see picoquic_autotune_ack_gap */
+    uint64_t ack_autotune_cycles_budget;
+    uint64_t ack_autotune_cycles_per_ack;
+    uint64_t ack_autotune_nb_losses;
+    uint64_t ack_autotune_hold_until;
     uint64_t ack_gap_remote;
     uint64_t ack_delay_remote;
 
@@ -1380,10 +1628,23 @@ typedef struct st_picoquic_cnx_t {
     picoquic_stateless_packet_t* first_sooner;
     picoquic_stateless_packet_t* last_sooner;
 
+    /* Datagrams waiting for asynchronous packet protection */
+    picoquic_protected_datagram_t* first_protected_datagram;
+    picoquic_protected_datagram_t* last_protected_datagram;
+    size_t nb_protected_datagrams;
+    uint64_t nb_crypto_jobs_in_flight;
+    size_t nb_pending_decryptions;
+
     /* Log handling */
     uint16_t log_unique;
     FILE* f_binlog;
     char* binlog_file_name;
+    struct st_picoquic_flight_recorder_t* flight_recorder;
+    uint64_t log_spurious_window_start;
+    uint64_t log_spurious_count;
+    uint64_t log_throughput_window_start;
+    uint64_t log_throughput_bytes;
+    unsigned int log_throughput_was_blocked : 1;
 
 } picoquic_cnx_t;
 
@@ -1400,7 +1661,14 @@ typedef struct st_picoquic_packet_data_t {
         int rs_is_path_limited; /* Whether the path was app limited when packet was sent */
         int is_set;
         uint64_t data_acked;
+        uint64_t cc_bytes_acked; /* Newly acked bytes, excluding spurious retransmissions */
+        uint64_t cc_packets_acked;
     } path_ack[PICOQUIC_NB_PATH_TARGET];
+    /* ECN counters increments, reported in the aggregated ACK event of the default path */
+    uint64_t ecn_ect0_delta;
+    uint64_t ecn_ect1_delta;
+    uint64_t ecn_ce_delta;
+    uint64_t ecn_packet_number;
 } picoquic_packet_data_t;
 
 /* Load the stash of retry tokens. */
@@ -1489,6 +1757,7 @@ void picoquic_update_pacing_after_send(picoquic_path_t* path_x, uint64_t current
 int picoquic_is_sending_authorized_by_pacing(picoquic_cnx_t* cnx, picoquic_path_t* path_x, uint64_t current_time, uint64_t* next_time);
 /* Reset pacing data if congestion algorithm computes it directly */
 void picoquic_update_pacing_rate(picoquic_cnx_t* cnx, picoquic_path_t* path_x, double pacing_rate, uint64_t quantum);
+void picoquic_update_pacing_rate_int(picoquic_cnx_t* cnx, picoquic_path_t* path_x, uint64_t pacing_rate, uint64_t quantum);
 
 /* Next time is used to order the list of available connections,
         * so ready connections are polled first */
@@ -1527,6 +1796,9 @@ int picoquic_parse_packet_header(
     picoquic_cnx_t** pcnx,
     int receiving);
 
+uint8_t picoquic_create_long_packet_type(picoquic_packet_type_enum pt, int version_index);
+picoquic_packet_type_enum picoquic_parse_long_packet_type(uint8_t flags, int version_index);
+
 size_t picoquic_create_packet_header(
     picoquic_cnx_t* cnx,
     picoquic_packet_type_enum packet_type,
@@ -1631,7 +1903,7 @@ void picoquic_sack_item_record_reset(picoquic_sack_list_t* sack_list, picoquic_s
 
 size_t picoquic_sack_list_size(picoquic_sack_list_t* first_sack);
 
-void picoquic_record_ack_packet_data(picoquic_packet_data_t* packet_data, picoquic_packet_t* acked_packet);
+int picoquic_record_ack_packet_data(picoquic_packet_data_t* packet_data, picoquic_packet_t* acked_packet);
 
 void picoquic_init_packet_ctx(picoquic_cnx_t* cnx, picoquic_packet_context_t* pkt_ctx);
 
@@ -1655,6 +1927,9 @@ void picoquic_seed_bandwidth(picoquic_cnx_t* cnx, uint64_t rtt_min, uint64_t cwi
 void picoquic_update_path_rtt(picoquic_cnx_t* cnx, picoquic_path_t * old_path, picoquic_path_t* path_x,
     uint64_t send_time, uint64_t current_time, uint64_t ack_delay, uint64_t time_stamp);
 
+/* Pass an RTT sample obtained outside of ACK processing to algorithms using the aggregated ACK event */
+void picoquic_notify_pending_rtt(picoquic_cnx_t* cnx, picoquic_path_t* path_x, uint64_t current_time);
+
 /* stream management */
 picoquic_stream_head_t* picoquic_create_stream(picoquic_cnx_t* cnx, uint64_t stream_id);
 picoquic_stream_head_t* picoquic_create_missing_streams(picoquic_cnx_t* cnx, uint64_t stream_id, int is_remote);
@@ -1765,6 +2040,9 @@ void picoquic_clear_ack_ctx(picoquic_ack_context_t* ack_ctx);
 int picoquic_queue_handshake_done_frame(picoquic_cnx_t* cnx);
 uint8_t* picoquic_format_first_datagram_frame(picoquic_cnx_t* cnx, uint8_t* bytes, uint8_t* bytes_max, int* more_data, int* is_pure_ack);
 uint8_t* picoquic_format_ready_datagram_frame(picoquic_cnx_t* cnx, uint8_t* bytes, uint8_t* bytes_max, int* more_data, int* is_pure_ack, int* ret);
+int picoquic_queue_redundant_datagrams(picoquic_cnx_t* cnx, picoquic_path_t* path_x, const uint8_t* bytes, size_t length);
+uint8_t* picoquic_format_redundant_datagram_frames(picoquic_path_t* path_x, uint8_t* bytes, uint8_t* bytes_max, int* more_data, int* is_pure_ack);
+void picoquic_delete_redundant_datagrams(picoquic_path_t* path_x);
 uint8_t* picoquic_decode_datagram_frame_header(uint8_t* bytes, const uint8_t* bytes_max,
     uint8_t* frame_id, uint64_t* length);
 const uint8_t* picoquic_parse_ack_frequency_frame(const uint8_t* bytes, const uint8_t* bytes_max, uint64_t* seq, uint64_t* packets, uint64_t* microsec, uint8_t * ignore_order);
@@ -1790,6 +2068,10 @@ uint64_t picoquic_prepare_transport_param_stream_id(uint64_t stream_id);
 void picoquic_process_sooner_packets(picoquic_cnx_t* cnx, uint64_t current_time);
 void picoquic_delete_sooner_packets(picoquic_cnx_t* cnx);
 
+void picoquic_protected_datagram_job_complete(picoquic_async_protection_t* protection);
+void picoquic_flush_async_protections(picoquic_cnx_t* cnx);
+void picoquic_process_pending_decryptions(picoquic_quic_t* quic, uint64_t current_time);
+
 /* handling of transport extensions.
  */
 
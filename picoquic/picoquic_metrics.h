@@ -0,0 +1,144 @@
+/*
+* Live metrics of a QUIC context.
+*
+* Each QUIC context can publish counters, gauges and latency histograms in a
+* memory segment. If a segment name is provided, the segment is a named
+* shared memory object, and external tools can open it read only and scrape
+* the values without any interaction with the data path. If no name is
+* provided, the segment is allocated in process memory.
+*
+* A QUIC context is served by a single thread, so each segment has a single
+* writer. Values are 64 bit aligned integers updated by plain stores, without
+* locks. Readers may observe values that are a few updates old, and the
+* histogram buckets are not guaranteed to be a consistent snapshot, which is
+* fine for monitoring. Servers running several worker threads create one
+* context, and thus one segment, per worker.
+*/
+#ifndef PICOQUIC_METRICS_H
+#define PICOQUIC_METRICS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "picoquic.h"
+#include "picoquic_events.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PICOQUIC_METRICS_MAGIC 0x5049434f4d455452ull /* "PICOMETR" */
+#define PICOQUIC_METRICS_VERSION 2
+
+typedef enum {
+    picoquic_metric_packets_in = 0,
+    picoquic_metric_packets_out,
+    picoquic_metric_bytes_in,
+    picoquic_metric_bytes_out,
+    picoquic_metric_drop_decrypt,
+    picoquic_metric_drop_version,
+    picoquic_metric_drop_malformed,
+    picoquic_metric_drop_duplicate,
+    picoquic_metric_drop_unexpected,
+    picoquic_metric_drop_blocked,
+    picoquic_metric_drop_other,
+    picoquic_metric_handshakes_completed,
+    picoquic_metric_handshakes_failed,
+    picoquic_metric_retransmits,
+    picoquic_metric_spurious_losses,
+    picoquic_metric_stateless_packets,
+    picoquic_metric_pool_exhausted,
+    picoquic_metric_counter_max
+} picoquic_metric_counter_enum;
+
+typedef enum {
+    picoquic_metric_connections = 0,
+    picoquic_metric_streams,
+    picoquic_metric_packets_in_pool,
+    picoquic_metric_gauge_max
+} picoquic_metric_gauge_enum;
+
+typedef enum {
+    picoquic_metric_rtt_usec = 0,
+    picoquic_metric_handshake_usec,
+    picoquic_metric_ack_cycles,
+    picoquic_metric_send_loop_cycles,
+    picoquic_metric_histogram_max
+} picoquic_metric_histogram_enum;
+
+/* Histograms use log-linear buckets, in the style of HDR histograms:
+ * values below 2^SUB_BITS have their own bucket, larger values are
+ * grouped in 2^SUB_BITS buckets per power of 2, so the value of a
+ * bucket is known within 1/2^SUB_BITS (12.5%).
+ */
+#define PICOQUIC_METRICS_SUB_BITS 3
+#define PICOQUIC_METRICS_SUB_COUNT (1 << PICOQUIC_METRICS_SUB_BITS)
+#define PICOQUIC_METRICS_NB_BUCKETS ((64 - PICOQUIC_METRICS_SUB_BITS + 1) * PICOQUIC_METRICS_SUB_COUNT)
+
+typedef struct st_picoquic_metrics_histogram_t {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+    uint64_t buckets[PICOQUIC_METRICS_NB_BUCKETS];
+} picoquic_metrics_histogram_t;
+
+typedef struct st_picoquic_metrics_segment_t {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t segment_size;
+    uint32_t nb_counters;
+    uint32_t nb_gauges;
+    uint32_t nb_histograms;
+    uint32_t writer_pid;
+    uint32_t nb_events;
+    uint32_t reserved;
+    uint64_t start_time;
+    uint64_t last_update_time;
+    uint64_t counters[picoquic_metric_counter_max];
+    int64_t gauges[picoquic_metric_gauge_max];
+    picoquic_metrics_histogram_t histograms[picoquic_metric_histogram_max];
+    uint64_t events[picoquic_event_max]; /* copy of the event counters of the context */
+} picoquic_metrics_segment_t;
+
+/* Enable metrics on the context. If segment_name is not NULL, the segment
+ * is created as a named shared memory object, e.g., "/picoquic-worker-0"
+ * on Posix systems, and removed when the context is freed. */
+int picoquic_metrics_enable(picoquic_quic_t* quic, char const* segment_name);
+void picoquic_metrics_disable(picoquic_quic_t* quic);
+picoquic_metrics_segment_t* picoquic_metrics_get_segment(picoquic_quic_t* quic);
+
+/* Update the gauges, the event counters and the time of last update. This is called
+ * once per call to picoquic_prepare_next_packet. */
+void picoquic_metrics_publish(picoquic_quic_t* quic, uint64_t current_time);
+
+/* Record a value in a histogram */
+unsigned int picoquic_metrics_bucket_index(uint64_t value);
+uint64_t picoquic_metrics_bucket_value(unsigned int bucket_index);
+void picoquic_metrics_histogram_add(picoquic_metrics_histogram_t* h, uint64_t value);
+void picoquic_metrics_record(picoquic_metrics_segment_t* segment, picoquic_metric_histogram_enum histogram, uint64_t value);
+
+/* Reader side. The segment is mapped read only, and checked for the
+ * expected magic number, version and size. */
+picoquic_metrics_segment_t const* picoquic_metrics_open_segment(char const* segment_name);
+void picoquic_metrics_close_segment(picoquic_metrics_segment_t const* segment);
+void picoquic_metrics_snapshot(picoquic_metrics_segment_t const* segment, picoquic_metrics_segment_t* snapshot);
+uint64_t picoquic_metrics_percentile(picoquic_metrics_histogram_t const* histogram, double percentile);
+char const* picoquic_metrics_counter_name(picoquic_metric_counter_enum counter);
+char const* picoquic_metrics_gauge_name(picoquic_metric_gauge_enum gauge);
+char const* picoquic_metrics_histogram_name(picoquic_metric_histogram_enum histogram);
+/* Print the metrics as "name value" lines, one per line. */
+void picoquic_metrics_print(FILE* F, picoquic_metrics_segment_t const* segment);
+
+/* Data path updates, only active if metrics are enabled on the context. */
+#define PICOQUIC_METRICS_ADD(quic, counter, n) \
+    do { if ((quic)->metrics != NULL) { (quic)->metrics->counters[counter] += (n); } } while (0)
+#define PICOQUIC_METRICS_INC(quic, counter) PICOQUIC_METRICS_ADD(quic, counter, 1)
+#define PICOQUIC_METRICS_GAUGE_ADD(quic, gauge, n) \
+    do { if ((quic)->metrics != NULL) { (quic)->metrics->gauges[gauge] += (n); } } while (0)
+#define PICOQUIC_METRICS_RECORD(quic, histogram, value) \
+    do { if ((quic)->metrics != NULL) { picoquic_metrics_record((quic)->metrics, histogram, value); } } while (0)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PICOQUIC_METRICS_H */
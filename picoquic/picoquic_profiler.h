@@ -0,0 +1,88 @@
+/*
+* Hot path cycle profiler.
+*
+* When the stack is compiled with PICOQUIC_WITH_PROFILER (cmake option
+* ENABLE_PROFILER), the main processing stages are bracketed by macros
+* that read the CPU cycle counter and record the elapsed cycles in a
+* histogram per stage. The histograms are attached to the QUIC context,
+* and since each context is served by a single thread, there is one set
+* of histograms per worker and no locking. Recording only happens after
+* the profiler is enabled on the context.
+*
+* Stages are nested: incoming_packet contains incoming_segment, which
+* contains decode_frames; prepare_next_packet contains prepare_packet_ready,
+* which contains protect_packet. The cycles of a stage include those of
+* the stages that it contains.
+*
+* Without PICOQUIC_WITH_PROFILER, the macros expand to nothing and
+* picoquic_profiler_enable returns an error.
+*/
+#ifndef PICOQUIC_PROFILER_H
+#define PICOQUIC_PROFILER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "picoquic.h"
+#include "picoquic_metrics.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    picoquic_profile_incoming_packet = 0,
+    picoquic_profile_incoming_segment,
+    picoquic_profile_decode_frames,
+    picoquic_profile_prepare_next_packet,
+    picoquic_profile_prepare_packet_ready,
+    picoquic_profile_protect_packet,
+    picoquic_profile_stage_max
+} picoquic_profile_stage_enum;
+
+typedef struct st_picoquic_profiler_t {
+    uint64_t start_cycles;
+    uint64_t nb_packets_in;
+    uint64_t nb_packets_out;
+    FILE* F_print;
+    uint64_t print_interval;
+    uint64_t next_print_time;
+    picoquic_metrics_histogram_t stages[picoquic_profile_stage_max];
+} picoquic_profiler_t;
+
+/* Returns 1 if the profiling macros are compiled in the stack */
+int picoquic_profiler_is_compiled();
+int picoquic_profiler_enable(picoquic_quic_t* quic);
+void picoquic_profiler_disable(picoquic_quic_t* quic);
+void picoquic_profiler_reset(picoquic_quic_t* quic);
+picoquic_profiler_t const* picoquic_profiler_get(picoquic_quic_t* quic);
+char const* picoquic_profiler_stage_name(picoquic_profile_stage_enum stage);
+/* Print one line per stage: number of calls, average cycles per call,
+ * cycles per received or sent packet, percentiles and maximum. */
+void picoquic_profiler_print(FILE* F, picoquic_quic_t* quic);
+/* Print the profile to F every interval_usec, then reset it. The packet
+ * loops call picoquic_profiler_print_if_due once per iteration. */
+void picoquic_profiler_set_print_interval(picoquic_quic_t* quic, FILE* F, uint64_t interval_usec);
+void picoquic_profiler_print_if_due(picoquic_quic_t* quic, uint64_t current_time);
+
+#ifdef PICOQUIC_WITH_PROFILER
+#define PICOQUIC_PROFILE_BEGIN(quic, start) \
+    uint64_t start = ((quic)->profiler != NULL) ? picoquic_cpu_cycles() : 0
+#define PICOQUIC_PROFILE_END(quic, start, stage) \
+    do { if ((quic)->profiler != NULL && (start) != 0) { \
+        picoquic_metrics_histogram_add(&(quic)->profiler->stages[stage], picoquic_cpu_cycles() - (start)); } } while (0)
+#define PICOQUIC_PROFILE_PACKETS_IN(quic, n) \
+    do { if ((quic)->profiler != NULL) { (quic)->profiler->nb_packets_in += (n); } } while (0)
+#define PICOQUIC_PROFILE_PACKETS_OUT(quic, n) \
+    do { if ((quic)->profiler != NULL) { (quic)->profiler->nb_packets_out += (n); } } while (0)
+#else
+#define PICOQUIC_PROFILE_BEGIN(quic, start)
+#define PICOQUIC_PROFILE_END(quic, start, stage)
+#define PICOQUIC_PROFILE_PACKETS_IN(quic, n)
+#define PICOQUIC_PROFILE_PACKETS_OUT(quic, n)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PICOQUIC_PROFILER_H */
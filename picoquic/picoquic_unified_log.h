@@ -103,6 +103,9 @@ typedef void (*picoquic_log_close_connection_fn)(picoquic_cnx_t* cnx);
 /* log congestion control parameters */
 typedef void (*picoquic_log_cc_dump_fn)(picoquic_cnx_t* cnx, uint64_t current_time);
 
+/* log that a trigger fired, flushing the flight recorder if one is kept */
+typedef void (*picoquic_log_trigger_fn)(picoquic_cnx_t* cnx, char const* trigger_name, uint64_t current_time);
+
 typedef struct st_picoquic_unified_logging_t {
     /* Per context log function */
     picoquic_log_quic_app_message_fn log_quic_app_message;
@@ -121,8 +124,22 @@ typedef struct st_picoquic_unified_logging_t {
     picoquic_log_new_connection_fn log_new_connection;
     picoquic_log_close_connection_fn log_close_connection;
     picoquic_log_cc_dump_fn log_cc_dump;
+    picoquic_log_trigger_fn log_trigger;
 } picoquic_unified_logging_t;
 
+#define PICOQUIC_LOG_SPURIOUS_BURST 4 /* Spurious retransmissions within one RTT */
+#define PICOQUIC_LOG_THROUGHPUT_WINDOW 1000000ull /* Throughput measurement window, microseconds */
+
+/* A connection produces binary log records if it has a log file open, or
+ * if it keeps them in its flight recorder until a trigger fires */
+#define PICOQUIC_CNX_HAS_BINLOG(cnx) ((cnx)->f_binlog != NULL || (cnx)->flight_recorder != NULL)
+
+/* Check whether the connection is selected by the log sampling policy */
+int picoquic_log_is_sampled(picoquic_cnx_t* cnx);
+
+/* Signal an anomaly that may trigger logging of the connection */
+void picoquic_log_trigger(picoquic_cnx_t* cnx, picoquic_log_trigger_enum trigger, uint64_t current_time);
+
 /* Log an event that cannot be attached to a specific connection */
 void picoquic_log_context_free_app_message(picoquic_quic_t* quic, const picoquic_connection_id_t* cid, const char* fmt, ...);
 
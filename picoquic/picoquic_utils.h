@@ -241,6 +241,21 @@ void picoquic_delete_event(picoquic_event_t* event);
 int picoquic_signal_event(picoquic_event_t* event);
 int picoquic_wait_for_event(picoquic_event_t* event, uint64_t microsec_wait);
 
+/* Minimal atomic operations, for data shared between threads without locks */
+#ifdef _WINDOWS
+#define PICOQUIC_ATOMIC_LOAD_32(x) InterlockedCompareExchange((volatile LONG*)(x), 0, 0)
+#define PICOQUIC_ATOMIC_STORE_32(x, v) InterlockedExchange((volatile LONG*)(x), (LONG)(v))
+#define PICOQUIC_ATOMIC_CAS_32(x, e, v) (InterlockedCompareExchange((volatile LONG*)(x), (LONG)(v), (LONG)(e)) == (LONG)(e))
+#define PICOQUIC_ATOMIC_INC_64(x) ((uint64_t)InterlockedIncrement64((volatile LONG64*)(x)))
+#define PICOQUIC_MEMORY_FENCE() MemoryBarrier()
+#else
+#define PICOQUIC_ATOMIC_LOAD_32(x) __atomic_load_n((x), __ATOMIC_ACQUIRE)
+#define PICOQUIC_ATOMIC_STORE_32(x, v) __atomic_store_n((x), (v), __ATOMIC_RELEASE)
+#define PICOQUIC_ATOMIC_CAS_32(x, e, v) __atomic_compare_exchange_n((x), &(uint32_t){ (e) }, (v), 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)
+#define PICOQUIC_ATOMIC_INC_64(x) __atomic_add_fetch((x), 1, __ATOMIC_RELAXED)
+#define PICOQUIC_MEMORY_FENCE() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#endif
+
 /* Set of random number generation functions, designed for tests.
  * The random numbers are defined by a 64 bit context, initialized to a seed.
  * The same seed will always generate the same sequence.
@@ -270,6 +285,7 @@ typedef struct st_picoquictest_sim_packet_t {
     size_t length;
     struct sockaddr_storage addr_from;
     struct sockaddr_storage addr_to;
+    uint8_t ecn_mark;
     uint8_t bytes[PICOQUIC_MAX_PACKET_SIZE];
 } picoquictest_sim_packet_t;
 
@@ -282,6 +298,7 @@ typedef struct st_picoquictest_sim_link_t {
     uint64_t* loss_mask;
     uint64_t packets_dropped;
     uint64_t packets_sent;
+    uint64_t queue_delay_total; /* Sum of queuing delays of the packets sent, in microseconds */
     uint64_t jitter;
     uint64_t jitter_seed;
     size_t path_mtu;
@@ -297,6 +314,10 @@ typedef struct st_picoquictest_sim_link_t {
     uint64_t bucket_arrival_last;
     /* Variable for multipath simulation */
     int is_switched_off;
+    /* Variables for L4S style ECN marking: ECT packets are marked CE
+     * when the queue delay exceeds the threshold */
+    uint64_t ecn_mark_threshold;
+    uint64_t packets_ce_marked;
 } picoquictest_sim_link_t;
 
 picoquictest_sim_link_t* picoquictest_sim_link_create(double data_rate_in_gps,
@@ -347,7 +368,15 @@ void setup_pkt_udp_ip_headers(struct rte_ipv4_hdr *ip_hdr,
                               struct rte_udp_hdr *udp_hdr,
                               uint16_t pkt_data_len,
                               struct sockaddr_storage local_addr,
-                              struct sockaddr_storage peer_addr);
+                              struct sockaddr_storage peer_addr,
+                              uint8_t ecn_codepoint);
+
+void setup_pkt_udp_ip6_headers(struct rte_ipv6_hdr *ip_hdr,
+                              struct rte_udp_hdr *udp_hdr,
+                              uint16_t pkt_data_len,
+                              struct sockaddr_storage local_addr,
+                              struct sockaddr_storage peer_addr,
+                              uint8_t ecn_codepoint);
 
 
 void copy_buf_to_pkt(void *buf, unsigned len, struct rte_mbuf *pkt, unsigned offset);
\ No newline at end of file
@@ -523,6 +523,22 @@ void picoquic_socks_cmsg_format(
     size_t send_msg_size,
     struct sockaddr* addr_from,
     int dest_if)
+{
+    picoquic_socks_cmsg_format_ecn(vmsg, message_length, send_msg_size, addr_from, dest_if, 0);
+}
+
+/* Same as picoquic_socks_cmsg_format, but also sets the ECN codepoint of the
+ * packet if it differs from the ECT(0) default set on the socket by
+ * picoquic_socket_set_ecn_options. An ecn_codepoint of 0 means "use the
+ * socket default".
+ */
+void picoquic_socks_cmsg_format_ecn(
+    void* vmsg,
+    size_t message_length,
+    size_t send_msg_size,
+    struct sockaddr* addr_from,
+    int dest_if,
+    uint8_t ecn_codepoint)
 {
 #ifdef _WINDOWS
     WSAMSG* msg = (WSAMSG*)vmsg;
@@ -576,6 +592,20 @@ void picoquic_socks_cmsg_format(
             }
         }
     }
+#ifdef IP_ECN
+    if (!is_null && ecn_codepoint != 0 && ecn_codepoint != PICOQUIC_ECN_ECT_0 &&
+        addr_from != NULL && addr_from->sa_family != 0) {
+        INT* pecn = (INT*)cmsg_format_header_return_data_ptr(msg, &last_cmsg, &control_length,
+            (addr_from->sa_family == AF_INET) ? IPPROTO_IP : IPPROTO_IPV6,
+            (addr_from->sa_family == AF_INET) ? IP_ECN : IPV6_ECN, sizeof(INT));
+        if (pecn != NULL) {
+            *pecn = (INT)ecn_codepoint;
+        }
+        else {
+            is_null = 1;
+        }
+    }
+#endif
     if (!is_null && send_msg_size > 0 && send_msg_size < message_length) {
         DWORD* pdw = (DWORD*)cmsg_format_header_return_data_ptr(msg, &last_cmsg,
             &control_length, IPPROTO_UDP, UDP_SEND_MSG_SIZE, sizeof(DWORD));
@@ -657,6 +687,21 @@ void picoquic_socks_cmsg_format(
 #endif
         }
     }
+#if defined(IP_TOS) && defined(IPV6_TCLASS)
+    if (!is_null && ecn_codepoint != 0 && ecn_codepoint != PICOQUIC_ECN_ECT_0 &&
+        addr_from != NULL && addr_from->sa_family != 0) {
+        /* The traffic class is passed as an int for both IPv4 and IPv6 */
+        int* pval = (int*)cmsg_format_header_return_data_ptr(msg, &last_cmsg, &control_length,
+            (addr_from->sa_family == AF_INET) ? IPPROTO_IP : IPPROTO_IPV6,
+            (addr_from->sa_family == AF_INET) ? IP_TOS : IPV6_TCLASS, sizeof(int));
+        if (pval != NULL) {
+            *pval = (int)ecn_codepoint;
+        }
+        else {
+            is_null = 1;
+        }
+    }
+#endif
 #if defined(UDP_SEGMENT)
     if (!is_null && send_msg_size > 0 && send_msg_size < message_length) {
         uint16_t* pval = (uint16_t*)cmsg_format_header_return_data_ptr(msg, &last_cmsg,
@@ -1002,6 +1047,18 @@ int picoquic_sendmsg(SOCKET_TYPE fd,
     const char* bytes, int length,
     int send_msg_size,
     int * sock_err)
+{
+    return picoquic_sendmsg_ecn(fd, addr_dest, addr_from, dest_if, bytes, length, send_msg_size, 0, sock_err);
+}
+
+int picoquic_sendmsg_ecn(SOCKET_TYPE fd,
+    struct sockaddr* addr_dest,
+    struct sockaddr* addr_from,
+    int dest_if,
+    const char* bytes, int length,
+    int send_msg_size,
+    uint8_t ecn_codepoint,
+    int * sock_err)
 #ifdef _WINDOWS
 {
     GUID WSASendMsg_GUID = WSAID_WSASENDMSG;
@@ -1039,7 +1096,7 @@ int picoquic_sendmsg(SOCKET_TYPE fd,
         msg.Control.len = sizeof(cmsg_buffer);
 
         /* Format the control message */
-        picoquic_socks_cmsg_format(&msg, length, send_msg_size, addr_from, dest_if);
+        picoquic_socks_cmsg_format_ecn(&msg, length, send_msg_size, addr_from, dest_if, ecn_codepoint);
 
         /* Send the message */
         ret = WSASendMsg(fd, &msg, 0, &dwBytesSent, NULL, NULL);
@@ -1088,7 +1145,7 @@ int picoquic_sendmsg(SOCKET_TYPE fd,
     msg.msg_controllen = sizeof(cmsg_buffer);
 
     /* Format the control message */
-    picoquic_socks_cmsg_format(&msg, length, send_msg_size, addr_from, dest_if);
+    picoquic_socks_cmsg_format_ecn(&msg, length, send_msg_size, addr_from, dest_if, ecn_codepoint);
 
     bytes_sent = sendmsg(fd, &msg, 0);
 
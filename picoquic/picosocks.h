@@ -109,10 +109,6 @@
 #endif
 #endif
 
-#define PICOQUIC_ECN_ECT_0 0x02
-#define PICOQUIC_ECN_ECT_1 0x01
-#define PICOQUIC_ECN_CE 0x03
-
 #include "picoquic.h"
 
 #ifdef __cplusplus
@@ -219,6 +215,13 @@ int picoquic_sendmsg(SOCKET_TYPE fd,
     const char* bytes, int length,
     int send_msg_size, int * sock_err);
 
+int picoquic_sendmsg_ecn(SOCKET_TYPE fd,
+    struct sockaddr* addr_dest,
+    struct sockaddr* addr_from,
+    int dest_if,
+    const char* bytes, int length,
+    int send_msg_size, uint8_t ecn_codepoint, int * sock_err);
+
 int picoquic_send_through_socket(
     SOCKET_TYPE fd,
     struct sockaddr* addr_dest,
@@ -264,6 +267,14 @@ void picoquic_socks_cmsg_format(
     struct sockaddr* addr_from,
     int dest_if);
 
+void picoquic_socks_cmsg_format_ecn(
+    void* vmsg,
+    size_t message_length,
+    size_t send_msg_size,
+    struct sockaddr* addr_from,
+    int dest_if,
+    uint8_t ecn_codepoint);
+
 #ifdef __cplusplus
 }
 #endif
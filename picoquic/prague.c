@@ -0,0 +1,286 @@
+/* Prague congestion control.
+ *
+ * Scalable congestion control for L4S, in the style of TCP Prague (and
+ * DCTCP, from which it derives). Packets are sent with ECT(1), which tells
+ * L4S capable bottlenecks to mark CE as soon as a shallow queue builds up,
+ * instead of dropping packets. The sender maintains "alpha", a moving
+ * average of the fraction of CE marked packets, updated once per RTT with
+ * a gain of 1/16, and reduces the window in proportion to it:
+ *
+ *     cwin = cwin * (1 - alpha/2)
+ *
+ * at most once per RTT. A few marks thus cause a small reduction, and the
+ * queue stays short without sacrificing throughput. Window increase is Reno
+ * like, one packet per RTT, after a slow start that exits on the first CE
+ * mark or on a delay increase (Hystart). Packet losses and timeouts are
+ * treated as in New Reno, so the algorithm stays safe on classic bottlenecks.
+ *
+ * The CE fraction is computed from the ECN counts reported by the peer in
+ * ACK_ECN frames, in packets rather than bytes. All the arithmetic is integer,
+ * alpha being expressed in units of 1/PICOQUIC_PRAGUE_ALPHA_ONE.
+ */
+
+#include "picoquic_internal.h"
+#include <stdlib.h>
+#include <string.h>
+#include "cc_common.h"
+
+#define PICOQUIC_PRAGUE_ALPHA_SHIFT 20
+#define PICOQUIC_PRAGUE_ALPHA_ONE (1ull << PICOQUIC_PRAGUE_ALPHA_SHIFT)
+#define PICOQUIC_PRAGUE_G_SHIFT 4 /* EWMA gain g = 1/16 */
+#define PICOQUIC_PRAGUE_EPOCH_MIN 1000 /* Update alpha at most once per ms */
+
+typedef enum {
+    picoquic_prague_alg_slow_start = 0,
+    picoquic_prague_alg_congestion_avoidance
+} picoquic_prague_alg_state_t;
+
+typedef struct st_picoquic_prague_state_t {
+    picoquic_prague_alg_state_t alg_state;
+    uint64_t ssthresh;
+    uint64_t residual_ack;
+    uint64_t alpha;
+    uint64_t epoch_start;
+    uint64_t epoch_ect_base;
+    uint64_t epoch_ce_base;
+    uint64_t last_ce_reduction;
+    uint64_t recovery_start;
+    uint64_t recovery_sequence;
+    uint64_t nb_ce_reductions;
+    picoquic_min_max_rtt_t rtt_filter;
+} picoquic_prague_state_t;
+
+static void picoquic_prague_reset(picoquic_prague_state_t* pr_state, picoquic_path_t* path_x, uint64_t current_time)
+{
+    memset(pr_state, 0, sizeof(picoquic_prague_state_t));
+    pr_state->alg_state = picoquic_prague_alg_slow_start;
+    pr_state->ssthresh = UINT64_MAX;
+    /* Start with alpha = 1, so the first CE mark halves the window as in classic ECN */
+    pr_state->alpha = PICOQUIC_PRAGUE_ALPHA_ONE;
+    pr_state->epoch_start = current_time;
+    path_x->cwin = PICOQUIC_CWIN_INITIAL;
+}
+
+static void picoquic_prague_init(picoquic_path_t* path_x, uint64_t current_time)
+{
+    picoquic_prague_state_t* pr_state = (picoquic_prague_state_t*)malloc(sizeof(picoquic_prague_state_t));
+
+    if (pr_state != NULL) {
+        picoquic_prague_reset(pr_state, path_x, current_time);
+    }
+    path_x->congestion_alg_state = pr_state;
+}
+
+static void picoquic_prague_reduce_cwin(picoquic_prague_state_t* pr_state, picoquic_path_t* path_x, uint64_t current_time)
+{
+    uint64_t reduction = (path_x->cwin >> 1) * pr_state->alpha >> PICOQUIC_PRAGUE_ALPHA_SHIFT;
+
+    path_x->cwin = (path_x->cwin > reduction + PICOQUIC_CWIN_MINIMUM) ? path_x->cwin - reduction : PICOQUIC_CWIN_MINIMUM;
+    pr_state->ssthresh = path_x->cwin;
+    pr_state->alg_state = picoquic_prague_alg_congestion_avoidance;
+    pr_state->last_ce_reduction = current_time;
+    pr_state->residual_ack = 0;
+    pr_state->nb_ce_reductions++;
+}
+
+/* Once per RTT, update alpha with the fraction of CE marks reported since the
+ * start of the epoch: alpha += g * (fraction - alpha)
+ */
+static void picoquic_prague_update_alpha(picoquic_prague_state_t* pr_state, picoquic_cnx_t* cnx,
+    picoquic_path_t* path_x, uint64_t current_time)
+{
+    uint64_t epoch_duration = (path_x->smoothed_rtt > PICOQUIC_PRAGUE_EPOCH_MIN) ? path_x->smoothed_rtt : PICOQUIC_PRAGUE_EPOCH_MIN;
+
+    if (current_time >= pr_state->epoch_start + epoch_duration) {
+        picoquic_packet_context_t* pkt_ctx = &cnx->pkt_ctx[picoquic_packet_context_application];
+        uint64_t ce_total = pkt_ctx->ecn_ce_total_remote;
+        uint64_t ect_total = pkt_ctx->ecn_ect0_total_remote + pkt_ctx->ecn_ect1_total_remote + ce_total;
+        uint64_t nb_ce = ce_total - pr_state->epoch_ce_base;
+        uint64_t nb_ect = ect_total - pr_state->epoch_ect_base;
+
+        if (nb_ect > 0) {
+            uint64_t fraction = (nb_ce << PICOQUIC_PRAGUE_ALPHA_SHIFT) / nb_ect;
+
+            if (fraction >= pr_state->alpha) {
+                pr_state->alpha += (fraction - pr_state->alpha) >> PICOQUIC_PRAGUE_G_SHIFT;
+            }
+            else {
+                pr_state->alpha -= (pr_state->alpha - fraction) >> PICOQUIC_PRAGUE_G_SHIFT;
+            }
+        }
+        pr_state->epoch_ce_base = ce_total;
+        pr_state->epoch_ect_base = ect_total;
+        pr_state->epoch_start = current_time;
+    }
+}
+
+static void picoquic_prague_enter_recovery(picoquic_prague_state_t* pr_state, picoquic_cnx_t* cnx,
+    picoquic_path_t* path_x, picoquic_congestion_notification_t notification, uint64_t current_time)
+{
+    pr_state->ssthresh = path_x->cwin / 2;
+    if (pr_state->ssthresh < PICOQUIC_CWIN_MINIMUM) {
+        pr_state->ssthresh = PICOQUIC_CWIN_MINIMUM;
+    }
+
+    if (notification == picoquic_congestion_notification_timeout) {
+        path_x->cwin = PICOQUIC_CWIN_MINIMUM;
+        pr_state->alg_state = picoquic_prague_alg_slow_start;
+    }
+    else {
+        path_x->cwin = pr_state->ssthresh;
+        pr_state->alg_state = picoquic_prague_alg_congestion_avoidance;
+    }
+
+    pr_state->recovery_start = current_time;
+    pr_state->recovery_sequence = picoquic_cc_get_sequence_number(cnx, path_x);
+    pr_state->residual_ack = 0;
+}
+
+static void picoquic_prague_on_ack(picoquic_prague_state_t* pr_state, picoquic_cnx_t* cnx,
+    picoquic_path_t* path_x, uint64_t nb_bytes_acknowledged, uint64_t current_time)
+{
+    picoquic_prague_update_alpha(pr_state, cnx, path_x, current_time);
+    if (nb_bytes_acknowledged > 0 && path_x->last_time_acked_data_frame_sent > path_x->last_sender_limited_time) {
+        if (pr_state->alg_state == picoquic_prague_alg_slow_start) {
+            path_x->cwin += nb_bytes_acknowledged;
+            if (path_x->cwin >= pr_state->ssthresh) {
+                pr_state->alg_state = picoquic_prague_alg_congestion_avoidance;
+            }
+        }
+        else {
+            uint64_t complete_delta = nb_bytes_acknowledged * path_x->send_mtu + pr_state->residual_ack;
+            pr_state->residual_ack = complete_delta % path_x->cwin;
+            path_x->cwin += complete_delta / path_x->cwin;
+        }
+    }
+}
+
+/* React to the first CE mark of the round trip, in proportion to alpha */
+static void picoquic_prague_on_ce(picoquic_prague_state_t* pr_state, picoquic_path_t* path_x, uint64_t current_time)
+{
+    if (pr_state->alg_state == picoquic_prague_alg_slow_start ||
+        current_time - pr_state->last_ce_reduction > path_x->smoothed_rtt) {
+        picoquic_prague_reduce_cwin(pr_state, path_x, current_time);
+        path_x->is_ssthresh_initialized = 1;
+    }
+}
+
+/* Exit slow start on delay increase, if the bottleneck does not mark CE */
+static void picoquic_prague_on_rtt(picoquic_prague_state_t* pr_state, picoquic_cnx_t* cnx,
+    picoquic_path_t* path_x, uint64_t rtt_measurement, uint64_t one_way_delay, uint64_t current_time)
+{
+    if (pr_state->alg_state == picoquic_prague_alg_slow_start && pr_state->ssthresh == UINT64_MAX &&
+        picoquic_hystart_test(&pr_state->rtt_filter, (cnx->is_time_stamp_enabled) ? one_way_delay : rtt_measurement,
+            cnx->path[0]->pacing_packet_time_microsec, current_time, cnx->is_time_stamp_enabled)) {
+        pr_state->ssthresh = path_x->cwin;
+        pr_state->alg_state = picoquic_prague_alg_congestion_avoidance;
+        path_x->is_ssthresh_initialized = 1;
+    }
+}
+
+static void picoquic_prague_notify(
+    picoquic_cnx_t* cnx,
+    picoquic_path_t* path_x,
+    picoquic_congestion_notification_t notification,
+    uint64_t rtt_measurement,
+    uint64_t one_way_delay,
+    uint64_t nb_bytes_acknowledged,
+    uint64_t lost_packet_number,
+    uint64_t current_time)
+{
+#ifdef _WINDOWS
+    UNREFERENCED_PARAMETER(lost_packet_number);
+#endif
+    picoquic_prague_state_t* pr_state = (picoquic_prague_state_t*)path_x->congestion_alg_state;
+
+    path_x->is_cc_data_updated = 1;
+
+    if (pr_state != NULL) {
+        switch (notification) {
+        case picoquic_congestion_notification_acknowledgement:
+            picoquic_prague_on_ack(pr_state, cnx, path_x, nb_bytes_acknowledged, current_time);
+            break;
+        case picoquic_congestion_notification_ecn_ec:
+            picoquic_prague_on_ce(pr_state, path_x, current_time);
+            break;
+        case picoquic_congestion_notification_repeat:
+        case picoquic_congestion_notification_timeout:
+            if (current_time - pr_state->recovery_start > path_x->smoothed_rtt ||
+                pr_state->recovery_sequence <= picoquic_cc_get_ack_number(cnx, path_x)) {
+                picoquic_prague_enter_recovery(pr_state, cnx, path_x, notification, current_time);
+            }
+            break;
+        case picoquic_congestion_notification_rtt_measurement:
+            picoquic_prague_on_rtt(pr_state, cnx, path_x, rtt_measurement, one_way_delay, current_time);
+            break;
+        case picoquic_congestion_notification_reset:
+            picoquic_prague_reset(pr_state, path_x, current_time);
+            break;
+        case picoquic_congestion_notification_spurious_repeat:
+        case picoquic_congestion_notification_cwin_blocked:
+        case picoquic_congestion_notification_bw_measurement:
+        case picoquic_congestion_notification_seed_cwin:
+        default:
+            break;
+        }
+
+        picoquic_update_pacing_data(cnx, path_x, pr_state->alg_state == picoquic_prague_alg_slow_start &&
+            pr_state->ssthresh == UINT64_MAX);
+    }
+}
+
+/* Aggregated ACK event: one window update, one CE reaction and one pacing
+ * update for all the packets acknowledged in the ACK.
+ */
+static void picoquic_prague_notify_ack(
+    picoquic_cnx_t* cnx,
+    picoquic_path_t* path_x,
+    picoquic_per_ack_state_t const* ack_state,
+    uint64_t current_time)
+{
+    picoquic_prague_state_t* pr_state = (picoquic_prague_state_t*)path_x->congestion_alg_state;
+
+    path_x->is_cc_data_updated = 1;
+
+    if (pr_state != NULL) {
+        picoquic_prague_on_ack(pr_state, cnx, path_x, ack_state->nb_bytes_acknowledged, current_time);
+        if (ack_state->ecn_ce_delta > 0) {
+            picoquic_prague_on_ce(pr_state, path_x, current_time);
+        }
+        if (ack_state->is_rtt_updated) {
+            picoquic_prague_on_rtt(pr_state, cnx, path_x, ack_state->rtt_measurement, ack_state->one_way_delay, current_time);
+        }
+        picoquic_update_pacing_data(cnx, path_x, pr_state->alg_state == picoquic_prague_alg_slow_start &&
+            pr_state->ssthresh == UINT64_MAX);
+    }
+}
+
+static void picoquic_prague_delete(picoquic_path_t* path_x)
+{
+    if (path_x->congestion_alg_state != NULL) {
+        free(path_x->congestion_alg_state);
+        path_x->congestion_alg_state = NULL;
+    }
+}
+
+/* The observed parameter is alpha, in thousandths */
+static void picoquic_prague_observe(picoquic_path_t* path_x, uint64_t* cc_state, uint64_t* cc_param)
+{
+    picoquic_prague_state_t* pr_state = (picoquic_prague_state_t*)path_x->congestion_alg_state;
+    *cc_state = (uint64_t)pr_state->alg_state;
+    *cc_param = (pr_state->alpha * 1000) >> PICOQUIC_PRAGUE_ALPHA_SHIFT;
+}
+
+#define PICOQUIC_PRAGUE_ID "prague"
+
+picoquic_congestion_algorithm_t picoquic_prague_algorithm_struct = {
+    PICOQUIC_PRAGUE_ID, PICOQUIC_CC_ALGO_NUMBER_PRAGUE,
+    picoquic_prague_init,
+    picoquic_prague_notify,
+    picoquic_prague_delete,
+    picoquic_prague_observe,
+    1,
+    picoquic_prague_notify_ack
+};
+
+picoquic_congestion_algorithm_t* picoquic_prague_algorithm = &picoquic_prague_algorithm_struct;
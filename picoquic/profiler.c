@@ -0,0 +1,142 @@
+/*
+* Hot path cycle profiler.
+*
+* The cycle counts are recorded by the macros defined in
+* picoquic_profiler.h, in histograms attached to the QUIC context. This
+* file manages the profiler context and formats the per stage breakdown.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "picoquic_internal.h"
+#include "picoquic_utils.h"
+#include "picoquic_profiler.h"
+
+static char const* picoquic_profiler_stage_names[picoquic_profile_stage_max] = {
+    "incoming_packet",
+    "incoming_segment",
+    "decode_frames",
+    "prepare_next_packet",
+    "prepare_packet_ready",
+    "protect_packet"
+};
+
+int picoquic_profiler_is_compiled()
+{
+#ifdef PICOQUIC_WITH_PROFILER
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+int picoquic_profiler_enable(picoquic_quic_t* quic)
+{
+    int ret = 0;
+
+    if (!picoquic_profiler_is_compiled()) {
+        DBG_PRINTF("%s", "The stack was compiled without PICOQUIC_WITH_PROFILER\n");
+        ret = -1;
+    }
+    else if (quic->profiler == NULL) {
+        quic->profiler = (picoquic_profiler_t*)malloc(sizeof(picoquic_profiler_t));
+        if (quic->profiler == NULL) {
+            ret = PICOQUIC_ERROR_MEMORY;
+        }
+        else {
+            memset(quic->profiler, 0, sizeof(picoquic_profiler_t));
+            picoquic_profiler_reset(quic);
+        }
+    }
+
+    return ret;
+}
+
+void picoquic_profiler_disable(picoquic_quic_t* quic)
+{
+    if (quic->profiler != NULL) {
+        free(quic->profiler);
+        quic->profiler = NULL;
+    }
+}
+
+/* Clear the counters, but keep the print settings */
+void picoquic_profiler_reset(picoquic_quic_t* quic)
+{
+    picoquic_profiler_t* profiler = quic->profiler;
+
+    if (profiler != NULL) {
+        profiler->start_cycles = picoquic_cpu_cycles();
+        profiler->nb_packets_in = 0;
+        profiler->nb_packets_out = 0;
+        memset(profiler->stages, 0, sizeof(profiler->stages));
+    }
+}
+
+picoquic_profiler_t const* picoquic_profiler_get(picoquic_quic_t* quic)
+{
+    return quic->profiler;
+}
+
+char const* picoquic_profiler_stage_name(picoquic_profile_stage_enum stage)
+{
+    return (stage < picoquic_profile_stage_max) ? picoquic_profiler_stage_names[stage] : "unknown";
+}
+
+void picoquic_profiler_print(FILE* F, picoquic_quic_t* quic)
+{
+    picoquic_profiler_t const* profiler = quic->profiler;
+
+    if (profiler == NULL) {
+        return;
+    }
+
+    fprintf(F, "Profile: %" PRIu64 " cycles, %" PRIu64 " packets in, %" PRIu64 " packets out\n",
+        picoquic_cpu_cycles() - profiler->start_cycles, profiler->nb_packets_in, profiler->nb_packets_out);
+    fprintf(F, "%-22s %12s %12s %12s %10s %10s %10s %12s\n",
+        "stage", "calls", "cycles/call", "cycles/pkt", "p50", "p90", "p99", "max");
+    for (int i = 0; i < picoquic_profile_stage_max; i++) {
+        picoquic_metrics_histogram_t const* h = &profiler->stages[i];
+        /* Receive stages are averaged over the packets received, send stages over the packets sent */
+        uint64_t nb_packets = (i < picoquic_profile_prepare_next_packet) ?
+            profiler->nb_packets_in : profiler->nb_packets_out;
+
+        fprintf(F, "%-22s %12" PRIu64 " %12" PRIu64 " %12" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %12" PRIu64 "\n",
+            picoquic_profiler_stage_names[i], h->count,
+            (h->count > 0) ? h->sum / h->count : 0,
+            (nb_packets > 0) ? h->sum / nb_packets : 0,
+            picoquic_metrics_percentile(h, 50.0),
+            picoquic_metrics_percentile(h, 90.0),
+            picoquic_metrics_percentile(h, 99.0),
+            h->max);
+    }
+}
+
+void picoquic_profiler_set_print_interval(picoquic_quic_t* quic, FILE* F, uint64_t interval_usec)
+{
+    if (quic->profiler != NULL) {
+        quic->profiler->F_print = F;
+        quic->profiler->print_interval = interval_usec;
+        quic->profiler->next_print_time = 0;
+    }
+}
+
+void picoquic_profiler_print_if_due(picoquic_quic_t* quic, uint64_t current_time)
+{
+    picoquic_profiler_t* profiler = quic->profiler;
+
+    if (profiler != NULL && profiler->F_print != NULL && profiler->print_interval > 0) {
+        if (profiler->next_print_time == 0) {
+            /* First call, start the measurement period */
+            picoquic_profiler_reset(quic);
+            profiler->next_print_time = current_time + profiler->print_interval;
+        }
+        else if (current_time >= profiler->next_print_time) {
+            picoquic_profiler_print(profiler->F_print, quic);
+            fflush(profiler->F_print);
+            picoquic_profiler_reset(quic);
+            profiler->next_print_time = current_time + profiler->print_interval;
+        }
+    }
+}
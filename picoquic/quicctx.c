@@ -25,11 +25,17 @@
 #include "picoquic.h"
 #include "picoquic_internal.h"
 #include "picoquic_unified_log.h"
+#include "picoquic_binlog.h"
+#include "picoquic_metrics.h"
+#include "picoquic_profiler.h"
 #include "tls_api.h"
 #include <stdlib.h>
 #include <string.h>
 #ifndef _WINDOWS
 #include <sys/time.h>
+#include <time.h>
+#else
+#include <intrin.h>
 #endif
 
 
@@ -332,7 +338,7 @@ static int picoquic_issued_ticket_compare(const void* key1, const void* key2)
     return ret;
 }
 
-picoquic_issued_ticket_t* picoquic_retrieve_issued_ticket(picoquic_quic_t* quic,
+static picoquic_issued_ticket_t* picoquic_retrieve_local_issued_ticket(picoquic_quic_t* quic,
     uint64_t ticket_id)
 {
     picoquic_issued_ticket_t* ret = NULL;
@@ -391,6 +397,86 @@ static void picoquic_delete_issued_ticket(picoquic_quic_t* quic, picoquic_issued
     }
 }
 
+static picoquic_issued_ticket_t* picoquic_insert_issued_ticket(picoquic_quic_t* quic,
+    uint64_t ticket_id,
+    uint64_t rtt,
+    uint64_t cwin,
+    const uint8_t* ip_addr,
+    uint8_t ip_addr_length)
+{
+    picoquic_issued_ticket_t* ticket;
+
+    while (quic->table_issued_tickets_nb > quic->max_number_connections) {
+        picoquic_delete_issued_ticket(quic, quic->table_issued_tickets_last);
+    }
+    ticket = (picoquic_issued_ticket_t*)malloc(sizeof(picoquic_issued_ticket_t));
+    if (ticket != NULL) {
+        memset(ticket, 0, sizeof(picoquic_issued_ticket_t));
+        ticket->ticket_id = ticket_id;
+        picoquic_update_issued_ticket(ticket, rtt, cwin, ip_addr, ip_addr_length);
+        ticket->next_ticket = quic->table_issued_tickets_first;
+        quic->table_issued_tickets_first = ticket;
+        if (ticket->next_ticket == NULL) {
+            quic->table_issued_tickets_last = ticket;
+        }
+        else {
+            ticket->next_ticket->previous_ticket = ticket;
+        }
+        picohash_insert(quic->table_issued_tickets, ticket);
+    }
+
+    return ticket;
+}
+
+/* Issued tickets in the shared cache are keyed by 'S' and the ticket ID.
+ * The value contains the RTT, the CWIN and the client address.
+ */
+static size_t picoquic_issued_ticket_cache_key(uint8_t* key, uint64_t ticket_id)
+{
+    key[0] = 'S';
+    picoformat_64(key + 1, ticket_id);
+    return 9;
+}
+
+static void picoquic_cache_issued_ticket(picoquic_quic_t* quic, picoquic_issued_ticket_t* ticket)
+{
+    uint8_t key[9];
+    uint8_t value[8 + 8 + 1 + PICOQUIC_STORED_IP_MAX];
+    size_t key_length = picoquic_issued_ticket_cache_key(key, ticket->ticket_id);
+    uint64_t current_time = picoquic_get_quic_time(quic);
+
+    picoformat_64(value, ticket->rtt);
+    picoformat_64(value + 8, ticket->cwin);
+    value[16] = ticket->ip_addr_length;
+    memcpy(value + 17, ticket->ip_addr, ticket->ip_addr_length);
+    if (picoquic_ticket_cache_put(quic->ticket_cache, key, key_length, value, (size_t)17 + ticket->ip_addr_length,
+        current_time + PICOQUIC_TICKET_CACHE_ISSUED_TTL, current_time) != 0) {
+        DBG_PRINTF("Cannot store ticket 0x%" PRIx64 " in shared cache", ticket->ticket_id);
+    }
+}
+
+picoquic_issued_ticket_t* picoquic_retrieve_issued_ticket(picoquic_quic_t* quic,
+    uint64_t ticket_id)
+{
+    picoquic_issued_ticket_t* ret = picoquic_retrieve_local_issued_ticket(quic, ticket_id);
+
+    if (ret == NULL && quic->ticket_cache != NULL) {
+        /* The ticket may have been issued by another context sharing the cache */
+        uint8_t key[9];
+        uint8_t value[8 + 8 + 1 + PICOQUIC_STORED_IP_MAX];
+        size_t key_length = picoquic_issued_ticket_cache_key(key, ticket_id);
+        size_t value_length = 0;
+
+        if (picoquic_ticket_cache_get(quic->ticket_cache, key, key_length, value, sizeof(value), &value_length,
+            picoquic_get_quic_time(quic)) == 0 && value_length >= 17 &&
+            value_length == (size_t)17 + value[16]) {
+            ret = picoquic_insert_issued_ticket(quic, ticket_id, PICOPARSE_64(value), PICOPARSE_64(value + 8),
+                value + 17, value[16]);
+        }
+    }
+    return ret;
+}
+
 int picoquic_remember_issued_ticket(picoquic_quic_t* quic,
     uint64_t ticket_id,
     uint64_t rtt,
@@ -400,38 +486,27 @@ int picoquic_remember_issued_ticket(picoquic_quic_t* quic,
 {
     int ret = 0;
 
-    picoquic_issued_ticket_t* ticket = picoquic_retrieve_issued_ticket(quic,
+    picoquic_issued_ticket_t* ticket = picoquic_retrieve_local_issued_ticket(quic,
         ticket_id);
     if (ticket != NULL) {
         picoquic_update_issued_ticket(ticket, rtt, cwin, ip_addr, ip_addr_length);
     }
-    else {
-        while (quic->table_issued_tickets_nb > quic->max_number_connections) {
-            picoquic_delete_issued_ticket(quic, quic->table_issued_tickets_last);
-        }
-        ticket = (picoquic_issued_ticket_t*)malloc(sizeof(picoquic_issued_ticket_t));
-        if (ticket != NULL) {
-            memset(ticket, 0, sizeof(picoquic_issued_ticket_t));
-            ticket->ticket_id = ticket_id;
-            picoquic_update_issued_ticket(ticket, rtt, cwin, ip_addr, ip_addr_length);
-            ticket->next_ticket = quic->table_issued_tickets_first;
-            quic->table_issued_tickets_first = ticket;
-            if (ticket->next_ticket == NULL) {
-                quic->table_issued_tickets_last = ticket;
-            }
-            else {
-                ticket->next_ticket->previous_ticket = ticket;
-            }
-            picohash_insert(quic->table_issued_tickets, ticket);
-        }
-        else {
-            ret = PICOQUIC_ERROR_MEMORY;
-        }
+    else if ((ticket = picoquic_insert_issued_ticket(quic, ticket_id, rtt, cwin, ip_addr, ip_addr_length)) == NULL) {
+        ret = PICOQUIC_ERROR_MEMORY;
+    }
+
+    if (ticket != NULL && quic->ticket_cache != NULL) {
+        picoquic_cache_issued_ticket(quic, ticket);
     }
 
     return ret;
 }
 
+void picoquic_set_ticket_cache(picoquic_quic_t* quic, picoquic_ticket_cache_t* cache)
+{
+    quic->ticket_cache = cache;
+}
+
 /* Token reuse management */
 
 static int64_t picoquic_registered_token_compare(void* l, void* r)
@@ -553,6 +628,7 @@ picoquic_quic_t* picoquic_create(uint32_t max_nb_connections,
         quic->default_callback_fn = default_callback_fn;
         quic->default_callback_ctx = default_callback_ctx;
         quic->default_congestion_alg = PICOQUIC_DEFAULT_CONGESTION_ALGORITHM;
+        quic->default_path_scheduler = PICOQUIC_DEFAULT_PATH_SCHEDULER;
         quic->default_alpn = picoquic_string_duplicate(default_alpn);
         quic->cnx_id_callback_fn = cnx_id_callback;
         quic->cnx_id_callback_ctx = cnx_id_callback_ctx;
@@ -562,11 +638,14 @@ picoquic_quic_t* picoquic_create(uint32_t max_nb_connections,
         quic->padding_minsize_default = PICOQUIC_RESET_PACKET_MIN_SIZE;
         quic->crypto_epoch_length_max = 0;
         quic->max_simultaneous_logs = PICOQUIC_DEFAULT_SIMULTANEOUS_LOGS;
+        quic->log_sample_one_in = 1;
         quic->max_half_open_before_retry = PICOQUIC_DEFAULT_HALF_OPEN_RETRY_THRESHOLD;
         quic->default_lossbit_policy = 0; /* For compatibility with old behavior. Consider 0 */
         quic->local_cnxid_ttl = UINT64_MAX;
         quic->stateless_reset_next_time = current_time;
         quic->stateless_reset_min_interval = PICOQUIC_MICROSEC_STATELESS_RESET_INTERVAL_DEFAULT;
+        quic->stateless_rate_per_second = 0; /* no per source limit unless set by the application */
+        quic->stateless_rate_burst = 1;
         picoquic_wake_list_init(quic);
 
         if (cnx_id_callback != NULL) {
@@ -613,12 +692,21 @@ picoquic_quic_t* picoquic_create(uint32_t max_nb_connections,
             picosplay_init_tree(&quic->token_reuse_tree, picoquic_registered_token_compare,
                 picoquic_registered_token_create, picoquic_registered_token_delete, picoquic_registered_token_value);
 
+            quic->stateless_packet_pool = (picoquic_stateless_packet_t*)malloc(
+                sizeof(picoquic_stateless_packet_t) * PICOQUIC_STATELESS_PACKET_POOL_SIZE);
+            quic->stateless_rate_buckets = (picoquic_stateless_rate_bucket_t*)calloc(
+                PICOQUIC_STATELESS_RATE_BUCKETS, sizeof(picoquic_stateless_rate_bucket_t));
+
             if (quic->table_cnx_by_id == NULL || quic->table_cnx_by_net == NULL ||
                 quic->table_cnx_by_icid == NULL || quic->table_cnx_by_secret == NULL ||
                 quic->table_issued_tickets == NULL) {
                 ret = -1;
                 DBG_PRINTF("%s", "Cannot initialize hash tables\n");
             }
+            else if (quic->stateless_packet_pool == NULL || quic->stateless_rate_buckets == NULL) {
+                ret = -1;
+                DBG_PRINTF("%s", "Cannot allocate stateless packet pool\n");
+            }
             else if (picoquic_master_tlscontext(quic, cert_file_name, key_file_name, cert_root_file_name, ticket_encryption_key, ticket_encryption_key_length) != 0) {
                 ret = -1;
                 DBG_PRINTF("%s", "Cannot create TLS context \n");
@@ -636,6 +724,12 @@ picoquic_quic_t* picoquic_create(uint32_t max_nb_connections,
                     memcpy(quic->reset_seed, reset_seed, sizeof(quic->reset_seed));
 
                 picoquic_crypto_random(quic, quic->retry_seed, sizeof(quic->retry_seed));
+                quic->stateless_rate_seed = picoquic_public_random_64();
+
+                for (int i = PICOQUIC_STATELESS_PACKET_POOL_SIZE - 1; i >= 0; i--) {
+                    quic->stateless_packet_pool[i].next_packet = quic->stateless_packet_free;
+                    quic->stateless_packet_free = &quic->stateless_packet_pool[i];
+                }
 
                 /* If there is no root certificate context specified, use a null certifier. */
             }
@@ -754,6 +848,18 @@ void picoquic_set_max_simultaneous_logs(picoquic_quic_t* quic, uint32_t max_simu
     quic->max_simultaneous_logs = max_simultaneous_logs;
 }
 
+void picoquic_set_log_sampling(picoquic_quic_t* quic, uint32_t one_in_n)
+{
+    quic->log_sample_one_in = one_in_n;
+}
+
+void picoquic_set_flight_recorder(picoquic_quic_t* quic, size_t nb_events, uint32_t trigger_mask, uint64_t min_throughput)
+{
+    quic->flight_recorder_events = nb_events;
+    quic->log_trigger_mask = trigger_mask;
+    quic->log_trigger_min_throughput = min_throughput;
+}
+
 uint32_t picoquic_get_max_simultaneous_logs(picoquic_quic_t* quic)
 {
     return quic->max_simultaneous_logs;
@@ -777,6 +883,14 @@ void picoquic_free(picoquic_quic_t* quic)
 
         /* Delete TLS and AEAD cntexts */
         picoquic_delete_retry_protection_contexts(quic);
+        picoquic_delete_crypto_provider(quic);
+        picoquic_delete_sign_offload(quic);
+        picoquic_binlog_writer_delete(quic->binlog_writer);
+        quic->binlog_writer = NULL;
+        picoquic_metrics_disable(quic);
+        picoquic_profiler_disable(quic);
+        picoquic_pacing_wheel_delete(quic->pacing_wheel);
+        quic->pacing_wheel = NULL;
 
         if (quic->aead_encrypt_ticket_ctx != NULL) {
             picoquic_aead_free(quic->aead_encrypt_ticket_ctx);
@@ -820,11 +934,23 @@ void picoquic_free(picoquic_quic_t* quic)
             quic->nb_data_nodes_in_pool--;
         }
 
-        /* delete all pending stateless packets */
+        /* delete all pending stateless packets, then the pool */
         while (quic->pending_stateless_packet != NULL) {
             picoquic_stateless_packet_t* to_delete = quic->pending_stateless_packet;
             quic->pending_stateless_packet = to_delete->next_packet;
-            free(to_delete);
+            picoquic_delete_stateless_packet(to_delete);
+        }
+        quic->pending_stateless_last = NULL;
+
+        if (quic->stateless_packet_pool != NULL) {
+            free(quic->stateless_packet_pool);
+            quic->stateless_packet_pool = NULL;
+            quic->stateless_packet_free = NULL;
+        }
+
+        if (quic->stateless_rate_buckets != NULL) {
+            free(quic->stateless_rate_buckets);
+            quic->stateless_rate_buckets = NULL;
         }
 
         if (quic->table_cnx_by_id != NULL) {
@@ -914,29 +1040,57 @@ uint32_t picoquic_get_max_half_open_retry_threshold(picoquic_quic_t* quic)
     return quic->max_half_open_before_retry;
 }
 
+picoquic_stateless_packet_t* picoquic_get_pooled_stateless_packet(picoquic_quic_t* quic)
+{
+    picoquic_stateless_packet_t* sp = quic->stateless_packet_free;
+
+    if (sp != NULL) {
+        quic->stateless_packet_free = sp->next_packet;
+        sp->next_packet = NULL;
+        sp->pool_quic = quic;
+    }
+
+    return sp;
+}
+
 picoquic_stateless_packet_t* picoquic_create_stateless_packet(picoquic_quic_t* quic)
 {
-#ifdef _WINDOWS
-    UNREFERENCED_PARAMETER(quic);
-#endif
-    return (picoquic_stateless_packet_t*)malloc(sizeof(picoquic_stateless_packet_t));
+    picoquic_stateless_packet_t* sp = picoquic_get_pooled_stateless_packet(quic);
+
+    if (sp == NULL) {
+        sp = (picoquic_stateless_packet_t*)malloc(sizeof(picoquic_stateless_packet_t));
+        if (sp != NULL) {
+            sp->next_packet = NULL;
+            sp->pool_quic = NULL;
+        }
+    }
+
+    return sp;
 }
 
 void picoquic_delete_stateless_packet(picoquic_stateless_packet_t* sp)
 {
-    free(sp);
+    if (sp->pool_quic != NULL) {
+        picoquic_quic_t* quic = sp->pool_quic;
+        sp->pool_quic = NULL;
+        sp->next_packet = quic->stateless_packet_free;
+        quic->stateless_packet_free = sp;
+    }
+    else {
+        free(sp);
+    }
 }
 
 void picoquic_queue_stateless_packet(picoquic_quic_t* quic, picoquic_stateless_packet_t* sp)
 {
-    picoquic_stateless_packet_t** pnext = &quic->pending_stateless_packet;
-
-    while ((*pnext) != NULL) {
-        pnext = &(*pnext)->next_packet;
-    }
-
-    *pnext = sp;
     sp->next_packet = NULL;
+    if (quic->pending_stateless_packet == NULL) {
+        quic->pending_stateless_packet = sp;
+    }
+    else {
+        quic->pending_stateless_last->next_packet = sp;
+    }
+    quic->pending_stateless_last = sp;
 }
 
 picoquic_stateless_packet_t* picoquic_dequeue_stateless_packet(picoquic_quic_t* quic)
@@ -945,6 +1099,9 @@ picoquic_stateless_packet_t* picoquic_dequeue_stateless_packet(picoquic_quic_t*
 
     if (sp != NULL) {
         quic->pending_stateless_packet = sp->next_packet;
+        if (quic->pending_stateless_packet == NULL) {
+            quic->pending_stateless_last = NULL;
+        }
         sp->next_packet = NULL;
         picoquic_log_quic_pdu(quic, 0, picoquic_get_quic_time(quic), sp->cnxid_log64,
             (struct sockaddr*) & sp->addr_to, (struct sockaddr*) & sp->addr_local, sp->length);
@@ -953,10 +1110,25 @@ picoquic_stateless_packet_t* picoquic_dequeue_stateless_packet(picoquic_quic_t*
     return sp;
 }
 
+void picoquic_set_stateless_rate_limit(picoquic_quic_t* quic, uint32_t max_per_second, uint32_t max_burst)
+{
+    quic->stateless_rate_per_second = max_per_second;
+    quic->stateless_rate_burst = (max_burst == 0) ? 1 : max_burst;
+    memset(quic->stateless_rate_buckets, 0, PICOQUIC_STATELESS_RATE_BUCKETS * sizeof(picoquic_stateless_rate_bucket_t));
+}
+
+void picoquic_get_prefilter_stats(picoquic_quic_t* quic, picoquic_prefilter_stats_t* stats)
+{
+    *stats = quic->prefilter_stats;
+}
+
+/* Connections with a flight recorder are not limited to the first packets,
+ * since the recorder must hold the events that precede a trigger. */
 int picoquic_cnx_is_still_logging(picoquic_cnx_t* cnx)
 {
     int ret =
-        (cnx->nb_packets_logged < PICOQUIC_LOG_PACKET_MAX_SEQUENCE || cnx->quic->use_long_log);
+        (cnx->nb_packets_logged < PICOQUIC_LOG_PACKET_MAX_SEQUENCE || cnx->quic->use_long_log ||
+            cnx->flight_recorder != NULL);
 
     return ret;
 }
@@ -966,6 +1138,7 @@ int picoquic_register_cnx_id(picoquic_quic_t* quic, picoquic_cnx_t* cnx, picoqui
 {
     int ret = 0;
     picohash_item* item;
+    uint64_t profile_start = (quic->setup_profile != NULL) ? picoquic_cpu_cycles() : 0;
     picoquic_cnx_id_key_t* key = (picoquic_cnx_id_key_t*)malloc(sizeof(picoquic_cnx_id_key_t));
 
     if (key == NULL) {
@@ -990,6 +1163,11 @@ int picoquic_register_cnx_id(picoquic_quic_t* quic, picoquic_cnx_t* cnx, picoqui
         }
     }
 
+    if (quic->setup_profile != NULL) {
+        quic->setup_profile->hash_insert_cycles += picoquic_cpu_cycles() - profile_start;
+        quic->setup_profile->nb_hash_insert++;
+    }
+
     return ret;
 }
 
@@ -997,6 +1175,7 @@ int picoquic_register_net_id(picoquic_quic_t* quic, picoquic_cnx_t* cnx, picoqui
 {
     int ret = 0;
     picohash_item* item;
+    uint64_t profile_start = (quic->setup_profile != NULL) ? picoquic_cpu_cycles() : 0;
     picoquic_net_id_key_t* key = (picoquic_net_id_key_t*)malloc(sizeof(picoquic_net_id_key_t));
 
     if (key == NULL) {
@@ -1026,6 +1205,11 @@ int picoquic_register_net_id(picoquic_quic_t* quic, picoquic_cnx_t* cnx, picoqui
         free(key);
     }
 
+    if (quic->setup_profile != NULL) {
+        quic->setup_profile->hash_insert_cycles += picoquic_cpu_cycles() - profile_start;
+        quic->setup_profile->nb_hash_insert++;
+    }
+
     return ret;
 }
 
@@ -1061,6 +1245,7 @@ int picoquic_register_net_icid(picoquic_cnx_t* cnx)
 {
     int ret = 0;
     picohash_item* item;
+    uint64_t profile_start = (cnx->quic->setup_profile != NULL) ? picoquic_cpu_cycles() : 0;
     picoquic_net_icid_key_t* key = (picoquic_net_icid_key_t*)malloc(sizeof(picoquic_net_icid_key_t));
 
     if (key == NULL) {
@@ -1091,6 +1276,11 @@ int picoquic_register_net_icid(picoquic_cnx_t* cnx)
         free(key);
     }
 
+    if (cnx->quic->setup_profile != NULL) {
+        cnx->quic->setup_profile->hash_insert_cycles += picoquic_cpu_cycles() - profile_start;
+        cnx->quic->setup_profile->nb_hash_insert++;
+    }
+
     return ret;
 }
 
@@ -1098,6 +1288,7 @@ int picoquic_register_net_secret(picoquic_cnx_t* cnx)
 {
     int ret = 0;
     picohash_item* item;
+    uint64_t profile_start = (cnx->quic->setup_profile != NULL) ? picoquic_cpu_cycles() : 0;
     picoquic_net_secret_key_t* key = (picoquic_net_secret_key_t*)malloc(sizeof(picoquic_net_secret_key_t));
 
     if (key == NULL) {
@@ -1131,6 +1322,11 @@ int picoquic_register_net_secret(picoquic_cnx_t* cnx)
         free(key);
     }
 
+    if (cnx->quic->setup_profile != NULL) {
+        cnx->quic->setup_profile->hash_insert_cycles += picoquic_cpu_cycles() - profile_start;
+        cnx->quic->setup_profile->nb_hash_insert++;
+    }
+
     return ret;
 }
 
@@ -1251,12 +1447,19 @@ static void picoquic_wake_list_init(picoquic_quic_t * quic)
 
 static void picoquic_remove_cnx_from_wake_list(picoquic_cnx_t* cnx)
 {
-    picosplay_delete_hint(&cnx->quic->cnx_wake_tree, &cnx->cnx_wake_node);
+    if (cnx->is_in_pacing_wheel) {
+        picoquic_pacing_wheel_remove(cnx->quic->pacing_wheel, cnx);
+    }
+    else {
+        picosplay_delete_hint(&cnx->quic->cnx_wake_tree, &cnx->cnx_wake_node);
+    }
 }
 
 static void picoquic_insert_cnx_by_wake_time(picoquic_quic_t* quic, picoquic_cnx_t* cnx)
 {
-    picosplay_insert(&quic->cnx_wake_tree, cnx);
+    if (quic->pacing_wheel == NULL || picoquic_pacing_wheel_insert(quic->pacing_wheel, cnx) != 0) {
+        picosplay_insert(&quic->cnx_wake_tree, cnx);
+    }
 }
 
 void picoquic_reinsert_by_wake_time(picoquic_quic_t* quic, picoquic_cnx_t* cnx, uint64_t next_time)
@@ -1274,6 +1477,17 @@ picoquic_cnx_t* picoquic_get_earliest_cnx_to_wake(picoquic_quic_t* quic, uint64_
     //     cnx = NULL;
     // }
 
+    if (quic->pacing_wheel != NULL) {
+        uint64_t wheel_time = UINT64_MAX;
+        picoquic_cnx_t* wheel_cnx;
+
+        picoquic_pacing_wheel_drain(quic->pacing_wheel, max_wake_time);
+        wheel_cnx = picoquic_pacing_wheel_first(quic->pacing_wheel, &wheel_time);
+        if (wheel_cnx != NULL && (cnx == NULL || wheel_time <= cnx->next_wake_time)) {
+            cnx = wheel_cnx;
+        }
+    }
+
     return cnx;
 }
 
@@ -1291,6 +1505,22 @@ uint64_t picoquic_get_next_wake_time(picoquic_quic_t* quic, uint64_t current_tim
         if (cnx_wake_first != NULL) {
             wake_time = cnx_wake_first->next_wake_time;
         }
+
+        if (quic->pacing_wheel != NULL) {
+            uint64_t wheel_time = UINT64_MAX;
+
+            picoquic_pacing_wheel_drain(quic->pacing_wheel, current_time);
+            if (picoquic_pacing_wheel_first(quic->pacing_wheel, &wheel_time) != NULL &&
+                wheel_time < wake_time) {
+                wake_time = wheel_time;
+            }
+        }
+    }
+
+    if (quic->sign_offload != NULL && picoquic_has_pending_signatures(quic) &&
+        wake_time > current_time + PICOQUIC_SIGN_OFFLOAD_POLL_INTERVAL) {
+        /* Completed signatures are collected when preparing packets */
+        wake_time = current_time + PICOQUIC_SIGN_OFFLOAD_POLL_INTERVAL;
     }
 
     return wake_time;
@@ -1309,6 +1539,45 @@ int64_t picoquic_get_next_wake_delay(picoquic_quic_t* quic,
     return wake_delay;
 }
 
+int picoquic_enable_pacing_wheel(picoquic_quic_t* quic, uint64_t slot_usec, size_t nb_slots)
+{
+    int ret = 0;
+
+    if (quic->pacing_wheel != NULL) {
+        /* Return the scheduled connections to the wake time tree */
+        picoquic_cnx_t* cnx = quic->cnx_list;
+
+        while (cnx != NULL) {
+            if (cnx->is_in_pacing_wheel) {
+                picoquic_pacing_wheel_remove(quic->pacing_wheel, cnx);
+                picosplay_insert(&quic->cnx_wake_tree, cnx);
+            }
+            cnx = cnx->next_in_table;
+        }
+        picoquic_pacing_wheel_delete(quic->pacing_wheel);
+        quic->pacing_wheel = NULL;
+    }
+
+    if (slot_usec > 0) {
+        /* Connections move to the wheel the next time they are rescheduled */
+        if ((quic->pacing_wheel = picoquic_pacing_wheel_create(slot_usec, nb_slots)) == NULL) {
+            ret = PICOQUIC_ERROR_MEMORY;
+        }
+    }
+
+    return ret;
+}
+
+void picoquic_get_pacing_wheel_stats(picoquic_quic_t* quic, picoquic_pacing_wheel_stats_t* stats)
+{
+    if (quic->pacing_wheel == NULL) {
+        memset(stats, 0, sizeof(picoquic_pacing_wheel_stats_t));
+    }
+    else {
+        *stats = quic->pacing_wheel->stats;
+    }
+}
+
 static uint64_t picoquic_get_wake_time(picoquic_cnx_t* cnx, uint64_t current_time)
 {
     uint64_t wake_time = UINT64_MAX;
@@ -1435,6 +1704,7 @@ int picoquic_create_path(picoquic_cnx_t* cnx, uint64_t start_time, const struct
             /* Record the path */
             cnx->path[cnx->nb_paths] = path_x;
             ret = cnx->nb_paths++;
+            cnx->is_path_sched_cache_valid = 0;
         }
     }
 
@@ -1478,6 +1748,8 @@ static void picoquic_clear_path_data(picoquic_cnx_t* cnx, picoquic_path_t * path
     if (cnx->congestion_alg != NULL) {
         cnx->congestion_alg->alg_delete(path_x);
     }
+    /* Remove the datagram copies queued by the redundant scheduler */
+    picoquic_delete_redundant_datagrams(path_x);
 
     /* Free the record */
     free(path_x);
@@ -1557,6 +1829,7 @@ void picoquic_delete_path(picoquic_cnx_t* cnx, int path_index)
 
     /* Remove old path data from retransmit queue */
     picoquic_empty_path_packet_queue(path_x);
+    cnx->loss_detection_epoch++;
     /* Remove old path data from retransmitted queue */
     /* TODO: what if using multiple number spaces? */
     for (picoquic_packet_context_enum pc = 0; pc < picoquic_nb_packet_context; pc++)
@@ -1582,6 +1855,7 @@ void picoquic_delete_path(picoquic_cnx_t* cnx, int path_index)
 
     cnx->nb_paths--;
     cnx->path[cnx->nb_paths] = NULL;
+    cnx->is_path_sched_cache_valid = 0;
 }
 
 /*
@@ -1662,6 +1936,7 @@ void picoquic_demote_path(picoquic_cnx_t* cnx, int path_index, uint64_t current_
         cnx->path[path_index]->path_is_demoted = 1;
         cnx->path[path_index]->demotion_time = current_time + 3* demote_timer;
         cnx->path_demotion_needed = 1;
+        cnx->is_path_sched_cache_valid = 0;
     }
 }
 
@@ -1684,7 +1959,7 @@ void picoquic_promote_path_to_default(picoquic_cnx_t* cnx, int path_index, uint6
             }
         }
 
-        if (cnx->quic->F_log != NULL || cnx->f_binlog != NULL) {
+        if (cnx->quic->F_log != NULL || PICOQUIC_CNX_HAS_BINLOG(cnx)) {
             char src_ip[128];
             char dst_ip[128];
 
@@ -1705,6 +1980,7 @@ void picoquic_promote_path_to_default(picoquic_cnx_t* cnx, int path_index, uint6
         /* Swap */
         cnx->path[path_index] = cnx->path[0];
         cnx->path[0] = path_x;
+        cnx->is_path_sched_cache_valid = 0;
 
         /* Update the secret */
         (void)picoquic_register_net_secret(cnx);
@@ -1718,6 +1994,7 @@ void picoquic_set_path_challenge(picoquic_cnx_t* cnx, int path_id, uint64_t curr
         /* Reset the path challenge */
         cnx->path[path_id]->challenge_required = 1;
         cnx->path[path_id]->challenge_time_first = current_time;
+        cnx->is_path_sched_cache_valid = 0;
         for (int ichal = 0; ichal < PICOQUIC_CHALLENGE_REPEAT_MAX; ichal++) {
             if (cnx->quic->use_constant_challenges) {
                 cnx->path[path_id]->challenge[ichal] = current_time*(0xdeadbeefull + ichal);
@@ -1842,6 +2119,7 @@ void picoquic_notify_destination_unreachable(picoquic_cnx_t* cnx, uint64_t curre
             cnx->path[path_id]->path_is_demoted = 1;
             cnx->path[path_id]->demotion_time = current_time;
             cnx->path_demotion_needed = 1;
+            cnx->is_path_sched_cache_valid = 0;
 
             for (int i = 0; no_path_left && i < cnx->nb_paths; i++) {
                 no_path_left &= cnx->path[i]->path_is_demoted;         
@@ -2030,6 +2308,7 @@ void picoquic_init_packet_ctx(picoquic_cnx_t* cnx, picoquic_packet_context_t* pk
     }
     pkt_ctx->retransmit_newest = NULL;
     pkt_ctx->retransmit_oldest = NULL;
+    memset(&pkt_ctx->loss_timer, 0, sizeof(picoquic_loss_timer_t));
     pkt_ctx->highest_acknowledged = pkt_ctx->send_sequence - 1;
     pkt_ctx->latest_time_acknowledged = cnx->start_time;
     pkt_ctx->highest_acknowledged_time = cnx->start_time;
@@ -2485,7 +2764,9 @@ void picoquic_clear_stream(picoquic_stream_head_t* stream)
 static void picoquic_stream_node_delete(void * tree, picosplay_node_t * node)
 {
     picoquic_stream_head_t * stream = picoquic_stream_node_value(node);
+    picoquic_cnx_t* cnx = (picoquic_cnx_t*)((char*)tree - offsetof(struct st_picoquic_cnx_t, stream_tree));
 
+    PICOQUIC_METRICS_GAUGE_ADD(cnx->quic, picoquic_metric_streams, -1);
     picoquic_clear_stream(stream);
 
     free(stream);
@@ -2641,6 +2922,7 @@ picoquic_stream_head_t* picoquic_create_stream(picoquic_cnx_t* cnx, uint64_t str
         picosplay_init_tree(&stream->stream_data_tree, picoquic_stream_data_node_compare, picoquic_stream_data_node_create, picoquic_stream_data_node_delete, picoquic_stream_data_node_value);
 
         picosplay_insert(&cnx->stream_tree, stream);
+        PICOQUIC_METRICS_GAUGE_ADD(cnx->quic, picoquic_metric_streams, 1);
         if (is_output_stream) {
             picoquic_insert_output_stream(cnx, stream);
         }
@@ -2955,6 +3237,8 @@ picoquic_cnx_t* picoquic_create_cnx(picoquic_quic_t* quic,
     const struct sockaddr* addr_to, uint64_t start_time, uint32_t preferred_version,
     char const* sni, char const* alpn, char client_mode)
 {
+    uint64_t profile_start = (quic->setup_profile != NULL) ? picoquic_cpu_cycles() : 0;
+    uint64_t profile_insert = (quic->setup_profile != NULL) ? quic->setup_profile->hash_insert_cycles : 0;
     picoquic_cnx_t* cnx = (picoquic_cnx_t*)malloc(sizeof(picoquic_cnx_t));
 
     if (cnx != NULL) {
@@ -2963,6 +3247,7 @@ picoquic_cnx_t* picoquic_create_cnx(picoquic_quic_t* quic,
 
         memset(cnx, 0, sizeof(picoquic_cnx_t));
         cnx->start_time = start_time;
+        cnx->limit_state_time = start_time;
         cnx->phase_delay = INT64_MAX;
         cnx->client_mode = client_mode;
         if (client_mode) {
@@ -3086,7 +3371,10 @@ picoquic_cnx_t* picoquic_create_cnx(picoquic_quic_t* quic,
         cnx->callback_fn = quic->default_callback_fn;
         cnx->callback_ctx = quic->default_callback_ctx;
         cnx->congestion_alg = quic->default_congestion_alg;
+        cnx->path_scheduler = quic->default_path_scheduler;
         cnx->is_preemptive_repeat_enabled = quic->is_preemptive_repeat_enabled;
+        cnx->is_ack_autotune_enabled = quic->is_ack_autotune_enabled;
+        cnx->ack_autotune_cycles_budget = quic->ack_autotune_cycles_budget;
         cnx->is_flow_control_limited = quic->is_flow_control_limited;
 
         /* Initialize key rotation interval to default value */
@@ -3234,6 +3522,12 @@ picoquic_cnx_t* picoquic_create_cnx(picoquic_quic_t* quic,
         picoquic_log_new_connection(cnx);
     }
 
+    if (quic->setup_profile != NULL) {
+        quic->setup_profile->cnx_create_cycles += picoquic_cpu_cycles() - profile_start -
+            (quic->setup_profile->hash_insert_cycles - profile_insert);
+        quic->setup_profile->nb_cnx_create++;
+    }
+
     return cnx;
 }
 
@@ -3453,6 +3747,27 @@ uint64_t picoquic_current_time()
     return now;
 }
 
+/*
+ * Provide a cycle counter for profiling. On platforms without a readable
+ * counter, fall back to nanoseconds of monotonic time.
+ */
+uint64_t picoquic_cpu_cycles()
+{
+#if defined(_WINDOWS)
+    return __rdtsc();
+#elif defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#elif defined(__aarch64__)
+    uint64_t cycles;
+    __asm__ volatile("mrs %0, cntvct_el0" : "=r"(cycles));
+    return cycles;
+#else
+    struct timespec ts;
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000ull) + (uint64_t)ts.tv_nsec;
+#endif
+}
+
 /*
 * Get the same time simulation as used for TLS
 */
@@ -3778,6 +4093,8 @@ int picoquic_connection_error_ex(picoquic_cnx_t* cnx, uint64_t local_error, uint
             cnx->cnx_state = picoquic_state_handshake_failure;
 
             picoquic_log_app_message(cnx, "Protocol error 0x%x", local_error);
+            picoquic_log_trigger(cnx, picoquic_log_trigger_handshake_failure, picoquic_get_quic_time(cnx->quic));
+            PICOQUIC_METRICS_INC(cnx->quic, picoquic_metric_handshakes_failed);
             DBG_PRINTF("Protocol error %x", local_error);
         }
     }
@@ -3866,12 +4183,18 @@ void picoquic_delete_cnx(picoquic_cnx_t* cnx)
             cnx->sni = NULL;
         }
 
+        if (cnx->cached_ticket != NULL) {
+            free(cnx->cached_ticket);
+            cnx->cached_ticket = NULL;
+        }
+
         if (cnx->retry_token != NULL) {
             free(cnx->retry_token);
             cnx->retry_token = NULL;
         }
 
         picoquic_delete_sooner_packets(cnx);
+        picoquic_crypto_async_delete_cnx(cnx);
 
         picoquic_remove_cnx_from_list(cnx);
         picoquic_remove_cnx_from_wake_list(cnx);
@@ -4066,12 +4389,54 @@ picoquic_congestion_algorithm_t const* picoquic_get_congestion_algorithm(char co
         else if (strcmp(alg_name, "bbr") == 0) {
             alg = picoquic_bbr_algorithm;
         }
+        else if (strcmp(alg_name, "prague") == 0) {
+            alg = picoquic_prague_algorithm;
+        }
+        else if (strcmp(alg_name, "bbr3") == 0) {
+            alg = picoquic_bbr3_algorithm;
+        }
         else {
             alg = NULL;
         }
     }
     return alg;
 }
+
+/* Get multipath scheduler by name */
+picoquic_path_scheduler_t const* picoquic_get_path_scheduler(char const* scheduler_name)
+{
+    picoquic_path_scheduler_t const* scheduler = NULL;
+    if (scheduler_name != NULL) {
+        if (strcmp(scheduler_name, "lru") == 0) {
+            scheduler = picoquic_lru_path_scheduler;
+        }
+        else if (strcmp(scheduler_name, "minrtt") == 0) {
+            scheduler = picoquic_minrtt_path_scheduler;
+        }
+        else if (strcmp(scheduler_name, "weighted") == 0) {
+            scheduler = picoquic_weighted_path_scheduler;
+        }
+        else if (strcmp(scheduler_name, "redundant") == 0) {
+            scheduler = picoquic_redundant_path_scheduler;
+        }
+        else if (strcmp(scheduler_name, "ecf") == 0) {
+            scheduler = picoquic_ecf_path_scheduler;
+        }
+    }
+    return scheduler;
+}
+
+uint8_t picoquic_get_ecn_codepoint(picoquic_cnx_t* cnx)
+{
+    uint8_t ecn_codepoint = PICOQUIC_ECN_ECT_0;
+
+    if (cnx != NULL && cnx->congestion_alg != NULL && cnx->congestion_alg->use_l4s_ecn) {
+        ecn_codepoint = PICOQUIC_ECN_ECT_1;
+    }
+
+    return ecn_codepoint;
+}
+
 /*
  * Set or reset the congestion control algorithm
  */
@@ -4086,6 +4451,25 @@ void picoquic_set_default_congestion_algorithm_by_name(picoquic_quic_t* quic, ch
     quic->default_congestion_alg = picoquic_get_congestion_algorithm(alg_name);
 }
 
+/*
+ * Set the multipath scheduler. NULL selects the default scheduler.
+ */
+
+void picoquic_set_default_path_scheduler(picoquic_quic_t* quic, picoquic_path_scheduler_t const* scheduler)
+{
+    quic->default_path_scheduler = (scheduler == NULL) ? PICOQUIC_DEFAULT_PATH_SCHEDULER : scheduler;
+}
+
+void picoquic_set_path_scheduler(picoquic_cnx_t* cnx, picoquic_path_scheduler_t const* scheduler)
+{
+    cnx->path_scheduler = (scheduler == NULL) ? PICOQUIC_DEFAULT_PATH_SCHEDULER : scheduler;
+    cnx->path_sched_virtual_clock = 0;
+    for (int i = 0; i < cnx->nb_paths; i++) {
+        cnx->path[i]->sched_virtual_time = 0;
+        picoquic_delete_redundant_datagrams(cnx->path[i]);
+    }
+}
+
 /*
  * Set the optimistic ack policy
  */
@@ -4105,6 +4489,19 @@ void picoquic_set_preemptive_repeat_per_cnx(picoquic_cnx_t* cnx, int do_repeat)
     cnx->is_preemptive_repeat_enabled = (do_repeat) ? 1 : 0;
 }
 
+void picoquic_set_default_ack_autotune(picoquic_quic_t* quic, int is_enabled, uint64_t ack_cycles_budget)
+{
+    quic->is_ack_autotune_enabled = (is_enabled) ? 1 : 0;
+    quic->ack_autotune_cycles_budget = ack_cycles_budget;
+}
+
+void picoquic_set_ack_autotune(picoquic_cnx_t* cnx, int is_enabled, uint64_t ack_cycles_budget)
+{
+    cnx->is_ack_autotune_enabled = (is_enabled) ? 1 : 0;
+    cnx->ack_autotune_cycles_budget = ack_cycles_budget;
+    cnx->is_ack_frequency_updated = cnx->is_ack_frequency_negotiated;
+}
+
 void picoquic_set_congestion_algorithm(picoquic_cnx_t* cnx, picoquic_congestion_algorithm_t const* alg)
 {
     if (cnx->congestion_alg != NULL) {
@@ -4240,6 +4637,37 @@ uint64_t picoquic_get_data_received(picoquic_cnx_t* cnx)
     return cnx->data_received;
 }
 
+uint64_t picoquic_get_limit_time(picoquic_cnx_t* cnx, picoquic_limit_state_enum state, uint64_t current_time)
+{
+    uint64_t limit_time = 0;
+
+    if ((unsigned int)state < picoquic_limit_max) {
+        limit_time = cnx->limit_time[state];
+        if (state == cnx->limit_state && current_time > cnx->limit_state_time) {
+            limit_time += current_time - cnx->limit_state_time;
+        }
+    }
+    return limit_time;
+}
+
+char const* picoquic_limit_state_name(picoquic_limit_state_enum state)
+{
+    switch (state) {
+    case picoquic_limit_handshake: return "handshake";
+    case picoquic_limit_amplification: return "amplification";
+    case picoquic_limit_none: return "none";
+    case picoquic_limit_application: return "application";
+    case picoquic_limit_cwin: return "cwin";
+    case picoquic_limit_pacing: return "pacing";
+    case picoquic_limit_flow_control: return "flow_control";
+    case picoquic_limit_stream_flow_control: return "stream_flow_control";
+    case picoquic_limit_closing: return "closing";
+    default:
+        break;
+    }
+    return "unknown";
+}
+
 void picoquic_set_client_authentication(picoquic_quic_t* quic, int client_authentication) {
     picoquic_tls_set_client_authentication(quic, client_authentication);
 }
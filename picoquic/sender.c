@@ -21,6 +21,8 @@
 
 #include "picoquic_internal.h"
 #include "picoquic_unified_log.h"
+#include "picoquic_metrics.h"
+#include "picoquic_profiler.h"
 #include "tls_api.h"
 #include <stdlib.h>
 #include <string.h>
@@ -398,6 +400,7 @@ picoquic_packet_t* picoquic_create_packet(picoquic_quic_t * quic)
     picoquic_packet_t* packet = quic->p_first_packet;
     
     if (packet == NULL) {
+        PICOQUIC_METRICS_INC(quic, picoquic_metric_pool_exhausted);
         packet = (picoquic_packet_t*)malloc(sizeof(picoquic_packet_t));
         if (packet != NULL) {
             quic->nb_packets_allocated++;
@@ -698,6 +701,94 @@ size_t picoquic_get_checksum_length(picoquic_cnx_t* cnx, picoquic_epoch_enum epo
     return ret;
 }
 
+/* Header protection. The sample is located after the pn_offset, assuming a
+ * packet number length of 4 bytes.
+ */
+static void picoquic_protect_packet_header(uint8_t* send_buffer, size_t pn_offset, uint8_t first_mask, void* pn_enc)
+{
+    size_t sample_offset = pn_offset + 4;
+    uint8_t mask_bytes[5] = { 0, 0, 0, 0, 0 };
+    uint8_t pn_l;
+
+    picoquic_pn_encrypt(pn_enc, send_buffer + sample_offset, mask_bytes, mask_bytes, 5);
+    /* Encode the first byte */
+    pn_l = (send_buffer[0] & 3) + 1;
+    send_buffer[0] ^= (mask_bytes[0] & first_mask);
+
+    /* Packet encoding is 1 to 4 bytes */
+    for (uint8_t i = 0; i < pn_l; i++) {
+        send_buffer[pn_offset + i] ^= mask_bytes[i + 1];
+    }
+}
+
+/* Record the protection of a 1-RTT packet for asynchronous submission.
+ * The payload is copied after the header in the send buffer, where it
+ * will be encrypted in place once the send buffer is copied to a protected
+ * datagram.
+ */
+static size_t picoquic_record_async_protection(picoquic_cnx_t* cnx, uint8_t* bytes, uint64_t sequence_number,
+    size_t length, size_t header_length, uint8_t* send_buffer, size_t h_length, size_t pn_offset,
+    uint8_t first_mask, void* aead_context, void* pn_enc, picoquic_path_t* path_x)
+{
+    picoquic_async_protection_t* protection = &cnx->quic->crypto_async_records[cnx->quic->nb_crypto_async_records++];
+
+    memset(protection, 0, sizeof(picoquic_async_protection_t));
+    memcpy(send_buffer + h_length, bytes + header_length, length - header_length);
+    protection->job.output = send_buffer + h_length;
+    protection->job.input = send_buffer + h_length;
+    protection->job.input_length = length - header_length;
+    protection->job.auth_data = send_buffer;
+    protection->job.auth_data_length = h_length;
+    protection->job.seq_num = sequence_number;
+    protection->job.aead_context = aead_context;
+    protection->job.is_encrypt = 1;
+    if (cnx->is_multipath_enabled) {
+        protection->job.is_multipath = 1;
+        protection->job.path_id = path_x->p_remote_cnxid->sequence;
+    }
+    protection->packet = send_buffer;
+    protection->pn_offset = pn_offset;
+    protection->expected_length = length - header_length + picoquic_aead_get_checksum_length(aead_context);
+    protection->pn_enc = pn_enc;
+    protection->first_mask = first_mask;
+
+    return protection->expected_length;
+}
+
+/* Complete the protection of a packet once its AEAD job is done. */
+void picoquic_protected_datagram_job_complete(picoquic_async_protection_t* protection)
+{
+    picoquic_protected_datagram_t* datagram = protection->datagram;
+
+    if (protection->job.result != protection->expected_length) {
+        datagram->is_failed = 1;
+    }
+    else {
+        picoquic_protect_packet_header(protection->packet, protection->pn_offset, protection->first_mask,
+            protection->pn_enc);
+    }
+    datagram->nb_pending--;
+}
+
+/* Protect in line the packets recorded in the current batch. This is used
+ * before releasing the keys that the recorded jobs refer to, or if the
+ * datagram cannot be queued.
+ */
+void picoquic_flush_async_protections(picoquic_cnx_t* cnx)
+{
+    picoquic_quic_t* quic = cnx->quic;
+
+    if (quic->is_crypto_async_recording) {
+        for (size_t i = 0; i < quic->nb_crypto_async_records; i++) {
+            picoquic_async_protection_t* protection = &quic->crypto_async_records[i];
+            (void)quic->crypto_provider->provider_process(quic->crypto_provider_ctx, &protection->job);
+            picoquic_protect_packet_header(protection->packet, protection->pn_offset, protection->first_mask,
+                protection->pn_enc);
+        }
+        quic->nb_crypto_async_records = 0;
+    }
+}
+
 static size_t picoquic_protect_packet(picoquic_cnx_t* cnx, 
     picoquic_packet_type_enum ptype,
     uint8_t * bytes, 
@@ -710,10 +801,11 @@ static size_t picoquic_protect_packet(picoquic_cnx_t* cnx,
     size_t send_length;
     size_t h_length;
     size_t pn_offset = 0;
-    size_t sample_offset = 0;
     size_t pn_length = 0;
     size_t aead_checksum_length = picoquic_aead_get_checksum_length(aead_context);
     uint8_t first_mask = 0x0F;
+    int is_recorded = 0;
+    PICOQUIC_PROFILE_BEGIN(cnx->quic, profile_start);
 
     /* Create the packet header just before encrypting the content */
     h_length = picoquic_create_packet_header(cnx, ptype,
@@ -760,16 +852,28 @@ static size_t picoquic_protect_packet(picoquic_cnx_t* cnx,
         }
     }
 
-    /* Encrypt the packet */
-    if (cnx->is_multipath_enabled && ptype == picoquic_packet_1rtt_protected) {
-        send_length = picoquic_aead_encrypt_mp(send_buffer + /* header_length */ h_length,
-            bytes + header_length, length - header_length, path_x->p_remote_cnxid->sequence,
+    /* Encrypt the packet, or defer encryption if the provider is asynchronous */
+    is_recorded = (ptype == picoquic_packet_1rtt_protected && cnx->quic->is_crypto_async_recording &&
+        cnx->quic->nb_crypto_async_records < PICOQUIC_CRYPTO_ASYNC_MAX_JOBS);
+    if (!is_recorded && ptype == picoquic_packet_1rtt_protected && cnx->nb_crypto_jobs_in_flight > 0) {
+        /* The AEAD context is not thread safe. Complete the jobs that use it
+         * before encrypting in line, e.g., when the batch is full. */
+        picoquic_crypto_async_wait_cnx(cnx);
+    }
+
+    if (is_recorded) {
+        send_length = picoquic_record_async_protection(cnx, bytes, sequence_number, length, header_length,
+            send_buffer, h_length, pn_offset, first_mask, aead_context, pn_enc, path_x);
+    }
+    else if (cnx->is_multipath_enabled && ptype == picoquic_packet_1rtt_protected) {
+        send_length = picoquic_aead_encrypt_packet(cnx->quic, send_buffer + /* header_length */ h_length,
+            bytes + header_length, length - header_length, 1, path_x->p_remote_cnxid->sequence,
             sequence_number, send_buffer, /* header_length */ h_length, aead_context);
 
     }
     else {
-        send_length = picoquic_aead_encrypt_generic(send_buffer + /* header_length */ h_length,
-            bytes + header_length, length - header_length,
+        send_length = picoquic_aead_encrypt_packet(cnx->quic, send_buffer + /* header_length */ h_length,
+            bytes + header_length, length - header_length, 0, 0,
             sequence_number, send_buffer, /* header_length */ h_length, aead_context);
     }
 
@@ -780,26 +884,13 @@ static size_t picoquic_protect_packet(picoquic_cnx_t* cnx,
         bytes, sequence_number, pn_length, length,
         send_buffer, send_length, current_time);
 
-    /* Next, encrypt the PN -- The sample is located after the pn_offset */
-    sample_offset = /* header_length */ pn_offset + 4;
-
-    if (pn_offset < sample_offset)
-    {
-        /* This is always true, as use pn_length = 4 */
-        uint8_t mask_bytes[5] = { 0, 0, 0, 0, 0 };
-        uint8_t pn_l;
-
-        picoquic_pn_encrypt(pn_enc, send_buffer + sample_offset, mask_bytes, mask_bytes, 5);
-        /* Encode the first byte */
-        pn_l = (send_buffer[0] & 3) + 1;
-        send_buffer[0] ^= (mask_bytes[0] & first_mask);
-
-        /* Packet encoding is 1 to 4 bytes */
-        for (uint8_t i = 0; i < pn_l; i++) {
-            send_buffer[pn_offset+i] ^= mask_bytes[i+1];
-        }
+    /* Next, encrypt the PN, unless this waits for the asynchronous encryption */
+    if (!is_recorded) {
+        picoquic_protect_packet_header(send_buffer, pn_offset, first_mask, pn_enc);
     }
 
+    PICOQUIC_PROFILE_END(cnx->quic, profile_start, picoquic_profile_protect_packet);
+
     return send_length;
 }
 
@@ -860,15 +951,45 @@ int picoquic_is_sending_authorized_by_pacing(picoquic_cnx_t * cnx, picoquic_path
     return ret;
 }
 
+/*
+ * Packet train budget. When the stack runs in packet train mode and the caller
+ * accepts batches of packets, compute once per wakeup how many full size packets
+ * the pacing bucket and the congestion window allow, capped by the size of the
+ * send buffer. While the budget is not exhausted, each packet of the batch is
+ * known to pass the pacing and congestion checks, so these checks are skipped.
+ * The train ends early if there is no more data to send.
+ */
+static uint64_t picoquic_compute_train_budget(picoquic_path_t* path_x, size_t send_buffer_max, uint64_t current_time)
+{
+    uint64_t budget = 0;
+
+    picoquic_update_pacing_bucket(path_x, current_time);
+
+    if (path_x->pacing_packet_time_nanosec > 0 && path_x->pacing_bucket_nanosec > 0 &&
+        path_x->cwin > path_x->bytes_in_transit && path_x->send_mtu > 0) {
+        uint64_t nb_cwin = (path_x->cwin - path_x->bytes_in_transit) / path_x->send_mtu;
+        uint64_t nb_buffer = send_buffer_max / path_x->send_mtu;
+
+        budget = (uint64_t)(path_x->pacing_bucket_nanosec / path_x->pacing_packet_time_nanosec);
+        if (budget > nb_cwin) {
+            budget = nb_cwin;
+        }
+        if (budget > nb_buffer) {
+            budget = nb_buffer;
+        }
+    }
+
+    return budget;
+}
+
 /* Reset the pacing data after recomputing the pacing rate
  */
-void picoquic_update_pacing_rate(picoquic_cnx_t * cnx, picoquic_path_t* path_x, double pacing_rate, uint64_t quantum)
+static void picoquic_set_pacing_parameters(picoquic_cnx_t* cnx, picoquic_path_t* path_x, uint64_t pacing_rate, uint64_t quantum,
+    int64_t packet_time_nanosec, int64_t quantum_time_nanosec)
 {
-    double packet_time = (double)path_x->send_mtu / pacing_rate;
-    double quantum_time = (double)quantum / pacing_rate;
     uint64_t rtt_nanosec = path_x->smoothed_rtt * 1000;
 
-    path_x->pacing_rate = (uint64_t)pacing_rate;
+    path_x->pacing_rate = pacing_rate;
 
     if (quantum > path_x->pacing_quantum_max) {
         path_x->pacing_quantum_max = quantum;
@@ -877,7 +998,7 @@ void picoquic_update_pacing_rate(picoquic_cnx_t * cnx, picoquic_path_t* path_x,
         path_x->pacing_rate_max = path_x->pacing_rate;
     }
 
-    path_x->pacing_packet_time_nanosec = (uint64_t)(packet_time * 1000000000.0);
+    path_x->pacing_packet_time_nanosec = packet_time_nanosec;
 
     if (path_x->pacing_packet_time_nanosec <= 0) {
         path_x->pacing_packet_time_nanosec = 1;
@@ -890,7 +1011,7 @@ void picoquic_update_pacing_rate(picoquic_cnx_t * cnx, picoquic_path_t* path_x,
         path_x->pacing_packet_time_microsec = (path_x->pacing_packet_time_nanosec + 999ull) / 1000;
     }
 
-    path_x->pacing_bucket_max = (uint64_t)(quantum_time * 1000000000.0);
+    path_x->pacing_bucket_max = quantum_time_nanosec;
     if (path_x->pacing_bucket_max <= 0) {
         path_x->pacing_bucket_max = 16 * path_x->pacing_packet_time_nanosec;
     }
@@ -911,6 +1032,26 @@ void picoquic_update_pacing_rate(picoquic_cnx_t * cnx, picoquic_path_t* path_x,
     }
 }
 
+void picoquic_update_pacing_rate(picoquic_cnx_t * cnx, picoquic_path_t* path_x, double pacing_rate, uint64_t quantum)
+{
+    double packet_time = (double)path_x->send_mtu / pacing_rate;
+    double quantum_time = (double)quantum / pacing_rate;
+
+    picoquic_set_pacing_parameters(cnx, path_x, (uint64_t)pacing_rate, quantum,
+        (uint64_t)(packet_time * 1000000000.0), (uint64_t)(quantum_time * 1000000000.0));
+}
+
+/* Same as picoquic_update_pacing_rate, for algorithms that compute the rate
+ * in integer bytes per second and avoid floating point in the ACK path.
+ */
+void picoquic_update_pacing_rate_int(picoquic_cnx_t* cnx, picoquic_path_t* path_x, uint64_t pacing_rate, uint64_t quantum)
+{
+    if (pacing_rate > 0) {
+        picoquic_set_pacing_parameters(cnx, path_x, pacing_rate, quantum,
+            (int64_t)((path_x->send_mtu * 1000000000ull) / pacing_rate), (int64_t)((quantum * 1000000000ull) / pacing_rate));
+    }
+}
+
 /*
  * Reset the pacing data after CWIN is updated.
  * The max bucket is set to contain at least 2 packets more than 1/8th of the congestion window.
@@ -1019,6 +1160,8 @@ picoquic_packet_t* picoquic_dequeue_retransmit_packet(picoquic_cnx_t* cnx,
 {
     size_t dequeued_length = p->length + p->checksum_overhead;
 
+    cnx->loss_detection_epoch++;
+
     if (p->is_queued_for_retransmit) {
         /* Remove from list */
         if (p->previous_packet == NULL) {
@@ -1495,12 +1638,52 @@ int picoquic_copy_before_retransmit(picoquic_packet_t * old_p,
     return ret;
 }
 
+/* Loss detection timers.
+ * The time at which the oldest packet in a queue may be declared lost only moves
+ * earlier when an ACK is received, when the RTT estimates are updated, or when
+ * packets are removed from the queue. All these events increment the connection's
+ * loss detection epoch. In between, the time computed for the oldest packet is
+ * kept in the queue's loss timer, and the prepare calls skip the loss detection
+ * entirely until that time. A sender with a large window and no losses then pays
+ * a single comparison per call instead of the per packet RACK computations.
+ * Caching a time that is too early is harmless, the full check then runs.
+ */
+static void picoquic_loss_timer_set(picoquic_cnx_t* cnx, picoquic_loss_timer_t* loss_timer,
+    picoquic_packet_context_enum pc, uint64_t check_time)
+{
+    if (cnx->cnx_state < picoquic_state_client_ready_start) {
+        /* The retransmit timer cap changes at the end of the handshake, do not cache. */
+        return;
+    }
+    loss_timer->check_time = check_time;
+    loss_timer->epoch = cnx->loss_detection_epoch;
+    loss_timer->pc = pc;
+}
+
+static int picoquic_loss_timer_is_pending(picoquic_cnx_t* cnx, picoquic_loss_timer_t* loss_timer,
+    picoquic_packet_context_enum pc, uint64_t current_time, uint64_t* next_wake_time)
+{
+    int is_pending = 0;
+
+    if (loss_timer->epoch == cnx->loss_detection_epoch && loss_timer->pc == pc &&
+        current_time < loss_timer->check_time && !cnx->initial_repeat_needed) {
+        is_pending = 1;
+        cnx->nb_loss_checks_skipped++;
+        if (loss_timer->check_time < *next_wake_time) {
+            *next_wake_time = loss_timer->check_time;
+            SET_LAST_WAKE(cnx->quic, PICOQUIC_SENDER);
+        }
+    }
+
+    return is_pending;
+}
+
 static int picoquic_retransmit_needed_packet(picoquic_cnx_t* cnx, picoquic_packet_context_t* pkt_ctx,
     picoquic_packet_t* old_p,
     picoquic_packet_context_enum pc,
     picoquic_path_t* path_x, uint64_t current_time, uint64_t* next_wake_time,
     picoquic_packet_t* packet, size_t send_buffer_max, size_t* header_length,
-    int* continue_next)
+    picoquic_loss_timer_t* loss_timer, int* continue_next)
 {
     size_t length = 0;
     *continue_next = 0;
@@ -1533,6 +1716,10 @@ static int picoquic_retransmit_needed_packet(picoquic_cnx_t* cnx, picoquic_packe
                 *next_wake_time = next_retransmit_time;
                 SET_LAST_WAKE(cnx->quic, PICOQUIC_SENDER);
             }
+            if (loss_timer != NULL) {
+                /* The queue is processed in order, nothing happens before this packet is due */
+                picoquic_loss_timer_set(cnx, loss_timer, pc, next_retransmit_time);
+            }
             /* Will not continue */
             *continue_next = 0;
         }
@@ -1663,6 +1850,8 @@ static int picoquic_retransmit_needed_packet(picoquic_cnx_t* cnx, picoquic_packe
                         old_p->send_time > old_path->last_loss_event_detected) {
                         old_path->nb_retransmit++;
                         old_path->last_loss_event_detected = current_time;
+                        cnx->is_path_sched_cache_valid = 0;
+                        picoquic_log_trigger(cnx, picoquic_log_trigger_rto, current_time);
                         if (old_path->nb_retransmit > 7) {
                             /* Max retransmission reached for this path */
                             DBG_PRINTF("%s\n", "Too many data retransmits, abandon path");
@@ -1713,6 +1902,7 @@ static int picoquic_retransmit_needed_packet(picoquic_cnx_t* cnx, picoquic_packe
                     }
                     packet->length = length;
                     cnx->nb_retransmission_total++;
+                    PICOQUIC_METRICS_INC(cnx->quic, picoquic_metric_retransmits);
 
                     if (old_path != NULL) {
                         old_path->nb_losses_found++;
@@ -1761,11 +1951,18 @@ static int picoquic_retransmit_needed_loop(picoquic_cnx_t* cnx, picoquic_packet_
     int ret = 0;
     picoquic_packet_t* old_p = pkt_ctx->retransmit_oldest;
 
+    if (old_p == NULL ||
+        picoquic_loss_timer_is_pending(cnx, &pkt_ctx->loss_timer, pc, current_time, next_wake_time)) {
+        return 0;
+    }
+    cnx->nb_loss_checks++;
+
     /* Call the per packet routine in a loop */
     while (old_p != 0 && continue_next) {
         picoquic_packet_t* p_next = old_p->previous_packet;
         ret = picoquic_retransmit_needed_packet(cnx, pkt_ctx, old_p, pc, path_x, current_time,
-            next_wake_time, packet, send_buffer_max, header_length, &continue_next);
+            next_wake_time, packet, send_buffer_max, header_length,
+            (old_p == pkt_ctx->retransmit_oldest) ? &pkt_ctx->loss_timer : NULL, &continue_next);
         old_p = p_next;
     }
 
@@ -1793,7 +1990,8 @@ int picoquic_retransmit_needed(picoquic_cnx_t* cnx,
                 int timer_based_retransmit = 0;
                 uint64_t next_retransmit_time = *next_wake_time;
 
-                if (r_cid->pkt_ctx.retransmit_oldest != NULL) {
+                if (r_cid->pkt_ctx.retransmit_oldest != NULL &&
+                    !picoquic_loss_timer_is_pending(cnx, &r_cid->pkt_ctx.loss_timer, pc, current_time, next_wake_time)) {
                     if (picoquic_retransmit_needed_by_packet(cnx, r_cid->pkt_ctx.retransmit_oldest,
                         current_time, &next_retransmit_time, &timer_based_retransmit)) {
                         *next_wake_time = current_time;
@@ -1812,17 +2010,24 @@ int picoquic_retransmit_needed(picoquic_cnx_t* cnx,
     else if (cnx->is_simple_multipath_enabled && cnx->cnx_state == picoquic_state_ready) {
         /* Find the path with the lowest repeat wait? */
         for (int i_path = 0; i_path < cnx->nb_paths; i_path++) {
-            picoquic_packet_t* old_p = cnx->path[i_path]->path_packet_first;
+            picoquic_path_t* old_path = cnx->path[i_path];
+            picoquic_packet_t* old_p = old_path->path_packet_first;
 
-            if (length == 0) {
+            if (old_p == NULL ||
+                picoquic_loss_timer_is_pending(cnx, &old_path->loss_timer, pc, current_time, next_wake_time)) {
+                continue;
+            }
+            else if (length == 0) {
                 int continue_next = 1;
 
+                cnx->nb_loss_checks++;
                 /* Call the per packet routine in a loop */
                 while (old_p != 0 && continue_next) {
                     picoquic_packet_t* p_next = old_p->path_packet_next;
                     if (old_p->pc == pc) {
                         length = picoquic_retransmit_needed_packet(cnx, &cnx->pkt_ctx[pc], old_p, pc, path_x, current_time,
-                            next_wake_time, packet, send_buffer_max, header_length, &continue_next);
+                            next_wake_time, packet, send_buffer_max, header_length,
+                            (old_p == old_path->path_packet_first) ? &old_path->loss_timer : NULL, &continue_next);
                     }
                     old_p = p_next;
                 }
@@ -2595,6 +2800,7 @@ int picoquic_prepare_packet_client_init(picoquic_cnx_t* cnx, picoquic_path_t * p
                         force_handshake_padding = 1;
                         cnx->path[0]->nb_retransmit++;
                         cnx->path[0]->last_loss_event_detected = current_time;
+                        cnx->is_path_sched_cache_valid = 0;
                     }
                     else if (repeat_time < *next_wake_time) {
                         *next_wake_time = repeat_time;
@@ -3283,6 +3489,8 @@ void picoquic_ready_state_transition(picoquic_cnx_t* cnx, uint64_t current_time)
      * The handshake is complete, all the handshake packets are implicitly acknowledged */
     cnx->cnx_state = picoquic_state_ready;
     cnx->is_handshake_finished = 1;
+    PICOQUIC_METRICS_INC(cnx->quic, picoquic_metric_handshakes_completed);
+    PICOQUIC_METRICS_RECORD(cnx->quic, picoquic_metric_handshake_usec, current_time - cnx->start_time);
     picoquic_implicit_handshake_ack(cnx, picoquic_packet_context_initial, current_time);
     picoquic_implicit_handshake_ack(cnx, picoquic_packet_context_handshake, current_time);
 
@@ -3709,9 +3917,7 @@ int picoquic_prepare_packet_almost_ready(picoquic_cnx_t* cnx, picoquic_path_t* p
         *next_wake_time = current_time;
         SET_LAST_WAKE(cnx->quic, PICOQUIC_SENDER);
 
-        if (picoquic_cnx_is_still_logging(cnx)) {
-            picoquic_log_cc_dump(cnx, current_time);
-        }
+        picoquic_log_cc_dump(cnx, current_time);
     }
 
     return ret;
@@ -3742,6 +3948,7 @@ int picoquic_prepare_packet_ready(picoquic_cnx_t* cnx, picoquic_path_t* path_x,
 
     picoquic_packet_context_t* pkt_ctx = (cnx->is_multipath_enabled) ?
         &path_x->p_remote_cnxid->pkt_ctx : &cnx->pkt_ctx[picoquic_packet_context_application];
+    PICOQUIC_PROFILE_BEGIN(cnx->quic, profile_start);
 
     /* Check whether to insert a hole in the sequence of packets */
     if (pkt_ctx->send_sequence >= pkt_ctx->next_sequence_hole) {
@@ -3895,7 +4102,8 @@ int picoquic_prepare_packet_ready(picoquic_cnx_t* cnx, picoquic_path_t* path_x,
             /* There are no frames yet that would be exempt from pacing control, but if there
              * was they should be sent here. */
 #if PACING_ON
-            if (picoquic_is_sending_authorized_by_pacing(cnx, path_x, current_time, next_wake_time)) {
+            if (cnx->train_budget > 0 ||
+                picoquic_is_sending_authorized_by_pacing(cnx, path_x, current_time, next_wake_time)) {
 #else
             if(true){
 #endif
@@ -3955,7 +4163,7 @@ int picoquic_prepare_packet_ready(picoquic_cnx_t* cnx, picoquic_path_t* path_x,
                 /* Compute the length before entering the CC block */
                 length = bytes_next - bytes;
 #if CC_ON
-                if (path_x->cwin < path_x->bytes_in_transit) {
+                if (cnx->train_budget == 0 && path_x->cwin < path_x->bytes_in_transit) {
                     cnx->cwin_blocked = 1;
                     if (cnx->congestion_alg != NULL) {
                         cnx->congestion_alg->alg_notify(cnx, path_x,
@@ -3998,6 +4206,13 @@ int picoquic_prepare_packet_ready(picoquic_cnx_t* cnx, picoquic_path_t* path_x,
                         /* Start of CC controlled frames */
                         if (ret == 0) {
                             uint8_t* bytes0 = bytes_next;
+                            uint8_t* bytes_dg;
+
+                            /* Copies of datagrams sent on other paths, queued by the redundant scheduler */
+                            if (path_x->first_redundant_datagram != NULL) {
+                                bytes_next = picoquic_format_redundant_datagram_frames(path_x, bytes_next, bytes_max, &more_data, &is_pure_ack);
+                            }
+                            bytes_dg = bytes_next;
 
                             if (cnx->first_datagram != NULL) {
                                 bytes_next = picoquic_format_first_datagram_frame(cnx, bytes_next, bytes_max, &more_data, &is_pure_ack);
@@ -4013,6 +4228,16 @@ int picoquic_prepare_packet_ready(picoquic_cnx_t* cnx, picoquic_path_t* path_x,
                                 }
                             }
                             datagram_tried_and_failed = (bytes_next == bytes0);
+
+                            if (ret == 0 && bytes_next != NULL && bytes_next > bytes_dg &&
+                                (cnx->is_multipath_enabled || cnx->is_simple_multipath_enabled) &&
+                                cnx->path_scheduler->sched_datagram_sent != NULL) {
+                                cnx->path_scheduler->sched_datagram_sent(cnx, path_x, bytes_dg, bytes_next - bytes_dg, current_time);
+                                for (int i = 0; i < cnx->nb_paths && !more_data; i++) {
+                                    /* Copies queued on other paths are ready to send */
+                                    more_data = (cnx->path[i] != path_x && cnx->path[i]->first_redundant_datagram != NULL);
+                                }
+                            }
                         }
 
                         /* If present, send stream frames queued for retransmission */
@@ -4190,11 +4415,13 @@ int picoquic_prepare_packet_ready(picoquic_cnx_t* cnx, picoquic_path_t* path_x,
         *next_wake_time = current_time;
         SET_LAST_WAKE(cnx->quic, PICOQUIC_SENDER);
 
-        if (ret == 0 && picoquic_cnx_is_still_logging(cnx)) {
+        if (ret == 0) {
             picoquic_log_cc_dump(cnx, current_time);
         }
     }
 
+    PICOQUIC_PROFILE_END(cnx->quic, profile_start, picoquic_profile_prepare_packet_ready);
+
     return ret;
 }
 
@@ -4222,6 +4449,11 @@ static int picoquic_check_idle_timer(picoquic_cnx_t* cnx, uint64_t* next_wake_ti
 
     if (current_time >= idle_timer) {
         /* Too long silence, break it. */
+        picoquic_log_trigger(cnx, (cnx->cnx_state >= picoquic_state_ready) ?
+            picoquic_log_trigger_idle_timeout : picoquic_log_trigger_handshake_failure, current_time);
+        if (cnx->cnx_state < picoquic_state_ready) {
+            PICOQUIC_METRICS_INC(cnx->quic, picoquic_metric_handshakes_failed);
+        }
         cnx->local_error = PICOQUIC_ERROR_IDLE_TIMEOUT;
         ret = PICOQUIC_ERROR_DISCONNECTED;
         picoquic_connection_disconnect(cnx);
@@ -4342,30 +4574,29 @@ int picoquic_prepare_segment(picoquic_cnx_t* cnx, picoquic_path_t* path_x, picoq
  * a "multipath_simple" option.
  */
 
-static int picoquic_select_next_path_mp(picoquic_cnx_t* cnx, uint64_t current_time, uint64_t* next_wake_time)
+/* Refresh the list of candidate paths for the multipath scheduler.
+ * Returns the index of a path for which a challenge, a response or a probe
+ * is required, or -1. The list is kept until the state of a path changes,
+ * unless a challenge is pending or a path is retransmitting, in which case
+ * it has to be recomputed for the next packet.
+ */
+static int picoquic_path_scheduler_refresh(picoquic_cnx_t* cnx, uint64_t current_time, uint64_t* challenge_time_next)
 {
-    int path_id = -1;
     int highest_priority = -1;
-    int data_path_cwin = -1;
-    int data_path_pacing = -1;
-    int challenge_path = -1;
-    uint64_t pacing_time_next = UINT64_MAX;
-    uint64_t challenge_time_next = UINT64_MAX;
     uint64_t highest_retransmit = UINT64_MAX;
-    uint64_t last_sent_pacing = UINT64_MAX;
-    uint64_t last_sent_cwin = UINT64_MAX;
+    int challenge_path = -1;
+    int is_cacheable = 1;
     int i;
-    int i_min_rtt = -1;
-    int is_min_rtt_pacing_ok = 0;
-    int is_ack_needed = 0;
 
-    cnx->last_path_polled++;
-    if (cnx->last_path_polled > cnx->nb_paths) {
-        cnx->last_path_polled = 0;
-    }
+    cnx->nb_path_sched_candidates = 0;
+    cnx->nb_path_sched_refresh++;
 
     for (i = 0; i < cnx->nb_paths; i++) {
         cnx->path[i]->is_nominal_ack_path = 0;
+        cnx->path[i]->is_sched_candidate = 0;
+    }
+
+    for (i = 0; i < cnx->nb_paths; i++) {
         if (cnx->path[i]->path_is_demoted) {
             continue;
         }
@@ -4382,14 +4613,15 @@ static int picoquic_select_next_path_mp(picoquic_cnx_t* cnx, uint64_t current_ti
             }
             else if (cnx->path[i]->challenge_required && !cnx->path[i]->challenge_verified) {
                 uint64_t next_challenge_time = picoquic_next_challenge_time(cnx, cnx->path[i]);
+                is_cacheable = 0;
                 if (cnx->path[i]->challenge_repeat_count == 0 ||
                     current_time >= next_challenge_time) {
                     cnx->path[i]->challenger++;
                     challenge_path = i;
                     break;
                 }
-                else if (next_challenge_time < challenge_time_next) {
-                    challenge_time_next = next_challenge_time;
+                else if (next_challenge_time < *challenge_time_next) {
+                    *challenge_time_next = next_challenge_time;
                 }
             }
             else if (cnx->path[i]->challenge_verified && cnx->path[i]->nb_retransmit > 0 && 
@@ -4405,6 +4637,10 @@ static int picoquic_select_next_path_mp(picoquic_cnx_t* cnx, uint64_t current_ti
                 if (cnx->congestion_alg != NULL && cnx->path[i]->congestion_alg_state == NULL) {
                     cnx->congestion_alg->alg_init(cnx->path[i], current_time);
                 }
+                /* The probe condition depends on bytes in transit, which changes with every packet */
+                if (cnx->path[i]->nb_retransmit > 0) {
+                    is_cacheable = 0;
+                }
 
                 if (cnx->path[i]->path_priority > highest_priority) {
                     is_polled = 1;
@@ -4423,51 +4659,74 @@ static int picoquic_select_next_path_mp(picoquic_cnx_t* cnx, uint64_t current_ti
                 if (is_new_priority) {
                     highest_priority = cnx->path[i]->path_priority;
                     highest_retransmit = cnx->path[i]->nb_retransmit;
-                    data_path_cwin = -1;
-                    data_path_pacing = -1;
-                    pacing_time_next = UINT64_MAX;
-                    last_sent_pacing = UINT64_MAX;
-                    last_sent_cwin = UINT64_MAX;
-                    i_min_rtt = -1;
-                    is_min_rtt_pacing_ok = 0;
-                }
-                if (is_polled) {
-                    /* This path is a candidate for min rtt */
-                    if (i_min_rtt < 0 || cnx->path[i]->rtt_min < cnx->path[i_min_rtt]->rtt_min) {
-                        i_min_rtt = i;
-                        is_min_rtt_pacing_ok = 0;
-                    }
-                    cnx->path[i]->polled++;
-                    if (picoquic_is_sending_authorized_by_pacing(cnx, cnx->path[i], current_time, &pacing_time_next)) {
-                        if (cnx->path[i]->last_sent_time < last_sent_pacing) {
-                            last_sent_pacing = cnx->path[i]->last_sent_time;
-                            data_path_pacing = i;
-                            if (i == i_min_rtt) {
-                                is_min_rtt_pacing_ok = 1;
-                            }
-                        }
-                        if (cnx->path[i]->bytes_in_transit < cnx->path[i]->cwin) {
-                            if (cnx->path[i]->last_sent_time < last_sent_cwin) {
-                                last_sent_cwin = cnx->path[i]->last_sent_time;
-                                data_path_cwin = i;
-                            }
-                        }
-                        else {
-                            cnx->path[i]->congested++;
-                        }
-                    }
-                    else {
-                        cnx->path[i]->paced++;
+                    for (int k = 0; k < cnx->nb_path_sched_candidates; k++) {
+                        cnx->path[cnx->path_sched_candidates[k]]->is_sched_candidate = 0;
                     }
+                    cnx->nb_path_sched_candidates = 0;
+                }
+                if (is_polled && cnx->nb_path_sched_candidates < PICOQUIC_NB_PATH_TARGET) {
+                    cnx->path_sched_candidates[cnx->nb_path_sched_candidates++] = i;
+                    cnx->path[i]->is_sched_candidate = 1;
                 }
             }
         }
     }
 
-    /* Ensure that at most one path is marked as nominal ack path */
-    for (i += 1; i < cnx->nb_paths; i++) {
-        cnx->path[i]->is_nominal_ack_path = 0;
+    cnx->is_path_sched_cache_valid = (challenge_path < 0 && is_cacheable);
+
+    return challenge_path;
+}
+
+static int picoquic_select_next_path_mp(picoquic_cnx_t* cnx, uint64_t current_time, uint64_t* next_wake_time)
+{
+    int path_id = -1;
+    int challenge_path = -1;
+    uint64_t pacing_time_next = UINT64_MAX;
+    uint64_t challenge_time_next = UINT64_MAX;
+    picoquic_path_candidate_t candidates[PICOQUIC_NB_PATH_TARGET];
+    int nb_candidates = 0;
+    int i_min_rtt = -1;
+    int is_ack_needed = 0;
+
+    cnx->last_path_polled++;
+    if (cnx->last_path_polled > cnx->nb_paths) {
+        cnx->last_path_polled = 0;
+    }
+
+    if (!cnx->is_path_sched_cache_valid) {
+        challenge_path = picoquic_path_scheduler_refresh(cnx, current_time, &challenge_time_next);
+    }
+
+    /* Evaluate pacing and congestion control for the candidate paths */
+    for (int k = 0; k < cnx->nb_path_sched_candidates; k++) {
+        int i = cnx->path_sched_candidates[k];
+        picoquic_path_t* path_x = cnx->path[i];
+
+        candidates[nb_candidates].path_x = path_x;
+        candidates[nb_candidates].path_index = i;
+        candidates[nb_candidates].is_pacing_ok = 0;
+        candidates[nb_candidates].is_cwin_ok = 0;
+        path_x->is_nominal_ack_path = 0;
+        path_x->polled++;
+        if (i_min_rtt < 0 || path_x->rtt_min < cnx->path[i_min_rtt]->rtt_min) {
+            i_min_rtt = i;
+        }
+        if (picoquic_is_sending_authorized_by_pacing(cnx, path_x, current_time, &pacing_time_next)) {
+            candidates[nb_candidates].is_pacing_ok = 1;
+            if (path_x->bytes_in_transit < path_x->cwin) {
+                candidates[nb_candidates].is_cwin_ok = 1;
+            }
+            else {
+                path_x->congested++;
+            }
+        }
+        else {
+            path_x->paced++;
+        }
+        nb_candidates++;
     }
+
+    /* At most one path is marked as nominal ack path */
     if (i_min_rtt >= 0) {
         is_ack_needed = picoquic_is_ack_needed(cnx, current_time, next_wake_time, 0, 0);
         cnx->path[i_min_rtt]->is_nominal_ack_path = 1;
@@ -4476,16 +4735,14 @@ static int picoquic_select_next_path_mp(picoquic_cnx_t* cnx, uint64_t current_ti
     if (challenge_path >= 0) {
         path_id = challenge_path;
     }
-    else if (is_ack_needed && is_min_rtt_pacing_ok) {
-        path_id = i_min_rtt;
-    }
-    else if (data_path_cwin >= 0) {
-        path_id = data_path_cwin;
-    }
-    else if (data_path_pacing >= 0) {
-        path_id = data_path_pacing;
+    else if (nb_candidates > 0) {
+        int selected = cnx->path_scheduler->sched_select(cnx, candidates, nb_candidates, is_ack_needed, current_time);
+        if (selected >= 0 && selected < nb_candidates) {
+            path_id = candidates[selected].path_index;
+        }
     }
-    else {
+
+    if (path_id < 0) {
         uint64_t path_wake_time = pacing_time_next;
         if (challenge_time_next < path_wake_time) {
             path_wake_time = challenge_time_next;
@@ -4565,8 +4822,53 @@ static int picoquic_select_next_path(picoquic_cnx_t * cnx, uint64_t current_time
     return path_id;
 }
 
+/* Attribute the time since the previous call to the previous limiting state,
+ * then find what limits the sender after this call. The congestion window
+ * and pacing are checked first, because the stream flow control flags are
+ * only set if the sender got to the point of looking for stream data.
+ */
+static void picoquic_update_limit_state(picoquic_cnx_t* cnx, picoquic_path_t* path_x, uint64_t current_time, size_t send_length)
+{
+    picoquic_limit_state_enum limit_state;
+
+    if (current_time > cnx->limit_state_time) {
+        cnx->limit_time[cnx->limit_state] += current_time - cnx->limit_state_time;
+        cnx->limit_state_time = current_time;
+    }
+
+    if (cnx->cnx_state >= picoquic_state_disconnecting) {
+        limit_state = picoquic_limit_closing;
+    }
+    else if (!cnx->initial_validated &&
+        cnx->initial_data_sent + path_x->send_mtu > 3 * cnx->initial_data_received) {
+        limit_state = picoquic_limit_amplification;
+    }
+    else if (cnx->cnx_state < picoquic_state_client_ready_start) {
+        limit_state = picoquic_limit_handshake;
+    }
+    else if (path_x->cwin <= path_x->bytes_in_transit) {
+        limit_state = picoquic_limit_cwin;
+    }
+    else if (path_x->pacing_bucket_nanosec < path_x->pacing_packet_time_nanosec) {
+        limit_state = picoquic_limit_pacing;
+    }
+    else if (cnx->flow_blocked) {
+        limit_state = picoquic_limit_flow_control;
+    }
+    else if (cnx->stream_blocked) {
+        limit_state = picoquic_limit_stream_flow_control;
+    }
+    else if (send_length > 0) {
+        limit_state = picoquic_limit_none;
+    }
+    else {
+        limit_state = picoquic_limit_application;
+    }
+    cnx->limit_state = limit_state;
+}
+
 /* Prepare next packet to send, or nothing.. */
-int picoquic_prepare_packet_ex(picoquic_cnx_t* cnx,
+static int picoquic_prepare_packet_batch(picoquic_cnx_t* cnx,
     uint64_t current_time, uint8_t* send_buffer, size_t send_buffer_max, size_t* send_length,
     struct sockaddr_storage * p_addr_to, struct sockaddr_storage * p_addr_from, int* if_index, size_t* send_msg_size)
 {
@@ -4577,6 +4879,7 @@ int picoquic_prepare_packet_ex(picoquic_cnx_t* cnx,
     struct sockaddr_storage addr_from_log;
     uint64_t next_wake_time = cnx->latest_progress_time + 2*PICOQUIC_MICROSEC_SILENCE_MAX;
     uint64_t initial_next_time;
+    uint64_t train_length = 0;
 
     SET_LAST_WAKE(cnx->quic, PICOQUIC_SENDER);
 
@@ -4633,6 +4936,11 @@ int picoquic_prepare_packet_ex(picoquic_cnx_t* cnx,
             cnx->is_sending_large_buffer = 1;
         }
 
+        if (cnx->quic->packet_train_mode && send_msg_size != NULL && cnx->cnx_state == picoquic_state_ready) {
+            cnx->train_budget = picoquic_compute_train_budget(cnx->path[path_id], send_buffer_max, current_time);
+            cnx->nb_train_packets_planned += cnx->train_budget;
+        }
+
         while (ret == 0)
         {
             /* Create a new packet, which may include several segments */
@@ -4720,6 +5028,10 @@ int picoquic_prepare_packet_ex(picoquic_cnx_t* cnx,
                     cnx->max_mtu_sent = packet_size;
                 }
                 cnx->nb_packets_sent++;
+                if (cnx->train_budget > 0) {
+                    cnx->train_budget--;
+                    train_length++;
+                }
                 /* if needed, log that the packet is sent */
                 picoquic_log_pdu(cnx, 0, current_time,
                     (struct sockaddr*) & addr_to_log, (struct sockaddr*) & addr_from_log, packet_size);
@@ -4768,6 +5080,17 @@ int picoquic_prepare_packet_ex(picoquic_cnx_t* cnx,
         if (*send_length > 0) {
             cnx->nb_trains_sent++;
         }
+        if (train_length > 0) {
+            cnx->nb_trains_built++;
+            cnx->nb_train_packets += train_length;
+            if (train_length > cnx->train_length_max) {
+                cnx->train_length_max = train_length;
+            }
+        }
+        /* The budget is only valid for the current wakeup */
+        cnx->train_budget = 0;
+
+        picoquic_update_limit_state(cnx, cnx->path[path_id], current_time, *send_length);
     }
 
     picoquic_reinsert_by_wake_time(cnx->quic, cnx, next_wake_time);
@@ -4775,6 +5098,219 @@ int picoquic_prepare_packet_ex(picoquic_cnx_t* cnx,
     return ret;
 }
 
+/* Queue the content of the send buffer as a protected datagram, and submit
+ * the jobs recorded while preparing it.
+ */
+static int picoquic_queue_protected_datagram(picoquic_cnx_t* cnx, uint8_t* send_buffer, size_t send_length,
+    struct sockaddr_storage* addr_to, struct sockaddr_storage* addr_from, int if_index, size_t send_msg_size)
+{
+    int ret = 0;
+    picoquic_quic_t* quic = cnx->quic;
+    size_t nb_jobs = quic->nb_crypto_async_records;
+    picoquic_protected_datagram_t* datagram = (picoquic_protected_datagram_t*)malloc(
+        sizeof(picoquic_protected_datagram_t) + nb_jobs * sizeof(picoquic_async_protection_t) + send_length);
+
+    if (datagram == NULL) {
+        ret = PICOQUIC_ERROR_MEMORY;
+    }
+    else {
+        picoquic_aead_job_t* jobs[PICOQUIC_CRYPTO_ASYNC_MAX_JOBS];
+
+        memset(datagram, 0, sizeof(picoquic_protected_datagram_t));
+        datagram->protection = (picoquic_async_protection_t*)(datagram + 1);
+        datagram->bytes = (uint8_t*)(datagram->protection + nb_jobs);
+        memcpy(datagram->bytes, send_buffer, send_length);
+        datagram->cnx = cnx;
+        picoquic_store_addr(&datagram->addr_to, (struct sockaddr*)addr_to);
+        picoquic_store_addr(&datagram->addr_from, (struct sockaddr*)addr_from);
+        datagram->if_index = if_index;
+        datagram->send_msg_size = send_msg_size;
+        datagram->length = send_length;
+        datagram->nb_jobs = nb_jobs;
+        datagram->nb_pending = nb_jobs;
+
+        for (size_t i = 0; i < nb_jobs; i++) {
+            picoquic_async_protection_t* protection = &datagram->protection[i];
+
+            *protection = quic->crypto_async_records[i];
+            protection->datagram = datagram;
+            protection->packet = datagram->bytes + (quic->crypto_async_records[i].packet - send_buffer);
+            protection->job.auth_data = protection->packet;
+            protection->job.output = protection->packet + protection->job.auth_data_length;
+            protection->job.input = protection->job.output;
+            protection->job.job_ctx = datagram;
+            jobs[i] = &protection->job;
+        }
+        quic->nb_crypto_async_records = 0;
+
+        if (cnx->last_protected_datagram == NULL) {
+            cnx->first_protected_datagram = datagram;
+        }
+        else {
+            cnx->last_protected_datagram->next_datagram = datagram;
+        }
+        cnx->last_protected_datagram = datagram;
+        cnx->nb_protected_datagrams++;
+
+        if (nb_jobs > 0) {
+            size_t nb_submitted = picoquic_crypto_async_submit(cnx, jobs, nb_jobs);
+
+            /* The jobs that the provider did not accept were processed in line */
+            for (size_t i = nb_submitted; i < nb_jobs; i++) {
+                picoquic_protected_datagram_job_complete(&datagram->protection[i]);
+            }
+        }
+    }
+
+    return ret;
+}
+
+/* Return the oldest protected datagram of the connection, if its protection is complete */
+static int picoquic_dequeue_protected_datagram(picoquic_cnx_t* cnx, uint8_t* send_buffer, size_t send_buffer_max,
+    size_t* send_length, struct sockaddr_storage* p_addr_to, struct sockaddr_storage* p_addr_from, int* if_index,
+    size_t* send_msg_size)
+{
+    int is_dequeued = 0;
+    picoquic_protected_datagram_t* datagram = cnx->first_protected_datagram;
+
+    if (datagram != NULL && datagram->nb_pending == 0) {
+        cnx->first_protected_datagram = datagram->next_datagram;
+        if (cnx->first_protected_datagram == NULL) {
+            cnx->last_protected_datagram = NULL;
+        }
+        cnx->nb_protected_datagrams--;
+        is_dequeued = 1;
+
+        if (!datagram->is_failed && datagram->length <= send_buffer_max) {
+            memcpy(send_buffer, datagram->bytes, datagram->length);
+            *send_length = datagram->length;
+            if (p_addr_to != NULL) {
+                picoquic_store_addr(p_addr_to, (struct sockaddr*)&datagram->addr_to);
+            }
+            if (p_addr_from != NULL) {
+                picoquic_store_addr(p_addr_from, (struct sockaddr*)&datagram->addr_from);
+            }
+            if (if_index != NULL) {
+                *if_index = datagram->if_index;
+            }
+            if (send_msg_size != NULL) {
+                *send_msg_size = datagram->send_msg_size;
+            }
+        }
+        free(datagram);
+    }
+
+    return is_dequeued;
+}
+
+/* Preparation of packets with an asynchronous crypto provider.
+ * The oldest queued datagram is returned if its protection is complete.
+ * Otherwise, a new batch is prepared while recording the 1-RTT protections,
+ * and queued until the jobs complete. Datagrams that do not need async
+ * protection are returned immediately, unless older datagrams are queued.
+ * The connection is woken up immediately as long as jobs are in flight,
+ * so the completed datagrams are sent without waiting for a timer.
+ * The queued datagrams are all sent before reporting a disconnection.
+ */
+static int picoquic_prepare_packet_async(picoquic_cnx_t* cnx,
+    uint64_t current_time, uint8_t* send_buffer, size_t send_buffer_max, size_t* send_length,
+    struct sockaddr_storage* p_addr_to, struct sockaddr_storage* p_addr_from, int* if_index, size_t* send_msg_size)
+{
+    int ret = 0;
+    picoquic_quic_t* quic = cnx->quic;
+
+    picoquic_process_pending_decryptions(quic, current_time);
+    *send_length = 0;
+
+    if (picoquic_dequeue_protected_datagram(cnx, send_buffer, send_buffer_max, send_length,
+        p_addr_to, p_addr_from, if_index, send_msg_size)) {
+        picoquic_reinsert_by_wake_time(quic, cnx, current_time);
+    }
+    else if (cnx->nb_protected_datagrams >= PICOQUIC_CRYPTO_ASYNC_MAX_DATAGRAMS) {
+        /* Wait for the provider before preparing more packets */
+        picoquic_reinsert_by_wake_time(quic, cnx, current_time);
+    }
+    else {
+        struct sockaddr_storage addr_to;
+        struct sockaddr_storage addr_from;
+        int local_if_index = -1;
+        size_t local_msg_size = 0;
+
+        memset(&addr_to, 0, sizeof(addr_to));
+        memset(&addr_from, 0, sizeof(addr_from));
+        if (quic->crypto_async_records == NULL) {
+            quic->crypto_async_records = (picoquic_async_protection_t*)malloc(
+                PICOQUIC_CRYPTO_ASYNC_MAX_JOBS * sizeof(picoquic_async_protection_t));
+        }
+        quic->nb_crypto_async_records = 0;
+        quic->is_crypto_async_recording = (quic->crypto_async_records != NULL);
+
+        ret = picoquic_prepare_packet_batch(cnx, current_time, send_buffer, send_buffer_max, send_length,
+            &addr_to, &addr_from, &local_if_index, (send_msg_size == NULL) ? NULL : &local_msg_size);
+
+        if (*send_length > 0 && (quic->nb_crypto_async_records > 0 || cnx->first_protected_datagram != NULL)) {
+            if (picoquic_queue_protected_datagram(cnx, send_buffer, *send_length, &addr_to, &addr_from,
+                local_if_index, local_msg_size) == 0) {
+                *send_length = 0;
+            }
+            else {
+                /* Cannot queue the datagram. Protect it in line, and send it now. */
+                picoquic_crypto_async_wait_cnx(cnx);
+                picoquic_flush_async_protections(cnx);
+            }
+        }
+        quic->is_crypto_async_recording = 0;
+        quic->nb_crypto_async_records = 0;
+
+        if (p_addr_to != NULL) {
+            picoquic_store_addr(p_addr_to, (struct sockaddr*)&addr_to);
+        }
+        if (p_addr_from != NULL) {
+            picoquic_store_addr(p_addr_from, (struct sockaddr*)&addr_from);
+        }
+        if (if_index != NULL) {
+            *if_index = local_if_index;
+        }
+        if (send_msg_size != NULL) {
+            *send_msg_size = local_msg_size;
+        }
+
+        if (ret == PICOQUIC_ERROR_DISCONNECTED && cnx->first_protected_datagram != NULL) {
+            /* Send the queued datagrams first, e.g., the last connection close */
+            picoquic_crypto_async_wait_cnx(cnx);
+            ret = 0;
+            if (*send_length == 0) {
+                (void)picoquic_dequeue_protected_datagram(cnx, send_buffer, send_buffer_max, send_length,
+                    p_addr_to, p_addr_from, if_index, send_msg_size);
+            }
+        }
+
+        if (cnx->nb_crypto_jobs_in_flight > 0 || cnx->first_protected_datagram != NULL) {
+            picoquic_reinsert_by_wake_time(quic, cnx, current_time);
+        }
+    }
+
+    return ret;
+}
+
+int picoquic_prepare_packet_ex(picoquic_cnx_t* cnx,
+    uint64_t current_time, uint8_t* send_buffer, size_t send_buffer_max, size_t* send_length,
+    struct sockaddr_storage* p_addr_to, struct sockaddr_storage* p_addr_from, int* if_index, size_t* send_msg_size)
+{
+    int ret;
+
+    if (picoquic_crypto_async_is_enabled(cnx->quic)) {
+        ret = picoquic_prepare_packet_async(cnx, current_time, send_buffer, send_buffer_max, send_length,
+            p_addr_to, p_addr_from, if_index, send_msg_size);
+    }
+    else {
+        ret = picoquic_prepare_packet_batch(cnx, current_time, send_buffer, send_buffer_max, send_length,
+            p_addr_to, p_addr_from, if_index, send_msg_size);
+    }
+
+    return ret;
+}
+
 int picoquic_prepare_packet(picoquic_cnx_t* cnx,
     uint64_t current_time, uint8_t* send_buffer, size_t send_buffer_max, size_t* send_length,
     struct sockaddr_storage* p_addr_to, struct sockaddr_storage* p_addr_from, int* if_index)
@@ -4830,7 +5366,16 @@ int picoquic_prepare_next_packet_ex(picoquic_quic_t* quic,
     picoquic_connection_id_t * log_cid, picoquic_cnx_t** p_last_cnx, size_t * send_msg_size)
 {
     int ret = 0;
-    picoquic_stateless_packet_t* sp = picoquic_dequeue_stateless_packet(quic);
+    picoquic_stateless_packet_t* sp;
+    uint64_t cycles_start = (quic->metrics != NULL) ? picoquic_cpu_cycles() : 0;
+    PICOQUIC_PROFILE_BEGIN(quic, profile_start);
+
+    if (quic->sign_offload != NULL) {
+        /* Resume the handshakes whose certificate signature completed */
+        (void)picoquic_poll_async_signatures(quic, current_time);
+    }
+
+    sp = picoquic_dequeue_stateless_packet(quic);
 
     if (p_last_cnx) {
         *p_last_cnx = NULL;
@@ -4849,6 +5394,7 @@ int picoquic_prepare_next_packet_ex(picoquic_quic_t* quic,
             if (log_cid != NULL) {
                 *log_cid = sp->initial_cid;
             }
+            PICOQUIC_METRICS_INC(quic, picoquic_metric_stateless_packets);
         }
         picoquic_delete_stateless_packet(sp);
     }
@@ -4861,15 +5407,21 @@ int picoquic_prepare_next_packet_ex(picoquic_quic_t* quic,
             *send_length = 0;
         }
         else {
+            uint64_t scheduled_time = cnx->next_wake_time;
+
             ret = picoquic_prepare_packet_ex(cnx, current_time, send_buffer, send_buffer_max, send_length, p_addr_to, p_addr_from, 
                 if_index, send_msg_size);
+            if (quic->pacing_wheel != NULL && *send_length > 0) {
+                picoquic_pacing_wheel_departure(quic->pacing_wheel, scheduled_time, current_time);
+            }
             if (log_cid != NULL) {
                 *log_cid = cnx->initial_cnxid;
             }
 
             if (ret == PICOQUIC_ERROR_DISCONNECTED) {
                 ret = 0;
-                printf("Closed. Retrans= %d, spurious= %d, max sp gap = %d, max sp delay = %d, dg-coal: %f",
+                picoquic_event_signal(quic, picoquic_event_cnx_closed, &cnx->initial_cnxid, current_time,
+                    "Retrans= %d, spurious= %d, max sp gap = %d, max sp delay = %d, dg-coal: %f",
                     (int)cnx->nb_retransmission_total, (int)cnx->nb_spurious,
                     (int)cnx->path[0]->max_reorder_gap, (int)cnx->path[0]->max_spurious_rtt,
                     (cnx->nb_trains_sent > 0) ? ((double)cnx->nb_packets_sent / (double)cnx->nb_trains_sent) : 0.0);
@@ -4883,7 +5435,7 @@ int picoquic_prepare_next_packet_ex(picoquic_quic_t* quic,
                     fflush(quic->F_log);
                 }
 
-                if (cnx->f_binlog != NULL) {
+                if (cnx->f_binlog != NULL && quic->binlog_writer == NULL) {
                     fflush(cnx->f_binlog);
                 }
 
@@ -4907,6 +5459,23 @@ int picoquic_prepare_next_packet_ex(picoquic_quic_t* quic,
         }
     }
 
+    if (quic->metrics != NULL) {
+        if (*send_length > 0) {
+            size_t nb_packets = (send_msg_size != NULL && *send_msg_size > 0) ?
+                (*send_length + *send_msg_size - 1) / *send_msg_size : 1;
+            PICOQUIC_METRICS_ADD(quic, picoquic_metric_packets_out, nb_packets);
+            PICOQUIC_METRICS_ADD(quic, picoquic_metric_bytes_out, *send_length);
+        }
+        picoquic_metrics_publish(quic, current_time);
+        picoquic_metrics_record(quic->metrics, picoquic_metric_send_loop_cycles, picoquic_cpu_cycles() - cycles_start);
+    }
+
+    if (*send_length > 0) {
+        PICOQUIC_PROFILE_PACKETS_OUT(quic, (send_msg_size != NULL && *send_msg_size > 0) ?
+            (*send_length + *send_msg_size - 1) / *send_msg_size : 1);
+    }
+    PICOQUIC_PROFILE_END(quic, profile_start, picoquic_profile_prepare_next_packet);
+
     return ret;
 }
 
@@ -0,0 +1,451 @@
+/* Asynchronous certificate signing.
+ *
+ * On a server under handshake load, the CertificateVerify signature is the
+ * most expensive step of the handshake, and it is executed inline in the
+ * packet processing loop. This module wraps the "sign_certificate" callback
+ * of the TLS master context, and uses the asynchronous mode of picotls to
+ * move the signature to a pool of signing threads:
+ *
+ * - when picotls asks for a signature, the callback copies the input and
+ *   queues a job, then returns PTLS_ERROR_ASYNC_OPERATION. The connection
+ *   is marked "signature pending", and the data produced so far (Server Hello,
+ *   Encrypted Extensions, Certificate) is queued for sending.
+ * - the signing threads pick up to "max_batch" jobs per wake up, compute
+ *   the signatures with the original signer, and place the completed jobs
+ *   in the "done" list.
+ * - the network thread calls "picoquic_poll_async_signatures", typically
+ *   from the prepare packet path. For each completed job, the handshake
+ *   is resumed and picotls calls the callback again to collect the result.
+ *
+ * Batching is limited to grouping the jobs processed per thread wake up:
+ * the original signer computes one signature per call. Accelerators that
+ * can process a vector of signatures can be plugged in by replacing the
+ * call to the original signer in "picoquic_sign_offload_process".
+ *
+ * The picotls context is shared by all the connections of a QUIC context,
+ * so the offload is attached to the QUIC context and only one network thread
+ * may poll it.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "picotls.h"
+#include "picoquic_internal.h"
+#include "picoquic_utils.h"
+#include "tls_api.h"
+
+#define PICOQUIC_SIGN_OFFLOAD_MAX_THREADS 16
+#define PICOQUIC_SIGN_OFFLOAD_WAIT_USEC 10000
+
+typedef enum {
+    picoquic_sign_job_pending = 0,
+    picoquic_sign_job_running,
+    picoquic_sign_job_done,
+    picoquic_sign_job_delivered
+} picoquic_sign_job_state_enum;
+
+typedef struct st_picoquic_sign_job_t {
+    ptls_async_job_t super;
+    struct st_picoquic_sign_job_t* next;
+    struct st_picoquic_sign_offload_t* offload;
+    picoquic_cnx_t* cnx;
+    uint8_t* input;
+    size_t input_len;
+    uint16_t* algorithms;
+    size_t num_algorithms;
+    ptls_buffer_t output;
+    uint16_t selected_algorithm;
+    int ret;
+    picoquic_sign_job_state_enum state;
+    unsigned int is_cancelled : 1;
+} picoquic_sign_job_t;
+
+typedef struct st_picoquic_sign_offload_t {
+    ptls_sign_certificate_t super;
+    ptls_sign_certificate_t* signer;
+    picoquic_quic_t* quic;
+    picoquic_mutex_t mutex;
+    picoquic_event_t event;
+    picoquic_thread_t threads[PICOQUIC_SIGN_OFFLOAD_MAX_THREADS];
+    int nb_threads;
+    size_t max_batch;
+    volatile int is_stopping;
+    picoquic_sign_job_t* pending_first;
+    picoquic_sign_job_t* pending_last;
+    picoquic_sign_job_t* done_first;
+    picoquic_sign_job_t* done_last;
+    volatile size_t done_count;
+    size_t nb_in_flight;
+    uint64_t nb_jobs;
+    uint64_t nb_batches;
+} picoquic_sign_offload_t;
+
+static void picoquic_sign_job_free(picoquic_sign_job_t* job)
+{
+    ptls_buffer_dispose(&job->output);
+    if (job->input != NULL) {
+        free(job->input);
+    }
+    if (job->algorithms != NULL) {
+        free(job->algorithms);
+    }
+    free(job);
+}
+
+/* Called by picotls if the TLS context is deleted while the job is outstanding,
+ * e.g., if the connection is deleted before the signature completes. A job that
+ * is being processed by a signing thread cannot be freed; it is marked, and
+ * freed by the signing thread when done.
+ */
+static void picoquic_sign_job_destroy(ptls_async_job_t* async_job)
+{
+    picoquic_sign_job_t* job = (picoquic_sign_job_t*)async_job;
+    picoquic_sign_offload_t* offload = job->offload;
+    int is_freed = 1;
+
+    picoquic_lock_mutex(&offload->mutex);
+    switch (job->state) {
+    case picoquic_sign_job_pending: {
+        picoquic_sign_job_t** pprevious = &offload->pending_first;
+        picoquic_sign_job_t* previous = NULL;
+        while (*pprevious != NULL && *pprevious != job) {
+            previous = *pprevious;
+            pprevious = &(*pprevious)->next;
+        }
+        if (*pprevious == job) {
+            *pprevious = job->next;
+            if (offload->pending_last == job) {
+                offload->pending_last = previous;
+            }
+        }
+        break;
+    }
+    case picoquic_sign_job_running:
+        job->is_cancelled = 1;
+        is_freed = 0;
+        break;
+    case picoquic_sign_job_done: {
+        picoquic_sign_job_t** pprevious = &offload->done_first;
+        picoquic_sign_job_t* previous = NULL;
+        while (*pprevious != NULL && *pprevious != job) {
+            previous = *pprevious;
+            pprevious = &(*pprevious)->next;
+        }
+        if (*pprevious == job) {
+            *pprevious = job->next;
+            if (offload->done_last == job) {
+                offload->done_last = previous;
+            }
+            offload->done_count--;
+        }
+        break;
+    }
+    default:
+        /* Delivered jobs are not in any list */
+        break;
+    }
+    if (is_freed) {
+        offload->nb_in_flight--;
+    }
+    picoquic_unlock_mutex(&offload->mutex);
+
+    if (is_freed) {
+        picoquic_sign_job_free(job);
+    }
+}
+
+static int picoquic_sign_offload_cb(ptls_sign_certificate_t* self, ptls_t* tls, ptls_async_job_t** async,
+    uint16_t* selected_algorithm, ptls_buffer_t* output, ptls_iovec_t input, const uint16_t* algorithms, size_t num_algorithms)
+{
+    picoquic_sign_offload_t* offload = (picoquic_sign_offload_t*)self;
+    picoquic_sign_job_t* job;
+    int ret;
+
+    if (async == NULL || offload->quic->cnx_in_progress == NULL) {
+        /* Asynchronous operation not possible in this context, sign inline */
+        return offload->signer->cb(offload->signer, tls, NULL, selected_algorithm, output, input, algorithms, num_algorithms);
+    }
+
+    if (*async != NULL) {
+        /* Handshake resumed after completion: deliver the result */
+        job = (picoquic_sign_job_t*)*async;
+        ret = job->ret;
+        if (ret == 0) {
+            *selected_algorithm = job->selected_algorithm;
+            ret = ptls_buffer__do_pushv(output, job->output.base, job->output.off);
+        }
+        *async = NULL;
+        picoquic_lock_mutex(&offload->mutex);
+        offload->nb_in_flight--;
+        picoquic_unlock_mutex(&offload->mutex);
+        picoquic_sign_job_free(job);
+        return ret;
+    }
+
+    if ((job = (picoquic_sign_job_t*)malloc(sizeof(picoquic_sign_job_t))) == NULL) {
+        return PTLS_ERROR_NO_MEMORY;
+    }
+    memset(job, 0, sizeof(picoquic_sign_job_t));
+    job->super.destroy_ = picoquic_sign_job_destroy;
+    job->offload = offload;
+    job->cnx = offload->quic->cnx_in_progress;
+    ptls_buffer_init(&job->output, "", 0);
+    job->input = (uint8_t*)malloc(input.len > 0 ? input.len : 1);
+    job->algorithms = (uint16_t*)malloc(num_algorithms > 0 ? num_algorithms * sizeof(uint16_t) : 1);
+    if (job->input == NULL || job->algorithms == NULL) {
+        picoquic_sign_job_free(job);
+        return PTLS_ERROR_NO_MEMORY;
+    }
+    memcpy(job->input, input.base, input.len);
+    job->input_len = input.len;
+    if (num_algorithms > 0) {
+        memcpy(job->algorithms, algorithms, num_algorithms * sizeof(uint16_t));
+    }
+    job->num_algorithms = num_algorithms;
+
+    picoquic_lock_mutex(&offload->mutex);
+    if (offload->pending_last == NULL) {
+        offload->pending_first = job;
+    }
+    else {
+        offload->pending_last->next = job;
+    }
+    offload->pending_last = job;
+    offload->nb_in_flight++;
+    picoquic_unlock_mutex(&offload->mutex);
+    (void)picoquic_signal_event(&offload->event);
+
+    *async = &job->super;
+
+    return PTLS_ERROR_ASYNC_OPERATION;
+}
+
+static void picoquic_sign_offload_process(picoquic_sign_offload_t* offload, picoquic_sign_job_t* batch)
+{
+    picoquic_sign_job_t* job = batch;
+
+    while (job != NULL) {
+        job->ret = offload->signer->cb(offload->signer, NULL, NULL, &job->selected_algorithm, &job->output,
+            ptls_iovec_init(job->input, job->input_len), job->algorithms, job->num_algorithms);
+        job = job->next;
+    }
+}
+
+static picoquic_thread_return_t picoquic_sign_offload_thread(void* arg)
+{
+    picoquic_sign_offload_t* offload = (picoquic_sign_offload_t*)arg;
+
+    while (!offload->is_stopping) {
+        picoquic_sign_job_t* batch = NULL;
+        picoquic_sign_job_t* batch_last = NULL;
+        size_t batch_size = 0;
+
+        picoquic_lock_mutex(&offload->mutex);
+        while (offload->pending_first != NULL && batch_size < offload->max_batch) {
+            picoquic_sign_job_t* job = offload->pending_first;
+            offload->pending_first = job->next;
+            if (offload->pending_first == NULL) {
+                offload->pending_last = NULL;
+            }
+            job->next = NULL;
+            job->state = picoquic_sign_job_running;
+            if (batch_last == NULL) {
+                batch = job;
+            }
+            else {
+                batch_last->next = job;
+            }
+            batch_last = job;
+            batch_size++;
+        }
+        picoquic_unlock_mutex(&offload->mutex);
+
+        if (batch == NULL) {
+            /* The event does not retain signals, so the wait is bounded and the
+             * queue is checked again after each wake up. */
+            (void)picoquic_wait_for_event(&offload->event, PICOQUIC_SIGN_OFFLOAD_WAIT_USEC);
+            continue;
+        }
+
+        picoquic_sign_offload_process(offload, batch);
+
+        picoquic_lock_mutex(&offload->mutex);
+        offload->nb_jobs += batch_size;
+        offload->nb_batches++;
+        while (batch != NULL) {
+            picoquic_sign_job_t* job = batch;
+            batch = job->next;
+            job->next = NULL;
+            if (job->is_cancelled) {
+                offload->nb_in_flight--;
+                picoquic_sign_job_free(job);
+            }
+            else {
+                job->state = picoquic_sign_job_done;
+                if (offload->done_last == NULL) {
+                    offload->done_first = job;
+                }
+                else {
+                    offload->done_last->next = job;
+                }
+                offload->done_last = job;
+                offload->done_count++;
+            }
+        }
+        picoquic_unlock_mutex(&offload->mutex);
+    }
+
+    picoquic_thread_do_return;
+}
+
+/* Resume the handshakes for which the signature is available.
+ * The completed jobs are taken from the done list one at a time, because
+ * resuming a handshake may delete other connections, and thus destroy
+ * their jobs; jobs still in the done list are unlinked by the destroy
+ * callback. Only the jobs completed before the call are resumed.
+ * Returns the number of handshakes resumed.
+ */
+int picoquic_poll_async_signatures(picoquic_quic_t* quic, uint64_t current_time)
+{
+    picoquic_sign_offload_t* offload = quic->sign_offload;
+    size_t nb_done;
+    int nb_resumed = 0;
+
+    if (offload == NULL || (nb_done = offload->done_count) == 0) {
+        return 0;
+    }
+
+    while (nb_done > 0) {
+        picoquic_sign_job_t* job;
+        picoquic_cnx_t* cnx = NULL;
+
+        nb_done--;
+        picoquic_lock_mutex(&offload->mutex);
+        if ((job = offload->done_first) != NULL) {
+            offload->done_first = job->next;
+            if (offload->done_first == NULL) {
+                offload->done_last = NULL;
+            }
+            offload->done_count--;
+            job->next = NULL;
+            job->state = picoquic_sign_job_delivered;
+            /* The job may be freed during the handshake resumption */
+            cnx = job->cnx;
+        }
+        picoquic_unlock_mutex(&offload->mutex);
+
+        if (cnx == NULL) {
+            break;
+        }
+        cnx->is_signature_pending = 0;
+        (void)picoquic_tls_resume_handshake(cnx, current_time);
+        nb_resumed++;
+    }
+
+    return nb_resumed;
+}
+
+int picoquic_set_async_signing(picoquic_quic_t* quic, int nb_threads, size_t max_batch)
+{
+    int ret = 0;
+    ptls_context_t* ctx = (ptls_context_t*)quic->tls_master_ctx;
+    picoquic_sign_offload_t* offload;
+
+    picoquic_delete_sign_offload(quic);
+
+    if (nb_threads <= 0) {
+        return 0;
+    }
+    if (ctx == NULL || ctx->sign_certificate == NULL) {
+        DBG_PRINTF("%s", "No certificate signer, cannot set asynchronous signing");
+        return PICOQUIC_ERROR_UNEXPECTED_ERROR;
+    }
+    if (nb_threads > PICOQUIC_SIGN_OFFLOAD_MAX_THREADS) {
+        nb_threads = PICOQUIC_SIGN_OFFLOAD_MAX_THREADS;
+    }
+    if (max_batch == 0) {
+        max_batch = 1;
+    }
+
+    if ((offload = (picoquic_sign_offload_t*)malloc(sizeof(picoquic_sign_offload_t))) == NULL) {
+        return PICOQUIC_ERROR_MEMORY;
+    }
+    memset(offload, 0, sizeof(picoquic_sign_offload_t));
+    offload->super.cb = picoquic_sign_offload_cb;
+    offload->signer = ctx->sign_certificate;
+    offload->quic = quic;
+    offload->max_batch = max_batch;
+
+    if (picoquic_create_mutex(&offload->mutex) != 0) {
+        free(offload);
+        return PICOQUIC_ERROR_MEMORY;
+    }
+    if (picoquic_create_event(&offload->event) != 0) {
+        (void)picoquic_delete_mutex(&offload->mutex);
+        free(offload);
+        return PICOQUIC_ERROR_MEMORY;
+    }
+    ctx->sign_certificate = &offload->super;
+    quic->sign_offload = offload;
+
+    for (int i = 0; i < nb_threads; i++) {
+        if (picoquic_create_thread(&offload->threads[i], picoquic_sign_offload_thread, offload) != 0) {
+            DBG_PRINTF("Cannot create signing thread #%d", i);
+            ret = PICOQUIC_ERROR_MEMORY;
+            break;
+        }
+        offload->nb_threads++;
+    }
+
+    if (ret != 0) {
+        picoquic_delete_sign_offload(quic);
+    }
+
+    return ret;
+}
+
+/* Stop the signing threads and restore the original signer. Must be called
+ * after the connections are deleted, since the pending jobs are referenced
+ * by the TLS contexts of these connections.
+ */
+void picoquic_delete_sign_offload(picoquic_quic_t* quic)
+{
+    picoquic_sign_offload_t* offload = quic->sign_offload;
+
+    if (offload != NULL) {
+        ptls_context_t* ctx = (ptls_context_t*)quic->tls_master_ctx;
+
+        offload->is_stopping = 1;
+        for (int i = 0; i < offload->nb_threads; i++) {
+            (void)picoquic_signal_event(&offload->event);
+            picoquic_delete_thread(&offload->threads[i]);
+        }
+        while (offload->pending_first != NULL) {
+            picoquic_sign_job_t* job = offload->pending_first;
+            offload->pending_first = job->next;
+            picoquic_sign_job_free(job);
+        }
+        while (offload->done_first != NULL) {
+            picoquic_sign_job_t* job = offload->done_first;
+            offload->done_first = job->next;
+            picoquic_sign_job_free(job);
+        }
+        if (ctx != NULL && ctx->sign_certificate == &offload->super) {
+            ctx->sign_certificate = offload->signer;
+        }
+        picoquic_delete_event(&offload->event);
+        (void)picoquic_delete_mutex(&offload->mutex);
+        free(offload);
+        quic->sign_offload = NULL;
+    }
+}
+
+int picoquic_has_pending_signatures(picoquic_quic_t* quic)
+{
+    return (quic->sign_offload != NULL && quic->sign_offload->nb_in_flight > 0);
+}
+
+size_t picoquic_get_completed_signatures(picoquic_quic_t* quic)
+{
+    return (quic->sign_offload == NULL) ? 0 : quic->sign_offload->done_count;
+}
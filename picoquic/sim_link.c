@@ -85,6 +85,7 @@ picoquictest_sim_packet_t* picoquictest_sim_link_create_packet()
         packet->next_packet = NULL;
         packet->arrival_time = 0;
         packet->length = 0;
+        packet->ecn_mark = 0;
     }
 
     return packet;
@@ -183,6 +184,11 @@ void picoquictest_sim_link_submit(picoquictest_sim_link_t* link, picoquictest_si
     }
 
     if (!should_drop) {
+        if (link->ecn_mark_threshold > 0 && queue_delay >= link->ecn_mark_threshold &&
+            (packet->ecn_mark == PICOQUIC_ECN_ECT_0 || packet->ecn_mark == PICOQUIC_ECN_ECT_1)) {
+            packet->ecn_mark = PICOQUIC_ECN_CE;
+            link->packets_ce_marked++;
+        }
 
         link->queue_time = current_time + queue_delay + transmit_time;
 
@@ -192,6 +198,7 @@ void picoquictest_sim_link_submit(picoquictest_sim_link_t* link, picoquictest_si
             free(packet);
         } else {
             link->packets_sent++;
+            link->queue_delay_total += queue_delay;
             if (link->last_packet == NULL) {
                 link->first_packet = packet;
             } else {
@@ -98,6 +98,7 @@
 #include "picoquic_internal.h"
 #include "picoquic_packet_loop.h"
 #include "picoquic_unified_log.h"
+#include "picoquic_profiler.h"
 
 #if defined(_WINDOWS)
 static int udp_gso_available = 0;
@@ -380,9 +381,10 @@ int picoquic_packet_loop(picoquic_quic_t* quic,
                                 }
                             }
 
-                            sock_ret = picoquic_sendmsg(send_socket,
+                            sock_ret = picoquic_sendmsg_ecn(send_socket,
                                 (struct sockaddr*)&peer_addr, (struct sockaddr*)&local_addr, if_index,
-                                (const char*)send_buffer, (int)send_length, (int)send_msg_size, &sock_err);
+                                (const char*)send_buffer, (int)send_length, (int)send_msg_size,
+                                picoquic_get_ecn_codepoint(last_cnx), &sock_err);
                             
                         }
 
@@ -408,9 +410,10 @@ int picoquic_packet_loop(picoquic_quic_t* quic,
                                         if (packet_index + packet_size > send_length) {
                                             packet_size = send_length - packet_index;
                                         }
-                                        sock_ret = picoquic_sendmsg(send_socket,
+                                        sock_ret = picoquic_sendmsg_ecn(send_socket,
                                             (struct sockaddr*)&peer_addr, (struct sockaddr*)&local_addr, if_index,
-                                            (const char*)(send_buffer + packet_index), (int)packet_size, 0, &sock_err);
+                                            (const char*)(send_buffer + packet_index), (int)packet_size, 0,
+                                            picoquic_get_ecn_codepoint(last_cnx), &sock_err);
                                         if (sock_ret > 0) {
                                             packet_index += packet_size;
                                         }
@@ -441,6 +444,7 @@ int picoquic_packet_loop(picoquic_quic_t* quic,
                 if (ret == 0 && loop_callback != NULL) {
                     ret = loop_callback(quic, picoquic_packet_loop_after_send, loop_callback_ctx, &bytes_sent);
                 }
+                picoquic_profiler_print_if_due(quic, current_time);
             }
         }
 
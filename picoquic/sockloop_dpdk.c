@@ -65,6 +65,8 @@
 #include "picoquic_internal.h"
 #include "picoquic_packet_loop.h"
 #include "picoquic_unified_log.h"
+#include "picoquic_profiler.h"
+#include "picoquic_events.h"
 #include <rte_common.h>
 #include <rte_log.h>
 #include <rte_malloc.h>
@@ -393,11 +395,19 @@ in6_fast_cksum(const struct in6_addr *saddr,
 #define ICMPV6_SOLICITATED 0x80
 #define ICMPV6_OVERRIDE 0x40
 
+/* Packets that could not be sent when the tx buffer was flushed. As with the
+ * default DPDK callback, the packets are freed. */
 void
 drop_callback(struct rte_mbuf **pkts, uint16_t unsent,
 		void *userdata) {
-    printf("unsent : %u\n",unsent);
-    printf("PACKET DROPPED!\n");
+    picoquic_quic_t *quic = (picoquic_quic_t *)userdata;
+
+    for (uint16_t i = 0; i < unsent; i++) {
+        rte_pktmbuf_free(pkts[i]);
+    }
+    picoquic_event_count(quic, picoquic_event_tx_dropped, unsent);
+    picoquic_event_text(quic, picoquic_event_tx_dropped, NULL, picoquic_current_time(),
+        "%u packets not sent", unsent);
 }
 
 int picoquic_packet_loop_dpdk(picoquic_quic_t *quic,
@@ -499,7 +509,7 @@ int picoquic_packet_loop_dpdk(picoquic_quic_t *quic,
     if (ret != 0) {
         return ret;
     }
-    rte_eth_tx_buffer_set_err_callback(tx_buffer, drop_callback, 0);
+    rte_eth_tx_buffer_set_err_callback(tx_buffer, drop_callback, quic);
 
 
 
@@ -570,10 +580,7 @@ int picoquic_packet_loop_dpdk(picoquic_quic_t *quic,
                     packet_received = true; 
                     udp_hdr = (struct rte_udp_hdr *)((unsigned char *)ip_hdr + sizeof(struct rte_ipv4_hdr));
 
-                    if ((ip_hdr->type_of_service & 0b11) == 0b11)
-                    {
-                        received_ecn = 1;
-                    }
+                    received_ecn = ip_hdr->type_of_service & PICOQUIC_ECN_CE;
                     src_addr = ip_hdr->src_addr;
                     dst_addr = ip_hdr->dst_addr;
                     src_port = udp_hdr->src_port;
@@ -602,10 +609,16 @@ int picoquic_packet_loop_dpdk(picoquic_quic_t *quic,
                     unsigned char *payload = (unsigned char *)(udp_hdr + 1);
                     rte_be16_t length = udp_hdr->dgram_len;
                     size_t payload_length = htons(length) - sizeof(struct rte_udp_hdr);
-                    (void)picoquic_incoming_packet_ex(quic, payload,
-                                                      payload_length, (struct sockaddr *)&addr_from,
-                                                      (struct sockaddr *)&addr_to, if_index_to, received_ecn,
-                                                      &last_cnx, current_time);
+                    /* Under load, Retry, VN and stateless resets are handled without
+                     * creating connection contexts; responses are queued as stateless packets. */
+                    if (picoquic_stateless_prefilter(quic, payload, payload_length, (struct sockaddr *)&addr_from,
+                            (struct sockaddr *)&addr_to, if_index_to, current_time, NULL, 0, NULL) == PICOQUIC_PREFILTER_PASS)
+                    {
+                        (void)picoquic_incoming_packet_ex(quic, payload,
+                                                          payload_length, (struct sockaddr *)&addr_from,
+                                                          (struct sockaddr *)&addr_to, if_index_to, received_ecn,
+                                                          &last_cnx, current_time);
+                    }
 
                     if (loop_callback != NULL)
                     {
@@ -620,13 +633,15 @@ int picoquic_packet_loop_dpdk(picoquic_quic_t *quic,
                 }
                 if (ip_hdr->next_proto_id == IPPROTO_ICMP)
                 {
-                    printf("ICMP packet received : ignored\n");
+                    picoquic_event_signal(quic, picoquic_event_icmp_received, NULL, current_time,
+                        "ICMP packet received : ignored");
                     rte_pktmbuf_free(pkts_burst[i]);
                     continue;
                 }
                 else
                 {
-                    printf("Unknown IP protocol : %x\n", ip_hdr->next_proto_id);
+                    picoquic_event_signal(quic, picoquic_event_unknown_ip_protocol, NULL, current_time,
+                        "Unknown IP protocol : %x", ip_hdr->next_proto_id);
                     rte_pktmbuf_free(pkts_burst[i]);
                     continue;
                 }
@@ -634,15 +649,16 @@ int picoquic_packet_loop_dpdk(picoquic_quic_t *quic,
             else if (eth_hdr->ether_type == rte_cpu_to_be_16(RTE_ETHER_TYPE_ARP))
             {
                 struct rte_arp_hdr *arp_hdr;
-                printf("ARP packet received\n");
                 arp_hdr = (struct rte_arp_hdr *)((char *)(eth_hdr + 1) + 0);
                 uint32_t bond_ip = (*(struct sockaddr_in *)(&my_addr)).sin_addr.s_addr;
-                printf("ARP IP (mine) %x (asked) %x\n", bond_ip, arp_hdr->arp_data.arp_tip);
+                picoquic_event_signal(quic, picoquic_event_arp_received, NULL, current_time,
+                    "ARP IP (mine) %x (asked) %x", bond_ip, arp_hdr->arp_data.arp_tip);
                 if (arp_hdr->arp_data.arp_tip == bond_ip)
                 {
                     if (arp_hdr->arp_opcode == rte_cpu_to_be_16(RTE_ARP_OP_REQUEST))
                     {
-                        printf("ARP request received, sending reply\n");
+                        picoquic_event_signal(quic, picoquic_event_arp_reply_sent, NULL, current_time,
+                            "ARP request received, sending reply");
 
                         // The packet is created in place : we rewrite the packet received and send it back to avoid memory allocation
                         arp_hdr->arp_opcode = rte_cpu_to_be_16(RTE_ARP_OP_REPLY);
@@ -685,11 +701,7 @@ int picoquic_packet_loop_dpdk(picoquic_quic_t *quic,
                     src_port = udp_hdr->src_port;
                     dst_port = udp_hdr->dst_port;
 
-                    if ((ip6_hdr->vtc_flow & RTE_IPV6_HDR_ECN_MASK) == RTE_IPV6_HDR_ECN_CE)
-                    {
-
-                        received_ecn = 1;
-                    }
+                    received_ecn = (rte_be_to_cpu_32(ip6_hdr->vtc_flow) >> 20) & PICOQUIC_ECN_CE;
 
                     // printf("Adding %x-> %x:..:%x\n", src_addr,  eth_hdr->s_addr.addr_bytes[0], eth_hdr->s_addr.addr_bytes[5]);
 #if RTE_VERSION < RTE_VERSION_NUM(21, 11, 0, 0)
@@ -709,10 +721,16 @@ int picoquic_packet_loop_dpdk(picoquic_quic_t *quic,
                     unsigned char *payload = (unsigned char *)(udp_hdr + 1);
                     rte_be16_t length = udp_hdr->dgram_len;
                     size_t payload_length = htons(length) - sizeof(struct rte_udp_hdr);
-                    (void)picoquic_incoming_packet_ex(quic, payload,
-                                                      payload_length, (struct sockaddr *)&addr_from,
-                                                      (struct sockaddr *)&addr_to, if_index_to, received_ecn,
-                                                      &last_cnx, current_time);
+                    /* Under load, Retry, VN and stateless resets are handled without
+                     * creating connection contexts; responses are queued as stateless packets. */
+                    if (picoquic_stateless_prefilter(quic, payload, payload_length, (struct sockaddr *)&addr_from,
+                            (struct sockaddr *)&addr_to, if_index_to, current_time, NULL, 0, NULL) == PICOQUIC_PREFILTER_PASS)
+                    {
+                        (void)picoquic_incoming_packet_ex(quic, payload,
+                                                          payload_length, (struct sockaddr *)&addr_from,
+                                                          (struct sockaddr *)&addr_to, if_index_to, received_ecn,
+                                                          &last_cnx, current_time);
+                    }
 
                     if (loop_callback != NULL)
                     {
@@ -728,7 +746,8 @@ int picoquic_packet_loop_dpdk(picoquic_quic_t *quic,
                 else if (ip6_hdr->proto == IPPROTO_ICMPV6)
                 {
                     struct rte_icmp_hdr *icmp_hdr = (struct rte_icmp_hdr *)((unsigned char *)ip6_hdr + sizeof(struct rte_ipv6_hdr));
-                    printf("ICMP proto %d %d\n", icmp_hdr->icmp_type, icmp_hdr->icmp_code);
+                    picoquic_event_signal(quic, picoquic_event_icmpv6_received, NULL, current_time,
+                        "ICMP proto %d %d", icmp_hdr->icmp_type, icmp_hdr->icmp_code);
                     if (icmp_hdr->icmp_type == 135)
                     {
                         struct nd_sol *ea = (struct nd_sol *)icmp_hdr;
@@ -769,13 +788,15 @@ int picoquic_packet_loop_dpdk(picoquic_quic_t *quic,
                 }
                 else
                 {
-                    printf("Unknown IPv6 protocol %x\n", ip6_hdr->proto);
+                    picoquic_event_signal(quic, picoquic_event_unknown_ipv6_protocol, NULL, current_time,
+                        "Unknown IPv6 protocol %x", ip6_hdr->proto);
                     rte_pktmbuf_free(pkts_burst[i]);
                 }
             }
             else
             {
-                printf("Unknown ethernet protocol %x\n", eth_hdr->ether_type);
+                picoquic_event_signal(quic, picoquic_event_unknown_ethertype, NULL, current_time,
+                    "Unknown ethernet protocol %x", eth_hdr->ether_type);
                 rte_pktmbuf_free(pkts_burst[i]);
             }
         }
@@ -878,7 +899,8 @@ int picoquic_packet_loop_dpdk(picoquic_quic_t *quic,
 
                         //(*(struct sockaddr_in *)(&addr_from)).sin_port = src_port;
                         // printf("Local addr port %d", (*(struct sockaddr_in *)(&local_addr)).sin_port);
-                        setup_pkt_udp_ip6_headers(&ip_hdr_struct, &udp_hdr_struct, send_length, my_addr, peer_addr);
+                        setup_pkt_udp_ip6_headers(&ip_hdr_struct, &udp_hdr_struct, send_length, my_addr, peer_addr,
+                            picoquic_get_ecn_codepoint(last_cnx));
                         (&eth_hdr_struct)->ether_type = rte_cpu_to_be_16(RTE_ETHER_TYPE_IPV6);
                         copy_buf_to_pkt(&eth_hdr_struct, sizeof(struct rte_ether_hdr), m, offset);
                         offset += sizeof(struct rte_ether_hdr);
@@ -900,7 +922,8 @@ int picoquic_packet_loop_dpdk(picoquic_quic_t *quic,
 
                         //(*(struct sockaddr_in *)(&addr_from)).sin_port = src_port;
                         // printf("Local addr port %d", (*(struct sockaddr_in *)(&local_addr)).sin_port);
-                        setup_pkt_udp_ip_headers(&ip_hdr_struct, &udp_hdr_struct, send_length, my_addr, peer_addr);
+                        setup_pkt_udp_ip_headers(&ip_hdr_struct, &udp_hdr_struct, send_length, my_addr, peer_addr,
+                            picoquic_get_ecn_codepoint(last_cnx));
                         (&eth_hdr_struct)->ether_type = rte_cpu_to_be_16(RTE_ETHER_TYPE_IPV4);
                         copy_buf_to_pkt(&eth_hdr_struct, sizeof(struct rte_ether_hdr), m, offset);
                         offset += sizeof(struct rte_ether_hdr);
@@ -927,10 +950,6 @@ int picoquic_packet_loop_dpdk(picoquic_quic_t *quic,
             if (pkt_created || max_tx < 8)
             {
                 int sent = rte_eth_tx_buffer_flush(portid, queueid, tx_buffer);
-                if (sent < pkt_created)
-                    received_ecn = 1;
-                else
-                    received_ecn = 0;
                 pkt_created -= sent;
                 send_counter += sent;
             } /*else if (pkt_created == 0 && pkts_recv == 0) {
@@ -944,6 +963,7 @@ int picoquic_packet_loop_dpdk(picoquic_quic_t *quic,
             {
                 ret = loop_callback(quic, picoquic_packet_loop_after_send, loop_callback_ctx, &bytes_sent);
             }
+            picoquic_profiler_print_if_due(quic, current_time);
         }
         else
         {
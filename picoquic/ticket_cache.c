@@ -0,0 +1,683 @@
+/*
+ * Shared session resumption cache.
+ *
+ * The cache is a set associative hash table, stored in a single shared memory
+ * segment so that it can be used by several QUIC contexts in different threads
+ * or processes. Each key hashes to a set of PICOQUIC_TICKET_CACHE_WAYS entries,
+ * so lookups and updates take constant time. When a set is full, the least
+ * recently used entry of that set is evicted.
+ *
+ * Readers do not take locks. Each entry carries a sequence number, which is
+ * odd while the entry is being written. Readers copy the entry and retry if
+ * the sequence number changed during the copy. Writers are serialized by a
+ * spin lock in the segment header.
+ *
+ * Updates can be logged to an append only file. Each record is written with
+ * a single unbuffered call in append mode, and contains the full key and
+ * value, so the file can be replayed to rebuild the cache after a restart.
+ * The spin lock only covers the update of the shared memory. File writes and
+ * compaction are serialized by a mutex in each handle, so a slow disk only
+ * delays the thread that writes. Compaction rewrites the live entries from
+ * a lock free snapshot of the cache, replaces the file, and increments a
+ * generation number in the segment header; the other handles reopen the
+ * log before their next write when they see the new generation. A record
+ * appended by another handle while the file is replaced may be lost, which
+ * only costs a resumption after a restart.
+ */
+
+#include "picoquic_internal.h"
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#ifndef _WINDOWS
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define PICOQUIC_TICKET_CACHE_MAGIC 0x5049434f54434348ull /* PICOTCCH */
+#define PICOQUIC_TICKET_CACHE_WAYS 8
+#define PICOQUIC_TICKET_CACHE_READ_TRIALS 64
+#define PICOQUIC_TICKET_CACHE_LOG_PUT 1
+#define PICOQUIC_TICKET_CACHE_LOG_REMOVE 2
+#define PICOQUIC_TICKET_CACHE_LOG_HEADER_SIZE (4 + 1 + 8 + 2 + 2)
+#define PICOQUIC_TICKET_CACHE_COMPACT_RATIO 4
+#define PICOQUIC_TICKET_CACHE_ATTACH_TRIALS 1000 /* Wait at most 1 second for the creator of a segment */
+#define PICOQUIC_TICKET_CACHE_ATTACH_WAIT_USEC 1000
+
+typedef struct st_picoquic_ticket_cache_entry_t {
+    uint32_t seq; /* odd while the entry is being updated */
+    uint16_t key_length;
+    uint16_t value_length;
+    uint64_t key_hash;
+    uint64_t expiry_time;
+    uint64_t last_access;
+    uint8_t key[PICOQUIC_TICKET_CACHE_KEY_MAX];
+    uint8_t value[PICOQUIC_TICKET_CACHE_VALUE_MAX];
+} picoquic_ticket_cache_entry_t;
+
+typedef struct st_picoquic_ticket_cache_header_t {
+    uint64_t magic;
+    uint64_t nb_sets;
+    uint64_t access_clock;
+    uint64_t nb_entries_used;
+    uint64_t nb_evictions;
+    uint64_t nb_log_records;
+    uint64_t log_generation;
+    uint32_t writer_lock;
+    uint32_t is_ready;
+} picoquic_ticket_cache_header_t;
+
+struct st_picoquic_ticket_cache_t {
+    picoquic_ticket_cache_header_t* header;
+    picoquic_ticket_cache_entry_t* entries;
+    size_t mapped_size;
+    picoquic_mutex_t log_mutex; /* Protects the log file of this handle */
+    FILE* F_log;
+    char* log_file_name;
+    uint64_t log_generation;
+    char* shm_name; /* Name of the segment, if created by this handle */
+    unsigned int is_mapped : 1;
+    unsigned int is_replaying : 1;
+};
+
+static uint64_t picoquic_ticket_cache_hash(const uint8_t* key, size_t key_length)
+{
+    /* FNV-1a, then a final mix so that the low order bits select the set */
+    uint64_t h = 0xcbf29ce484222325ull;
+
+    for (size_t i = 0; i < key_length; i++) {
+        h ^= key[i];
+        h *= 0x100000001b3ull;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+
+    return h;
+}
+
+static void picoquic_ticket_cache_lock(picoquic_ticket_cache_t* cache)
+{
+    while (!PICOQUIC_ATOMIC_CAS_32(&cache->header->writer_lock, 0, 1)) {
+        /* Spin. Updates are short, and only happen once per connection */
+    }
+}
+
+static void picoquic_ticket_cache_unlock(picoquic_ticket_cache_t* cache)
+{
+    PICOQUIC_ATOMIC_STORE_32(&cache->header->writer_lock, 0);
+}
+
+static picoquic_ticket_cache_entry_t* picoquic_ticket_cache_set(picoquic_ticket_cache_t* cache, uint64_t key_hash)
+{
+    return &cache->entries[(key_hash % cache->header->nb_sets) * PICOQUIC_TICKET_CACHE_WAYS];
+}
+
+static int picoquic_ticket_cache_entry_match(picoquic_ticket_cache_entry_t* entry, uint64_t key_hash,
+    const uint8_t* key, size_t key_length)
+{
+    return (entry->key_hash == key_hash && entry->key_length == key_length &&
+        memcmp(entry->key, key, key_length) == 0);
+}
+
+/* Format a log record, and return its length */
+static size_t picoquic_ticket_cache_format_record(uint8_t* buffer, uint8_t record_type,
+    const uint8_t* key, size_t key_length, const uint8_t* value, size_t value_length, uint64_t expiry_time)
+{
+    size_t record_length = PICOQUIC_TICKET_CACHE_LOG_HEADER_SIZE + key_length + value_length;
+
+    picoformat_32(buffer, (uint32_t)record_length);
+    buffer[4] = record_type;
+    picoformat_64(buffer + 5, expiry_time);
+    picoformat_16(buffer + 13, (uint16_t)key_length);
+    picoformat_16(buffer + 15, (uint16_t)value_length);
+    memcpy(buffer + PICOQUIC_TICKET_CACHE_LOG_HEADER_SIZE, key, key_length);
+    if (value_length > 0) {
+        memcpy(buffer + PICOQUIC_TICKET_CACHE_LOG_HEADER_SIZE + key_length, value, value_length);
+    }
+
+    return record_length;
+}
+
+/* Open the log in append mode, without buffering, so that each record is
+ * written with a single call and records from several processes do not
+ * interleave. */
+static FILE* picoquic_ticket_cache_open_append(char const* log_file_name)
+{
+    FILE* F = picoquic_file_open(log_file_name, "ab");
+
+    if (F != NULL) {
+        (void)setvbuf(F, NULL, _IONBF, 0);
+    }
+
+    return F;
+}
+
+/* Logging of updates to the append only file. Called without the writer lock. */
+static int picoquic_ticket_cache_log_record(picoquic_ticket_cache_t* cache, uint8_t record_type,
+    const uint8_t* key, size_t key_length, const uint8_t* value, size_t value_length, uint64_t expiry_time)
+{
+    int ret = 0;
+    uint8_t buffer[PICOQUIC_TICKET_CACHE_LOG_HEADER_SIZE + PICOQUIC_TICKET_CACHE_KEY_MAX + PICOQUIC_TICKET_CACHE_VALUE_MAX];
+    size_t record_length = picoquic_ticket_cache_format_record(buffer, record_type, key, key_length,
+        value, value_length, expiry_time);
+
+    picoquic_lock_mutex(&cache->log_mutex);
+    if (cache->log_file_name != NULL) {
+        /* Reopen the log if it was compacted through another handle, or if reopening failed */
+        if (cache->F_log == NULL || cache->log_generation != cache->header->log_generation) {
+            if (cache->F_log != NULL) {
+                (void)picoquic_file_close(cache->F_log);
+            }
+            cache->F_log = picoquic_ticket_cache_open_append(cache->log_file_name);
+            cache->log_generation = cache->header->log_generation;
+        }
+        if (cache->F_log == NULL || fwrite(buffer, 1, record_length, cache->F_log) != record_length) {
+            ret = PICOQUIC_ERROR_INVALID_FILE;
+        }
+        else {
+            (void)PICOQUIC_ATOMIC_INC_64(&cache->header->nb_log_records);
+        }
+    }
+    picoquic_unlock_mutex(&cache->log_mutex);
+
+    return ret;
+}
+
+int picoquic_ticket_cache_put(picoquic_ticket_cache_t* cache, const uint8_t* key, size_t key_length,
+    const uint8_t* value, size_t value_length, uint64_t expiry_time, uint64_t current_time)
+{
+    int ret = 0;
+
+    if (key_length > PICOQUIC_TICKET_CACHE_KEY_MAX || value_length > PICOQUIC_TICKET_CACHE_VALUE_MAX) {
+        ret = PICOQUIC_ERROR_INVALID_TICKET;
+    }
+    else {
+        uint64_t key_hash = picoquic_ticket_cache_hash(key, key_length);
+        picoquic_ticket_cache_entry_t* set = picoquic_ticket_cache_set(cache, key_hash);
+        picoquic_ticket_cache_entry_t* target = NULL;
+        picoquic_ticket_cache_entry_t* oldest = NULL;
+
+        picoquic_ticket_cache_lock(cache);
+
+        for (int i = 0; i < PICOQUIC_TICKET_CACHE_WAYS; i++) {
+            picoquic_ticket_cache_entry_t* entry = &set[i];
+            if (entry->key_length == 0) {
+                if (target == NULL) {
+                    target = entry;
+                }
+            }
+            else if (picoquic_ticket_cache_entry_match(entry, key_hash, key, key_length)) {
+                target = entry;
+                break;
+            }
+            else if (oldest == NULL || entry->last_access < oldest->last_access) {
+                oldest = entry;
+            }
+        }
+
+        if (target == NULL) {
+            target = oldest;
+            cache->header->nb_evictions++;
+        }
+        else if (target->key_length == 0) {
+            cache->header->nb_entries_used++;
+        }
+
+        PICOQUIC_ATOMIC_STORE_32(&target->seq, target->seq + 1);
+        PICOQUIC_MEMORY_FENCE();
+        target->key_hash = key_hash;
+        target->key_length = (uint16_t)key_length;
+        memcpy(target->key, key, key_length);
+        target->value_length = (uint16_t)value_length;
+        memcpy(target->value, value, value_length);
+        target->expiry_time = expiry_time;
+        target->last_access = PICOQUIC_ATOMIC_INC_64(&cache->header->access_clock);
+        PICOQUIC_MEMORY_FENCE();
+        PICOQUIC_ATOMIC_STORE_32(&target->seq, target->seq + 1);
+
+        picoquic_ticket_cache_unlock(cache);
+
+        if (!cache->is_replaying) {
+            ret = picoquic_ticket_cache_log_record(cache, PICOQUIC_TICKET_CACHE_LOG_PUT,
+                key, key_length, value, value_length, expiry_time);
+            if (ret == 0 && cache->header->nb_log_records >
+                PICOQUIC_TICKET_CACHE_COMPACT_RATIO * PICOQUIC_TICKET_CACHE_WAYS * cache->header->nb_sets) {
+                ret = picoquic_ticket_cache_compact_log(cache, current_time);
+            }
+        }
+    }
+
+    return ret;
+}
+
+int picoquic_ticket_cache_get(picoquic_ticket_cache_t* cache, const uint8_t* key, size_t key_length,
+    uint8_t* value, size_t value_max, size_t* value_length, uint64_t current_time)
+{
+    int ret = -1;
+    uint64_t key_hash = picoquic_ticket_cache_hash(key, key_length);
+    picoquic_ticket_cache_entry_t* set = picoquic_ticket_cache_set(cache, key_hash);
+
+    *value_length = 0;
+
+    for (int i = 0; ret != 0 && i < PICOQUIC_TICKET_CACHE_WAYS; i++) {
+        picoquic_ticket_cache_entry_t* entry = &set[i];
+
+        for (int trial = 0; trial < PICOQUIC_TICKET_CACHE_READ_TRIALS; trial++) {
+            uint32_t seq = PICOQUIC_ATOMIC_LOAD_32(&entry->seq);
+            int is_match = 0;
+            size_t copied = 0;
+
+            if ((seq & 1) != 0) {
+                /* Write in progress */
+                continue;
+            }
+            if (picoquic_ticket_cache_entry_match(entry, key_hash, key, key_length) &&
+                entry->expiry_time > current_time && entry->value_length <= value_max) {
+                copied = entry->value_length;
+                memcpy(value, entry->value, copied);
+                is_match = 1;
+            }
+            PICOQUIC_MEMORY_FENCE();
+            if (PICOQUIC_ATOMIC_LOAD_32(&entry->seq) == seq) {
+                if (is_match) {
+                    /* Relaxed update of the LRU clock. Losing a race here only affects eviction order. */
+                    entry->last_access = PICOQUIC_ATOMIC_INC_64(&cache->header->access_clock);
+                    *value_length = copied;
+                    ret = 0;
+                }
+                break;
+            }
+        }
+    }
+
+    return ret;
+}
+
+int picoquic_ticket_cache_remove(picoquic_ticket_cache_t* cache, const uint8_t* key, size_t key_length)
+{
+    int ret = -1;
+    uint64_t key_hash = picoquic_ticket_cache_hash(key, key_length);
+    picoquic_ticket_cache_entry_t* set = picoquic_ticket_cache_set(cache, key_hash);
+
+    picoquic_ticket_cache_lock(cache);
+    for (int i = 0; i < PICOQUIC_TICKET_CACHE_WAYS; i++) {
+        picoquic_ticket_cache_entry_t* entry = &set[i];
+        if (entry->key_length != 0 && picoquic_ticket_cache_entry_match(entry, key_hash, key, key_length)) {
+            PICOQUIC_ATOMIC_STORE_32(&entry->seq, entry->seq + 1);
+            PICOQUIC_MEMORY_FENCE();
+            entry->key_length = 0;
+            entry->key_hash = 0;
+            entry->value_length = 0;
+            entry->expiry_time = 0;
+            PICOQUIC_MEMORY_FENCE();
+            PICOQUIC_ATOMIC_STORE_32(&entry->seq, entry->seq + 1);
+            cache->header->nb_entries_used--;
+            ret = 0;
+            break;
+        }
+    }
+    picoquic_ticket_cache_unlock(cache);
+    if (ret == 0 && !cache->is_replaying) {
+        ret = picoquic_ticket_cache_log_record(cache, PICOQUIC_TICKET_CACHE_LOG_REMOVE,
+            key, key_length, NULL, 0, 0);
+    }
+
+    return ret;
+}
+
+static void picoquic_ticket_cache_attach_wait()
+{
+#ifdef _WINDOWS
+    Sleep(PICOQUIC_TICKET_CACHE_ATTACH_WAIT_USEC / 1000);
+#else
+    usleep(PICOQUIC_TICKET_CACHE_ATTACH_WAIT_USEC);
+#endif
+}
+
+#ifndef _WINDOWS
+/* Wait until the creator of a named segment has set its size. Touching the
+ * mapping before that would raise SIGBUS. A segment created for a different
+ * number of entries is rejected.
+ */
+static int picoquic_ticket_cache_wait_size(int fd, size_t mapped_size)
+{
+    int ret = -1;
+
+    for (int trial = 0; trial < PICOQUIC_TICKET_CACHE_ATTACH_TRIALS; trial++) {
+        struct stat st;
+
+        if (fstat(fd, &st) != 0 || (st.st_size != 0 && (size_t)st.st_size != mapped_size)) {
+            break;
+        }
+        else if ((size_t)st.st_size == mapped_size) {
+            ret = 0;
+            break;
+        }
+        picoquic_ticket_cache_attach_wait();
+    }
+
+    return ret;
+}
+#endif
+
+/* Wait until the creator has initialized the segment */
+static int picoquic_ticket_cache_wait_ready(picoquic_ticket_cache_header_t* header)
+{
+    int ret = -1;
+
+    for (int trial = 0; trial < PICOQUIC_TICKET_CACHE_ATTACH_TRIALS; trial++) {
+        if (PICOQUIC_ATOMIC_LOAD_32(&header->is_ready) != 0) {
+            ret = 0;
+            break;
+        }
+        picoquic_ticket_cache_attach_wait();
+    }
+
+    return ret;
+}
+
+/* Creation and deletion of the cache.
+ * The segment is initialized by the first process that maps it. The others
+ * wait until it is sized and the "is_ready" flag is set, for at most one
+ * second, e.g., if the creator crashed. The handle that created a named
+ * segment unlinks it when it is deleted. Processes that are attached keep
+ * using the segment; processes that attach later create a new one.
+ */
+picoquic_ticket_cache_t* picoquic_ticket_cache_create(size_t nb_entries, char const* shm_name)
+{
+    picoquic_ticket_cache_t* cache = (picoquic_ticket_cache_t*)malloc(sizeof(picoquic_ticket_cache_t));
+
+    if (cache != NULL) {
+        memset(cache, 0, sizeof(picoquic_ticket_cache_t));
+        if (picoquic_create_mutex(&cache->log_mutex) != 0) {
+            free(cache);
+            cache = NULL;
+        }
+    }
+
+    if (cache != NULL) {
+        size_t nb_sets = (nb_entries + PICOQUIC_TICKET_CACHE_WAYS - 1) / PICOQUIC_TICKET_CACHE_WAYS;
+        size_t header_size = (sizeof(picoquic_ticket_cache_header_t) + 63) & ~((size_t)63);
+        int is_creator = 1;
+        void* mem = NULL;
+
+        if (nb_sets == 0) {
+            nb_sets = 1;
+        }
+        cache->mapped_size = header_size + nb_sets * PICOQUIC_TICKET_CACHE_WAYS * sizeof(picoquic_ticket_cache_entry_t);
+#ifdef _WINDOWS
+        if (shm_name == NULL) {
+            mem = calloc(1, cache->mapped_size);
+        }
+#else
+        if (shm_name == NULL) {
+            mem = mmap(NULL, cache->mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        }
+        else {
+            int fd = shm_open(shm_name, O_RDWR | O_CREAT | O_EXCL, 0600);
+            if (fd < 0 && errno == EEXIST) {
+                is_creator = 0;
+                fd = shm_open(shm_name, O_RDWR, 0600);
+            }
+            if (fd >= 0) {
+                if ((is_creator) ? (ftruncate(fd, (off_t)cache->mapped_size) == 0) :
+                    (picoquic_ticket_cache_wait_size(fd, cache->mapped_size) == 0)) {
+                    mem = mmap(NULL, cache->mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+                }
+                if (is_creator && mem != NULL && mem != MAP_FAILED &&
+                    (cache->shm_name = picoquic_string_duplicate(shm_name)) == NULL) {
+                    (void)munmap(mem, cache->mapped_size);
+                    mem = NULL;
+                }
+                if (is_creator && (mem == NULL || mem == MAP_FAILED)) {
+                    (void)shm_unlink(shm_name);
+                }
+                close(fd);
+            }
+        }
+        if (mem == MAP_FAILED) {
+            mem = NULL;
+        }
+        cache->is_mapped = 1;
+#endif
+        if (mem == NULL) {
+            DBG_PRINTF("Cannot allocate ticket cache of %d bytes", (int)cache->mapped_size);
+            (void)picoquic_delete_mutex(&cache->log_mutex);
+            free(cache);
+            cache = NULL;
+        }
+        else {
+            cache->header = (picoquic_ticket_cache_header_t*)mem;
+            cache->entries = (picoquic_ticket_cache_entry_t*)(((uint8_t*)mem) + header_size);
+            if (is_creator) {
+                /* Anonymous and new shm segments are zero filled */
+                cache->header->magic = PICOQUIC_TICKET_CACHE_MAGIC;
+                cache->header->nb_sets = nb_sets;
+                PICOQUIC_ATOMIC_STORE_32(&cache->header->is_ready, 1);
+            }
+            else {
+                if (picoquic_ticket_cache_wait_ready(cache->header) != 0) {
+                    DBG_PRINTF("Shared ticket cache %s was never initialized", shm_name);
+                    picoquic_ticket_cache_delete(cache);
+                    cache = NULL;
+                }
+                else if (cache->header->magic != PICOQUIC_TICKET_CACHE_MAGIC || cache->header->nb_sets != nb_sets) {
+                    DBG_PRINTF("Shared ticket cache %s does not match the requested size", shm_name);
+                    picoquic_ticket_cache_delete(cache);
+                    cache = NULL;
+                }
+            }
+        }
+    }
+
+    return cache;
+}
+
+void picoquic_ticket_cache_delete(picoquic_ticket_cache_t* cache)
+{
+    if (cache->F_log != NULL) {
+        cache->F_log = picoquic_file_close(cache->F_log);
+    }
+    if (cache->log_file_name != NULL) {
+        free(cache->log_file_name);
+    }
+    if (cache->header != NULL) {
+#ifdef _WINDOWS
+        free(cache->header);
+#else
+        (void)munmap(cache->header, cache->mapped_size);
+        if (cache->shm_name != NULL) {
+            (void)shm_unlink(cache->shm_name);
+        }
+#endif
+    }
+    if (cache->shm_name != NULL) {
+        free(cache->shm_name);
+    }
+    (void)picoquic_delete_mutex(&cache->log_mutex);
+    free(cache);
+}
+
+/* Open the update log. Records already present are replayed into the cache,
+ * then the file is kept open in append mode.
+ */
+int picoquic_ticket_cache_open_log(picoquic_ticket_cache_t* cache, char const* log_file_name, uint64_t current_time)
+{
+    int ret = 0;
+    int last_err = 0;
+    FILE* F = picoquic_file_open_ex(log_file_name, "rb", &last_err);
+
+    uint64_t nb_records = 0;
+
+    picoquic_lock_mutex(&cache->log_mutex);
+    if (cache->F_log != NULL) {
+        cache->F_log = picoquic_file_close(cache->F_log);
+    }
+    picoquic_unlock_mutex(&cache->log_mutex);
+
+    if (F != NULL) {
+        uint8_t buffer[PICOQUIC_TICKET_CACHE_LOG_HEADER_SIZE + PICOQUIC_TICKET_CACHE_KEY_MAX + PICOQUIC_TICKET_CACHE_VALUE_MAX];
+
+        cache->is_replaying = 1;
+        while (ret == 0 && fread(buffer, 1, 4, F) == 4) {
+            size_t record_length = PICOPARSE_32(buffer);
+            if (record_length < PICOQUIC_TICKET_CACHE_LOG_HEADER_SIZE || record_length > sizeof(buffer) ||
+                fread(buffer + 4, 1, record_length - 4, F) != record_length - 4) {
+                /* Truncated or corrupted record, e.g. after a crash. Ignore the tail. */
+                break;
+            }
+            else {
+                uint8_t record_type = buffer[4];
+                uint64_t expiry_time = PICOPARSE_64(buffer + 5);
+                size_t key_length = PICOPARSE_16(buffer + 13);
+                size_t value_length = PICOPARSE_16(buffer + 15);
+
+                if (PICOQUIC_TICKET_CACHE_LOG_HEADER_SIZE + key_length + value_length != record_length) {
+                    break;
+                }
+                nb_records++;
+                if (record_type == PICOQUIC_TICKET_CACHE_LOG_PUT) {
+                    if (expiry_time > current_time) {
+                        ret = picoquic_ticket_cache_put(cache, buffer + PICOQUIC_TICKET_CACHE_LOG_HEADER_SIZE, key_length,
+                            buffer + PICOQUIC_TICKET_CACHE_LOG_HEADER_SIZE + key_length, value_length, expiry_time,
+                            current_time);
+                    }
+                }
+                else if (record_type == PICOQUIC_TICKET_CACHE_LOG_REMOVE) {
+                    (void)picoquic_ticket_cache_remove(cache, buffer + PICOQUIC_TICKET_CACHE_LOG_HEADER_SIZE, key_length);
+                }
+            }
+        }
+        cache->is_replaying = 0;
+        (void)picoquic_file_close(F);
+    }
+    else if (last_err != ENOENT) {
+        ret = PICOQUIC_ERROR_INVALID_FILE;
+    }
+
+    if (ret == 0) {
+        if (cache->log_file_name != log_file_name) {
+            if (cache->log_file_name != NULL) {
+                free(cache->log_file_name);
+            }
+            cache->log_file_name = picoquic_string_duplicate(log_file_name);
+        }
+        if (cache->log_file_name == NULL) {
+            ret = PICOQUIC_ERROR_MEMORY;
+        }
+        else {
+            picoquic_lock_mutex(&cache->log_mutex);
+            if ((cache->F_log = picoquic_ticket_cache_open_append(log_file_name)) == NULL) {
+                ret = PICOQUIC_ERROR_INVALID_FILE;
+            }
+            else {
+                cache->log_generation = cache->header->log_generation;
+                cache->header->nb_log_records = nb_records;
+            }
+            picoquic_unlock_mutex(&cache->log_mutex);
+        }
+    }
+
+    return ret;
+}
+
+#ifdef _WINDOWS
+#define picoquic_ticket_cache_process_id() ((unsigned long)GetCurrentProcessId())
+#else
+#define picoquic_ticket_cache_process_id() ((unsigned long)getpid())
+#endif
+
+/* Copy an entry without the writer lock, with the same sequence number
+ * checks as the readers. Returns 1 if a consistent copy was obtained.
+ */
+static int picoquic_ticket_cache_copy_entry(picoquic_ticket_cache_entry_t* entry, picoquic_ticket_cache_entry_t* copy)
+{
+    int is_copied = 0;
+
+    for (int trial = 0; !is_copied && trial < PICOQUIC_TICKET_CACHE_READ_TRIALS; trial++) {
+        uint32_t seq = PICOQUIC_ATOMIC_LOAD_32(&entry->seq);
+
+        if ((seq & 1) == 0) {
+            memcpy(copy, entry, sizeof(picoquic_ticket_cache_entry_t));
+            PICOQUIC_MEMORY_FENCE();
+            is_copied = (PICOQUIC_ATOMIC_LOAD_32(&entry->seq) == seq);
+        }
+    }
+
+    return is_copied;
+}
+
+/* Rewrite the log with only the live entries, then swap it in place of the
+ * current log. Entries that expired before current_time are not copied.
+ * The entries are read without the writer lock. The temporary file is
+ * specific to the process and handle, so concurrent compactions through
+ * other handles do not collide; each of them renames a complete snapshot.
+ */
+int picoquic_ticket_cache_compact_log(picoquic_ticket_cache_t* cache, uint64_t current_time)
+{
+    int ret = 0;
+    char temp_name[512];
+    FILE* F_temp = NULL;
+
+    picoquic_lock_mutex(&cache->log_mutex);
+
+    if (cache->log_file_name == NULL || cache->F_log == NULL) {
+        ret = -1;
+    }
+    else if (picoquic_sprintf(temp_name, sizeof(temp_name), NULL, "%s.%lu.%p.tmp", cache->log_file_name,
+        picoquic_ticket_cache_process_id(), (void*)cache) != 0 ||
+        (F_temp = picoquic_file_open(temp_name, "wb")) == NULL) {
+        ret = PICOQUIC_ERROR_INVALID_FILE;
+    }
+    else {
+        uint8_t buffer[PICOQUIC_TICKET_CACHE_LOG_HEADER_SIZE + PICOQUIC_TICKET_CACHE_KEY_MAX + PICOQUIC_TICKET_CACHE_VALUE_MAX];
+        picoquic_ticket_cache_entry_t entry;
+        size_t nb_entries = (size_t)cache->header->nb_sets * PICOQUIC_TICKET_CACHE_WAYS;
+        uint64_t nb_records = 0;
+
+        for (size_t i = 0; ret == 0 && i < nb_entries; i++) {
+            if (picoquic_ticket_cache_copy_entry(&cache->entries[i], &entry) &&
+                entry.key_length > 0 && entry.expiry_time > current_time) {
+                size_t record_length = picoquic_ticket_cache_format_record(buffer, PICOQUIC_TICKET_CACHE_LOG_PUT,
+                    entry.key, entry.key_length, entry.value, entry.value_length, entry.expiry_time);
+
+                if (fwrite(buffer, 1, record_length, F_temp) != record_length) {
+                    ret = PICOQUIC_ERROR_INVALID_FILE;
+                }
+                else {
+                    nb_records++;
+                }
+            }
+        }
+        if (fflush(F_temp) != 0) {
+            ret = PICOQUIC_ERROR_INVALID_FILE;
+        }
+        (void)picoquic_file_close(F_temp);
+
+        if (ret == 0 && rename(temp_name, cache->log_file_name) != 0) {
+            ret = PICOQUIC_ERROR_INVALID_FILE;
+        }
+
+        if (ret != 0) {
+            (void)picoquic_file_delete(temp_name, NULL);
+        }
+        else {
+            /* Other handles still point to the replaced file, and reopen the log on their next write */
+            (void)picoquic_file_close(cache->F_log);
+            cache->header->nb_log_records = nb_records;
+            cache->log_generation = PICOQUIC_ATOMIC_INC_64(&cache->header->log_generation);
+            if ((cache->F_log = picoquic_ticket_cache_open_append(cache->log_file_name)) == NULL) {
+                ret = PICOQUIC_ERROR_INVALID_FILE;
+            }
+        }
+    }
+
+    picoquic_unlock_mutex(&cache->log_mutex);
+
+    return ret;
+}
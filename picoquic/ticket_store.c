@@ -256,12 +256,8 @@ int picoquic_deserialize_ticket(picoquic_stored_ticket_t ** ticket, uint8_t * by
     return ret;
 }
 
-int picoquic_store_ticket(picoquic_stored_ticket_t** pp_first_ticket,
-    uint64_t current_time,
-    char const* sni, uint16_t sni_length, char const* alpn, uint16_t alpn_length,
-    uint32_t version, const uint8_t* ip_addr, uint8_t ip_addr_length,
-    const uint8_t* ip_addr_client, uint8_t ip_addr_client_length,
-    uint8_t* ticket, uint16_t ticket_length, picoquic_tp_t const * tp)
+static int picoquic_ticket_time_valid_until(uint64_t current_time, uint8_t* ticket, uint16_t ticket_length,
+    uint64_t* time_valid_until)
 {
     int ret = 0;
 
@@ -270,7 +266,6 @@ int picoquic_store_ticket(picoquic_stored_ticket_t** pp_first_ticket,
     } else {
         uint64_t ticket_issued_time;
         uint64_t ttl_seconds;
-        uint64_t time_valid_until;
 
         ticket_issued_time = PICOPARSE_64(ticket);
         ttl_seconds = PICOPARSE_32(ticket + 13);
@@ -279,43 +274,58 @@ int picoquic_store_ticket(picoquic_stored_ticket_t** pp_first_ticket,
             ttl_seconds = (7 * 24 * 3600);
         }
 
-        time_valid_until = (ticket_issued_time * 1000) + (ttl_seconds * 1000000);
+        *time_valid_until = (ticket_issued_time * 1000) + (ttl_seconds * 1000000);
 
-        if (current_time != 0 && time_valid_until < current_time) {
+        if (current_time != 0 && *time_valid_until < current_time) {
             ret = PICOQUIC_ERROR_INVALID_TICKET;
-        } else {
-            picoquic_stored_ticket_t* stored = picoquic_format_ticket(time_valid_until, sni, sni_length,
-                alpn, alpn_length, version, ip_addr, ip_addr_length,
-                ip_addr_client, ip_addr_client_length,
-                ticket, ticket_length, tp);
-            if (stored == NULL) {
-                ret = PICOQUIC_ERROR_MEMORY;
-            }
-            else {
-                picoquic_stored_ticket_t* next;
-                picoquic_stored_ticket_t** pprevious;
-
-                stored->next_ticket = next = *pp_first_ticket;
-                *pp_first_ticket = stored;
-                pprevious = &stored->next_ticket;
-
-                /* Now remove the old tickets for that SNI & ALPN & version */
-                while (next != NULL) {
-                    if (next->time_valid_until <= stored->time_valid_until &&
-                        next->sni_length == sni_length &&
-                        next->alpn_length == alpn_length &&
-                        memcmp(next->sni, sni, sni_length) == 0 &&
-                        memcmp(next->alpn, alpn, alpn_length) == 0 &&
-                        next->version == version) {
-                        picoquic_stored_ticket_t* deleted = next;
-                        next = next->next_ticket;
-                        *pprevious = next;
-                        memset(&deleted->ticket, 0, deleted->ticket_length);
-                        free(deleted);
-                    } else {
-                        pprevious = &next->next_ticket;
-                        next = next->next_ticket;
-                    }
+        }
+    }
+
+    return ret;
+}
+
+int picoquic_store_ticket(picoquic_stored_ticket_t** pp_first_ticket,
+    uint64_t current_time,
+    char const* sni, uint16_t sni_length, char const* alpn, uint16_t alpn_length,
+    uint32_t version, const uint8_t* ip_addr, uint8_t ip_addr_length,
+    const uint8_t* ip_addr_client, uint8_t ip_addr_client_length,
+    uint8_t* ticket, uint16_t ticket_length, picoquic_tp_t const * tp)
+{
+    uint64_t time_valid_until = 0;
+    int ret = picoquic_ticket_time_valid_until(current_time, ticket, ticket_length, &time_valid_until);
+
+    if (ret == 0) {
+        picoquic_stored_ticket_t* stored = picoquic_format_ticket(time_valid_until, sni, sni_length,
+            alpn, alpn_length, version, ip_addr, ip_addr_length,
+            ip_addr_client, ip_addr_client_length,
+            ticket, ticket_length, tp);
+        if (stored == NULL) {
+            ret = PICOQUIC_ERROR_MEMORY;
+        }
+        else {
+            picoquic_stored_ticket_t* next;
+            picoquic_stored_ticket_t** pprevious;
+
+            stored->next_ticket = next = *pp_first_ticket;
+            *pp_first_ticket = stored;
+            pprevious = &stored->next_ticket;
+
+            /* Now remove the old tickets for that SNI & ALPN & version */
+            while (next != NULL) {
+                if (next->time_valid_until <= stored->time_valid_until &&
+                    next->sni_length == sni_length &&
+                    next->alpn_length == alpn_length &&
+                    memcmp(next->sni, sni, sni_length) == 0 &&
+                    memcmp(next->alpn, alpn, alpn_length) == 0 &&
+                    next->version == version) {
+                    picoquic_stored_ticket_t* deleted = next;
+                    next = next->next_ticket;
+                    *pprevious = next;
+                    memset(&deleted->ticket, 0, deleted->ticket_length);
+                    free(deleted);
+                } else {
+                    pprevious = &next->next_ticket;
+                    next = next->next_ticket;
                 }
             }
         }
@@ -396,6 +406,124 @@ int picoquic_get_ticket(picoquic_stored_ticket_t* p_first_ticket,
     return ret;
 }
 
+/* Client tickets in the shared ticket cache are keyed by 'C', version, SNI and ALPN,
+ * so that storing a new ticket replaces the previous one, as in the ticket list.
+ * The value is the serialized ticket.
+ */
+static size_t picoquic_client_ticket_cache_key(uint8_t* key, char const* sni, uint16_t sni_length,
+    char const* alpn, uint16_t alpn_length, uint32_t version)
+{
+    size_t key_length = (size_t)1 + 4 + 2 + sni_length + alpn_length;
+
+    if (key_length > PICOQUIC_TICKET_CACHE_KEY_MAX) {
+        key_length = 0;
+    }
+    else {
+        key[0] = 'C';
+        picoformat_32(key + 1, version);
+        picoformat_16(key + 5, sni_length);
+        memcpy(key + 7, sni, sni_length);
+        memcpy(key + 7 + sni_length, alpn, alpn_length);
+    }
+
+    return key_length;
+}
+
+static int picoquic_put_client_ticket_in_cache(picoquic_ticket_cache_t* cache, const picoquic_stored_ticket_t* stored,
+    uint64_t current_time)
+{
+    uint8_t key[PICOQUIC_TICKET_CACHE_KEY_MAX];
+    uint8_t value[PICOQUIC_TICKET_CACHE_VALUE_MAX];
+    size_t value_length = 0;
+    size_t key_length = picoquic_client_ticket_cache_key(key, stored->sni, stored->sni_length,
+        stored->alpn, stored->alpn_length, stored->version);
+    int ret = (key_length == 0) ? PICOQUIC_ERROR_INVALID_TICKET :
+        picoquic_serialize_ticket(stored, value, sizeof(value), &value_length);
+
+    if (ret == 0) {
+        ret = picoquic_ticket_cache_put(cache, key, key_length, value, value_length,
+            stored->time_valid_until, current_time);
+    }
+
+    return ret;
+}
+
+int picoquic_cache_client_ticket(picoquic_ticket_cache_t* cache, uint64_t current_time,
+    char const* sni, uint16_t sni_length, char const* alpn, uint16_t alpn_length,
+    uint32_t version, uint8_t* ticket, uint16_t ticket_length, picoquic_tp_t const* tp)
+{
+    uint64_t time_valid_until = 0;
+    int ret = picoquic_ticket_time_valid_until(current_time, ticket, ticket_length, &time_valid_until);
+
+    if (ret == 0) {
+        picoquic_stored_ticket_t* stored = picoquic_format_ticket(time_valid_until, sni, sni_length,
+            alpn, alpn_length, version, NULL, 0, NULL, 0, ticket, ticket_length, tp);
+        if (stored == NULL) {
+            ret = PICOQUIC_ERROR_MEMORY;
+        }
+        else {
+            ret = picoquic_put_client_ticket_in_cache(cache, stored, current_time);
+            memset(stored->ticket, 0, stored->ticket_length);
+            free(stored);
+        }
+    }
+
+    return ret;
+}
+
+/* Returns a copy of the cached ticket, allocated with malloc, or NULL. */
+picoquic_stored_ticket_t* picoquic_get_cached_client_ticket(picoquic_ticket_cache_t* cache,
+    uint64_t current_time, char const* sni, uint16_t sni_length,
+    char const* alpn, uint16_t alpn_length, uint32_t version, uint64_t ticket_id)
+{
+    picoquic_stored_ticket_t* stored = NULL;
+    uint8_t key[PICOQUIC_TICKET_CACHE_KEY_MAX];
+    uint8_t value[PICOQUIC_TICKET_CACHE_VALUE_MAX];
+    size_t value_length = 0;
+    size_t consumed = 0;
+    size_t key_length = picoquic_client_ticket_cache_key(key, sni, sni_length, alpn, alpn_length, version);
+
+    if (key_length > 0 &&
+        picoquic_ticket_cache_get(cache, key, key_length, value, sizeof(value), &value_length, current_time) == 0 &&
+        picoquic_deserialize_ticket(&stored, value, value_length, &consumed) == 0) {
+        uint64_t stored_id = (stored->ticket_length < 8) ? 0 : PICOPARSE_64(stored->ticket);
+        if (ticket_id != 0 && stored_id != ticket_id) {
+            free(stored);
+            stored = NULL;
+        }
+    }
+
+    return stored;
+}
+
+/* Find the ticket matching the SNI, ALPN and version of a client connection, either in
+ * the ticket list or in the shared cache. Tickets copied from the cache are kept in the
+ * connection context, so the pointers remain valid for the duration of the connection.
+ */
+picoquic_stored_ticket_t* picoquic_get_cnx_stored_ticket(picoquic_cnx_t* cnx, uint64_t current_time)
+{
+    picoquic_stored_ticket_t* stored_ticket = NULL;
+    uint32_t version = picoquic_supported_versions[cnx->version_index].version;
+
+    if (cnx->quic->ticket_cache == NULL) {
+        stored_ticket = picoquic_get_stored_ticket(cnx->quic->p_first_ticket,
+            current_time, cnx->sni, (uint16_t)strlen(cnx->sni), cnx->alpn, (uint16_t)strlen(cnx->alpn),
+            version, 1, 0);
+    }
+    else if (cnx->cached_ticket != NULL) {
+        if (cnx->cached_ticket->time_valid_until > current_time) {
+            stored_ticket = cnx->cached_ticket;
+        }
+    }
+    else {
+        stored_ticket = picoquic_get_cached_client_ticket(cnx->quic->ticket_cache, current_time,
+            cnx->sni, (uint16_t)strlen(cnx->sni), cnx->alpn, (uint16_t)strlen(cnx->alpn), version, 0);
+        cnx->cached_ticket = stored_ticket;
+    }
+
+    return stored_ticket;
+}
+
 int picoquic_save_tickets(const picoquic_stored_ticket_t* first_ticket,
     uint64_t current_time,
     char const* ticket_file_name)
@@ -523,6 +651,19 @@ int picoquic_save_retry_tokens(picoquic_quic_t* quic, char const* ticket_store_f
     return picoquic_save_tokens(quic->p_first_token, picoquic_get_quic_time(quic), ticket_store_filename);
 }
 
+static void picoquic_update_ticket_bdp(picoquic_stored_ticket_t* stored, picoquic_path_t* path_x,
+    uint8_t* ip_addr, uint8_t ip_addr_length)
+{
+    stored->ip_addr_length = ip_addr_length;
+    memcpy(stored->ip_addr, ip_addr, ip_addr_length);
+    stored->tp_0rtt[picoquic_tp_0rtt_rtt_local] = path_x->rtt_min;
+    stored->tp_0rtt[picoquic_tp_0rtt_cwin_local] = path_x->cwin;
+    stored->tp_0rtt[picoquic_tp_0rtt_rtt_remote] = path_x->rtt_min_remote;
+    stored->tp_0rtt[picoquic_tp_0rtt_cwin_remote] = path_x->cwin_remote;
+    stored->ip_addr_client_length = path_x->ip_client_remote_length;
+    memcpy(stored->ip_addr_client, path_x->ip_client_remote, path_x->ip_client_remote_length);
+}
+
 void picoquic_update_stored_ticket(picoquic_cnx_t* cnx, picoquic_path_t * path_x, uint64_t current_time)
 {
     char const* sni = (cnx->sni == NULL) ? "" : cnx->sni;
@@ -536,34 +677,38 @@ void picoquic_update_stored_ticket(picoquic_cnx_t* cnx, picoquic_path_t * path_x
     picoquic_get_ip_addr((struct sockaddr *)&path_x->peer_addr, &ip_addr, &ip_addr_length);
 
     if (ip_addr != NULL && ip_addr_length <= PICOQUIC_STORED_IP_MAX) {
-        picoquic_stored_ticket_t* next = picoquic_get_stored_ticket(
-            cnx->quic->p_first_ticket, current_time, sni, (uint16_t)sni_length,
-            alpn, (uint16_t)alpn_length, version, 0, cnx->issued_ticket_id);
-        while (next != NULL) {
-            if (next->sni_length == sni_length &&
-                next->alpn_length == alpn_length &&
-                memcmp(next->sni, sni, sni_length) == 0 &&
-                memcmp(next->alpn, alpn, alpn_length) == 0 &&
-                next->version == version) {
-                uint64_t ticket_id = (next->ticket_length < 8) ? 0 : PICOPARSE_64(next->ticket);
-                if (cnx->issued_ticket_id == 0 || cnx->issued_ticket_id == ticket_id) {
-                    break;
+        if (cnx->quic->ticket_cache != NULL) {
+            picoquic_stored_ticket_t* cached = picoquic_get_cached_client_ticket(cnx->quic->ticket_cache,
+                current_time, sni, (uint16_t)sni_length, alpn, (uint16_t)alpn_length, version, cnx->issued_ticket_id);
+            if (cached != NULL) {
+                picoquic_update_ticket_bdp(cached, path_x, ip_addr, ip_addr_length);
+                (void)picoquic_put_client_ticket_in_cache(cnx->quic->ticket_cache, cached, current_time);
+                free(cached);
+            }
+        }
+        else {
+            picoquic_stored_ticket_t* next = picoquic_get_stored_ticket(
+                cnx->quic->p_first_ticket, current_time, sni, (uint16_t)sni_length,
+                alpn, (uint16_t)alpn_length, version, 0, cnx->issued_ticket_id);
+            while (next != NULL) {
+                if (next->sni_length == sni_length &&
+                    next->alpn_length == alpn_length &&
+                    memcmp(next->sni, sni, sni_length) == 0 &&
+                    memcmp(next->alpn, alpn, alpn_length) == 0 &&
+                    next->version == version) {
+                    uint64_t ticket_id = (next->ticket_length < 8) ? 0 : PICOPARSE_64(next->ticket);
+                    if (cnx->issued_ticket_id == 0 || cnx->issued_ticket_id == ticket_id) {
+                        break;
+                    }
+                }
+                else {
+                    next = next->next_ticket;
                 }
             }
-            else {
-                next = next->next_ticket;
+            if (next != NULL) {
+                picoquic_update_ticket_bdp(next, path_x, ip_addr, ip_addr_length);
             }
         }
-        if (next != NULL) {
-            next->ip_addr_length = ip_addr_length;
-            memcpy(next->ip_addr, ip_addr, ip_addr_length);
-            next->tp_0rtt[picoquic_tp_0rtt_rtt_local] = path_x->rtt_min;
-            next->tp_0rtt[picoquic_tp_0rtt_cwin_local] = path_x->cwin;
-            next->tp_0rtt[picoquic_tp_0rtt_rtt_remote] = path_x->rtt_min_remote;
-            next->tp_0rtt[picoquic_tp_0rtt_cwin_remote] = path_x->cwin_remote;
-            next->ip_addr_client_length = path_x->ip_client_remote_length;
-            memcpy(next->ip_addr_client, path_x->ip_client_remote, path_x->ip_client_remote_length);
-        }
     }
 }
 
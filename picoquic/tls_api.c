@@ -1226,9 +1226,15 @@ int picoquic_client_save_ticket_call_back(ptls_save_ticket_t* save_ticket_ctx,
 
     if (sni != NULL && alpn != NULL) {
         /* TODO: SHOULD STORE IP ADDRESSES? */
-        ret = picoquic_store_ticket(&quic->p_first_ticket, 0, sni, (uint16_t)strlen(sni),
-            alpn, (uint16_t)strlen(alpn), version, NULL, 0, NULL, 0,
-            input.base, (uint16_t)input.len, &cnx->remote_parameters);
+        if (quic->ticket_cache != NULL) {
+            ret = picoquic_cache_client_ticket(quic->ticket_cache, picoquic_get_quic_time(quic), sni, (uint16_t)strlen(sni),
+                alpn, (uint16_t)strlen(alpn), version, input.base, (uint16_t)input.len, &cnx->remote_parameters);
+        }
+        else {
+            ret = picoquic_store_ticket(&quic->p_first_ticket, 0, sni, (uint16_t)strlen(sni),
+                alpn, (uint16_t)strlen(alpn), version, NULL, 0, NULL, 0,
+                input.base, (uint16_t)input.len, &cnx->remote_parameters);
+        }
         /* Set first 8 bytes of ticket as identifier */
         if (input.len > 8) {
             cnx->issued_ticket_id = PICOPARSE_64(input.base);
@@ -1623,6 +1629,10 @@ int picoquic_compute_new_rotated_keys(picoquic_cnx_t * cnx)
 
 void picoquic_apply_rotated_keys(picoquic_cnx_t * cnx, int is_enc)
 {
+    /* Asynchronous jobs may still use the keys that are about to be released */
+    picoquic_crypto_async_wait_cnx(cnx);
+    picoquic_flush_async_protections(cnx);
+
     if (is_enc) {
         if (cnx->crypto_context[3].aead_encrypt != NULL) {
             ptls_aead_free((ptls_aead_context_t *)cnx->crypto_context[3].aead_encrypt);
@@ -2304,9 +2314,7 @@ int picoquic_initialize_tls_stream(picoquic_cnx_t* cnx, uint64_t current_time)
     /* No resumption if no alpn specified upfront, because it would make the negotiation and
      * the handling of 0-RTT way too messy */
     if (cnx->sni != NULL && cnx->alpn != NULL && !cnx->quic->client_zero_share) {
-        picoquic_stored_ticket_t* stored_ticket = picoquic_get_stored_ticket(cnx->quic->p_first_ticket, 
-            current_time, cnx->sni, (uint16_t)strlen(cnx->sni), cnx->alpn, (uint16_t)strlen(cnx->alpn),
-            picoquic_supported_versions[cnx->version_index].version, 1, 0);
+        picoquic_stored_ticket_t* stored_ticket = picoquic_get_cnx_stored_ticket(cnx, current_time);
         if (stored_ticket != NULL) {
             ctx->handshake_properties.client.session_ticket.base = stored_ticket->ticket;
             ctx->handshake_properties.client.session_ticket.len = stored_ticket->ticket_length;
@@ -2540,6 +2548,344 @@ size_t picoquic_aead_encrypt_mp(uint8_t* output, const uint8_t* input, size_t in
     return encrypted;
 }
 
+/* Software packet protection provider.
+ * This is the reference implementation of the provider API, executing the
+ * AEAD jobs inline with picotls. It is also used by providers that run the
+ * same code on another thread.
+ */
+size_t picoquic_software_crypto_process(void* provider_ctx, picoquic_aead_job_t* job)
+{
+#ifdef _WINDOWS
+    UNREFERENCED_PARAMETER(provider_ctx);
+#endif
+    if (job->is_encrypt) {
+        if (job->is_multipath) {
+            job->result = picoquic_aead_encrypt_mp(job->output, job->input, job->input_length, job->path_id,
+                job->seq_num, job->auth_data, job->auth_data_length, job->aead_context);
+        }
+        else {
+            job->result = picoquic_aead_encrypt_generic(job->output, job->input, job->input_length,
+                job->seq_num, job->auth_data, job->auth_data_length, job->aead_context);
+        }
+    }
+    else {
+        if (job->is_multipath) {
+            job->result = picoquic_aead_decrypt_mp(job->output, job->input, job->input_length, job->path_id,
+                job->seq_num, job->auth_data, job->auth_data_length, job->aead_context);
+        }
+        else {
+            job->result = picoquic_aead_decrypt_generic(job->output, job->input, job->input_length,
+                job->seq_num, job->auth_data, job->auth_data_length, job->aead_context);
+        }
+    }
+    job->is_complete = 1;
+
+    return job->result;
+}
+
+#define PICOQUIC_SOFTWARE_CRYPTO_PROVIDER_ID "software"
+
+picoquic_crypto_provider_t picoquic_software_crypto_provider_struct = {
+    PICOQUIC_SOFTWARE_CRYPTO_PROVIDER_ID,
+    NULL,
+    NULL,
+    picoquic_software_crypto_process,
+    NULL,
+    NULL
+};
+
+picoquic_crypto_provider_t* picoquic_software_crypto_provider = &picoquic_software_crypto_provider_struct;
+
+picoquic_crypto_provider_t const* picoquic_get_crypto_provider(char const* provider_name)
+{
+    picoquic_crypto_provider_t const* provider = NULL;
+    if (provider_name != NULL) {
+        if (strcmp(provider_name, picoquic_software_crypto_provider->provider_id) == 0) {
+            provider = picoquic_software_crypto_provider;
+        }
+        else if (strcmp(provider_name, picoquic_ring_crypto_provider->provider_id) == 0) {
+            provider = picoquic_ring_crypto_provider;
+        }
+    }
+    return provider;
+}
+
+void picoquic_delete_crypto_provider(picoquic_quic_t* quic)
+{
+    /* Jobs in flight refer to buffers owned by the stack */
+    while (quic->nb_crypto_jobs_in_flight > 0) {
+        (void)picoquic_crypto_async_collect(quic);
+    }
+    if (quic->crypto_async_records != NULL) {
+        free(quic->crypto_async_records);
+        quic->crypto_async_records = NULL;
+        quic->nb_crypto_async_records = 0;
+    }
+    if (quic->crypto_provider != NULL && quic->crypto_provider->provider_delete != NULL &&
+        quic->crypto_provider_ctx != NULL) {
+        quic->crypto_provider->provider_delete(quic->crypto_provider_ctx);
+    }
+    quic->crypto_provider = NULL;
+    quic->crypto_provider_ctx = NULL;
+}
+
+int picoquic_set_crypto_provider(picoquic_quic_t* quic, picoquic_crypto_provider_t const* provider, char const* param)
+{
+    int ret = 0;
+    void* provider_ctx = NULL;
+
+    if (provider != NULL && provider->provider_create != NULL) {
+        provider_ctx = provider->provider_create(quic, param);
+        if (provider_ctx == NULL) {
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        picoquic_delete_crypto_provider(quic);
+        quic->crypto_provider = provider;
+        quic->crypto_provider_ctx = provider_ctx;
+    }
+
+    return ret;
+}
+
+size_t picoquic_crypto_provider_submit_jobs(picoquic_quic_t* quic, picoquic_aead_job_t** jobs, size_t nb_jobs)
+{
+    size_t nb_accepted = 0;
+
+    if (quic->crypto_provider != NULL && quic->crypto_provider->provider_submit != NULL) {
+        for (size_t i = 0; i < nb_jobs; i++) {
+            jobs[i]->is_complete = 0;
+        }
+        nb_accepted = quic->crypto_provider->provider_submit(quic->crypto_provider_ctx, jobs, nb_jobs);
+    }
+    else {
+        for (nb_accepted = 0; nb_accepted < nb_jobs; nb_accepted++) {
+            if (quic->crypto_provider != NULL) {
+                (void)quic->crypto_provider->provider_process(quic->crypto_provider_ctx, jobs[nb_accepted]);
+            }
+            else {
+                (void)picoquic_software_crypto_process(NULL, jobs[nb_accepted]);
+            }
+        }
+    }
+
+    return nb_accepted;
+}
+
+size_t picoquic_crypto_provider_poll_jobs(picoquic_quic_t* quic, picoquic_aead_job_t** jobs, size_t max_jobs)
+{
+    size_t nb_polled = 0;
+
+    if (quic->crypto_provider != NULL && quic->crypto_provider->provider_poll != NULL) {
+        nb_polled = quic->crypto_provider->provider_poll(quic->crypto_provider_ctx, jobs, max_jobs);
+    }
+
+    return nb_polled;
+}
+
+/* Asynchronous protection of 1-RTT packets is used if the provider
+ * supports the submit and poll functions.
+ */
+int picoquic_crypto_async_is_enabled(picoquic_quic_t* quic)
+{
+    return (quic->crypto_provider != NULL && quic->crypto_provider->provider_submit != NULL &&
+        quic->crypto_provider->provider_poll != NULL);
+}
+
+/* Submit the jobs of a connection in an async batch. Jobs that the provider
+ * cannot accept are processed in line, and returned as completed. The AEAD
+ * contexts are not thread safe, so the accepted jobs of the connection
+ * must be completed before the others are processed in line. The function
+ * returns the number of jobs submitted to the provider.
+ */
+size_t picoquic_crypto_async_submit(picoquic_cnx_t* cnx, picoquic_aead_job_t** jobs, size_t nb_jobs)
+{
+    picoquic_quic_t* quic = cnx->quic;
+    size_t nb_submitted = picoquic_crypto_provider_submit_jobs(quic, jobs, nb_jobs);
+
+    cnx->nb_crypto_jobs_in_flight += nb_submitted;
+    quic->nb_crypto_jobs_in_flight += nb_submitted;
+
+    if (nb_submitted < nb_jobs) {
+        picoquic_crypto_async_wait_cnx(cnx);
+        for (size_t i = nb_submitted; i < nb_jobs; i++) {
+            (void)quic->crypto_provider->provider_process(quic->crypto_provider_ctx, jobs[i]);
+        }
+    }
+
+    return nb_submitted;
+}
+
+/* Collect the completed jobs. Encryption jobs complete the protection of their
+ * datagram. Decryption jobs are marked done, and the corresponding packets are
+ * processed later by "picoquic_process_pending_decryptions", so collection
+ * can happen at any point in the packet processing code.
+ * The accounting uses the context that submitted the job, as a provider
+ * context could be shared between several QUIC contexts.
+ */
+void picoquic_crypto_async_complete(picoquic_aead_job_t* job)
+{
+    picoquic_cnx_t* cnx;
+
+    if (job->is_encrypt) {
+        picoquic_async_protection_t* protection = (picoquic_async_protection_t*)job;
+        cnx = protection->datagram->cnx;
+        picoquic_protected_datagram_job_complete(protection);
+    }
+    else {
+        picoquic_pending_decryption_t* pending = (picoquic_pending_decryption_t*)job;
+        cnx = pending->cnx;
+        pending->is_done = 1;
+    }
+    cnx->nb_crypto_jobs_in_flight--;
+    cnx->quic->nb_crypto_jobs_in_flight--;
+}
+
+size_t picoquic_crypto_async_collect(picoquic_quic_t* quic)
+{
+    picoquic_aead_job_t* jobs[PICOQUIC_CRYPTO_ASYNC_MAX_JOBS];
+    size_t nb_collected = 0;
+    size_t nb_jobs;
+
+    while (quic->nb_crypto_jobs_in_flight > 0 &&
+        (nb_jobs = picoquic_crypto_provider_poll_jobs(quic, jobs, PICOQUIC_CRYPTO_ASYNC_MAX_JOBS)) > 0) {
+        for (size_t i = 0; i < nb_jobs; i++) {
+            picoquic_crypto_async_complete(jobs[i]);
+        }
+        nb_collected += nb_jobs;
+    }
+
+    return nb_collected;
+}
+
+/* Wait until the provider has returned all the jobs of the connection.
+ * This is required before releasing AEAD contexts that these jobs may use.
+ */
+void picoquic_crypto_async_wait_cnx(picoquic_cnx_t* cnx)
+{
+    while (cnx->nb_crypto_jobs_in_flight > 0) {
+        (void)picoquic_crypto_async_collect(cnx->quic);
+    }
+}
+
+void picoquic_crypto_provider_wait(picoquic_quic_t* quic, uint64_t current_time)
+{
+    while (quic->nb_crypto_jobs_in_flight > 0) {
+        (void)picoquic_crypto_async_collect(quic);
+    }
+    picoquic_process_pending_decryptions(quic, current_time);
+}
+
+/* Release the asynchronous protection state of a connection that is being deleted */
+void picoquic_crypto_async_delete_cnx(picoquic_cnx_t* cnx)
+{
+    picoquic_quic_t* quic = cnx->quic;
+    picoquic_pending_decryption_t* pending = quic->first_pending_decryption;
+    picoquic_pending_decryption_t* previous = NULL;
+
+    picoquic_crypto_async_wait_cnx(cnx);
+
+    while (cnx->first_protected_datagram != NULL) {
+        picoquic_protected_datagram_t* datagram = cnx->first_protected_datagram;
+        cnx->first_protected_datagram = datagram->next_datagram;
+        free(datagram);
+    }
+    cnx->last_protected_datagram = NULL;
+    cnx->nb_protected_datagrams = 0;
+
+    while (pending != NULL) {
+        picoquic_pending_decryption_t* next = pending->next_pending;
+        if (pending->cnx == cnx) {
+            if (previous == NULL) {
+                quic->first_pending_decryption = next;
+            }
+            else {
+                previous->next_pending = next;
+            }
+            if (quic->last_pending_decryption == pending) {
+                quic->last_pending_decryption = previous;
+            }
+            picoquic_stream_data_node_recycle(pending->decrypted_data);
+            free(pending);
+        }
+        else {
+            previous = pending;
+        }
+        pending = next;
+    }
+}
+
+/* Packet protection entry points used by the sender and the receiver.
+ * If no provider is set, call picotls directly and avoid the job setup.
+ */
+static size_t picoquic_aead_packet_job(picoquic_quic_t* quic, int is_encrypt, uint8_t* output, const uint8_t* input,
+    size_t input_length, int is_multipath, uint64_t path_id, uint64_t seq_num,
+    const uint8_t* auth_data, size_t auth_data_length, void* aead_context)
+{
+    picoquic_aead_job_t job;
+
+    memset(&job, 0, sizeof(job));
+    job.output = output;
+    job.input = input;
+    job.input_length = input_length;
+    job.auth_data = auth_data;
+    job.auth_data_length = auth_data_length;
+    job.seq_num = seq_num;
+    job.path_id = path_id;
+    job.aead_context = aead_context;
+    job.is_encrypt = (is_encrypt) ? 1 : 0;
+    job.is_multipath = (is_multipath) ? 1 : 0;
+
+    return quic->crypto_provider->provider_process(quic->crypto_provider_ctx, &job);
+}
+
+size_t picoquic_aead_encrypt_packet(picoquic_quic_t* quic, uint8_t* output, const uint8_t* input, size_t input_length,
+    int is_multipath, uint64_t path_id, uint64_t seq_num, const uint8_t* auth_data, size_t auth_data_length, void* aead_context)
+{
+    size_t encrypted;
+
+    if (quic->crypto_provider != NULL) {
+        encrypted = picoquic_aead_packet_job(quic, 1, output, input, input_length, is_multipath, path_id,
+            seq_num, auth_data, auth_data_length, aead_context);
+    }
+    else if (is_multipath) {
+        encrypted = picoquic_aead_encrypt_mp(output, input, input_length, path_id,
+            seq_num, auth_data, auth_data_length, aead_context);
+    }
+    else {
+        encrypted = picoquic_aead_encrypt_generic(output, input, input_length,
+            seq_num, auth_data, auth_data_length, aead_context);
+    }
+
+    return encrypted;
+}
+
+size_t picoquic_aead_decrypt_packet(picoquic_quic_t* quic, uint8_t* output, const uint8_t* input, size_t input_length,
+    int is_multipath, uint64_t path_id, uint64_t seq_num, const uint8_t* auth_data, size_t auth_data_length, void* aead_context)
+{
+    size_t decrypted;
+
+    if (aead_context == NULL) {
+        decrypted = SIZE_MAX;
+    }
+    else if (quic->crypto_provider != NULL) {
+        decrypted = picoquic_aead_packet_job(quic, 0, output, input, input_length, is_multipath, path_id,
+            seq_num, auth_data, auth_data_length, aead_context);
+    }
+    else if (is_multipath) {
+        decrypted = picoquic_aead_decrypt_mp(output, input, input_length, path_id,
+            seq_num, auth_data, auth_data_length, aead_context);
+    }
+    else {
+        decrypted = picoquic_aead_decrypt_generic(output, input, input_length,
+            seq_num, auth_data, auth_data_length, aead_context);
+    }
+
+    return decrypted;
+}
+
 /* management of version specific salt, for initial packet encryption.
  */
 
@@ -2597,12 +2943,36 @@ int picoquic_compare_cleartext_aead_contexts(picoquic_cnx_t* cnx1, picoquic_cnx_
  * should be sent at each epoch.
  */
 
+/* State transition of the server after processing handshake messages, either
+ * in picoquic_tls_stream_process or after resuming an asynchronous signature.
+ */
+static void picoquic_server_handshake_transition(picoquic_cnx_t* cnx, int data_pushed, uint64_t current_time)
+{
+    /* If client authentication is activated, the client sends the certificates with its `Finished` packet.
+       The server does not send any further packets, so, we can switch into false start state here.
+    */
+    if (data_pushed == 0 && ((ptls_context_t*)cnx->quic->tls_master_ctx)->require_client_authentication == 1) {
+        picoquic_false_start_transition(cnx, current_time);
+    }
+    else {
+        if (cnx->crypto_context[3].aead_encrypt != NULL) {
+            cnx->cnx_state = picoquic_state_server_almost_ready;
+        }
+    }
+}
+
 int picoquic_tls_stream_process(picoquic_cnx_t* cnx, int * data_consumed, uint64_t current_time)
 {
     int ret = 0;
     picoquic_tls_ctx_t* ctx = (picoquic_tls_ctx_t*)cnx->tls_ctx;
     size_t next_epoch = 0;
 
+    if (cnx->is_signature_pending) {
+        /* The handshake is suspended until the asynchronous signature completes.
+         * Incoming data stays queued, and is processed when the handshake resumes. */
+        return 0;
+    }
+
     /* Provide indication of current connection for later callbacks */
     cnx->quic->cnx_in_progress = cnx;
 
@@ -2631,7 +3001,7 @@ int picoquic_tls_stream_process(picoquic_cnx_t* cnx, int * data_consumed, uint64
             }
         }
 
-        while ((ret == 0 || ret == PTLS_ERROR_IN_PROGRESS) &&
+        while ((ret == 0 || ret == PTLS_ERROR_IN_PROGRESS) && !cnx->is_signature_pending &&
             data != NULL && data->offset <= stream->consumed_offset) {
             struct st_ptls_buffer_t sendbuf;
             size_t start = (size_t)(stream->consumed_offset - data->offset);
@@ -2651,6 +3021,14 @@ int picoquic_tls_stream_process(picoquic_cnx_t* cnx, int * data_consumed, uint64
             ret = ptls_handle_message(ctx->tls, &sendbuf, send_offset, epoch,
                 data->bytes + start, epoch_data, &ctx->handshake_properties);
 
+            if (ret == PTLS_ERROR_ASYNC_OPERATION) {
+                /* The certificate signature is computed in the background. The
+                 * messages produced so far are sent now, the handshake will be
+                 * resumed by picoquic_tls_resume_handshake. */
+                cnx->is_signature_pending = 1;
+                ret = 0;
+            }
+
             if ((ret == 0 || ret == PTLS_ERROR_IN_PROGRESS ||
                 ret == PTLS_ERROR_STATELESS_RETRY)) {
                 for (int i = 0; i < PICOQUIC_NUMBER_OF_EPOCHS; i++) {
@@ -2733,17 +3111,7 @@ int picoquic_tls_stream_process(picoquic_cnx_t* cnx, int * data_consumed, uint64
                     break;
                 case picoquic_state_server_init:
                 case picoquic_state_server_handshake:
-                    /* If client authentication is activated, the client sends the certificates with its `Finished` packet.
-                       The server does not send any further packets, so, we can switch into false start state here.
-                    */
-                    if (data_pushed == 0 && ((ptls_context_t*)cnx->quic->tls_master_ctx)->require_client_authentication == 1) {
-                        picoquic_false_start_transition(cnx, current_time);
-                    }
-                    else {
-                        if (cnx->crypto_context[3].aead_encrypt != NULL) {
-                            cnx->cnx_state = picoquic_state_server_almost_ready;
-                        }
-                    }
+                    picoquic_server_handshake_transition(cnx, data_pushed, current_time);
                     break;
                 case picoquic_state_client_almost_ready:
                 case picoquic_state_handshake_failure:
@@ -2803,6 +3171,70 @@ int picoquic_tls_stream_process(picoquic_cnx_t* cnx, int * data_consumed, uint64
     return ret;
 }
 
+/*
+ * Resume a server handshake after completion of the asynchronous signature.
+ * Picotls collects the signature from the async job and produces the
+ * CertificateVerify and Finished messages, which are queued for sending.
+ * Data received while the handshake was suspended is then processed.
+ */
+int picoquic_tls_resume_handshake(picoquic_cnx_t* cnx, uint64_t current_time)
+{
+    int ret;
+    int data_pushed = 0;
+    picoquic_tls_ctx_t* ctx = (picoquic_tls_ctx_t*)cnx->tls_ctx;
+    struct st_ptls_buffer_t sendbuf;
+    size_t send_offset[PICOQUIC_NUMBER_OF_EPOCH_OFFSETS] = { 0, 0, 0, 0, 0 };
+
+    cnx->quic->cnx_in_progress = cnx;
+    ptls_buffer_init(&sendbuf, "", 0);
+    picoquic_clear_crypto_errors();
+
+    ret = ptls_handle_message(ctx->tls, &sendbuf, send_offset, ptls_get_read_epoch(ctx->tls),
+        NULL, 0, &ctx->handshake_properties);
+
+    if (ret == PTLS_ERROR_ASYNC_OPERATION) {
+        cnx->is_signature_pending = 1;
+        ret = 0;
+    }
+
+    if (ret == 0 || ret == PTLS_ERROR_IN_PROGRESS) {
+        ret = 0;
+        for (int i = 0; i < PICOQUIC_NUMBER_OF_EPOCHS && ret == 0; i++) {
+            if (send_offset[i] < send_offset[i + 1]) {
+                data_pushed = 1;
+                ret = picoquic_add_to_tls_stream(cnx,
+                    sendbuf.base + send_offset[i], send_offset[i + 1] - send_offset[i], i);
+            }
+        }
+        if (ret == 0 && !cnx->is_signature_pending && (cnx->cnx_state == picoquic_state_server_init ||
+            cnx->cnx_state == picoquic_state_server_handshake)) {
+            picoquic_server_handshake_transition(cnx, data_pushed, current_time);
+        }
+    }
+    else {
+        uint16_t error_code = PICOQUIC_TRANSPORT_INTERNAL_ERROR;
+
+        picoquic_log_crypto_errors(cnx, ret);
+        if (PTLS_ERROR_GET_CLASS(ret) == PTLS_ERROR_CLASS_SELF_ALERT) {
+            error_code = PICOQUIC_TRANSPORT_CRYPTO_ERROR(ret);
+        }
+        DBG_PRINTF("Handshake resumption failed, ret = 0x%x.\n", ret);
+        (void)picoquic_connection_error(cnx, error_code, 0);
+        ret = 0;
+    }
+
+    ptls_buffer_dispose(&sendbuf);
+    cnx->quic->cnx_in_progress = NULL;
+
+    if (ret == 0 && !cnx->is_signature_pending) {
+        ret = picoquic_tls_stream_process(cnx, NULL, current_time);
+    }
+
+    picoquic_reinsert_by_wake_time(cnx->quic, cnx, current_time);
+
+    return ret;
+}
+
 /*
  * Test whether the TLS handshake is complete according to TLS stack
  */
@@ -3327,20 +3759,20 @@ void * picoquic_create_retry_protection_context(int is_enc, uint8_t * key, const
     return (void *)picoquic_setup_test_aead_context(is_enc, key, prefix_label);
 }
 
-void * picoquic_find_retry_protection_context(picoquic_cnx_t * cnx, int sending)
+void * picoquic_find_retry_protection_context_by_version(picoquic_quic_t * quic, int version_index, int sending)
 {
     void * aead_ctx = NULL;
-    void ** aead_vector = (sending) ? cnx->quic->retry_integrity_sign_ctx : cnx->quic->retry_integrity_verify_ctx;
+    void ** aead_vector = (sending) ? quic->retry_integrity_sign_ctx : quic->retry_integrity_verify_ctx;
 
-    if (picoquic_supported_versions[cnx->version_index].version_retry_key != NULL) {
+    if (picoquic_supported_versions[version_index].version_retry_key != NULL) {
         if (aead_vector == NULL) {
             if (sending) {
-                cnx->quic->retry_integrity_sign_ctx = (void**)malloc(sizeof(void*)*picoquic_nb_supported_versions);
-                aead_vector = cnx->quic->retry_integrity_sign_ctx;
+                quic->retry_integrity_sign_ctx = (void**)malloc(sizeof(void*)*picoquic_nb_supported_versions);
+                aead_vector = quic->retry_integrity_sign_ctx;
             }
             else {
-                cnx->quic->retry_integrity_verify_ctx = (void**)malloc(sizeof(void*)*picoquic_nb_supported_versions);
-                aead_vector = cnx->quic->retry_integrity_verify_ctx;
+                quic->retry_integrity_verify_ctx = (void**)malloc(sizeof(void*)*picoquic_nb_supported_versions);
+                aead_vector = quic->retry_integrity_verify_ctx;
             }
             if (aead_vector != NULL) {
                 memset(aead_vector, 0, sizeof(void*)*picoquic_nb_supported_versions);
@@ -3348,11 +3780,11 @@ void * picoquic_find_retry_protection_context(picoquic_cnx_t * cnx, int sending)
         }
 
         if (aead_vector != NULL) {
-            aead_ctx = aead_vector[cnx->version_index];
+            aead_ctx = aead_vector[version_index];
             if (aead_ctx == NULL) {
-                aead_ctx = picoquic_create_retry_protection_context(sending, picoquic_supported_versions[cnx->version_index].version_retry_key,
-                                                                    picoquic_supported_versions[cnx->version_index].tls_prefix_label);
-                aead_vector[cnx->version_index] = aead_ctx;
+                aead_ctx = picoquic_create_retry_protection_context(sending, picoquic_supported_versions[version_index].version_retry_key,
+                                                                    picoquic_supported_versions[version_index].tls_prefix_label);
+                aead_vector[version_index] = aead_ctx;
             }
         }
     }
@@ -3360,6 +3792,11 @@ void * picoquic_find_retry_protection_context(picoquic_cnx_t * cnx, int sending)
     return aead_ctx;
 }
 
+void * picoquic_find_retry_protection_context(picoquic_cnx_t * cnx, int sending)
+{
+    return picoquic_find_retry_protection_context_by_version(cnx->quic, cnx->version_index, sending);
+}
+
 static void ** picoquic_delete_one_retry_protection_context(void ** ctx)
 {
     if (ctx != NULL) {
@@ -85,6 +85,28 @@ size_t picoquic_aead_decrypt_mp(uint8_t* output, const uint8_t* input, size_t in
 size_t picoquic_aead_encrypt_mp(uint8_t* output, const uint8_t* input, size_t input_length, uint64_t path_id,
     uint64_t seq_num, const uint8_t* auth_data, size_t auth_data_length, void* aead_context);
 
+/* Packet protection through the provider selected for the QUIC context */
+size_t picoquic_aead_encrypt_packet(picoquic_quic_t* quic, uint8_t* output, const uint8_t* input, size_t input_length,
+    int is_multipath, uint64_t path_id, uint64_t seq_num, const uint8_t* auth_data, size_t auth_data_length, void* aead_context);
+size_t picoquic_aead_decrypt_packet(picoquic_quic_t* quic, uint8_t* output, const uint8_t* input, size_t input_length,
+    int is_multipath, uint64_t path_id, uint64_t seq_num, const uint8_t* auth_data, size_t auth_data_length, void* aead_context);
+size_t picoquic_software_crypto_process(void* provider_ctx, picoquic_aead_job_t* job);
+void picoquic_delete_crypto_provider(picoquic_quic_t* quic);
+
+/* Asynchronous packet protection */
+int picoquic_crypto_async_is_enabled(picoquic_quic_t* quic);
+size_t picoquic_crypto_async_submit(picoquic_cnx_t* cnx, picoquic_aead_job_t** jobs, size_t nb_jobs);
+void picoquic_crypto_async_complete(picoquic_aead_job_t* job);
+size_t picoquic_crypto_async_collect(picoquic_quic_t* quic);
+void picoquic_crypto_async_wait_cnx(picoquic_cnx_t* cnx);
+void picoquic_crypto_async_delete_cnx(picoquic_cnx_t* cnx);
+
+/* Asynchronous certificate signing */
+void picoquic_delete_sign_offload(picoquic_quic_t* quic);
+int picoquic_has_pending_signatures(picoquic_quic_t* quic);
+size_t picoquic_get_completed_signatures(picoquic_quic_t* quic);
+int picoquic_tls_resume_handshake(picoquic_cnx_t* cnx, uint64_t current_time);
+
 uint64_t picoquic_aead_integrity_limit(void* aead_ctx);
 uint64_t picoquic_aead_confidentiality_limit(void* aead_ctx);
 
@@ -191,6 +213,7 @@ ptls_iovec_t* picoquic_get_certs_from_file(char const* file_name, size_t * count
 /* Special AEAD context definition functions used for stateless retry integrity protection */
 void * picoquic_create_retry_protection_context(int is_enc, uint8_t * key, const char *prefix_label);
 void * picoquic_find_retry_protection_context(picoquic_cnx_t * cnx, int sending);
+void * picoquic_find_retry_protection_context_by_version(picoquic_quic_t * quic, int version_index, int sending);
 void picoquic_delete_retry_protection_contexts(picoquic_quic_t * quic);
 size_t picoquic_encode_retry_protection(void * integrity_aead, uint8_t * bytes, size_t bytes_max, size_t byte_index, const picoquic_connection_id_t * odcid);
 int picoquic_verify_retry_protection(void * integrity_aead, uint8_t * bytes, size_t * length, size_t byte_index, const picoquic_connection_id_t * odcid);
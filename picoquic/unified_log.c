@@ -46,7 +46,7 @@ void picoquic_log_app_message_v(picoquic_cnx_t* cnx, const char* fmt, va_list va
         cnx->quic->text_log_fns->log_app_message(cnx, fmt, vargs);
     }
 
-    if (cnx->f_binlog != NULL) {
+    if (PICOQUIC_CNX_HAS_BINLOG(cnx)) {
         cnx->quic->bin_log_fns->log_app_message(cnx, fmt, vargs);
     }
 }
@@ -60,7 +60,7 @@ void picoquic_log_app_message(picoquic_cnx_t* cnx, const char* fmt, ...)
         va_end(args);
     }
 
-    if (cnx->f_binlog != NULL) {
+    if (PICOQUIC_CNX_HAS_BINLOG(cnx)) {
         va_list args;
         va_start(args, fmt);
         cnx->quic->bin_log_fns->log_app_message(cnx, fmt, args);
@@ -87,7 +87,7 @@ void picoquic_log_pdu(picoquic_cnx_t* cnx, int receiving, uint64_t current_time,
             cnx->quic->text_log_fns->log_pdu(cnx, receiving, current_time, addr_peer, addr_local, packet_length);
         }
 
-        if (cnx->f_binlog != NULL) {
+        if (PICOQUIC_CNX_HAS_BINLOG(cnx)) {
             cnx->quic->bin_log_fns->log_pdu(cnx, receiving, current_time, addr_peer, addr_local, packet_length);
         }
     }
@@ -102,7 +102,7 @@ void picoquic_log_packet(picoquic_cnx_t* cnx, picoquic_path_t* path_x, int recei
             cnx->quic->text_log_fns->log_packet(cnx, path_x, receiving, current_time, ph, bytes, bytes_max);
         }
 
-        if (cnx->f_binlog != NULL) {
+        if (PICOQUIC_CNX_HAS_BINLOG(cnx)) {
             cnx->quic->bin_log_fns->log_packet(cnx, path_x, receiving, current_time, ph, bytes, bytes_max);
         }
     }
@@ -117,7 +117,7 @@ void picoquic_log_dropped_packet(picoquic_cnx_t* cnx, picoquic_path_t* path_x, s
             cnx->quic->text_log_fns->log_dropped_packet(cnx, path_x, ph, packet_size, err, raw_data, current_time);
         }
 
-        if (cnx->f_binlog != NULL) {
+        if (PICOQUIC_CNX_HAS_BINLOG(cnx)) {
             cnx->quic->bin_log_fns->log_dropped_packet(cnx, path_x, ph, packet_size, err, raw_data, current_time);
         }
     }
@@ -131,7 +131,7 @@ void picoquic_log_buffered_packet(picoquic_cnx_t* cnx, picoquic_path_t* path_x,
             cnx->quic->text_log_fns->log_buffered_packet(cnx, path_x, ptype, current_time);
         }
 
-        if (cnx->f_binlog != NULL) {
+        if (PICOQUIC_CNX_HAS_BINLOG(cnx)) {
             cnx->quic->bin_log_fns->log_buffered_packet(cnx, path_x, ptype, current_time);
         }
     }
@@ -148,7 +148,7 @@ void picoquic_log_outgoing_packet(picoquic_cnx_t* cnx, picoquic_path_t* path_x,
                 send_buffer, send_length, current_time);
         }
 
-        if (cnx->f_binlog != NULL) {
+        if (PICOQUIC_CNX_HAS_BINLOG(cnx)) {
             cnx->quic->bin_log_fns->log_outgoing_packet(cnx, path_x, bytes, sequence_number, pn_length, length,
                 send_buffer, send_length, current_time);
         }
@@ -166,7 +166,7 @@ void picoquic_log_packet_lost(picoquic_cnx_t* cnx, picoquic_path_t* path_x,
             cnx->quic->text_log_fns->log_packet_lost(cnx, path_x, ptype, sequence_number, trigger, dcid, packet_size, current_time);
         }
 
-        if (cnx->f_binlog != NULL) {
+        if (PICOQUIC_CNX_HAS_BINLOG(cnx)) {
             cnx->quic->bin_log_fns->log_packet_lost(cnx, path_x, ptype, sequence_number, trigger, dcid, packet_size, current_time);
         }
     }
@@ -181,7 +181,7 @@ void picoquic_log_negotiated_alpn(picoquic_cnx_t* cnx, int is_local,
         cnx->quic->text_log_fns->log_negotiated_alpn(cnx, is_local, sni, sni_len, alpn, alpn_len, alpn_list, alpn_count);
     }
 
-    if (cnx->f_binlog != NULL) {
+    if (PICOQUIC_CNX_HAS_BINLOG(cnx)) {
         cnx->quic->bin_log_fns->log_negotiated_alpn(cnx, is_local, sni, sni_len, alpn, alpn_len, alpn_list, alpn_count);
     }
 }
@@ -194,7 +194,7 @@ void picoquic_log_transport_extension(picoquic_cnx_t* cnx, int is_local,
         cnx->quic->text_log_fns->log_transport_extension(cnx, is_local, param_length, params);
     }
 
-    if (cnx->f_binlog != NULL) {
+    if (PICOQUIC_CNX_HAS_BINLOG(cnx)) {
         cnx->quic->bin_log_fns->log_transport_extension(cnx, is_local, param_length, params);
     }
 }
@@ -206,7 +206,7 @@ void picoquic_log_tls_ticket(picoquic_cnx_t* cnx, uint8_t* ticket, uint16_t tick
         cnx->quic->text_log_fns->log_picotls_ticket(cnx, ticket, ticket_length);
     }
 
-    if (cnx->f_binlog != NULL) {
+    if (PICOQUIC_CNX_HAS_BINLOG(cnx)) {
         cnx->quic->bin_log_fns->log_picotls_ticket(cnx, ticket, ticket_length);
     }
 }
@@ -229,20 +229,129 @@ void picoquic_log_close_connection(picoquic_cnx_t* cnx)
         cnx->quic->text_log_fns->log_close_connection(cnx);
     }
 
-    if (cnx->f_binlog != NULL) {
+    if (PICOQUIC_CNX_HAS_BINLOG(cnx)) {
         cnx->quic->bin_log_fns->log_close_connection(cnx);
     }
 }
 
-/* log congestion control parameters */
+/* Check the low throughput trigger. The throughput is measured over
+ * successive one second windows, and the trigger only fires if the
+ * connection was limited by the congestion window during the window,
+ * i.e., if the application had more data to send.
+ */
+static void picoquic_log_check_throughput(picoquic_cnx_t* cnx, uint64_t current_time)
+{
+    uint64_t total_bytes = cnx->data_sent + cnx->data_received;
+
+    cnx->log_throughput_was_blocked |= cnx->cwin_blocked;
+    if (cnx->log_throughput_window_start == 0) {
+        cnx->log_throughput_window_start = current_time;
+        cnx->log_throughput_bytes = total_bytes;
+        cnx->log_throughput_was_blocked = 0;
+    }
+    else if (current_time >= cnx->log_throughput_window_start + PICOQUIC_LOG_THROUGHPUT_WINDOW) {
+        uint64_t delta_t = current_time - cnx->log_throughput_window_start;
+        uint64_t throughput = ((total_bytes - cnx->log_throughput_bytes) * 1000000) / delta_t;
+
+        if (cnx->log_throughput_was_blocked && cnx->cnx_state == picoquic_state_ready &&
+            throughput < cnx->quic->log_trigger_min_throughput) {
+            picoquic_log_trigger(cnx, picoquic_log_trigger_low_throughput, current_time);
+        }
+        cnx->log_throughput_window_start = current_time;
+        cnx->log_throughput_bytes = total_bytes;
+        cnx->log_throughput_was_blocked = 0;
+    }
+}
+
+/* log congestion control parameters. The throughput check runs even if
+ * the connection is no longer logging. */
 void picoquic_log_cc_dump(picoquic_cnx_t* cnx, uint64_t current_time)
 {
+    if ((cnx->quic->log_trigger_mask & picoquic_log_trigger_low_throughput) != 0) {
+        picoquic_log_check_throughput(cnx, current_time);
+    }
+
     if (picoquic_cnx_is_still_logging(cnx)) {
         if (cnx->quic->F_log != NULL) {
             cnx->quic->text_log_fns->log_cc_dump(cnx, current_time);
         }
-        if (cnx->f_binlog != NULL) {
+        if (PICOQUIC_CNX_HAS_BINLOG(cnx)) {
             cnx->quic->bin_log_fns->log_cc_dump(cnx, current_time);
         }
     }
-}
\ No newline at end of file
+}
+
+/* Sampling policy. The connection ID hash is multiplied by a large odd
+ * constant before the modulo, so that the selection does not depend on
+ * the low order bits of the hash alone.
+ */
+int picoquic_log_is_sampled(picoquic_cnx_t* cnx)
+{
+    int is_sampled = 1;
+    uint32_t one_in_n = cnx->quic->log_sample_one_in;
+
+    if (one_in_n == 0) {
+        is_sampled = 0;
+    }
+    else if (one_in_n > 1) {
+        uint64_t h = picoquic_connection_id_hash(&cnx->initial_cnxid) * 0x9E3779B97F4A7C15ull;
+        is_sampled = ((h >> 32) % one_in_n) == 0;
+    }
+
+    return is_sampled;
+}
+
+static char const* picoquic_log_trigger_name(picoquic_log_trigger_enum trigger)
+{
+    char const* trigger_name = "unknown";
+
+    switch (trigger) {
+    case picoquic_log_trigger_spurious_burst:
+        trigger_name = "spurious_burst";
+        break;
+    case picoquic_log_trigger_rto:
+        trigger_name = "rto";
+        break;
+    case picoquic_log_trigger_idle_timeout:
+        trigger_name = "idle_timeout";
+        break;
+    case picoquic_log_trigger_handshake_failure:
+        trigger_name = "handshake_failure";
+        break;
+    case picoquic_log_trigger_low_throughput:
+        trigger_name = "low_throughput";
+        break;
+    default:
+        break;
+    }
+    return trigger_name;
+}
+
+/* Signal an anomaly. Isolated spurious retransmissions are common, so the
+ * corresponding trigger only fires if several happen within one RTT.
+ */
+void picoquic_log_trigger(picoquic_cnx_t* cnx, picoquic_log_trigger_enum trigger, uint64_t current_time)
+{
+    if ((cnx->quic->log_trigger_mask & (uint32_t)trigger) == 0) {
+        return;
+    }
+
+    if (trigger == picoquic_log_trigger_spurious_burst) {
+        if (current_time > cnx->log_spurious_window_start + cnx->path[0]->smoothed_rtt) {
+            cnx->log_spurious_window_start = current_time;
+            cnx->log_spurious_count = 0;
+        }
+        cnx->log_spurious_count++;
+        if (cnx->log_spurious_count != PICOQUIC_LOG_SPURIOUS_BURST) {
+            return;
+        }
+    }
+
+    if (cnx->quic->F_log != NULL) {
+        cnx->quic->text_log_fns->log_trigger(cnx, picoquic_log_trigger_name(trigger), current_time);
+    }
+
+    if (PICOQUIC_CNX_HAS_BINLOG(cnx)) {
+        cnx->quic->bin_log_fns->log_trigger(cnx, picoquic_log_trigger_name(trigger), current_time);
+    }
+}
@@ -1365,7 +1365,8 @@ void setup_pkt_udp_ip_headers(struct rte_ipv4_hdr *ip_hdr,
                               struct rte_udp_hdr *udp_hdr,
                               uint16_t pkt_data_len,
                               struct sockaddr_storage local_addr,
-                              struct sockaddr_storage peer_addr)
+                              struct sockaddr_storage peer_addr,
+                              uint8_t ecn_codepoint)
 {
     uint16_t *ptr16;
     uint32_t ip_cksum;
@@ -1410,7 +1411,7 @@ void setup_pkt_udp_ip_headers(struct rte_ipv4_hdr *ip_hdr,
      */
     pkt_len = (uint16_t)(pkt_len + sizeof(struct rte_ipv4_hdr));
     ip_hdr->version_ihl = RTE_IPV4_VHL_DEF;
-    ip_hdr->type_of_service = 0;
+    ip_hdr->type_of_service = ecn_codepoint & PICOQUIC_ECN_CE;
     ip_hdr->fragment_offset = 0;
     ip_hdr->time_to_live = IP_DEFTTL;
     ip_hdr->next_proto_id = IPPROTO_UDP;
@@ -1451,7 +1452,8 @@ void setup_pkt_udp_ip6_headers(struct rte_ipv6_hdr *ip_hdr,
                               struct rte_udp_hdr *udp_hdr,
                               uint16_t pkt_data_len,
                               struct sockaddr_storage local_addr,
-                              struct sockaddr_storage peer_addr)
+                              struct sockaddr_storage peer_addr,
+                              uint8_t ecn_codepoint)
 {
     uint16_t *ptr16;
     uint32_t ip_cksum;
@@ -1481,7 +1483,8 @@ void setup_pkt_udp_ip6_headers(struct rte_ipv6_hdr *ip_hdr,
      * Initialize IP header.
      */
     //pkt_len = (uint16_t)(pkt_len + sizeof(struct rte_ipv6_hdr));
-    ip_hdr->vtc_flow = 6 << 4;
+    /* Version 6, with the ECN codepoint in the two low bits of the traffic class */
+    ip_hdr->vtc_flow = rte_cpu_to_be_32((6u << 28) | ((uint32_t)(ecn_codepoint & PICOQUIC_ECN_CE) << 20));
     ip_hdr->proto = IPPROTO_UDP;
     ip_hdr->hop_limits = 128;
     ip_hdr->payload_len = rte_cpu_to_be_16(pkt_len);
@@ -76,6 +76,7 @@ int picoquic_packet_loop_win(picoquic_quic_t* quic,
 #include "picoquic_internal.h"
 #include "picoquic_packet_loop.h"
 #include "picoquic_unified_log.h"
+#include "picoquic_profiler.h"
 
  /* Test support for UDP coalescing */
 void picoquic_socks_win_coalescing_test(int * recv_coalesced, int * send_coalesced)
@@ -674,6 +675,7 @@ int picoquic_packet_loop_win(picoquic_quic_t* quic,
                 if (ret == 0 && loop_callback != NULL) {
                     ret = loop_callback(quic, picoquic_packet_loop_after_send, loop_callback_ctx, &bytes_sent);
                 }
+                picoquic_profiler_print_if_due(quic, current_time);
             }
         }
 
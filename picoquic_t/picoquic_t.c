@@ -61,6 +61,7 @@ static const picoquic_test_def_t test_table[] = {
     { "parse_frames", parse_frame_test },
     { "logger", logger_test },
     { "binlog", binlog_test },
+    { "binlog_ring", binlog_ring_test },
     { "app_message_overflow", app_message_overflow_test },
     { "TlsStreamFrame", TlsStreamFrameTest },
     { "StreamZeroFrame", StreamZeroFrameTest },
@@ -81,12 +82,15 @@ static const picoquic_test_def_t test_table[] = {
     { "cid_for_lb", cid_for_lb_test },
     { "cid_for_lb_cli", cid_for_lb_cli_test },
     { "retry_protection_vector", retry_protection_vector_test },
+    { "crypto_provider", crypto_provider_test },
+    { "crypto_ring_provider", crypto_ring_provider_test },
     { "draft17_vector", draft17_vector_test },
     { "esni", esni_test },
     { "pn_enc_1rtt", pn_enc_1rtt_test },
     { "new_cnxid_stash", cnxid_stash_test },
     { "new_cnxid", new_cnxid_test },
     { "pacing", pacing_test },
+    { "pacing_wheel", pacing_wheel_test },
     { "tls_api", tls_api_test },
     { "tls_api_inject_hs_ack", tls_api_inject_hs_ack_test },
     { "null_sni", null_sni_test },
@@ -137,6 +141,10 @@ static const picoquic_test_def_t test_table[] = {
     { "retry_large", tls_api_retry_large_test},
     { "retry_token", tls_retry_token_test },
     { "retry_token_valid", tls_retry_token_valid_test },
+    { "stateless_prefilter", stateless_prefilter_test },
+    { "async_sign", async_sign_test },
+    { "async_sign_client_auth", async_sign_client_auth_test },
+    { "async_sign_delete", async_sign_delete_test },
     { "two_connections", tls_api_two_connections_test },
     { "multiple_versions", tls_api_multiple_versions_test },
     { "keep_alive", keep_alive_test },
@@ -150,6 +158,7 @@ static const picoquic_test_def_t test_table[] = {
     { "ticket_store", ticket_store_test },
     { "ticket_seed", ticket_seed_test },
     { "ticket_seed_from_bdp_frame", ticket_seed_from_bdp_frame_test },
+    { "ticket_cache", ticket_cache_test },
     { "token_store", token_store_test },
     { "token_reuse_api", token_reuse_api_test },
     { "session_resume", session_resume_test },
@@ -230,11 +239,25 @@ static const picoquic_test_def_t test_table[] = {
     { "padding_test", padding_test },
     { "packet_trace", packet_trace_test },
     { "qlog_trace", qlog_trace_test },
+    { "qlog_index", qlog_index_test },
+    { "coltrace", coltrace_test },
     { "qlog_trace_auto", qlog_trace_auto_test },
     { "qlog_trace_only", qlog_trace_only_test },
     { "qlog_trace_ecn", qlog_trace_ecn_test },
+    { "qlog_trace_async", qlog_trace_async_test },
+    { "log_trigger", log_trigger_test },
+    { "log_trigger_rto", log_trigger_rto_test },
+    { "log_trigger_idle", log_trigger_idle_test },
+    { "log_trigger_handshake", log_trigger_handshake_test },
+    { "log_trigger_throughput", log_trigger_throughput_test },
+    { "metrics", metrics_test },
+    { "profiler", profiler_test },
+    { "events", events_test },
     { "path_packet_queue", path_packet_queue_test },
     { "perflog", perflog_test },
+    { "limit_time", limit_time_test },
+    { "limit_time_flow_control", limit_time_flow_control_test },
+    { "limit_time_stream_flow_control", limit_time_stream_flow_control_test },
     { "nat_rebinding_stress", rebinding_stress_test },
     { "random_padding", random_padding_test },
     { "ec00_zero", ec00_zero_test },
@@ -255,6 +278,11 @@ static const picoquic_test_def_t test_table[] = {
     { "fastcc_jitter", fastcc_jitter_test },
     { "bbr", bbr_test },
     { "bbr_jitter", bbr_jitter_test },
+    { "bbr3", bbr3_test },
+    { "bbr3_jitter", bbr3_jitter_test },
+    { "bbr3_shallow", bbr3_shallow_test },
+    { "cc_ack_event", cc_ack_event_test },
+    { "prague", prague_test },
     { "bbr_long", bbr_long_test },
     { "bbr_performance", bbr_performance_test },
     { "bbr_slow_long", bbr_slow_long_test },
@@ -263,6 +291,8 @@ static const picoquic_test_def_t test_table[] = {
     { "bbr_asym100", bbr_asym100_test },
     { "bbr_asym100_nodelay", bbr_asym100_nodelay_test },
     { "bbr_asym400", bbr_asym400_test },
+    { "ack_autotune", ack_autotune_test },
+    { "loss_timer", loss_timer_test },
     { "long_rtt", long_rtt_test },
     { "high_latency_basic", high_latency_basic_test },
     { "high_latency_bbr", high_latency_bbr_test },
@@ -330,6 +360,10 @@ static const picoquic_test_def_t test_table[] = {
     { "multipath_back1", multipath_back1_test },
     { "multipath_nat", multipath_nat_test },
     { "multipath_perf", multipath_perf_test },
+    { "multipath_minrtt", multipath_minrtt_test },
+    { "multipath_weighted", multipath_weighted_test },
+    { "multipath_ecf", multipath_ecf_test },
+    { "multipath_redundant", multipath_redundant_test },
     { "multipath_qlog", multipath_qlog_test },
     { "monopath_0rtt", monopath_0rtt_test },
     { "monopath_0rtt_loss", monopath_0rtt_loss_test },
@@ -355,6 +389,9 @@ static const picoquic_test_def_t test_table[] = {
     { "fuzz_initial", fuzz_initial_test},
     { "cnx_stress", cnx_stress_unit_test },
     { "cnx_ddos", cnx_ddos_unit_test },
+    { "handshake_bench", handshake_bench_test },
+    { "cc_bench", cc_bench_test },
+    { "scale_bench", scale_bench_test },
     { "config_option_letters", config_option_letters_test },
     { "config_option", config_option_test }
 };
@@ -407,6 +444,9 @@ int usage(char const * argv0)
     fprintf(stderr, "  -f nnn            Run fuzz for nnn minutes.\n");
     fprintf(stderr, "  -c nnn ccc        Run connection stress for nnn minutes, ccc connections.\n");
     fprintf(stderr, "  -d ppp uuu dir    Run connection ddoss for ppp packets, uuu usec intervals,\n");
+    fprintf(stderr, "  -H nnn rrr        Run handshake benchmark for nnn connections at rrr per second.\n");
+    fprintf(stderr, "  -B file.csv       Run the congestion control benchmark matrix, results in file.csv (\"-\" for stdout).\n");
+    fprintf(stderr, "  -M nnn rrr aaa    Run scale benchmark for nnn connections at rrr per second, aaa per mille active.\n");
     fprintf(stderr, "  -F nnn            Run the corrupt file fuzzer nnn times,\n");
     fprintf(stderr, "                    logs in dir. No logs if dir=\"-\"");
     fprintf(stderr, "  -n                Disable debug prints.\n");
@@ -444,6 +484,9 @@ int main(int argc, char** argv)
     int do_stress = 0;
     int do_cnx_stress = 0;
     int do_cnx_ddos = 0;
+    int do_handshake_bench = 0;
+    int do_cc_bench = 0;
+    int do_scale_bench = 0;
     int do_cf_fuzz = 0;
     int disable_debug = 0;
     int retry_failed_test = 0;
@@ -452,6 +495,12 @@ int main(int argc, char** argv)
     int cnx_ddos_packets = 0;
     int cnx_ddos_interval = 0;
     char const* cnx_ddos_dir = NULL;
+    uint64_t handshake_bench_nb_cnx = 0;
+    uint64_t handshake_bench_rate = 0;
+    char const* cc_bench_csv_file = NULL;
+    uint64_t scale_bench_nb_cnx = 0;
+    uint64_t scale_bench_rate = 0;
+    uint64_t scale_bench_active = 0;
 
     debug_printf_push_stream(stderr);
 
@@ -464,7 +513,7 @@ int main(int argc, char** argv)
     {
         memset(test_status, 0, nb_tests * sizeof(test_status_t));
 
-        while (ret == 0 && (opt = getopt(argc, argv, "c:d:f:F:s:S:x:nrh")) != -1) {
+        while (ret == 0 && (opt = getopt(argc, argv, "B:c:d:f:F:H:M:s:S:x:nrh")) != -1) {
             switch (opt) {
             case 'x': {
                 optind--;
@@ -547,6 +596,49 @@ int main(int argc, char** argv)
                     ret = usage(argv[0]);
                 }
                 break;
+            case 'H':
+                if (optind + 1 > argc) {
+                    fprintf(stderr, "option requires more arguments -- H\n");
+                    ret = usage(argv[0]);
+                }
+                do_handshake_bench = 1;
+                handshake_bench_nb_cnx = (uint64_t)atoi(optarg);
+                handshake_bench_rate = (uint64_t)atoi(argv[optind++]);
+                if (handshake_bench_nb_cnx == 0) {
+                    fprintf(stderr, "Incorrect handshake bench number of connections: %s\n", optarg);
+                    ret = usage(argv[0]);
+                }
+                else if (handshake_bench_rate == 0) {
+                    fprintf(stderr, "Incorrect handshake bench rate: %s\n", argv[optind - 1]);
+                    ret = usage(argv[0]);
+                }
+                break;
+            case 'B':
+                do_cc_bench = 1;
+                cc_bench_csv_file = optarg;
+                break;
+            case 'M':
+                if (optind + 2 > argc) {
+                    fprintf(stderr, "option requires more arguments -- M\n");
+                    ret = usage(argv[0]);
+                }
+                do_scale_bench = 1;
+                scale_bench_nb_cnx = (uint64_t)atoi(optarg);
+                scale_bench_rate = (uint64_t)atoi(argv[optind++]);
+                scale_bench_active = (uint64_t)atoi(argv[optind++]);
+                if (scale_bench_nb_cnx == 0) {
+                    fprintf(stderr, "Incorrect scale bench number of connections: %s\n", optarg);
+                    ret = usage(argv[0]);
+                }
+                else if (scale_bench_rate == 0) {
+                    fprintf(stderr, "Incorrect scale bench rate: %s\n", argv[optind - 2]);
+                    ret = usage(argv[0]);
+                }
+                else if (scale_bench_active > 1000) {
+                    fprintf(stderr, "Incorrect scale bench active per mille: %s\n", argv[optind - 1]);
+                    ret = usage(argv[0]);
+                }
+                break;
             case 'S':
                 picoquic_set_solution_dir(optarg);
                 break;
@@ -566,7 +658,7 @@ int main(int argc, char** argv)
             }
         }
         /* If one of the stressers was specified, do not run any other test by default */
-        if (do_stress || do_fuzz || do_cnx_stress || do_cnx_ddos || do_cf_fuzz) {
+        if (do_stress || do_fuzz || do_cnx_stress || do_cnx_ddos || do_cf_fuzz || do_handshake_bench || do_cc_bench || do_scale_bench) {
             auto_bypass = 1;
             for (size_t i = 0; i < nb_tests; i++) {
                 test_status[i] = test_excluded;
@@ -596,7 +688,7 @@ int main(int argc, char** argv)
         /* If one of the stressers is requested, just execute it,
          */
 
-        if (ret == 0 && (do_stress || do_fuzz || do_cnx_stress || do_cnx_ddos || do_cf_fuzz)) {
+        if (ret == 0 && (do_stress || do_fuzz || do_cnx_stress || do_cnx_ddos || do_cf_fuzz || do_handshake_bench || do_cc_bench || do_scale_bench)) {
             debug_printf_suspend();
             if (do_stress || do_fuzz) {
                 picoquic_stress_test_duration = stress_minutes;
@@ -629,6 +721,39 @@ int main(int argc, char** argv)
                         test_status[i] = test_success;
                     }
                 }
+                else if (do_handshake_bench && strcmp(test_table[i].test_name, "handshake_bench") == 0) {
+                    nb_test_tried++;
+                    if (handshake_bench_do_test(handshake_bench_nb_cnx, handshake_bench_rate, stdout) != 0) {
+                        test_status[i] = test_failed;
+                        nb_test_failed++;
+                        ret = -1;
+                    }
+                    else {
+                        test_status[i] = test_success;
+                    }
+                }
+                else if (do_cc_bench && strcmp(test_table[i].test_name, "cc_bench") == 0) {
+                    nb_test_tried++;
+                    if (cc_bench_do_test(cc_bench_csv_file) != 0) {
+                        test_status[i] = test_failed;
+                        nb_test_failed++;
+                        ret = -1;
+                    }
+                    else {
+                        test_status[i] = test_success;
+                    }
+                }
+                else if (do_scale_bench && strcmp(test_table[i].test_name, "scale_bench") == 0) {
+                    nb_test_tried++;
+                    if (scale_bench_do_test(scale_bench_nb_cnx, scale_bench_rate, scale_bench_active, stdout) != 0) {
+                        test_status[i] = test_failed;
+                        nb_test_failed++;
+                        ret = -1;
+                    }
+                    else {
+                        test_status[i] = test_success;
+                    }
+                }
                 else if (do_cnx_ddos && strcmp(test_table[i].test_name, "cnx_ddos") == 0) {
                     nb_test_tried++;
                     if (cnx_ddos_test_loop(cnx_ddos_packets, cnx_ddos_interval, cnx_ddos_dir) != 0) {
@@ -0,0 +1,582 @@
+/* Congestion control benchmark.
+ *
+ * Runs a matrix of scenarios in simulated time, for each of the congestion
+ * control algorithms known to the stack. A scenario is defined by the
+ * bottleneck bandwidth, the round trip time, the depth of the bottleneck
+ * buffer expressed as a fraction of the bandwidth delay product, a loss
+ * model, and the number of competing flows. Each flow is a separate client
+ * connection sending bulk data on one stream to the server, through the same
+ * bottleneck link. Flows start one RTT apart, so later flows have to claim
+ * their share from those already running.
+ *
+ * For each scenario and algorithm, the benchmark reports:
+ *
+ * - goodput: the stream data received by the server, in Mbps,
+ * - the median and 99th percentile of the queueing delay at the bottleneck,
+ * - the retransmission ratio: packets retransmitted per packet sent,
+ * - Jain's fairness index of the per flow goodputs,
+ * - the CPU time spent per GB of simulated data.
+ *
+ * The simulation uses fixed random seeds, so that apart from the CPU time the
+ * results only change if the code changes. Running the benchmark on two
+ * commits and comparing the CSV files shows the effect of CC and sender changes.
+ */
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <picotls.h>
+#include "picoquic_utils.h"
+#include "picoquic_internal.h"
+#include "tls_api.h"
+#include "picoquictest_internal.h"
+
+#define CC_BENCH_ALPN "ccbench"
+#define CC_BENCH_MAX_FLOWS 8
+#define CC_BENCH_CLIENT_PORT 12000
+#define CC_BENCH_DELAY_BIN_USEC 100
+#define CC_BENCH_DELAY_NB_BINS 20000
+#define CC_BENCH_DURATION_DEFAULT 10000000ull
+
+typedef enum {
+    cc_bench_loss_none = 0,
+    cc_bench_loss_periodic, /* One packet in 64 */
+    cc_bench_loss_burst /* Three consecutive packets in 64 */
+} cc_bench_loss_model_enum;
+
+typedef struct st_cc_bench_scenario_t {
+    uint64_t bandwidth_mbps;
+    uint64_t rtt_usec;
+    uint64_t buffer_bdp_percent;
+    cc_bench_loss_model_enum loss_model;
+    int nb_flows;
+} cc_bench_scenario_t;
+
+typedef struct st_cc_bench_result_t {
+    uint64_t bytes_received;
+    double goodput_mbps;
+    uint64_t queue_delay_p50;
+    uint64_t queue_delay_p99;
+    double retransmit_ratio;
+    double fairness;
+    double cpu_sec_per_gb;
+} cc_bench_result_t;
+
+typedef struct st_cc_bench_flow_t {
+    picoquic_cnx_t* cnx;
+    struct sockaddr_in client_addr;
+    uint64_t start_time;
+    uint64_t bytes_received;
+} cc_bench_flow_t;
+
+typedef struct st_cc_bench_ctx_t {
+    uint64_t simulated_time;
+    uint64_t duration;
+    picoquic_quic_t* qserver;
+    picoquic_quic_t* qclient;
+    struct sockaddr_in server_addr;
+    picoquictest_sim_link_t* link_to_server;
+    picoquictest_sim_link_t* link_to_clients;
+    uint64_t loss_mask;
+    int nb_flows;
+    int nb_flows_started;
+    cc_bench_flow_t flows[CC_BENCH_MAX_FLOWS];
+    uint64_t nb_delay_samples;
+    uint64_t* delay_histogram;
+} cc_bench_ctx_t;
+
+static char const* cc_bench_algorithms[] = { "reno", "cubic", "dcubic", "fast", "bbr", "prague", "bbr3" };
+static const size_t nb_cc_bench_algorithms = sizeof(cc_bench_algorithms) / sizeof(char const*);
+
+static const uint64_t cc_bench_bandwidths[] = { 10, 100 };
+static const uint64_t cc_bench_rtts[] = { 20000, 200000 };
+static const uint64_t cc_bench_buffers[] = { 50, 100, 400 };
+static const cc_bench_loss_model_enum cc_bench_losses[] = { cc_bench_loss_none, cc_bench_loss_periodic, cc_bench_loss_burst };
+static const int cc_bench_nb_flows[] = { 1, 2, 4 };
+
+static char const* cc_bench_loss_name(cc_bench_loss_model_enum loss_model)
+{
+    switch (loss_model) {
+    case cc_bench_loss_periodic:
+        return "periodic";
+    case cc_bench_loss_burst:
+        return "burst";
+    default:
+        return "none";
+    }
+}
+
+/* Callbacks. The clients send data on stream 0 for as long as the simulation runs,
+ * the server counts what it receives. */
+static int cc_bench_client_callback(picoquic_cnx_t* cnx,
+    uint64_t stream_id, uint8_t* bytes, size_t length,
+    picoquic_call_back_event_t fin_or_event, void* callback_ctx, void* v_stream_ctx)
+{
+    if (fin_or_event == picoquic_callback_prepare_to_send) {
+        uint8_t* buffer = picoquic_provide_stream_data_buffer(bytes, length, 0, 1);
+
+        if (buffer != NULL) {
+            memset(buffer, 0x5a, length);
+        }
+    }
+
+    return 0;
+}
+
+static int cc_bench_server_callback(picoquic_cnx_t* cnx,
+    uint64_t stream_id, uint8_t* bytes, size_t length,
+    picoquic_call_back_event_t fin_or_event, void* callback_ctx, void* v_stream_ctx)
+{
+    cc_bench_ctx_t* bench_ctx = (cc_bench_ctx_t*)callback_ctx;
+
+    if ((fin_or_event == picoquic_callback_stream_data || fin_or_event == picoquic_callback_stream_fin) &&
+        bench_ctx != NULL) {
+        struct sockaddr* peer_addr = NULL;
+
+        picoquic_get_peer_addr(cnx, &peer_addr);
+        if (peer_addr != NULL && peer_addr->sa_family == AF_INET) {
+            int flow_id = (int)ntohs(((struct sockaddr_in*)peer_addr)->sin_port) - CC_BENCH_CLIENT_PORT;
+
+            if (flow_id >= 0 && flow_id < bench_ctx->nb_flows) {
+                bench_ctx->flows[flow_id].bytes_received += length;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int cc_bench_start_flow(cc_bench_ctx_t* bench_ctx)
+{
+    int ret = 0;
+    cc_bench_flow_t* flow = &bench_ctx->flows[bench_ctx->nb_flows_started];
+
+    flow->cnx = picoquic_create_cnx(
+        bench_ctx->qclient, picoquic_null_connection_id, picoquic_null_connection_id,
+        (struct sockaddr*)&bench_ctx->server_addr, bench_ctx->simulated_time, 0,
+        PICOQUIC_TEST_SNI, CC_BENCH_ALPN, 1);
+
+    if (flow->cnx == NULL) {
+        ret = -1;
+    }
+    else {
+        picoquic_set_callback(flow->cnx, cc_bench_client_callback, bench_ctx);
+        ret = picoquic_set_local_addr(flow->cnx, (struct sockaddr*)&flow->client_addr);
+        if (ret == 0) {
+            ret = picoquic_start_client_cnx(flow->cnx);
+        }
+        if (ret == 0) {
+            ret = picoquic_mark_active_stream(flow->cnx, 0, 1, NULL);
+        }
+    }
+    bench_ctx->nb_flows_started++;
+
+    return ret;
+}
+
+static int cc_bench_arrival(picoquic_quic_t* quic, picoquictest_sim_link_t* link, uint64_t current_time)
+{
+    int ret = 0;
+    picoquictest_sim_packet_t* packet = picoquictest_sim_link_dequeue(link, current_time);
+
+    if (packet != NULL) {
+        ret = picoquic_incoming_packet(quic, packet->bytes, (uint32_t)packet->length,
+            (struct sockaddr*)&packet->addr_from, (struct sockaddr*)&packet->addr_to, 0, 0, current_time);
+        free(packet);
+    }
+
+    return ret;
+}
+
+static int cc_bench_departure(cc_bench_ctx_t* bench_ctx, picoquic_quic_t* quic, picoquictest_sim_link_t* link, int is_bottleneck)
+{
+    int ret = 0;
+    picoquictest_sim_packet_t* packet = picoquictest_sim_link_create_packet();
+
+    if (packet == NULL) {
+        ret = -1;
+    }
+    else {
+        picoquic_connection_id_t log_cid;
+        picoquic_cnx_t* last_cnx;
+        int if_index = 0;
+
+        ret = picoquic_prepare_next_packet(quic, bench_ctx->simulated_time, packet->bytes,
+            PICOQUIC_MAX_PACKET_SIZE, &packet->length,
+            &packet->addr_to, &packet->addr_from, &if_index, &log_cid, &last_cnx);
+
+        if (ret == 0 && packet->length > 0) {
+            uint64_t queue_delay = (link->queue_time > bench_ctx->simulated_time) ?
+                link->queue_time - bench_ctx->simulated_time : 0;
+            uint64_t nb_dropped = link->packets_dropped;
+
+            if (packet->addr_from.ss_family == AF_UNSPEC) {
+                picoquic_store_addr(&packet->addr_from, (struct sockaddr*)&bench_ctx->server_addr);
+            }
+            picoquictest_sim_link_submit(link, packet, bench_ctx->simulated_time);
+
+            if (is_bottleneck && link->packets_dropped == nb_dropped) {
+                uint64_t bin = queue_delay / CC_BENCH_DELAY_BIN_USEC;
+
+                if (bin >= CC_BENCH_DELAY_NB_BINS) {
+                    bin = CC_BENCH_DELAY_NB_BINS - 1;
+                }
+                bench_ctx->delay_histogram[bin]++;
+                bench_ctx->nb_delay_samples++;
+            }
+        }
+        else {
+            free(packet);
+        }
+    }
+
+    return ret;
+}
+
+/* Execute the next event: flow start, packet arrival or departure
+ * at client or server, whichever comes first. */
+static int cc_bench_loop_step(cc_bench_ctx_t* bench_ctx)
+{
+    int ret = 0;
+    int next_event = -1;
+    uint64_t next_time = UINT64_MAX;
+    uint64_t event_time;
+
+    if (bench_ctx->nb_flows_started < bench_ctx->nb_flows) {
+        next_time = bench_ctx->flows[bench_ctx->nb_flows_started].start_time;
+        next_event = 0;
+    }
+    if ((event_time = picoquictest_sim_link_next_arrival(bench_ctx->link_to_server, next_time)) < next_time) {
+        next_time = event_time;
+        next_event = 1;
+    }
+    if ((event_time = picoquictest_sim_link_next_arrival(bench_ctx->link_to_clients, next_time)) < next_time) {
+        next_time = event_time;
+        next_event = 2;
+    }
+    if ((event_time = picoquic_get_next_wake_time(bench_ctx->qclient, bench_ctx->simulated_time)) < next_time) {
+        next_time = event_time;
+        next_event = 3;
+    }
+    if ((event_time = picoquic_get_next_wake_time(bench_ctx->qserver, bench_ctx->simulated_time)) < next_time) {
+        next_time = event_time;
+        next_event = 4;
+    }
+
+    if (next_event < 0) {
+        ret = -1;
+    }
+    else {
+        if (next_time > bench_ctx->simulated_time) {
+            bench_ctx->simulated_time = next_time;
+        }
+
+        switch (next_event) {
+        case 0:
+            ret = cc_bench_start_flow(bench_ctx);
+            break;
+        case 1:
+            ret = cc_bench_arrival(bench_ctx->qserver, bench_ctx->link_to_server, bench_ctx->simulated_time);
+            break;
+        case 2:
+            ret = cc_bench_arrival(bench_ctx->qclient, bench_ctx->link_to_clients, bench_ctx->simulated_time);
+            break;
+        case 3:
+            ret = cc_bench_departure(bench_ctx, bench_ctx->qclient, bench_ctx->link_to_server, 1);
+            break;
+        default:
+            ret = cc_bench_departure(bench_ctx, bench_ctx->qserver, bench_ctx->link_to_clients, 0);
+            break;
+        }
+    }
+
+    return ret;
+}
+
+static void cc_bench_delete_ctx(cc_bench_ctx_t* bench_ctx)
+{
+    if (bench_ctx->qclient != NULL) {
+        picoquic_free(bench_ctx->qclient);
+    }
+    if (bench_ctx->qserver != NULL) {
+        picoquic_free(bench_ctx->qserver);
+    }
+    if (bench_ctx->link_to_server != NULL) {
+        picoquictest_sim_link_delete(bench_ctx->link_to_server);
+    }
+    if (bench_ctx->link_to_clients != NULL) {
+        picoquictest_sim_link_delete(bench_ctx->link_to_clients);
+    }
+    if (bench_ctx->delay_histogram != NULL) {
+        free(bench_ctx->delay_histogram);
+    }
+    free(bench_ctx);
+}
+
+static cc_bench_ctx_t* cc_bench_create_ctx(cc_bench_scenario_t const* scenario,
+    picoquic_congestion_algorithm_t const* cc_algo, uint64_t duration)
+{
+    cc_bench_ctx_t* bench_ctx = (cc_bench_ctx_t*)malloc(sizeof(cc_bench_ctx_t));
+
+    if (bench_ctx != NULL) {
+        int ret = 0;
+        char test_server_cert_file[512];
+        char test_server_key_file[512];
+        double data_rate_in_gps = ((double)scenario->bandwidth_mbps) / 1000.0;
+        uint64_t queue_delay_max = (scenario->rtt_usec * scenario->buffer_bdp_percent) / 100;
+
+        memset(bench_ctx, 0, sizeof(cc_bench_ctx_t));
+        bench_ctx->duration = duration;
+        bench_ctx->nb_flows = (scenario->nb_flows > CC_BENCH_MAX_FLOWS) ? CC_BENCH_MAX_FLOWS : scenario->nb_flows;
+        picoquic_set_test_address(&bench_ctx->server_addr, 0x01010101, 4433);
+        for (int i = 0; i < bench_ctx->nb_flows; i++) {
+            picoquic_set_test_address(&bench_ctx->flows[i].client_addr, 0x08080808, (uint16_t)(CC_BENCH_CLIENT_PORT + i));
+            bench_ctx->flows[i].start_time = i * scenario->rtt_usec;
+        }
+        switch (scenario->loss_model) {
+        case cc_bench_loss_periodic:
+            bench_ctx->loss_mask = 0x8000000000000000ull;
+            break;
+        case cc_bench_loss_burst:
+            bench_ctx->loss_mask = 0xE000000000000000ull;
+            break;
+        default:
+            break;
+        }
+
+        bench_ctx->delay_histogram = (uint64_t*)calloc(CC_BENCH_DELAY_NB_BINS, sizeof(uint64_t));
+        if (bench_ctx->delay_histogram == NULL) {
+            ret = -1;
+        }
+        else {
+            ret = picoquic_get_input_path(test_server_cert_file, sizeof(test_server_cert_file), picoquic_solution_dir, PICOQUIC_TEST_FILE_SERVER_CERT);
+        }
+        if (ret == 0) {
+            ret = picoquic_get_input_path(test_server_key_file, sizeof(test_server_key_file), picoquic_solution_dir, PICOQUIC_TEST_FILE_SERVER_KEY);
+        }
+        if (ret == 0) {
+            bench_ctx->qclient = picoquic_create(CC_BENCH_MAX_FLOWS, NULL, NULL,
+                NULL, CC_BENCH_ALPN, NULL, NULL, NULL, NULL,
+                NULL, bench_ctx->simulated_time, &bench_ctx->simulated_time,
+                NULL, NULL, 0);
+            bench_ctx->qserver = picoquic_create(CC_BENCH_MAX_FLOWS, test_server_cert_file, test_server_key_file,
+                NULL, CC_BENCH_ALPN, cc_bench_server_callback, bench_ctx, NULL, NULL,
+                NULL, bench_ctx->simulated_time, &bench_ctx->simulated_time,
+                NULL, NULL, 0);
+            bench_ctx->link_to_server = picoquictest_sim_link_create(data_rate_in_gps, scenario->rtt_usec / 2,
+                (scenario->loss_model == cc_bench_loss_none) ? NULL : &bench_ctx->loss_mask, queue_delay_max, 0);
+            bench_ctx->link_to_clients = picoquictest_sim_link_create(data_rate_in_gps, scenario->rtt_usec / 2,
+                NULL, 0, 0);
+            if (bench_ctx->qclient == NULL || bench_ctx->qserver == NULL ||
+                bench_ctx->link_to_server == NULL || bench_ctx->link_to_clients == NULL) {
+                ret = -1;
+            }
+            else {
+                picoquic_set_default_congestion_algorithm(bench_ctx->qclient, cc_algo);
+                picoquic_set_default_congestion_algorithm(bench_ctx->qserver, cc_algo);
+            }
+        }
+
+        if (ret != 0) {
+            cc_bench_delete_ctx(bench_ctx);
+            bench_ctx = NULL;
+        }
+    }
+
+    return bench_ctx;
+}
+
+static uint64_t cc_bench_delay_percentile(cc_bench_ctx_t* bench_ctx, uint64_t percent)
+{
+    uint64_t target = (bench_ctx->nb_delay_samples * percent + 99) / 100;
+    uint64_t cumul = 0;
+
+    for (uint64_t bin = 0; bin < CC_BENCH_DELAY_NB_BINS; bin++) {
+        cumul += bench_ctx->delay_histogram[bin];
+        if (cumul >= target) {
+            return bin * CC_BENCH_DELAY_BIN_USEC;
+        }
+    }
+
+    return CC_BENCH_DELAY_NB_BINS * CC_BENCH_DELAY_BIN_USEC;
+}
+
+static void cc_bench_compute_result(cc_bench_ctx_t* bench_ctx, double cpu_sec, cc_bench_result_t* result)
+{
+    double sum_goodput = 0;
+    double sum_squares = 0;
+    uint64_t nb_packets_sent = 0;
+    uint64_t nb_retransmissions = 0;
+
+    memset(result, 0, sizeof(cc_bench_result_t));
+
+    for (int i = 0; i < bench_ctx->nb_flows; i++) {
+        cc_bench_flow_t* flow = &bench_ctx->flows[i];
+        double goodput = 0;
+
+        if (bench_ctx->simulated_time > flow->start_time) {
+            goodput = ((double)flow->bytes_received * 8.0) / ((double)(bench_ctx->simulated_time - flow->start_time));
+        }
+        sum_goodput += goodput;
+        sum_squares += goodput * goodput;
+        result->bytes_received += flow->bytes_received;
+        if (flow->cnx != NULL) {
+            nb_packets_sent += flow->cnx->nb_packets_sent;
+            nb_retransmissions += flow->cnx->nb_retransmission_total;
+        }
+    }
+
+    if (bench_ctx->simulated_time > 0) {
+        result->goodput_mbps = ((double)result->bytes_received * 8.0) / ((double)bench_ctx->simulated_time);
+    }
+    result->queue_delay_p50 = cc_bench_delay_percentile(bench_ctx, 50);
+    result->queue_delay_p99 = cc_bench_delay_percentile(bench_ctx, 99);
+    if (nb_packets_sent > 0) {
+        result->retransmit_ratio = ((double)nb_retransmissions) / ((double)nb_packets_sent);
+    }
+    if (sum_squares > 0) {
+        result->fairness = (sum_goodput * sum_goodput) / (((double)bench_ctx->nb_flows) * sum_squares);
+    }
+    if (result->bytes_received > 0) {
+        result->cpu_sec_per_gb = (cpu_sec * 1000000000.0) / ((double)result->bytes_received);
+    }
+}
+
+static int cc_bench_run_one(cc_bench_scenario_t const* scenario, char const* cc_name,
+    uint64_t duration, cc_bench_result_t* result)
+{
+    int ret = 0;
+    picoquic_congestion_algorithm_t const* cc_algo = picoquic_get_congestion_algorithm(cc_name);
+    cc_bench_ctx_t* bench_ctx = NULL;
+
+    picoquic_public_random_seed_64(RANDOM_PUBLIC_TEST_SEED, 1);
+
+    if (cc_algo == NULL || scenario->nb_flows <= 0 || scenario->bandwidth_mbps == 0) {
+        ret = -1;
+    }
+    else if ((bench_ctx = cc_bench_create_ctx(scenario, cc_algo, duration)) == NULL) {
+        ret = -1;
+    }
+    else {
+        clock_t cpu_start = clock();
+
+        while (ret == 0 && bench_ctx->simulated_time < bench_ctx->duration) {
+            ret = cc_bench_loop_step(bench_ctx);
+        }
+
+        if (ret == 0) {
+            cc_bench_compute_result(bench_ctx, ((double)(clock() - cpu_start)) / ((double)CLOCKS_PER_SEC), result);
+        }
+        else {
+            DBG_PRINTF("CC bench %s fails at %" PRIu64 ", ret = %d", cc_name, bench_ctx->simulated_time, ret);
+        }
+
+        cc_bench_delete_ctx(bench_ctx);
+    }
+
+    return ret;
+}
+
+static void cc_bench_csv_header(FILE* F)
+{
+    fprintf(F, "cc, bandwidth_mbps, rtt_ms, buffer_bdp_pct, loss, flows, duration_s, "
+        "goodput_mbps, qdelay_p50_ms, qdelay_p99_ms, retransmit_ratio, fairness, cpu_sec_per_gb\n");
+}
+
+static void cc_bench_csv_line(FILE* F, cc_bench_scenario_t const* scenario, char const* cc_name,
+    uint64_t duration, cc_bench_result_t const* result)
+{
+    fprintf(F, "%s, %" PRIu64 ", %" PRIu64 ", %" PRIu64 ", %s, %d, %" PRIu64 ", %.3f, %.1f, %.1f, %.5f, %.4f, %.3f\n",
+        cc_name, scenario->bandwidth_mbps, scenario->rtt_usec / 1000, scenario->buffer_bdp_percent,
+        cc_bench_loss_name(scenario->loss_model), scenario->nb_flows, duration / 1000000,
+        result->goodput_mbps, ((double)result->queue_delay_p50) / 1000.0, ((double)result->queue_delay_p99) / 1000.0,
+        result->retransmit_ratio, result->fairness, result->cpu_sec_per_gb);
+}
+
+/* Run the full matrix of scenarios for all algorithms, and write the results
+ * in the CSV file. Returns -1 if any run fails, after running all of them. */
+int cc_bench_do_test(char const* csv_file_name)
+{
+    int ret = 0;
+    FILE* F = (strcmp(csv_file_name, "-") == 0) ? stdout : picoquic_file_open(csv_file_name, "w");
+
+    if (F == NULL) {
+        DBG_PRINTF("Cannot open %s", csv_file_name);
+        ret = -1;
+    }
+    else {
+        cc_bench_csv_header(F);
+
+        for (size_t i_cc = 0; i_cc < nb_cc_bench_algorithms; i_cc++) {
+            for (size_t i_bw = 0; i_bw < sizeof(cc_bench_bandwidths) / sizeof(uint64_t); i_bw++) {
+                for (size_t i_rtt = 0; i_rtt < sizeof(cc_bench_rtts) / sizeof(uint64_t); i_rtt++) {
+                    for (size_t i_buf = 0; i_buf < sizeof(cc_bench_buffers) / sizeof(uint64_t); i_buf++) {
+                        for (size_t i_loss = 0; i_loss < sizeof(cc_bench_losses) / sizeof(cc_bench_loss_model_enum); i_loss++) {
+                            for (size_t i_flows = 0; i_flows < sizeof(cc_bench_nb_flows) / sizeof(int); i_flows++) {
+                                cc_bench_scenario_t scenario;
+                                cc_bench_result_t result;
+
+                                scenario.bandwidth_mbps = cc_bench_bandwidths[i_bw];
+                                scenario.rtt_usec = cc_bench_rtts[i_rtt];
+                                scenario.buffer_bdp_percent = cc_bench_buffers[i_buf];
+                                scenario.loss_model = cc_bench_losses[i_loss];
+                                scenario.nb_flows = cc_bench_nb_flows[i_flows];
+
+                                if (cc_bench_run_one(&scenario, cc_bench_algorithms[i_cc], CC_BENCH_DURATION_DEFAULT, &result) == 0) {
+                                    cc_bench_csv_line(F, &scenario, cc_bench_algorithms[i_cc], CC_BENCH_DURATION_DEFAULT, &result);
+                                    fflush(F);
+                                }
+                                else {
+                                    ret = -1;
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        if (F != stdout) {
+            (void)picoquic_file_close(F);
+        }
+    }
+
+    return ret;
+}
+
+/* The unit test runs one short scenario with two competing flows for each
+ * algorithm, to check that the harness works and that the metrics are sane. */
+int cc_bench_test()
+{
+    int ret = 0;
+    const uint64_t duration = 3000000;
+    cc_bench_scenario_t scenario = { 10, 20000, 100, cc_bench_loss_none, 2 };
+
+    for (size_t i_cc = 0; ret == 0 && i_cc < nb_cc_bench_algorithms; i_cc++) {
+        cc_bench_result_t result;
+
+        ret = cc_bench_run_one(&scenario, cc_bench_algorithms[i_cc], duration, &result);
+
+        if (ret == 0) {
+            if (result.goodput_mbps < ((double)scenario.bandwidth_mbps) / 4 ||
+                result.goodput_mbps > (double)scenario.bandwidth_mbps) {
+                DBG_PRINTF("CC bench %s, goodput %f Mbps", cc_bench_algorithms[i_cc], result.goodput_mbps);
+                ret = -1;
+            }
+            else if (result.fairness <= 0 || result.fairness > 1.000001) {
+                DBG_PRINTF("CC bench %s, fairness %f", cc_bench_algorithms[i_cc], result.fairness);
+                ret = -1;
+            }
+            else if (result.queue_delay_p50 > result.queue_delay_p99 ||
+                result.queue_delay_p99 > scenario.rtt_usec * scenario.buffer_bdp_percent / 100 + CC_BENCH_DELAY_BIN_USEC) {
+                DBG_PRINTF("CC bench %s, queue delay p50 %" PRIu64 ", p99 %" PRIu64, cc_bench_algorithms[i_cc],
+                    result.queue_delay_p50, result.queue_delay_p99);
+                ret = -1;
+            }
+        }
+    }
+
+    return ret;
+}
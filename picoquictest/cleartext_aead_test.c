@@ -28,6 +28,7 @@
 #include "picotls.h"
 #include "picoquic_lb.h"
 #include <string.h>
+#include <rte_eal.h>
 #include "picoquictest_internal.h"
 
 static uint8_t const addr1[4] = { 10, 0, 0, 1 };
@@ -1307,3 +1308,432 @@ int retry_protection_vector_test()
     return ret;
 }
 
+
+/* Test of the packet protection provider API.
+ * The test provider defers the processing of submitted jobs until they
+ * are polled, which emulates an asynchronous engine. The test verifies that
+ * the results are the same as with the inline AEAD functions, and that a
+ * connection works when all packets go through the provider.
+ */
+#define CRYPTO_PROVIDER_TEST_MAX_JOBS 8
+#define CRYPTO_PROVIDER_TEST_PAYLOAD 256
+
+typedef struct st_crypto_provider_test_ctx_t {
+    picoquic_aead_job_t* pending[CRYPTO_PROVIDER_TEST_MAX_JOBS];
+    size_t nb_pending;
+    uint64_t nb_processed;
+} crypto_provider_test_ctx_t;
+
+static crypto_provider_test_ctx_t crypto_provider_test_ctx;
+static int crypto_provider_test_nb_ctx;
+
+static void* crypto_provider_test_create(picoquic_quic_t* quic, char const* param)
+{
+    crypto_provider_test_nb_ctx++;
+    return &crypto_provider_test_ctx;
+}
+
+static void crypto_provider_test_delete(void* provider_ctx)
+{
+    crypto_provider_test_nb_ctx--;
+}
+
+static size_t crypto_provider_test_process(void* provider_ctx, picoquic_aead_job_t* job)
+{
+    ((crypto_provider_test_ctx_t*)provider_ctx)->nb_processed++;
+    return picoquic_software_crypto_process(NULL, job);
+}
+
+static size_t crypto_provider_test_submit(void* provider_ctx, picoquic_aead_job_t** jobs, size_t nb_jobs)
+{
+    crypto_provider_test_ctx_t* ctx = (crypto_provider_test_ctx_t*)provider_ctx;
+    size_t nb_accepted = 0;
+
+    while (nb_accepted < nb_jobs && ctx->nb_pending < CRYPTO_PROVIDER_TEST_MAX_JOBS) {
+        ctx->pending[ctx->nb_pending++] = jobs[nb_accepted++];
+    }
+    return nb_accepted;
+}
+
+static size_t crypto_provider_test_poll(void* provider_ctx, picoquic_aead_job_t** jobs, size_t max_jobs)
+{
+    crypto_provider_test_ctx_t* ctx = (crypto_provider_test_ctx_t*)provider_ctx;
+    size_t nb_polled = 0;
+
+    /* Complete in reverse order, to verify that callers do not depend on ordering */
+    while (nb_polled < max_jobs && ctx->nb_pending > 0) {
+        picoquic_aead_job_t* job = ctx->pending[--ctx->nb_pending];
+        (void)crypto_provider_test_process(provider_ctx, job);
+        jobs[nb_polled++] = job;
+    }
+    return nb_polled;
+}
+
+static picoquic_crypto_provider_t crypto_provider_test_provider = {
+    "test",
+    crypto_provider_test_create,
+    crypto_provider_test_delete,
+    crypto_provider_test_process,
+    crypto_provider_test_submit,
+    crypto_provider_test_poll
+};
+
+static uint8_t crypto_provider_test_secret[] = {
+    0x9a, 0xc3, 0x12, 0xa7, 0xf8, 0x77, 0x46, 0x8e, 0xbe, 0x69, 0x42, 0x27, 0x48, 0xad, 0x00, 0xa1,
+    0x54, 0x43, 0xf1, 0x82, 0x03, 0xa0, 0x7d, 0x60, 0x60, 0xf6, 0x88, 0xf3, 0x0f, 0x21, 0x63, 0x2b
+};
+
+static int crypto_provider_batch_test(picoquic_quic_t* quic, void* aead_encrypt, void* aead_decrypt)
+{
+    int ret = 0;
+    uint8_t header[16];
+    uint8_t input[CRYPTO_PROVIDER_TEST_PAYLOAD];
+    uint8_t reference[CRYPTO_PROVIDER_TEST_MAX_JOBS][CRYPTO_PROVIDER_TEST_PAYLOAD + 16];
+    uint8_t encrypted[CRYPTO_PROVIDER_TEST_MAX_JOBS][CRYPTO_PROVIDER_TEST_PAYLOAD + 16];
+    uint8_t decrypted[CRYPTO_PROVIDER_TEST_MAX_JOBS][CRYPTO_PROVIDER_TEST_PAYLOAD];
+    size_t reference_length[CRYPTO_PROVIDER_TEST_MAX_JOBS];
+    picoquic_aead_job_t jobs[CRYPTO_PROVIDER_TEST_MAX_JOBS];
+    picoquic_aead_job_t* job_list[CRYPTO_PROVIDER_TEST_MAX_JOBS];
+    picoquic_aead_job_t* completed[CRYPTO_PROVIDER_TEST_MAX_JOBS];
+    size_t nb_completed = 0;
+
+    for (size_t i = 0; i < sizeof(header); i++) {
+        header[i] = (uint8_t)(0x40 + i);
+    }
+    for (size_t i = 0; i < sizeof(input); i++) {
+        input[i] = (uint8_t)i;
+    }
+
+    /* Compute the reference values with the inline functions. Odd jobs use the multipath variant */
+    for (int i = 0; i < CRYPTO_PROVIDER_TEST_MAX_JOBS; i++) {
+        if (i & 1) {
+            reference_length[i] = picoquic_aead_encrypt_mp(reference[i], input, sizeof(input), i,
+                1000 + i, header, sizeof(header), aead_encrypt);
+        }
+        else {
+            reference_length[i] = picoquic_aead_encrypt_generic(reference[i], input, sizeof(input),
+                1000 + i, header, sizeof(header), aead_encrypt);
+        }
+        memset(&jobs[i], 0, sizeof(picoquic_aead_job_t));
+        jobs[i].output = encrypted[i];
+        jobs[i].input = input;
+        jobs[i].input_length = sizeof(input);
+        jobs[i].auth_data = header;
+        jobs[i].auth_data_length = sizeof(header);
+        jobs[i].seq_num = 1000 + i;
+        jobs[i].path_id = i;
+        jobs[i].aead_context = aead_encrypt;
+        jobs[i].is_encrypt = 1;
+        jobs[i].is_multipath = i & 1;
+        jobs[i].job_ctx = &reference_length[i];
+        job_list[i] = &jobs[i];
+    }
+
+    if (picoquic_crypto_provider_submit_jobs(quic, job_list, CRYPTO_PROVIDER_TEST_MAX_JOBS) != CRYPTO_PROVIDER_TEST_MAX_JOBS) {
+        DBG_PRINTF("%s", "Not all jobs accepted.");
+        ret = -1;
+    }
+    else if (jobs[0].is_complete) {
+        DBG_PRINTF("%s", "Async job completed before poll.");
+        ret = -1;
+    }
+    else {
+        nb_completed = picoquic_crypto_provider_poll_jobs(quic, completed, CRYPTO_PROVIDER_TEST_MAX_JOBS);
+        if (nb_completed != CRYPTO_PROVIDER_TEST_MAX_JOBS) {
+            DBG_PRINTF("Polled %d jobs instead of %d.", (int)nb_completed, CRYPTO_PROVIDER_TEST_MAX_JOBS);
+            ret = -1;
+        }
+    }
+
+    for (int i = 0; ret == 0 && i < CRYPTO_PROVIDER_TEST_MAX_JOBS; i++) {
+        if (!jobs[i].is_complete || jobs[i].result != reference_length[i] ||
+            memcmp(encrypted[i], reference[i], reference_length[i]) != 0) {
+            DBG_PRINTF("Job %d does not match reference.", i);
+            ret = -1;
+        }
+    }
+
+    /* Decrypt through the synchronous entry point, as the receive path does */
+    for (int i = 0; ret == 0 && i < CRYPTO_PROVIDER_TEST_MAX_JOBS; i++) {
+        size_t decrypted_length = picoquic_aead_decrypt_packet(quic, decrypted[i], encrypted[i], jobs[i].result,
+            i & 1, i, 1000 + i, header, sizeof(header), aead_decrypt);
+        if (decrypted_length != sizeof(input) || memcmp(decrypted[i], input, sizeof(input)) != 0) {
+            DBG_PRINTF("Job %d does not decrypt.", i);
+            ret = -1;
+        }
+        else {
+            /* Check that a corrupted packet is rejected */
+            encrypted[i][0] ^= 1;
+            decrypted_length = picoquic_aead_decrypt_packet(quic, decrypted[i], encrypted[i], jobs[i].result,
+                i & 1, i, 1000 + i, header, sizeof(header), aead_decrypt);
+            if (decrypted_length <= sizeof(input)) {
+                DBG_PRINTF("Corruption of job %d not detected.", i);
+                ret = -1;
+            }
+        }
+    }
+
+    return ret;
+}
+
+int crypto_provider_test()
+{
+    int ret = 0;
+    uint64_t simulated_time = 0;
+    picoquic_quic_t* quic = picoquic_create(8, NULL, NULL, NULL, NULL, NULL, NULL,
+        NULL, NULL, NULL, simulated_time, &simulated_time, NULL, NULL, 0);
+    void* aead_encrypt = picoquic_setup_test_aead_context(1, crypto_provider_test_secret, PICOQUIC_LABEL_QUIC_V1_KEY_BASE);
+    void* aead_decrypt = picoquic_setup_test_aead_context(0, crypto_provider_test_secret, PICOQUIC_LABEL_QUIC_V1_KEY_BASE);
+    picoquic_test_tls_api_ctx_t* test_ctx = NULL;
+
+    memset(&crypto_provider_test_ctx, 0, sizeof(crypto_provider_test_ctx));
+
+    if (quic == NULL || aead_encrypt == NULL || aead_decrypt == NULL) {
+        DBG_PRINTF("%s", "Could not create the test contexts.");
+        ret = -1;
+    }
+    else if (picoquic_get_crypto_provider("software") != picoquic_software_crypto_provider ||
+        picoquic_get_crypto_provider("ring") != picoquic_ring_crypto_provider ||
+        picoquic_get_crypto_provider("no-such-provider") != NULL) {
+        DBG_PRINTF("%s", "Provider lookup fails.");
+        ret = -1;
+    }
+    else {
+        /* Inline processing, with no provider set */
+        ret = crypto_provider_batch_test(quic, aead_encrypt, aead_decrypt);
+        if (ret == 0 && (ret = picoquic_set_crypto_provider(quic, &crypto_provider_test_provider, NULL)) == 0) {
+            ret = crypto_provider_batch_test(quic, aead_encrypt, aead_decrypt);
+        }
+    }
+
+    if (quic != NULL) {
+        picoquic_free(quic);
+    }
+    if (aead_encrypt != NULL) {
+        picoquic_aead_free(aead_encrypt);
+    }
+    if (aead_decrypt != NULL) {
+        picoquic_aead_free(aead_decrypt);
+    }
+
+    if (ret == 0 && crypto_provider_test_nb_ctx != 0) {
+        DBG_PRINTF("%s", "Provider context not deleted with QUIC context.");
+        ret = -1;
+    }
+
+    /* Run a connection with all packets protected through the provider */
+    if (ret == 0) {
+        test_api_stream_desc_t test_scenario[] = { { 4, 0, 257, 2000 } };
+
+        crypto_provider_test_ctx.nb_processed = 0;
+        ret = tls_api_one_scenario_init(&test_ctx, &simulated_time, 0, NULL, NULL);
+        if (ret == 0) {
+            ret = picoquic_set_crypto_provider(test_ctx->qclient, &crypto_provider_test_provider, NULL);
+        }
+        if (ret == 0) {
+            ret = picoquic_set_crypto_provider(test_ctx->qserver, &crypto_provider_test_provider, NULL);
+        }
+        if (ret == 0) {
+            ret = tls_api_one_scenario_body(test_ctx, &simulated_time, test_scenario, sizeof(test_scenario), 0, 0, 0, 0, 75000);
+        }
+        if (ret == 0 && crypto_provider_test_ctx.nb_processed == 0) {
+            DBG_PRINTF("%s", "Packets were not processed by the provider.");
+            ret = -1;
+        }
+        if (test_ctx != NULL) {
+            tls_api_delete_ctx(test_ctx);
+            test_ctx = NULL;
+        }
+        if (ret == 0 && crypto_provider_test_nb_ctx != 0) {
+            DBG_PRINTF("%s", "Provider contexts not deleted after connection test.");
+            ret = -1;
+        }
+    }
+
+    return ret;
+}
+
+/* End to end test of the ring provider. The ring provider is wrapped to count
+ * the jobs that go through the rings, and is set on both client and server.
+ * The crypto loop runs on a plain thread, so the test only needs a minimal
+ * EAL, without huge pages or devices. The transfer includes a key rotation,
+ * which requires the jobs using the old keys to complete first.
+ */
+typedef struct st_crypto_ring_test_counts_t {
+    uint64_t nb_encrypt_submitted;
+    uint64_t nb_decrypt_submitted;
+    uint64_t nb_polled;
+    uint64_t nb_processed;
+    int nb_ctx;
+} crypto_ring_test_counts_t;
+
+static crypto_ring_test_counts_t crypto_ring_test_counts;
+
+static void* crypto_ring_test_create(picoquic_quic_t* quic, char const* param)
+{
+    void* ring_ctx = picoquic_ring_crypto_provider->provider_create(quic, param);
+
+    if (ring_ctx != NULL) {
+        crypto_ring_test_counts.nb_ctx++;
+    }
+    return ring_ctx;
+}
+
+static void crypto_ring_test_delete(void* provider_ctx)
+{
+    crypto_ring_test_counts.nb_ctx--;
+    picoquic_ring_crypto_provider->provider_delete(provider_ctx);
+}
+
+static size_t crypto_ring_test_process(void* provider_ctx, picoquic_aead_job_t* job)
+{
+    crypto_ring_test_counts.nb_processed++;
+    return picoquic_ring_crypto_provider->provider_process(provider_ctx, job);
+}
+
+static size_t crypto_ring_test_submit(void* provider_ctx, picoquic_aead_job_t** jobs, size_t nb_jobs)
+{
+    size_t nb_accepted = picoquic_ring_crypto_provider->provider_submit(provider_ctx, jobs, nb_jobs);
+
+    for (size_t i = 0; i < nb_accepted; i++) {
+        if (jobs[i]->is_encrypt) {
+            crypto_ring_test_counts.nb_encrypt_submitted++;
+        }
+        else {
+            crypto_ring_test_counts.nb_decrypt_submitted++;
+        }
+    }
+    return nb_accepted;
+}
+
+static size_t crypto_ring_test_poll(void* provider_ctx, picoquic_aead_job_t** jobs, size_t max_jobs)
+{
+    size_t nb_polled = picoquic_ring_crypto_provider->provider_poll(provider_ctx, jobs, max_jobs);
+
+    crypto_ring_test_counts.nb_polled += nb_polled;
+    return nb_polled;
+}
+
+static picoquic_crypto_provider_t crypto_ring_test_provider = {
+    "ring-test",
+    crypto_ring_test_create,
+    crypto_ring_test_delete,
+    crypto_ring_test_process,
+    crypto_ring_test_submit,
+    crypto_ring_test_poll
+};
+
+static int crypto_ring_test_init_eal()
+{
+    static int eal_state = 0; /* 0: not tried, 1: ready, -1: failed */
+
+    if (eal_state == 0) {
+        char arg_0[] = "picoquic_ct";
+        char arg_1[] = "--no-huge";
+        char arg_2[] = "--no-pci";
+        char arg_3[] = "--in-memory";
+        char arg_4[] = "-l";
+        char arg_5[] = "0";
+        char arg_6[] = "--log-level=1";
+        char* eal_argv[] = { arg_0, arg_1, arg_2, arg_3, arg_4, arg_5, arg_6 };
+
+        eal_state = (rte_eal_init(7, eal_argv) < 0) ? -1 : 1;
+    }
+
+    return (eal_state == 1) ? 0 : -1;
+}
+
+int crypto_ring_provider_test()
+{
+    int ret = 0;
+    uint64_t simulated_time = 0;
+    uint64_t loss_mask = 0;
+    test_api_stream_desc_t test_scenario[] = { { 4, 0, 257, 1000000 }, { 8, 4, 257, 1000000 } };
+    picoquic_test_tls_api_ctx_t* test_ctx = NULL;
+
+    memset(&crypto_ring_test_counts, 0, sizeof(crypto_ring_test_counts));
+
+    if (crypto_ring_test_init_eal() != 0) {
+        DBG_PRINTF("%s", "Cannot initialize the EAL for the ring provider.");
+        ret = -1;
+    }
+    else {
+        ret = tls_api_one_scenario_init(&test_ctx, &simulated_time, 0, NULL, NULL);
+    }
+
+    if (ret == 0) {
+        ret = picoquic_set_crypto_provider(test_ctx->qclient, &crypto_ring_test_provider, NULL);
+        if (ret == 0) {
+            ret = picoquic_set_crypto_provider(test_ctx->qserver, &crypto_ring_test_provider, NULL);
+        }
+        if (ret != 0) {
+            DBG_PRINTF("%s", "Cannot set the ring provider.");
+        }
+    }
+
+    if (ret == 0) {
+        ret = tls_api_one_scenario_body_connect(test_ctx, &simulated_time, 0, 0, 0);
+    }
+
+    if (ret == 0) {
+        ret = test_api_init_send_recv_scenario(test_ctx, test_scenario, sizeof(test_scenario));
+    }
+
+    /* Send part of the data, rotate the keys, then complete the transfer */
+    if (ret == 0) {
+        ret = tls_api_data_sending_loop(test_ctx, &loss_mask, &simulated_time, 200);
+    }
+
+    if (ret == 0 && !test_ctx->test_finished) {
+        ret = picoquic_start_key_rotation(test_ctx->cnx_client);
+        if (ret != 0) {
+            DBG_PRINTF("Cannot start key rotation, ret = 0x%x", ret);
+        }
+    }
+
+    if (ret == 0) {
+        ret = tls_api_data_sending_loop(test_ctx, &loss_mask, &simulated_time, 0);
+    }
+
+    if (ret == 0) {
+        ret = tls_api_one_scenario_body_verify(test_ctx, &simulated_time, 0);
+    }
+
+    if (ret == 0 && test_ctx->cnx_server->nb_crypto_key_rotations == 0) {
+        DBG_PRINTF("%s", "The server did not follow the key rotation.");
+        ret = -1;
+    }
+
+    if (ret == 0 && (crypto_ring_test_counts.nb_encrypt_submitted == 0 ||
+        crypto_ring_test_counts.nb_decrypt_submitted == 0)) {
+        DBG_PRINTF("Jobs submitted to the ring: %" PRIu64 " encrypt, %" PRIu64 " decrypt",
+            crypto_ring_test_counts.nb_encrypt_submitted, crypto_ring_test_counts.nb_decrypt_submitted);
+        ret = -1;
+    }
+
+    if (ret == 0 && crypto_ring_test_counts.nb_polled !=
+        crypto_ring_test_counts.nb_encrypt_submitted + crypto_ring_test_counts.nb_decrypt_submitted) {
+        DBG_PRINTF("Jobs polled: %" PRIu64 ", submitted: %" PRIu64, crypto_ring_test_counts.nb_polled,
+            crypto_ring_test_counts.nb_encrypt_submitted + crypto_ring_test_counts.nb_decrypt_submitted);
+        ret = -1;
+    }
+
+    if (ret == 0 && crypto_ring_test_counts.nb_processed >= crypto_ring_test_counts.nb_polled) {
+        /* Only the handshake packets are expected to be processed in line */
+        DBG_PRINTF("Jobs processed in line: %" PRIu64 ", through the ring: %" PRIu64,
+            crypto_ring_test_counts.nb_processed, crypto_ring_test_counts.nb_polled);
+        ret = -1;
+    }
+
+    if (test_ctx != NULL) {
+        tls_api_delete_ctx(test_ctx);
+        test_ctx = NULL;
+    }
+
+    if (ret == 0 && crypto_ring_test_counts.nb_ctx != 0) {
+        DBG_PRINTF("%s", "Ring provider contexts not deleted.");
+        ret = -1;
+    }
+
+    return ret;
+}
@@ -26,7 +26,7 @@
 #include "picoquic_utils.h"
 #include "picoquic_config.h"
 
-static char* ref_option_text = "c:k:K:p:v:o:w:x:rRs:XS:G:P:O:M:e:C:E:i:l:Lb:q:m:n:a:t:zI:DQT:N:B:F:VU:0j:h";
+static char* ref_option_text = "c:k:K:p:v:o:w:x:rRs:XS:G:P:O:M:e:C:E:i:l:Lb:q:m:n:a:t:zI:DQT:N:B:F:VU:0j:Y:h";
 
 int config_option_letters_test()
 {
@@ -94,6 +94,7 @@ static picoquic_quic_config_t param1 = {
     0, /* unsigned int force_zero_share : 1; */
     0, /* unsigned int no_disk : 1; */
     0, /* unsigned int large_client_hello : 1; */
+    100 /* int profile_interval_ms; */
 };
 
 static char const* config_argv1[] = {
@@ -122,6 +123,7 @@ static char const* config_argv1[] = {
     "-F", "/data/performance_log.csv",
     "-V",
     "-j", "1",
+    "-Y", "100",
     "-0",
     "-i", "0N8C-000123",
     NULL
@@ -176,7 +178,8 @@ static picoquic_quic_config_t param2 = {
     0x00000002, /* uint32_t desired_version; */
     1,/* unsigned int force_zero_share : 1; */
     1, /* unsigned int no_disk : 1; */
-    1 /* unsigned int large_client_hello : 1; */
+    1, /* unsigned int large_client_hello : 1; */
+    0 /* int profile_interval_ms; */
 };
 
 static const char* config_argv2[] = {
@@ -285,6 +288,7 @@ int config_test_compare(const picoquic_quic_config_t* expected, const picoquic_q
     ret |= config_test_compare_int("large_client_hello", expected->large_client_hello, actual->large_client_hello);
     ret |= config_test_compare_int("cnx_id_length", expected->cnx_id_length, actual->cnx_id_length);
     ret |= config_test_compare_int("bdp", expected->bdp_frame_option, actual->bdp_frame_option);
+    ret |= config_test_compare_int("profile", expected->profile_interval_ms, actual->profile_interval_ms);
 
     return ret;
 }
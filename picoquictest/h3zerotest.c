@@ -532,6 +532,242 @@ int qpack_huffman_base_test()
 }
 
 
+/* Reference decoder, one bit at a time, using the list of codes above,
+ * which is sorted by code length and then by code value. */
+static int qpack_huffman_reference_decode(uint8_t const* bytes, size_t length, uint8_t* decoded, size_t max_decoded, size_t* nb_decoded)
+{
+    int ret = 0;
+    uint64_t code = 0;
+    int nb_bits = 0;
+    size_t first = 0;
+
+    *nb_decoded = 0;
+    for (size_t i = 0; ret == 0 && i < 8 * length; i++) {
+        code = (code << 1) | ((bytes[i / 8] >> (7 - (i % 8))) & 1);
+        nb_bits++;
+        while (first < nb_h3zero_qpack_huffman_base && h3zero_qpack_huffman_base[first].nb_bits < nb_bits) {
+            first++;
+        }
+        for (size_t j = first; j < nb_h3zero_qpack_huffman_base && h3zero_qpack_huffman_base[j].nb_bits == nb_bits; j++) {
+            if (h3zero_qpack_huffman_base[j].right_shift_hex == code) {
+                if (h3zero_qpack_huffman_base[j].code > 255 || *nb_decoded >= max_decoded) {
+                    ret = -1;
+                }
+                else {
+                    decoded[(*nb_decoded)++] = (uint8_t)h3zero_qpack_huffman_base[j].code;
+                    code = 0;
+                    nb_bits = 0;
+                    first = 0;
+                }
+                break;
+            }
+        }
+    }
+    if (ret == 0 && nb_bits > 0 && code != (UINT64_MAX >> (64 - nb_bits))) {
+        /* Padding is not all ones */
+        ret = -1;
+    }
+    return ret;
+}
+
+static int qpack_huffman_round_trip(uint8_t const* val, size_t val_length)
+{
+    int ret = 0;
+    uint8_t encoded[1024];
+    uint8_t decoded[1024];
+    size_t nb_decoded = 0;
+    size_t nb_reference = 0;
+    uint8_t* bytes = h3zero_qpack_huffman_encode(encoded, encoded + sizeof(encoded), val, val_length);
+
+    if (bytes == NULL || (size_t)(bytes - encoded) != h3zero_qpack_huffman_length(val, val_length)) {
+        DBG_PRINTF("Huffman encoding fails for length %d", (int)val_length);
+        ret = -1;
+    }
+    else if (hzero_qpack_huffman_decode(encoded, bytes, decoded, sizeof(decoded), &nb_decoded) != 0 ||
+        nb_decoded != val_length || memcmp(decoded, val, val_length) != 0) {
+        DBG_PRINTF("Huffman round trip fails for length %d", (int)val_length);
+        ret = -1;
+    }
+    else if (qpack_huffman_reference_decode(encoded, bytes - encoded, decoded, sizeof(decoded), &nb_reference) != 0 ||
+        nb_reference != val_length || memcmp(decoded, val, val_length) != 0) {
+        DBG_PRINTF("Huffman reference decoding fails for length %d", (int)val_length);
+        ret = -1;
+    }
+    else if (val_length > 0 && h3zero_qpack_huffman_encode(encoded, bytes - 1, val, val_length) != NULL) {
+        DBG_PRINTF("Huffman encoding overflow not detected for length %d", (int)val_length);
+        ret = -1;
+    }
+    return ret;
+}
+
+int qpack_huffman_encode_test()
+{
+    int ret = 0;
+    uint8_t data[256];
+    uint8_t encoded[256];
+    size_t nb_data;
+    uint64_t random_context = 0x48756666u;
+    /* EOS inside a string, padding with zeros, truncated code */
+    uint8_t const eos_string[] = { 0x1f, 0xff, 0xff, 0xff, 0xff };
+    uint8_t const zero_padding[] = { 0x18 };
+    uint8_t const truncated[] = { 0xff, 0xfe };
+
+    /* The test vectors are encoded as expected */
+    for (size_t i = 0; ret == 0 && i < nb_qpack_huffman_test_case; i++) {
+        uint8_t* bytes = h3zero_qpack_huffman_encode(encoded, encoded + sizeof(encoded),
+            qpack_huffman_test_case[i].result, qpack_huffman_test_case[i].result_size);
+        if (bytes == NULL || (size_t)(bytes - encoded) != qpack_huffman_test_case[i].test_size ||
+            memcmp(encoded, qpack_huffman_test_case[i].test, qpack_huffman_test_case[i].test_size) != 0) {
+            DBG_PRINTF("Huffman encode test %d does not match", (int)i);
+            ret = -1;
+        }
+    }
+
+    /* Each octet value, alone and in sequence */
+    for (int i = 0; ret == 0 && i < 256; i++) {
+        data[i] = (uint8_t)i;
+        ret = qpack_huffman_round_trip(&data[i], 1);
+    }
+    if (ret == 0) {
+        ret = qpack_huffman_round_trip(data, 256);
+    }
+
+    /* Random strings */
+    for (int i = 0; ret == 0 && i < 256; i++) {
+        size_t length = (size_t)picoquic_test_uniform_random(&random_context, sizeof(data));
+        for (size_t j = 0; j < length; j++) {
+            data[j] = (uint8_t)picoquic_test_uniform_random(&random_context, (i & 1) ? 256 : 64) + ((i & 1) ? 0 : 0x30);
+        }
+        ret = qpack_huffman_round_trip(data, length);
+    }
+
+    /* Invalid inputs */
+    if (ret == 0 && hzero_qpack_huffman_decode((uint8_t*)eos_string, (uint8_t*)eos_string + sizeof(eos_string),
+        data, sizeof(data), &nb_data) == 0) {
+        DBG_PRINTF("%s", "EOS in Huffman string not detected");
+        ret = -1;
+    }
+    if (ret == 0 && hzero_qpack_huffman_decode((uint8_t*)zero_padding, (uint8_t*)zero_padding + sizeof(zero_padding),
+        data, sizeof(data), &nb_data) == 0) {
+        DBG_PRINTF("%s", "Zero padding not detected");
+        ret = -1;
+    }
+    if (ret == 0 && hzero_qpack_huffman_decode((uint8_t*)truncated, (uint8_t*)truncated + sizeof(truncated),
+        data, sizeof(data), &nb_data) == 0) {
+        DBG_PRINTF("%s", "Truncated code not detected");
+        ret = -1;
+    }
+    if (ret == 0 && hzero_qpack_huffman_decode(qpack_huffman_test_case[1].test,
+        qpack_huffman_test_case[1].test + qpack_huffman_test_case[1].test_size,
+        data, qpack_huffman_test_case[1].result_size - 1, &nb_data) == 0) {
+        DBG_PRINTF("%s", "Huffman decoding overflow not detected");
+        ret = -1;
+    }
+
+    return ret;
+}
+
+/* Microbenchmark of the Huffman codec, on typical header values. The table
+ * decoder is compared to the bit by bit reference decoder. */
+static char const* qpack_huffman_bench_values[] = {
+    "Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0.0.0 Safari/537.36",
+    "Mozilla/5.0 (iPhone; CPU iPhone OS 17_1 like Mac OS X) AppleWebKit/605.1.15 (KHTML, like Gecko) Version/17.1 Mobile/15E148",
+    "text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,*/*;q=0.8",
+    "gzip, deflate, br",
+    "en-US,en;q=0.9",
+    "/static/js/main.8f2c1d4e.chunk.js",
+    "/api/v2/users/12345/profile?fields=name,email,avatar&locale=en_US",
+    "www.example.com",
+    "session=8e4f1b2a9c7d6e5f4a3b2c1d0e9f8a7b; theme=dark; _ga=GA1.2.1234567890.1700000000",
+    "Bearer eyJhbGciOiJIUzI1NiIsInR5cCI6IkpXVCJ9.eyJzdWIiOiIxMjM0NTY3ODkwIiwibmFtZSI6IkpvaG4ifQ",
+    "Tue, 17 Oct 2023 12:34:56 GMT",
+    "max-age=31536000; includeSubDomains",
+    "\"33a64df551425fcc55e4d42a148795d9f25f89d4\"",
+    "h3zero/1.0"
+};
+
+static size_t const nb_qpack_huffman_bench_values = sizeof(qpack_huffman_bench_values) / sizeof(char const*);
+
+int qpack_huffman_bench_do_test(uint64_t nb_rounds, FILE* F)
+{
+    int ret = 0;
+    uint8_t encoded[16][256];
+    size_t encoded_length[16];
+    uint8_t decoded[512];
+    size_t nb_decoded = 0;
+    size_t plain_bytes = 0;
+    size_t huffman_bytes = 0;
+    uint64_t time_start;
+    uint64_t encode_time;
+    uint64_t decode_time;
+    uint64_t reference_time;
+
+    if (nb_qpack_huffman_bench_values > 16) {
+        return -1;
+    }
+
+    time_start = picoquic_current_time();
+    for (uint64_t r = 0; ret == 0 && r < nb_rounds; r++) {
+        for (size_t i = 0; ret == 0 && i < nb_qpack_huffman_bench_values; i++) {
+            uint8_t const* val = (uint8_t const*)qpack_huffman_bench_values[i];
+            uint8_t* bytes = h3zero_qpack_huffman_encode(encoded[i], encoded[i] + sizeof(encoded[i]),
+                val, strlen(qpack_huffman_bench_values[i]));
+            if (bytes == NULL) {
+                ret = -1;
+            }
+            else {
+                encoded_length[i] = bytes - encoded[i];
+            }
+        }
+    }
+    encode_time = picoquic_current_time() - time_start;
+
+    time_start = picoquic_current_time();
+    for (uint64_t r = 0; ret == 0 && r < nb_rounds; r++) {
+        for (size_t i = 0; ret == 0 && i < nb_qpack_huffman_bench_values; i++) {
+            ret = hzero_qpack_huffman_decode(encoded[i], encoded[i] + encoded_length[i], decoded, sizeof(decoded), &nb_decoded);
+        }
+    }
+    decode_time = picoquic_current_time() - time_start;
+
+    time_start = picoquic_current_time();
+    for (uint64_t r = 0; ret == 0 && r < nb_rounds; r++) {
+        for (size_t i = 0; ret == 0 && i < nb_qpack_huffman_bench_values; i++) {
+            ret = qpack_huffman_reference_decode(encoded[i], encoded_length[i], decoded, sizeof(decoded), &nb_decoded);
+        }
+    }
+    reference_time = picoquic_current_time() - time_start;
+
+    for (size_t i = 0; ret == 0 && i < nb_qpack_huffman_bench_values; i++) {
+        size_t length = strlen(qpack_huffman_bench_values[i]);
+        if (hzero_qpack_huffman_decode(encoded[i], encoded[i] + encoded_length[i], decoded, sizeof(decoded), &nb_decoded) != 0 ||
+            nb_decoded != length || memcmp(decoded, qpack_huffman_bench_values[i], length) != 0) {
+            DBG_PRINTF("Bench value %d does not decode", (int)i);
+            ret = -1;
+        }
+        plain_bytes += length;
+        huffman_bytes += encoded_length[i];
+    }
+
+    if (ret == 0 && F != NULL) {
+        double total_plain = (double)plain_bytes * (double)nb_rounds;
+
+        fprintf(F, "QPACK Huffman, %" PRIu64 " rounds of %d strings, %d bytes, %d encoded (%.1f%%)\n",
+            nb_rounds, (int)nb_qpack_huffman_bench_values, (int)plain_bytes, (int)huffman_bytes,
+            100.0 * (double)huffman_bytes / (double)plain_bytes);
+        fprintf(F, "    encode: %.2f ns/byte\n", (encode_time * 1000.0) / total_plain);
+        fprintf(F, "    decode: %.2f ns/byte\n", (decode_time * 1000.0) / total_plain);
+        fprintf(F, "    bit by bit decode: %.2f ns/byte\n", (reference_time * 1000.0) / total_plain);
+    }
+
+    return ret;
+}
+
+int qpack_huffman_bench_test()
+{
+    return qpack_huffman_bench_do_test(16, NULL);
+}
+
 #define QPACK_HUFFMAN_TXT "qpack_huffman.txt"
 
 /* Test decoding of basic QPACK messages */
@@ -1270,6 +1506,418 @@ int h3zero_stream_test()
     return ret;
 }
 
+/*
+ * Test of the QPACK dynamic table. An encoder and a decoder exchange the
+ * instructions of the encoder and decoder streams, as they would on a
+ * connection, and the field sections are verified after decoding.
+ */
+
+static int h3zero_qpack_test_exchange(h3zero_qpack_encoder_t* encoder, h3zero_qpack_decoder_t* decoder, int to_decoder, int to_encoder)
+{
+    int ret = 0;
+    uint8_t buffer[256];
+    size_t length;
+
+    while (ret == 0 && to_decoder && (length = h3zero_qpack_buffer_take(&encoder->encoder_stream, buffer, sizeof(buffer))) > 0) {
+        ret = h3zero_qpack_receive_encoder_stream(decoder, buffer, length);
+    }
+    while (ret == 0 && to_encoder && (length = h3zero_qpack_buffer_take(&decoder->decoder_stream, buffer, sizeof(buffer))) > 0) {
+        ret = h3zero_qpack_receive_decoder_stream(encoder, buffer, length);
+    }
+    if (ret == 0 && to_decoder) {
+        /* Both copies of the table shall be identical */
+        if (encoder->table.insert_count != decoder->table.insert_count ||
+            encoder->table.size != decoder->table.size) {
+            DBG_PRINTF("Tables differ, insert count %d vs %d", (int)encoder->table.insert_count, (int)decoder->table.insert_count);
+            ret = -1;
+        }
+        for (uint64_t i = decoder->table.insert_count - decoder->table.nb_entries; ret == 0 && i < decoder->table.insert_count; i++) {
+            h3zero_qpack_entry_t* e_entry = h3zero_qpack_table_get(&encoder->table, i);
+            h3zero_qpack_entry_t* d_entry = h3zero_qpack_table_get(&decoder->table, i);
+
+            if (e_entry == NULL || d_entry == NULL ||
+                e_entry->name_length != d_entry->name_length || e_entry->value_length != d_entry->value_length ||
+                memcmp(e_entry->name, d_entry->name, d_entry->name_length) != 0 ||
+                memcmp(e_entry->value, d_entry->value, d_entry->value_length) != 0) {
+                DBG_PRINTF("Entry %d differs", (int)i);
+                ret = -1;
+            }
+        }
+    }
+    return ret;
+}
+
+static int h3zero_qpack_test_parse(uint8_t* bytes, uint8_t* bytes_max, h3zero_qpack_decoder_t* decoder,
+    uint64_t stream_id, char const* path)
+{
+    int ret = 0;
+    int is_blocked = 0;
+    h3zero_header_parts_t parts;
+    uint8_t* parsed;
+
+    memset(&parts, 0, sizeof(parts));
+    parsed = h3zero_parse_qpack_header_frame_ex(bytes, bytes_max, &parts, decoder, stream_id, &is_blocked);
+    if (parsed != bytes_max || is_blocked) {
+        DBG_PRINTF("Cannot parse section of stream %d", (int)stream_id);
+        ret = -1;
+    }
+    else if (parts.method != h3zero_method_get || parts.path == NULL || parts.path_length != strlen(path) ||
+        memcmp(parts.path, path, parts.path_length) != 0) {
+        DBG_PRINTF("Wrong parts for stream %d", (int)stream_id);
+        ret = -1;
+    }
+    if (parts.path != NULL) {
+        free((uint8_t*)parts.path);
+    }
+    return ret;
+}
+
+static int h3zero_qpack_settings_test()
+{
+    int ret = 0;
+    uint8_t buffer[64];
+    uint8_t* bytes;
+    h3zero_settings_t settings = { 0 };
+    h3zero_settings_t decoded;
+
+    /* Default settings produce the default frame */
+    bytes = h3zero_settings_encode(buffer, buffer + sizeof(buffer), &settings);
+    if (bytes == NULL || (size_t)(bytes - buffer) != h3zero_default_setting_frame_size ||
+        memcmp(buffer, h3zero_default_setting_frame, h3zero_default_setting_frame_size) != 0) {
+        DBG_PRINTF("%s", "Default settings not encoded as expected");
+        ret = -1;
+    }
+    else {
+        settings.header_size = H3ZERO_QPACK_MAX_TABLE_CAPACITY_DEFAULT;
+        settings.blocked_streams = H3ZERO_QPACK_BLOCKED_STREAMS_DEFAULT;
+        bytes = h3zero_settings_encode(buffer, buffer + sizeof(buffer), &settings);
+        if (bytes == NULL || buffer[0] != h3zero_stream_type_control || buffer[1] != h3zero_frame_settings ||
+            buffer[2] != (uint8_t)(bytes - buffer - 3)) {
+            DBG_PRINTF("%s", "Cannot encode settings");
+            ret = -1;
+        }
+        else if (h3zero_settings_decode(buffer + 3, bytes, &decoded) != bytes ||
+            decoded.header_size != settings.header_size || decoded.blocked_streams != settings.blocked_streams) {
+            DBG_PRINTF("%s", "Cannot decode settings");
+            ret = -1;
+        }
+    }
+    return ret;
+}
+
+static int h3zero_qpack_static_only_test()
+{
+    int ret = 0;
+    uint8_t buffer[256];
+    uint8_t target[256];
+    uint8_t* bytes;
+    uint8_t* target_end;
+    char const* path = "/index.html";
+
+    /* Without an encoder context, the encoding only differs from the
+     * static encoding by the use of Huffman coding */
+    bytes = h3zero_create_request_header_frame_qpack(NULL, 0, buffer, buffer + sizeof(buffer),
+        (uint8_t const*)path, strlen(path), "example.com", "test-agent", NULL, 0);
+    target_end = h3zero_create_request_header_frame_ex(target, target + sizeof(target),
+        (uint8_t const*)path, strlen(path), "example.com", "test-agent");
+
+    if (bytes == NULL || target_end == NULL || bytes - buffer >= target_end - target) {
+        DBG_PRINTF("%s", "Static only encoding is not shorter");
+        ret = -1;
+    }
+    else {
+        ret = h3zero_qpack_test_parse(buffer, bytes, NULL, 0, path);
+    }
+    return ret;
+}
+
+static int h3zero_qpack_init_pair(h3zero_qpack_encoder_t* encoder, h3zero_qpack_decoder_t* decoder,
+    unsigned int capacity, unsigned int blocked_streams)
+{
+    int ret;
+    h3zero_settings_t settings = { 0 };
+
+    settings.header_size = capacity;
+    settings.blocked_streams = blocked_streams;
+
+    if ((ret = h3zero_qpack_encoder_init(encoder, H3ZERO_QPACK_MAX_TABLE_CAPACITY_DEFAULT)) == 0 &&
+        (ret = h3zero_qpack_decoder_init(decoder, capacity, blocked_streams)) == 0) {
+        ret = h3zero_qpack_encoder_set_peer_settings(encoder, &settings);
+    }
+    return ret;
+}
+
+static int h3zero_qpack_requests_test(unsigned int capacity, int nb_requests, int vary_fields)
+{
+    int ret = 0;
+    h3zero_qpack_encoder_t encoder;
+    h3zero_qpack_decoder_t decoder;
+    char const* ua = (vary_fields) ? NULL : "Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0 Safari/537.36";
+    char path[64];
+    char host[64];
+    char authorization[128];
+    h3zero_qpack_field_t extra;
+    uint8_t buffer[512];
+    uint8_t* bytes;
+    size_t static_length = 0;
+    size_t last_length = 0;
+
+    ret = h3zero_qpack_init_pair(&encoder, &decoder, capacity, H3ZERO_QPACK_BLOCKED_STREAMS_DEFAULT);
+
+    for (int i = 0; ret == 0 && i < nb_requests; i++) {
+        uint64_t stream_id = 4 * (uint64_t)i;
+        (void)picoquic_sprintf(path, sizeof(path), NULL, "/file-%d.html", i);
+        (void)picoquic_sprintf(host, sizeof(host), NULL, "server-%d.example.com", (vary_fields) ? i : 0);
+        (void)picoquic_sprintf(authorization, sizeof(authorization), NULL,
+            "Bearer eyJhbGciOiJIUzI1NiIsInR5cCI6IkpXVCJ9.eyJzdWIiOiIxMjM0NTY3ODkwIn0.%d",
+            (vary_fields) ? i : 0);
+        extra.name = (uint8_t const*)"authorization";
+        extra.name_length = strlen("authorization");
+        extra.value = (uint8_t const*)authorization;
+        extra.value_length = strlen(authorization);
+
+        if (i == 0) {
+            bytes = h3zero_create_request_header_frame_qpack(NULL, 0, buffer, buffer + sizeof(buffer),
+                (uint8_t const*)path, strlen(path), host, ua, &extra, 1);
+            static_length = (bytes == NULL) ? 0 : bytes - buffer;
+        }
+        bytes = h3zero_create_request_header_frame_qpack(&encoder, stream_id, buffer, buffer + sizeof(buffer),
+            (uint8_t const*)path, strlen(path), host, ua, &extra, 1);
+        if (bytes == NULL) {
+            DBG_PRINTF("Cannot encode request %d", i);
+            ret = -1;
+        }
+        else if (encoder.table.size > encoder.table.capacity) {
+            DBG_PRINTF("Table size %d above capacity", (int)encoder.table.size);
+            ret = -1;
+        }
+        else if ((ret = h3zero_qpack_test_exchange(&encoder, &decoder, 1, 0)) == 0 &&
+            (ret = h3zero_qpack_test_parse(buffer, bytes, &decoder, stream_id, path)) == 0) {
+            last_length = bytes - buffer;
+            ret = h3zero_qpack_test_exchange(&encoder, &decoder, 0, 1);
+        }
+    }
+
+    if (ret == 0 && encoder.first_section != NULL) {
+        DBG_PRINTF("%s", "Some sections were not acknowledged");
+        ret = -1;
+    }
+    if (ret == 0 && vary_fields && encoder.table.insert_count <= encoder.table.nb_entries) {
+        DBG_PRINTF("%s", "No entry was evicted");
+        ret = -1;
+    }
+    if (ret == 0 && !vary_fields && 2 * last_length > static_length) {
+        DBG_PRINTF("Sections not compressed, %d vs %d bytes", (int)last_length, (int)static_length);
+        ret = -1;
+    }
+
+    h3zero_qpack_encoder_release(&encoder);
+    h3zero_qpack_decoder_release(&decoder);
+    return ret;
+}
+
+static int h3zero_qpack_blocked_test()
+{
+    int ret = 0;
+    h3zero_qpack_encoder_t encoder;
+    h3zero_qpack_decoder_t decoder;
+    h3zero_data_stream_state_t stream_state;
+    char const* path = "/blocked.html";
+    uint8_t stream[256];
+    uint8_t* bytes = stream + 3;
+    uint8_t* p;
+    uint8_t* kept = NULL;
+    size_t kept_length = 0;
+    size_t available_data = 0;
+    size_t nb_data = 0;
+    uint16_t error_found = 0;
+
+    memset(&stream_state, 0, sizeof(stream_state));
+    ret = h3zero_qpack_init_pair(&encoder, &decoder, H3ZERO_QPACK_MAX_TABLE_CAPACITY_DEFAULT, 1);
+
+    if (ret == 0) {
+        /* Header frame followed by a data frame of 4 bytes */
+        bytes = h3zero_create_request_header_frame_qpack(&encoder, 0, bytes, stream + sizeof(stream) - 6,
+            (uint8_t const*)path, strlen(path), "example.com", "test-agent", NULL, 0);
+        if (bytes == NULL || encoder.table.insert_count == 0) {
+            DBG_PRINTF("%s", "Cannot encode the blocking request");
+            ret = -1;
+        }
+        else {
+            stream[0] = h3zero_frame_header;
+            stream[1] = (uint8_t)(0x40 | ((bytes - stream - 3) >> 8));
+            stream[2] = (uint8_t)(bytes - stream - 3);
+            *bytes++ = h3zero_frame_data;
+            *bytes++ = 4;
+            memcpy(bytes, "data", 4);
+            bytes += 4;
+        }
+    }
+
+    if (ret == 0) {
+        /* The entries are not received yet, the stream is blocked */
+        stream_state.qpack_decoder = &decoder;
+        stream_state.stream_id = 0;
+        p = stream;
+        while (p != NULL && p < bytes) {
+            p = h3zero_parse_data_stream(p, bytes, &stream_state, &available_data, &error_found);
+        }
+        if (p == NULL || !stream_state.is_blocked || stream_state.header_found || decoder.nb_blocked_streams != 1) {
+            DBG_PRINTF("Stream not blocked, error 0x%x", error_found);
+            ret = -1;
+        }
+        else if (h3zero_data_stream_unblock(&stream_state, &kept_length, &error_found) != NULL || !stream_state.is_blocked) {
+            DBG_PRINTF("%s", "Stream unblocked too early");
+            ret = -1;
+        }
+    }
+
+    if (ret == 0 && (ret = h3zero_qpack_test_exchange(&encoder, &decoder, 1, 0)) == 0) {
+        kept = h3zero_data_stream_unblock(&stream_state, &kept_length, &error_found);
+        if (kept == NULL || stream_state.is_blocked || !stream_state.header_found || decoder.nb_blocked_streams != 0 ||
+            stream_state.header.path_length != strlen(path) || memcmp(stream_state.header.path, path, strlen(path)) != 0) {
+            DBG_PRINTF("Stream not unblocked, error 0x%x", error_found);
+            ret = -1;
+        }
+        else {
+            p = kept;
+            while (p != NULL && p < kept + kept_length) {
+                p = h3zero_parse_data_stream(p, kept + kept_length, &stream_state, &available_data, &error_found);
+                if (p != NULL && available_data > 0) {
+                    if (available_data != 4 || memcmp(p, "data", 4) != 0) {
+                        p = NULL;
+                    }
+                    else {
+                        p += available_data;
+                        nb_data += available_data;
+                    }
+                }
+            }
+            if (p == NULL || nb_data != 4) {
+                DBG_PRINTF("%s", "Data not found after unblocking");
+                ret = -1;
+            }
+        }
+        if (kept != NULL) {
+            free(kept);
+        }
+    }
+
+    if (ret == 0 && (ret = h3zero_qpack_test_exchange(&encoder, &decoder, 0, 1)) == 0 && encoder.first_section != NULL) {
+        DBG_PRINTF("%s", "Section not acknowledged");
+        ret = -1;
+    }
+    h3zero_delete_data_stream_state(&stream_state);
+
+    if (ret == 0) {
+        /* Blocked stream reset before the entries arrive */
+        h3zero_qpack_field_t extra;
+        extra.name = (uint8_t const*)"x-cancelled";
+        extra.name_length = strlen("x-cancelled");
+        extra.value = (uint8_t const*)"yes";
+        extra.value_length = 3;
+
+        memset(&stream_state, 0, sizeof(stream_state));
+        stream_state.qpack_decoder = &decoder;
+        stream_state.stream_id = 4;
+        bytes = h3zero_create_request_header_frame_qpack(&encoder, 4, stream + 3, stream + sizeof(stream),
+            (uint8_t const*)path, strlen(path), "example.com", "test-agent", &extra, 1);
+        if (bytes == NULL) {
+            ret = -1;
+        }
+        else {
+            stream[0] = h3zero_frame_header;
+            stream[1] = (uint8_t)(0x40 | ((bytes - stream - 3) >> 8));
+            stream[2] = (uint8_t)(bytes - stream - 3);
+            p = stream;
+            while (p != NULL && p < bytes) {
+                p = h3zero_parse_data_stream(p, bytes, &stream_state, &available_data, &error_found);
+            }
+            if (p != bytes || !stream_state.is_blocked) {
+                DBG_PRINTF("%s", "Second stream not blocked");
+                ret = -1;
+            }
+        }
+        h3zero_delete_data_stream_state(&stream_state);
+        if (ret == 0 && (decoder.nb_blocked_streams != 0 || decoder.decoder_stream.length == 0 ||
+            decoder.decoder_stream.bytes[0] != 0x44)) {
+            DBG_PRINTF("%s", "Stream cancellation not sent");
+            ret = -1;
+        }
+        if (ret == 0 && (ret = h3zero_qpack_test_exchange(&encoder, &decoder, 1, 1)) == 0 && encoder.first_section != NULL) {
+            DBG_PRINTF("%s", "Section not removed after cancellation");
+            ret = -1;
+        }
+    }
+
+    h3zero_qpack_encoder_release(&encoder);
+    h3zero_qpack_decoder_release(&decoder);
+    return ret;
+}
+
+static int h3zero_qpack_bad_stream_test()
+{
+    int ret = 0;
+    h3zero_qpack_encoder_t encoder;
+    h3zero_qpack_decoder_t decoder;
+    /* Capacity above the maximum, duplicate of a missing entry */
+    uint8_t const bad_capacity[] = { 0x3F, 0xFF, 0x7F };
+    uint8_t const bad_duplicate[] = { 0x00 };
+    /* Acknowledgement of a section that was never sent */
+    uint8_t const bad_ack[] = { 0x84 };
+
+    if (h3zero_qpack_decoder_init(&decoder, 4096, 16) != 0 ||
+        h3zero_qpack_receive_encoder_stream(&decoder, bad_capacity, sizeof(bad_capacity)) != H3ZERO_QPACK_ENCODER_STREAM_ERROR) {
+        DBG_PRINTF("%s", "Excessive capacity not detected");
+        ret = -1;
+    }
+    h3zero_qpack_decoder_release(&decoder);
+
+    if (ret == 0 && (h3zero_qpack_decoder_init(&decoder, 4096, 16) != 0 ||
+        h3zero_qpack_receive_encoder_stream(&decoder, bad_duplicate, sizeof(bad_duplicate)) != H3ZERO_QPACK_ENCODER_STREAM_ERROR)) {
+        DBG_PRINTF("%s", "Bad duplicate not detected");
+        ret = -1;
+    }
+    h3zero_qpack_decoder_release(&decoder);
+
+    if (ret == 0 && (h3zero_qpack_encoder_init(&encoder, 4096) != 0 ||
+        h3zero_qpack_receive_decoder_stream(&encoder, bad_ack, sizeof(bad_ack)) != H3ZERO_QPACK_DECODER_STREAM_ERROR)) {
+        DBG_PRINTF("%s", "Bad acknowledgement not detected");
+        ret = -1;
+    }
+    h3zero_qpack_encoder_release(&encoder);
+
+    return ret;
+}
+
+int h3zero_qpack_dynamic_test()
+{
+    int ret = h3zero_qpack_settings_test();
+
+    if (ret == 0) {
+        ret = h3zero_qpack_static_only_test();
+    }
+
+    if (ret == 0) {
+        ret = h3zero_qpack_requests_test(H3ZERO_QPACK_MAX_TABLE_CAPACITY_DEFAULT, 100, 0);
+    }
+
+    if (ret == 0) {
+        /* Small table, with frequent evictions */
+        ret = h3zero_qpack_requests_test(512, 100, 1);
+    }
+
+    if (ret == 0) {
+        ret = h3zero_qpack_blocked_test();
+    }
+
+    if (ret == 0) {
+        ret = h3zero_qpack_bad_stream_test();
+    }
+
+    return ret;
+}
+
 
 /*
  * Test the scenario parsing function
@@ -0,0 +1,590 @@
+/* Handshake benchmark.
+ *
+ * Opens connections at a fixed rate (in simulated time) from one client
+ * context to one server context, over simulated links. Each client closes its
+ * connection as soon as the handshake completes, which mimics short-lived
+ * clients. The benchmark measures the CPU cost of connection setup on the
+ * server, broken down by phase:
+ *
+ * - TLS key exchange, by wrapping the key exchange algorithms of the server TLS context,
+ * - certificate signing, by wrapping the server's sign certificate callback,
+ * - packet protection, by installing a timing packet protection provider,
+ * - context creation and hash table insertion, using quic->setup_profile.
+ *
+ * The remainder is reported as "other": TLS key schedule and transcript,
+ * frame processing, packet formatting. The benchmark also reports the heap
+ * memory allocated when a half-open connection is created, if the
+ * platform allows it.
+ */
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <picotls.h>
+#include "picoquic_utils.h"
+#include "picoquic_internal.h"
+#include "tls_api.h"
+#include "picoquictest_internal.h"
+
+#if defined(__GLIBC__) && ((__GLIBC__ > 2) || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+#include <malloc.h>
+#define HANDSHAKE_BENCH_HEAP_USED() ((uint64_t)mallinfo2().uordblks)
+#define HANDSHAKE_BENCH_HAS_HEAP 1
+#else
+#define HANDSHAKE_BENCH_HEAP_USED() 0
+#define HANDSHAKE_BENCH_HAS_HEAP 0
+#endif
+
+#define HANDSHAKE_BENCH_ALPN "hsbench"
+#define HANDSHAKE_BENCH_MAX_KEX 8
+
+typedef struct st_handshake_bench_phase_t {
+    uint64_t cycles;
+    uint64_t count;
+} handshake_bench_phase_t;
+
+typedef struct st_handshake_bench_kex_t {
+    struct st_ptls_key_exchange_algorithm_t super;
+    ptls_key_exchange_algorithm_t* original;
+    handshake_bench_phase_t* phase;
+} handshake_bench_kex_t;
+
+typedef struct st_handshake_bench_signer_t {
+    ptls_sign_certificate_t super;
+    ptls_sign_certificate_t* original;
+    handshake_bench_phase_t* phase;
+} handshake_bench_signer_t;
+
+typedef struct st_handshake_bench_ctx_t {
+    uint64_t simulated_time;
+    picoquic_quic_t* qserver;
+    picoquic_quic_t* qclient;
+    struct sockaddr_in server_addr;
+    struct sockaddr_in client_addr;
+    picoquictest_sim_link_t* link_to_clients;
+    picoquictest_sim_link_t* link_to_server;
+    /* Connection schedule */
+    uint64_t nb_cnx_target;
+    uint64_t nb_cnx_created;
+    uint64_t nb_cnx_reaped;
+    uint64_t nb_handshakes;
+    uint64_t cnx_interval;
+    uint64_t next_cnx_time;
+    uint64_t sum_handshake_delay;
+    picoquic_cnx_t** c_cnx;
+    /* Instrumentation */
+    picoquic_setup_profile_t setup_profile;
+    handshake_bench_phase_t key_exchange;
+    handshake_bench_phase_t sign;
+    handshake_bench_phase_t protect;
+    handshake_bench_phase_t server;
+    handshake_bench_phase_t client;
+    handshake_bench_kex_t kex[HANDSHAKE_BENCH_MAX_KEX];
+    ptls_key_exchange_algorithm_t* kex_list[HANDSHAKE_BENCH_MAX_KEX + 1];
+    ptls_key_exchange_algorithm_t** original_kex_list;
+    handshake_bench_signer_t signer;
+    /* Memory per half open connection */
+    uint64_t nb_half_open_samples;
+    uint64_t sum_half_open_memory;
+    uint64_t max_half_open_memory;
+    uint32_t max_half_open;
+} handshake_bench_ctx_t;
+
+/* Instrumentation wrappers */
+static int handshake_bench_kex_exchange(ptls_key_exchange_algorithm_t* algo, ptls_iovec_t* pubkey,
+    ptls_iovec_t* secret, ptls_iovec_t peerkey)
+{
+    const handshake_bench_kex_t* kex = (const handshake_bench_kex_t*)algo;
+    uint64_t start = picoquic_cpu_cycles();
+    int ret = kex->original->exchange(kex->original, pubkey, secret, peerkey);
+
+    kex->phase->cycles += picoquic_cpu_cycles() - start;
+    kex->phase->count++;
+
+    return ret;
+}
+
+static int handshake_bench_sign_certificate(ptls_sign_certificate_t* self, ptls_t* tls, ptls_async_job_t** async,
+    uint16_t* selected_algorithm, ptls_buffer_t* output, ptls_iovec_t input, const uint16_t* algorithms, size_t num_algorithms)
+{
+    handshake_bench_signer_t* signer = (handshake_bench_signer_t*)((char*)self - offsetof(handshake_bench_signer_t, super));
+    uint64_t start = picoquic_cpu_cycles();
+    int ret = signer->original->cb(signer->original, tls, async, selected_algorithm, output, input, algorithms, num_algorithms);
+
+    signer->phase->cycles += picoquic_cpu_cycles() - start;
+    signer->phase->count++;
+
+    return ret;
+}
+
+/* The provider context is the phase in which packet protection is accounted.
+ * It is passed to the create function through a static variable, because the
+ * provider parameter is a string. */
+static handshake_bench_phase_t* handshake_bench_protect_phase = NULL;
+
+static void* handshake_bench_protect_create(picoquic_quic_t* quic, char const* param)
+{
+    return handshake_bench_protect_phase;
+}
+
+static size_t handshake_bench_protect(void* provider_ctx, picoquic_aead_job_t* job)
+{
+    handshake_bench_phase_t* phase = (handshake_bench_phase_t*)provider_ctx;
+    uint64_t start = picoquic_cpu_cycles();
+    size_t result = picoquic_software_crypto_process(NULL, job);
+
+    phase->cycles += picoquic_cpu_cycles() - start;
+    phase->count++;
+
+    return result;
+}
+
+static picoquic_crypto_provider_t handshake_bench_crypto_provider = {
+    "hsbench",
+    handshake_bench_protect_create,
+    NULL,
+    handshake_bench_protect,
+    NULL,
+    NULL
+};
+
+static int handshake_bench_instrument(handshake_bench_ctx_t* bench_ctx)
+{
+    int ret = 0;
+    ptls_context_t* tls_ctx = (ptls_context_t*)bench_ctx->qserver->tls_master_ctx;
+    size_t nb_kex = 0;
+
+    bench_ctx->qserver->setup_profile = &bench_ctx->setup_profile;
+
+    if (tls_ctx->key_exchanges != NULL) {
+        while (nb_kex < HANDSHAKE_BENCH_MAX_KEX && tls_ctx->key_exchanges[nb_kex] != NULL) {
+            handshake_bench_kex_t* kex = &bench_ctx->kex[nb_kex];
+            kex->super = *tls_ctx->key_exchanges[nb_kex];
+            kex->super.exchange = handshake_bench_kex_exchange;
+            kex->original = tls_ctx->key_exchanges[nb_kex];
+            kex->phase = &bench_ctx->key_exchange;
+            bench_ctx->kex_list[nb_kex] = &kex->super;
+            nb_kex++;
+        }
+        bench_ctx->kex_list[nb_kex] = NULL;
+        bench_ctx->original_kex_list = tls_ctx->key_exchanges;
+        tls_ctx->key_exchanges = bench_ctx->kex_list;
+    }
+
+    if (tls_ctx->sign_certificate != NULL) {
+        bench_ctx->signer.super.cb = handshake_bench_sign_certificate;
+        bench_ctx->signer.original = tls_ctx->sign_certificate;
+        bench_ctx->signer.phase = &bench_ctx->sign;
+        tls_ctx->sign_certificate = &bench_ctx->signer.super;
+    }
+
+    handshake_bench_protect_phase = &bench_ctx->protect;
+    if (picoquic_set_crypto_provider(bench_ctx->qserver, &handshake_bench_crypto_provider, NULL) != 0) {
+        ret = -1;
+    }
+    handshake_bench_protect_phase = NULL;
+
+    return ret;
+}
+
+/* Restore the original TLS callbacks before the server context is freed,
+ * so the signer is disposed of properly. */
+static void handshake_bench_uninstrument(handshake_bench_ctx_t* bench_ctx)
+{
+    ptls_context_t* tls_ctx = (ptls_context_t*)bench_ctx->qserver->tls_master_ctx;
+
+    if (bench_ctx->original_kex_list != NULL) {
+        tls_ctx->key_exchanges = bench_ctx->original_kex_list;
+        bench_ctx->original_kex_list = NULL;
+    }
+    if (bench_ctx->signer.original != NULL) {
+        tls_ctx->sign_certificate = bench_ctx->signer.original;
+        bench_ctx->signer.original = NULL;
+    }
+    (void)picoquic_set_crypto_provider(bench_ctx->qserver, NULL, NULL);
+    bench_ctx->qserver->setup_profile = NULL;
+}
+
+/* Callbacks. The client closes the connection as soon as it is ready.
+ * The server does not need to do anything. */
+static int handshake_bench_client_callback(picoquic_cnx_t* cnx,
+    uint64_t stream_id, uint8_t* bytes, size_t length,
+    picoquic_call_back_event_t fin_or_event, void* callback_ctx, void* v_stream_ctx)
+{
+    handshake_bench_ctx_t* bench_ctx = (handshake_bench_ctx_t*)callback_ctx;
+    int ret = 0;
+
+    if (fin_or_event == picoquic_callback_ready && bench_ctx != NULL) {
+        bench_ctx->nb_handshakes++;
+        bench_ctx->sum_handshake_delay += bench_ctx->simulated_time - cnx->start_time;
+        picoquic_set_callback(cnx, NULL, NULL);
+        ret = picoquic_close(cnx, 0);
+    }
+
+    return ret;
+}
+
+static int handshake_bench_server_callback(picoquic_cnx_t* cnx,
+    uint64_t stream_id, uint8_t* bytes, size_t length,
+    picoquic_call_back_event_t fin_or_event, void* callback_ctx, void* v_stream_ctx)
+{
+    return 0;
+}
+
+static int handshake_bench_create_client_cnx(handshake_bench_ctx_t* bench_ctx)
+{
+    int ret = 0;
+    picoquic_cnx_t* cnx = picoquic_create_cnx(
+        bench_ctx->qclient, picoquic_null_connection_id, picoquic_null_connection_id,
+        (struct sockaddr*)&bench_ctx->server_addr, bench_ctx->simulated_time, 0,
+        PICOQUIC_TEST_SNI, HANDSHAKE_BENCH_ALPN, 1);
+
+    if (cnx == NULL) {
+        ret = -1;
+    }
+    else {
+        uint64_t start = picoquic_cpu_cycles();
+
+        picoquic_set_callback(cnx, handshake_bench_client_callback, bench_ctx);
+        bench_ctx->c_cnx[bench_ctx->nb_cnx_created++] = cnx;
+        ret = picoquic_start_client_cnx(cnx);
+        bench_ctx->client.cycles += picoquic_cpu_cycles() - start;
+    }
+
+    /* Delete the client connections that are fully closed, oldest first */
+    while (bench_ctx->nb_cnx_reaped < bench_ctx->nb_cnx_created &&
+        bench_ctx->c_cnx[bench_ctx->nb_cnx_reaped]->cnx_state == picoquic_state_disconnected) {
+        picoquic_delete_cnx(bench_ctx->c_cnx[bench_ctx->nb_cnx_reaped]);
+        bench_ctx->c_cnx[bench_ctx->nb_cnx_reaped] = NULL;
+        bench_ctx->nb_cnx_reaped++;
+    }
+
+    return ret;
+}
+
+static int handshake_bench_server_arrival(handshake_bench_ctx_t* bench_ctx)
+{
+    int ret = 0;
+    picoquictest_sim_packet_t* packet =
+        picoquictest_sim_link_dequeue(bench_ctx->link_to_server, bench_ctx->simulated_time);
+
+    if (packet != NULL) {
+        uint32_t nb_cnx_before = bench_ctx->qserver->current_number_connections;
+        uint64_t heap_before = HANDSHAKE_BENCH_HEAP_USED();
+        uint64_t start = picoquic_cpu_cycles();
+
+        ret = picoquic_incoming_packet(bench_ctx->qserver, packet->bytes,
+            (uint32_t)packet->length,
+            (struct sockaddr*)&packet->addr_from,
+            (struct sockaddr*)&packet->addr_to, 0, 0, bench_ctx->simulated_time);
+        bench_ctx->server.cycles += picoquic_cpu_cycles() - start;
+
+        if (bench_ctx->qserver->current_number_connections > nb_cnx_before) {
+            /* A half open connection was created while processing this packet */
+            uint64_t heap_after = HANDSHAKE_BENCH_HEAP_USED();
+            uint64_t memory = (heap_after > heap_before) ? heap_after - heap_before : 0;
+
+            bench_ctx->nb_half_open_samples++;
+            bench_ctx->sum_half_open_memory += memory;
+            if (memory > bench_ctx->max_half_open_memory) {
+                bench_ctx->max_half_open_memory = memory;
+            }
+        }
+        if (bench_ctx->qserver->current_number_half_open > bench_ctx->max_half_open) {
+            bench_ctx->max_half_open = bench_ctx->qserver->current_number_half_open;
+        }
+        free(packet);
+    }
+
+    return ret;
+}
+
+static int handshake_bench_client_arrival(handshake_bench_ctx_t* bench_ctx)
+{
+    int ret = 0;
+    picoquictest_sim_packet_t* packet =
+        picoquictest_sim_link_dequeue(bench_ctx->link_to_clients, bench_ctx->simulated_time);
+
+    if (packet != NULL) {
+        uint64_t start = picoquic_cpu_cycles();
+
+        ret = picoquic_incoming_packet(bench_ctx->qclient, packet->bytes,
+            (uint32_t)packet->length,
+            (struct sockaddr*)&packet->addr_from,
+            (struct sockaddr*)&packet->addr_to, 0, 0, bench_ctx->simulated_time);
+        bench_ctx->client.cycles += picoquic_cpu_cycles() - start;
+        free(packet);
+    }
+
+    return ret;
+}
+
+static int handshake_bench_prepare(picoquic_quic_t* quic, picoquictest_sim_link_t* link,
+    struct sockaddr* default_source, uint64_t current_time, handshake_bench_phase_t* phase)
+{
+    int ret = 0;
+    picoquictest_sim_packet_t* packet = picoquictest_sim_link_create_packet();
+
+    if (packet == NULL) {
+        ret = -1;
+    }
+    else {
+        picoquic_connection_id_t log_cid;
+        picoquic_cnx_t* last_cnx;
+        int if_index = 0;
+        uint64_t start = picoquic_cpu_cycles();
+
+        ret = picoquic_prepare_next_packet(quic, current_time, packet->bytes,
+            PICOQUIC_MAX_PACKET_SIZE, &packet->length,
+            &packet->addr_to, &packet->addr_from, &if_index, &log_cid, &last_cnx);
+        phase->cycles += picoquic_cpu_cycles() - start;
+
+        if (ret == 0 && packet->length > 0) {
+            if (packet->addr_from.ss_family == AF_UNSPEC) {
+                picoquic_store_addr(&packet->addr_from, default_source);
+            }
+            picoquictest_sim_link_submit(link, packet, current_time);
+        }
+        else {
+            free(packet);
+        }
+    }
+
+    return ret;
+}
+
+/* Execute the next event: connection creation, packet arrival or departure
+ * at client or server, whichever comes first. */
+static int handshake_bench_loop_step(handshake_bench_ctx_t* bench_ctx)
+{
+    int ret = 0;
+    int next_event = -1;
+    uint64_t next_time = bench_ctx->next_cnx_time;
+    uint64_t client_wake = picoquic_get_next_wake_time(bench_ctx->qclient, bench_ctx->simulated_time);
+    uint64_t server_wake = picoquic_get_next_wake_time(bench_ctx->qserver, bench_ctx->simulated_time);
+
+    if (next_time < UINT64_MAX) {
+        next_event = 0;
+    }
+    if (bench_ctx->link_to_clients->first_packet != NULL &&
+        bench_ctx->link_to_clients->first_packet->arrival_time < next_time) {
+        next_event = 1;
+        next_time = bench_ctx->link_to_clients->first_packet->arrival_time;
+    }
+    if (client_wake < next_time) {
+        next_event = 2;
+        next_time = client_wake;
+    }
+    if (bench_ctx->link_to_server->first_packet != NULL &&
+        bench_ctx->link_to_server->first_packet->arrival_time < next_time) {
+        next_event = 3;
+        next_time = bench_ctx->link_to_server->first_packet->arrival_time;
+    }
+    if (server_wake < next_time) {
+        next_event = 4;
+        next_time = server_wake;
+    }
+    if (next_time > bench_ctx->simulated_time && next_time < UINT64_MAX) {
+        bench_ctx->simulated_time = next_time;
+    }
+
+    switch (next_event) {
+    case 0:
+        ret = handshake_bench_create_client_cnx(bench_ctx);
+        bench_ctx->next_cnx_time = (bench_ctx->nb_cnx_created >= bench_ctx->nb_cnx_target) ?
+            UINT64_MAX : bench_ctx->next_cnx_time + bench_ctx->cnx_interval;
+        break;
+    case 1:
+        ret = handshake_bench_client_arrival(bench_ctx);
+        break;
+    case 2:
+        ret = handshake_bench_prepare(bench_ctx->qclient, bench_ctx->link_to_server,
+            (struct sockaddr*)&bench_ctx->client_addr, bench_ctx->simulated_time, &bench_ctx->client);
+        break;
+    case 3:
+        ret = handshake_bench_server_arrival(bench_ctx);
+        break;
+    case 4:
+        ret = handshake_bench_prepare(bench_ctx->qserver, bench_ctx->link_to_clients,
+            (struct sockaddr*)&bench_ctx->server_addr, bench_ctx->simulated_time, &bench_ctx->server);
+        break;
+    default:
+        /* Nothing left to do */
+        ret = -1;
+        break;
+    }
+
+    return ret;
+}
+
+static void handshake_bench_delete_ctx(handshake_bench_ctx_t* bench_ctx)
+{
+    if (bench_ctx->link_to_clients != NULL) {
+        picoquictest_sim_link_delete(bench_ctx->link_to_clients);
+    }
+    if (bench_ctx->link_to_server != NULL) {
+        picoquictest_sim_link_delete(bench_ctx->link_to_server);
+    }
+    if (bench_ctx->qserver != NULL) {
+        handshake_bench_uninstrument(bench_ctx);
+        picoquic_free(bench_ctx->qserver);
+    }
+    if (bench_ctx->qclient != NULL) {
+        picoquic_free(bench_ctx->qclient);
+    }
+    if (bench_ctx->c_cnx != NULL) {
+        free(bench_ctx->c_cnx);
+    }
+    free(bench_ctx);
+}
+
+static handshake_bench_ctx_t* handshake_bench_create_ctx(uint64_t nb_connections, uint64_t cnx_per_second)
+{
+    handshake_bench_ctx_t* bench_ctx = (handshake_bench_ctx_t*)malloc(sizeof(handshake_bench_ctx_t));
+
+    if (bench_ctx != NULL) {
+        int ret = 0;
+        char test_server_cert_file[512];
+        char test_server_key_file[512];
+        /* Size the contexts for the connections that can be present at the same time,
+         * i.e., those in handshake or closing, allowing a few seconds of lifetime. */
+        uint64_t max_cnx = cnx_per_second * 4 + 1024;
+        uint32_t max_server_cnx = (uint32_t)((max_cnx < nb_connections + 16) ? max_cnx : nb_connections + 16);
+
+        memset(bench_ctx, 0, sizeof(handshake_bench_ctx_t));
+        picoquic_set_test_address(&bench_ctx->client_addr, 0x08080808, 12345);
+        picoquic_set_test_address(&bench_ctx->server_addr, 0x01010101, 4433);
+        bench_ctx->nb_cnx_target = nb_connections;
+        bench_ctx->cnx_interval = 1000000 / cnx_per_second;
+        if (bench_ctx->cnx_interval == 0) {
+            bench_ctx->cnx_interval = 1;
+        }
+        bench_ctx->c_cnx = (picoquic_cnx_t**)malloc(sizeof(picoquic_cnx_t*) * (size_t)nb_connections);
+        if (bench_ctx->c_cnx == NULL) {
+            ret = -1;
+        }
+        else {
+            ret = picoquic_get_input_path(test_server_cert_file, sizeof(test_server_cert_file), picoquic_solution_dir, PICOQUIC_TEST_FILE_SERVER_CERT);
+        }
+        if (ret == 0) {
+            ret = picoquic_get_input_path(test_server_key_file, sizeof(test_server_key_file), picoquic_solution_dir, PICOQUIC_TEST_FILE_SERVER_KEY);
+        }
+        if (ret == 0) {
+            bench_ctx->qclient = picoquic_create(max_server_cnx, NULL, NULL,
+                NULL, HANDSHAKE_BENCH_ALPN, NULL, NULL, NULL, NULL,
+                NULL, bench_ctx->simulated_time, &bench_ctx->simulated_time,
+                NULL, NULL, 0);
+            bench_ctx->qserver = picoquic_create(max_server_cnx, test_server_cert_file, test_server_key_file,
+                NULL, HANDSHAKE_BENCH_ALPN, handshake_bench_server_callback, bench_ctx, NULL, NULL,
+                NULL, bench_ctx->simulated_time, &bench_ctx->simulated_time,
+                NULL, NULL, 0);
+            bench_ctx->link_to_clients = picoquictest_sim_link_create(1.0, 10000, NULL, 20000, 0);
+            bench_ctx->link_to_server = picoquictest_sim_link_create(1.0, 10000, NULL, 20000, 0);
+            if (bench_ctx->qclient == NULL || bench_ctx->qserver == NULL ||
+                bench_ctx->link_to_clients == NULL || bench_ctx->link_to_server == NULL) {
+                ret = -1;
+            }
+            else {
+                ret = handshake_bench_instrument(bench_ctx);
+            }
+        }
+
+        if (ret != 0) {
+            handshake_bench_delete_ctx(bench_ctx);
+            bench_ctx = NULL;
+        }
+    }
+
+    return bench_ctx;
+}
+
+static void handshake_bench_report_phase(FILE* F, char const* phase_name, uint64_t cycles, uint64_t nb_handshakes, uint64_t total)
+{
+    fprintf(F, "    %-20s %12" PRIu64 " cycles/handshake (%5.1f%%)\n", phase_name, cycles / nb_handshakes,
+        (total > 0) ? (100.0 * (double)cycles) / (double)total : 0.0);
+}
+
+static void handshake_bench_report(handshake_bench_ctx_t* bench_ctx, FILE* F, uint64_t wall_time_elapsed, uint64_t cycles_elapsed)
+{
+    uint64_t nb = bench_ctx->nb_handshakes;
+    uint64_t server_total = bench_ctx->server.cycles;
+    uint64_t accounted = bench_ctx->key_exchange.cycles + bench_ctx->sign.cycles + bench_ctx->protect.cycles +
+        bench_ctx->setup_profile.cnx_create_cycles + bench_ctx->setup_profile.hash_insert_cycles;
+    double cycles_per_second = (wall_time_elapsed > 0) ? ((double)cycles_elapsed * 1000000.0) / (double)wall_time_elapsed : 0;
+
+    fprintf(F, "Handshake benchmark: %" PRIu64 " handshakes in %fs (wall time), %fs (simulated).\n",
+        nb, ((double)wall_time_elapsed) / 1000000.0, ((double)bench_ctx->simulated_time) / 1000000.0);
+    fprintf(F, "    Client and server: %.0f handshakes/sec\n",
+        (wall_time_elapsed > 0) ? ((double)nb * 1000000.0) / (double)wall_time_elapsed : 0.0);
+    fprintf(F, "    Server only:       %.0f handshakes/sec (%" PRIu64 " cycles/handshake, %.0f cycles/sec)\n",
+        (server_total > 0) ? ((double)nb * cycles_per_second) / (double)server_total : 0.0,
+        server_total / nb, cycles_per_second);
+    fprintf(F, "    Average handshake delay: %fs (simulated)\n",
+        ((double)bench_ctx->sum_handshake_delay) / ((double)nb * 1000000.0));
+    fprintf(F, "Server cost per handshake, by phase:\n");
+    handshake_bench_report_phase(F, "Key exchange", bench_ctx->key_exchange.cycles, nb, server_total);
+    handshake_bench_report_phase(F, "Certificate signing", bench_ctx->sign.cycles, nb, server_total);
+    handshake_bench_report_phase(F, "Packet protection", bench_ctx->protect.cycles, nb, server_total);
+    handshake_bench_report_phase(F, "Context creation", bench_ctx->setup_profile.cnx_create_cycles, nb, server_total);
+    handshake_bench_report_phase(F, "Hash table insert", bench_ctx->setup_profile.hash_insert_cycles, nb, server_total);
+    handshake_bench_report_phase(F, "Other", (server_total > accounted) ? server_total - accounted : 0, nb, server_total);
+    fprintf(F, "    (%" PRIu64 " key exchanges, %" PRIu64 " signatures, %" PRIu64 " AEAD operations, %" PRIu64 " hash inserts)\n",
+        bench_ctx->key_exchange.count, bench_ctx->sign.count, bench_ctx->protect.count, bench_ctx->setup_profile.nb_hash_insert);
+    if (HANDSHAKE_BENCH_HAS_HEAP && bench_ctx->nb_half_open_samples > 0) {
+        fprintf(F, "Memory per half open connection: %" PRIu64 " bytes average, %" PRIu64 " bytes peak, %u half open peak.\n",
+            bench_ctx->sum_half_open_memory / bench_ctx->nb_half_open_samples, bench_ctx->max_half_open_memory,
+            bench_ctx->max_half_open);
+    }
+    else {
+        fprintf(F, "Memory per half open connection: not available, %u half open peak.\n", bench_ctx->max_half_open);
+    }
+}
+
+int handshake_bench_do_test(uint64_t nb_connections, uint64_t cnx_per_second, FILE* F)
+{
+    int ret = 0;
+    handshake_bench_ctx_t* bench_ctx = NULL;
+
+    if (nb_connections == 0 || cnx_per_second == 0) {
+        ret = -1;
+    }
+    else if ((bench_ctx = handshake_bench_create_ctx(nb_connections, cnx_per_second)) == NULL) {
+        ret = -1;
+    }
+    else {
+        /* Leave time for the last handshakes to complete */
+        uint64_t max_time = nb_connections * bench_ctx->cnx_interval + 30000000;
+        uint64_t wall_time_start = picoquic_current_time();
+        uint64_t cycles_start = picoquic_cpu_cycles();
+
+        while (ret == 0 && bench_ctx->nb_handshakes < nb_connections && bench_ctx->simulated_time < max_time) {
+            ret = handshake_bench_loop_step(bench_ctx);
+        }
+
+        if (ret == 0 && bench_ctx->nb_handshakes != nb_connections) {
+            DBG_PRINTF("Expected %" PRIu64 " handshakes, got %" PRIu64, nb_connections, bench_ctx->nb_handshakes);
+            ret = -1;
+        }
+        else if (ret == 0 && (bench_ctx->key_exchange.count == 0 || bench_ctx->sign.count == 0 ||
+            bench_ctx->protect.count == 0 || bench_ctx->setup_profile.nb_cnx_create == 0)) {
+            DBG_PRINTF("%s", "Some phases were not instrumented");
+            ret = -1;
+        }
+        else if (ret == 0 && F != NULL) {
+            handshake_bench_report(bench_ctx, F, picoquic_current_time() - wall_time_start,
+                picoquic_cpu_cycles() - cycles_start);
+        }
+
+        handshake_bench_delete_ctx(bench_ctx);
+    }
+
+    return ret;
+}
+
+/* The unit test runs the benchmark with a small number of connections,
+ * to check that the harness and the instrumentation work. */
+int handshake_bench_test()
+{
+    return handshake_bench_do_test(64, 100, NULL);
+}
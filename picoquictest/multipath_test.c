@@ -412,7 +412,10 @@ typedef enum {
     multipath_test_break1,
     multipath_test_back1,
     multipath_test_perf,
-    multipath_test_abandon
+    multipath_test_abandon,
+    multipath_test_perf_minrtt,
+    multipath_test_perf_weighted,
+    multipath_test_perf_ecf
 } multipath_test_enum_t;
 
 int multipath_test_one(uint64_t max_completion_microsec, multipath_test_enum_t test_id, int is_simple_multipath)
@@ -424,12 +427,14 @@ int multipath_test_one(uint64_t max_completion_microsec, multipath_test_enum_t t
     picoquic_tp_t server_parameters;
     uint64_t original_r_cid_sequence = 1;
     size_t send_buffer_size = 0;
+    int is_perf_test = (test_id == multipath_test_perf || test_id == multipath_test_perf_minrtt ||
+        test_id == multipath_test_perf_weighted || test_id == multipath_test_perf_ecf);
     int ret;
 
     initial_cid.id[2] = (int)test_id;
     initial_cid.id[3] = is_simple_multipath;
 
-    if (test_id == multipath_test_perf) {
+    if (is_perf_test) {
         send_buffer_size = 65536;
     }
 
@@ -449,10 +454,19 @@ int multipath_test_one(uint64_t max_completion_microsec, multipath_test_enum_t t
              * or to simulate a long transfer and test broken path detection or repair */
             multipath_test_sat_links(test_ctx, 0);
         }
-        else if (test_id == multipath_test_perf) {
+        else if (is_perf_test) {
             multipath_test_perf_links(test_ctx, 0);
             picoquic_set_default_congestion_algorithm(test_ctx->qserver, picoquic_bbr_algorithm);
         }
+        if (test_id == multipath_test_perf_minrtt) {
+            picoquic_set_default_path_scheduler(test_ctx->qserver, picoquic_minrtt_path_scheduler);
+        }
+        else if (test_id == multipath_test_perf_weighted) {
+            picoquic_set_default_path_scheduler(test_ctx->qserver, picoquic_weighted_path_scheduler);
+        }
+        else if (test_id == multipath_test_perf_ecf) {
+            picoquic_set_default_path_scheduler(test_ctx->qserver, picoquic_ecf_path_scheduler);
+        }
         test_ctx->c_to_s_link->queue_delay_max = 2 * test_ctx->c_to_s_link->microsec_latency;
         test_ctx->s_to_c_link->queue_delay_max = 2 * test_ctx->s_to_c_link->microsec_latency;
 
@@ -511,7 +525,7 @@ int multipath_test_one(uint64_t max_completion_microsec, multipath_test_enum_t t
 
     /* Prepare to send data */
     if (ret == 0) {
-        if (test_id == multipath_test_sat_plus || test_id == multipath_test_perf) {
+        if (test_id == multipath_test_sat_plus || is_perf_test) {
             ret = test_api_init_send_recv_scenario(test_ctx, test_scenario_multipath_long, sizeof(test_scenario_multipath_long));
         } else {
             ret = test_api_init_send_recv_scenario(test_ctx, test_scenario_multipath, sizeof(test_scenario_multipath));
@@ -530,7 +544,7 @@ int multipath_test_one(uint64_t max_completion_microsec, multipath_test_enum_t t
             /* Simulate an asymmetric "satellite and landline" scenario */
             multipath_test_sat_links(test_ctx, 1);
         }
-        else if (test_id == multipath_test_perf) {
+        else if (is_perf_test) {
             multipath_test_perf_links(test_ctx, 1);
         }
     }
@@ -635,6 +649,19 @@ int multipath_test_one(uint64_t max_completion_microsec, multipath_test_enum_t t
         }
     }
 
+    if (ret == 0 && (test_id == multipath_test_perf_minrtt || test_id == multipath_test_perf_weighted ||
+        test_id == multipath_test_perf_ecf)) {
+        /* The alternative schedulers shall carry a share of the data on each path */
+        for (int i = 0; ret == 0 && i < test_ctx->cnx_server->nb_paths; i++) {
+            picoquic_path_t* path_x = test_ctx->cnx_server->path[i];
+
+            if (path_x->delivered < 16 * (uint64_t)path_x->send_mtu) {
+                DBG_PRINTF("Server path %d delivered only %" PRIu64 " bytes\n", i, path_x->delivered);
+                ret = -1;
+            }
+        }
+    }
+
     if (ret == 0 && test_id == multipath_test_rotation) {
         if (test_ctx->cnx_server->nb_crypto_key_rotations == 0) {
             DBG_PRINTF("%s", "No key rotation observed.\n");
@@ -775,6 +802,243 @@ int multipath_perf_test()
     return  multipath_test_one(max_completion_microsec, multipath_test_perf, 0);
 }
 
+/* Test the alternative multipath schedulers in the wifi+lte scenario.
+ * All of them shall use both paths and complete in reasonable time. The
+ * share of data delivered on each path is checked in multipath_test_one.
+ */
+int multipath_minrtt_test()
+{
+    uint64_t max_completion_microsec = 1500000;
+
+    return  multipath_test_one(max_completion_microsec, multipath_test_perf_minrtt, 0);
+}
+
+int multipath_weighted_test()
+{
+    uint64_t max_completion_microsec = 1500000;
+
+    return  multipath_test_one(max_completion_microsec, multipath_test_perf_weighted, 0);
+}
+
+int multipath_ecf_test()
+{
+    uint64_t max_completion_microsec = 1500000;
+
+    return  multipath_test_one(max_completion_microsec, multipath_test_perf_ecf, 0);
+}
+
+/* Redundant scheduler. The server sends numbered datagrams on a two path
+ * connection. Each datagram shall be received twice by the client, once on
+ * each path, since the copies are only queued on the paths other than the one
+ * carrying the original. The queued copies shall be released once sent, and
+ * freed by picoquic_delete_redundant_datagrams, which is called when a path
+ * is deleted.
+ */
+#define MULTIPATH_REDUNDANT_NB_DATAGRAMS 32
+
+typedef struct st_multipath_redundant_ctx_t {
+    int nb_sent;
+    uint64_t next_send_time;
+    uint64_t send_interval;
+    int nb_received[MULTIPATH_REDUNDANT_NB_DATAGRAMS];
+} multipath_redundant_ctx_t;
+
+static int multipath_redundant_is_ready(multipath_redundant_ctx_t* rd_ctx, uint64_t current_time)
+{
+    return rd_ctx->nb_sent < MULTIPATH_REDUNDANT_NB_DATAGRAMS && current_time >= rd_ctx->next_send_time;
+}
+
+static int multipath_redundant_send(picoquic_cnx_t* cnx, uint8_t* bytes, size_t length, void* datagram_ctx)
+{
+    int ret = 0;
+    multipath_redundant_ctx_t* rd_ctx = (multipath_redundant_ctx_t*)datagram_ctx;
+    uint64_t current_time = picoquic_get_quic_time(picoquic_get_quic_ctx(cnx));
+
+    if (!cnx->client_mode && multipath_redundant_is_ready(rd_ctx, current_time)) {
+        uint8_t* buffer = picoquic_provide_datagram_buffer(bytes, 8);
+
+        if (buffer == NULL) {
+            ret = -1;
+        }
+        else {
+            picoformat_64(buffer, (uint64_t)rd_ctx->nb_sent);
+            rd_ctx->nb_sent++;
+            rd_ctx->next_send_time = current_time + rd_ctx->send_interval;
+        }
+    }
+    picoquic_mark_datagram_ready(cnx, !cnx->client_mode && multipath_redundant_is_ready(rd_ctx, current_time));
+
+    return ret;
+}
+
+static int multipath_redundant_recv(picoquic_cnx_t* cnx, uint8_t* bytes, size_t length, void* datagram_ctx)
+{
+    multipath_redundant_ctx_t* rd_ctx = (multipath_redundant_ctx_t*)datagram_ctx;
+
+    if (cnx->client_mode && length == 8) {
+        uint64_t dg_number = PICOPARSE_64(bytes);
+
+        if (dg_number < MULTIPATH_REDUNDANT_NB_DATAGRAMS) {
+            rd_ctx->nb_received[dg_number]++;
+        }
+    }
+
+    return 0;
+}
+
+static int multipath_redundant_check_queues(picoquic_test_tls_api_ctx_t* test_ctx)
+{
+    int ret = 0;
+
+    for (int i = 0; ret == 0 && i < test_ctx->cnx_server->nb_paths; i++) {
+        picoquic_path_t* path_x = test_ctx->cnx_server->path[i];
+
+        if (path_x->first_redundant_datagram != NULL || path_x->last_redundant_datagram != NULL ||
+            path_x->nb_redundant_datagrams != 0) {
+            DBG_PRINTF("Path %d still holds %d datagram copies\n", i, path_x->nb_redundant_datagrams);
+            ret = -1;
+        }
+    }
+
+    return ret;
+}
+
+int multipath_redundant_test()
+{
+    uint64_t simulated_time = 0;
+    uint64_t loss_mask = 0;
+    picoquic_test_tls_api_ctx_t* test_ctx = NULL;
+    picoquic_connection_id_t initial_cid = { {0x1b, 0x11, 0xed, 4, 5, 6, 7, 8}, 8 };
+    picoquic_tp_t server_parameters;
+    multipath_redundant_ctx_t rd_ctx;
+    int nb_trials = 0;
+    int nb_inactive = 0;
+    int is_complete = 0;
+    int ret;
+
+    memset(&rd_ctx, 0, sizeof(rd_ctx));
+    rd_ctx.send_interval = 10000;
+
+    ret = tls_api_init_ctx_ex2(&test_ctx, PICOQUIC_INTERNAL_TEST_VERSION_1,
+        PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN, &simulated_time, NULL, NULL, 0, 1, 0, &initial_cid,
+        8, 0, 0);
+
+    if (ret == 0 && test_ctx == NULL) {
+        ret = -1;
+    }
+    else if (ret == 0) {
+        test_ctx->datagram_ctx = &rd_ctx;
+        test_ctx->datagram_send_fn = multipath_redundant_send;
+        test_ctx->datagram_recv_fn = multipath_redundant_recv;
+        picoquic_set_default_path_scheduler(test_ctx->qserver, picoquic_redundant_path_scheduler);
+        multipath_init_params(&server_parameters, 0, 0);
+        server_parameters.max_datagram_frame_size = PICOQUIC_MAX_PACKET_SIZE;
+        picoquic_set_default_tp(test_ctx->qserver, &server_parameters);
+        test_ctx->cnx_client->local_parameters.enable_multipath = 2;
+        test_ctx->cnx_client->local_parameters.enable_time_stamp = 3;
+        test_ctx->cnx_client->local_parameters.max_datagram_frame_size = PICOQUIC_MAX_PACKET_SIZE;
+        ret = picoquic_start_client_cnx(test_ctx->cnx_client);
+    }
+
+    if (ret == 0) {
+        ret = tls_api_connection_loop(test_ctx, &loss_mask, 2 * test_ctx->s_to_c_link->microsec_latency, &simulated_time);
+    }
+
+    if (ret == 0) {
+        ret = wait_client_connection_ready(test_ctx, &simulated_time);
+    }
+
+    if (ret == 0) {
+        ret = multipath_test_add_links(test_ctx, 0);
+    }
+
+    if (ret == 0) {
+        ret = picoquic_probe_new_path(test_ctx->cnx_client, (struct sockaddr*)&test_ctx->server_addr,
+            (struct sockaddr*)&test_ctx->client_addr_2, simulated_time);
+    }
+
+    if (ret == 0) {
+        ret = wait_multipath_ready(test_ctx, &simulated_time);
+    }
+
+    if (ret == 0 && test_ctx->cnx_server->path_scheduler != picoquic_redundant_path_scheduler) {
+        DBG_PRINTF("%s", "Server does not use the redundant scheduler\n");
+        ret = -1;
+    }
+
+    /* Send the datagrams, until all copies are received */
+    if (ret == 0) {
+        rd_ctx.next_send_time = simulated_time;
+        picoquic_mark_datagram_ready(test_ctx->cnx_server, 1);
+    }
+
+    while (ret == 0 && !is_complete && nb_trials < 4096 && nb_inactive < 256) {
+        int was_active = 0;
+        /* Wake up when the next datagram is due */
+        uint64_t time_out = (rd_ctx.nb_sent < MULTIPATH_REDUNDANT_NB_DATAGRAMS && rd_ctx.next_send_time > simulated_time) ?
+            rd_ctx.next_send_time : 0;
+
+        nb_trials++;
+        ret = tls_api_one_sim_round(test_ctx, &simulated_time, time_out, &was_active);
+
+        if (was_active) {
+            nb_inactive = 0;
+        }
+        else {
+            nb_inactive++;
+        }
+
+        if (ret == 0 && !test_ctx->cnx_server->is_datagram_ready && multipath_redundant_is_ready(&rd_ctx, simulated_time)) {
+            picoquic_mark_datagram_ready(test_ctx->cnx_server, 1);
+        }
+
+        is_complete = (rd_ctx.nb_sent == MULTIPATH_REDUNDANT_NB_DATAGRAMS);
+        for (int i = 0; is_complete && i < MULTIPATH_REDUNDANT_NB_DATAGRAMS; i++) {
+            is_complete = (rd_ctx.nb_received[i] >= 2);
+        }
+    }
+
+    if (ret == 0) {
+        for (int i = 0; ret == 0 && i < MULTIPATH_REDUNDANT_NB_DATAGRAMS; i++) {
+            if (rd_ctx.nb_received[i] != 2) {
+                DBG_PRINTF("Datagram %d received %d times, sent %d datagrams\n", i, rd_ctx.nb_received[i], rd_ctx.nb_sent);
+                ret = -1;
+            }
+        }
+    }
+
+    /* All the copies were sent, nothing shall remain queued */
+    if (ret == 0) {
+        ret = multipath_redundant_check_queues(test_ctx);
+    }
+
+    /* Copies that were not sent are freed when the path is deleted */
+    if (ret == 0) {
+        /* Two datagram frames with explicit length, then padding */
+        uint8_t dg_frames[] = {
+            picoquic_frame_type_datagram_l, 4, 1, 2, 3, 4,
+            picoquic_frame_type_datagram_l, 4, 5, 6, 7, 8,
+            picoquic_frame_type_padding, picoquic_frame_type_padding };
+        picoquic_path_t* path_x = test_ctx->cnx_server->path[1];
+
+        if (picoquic_queue_redundant_datagrams(test_ctx->cnx_server, path_x, dg_frames, sizeof(dg_frames)) != 0 ||
+            path_x->nb_redundant_datagrams != 2 || path_x->first_redundant_datagram == NULL) {
+            DBG_PRINTF("%s", "Cannot queue datagram copies\n");
+            ret = -1;
+        }
+        else {
+            picoquic_delete_redundant_datagrams(path_x);
+            ret = multipath_redundant_check_queues(test_ctx);
+        }
+    }
+
+    if (test_ctx != NULL) {
+        tls_api_delete_ctx(test_ctx);
+    }
+
+    return ret;
+}
+
 
 /* Monopath tests:
  * Enable the multipath option, but use only a single path. The gal of the tests is to verify that
@@ -433,6 +433,13 @@ int netperf_one_scenario(test_api_stream_desc_t* scenario,
                         test_ctx->cnx_server->nb_trains_sent, test_ctx->cnx_server->nb_packets_sent);
                     ret = -1;
                 }
+                else if (cc_algo != NULL && send_buffer_size > 0 && (test_ctx->cnx_server->nb_trains_built == 0 ||
+                    test_ctx->cnx_server->nb_train_packets > test_ctx->cnx_server->nb_train_packets_planned)) {
+                    DBG_PRINTF("Train builder fails, %" PRIu64 " trains, %" PRIu64 " packets for %" PRIu64 " planned\n",
+                        test_ctx->cnx_server->nb_trains_built, test_ctx->cnx_server->nb_train_packets,
+                        test_ctx->cnx_server->nb_train_packets_planned);
+                    ret = -1;
+                }
                 else if (20 * test_ctx->cnx_server->nb_retransmission_total > test_ctx->cnx_server->nb_packets_sent) {
                     DBG_PRINTF("Too many losses, %" PRIu64 " losses for %" PRIu64 "packets\n",
                         test_ctx->cnx_server->nb_retransmission_total, test_ctx->cnx_server->nb_packets_sent);
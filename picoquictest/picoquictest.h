@@ -94,12 +94,14 @@ int skip_frame_test();
 int keep_alive_test();
 int logger_test();
 int binlog_test();
+int binlog_ring_test();
 int app_message_overflow_test();
 int socket_test();
 int test_stateless_blowback();
 int ticket_store_test();
 int ticket_seed_test();
 int ticket_seed_from_bdp_frame_test();
+int ticket_cache_test();
 int token_store_test();
 int session_resume_test();
 int zero_rtt_test();
@@ -151,6 +153,12 @@ int stress_test();
 int cnx_stress_unit_test();
 int cnx_stress_do_test(uint64_t duration, int nb_clients, int do_report);
 int cnx_ddos_unit_test();
+int handshake_bench_test();
+int cc_bench_test();
+int scale_bench_test();
+int handshake_bench_do_test(uint64_t nb_connections, uint64_t cnx_per_second, FILE* F);
+int cc_bench_do_test(char const* csv_file_name);
+int scale_bench_do_test(uint64_t nb_connections, uint64_t cnx_per_second, uint64_t active_per_mille, FILE* F);
 int cnx_ddos_test_loop(int nb_connections, uint64_t ddos_interval, const char* qlogdir);
 int splay_test();
 int TlsStreamFrameTest();
@@ -190,11 +198,25 @@ int stream_id_to_rank_test();
 int padding_test();
 int packet_trace_test();
 int qlog_trace_test();
+int qlog_index_test();
+int coltrace_test();
 int qlog_trace_auto_test();
 int qlog_trace_only_test();
 int qlog_trace_ecn_test();
+int qlog_trace_async_test();
+int log_trigger_test();
+int log_trigger_rto_test();
+int log_trigger_idle_test();
+int log_trigger_handshake_test();
+int log_trigger_throughput_test();
+int metrics_test();
+int profiler_test();
+int events_test();
 int path_packet_queue_test();
 int perflog_test();
+int limit_time_test();
+int limit_time_flow_control_test();
+int limit_time_stream_flow_control_test();
 int rebinding_stress_test();
 int many_short_loss_test();
 int random_padding_test();
@@ -240,12 +262,16 @@ int initial_server_close_test();
 int h3zero_integer_test();
 int qpack_huffman_test();
 int qpack_huffman_base_test();
+int qpack_huffman_encode_test();
+int qpack_huffman_bench_test();
+int qpack_huffman_bench_do_test(uint64_t nb_rounds, FILE* F);
 int h3zero_parse_qpack_test();
 int h3zero_prepare_qpack_test();
 int h3zero_user_agent_test();
 int h3zero_null_sni_test();
 int h3zero_qpack_fuzz_test();
 int h3zero_stream_test();
+int h3zero_qpack_dynamic_test();
 int parse_demo_scenario_test();
 int h3zero_server_test();
 int h09_server_test();
@@ -254,6 +280,10 @@ int generic_server_test();
 int esni_test();
 int tls_retry_token_test();
 int tls_retry_token_valid_test();
+int stateless_prefilter_test();
+int async_sign_test();
+int async_sign_client_auth_test();
+int async_sign_delete_test();
 int optimistic_ack_test();
 int optimistic_hole_test();
 int document_addresses_test();
@@ -265,6 +295,8 @@ int preferred_address_zero_test();
 int cid_for_lb_test();
 int cid_for_lb_cli_test();
 int retry_protection_vector_test();
+int crypto_provider_test();
+int crypto_ring_provider_test();
 int test_copy_for_retransmit();
 int test_format_for_retransmit();
 int bad_coalesce_test();
@@ -280,6 +312,11 @@ int fastcc_test();
 int fastcc_jitter_test();
 int bbr_test();
 int bbr_jitter_test();
+int bbr3_test();
+int bbr3_jitter_test();
+int bbr3_shallow_test();
+int cc_ack_event_test();
+int prague_test();
 int bbr_long_test();
 int bbr_performance_test();
 int bbr_slow_long_test();
@@ -288,6 +325,8 @@ int gbps_performance_test();
 int bbr_asym100_test();
 int bbr_asym100_nodelay_test();
 int bbr_asym400_test();
+int ack_autotune_test();
+int loss_timer_test();
 int large_client_hello_test();
 int fast_nat_rebinding_test();
 int datagram_test();
@@ -306,6 +345,7 @@ int direct_receive_test();
 int app_limit_cc_test();
 int initial_race_test();
 int pacing_test();
+int pacing_wheel_test();
 int chacha20_test();
 int cnx_limit_test();
 int cert_verify_bad_cert_test();
@@ -333,6 +373,10 @@ int multipath_break1_test();
 int multipath_abandon_test();
 int multipath_back1_test();
 int multipath_perf_test();
+int multipath_minrtt_test();
+int multipath_weighted_test();
+int multipath_ecf_test();
+int multipath_redundant_test();
 int multipath_qlog_test();
 int simple_multipath_basic_test();
 int simple_multipath_drop_first_test();
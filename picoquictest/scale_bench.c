@@ -0,0 +1,703 @@
+/* Connection scale benchmark.
+ *
+ * Ramps up a server to a large number of connections, in simulated time. Clients
+ * connect at a fixed rate. Most of them go away silently shortly after the
+ * handshake, leaving an idle connection on the server, since the idle timeout is
+ * disabled. A configurable fraction stays active and sends a short message on
+ * a stream every second.
+ *
+ * The benchmark reports, each time the number of server connections doubles:
+ *
+ * - the resident set size of the process (Linux only),
+ * - the heap memory held by the server, per connection,
+ * - the average CPU cost of processing an incoming packet and of preparing
+ *   an outgoing packet on the server, since the previous report.
+ *
+ * At the end, the memory of an idle connection is broken down by structure,
+ * using a sample of idle server connections: the connection context, the paths,
+ * the stash of local and remote connection IDs, the SACK lists, the stream
+ * contexts and the packets waiting for acknowledgement are counted by size. The
+ * AEAD contexts (which include the precomputed tables of the fusion AES-GCM
+ * implementation if it is used) and the TLS context are measured by freeing them
+ * and looking at the heap. The remainder is reported as "other".
+ *
+ * The heap measurements require glibc 2.33 or later.
+ */
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <picotls.h>
+#include "picoquic_utils.h"
+#include "picoquic_internal.h"
+#include "tls_api.h"
+#include "picoquictest_internal.h"
+
+#if defined(__GLIBC__) && ((__GLIBC__ > 2) || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+#include <malloc.h>
+#define SCALE_BENCH_HEAP_USED() ((uint64_t)mallinfo2().uordblks)
+#define SCALE_BENCH_HAS_HEAP 1
+#else
+#define SCALE_BENCH_HEAP_USED() 0
+#define SCALE_BENCH_HAS_HEAP 0
+#endif
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+#define SCALE_BENCH_ALPN "scalebench"
+#define SCALE_BENCH_CLIENT_ADDR_BASE 0x0A000000
+#define SCALE_BENCH_LINGER 1000000ull
+#define SCALE_BENCH_ACTIVE_INTERVAL 1000000ull
+#define SCALE_BENCH_SETTLE_TIME 5000000ull
+#define SCALE_BENCH_FIRST_MILESTONE 1024
+#define SCALE_BENCH_MAX_MILESTONES 48
+#define SCALE_BENCH_MEMORY_SAMPLES 256
+
+typedef struct st_scale_bench_milestone_t {
+    uint64_t nb_cnx;
+    uint64_t simulated_time;
+    uint64_t rss;
+    uint64_t server_heap;
+    uint64_t nb_packets_in;
+    uint64_t cycles_in;
+    uint64_t nb_packets_out;
+    uint64_t cycles_out;
+} scale_bench_milestone_t;
+
+typedef struct st_scale_bench_memory_t {
+    uint64_t nb_samples;
+    uint64_t cnx_context;
+    uint64_t paths;
+    uint64_t cid_stash;
+    uint64_t sack_lists;
+    uint64_t streams;
+    uint64_t packets;
+    uint64_t aead;
+    uint64_t tls;
+    uint64_t total;
+} scale_bench_memory_t;
+
+typedef struct st_scale_bench_ctx_t {
+    uint64_t simulated_time;
+    picoquic_quic_t* qserver;
+    picoquic_quic_t* qclient;
+    struct sockaddr_in server_addr;
+    picoquictest_sim_link_t* link_to_clients;
+    picoquictest_sim_link_t* link_to_server;
+    /* Connection schedule */
+    uint64_t nb_cnx_target;
+    uint64_t active_per_mille;
+    uint64_t nb_cnx_created;
+    uint64_t nb_handshakes;
+    uint64_t cnx_interval;
+    uint64_t next_cnx_time;
+    uint64_t end_time;
+    /* Idle clients waiting for deletion, in order of handshake completion */
+    picoquic_cnx_t** linger_cnx;
+    uint64_t* linger_time;
+    uint64_t linger_first;
+    uint64_t linger_last;
+    /* Active clients, served in round robin */
+    picoquic_cnx_t** active_cnx;
+    uint64_t nb_active;
+    uint64_t next_active;
+    uint64_t next_active_time;
+    uint64_t nb_messages;
+    /* Server measurements */
+    uint64_t server_heap;
+    uint64_t nb_packets_in;
+    uint64_t cycles_in;
+    uint64_t nb_packets_out;
+    uint64_t cycles_out;
+    uint64_t next_milestone;
+    int nb_milestones;
+    scale_bench_milestone_t milestones[SCALE_BENCH_MAX_MILESTONES];
+    scale_bench_memory_t memory;
+} scale_bench_ctx_t;
+
+static const uint8_t scale_bench_message[64] = { 0 };
+
+static uint64_t scale_bench_rss()
+{
+    uint64_t rss = 0;
+#ifdef __linux__
+    FILE* F = fopen("/proc/self/statm", "r");
+
+    if (F != NULL) {
+        unsigned long long size = 0;
+        unsigned long long resident = 0;
+
+        if (fscanf(F, "%llu %llu", &size, &resident) == 2) {
+            rss = (uint64_t)resident * (uint64_t)sysconf(_SC_PAGESIZE);
+        }
+        fclose(F);
+    }
+#endif
+    return rss;
+}
+
+/* The active clients are spread evenly among the connections */
+static int scale_bench_is_active(scale_bench_ctx_t* bench_ctx, uint64_t cnx_index)
+{
+    return ((cnx_index + 1) * bench_ctx->active_per_mille) / 1000 != (cnx_index * bench_ctx->active_per_mille) / 1000;
+}
+
+static int scale_bench_client_callback(picoquic_cnx_t* cnx,
+    uint64_t stream_id, uint8_t* bytes, size_t length,
+    picoquic_call_back_event_t fin_or_event, void* callback_ctx, void* v_stream_ctx)
+{
+    scale_bench_ctx_t* bench_ctx = (scale_bench_ctx_t*)callback_ctx;
+
+    if (fin_or_event == picoquic_callback_ready && bench_ctx != NULL) {
+        struct sockaddr* local_addr = NULL;
+        uint64_t cnx_index = 0;
+
+        picoquic_get_local_addr(cnx, &local_addr);
+        if (local_addr != NULL && local_addr->sa_family == AF_INET) {
+            cnx_index = ntohl(((struct sockaddr_in*)local_addr)->sin_addr.s_addr) - SCALE_BENCH_CLIENT_ADDR_BASE;
+        }
+        bench_ctx->nb_handshakes++;
+        if (scale_bench_is_active(bench_ctx, cnx_index)) {
+            bench_ctx->active_cnx[bench_ctx->nb_active++] = cnx;
+        }
+        else {
+            bench_ctx->linger_cnx[bench_ctx->linger_last] = cnx;
+            bench_ctx->linger_time[bench_ctx->linger_last] = bench_ctx->simulated_time + SCALE_BENCH_LINGER;
+            bench_ctx->linger_last++;
+        }
+    }
+
+    return 0;
+}
+
+static int scale_bench_server_callback(picoquic_cnx_t* cnx,
+    uint64_t stream_id, uint8_t* bytes, size_t length,
+    picoquic_call_back_event_t fin_or_event, void* callback_ctx, void* v_stream_ctx)
+{
+    return 0;
+}
+
+static int scale_bench_create_client_cnx(scale_bench_ctx_t* bench_ctx)
+{
+    int ret = 0;
+    struct sockaddr_in client_addr;
+    picoquic_cnx_t* cnx = picoquic_create_cnx(
+        bench_ctx->qclient, picoquic_null_connection_id, picoquic_null_connection_id,
+        (struct sockaddr*)&bench_ctx->server_addr, bench_ctx->simulated_time, 0,
+        PICOQUIC_TEST_SNI, SCALE_BENCH_ALPN, 1);
+
+    /* Each client gets its own address, so the server can tell them apart */
+    picoquic_set_test_address(&client_addr, (uint32_t)(SCALE_BENCH_CLIENT_ADDR_BASE + bench_ctx->nb_cnx_created), 443);
+
+    if (cnx == NULL) {
+        ret = -1;
+    }
+    else {
+        picoquic_set_callback(cnx, scale_bench_client_callback, bench_ctx);
+        ret = picoquic_set_local_addr(cnx, (struct sockaddr*)&client_addr);
+        if (ret == 0) {
+            ret = picoquic_start_client_cnx(cnx);
+        }
+    }
+    bench_ctx->nb_cnx_created++;
+    bench_ctx->next_cnx_time = (bench_ctx->nb_cnx_created < bench_ctx->nb_cnx_target) ?
+        bench_ctx->next_cnx_time + bench_ctx->cnx_interval : UINT64_MAX;
+
+    return ret;
+}
+
+/* Idle clients disappear without closing the connection */
+static int scale_bench_linger_expire(scale_bench_ctx_t* bench_ctx)
+{
+    picoquic_cnx_t* cnx = bench_ctx->linger_cnx[bench_ctx->linger_first];
+
+    bench_ctx->linger_cnx[bench_ctx->linger_first] = NULL;
+    bench_ctx->linger_first++;
+    picoquic_set_callback(cnx, NULL, NULL);
+    picoquic_delete_cnx(cnx);
+
+    return 0;
+}
+
+static int scale_bench_active_send(scale_bench_ctx_t* bench_ctx)
+{
+    int ret = 0;
+    picoquic_cnx_t* cnx = bench_ctx->active_cnx[bench_ctx->next_active % bench_ctx->nb_active];
+
+    bench_ctx->next_active++;
+    bench_ctx->next_active_time += SCALE_BENCH_ACTIVE_INTERVAL / bench_ctx->nb_active;
+    if (cnx->cnx_state == picoquic_state_ready) {
+        ret = picoquic_add_to_stream(cnx, 0, scale_bench_message, sizeof(scale_bench_message), 0);
+        bench_ctx->nb_messages++;
+    }
+
+    return ret;
+}
+
+static void scale_bench_milestone(scale_bench_ctx_t* bench_ctx, uint64_t nb_cnx)
+{
+    if (bench_ctx->nb_milestones < SCALE_BENCH_MAX_MILESTONES) {
+        scale_bench_milestone_t* milestone = &bench_ctx->milestones[bench_ctx->nb_milestones++];
+
+        milestone->nb_cnx = nb_cnx;
+        milestone->simulated_time = bench_ctx->simulated_time;
+        milestone->rss = scale_bench_rss();
+        milestone->server_heap = bench_ctx->server_heap;
+        milestone->nb_packets_in = bench_ctx->nb_packets_in;
+        milestone->cycles_in = bench_ctx->cycles_in;
+        milestone->nb_packets_out = bench_ctx->nb_packets_out;
+        milestone->cycles_out = bench_ctx->cycles_out;
+    }
+}
+
+static int scale_bench_server_arrival(scale_bench_ctx_t* bench_ctx)
+{
+    int ret = 0;
+    picoquictest_sim_packet_t* packet =
+        picoquictest_sim_link_dequeue(bench_ctx->link_to_server, bench_ctx->simulated_time);
+
+    if (packet != NULL) {
+        uint64_t heap_before = SCALE_BENCH_HEAP_USED();
+        uint64_t start = picoquic_cpu_cycles();
+        uint64_t heap_after;
+
+        ret = picoquic_incoming_packet(bench_ctx->qserver, packet->bytes,
+            (uint32_t)packet->length,
+            (struct sockaddr*)&packet->addr_from,
+            (struct sockaddr*)&packet->addr_to, 0, 0, bench_ctx->simulated_time);
+        bench_ctx->cycles_in += picoquic_cpu_cycles() - start;
+        bench_ctx->nb_packets_in++;
+        heap_after = SCALE_BENCH_HEAP_USED();
+        bench_ctx->server_heap += heap_after - heap_before;
+        free(packet);
+
+        if (bench_ctx->qserver->current_number_connections >= bench_ctx->next_milestone) {
+            scale_bench_milestone(bench_ctx, bench_ctx->qserver->current_number_connections);
+            bench_ctx->next_milestone *= 2;
+        }
+    }
+
+    return ret;
+}
+
+static int scale_bench_client_arrival(scale_bench_ctx_t* bench_ctx)
+{
+    int ret = 0;
+    picoquictest_sim_packet_t* packet =
+        picoquictest_sim_link_dequeue(bench_ctx->link_to_clients, bench_ctx->simulated_time);
+
+    if (packet != NULL) {
+        ret = picoquic_incoming_packet(bench_ctx->qclient, packet->bytes,
+            (uint32_t)packet->length,
+            (struct sockaddr*)&packet->addr_from,
+            (struct sockaddr*)&packet->addr_to, 0, 0, bench_ctx->simulated_time);
+        free(packet);
+    }
+
+    return ret;
+}
+
+static int scale_bench_prepare(scale_bench_ctx_t* bench_ctx, int is_server)
+{
+    int ret = 0;
+    picoquictest_sim_packet_t* packet = picoquictest_sim_link_create_packet();
+
+    if (packet == NULL) {
+        ret = -1;
+    }
+    else {
+        picoquic_connection_id_t log_cid;
+        picoquic_cnx_t* last_cnx;
+        int if_index = 0;
+        uint64_t heap_before = 0;
+        uint64_t start = 0;
+
+        if (is_server) {
+            heap_before = SCALE_BENCH_HEAP_USED();
+            start = picoquic_cpu_cycles();
+        }
+        ret = picoquic_prepare_next_packet((is_server) ? bench_ctx->qserver : bench_ctx->qclient,
+            bench_ctx->simulated_time, packet->bytes, PICOQUIC_MAX_PACKET_SIZE, &packet->length,
+            &packet->addr_to, &packet->addr_from, &if_index, &log_cid, &last_cnx);
+        if (is_server) {
+            bench_ctx->cycles_out += picoquic_cpu_cycles() - start;
+            bench_ctx->server_heap += SCALE_BENCH_HEAP_USED() - heap_before;
+        }
+
+        if (ret == 0 && packet->length > 0) {
+            if (is_server) {
+                bench_ctx->nb_packets_out++;
+                if (packet->addr_from.ss_family == AF_UNSPEC) {
+                    picoquic_store_addr(&packet->addr_from, (struct sockaddr*)&bench_ctx->server_addr);
+                }
+            }
+            picoquictest_sim_link_submit((is_server) ? bench_ctx->link_to_clients : bench_ctx->link_to_server,
+                packet, bench_ctx->simulated_time);
+        }
+        else {
+            free(packet);
+        }
+    }
+
+    return ret;
+}
+
+/* Execute the next event: connection creation, idle client departure, active
+ * client message, packet arrival or departure, whichever comes first. */
+static int scale_bench_loop_step(scale_bench_ctx_t* bench_ctx)
+{
+    int ret = 0;
+    int next_event = 0;
+    uint64_t next_time = bench_ctx->next_cnx_time;
+    uint64_t event_time;
+
+    if (bench_ctx->linger_first < bench_ctx->linger_last &&
+        bench_ctx->linger_time[bench_ctx->linger_first] < next_time) {
+        next_time = bench_ctx->linger_time[bench_ctx->linger_first];
+        next_event = 1;
+    }
+    if (bench_ctx->nb_active > 0 && bench_ctx->next_active_time < next_time) {
+        next_time = bench_ctx->next_active_time;
+        next_event = 2;
+    }
+    if ((event_time = picoquictest_sim_link_next_arrival(bench_ctx->link_to_server, next_time)) < next_time) {
+        next_time = event_time;
+        next_event = 3;
+    }
+    if ((event_time = picoquictest_sim_link_next_arrival(bench_ctx->link_to_clients, next_time)) < next_time) {
+        next_time = event_time;
+        next_event = 4;
+    }
+    if ((event_time = picoquic_get_next_wake_time(bench_ctx->qclient, bench_ctx->simulated_time)) < next_time) {
+        next_time = event_time;
+        next_event = 5;
+    }
+    if ((event_time = picoquic_get_next_wake_time(bench_ctx->qserver, bench_ctx->simulated_time)) < next_time) {
+        next_time = event_time;
+        next_event = 6;
+    }
+
+    if (next_time > bench_ctx->end_time) {
+        /* Nothing left to do before the end of the test */
+        bench_ctx->simulated_time = bench_ctx->end_time;
+    }
+    else {
+        if (next_time > bench_ctx->simulated_time) {
+            bench_ctx->simulated_time = next_time;
+        }
+
+        switch (next_event) {
+        case 0:
+            ret = scale_bench_create_client_cnx(bench_ctx);
+            if (bench_ctx->next_cnx_time == UINT64_MAX) {
+                bench_ctx->end_time = bench_ctx->simulated_time + SCALE_BENCH_SETTLE_TIME;
+            }
+            break;
+        case 1:
+            ret = scale_bench_linger_expire(bench_ctx);
+            break;
+        case 2:
+            ret = scale_bench_active_send(bench_ctx);
+            break;
+        case 3:
+            ret = scale_bench_server_arrival(bench_ctx);
+            break;
+        case 4:
+            ret = scale_bench_client_arrival(bench_ctx);
+            break;
+        case 5:
+            ret = scale_bench_prepare(bench_ctx, 0);
+            break;
+        default:
+            ret = scale_bench_prepare(bench_ctx, 1);
+            break;
+        }
+    }
+
+    return ret;
+}
+
+/* Account for the memory of an idle server connection, then delete it */
+static void scale_bench_memory_sample(scale_bench_ctx_t* bench_ctx, picoquic_cnx_t* cnx)
+{
+    scale_bench_memory_t* memory = &bench_ctx->memory;
+    uint64_t heap_start = SCALE_BENCH_HEAP_USED();
+    uint64_t heap_aead;
+    uint64_t heap_tls;
+    uint64_t nb_sack_items = 0;
+    uint64_t nb_packets = 0;
+    picoquic_stream_head_t* stream;
+
+    memory->nb_samples++;
+    memory->cnx_context += sizeof(picoquic_cnx_t);
+    memory->paths += cnx->nb_path_alloc * sizeof(picoquic_path_t*) + cnx->nb_paths * sizeof(picoquic_path_t);
+    for (picoquic_remote_cnxid_t* r_cid = cnx->cnxid_stash_first; r_cid != NULL; r_cid = r_cid->next) {
+        memory->cid_stash += sizeof(picoquic_remote_cnxid_t);
+    }
+    for (picoquic_local_cnxid_t* l_cid = cnx->local_cnxid_first; l_cid != NULL; l_cid = l_cid->next) {
+        memory->cid_stash += sizeof(picoquic_local_cnxid_t);
+        nb_sack_items += picoquic_sack_list_size(&l_cid->ack_ctx.sack_list);
+    }
+    for (int pc = 0; pc < picoquic_nb_packet_context; pc++) {
+        nb_sack_items += picoquic_sack_list_size(&cnx->ack_ctx[pc].sack_list);
+        for (picoquic_packet_t* p = cnx->pkt_ctx[pc].retransmit_oldest; p != NULL; p = p->previous_packet) {
+            nb_packets++;
+        }
+        for (picoquic_packet_t* p = cnx->pkt_ctx[pc].retransmitted_oldest; p != NULL; p = p->previous_packet) {
+            nb_packets++;
+        }
+    }
+    stream = picoquic_first_stream(cnx);
+    while (stream != NULL) {
+        memory->streams += sizeof(picoquic_stream_head_t);
+        nb_sack_items += picoquic_sack_list_size(&stream->sack_list);
+        stream = picoquic_next_stream(stream);
+    }
+    memory->sack_lists += nb_sack_items * sizeof(picoquic_sack_item_t);
+    memory->packets += nb_packets * sizeof(picoquic_packet_t);
+
+    for (int epoch = 0; epoch < PICOQUIC_NUMBER_OF_EPOCHS; epoch++) {
+        picoquic_crypto_context_free(&cnx->crypto_context[epoch]);
+    }
+    picoquic_crypto_context_free(&cnx->crypto_context_new);
+    picoquic_crypto_context_free(&cnx->crypto_context_old);
+    heap_aead = SCALE_BENCH_HEAP_USED();
+    memory->aead += heap_start - heap_aead;
+
+    if (cnx->tls_ctx != NULL) {
+        picoquic_tlscontext_free(cnx->tls_ctx);
+        cnx->tls_ctx = NULL;
+    }
+    heap_tls = SCALE_BENCH_HEAP_USED();
+    memory->tls += heap_aead - heap_tls;
+
+    picoquic_delete_cnx(cnx);
+    memory->total += heap_start - SCALE_BENCH_HEAP_USED();
+}
+
+static void scale_bench_memory_breakdown(scale_bench_ctx_t* bench_ctx)
+{
+    picoquic_cnx_t* cnx = picoquic_get_first_cnx(bench_ctx->qserver);
+
+    while (cnx != NULL && bench_ctx->memory.nb_samples < SCALE_BENCH_MEMORY_SAMPLES) {
+        picoquic_cnx_t* next_cnx = picoquic_get_next_cnx(cnx);
+        struct sockaddr* peer_addr = NULL;
+
+        picoquic_get_peer_addr(cnx, &peer_addr);
+        if (cnx->cnx_state == picoquic_state_ready && peer_addr != NULL && peer_addr->sa_family == AF_INET &&
+            !scale_bench_is_active(bench_ctx,
+                ntohl(((struct sockaddr_in*)peer_addr)->sin_addr.s_addr) - SCALE_BENCH_CLIENT_ADDR_BASE)) {
+            scale_bench_memory_sample(bench_ctx, cnx);
+        }
+        cnx = next_cnx;
+    }
+}
+
+static void scale_bench_delete_ctx(scale_bench_ctx_t* bench_ctx)
+{
+    if (bench_ctx->qclient != NULL) {
+        picoquic_free(bench_ctx->qclient);
+    }
+    if (bench_ctx->qserver != NULL) {
+        picoquic_free(bench_ctx->qserver);
+    }
+    if (bench_ctx->link_to_clients != NULL) {
+        picoquictest_sim_link_delete(bench_ctx->link_to_clients);
+    }
+    if (bench_ctx->link_to_server != NULL) {
+        picoquictest_sim_link_delete(bench_ctx->link_to_server);
+    }
+    if (bench_ctx->linger_cnx != NULL) {
+        free(bench_ctx->linger_cnx);
+    }
+    if (bench_ctx->linger_time != NULL) {
+        free(bench_ctx->linger_time);
+    }
+    if (bench_ctx->active_cnx != NULL) {
+        free(bench_ctx->active_cnx);
+    }
+    free(bench_ctx);
+}
+
+static scale_bench_ctx_t* scale_bench_create_ctx(uint64_t nb_connections, uint64_t cnx_per_second, uint64_t active_per_mille)
+{
+    scale_bench_ctx_t* bench_ctx = (scale_bench_ctx_t*)malloc(sizeof(scale_bench_ctx_t));
+
+    if (bench_ctx != NULL) {
+        int ret = 0;
+        char test_server_cert_file[512];
+        char test_server_key_file[512];
+        picoquic_tp_t tp;
+        /* The client only holds the connections in handshake, lingering or active */
+        uint64_t max_client_cnx = cnx_per_second * 4 + (nb_connections * active_per_mille) / 1000 + 1024;
+
+        memset(bench_ctx, 0, sizeof(scale_bench_ctx_t));
+        picoquic_set_test_address(&bench_ctx->server_addr, 0x01010101, 4433);
+        bench_ctx->nb_cnx_target = nb_connections;
+        bench_ctx->active_per_mille = active_per_mille;
+        bench_ctx->cnx_interval = 1000000 / cnx_per_second;
+        if (bench_ctx->cnx_interval == 0) {
+            bench_ctx->cnx_interval = 1;
+        }
+        bench_ctx->end_time = UINT64_MAX;
+        bench_ctx->next_active_time = SCALE_BENCH_ACTIVE_INTERVAL;
+        bench_ctx->next_milestone = SCALE_BENCH_FIRST_MILESTONE;
+        if (max_client_cnx > nb_connections) {
+            max_client_cnx = nb_connections;
+        }
+
+        bench_ctx->linger_cnx = (picoquic_cnx_t**)malloc(sizeof(picoquic_cnx_t*) * (size_t)nb_connections);
+        bench_ctx->linger_time = (uint64_t*)malloc(sizeof(uint64_t) * (size_t)nb_connections);
+        bench_ctx->active_cnx = (picoquic_cnx_t**)malloc(sizeof(picoquic_cnx_t*) * (size_t)nb_connections);
+        if (bench_ctx->linger_cnx == NULL || bench_ctx->linger_time == NULL || bench_ctx->active_cnx == NULL) {
+            ret = -1;
+        }
+        else {
+            ret = picoquic_get_input_path(test_server_cert_file, sizeof(test_server_cert_file), picoquic_solution_dir, PICOQUIC_TEST_FILE_SERVER_CERT);
+        }
+        if (ret == 0) {
+            ret = picoquic_get_input_path(test_server_key_file, sizeof(test_server_key_file), picoquic_solution_dir, PICOQUIC_TEST_FILE_SERVER_KEY);
+        }
+        if (ret == 0) {
+            bench_ctx->qclient = picoquic_create((uint32_t)max_client_cnx, NULL, NULL,
+                NULL, SCALE_BENCH_ALPN, NULL, NULL, NULL, NULL,
+                NULL, bench_ctx->simulated_time, &bench_ctx->simulated_time,
+                NULL, NULL, 0);
+            bench_ctx->qserver = picoquic_create((uint32_t)(nb_connections + 16), test_server_cert_file, test_server_key_file,
+                NULL, SCALE_BENCH_ALPN, scale_bench_server_callback, bench_ctx, NULL, NULL,
+                NULL, bench_ctx->simulated_time, &bench_ctx->simulated_time,
+                NULL, NULL, 0);
+            bench_ctx->link_to_clients = picoquictest_sim_link_create(10.0, 10000, NULL, 0, 0);
+            bench_ctx->link_to_server = picoquictest_sim_link_create(10.0, 10000, NULL, 0, 0);
+            if (bench_ctx->qclient == NULL || bench_ctx->qserver == NULL ||
+                bench_ctx->link_to_clients == NULL || bench_ctx->link_to_server == NULL) {
+                ret = -1;
+            }
+        }
+        if (ret == 0) {
+            /* Idle connections stay up until the end of the test */
+            picoquic_init_transport_parameters(&tp, 1);
+            tp.idle_timeout = 0;
+            ret = picoquic_set_default_tp(bench_ctx->qclient, &tp);
+            if (ret == 0) {
+                picoquic_init_transport_parameters(&tp, 0);
+                tp.idle_timeout = 0;
+                ret = picoquic_set_default_tp(bench_ctx->qserver, &tp);
+            }
+        }
+
+        if (ret != 0) {
+            scale_bench_delete_ctx(bench_ctx);
+            bench_ctx = NULL;
+        }
+    }
+
+    return bench_ctx;
+}
+
+static void scale_bench_report_memory_item(FILE* F, char const* item_name, uint64_t bytes, uint64_t nb_samples, uint64_t total)
+{
+    fprintf(F, "    %-24s %8" PRIu64 " bytes (%5.1f%%)\n", item_name, bytes / nb_samples,
+        (total > 0) ? (100.0 * (double)bytes) / (double)total : 0.0);
+}
+
+static void scale_bench_report(scale_bench_ctx_t* bench_ctx, FILE* F, uint64_t wall_time_elapsed)
+{
+    scale_bench_memory_t* memory = &bench_ctx->memory;
+    scale_bench_milestone_t const* previous = NULL;
+
+    fprintf(F, "Scale benchmark: %" PRIu64 " connections, %" PRIu64 " active, in %fs (wall time), %fs (simulated).\n",
+        bench_ctx->nb_handshakes, bench_ctx->nb_active, ((double)wall_time_elapsed) / 1000000.0,
+        ((double)bench_ctx->simulated_time) / 1000000.0);
+    fprintf(F, "    %" PRIu64 " messages from active clients.\n", bench_ctx->nb_messages);
+    fprintf(F, "%12s %12s %14s %14s %14s %14s\n", "connections", "time (s)", "RSS (MB)", "heap/cnx", "cycles/in", "cycles/out");
+    for (int i = 0; i < bench_ctx->nb_milestones; i++) {
+        scale_bench_milestone_t const* milestone = &bench_ctx->milestones[i];
+        uint64_t nb_in = milestone->nb_packets_in - ((previous == NULL) ? 0 : previous->nb_packets_in);
+        uint64_t cycles_in = milestone->cycles_in - ((previous == NULL) ? 0 : previous->cycles_in);
+        uint64_t nb_out = milestone->nb_packets_out - ((previous == NULL) ? 0 : previous->nb_packets_out);
+        uint64_t cycles_out = milestone->cycles_out - ((previous == NULL) ? 0 : previous->cycles_out);
+
+        fprintf(F, "%12" PRIu64 " %12.3f %14.1f %14" PRIu64 " %14" PRIu64 " %14" PRIu64 "\n",
+            milestone->nb_cnx, ((double)milestone->simulated_time) / 1000000.0,
+            ((double)milestone->rss) / (1024.0 * 1024.0),
+            (milestone->nb_cnx > 0) ? milestone->server_heap / milestone->nb_cnx : 0,
+            (nb_in > 0) ? cycles_in / nb_in : 0, (nb_out > 0) ? cycles_out / nb_out : 0);
+        previous = milestone;
+    }
+    if (SCALE_BENCH_HAS_HEAP && memory->nb_samples > 0) {
+        uint64_t counted = memory->cnx_context + memory->paths + memory->cid_stash + memory->sack_lists +
+            memory->streams + memory->packets + memory->aead + memory->tls;
+
+        fprintf(F, "Memory per idle connection, %" PRIu64 " bytes (%" PRIu64 " samples):\n",
+            memory->total / memory->nb_samples, memory->nb_samples);
+        scale_bench_report_memory_item(F, "Connection context", memory->cnx_context, memory->nb_samples, memory->total);
+        scale_bench_report_memory_item(F, "Paths", memory->paths, memory->nb_samples, memory->total);
+        scale_bench_report_memory_item(F, "CID stash", memory->cid_stash, memory->nb_samples, memory->total);
+        scale_bench_report_memory_item(F, "SACK lists", memory->sack_lists, memory->nb_samples, memory->total);
+        scale_bench_report_memory_item(F, "Streams", memory->streams, memory->nb_samples, memory->total);
+        scale_bench_report_memory_item(F, "Packets in flight", memory->packets, memory->nb_samples, memory->total);
+        scale_bench_report_memory_item(F, "AEAD contexts", memory->aead, memory->nb_samples, memory->total);
+        scale_bench_report_memory_item(F, "TLS context", memory->tls, memory->nb_samples, memory->total);
+        scale_bench_report_memory_item(F, "Other", (memory->total > counted) ? memory->total - counted : 0,
+            memory->nb_samples, memory->total);
+        fprintf(F, "    (low memory mode %s)\n", (bench_ctx->qserver->use_low_memory) ? "on" : "off");
+    }
+    else {
+        fprintf(F, "Memory per idle connection: not available.\n");
+    }
+}
+
+int scale_bench_do_test(uint64_t nb_connections, uint64_t cnx_per_second, uint64_t active_per_mille, FILE* F)
+{
+    int ret = 0;
+    scale_bench_ctx_t* bench_ctx = NULL;
+
+    if (nb_connections == 0 || cnx_per_second == 0 || active_per_mille > 1000) {
+        ret = -1;
+    }
+    else if ((bench_ctx = scale_bench_create_ctx(nb_connections, cnx_per_second, active_per_mille)) == NULL) {
+        ret = -1;
+    }
+    else {
+        uint64_t wall_time_start = picoquic_current_time();
+
+        picoquic_public_random_seed_64(RANDOM_PUBLIC_TEST_SEED, 1);
+
+        while (ret == 0 && bench_ctx->simulated_time < bench_ctx->end_time) {
+            ret = scale_bench_loop_step(bench_ctx);
+        }
+
+        if (ret == 0) {
+            scale_bench_milestone(bench_ctx, bench_ctx->qserver->current_number_connections);
+            scale_bench_memory_breakdown(bench_ctx);
+        }
+
+        if (ret == 0 && bench_ctx->nb_handshakes != nb_connections) {
+            DBG_PRINTF("Expected %" PRIu64 " handshakes, got %" PRIu64, nb_connections, bench_ctx->nb_handshakes);
+            ret = -1;
+        }
+        else if (ret == 0 && bench_ctx->milestones[bench_ctx->nb_milestones - 1].nb_cnx != nb_connections) {
+            DBG_PRINTF("Expected %" PRIu64 " server connections, got %" PRIu64, nb_connections,
+                bench_ctx->milestones[bench_ctx->nb_milestones - 1].nb_cnx);
+            ret = -1;
+        }
+        else if (ret == 0 && F != NULL) {
+            scale_bench_report(bench_ctx, F, picoquic_current_time() - wall_time_start);
+        }
+
+        scale_bench_delete_ctx(bench_ctx);
+    }
+
+    return ret;
+}
+
+/* The unit test ramps to a few thousand connections, to check that the
+ * harness and the accounting work. */
+int scale_bench_test()
+{
+    return scale_bench_do_test(2048, 1000, 50, NULL);
+}
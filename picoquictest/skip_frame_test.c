@@ -1345,6 +1345,84 @@ int binlog_test()
     return ret;
 }
 
+/* Test of the ring used by the asynchronous binary logs. The writer thread is
+ * not started, so the test controls when the ring is drained. Chunks are pushed
+ * in bursts larger than the ring, so some are dropped; the file shall contain
+ * exactly the chunks that were accepted, in order.
+ */
+#define BINLOG_RING_TEST_FILE "binlog_ring_test.log"
+#define BINLOG_RING_TEST_CHUNKS 400
+#define BINLOG_RING_TEST_BURST 50
+
+int binlog_ring_test()
+{
+    int ret = 0;
+    uint64_t random_context = 0xB1B10C;
+    uint64_t nb_dropped = 0;
+    size_t expected_length = 0;
+    uint8_t chunk[3000];
+    uint8_t* expected = (uint8_t*)malloc(BINLOG_RING_TEST_CHUNKS * sizeof(chunk));
+    uint8_t* actual = (uint8_t*)malloc(BINLOG_RING_TEST_CHUNKS * sizeof(chunk));
+    picoquic_binlog_writer_t* writer = picoquic_binlog_writer_create(0x10000, picoquic_binlog_overflow_drop, 0);
+    FILE* F = picoquic_file_open(BINLOG_RING_TEST_FILE, "wb");
+
+    if (expected == NULL || actual == NULL || writer == NULL || F == NULL) {
+        DBG_PRINTF("%s", "Cannot allocate the ring test resources\n");
+        ret = -1;
+    }
+
+    for (int i = 0; ret == 0 && i < BINLOG_RING_TEST_CHUNKS; i++) {
+        size_t length = 1 + (size_t)picoquic_test_uniform_random(&random_context, sizeof(chunk));
+
+        picoquic_test_random_bytes(&random_context, chunk, length);
+        if (picoquic_binlog_writer_push(writer, F, chunk, length) == 0) {
+            memcpy(expected + expected_length, chunk, length);
+            expected_length += length;
+        }
+        else {
+            nb_dropped++;
+        }
+        if ((i % BINLOG_RING_TEST_BURST) == BINLOG_RING_TEST_BURST - 1) {
+            (void)picoquic_binlog_writer_drain(writer);
+        }
+    }
+
+    if (ret == 0) {
+        picoquic_binlog_writer_close_file(writer, F, 1);
+        F = NULL;
+        if (nb_dropped == 0 || nb_dropped != picoquic_binlog_writer_dropped(writer)) {
+            DBG_PRINTF("Dropped %" PRIu64 " chunks, writer reports %" PRIu64 "\n",
+                nb_dropped, picoquic_binlog_writer_dropped(writer));
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        size_t actual_length = 0;
+
+        if ((F = picoquic_file_open(BINLOG_RING_TEST_FILE, "rb")) == NULL) {
+            ret = -1;
+        }
+        else {
+            actual_length = fread(actual, 1, BINLOG_RING_TEST_CHUNKS * sizeof(chunk), F);
+            F = picoquic_file_close(F);
+        }
+        if (ret == 0 && (actual_length != expected_length || memcmp(actual, expected, expected_length) != 0)) {
+            DBG_PRINTF("Ring test file has %zu bytes, expected %zu\n", actual_length, expected_length);
+            ret = -1;
+        }
+    }
+
+    if (F != NULL) {
+        (void)picoquic_file_close(F);
+    }
+    picoquic_binlog_writer_delete(writer);
+    free(expected);
+    free(actual);
+
+    return ret;
+}
+
 /* Basic test of connection ID stash, part of migration support  */
 static const picoquic_remote_cnxid_t stash_test_case[] = {
     { NULL,  1,{ { 0, 1, 2, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, 4 },
@@ -23,6 +23,11 @@
 #include "picoquictest_internal.h"
 #include <stdlib.h>
 #include <string.h>
+#ifndef _WINDOWS
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 static char const* test_ticket_file_name = "ticket_store_test.bin";
 static char const* test_token_file_name = "token_store_test.bin";
@@ -703,3 +708,282 @@ int ticket_seed_from_bdp_frame_test() {
     
    return ticket_seed_test_one(2);
 }
+
+/* Shared ticket cache.
+ * Verify the basic put and get operations, LRU eviction in a set, expiry,
+ * replay and compaction of the log file, and sharing of tickets between
+ * QUIC contexts.
+ */
+static char const* ticket_cache_log_name = "ticket_cache_test.log";
+#ifndef _WINDOWS
+static char const* ticket_cache_shm_name = "/picoquic_ticket_cache_test";
+#endif
+
+static int ticket_cache_test_check(picoquic_ticket_cache_t* cache, uint8_t key_id, int should_be_present, uint64_t current_time)
+{
+    int ret = 0;
+    uint8_t key[4] = { 'k', 'e', 'y', key_id };
+    uint8_t value[64];
+    size_t value_length = 0;
+    int is_found = picoquic_ticket_cache_get(cache, key, sizeof(key), value, sizeof(value), &value_length, current_time) == 0;
+
+    if (is_found != should_be_present) {
+        DBG_PRINTF("Key %d: found = %d, expected %d", key_id, is_found, should_be_present);
+        ret = -1;
+    }
+    else if (is_found) {
+        for (size_t i = 0; i < value_length; i++) {
+            if (value[i] != (uint8_t)(key_id + i)) {
+                DBG_PRINTF("Key %d: value mismatch at %d", key_id, (int)i);
+                ret = -1;
+                break;
+            }
+        }
+        if (value_length != (size_t)key_id + 1) {
+            DBG_PRINTF("Key %d: value length %d", key_id, (int)value_length);
+            ret = -1;
+        }
+    }
+
+    return ret;
+}
+
+static int ticket_cache_test_put(picoquic_ticket_cache_t* cache, uint8_t key_id, uint64_t expiry_time, uint64_t current_time)
+{
+    uint8_t key[4] = { 'k', 'e', 'y', key_id };
+    uint8_t value[64];
+
+    for (size_t i = 0; i <= key_id; i++) {
+        value[i] = (uint8_t)(key_id + i);
+    }
+
+    return picoquic_ticket_cache_put(cache, key, sizeof(key), value, (size_t)key_id + 1, expiry_time, current_time);
+}
+
+int ticket_cache_test()
+{
+    int ret = 0;
+    uint64_t simulated_time = 1000000;
+    picoquic_ticket_cache_t* cache = picoquic_ticket_cache_create(8, NULL);
+
+    (void)picoquic_file_delete(ticket_cache_log_name, NULL);
+
+    if (cache == NULL) {
+        DBG_PRINTF("%s", "Cannot create ticket cache");
+        ret = -1;
+    }
+
+    /* With 8 entries, all keys fall in the same set. */
+    for (uint8_t i = 0; ret == 0 && i < 8; i++) {
+        ret = ticket_cache_test_put(cache, i, simulated_time + 1000000, simulated_time);
+    }
+    for (uint8_t i = 0; ret == 0 && i < 8; i++) {
+        ret = ticket_cache_test_check(cache, i, 1, simulated_time);
+    }
+    /* Refresh key 0, then insert key 8: the least recently used key 1 is evicted */
+    if (ret == 0 && (ret = ticket_cache_test_check(cache, 0, 1, simulated_time)) == 0 &&
+        (ret = ticket_cache_test_put(cache, 8, simulated_time + 1000000, simulated_time)) == 0) {
+        for (uint8_t i = 0; ret == 0 && i < 9; i++) {
+            ret = ticket_cache_test_check(cache, i, i != 1, simulated_time);
+        }
+    }
+    /* Entries are not returned after they expire */
+    if (ret == 0) {
+        ret = ticket_cache_test_check(cache, 0, 0, simulated_time + 1000000);
+    }
+
+    if (cache != NULL) {
+        picoquic_ticket_cache_delete(cache);
+        cache = NULL;
+    }
+
+    /* Log replay: updates written by one cache are restored in the next one */
+    if (ret == 0) {
+        uint8_t removed_key[4] = { 'k', 'e', 'y', 3 };
+
+        if ((cache = picoquic_ticket_cache_create(64, NULL)) == NULL ||
+            picoquic_ticket_cache_open_log(cache, ticket_cache_log_name, simulated_time) != 0) {
+            DBG_PRINTF("%s", "Cannot open ticket cache log");
+            ret = -1;
+        }
+        for (uint8_t i = 0; ret == 0 && i < 6; i++) {
+            ret = ticket_cache_test_put(cache, i, (i == 5) ? simulated_time + 10 : simulated_time + 1000000, simulated_time);
+        }
+        if (ret == 0) {
+            ret = picoquic_ticket_cache_remove(cache, removed_key, sizeof(removed_key));
+        }
+        if (cache != NULL) {
+            picoquic_ticket_cache_delete(cache);
+            cache = NULL;
+        }
+    }
+
+    if (ret == 0) {
+        simulated_time += 100;
+        if ((cache = picoquic_ticket_cache_create(64, NULL)) == NULL ||
+            picoquic_ticket_cache_open_log(cache, ticket_cache_log_name, simulated_time) != 0) {
+            DBG_PRINTF("%s", "Cannot replay ticket cache log");
+            ret = -1;
+        }
+        for (uint8_t i = 0; ret == 0 && i < 6; i++) {
+            ret = ticket_cache_test_check(cache, i, i != 3 && i != 5, simulated_time);
+        }
+        /* Compaction keeps the live entries */
+        if (ret == 0 && (ret = picoquic_ticket_cache_compact_log(cache, simulated_time)) == 0) {
+            picoquic_ticket_cache_delete(cache);
+            if ((cache = picoquic_ticket_cache_create(64, NULL)) == NULL ||
+                picoquic_ticket_cache_open_log(cache, ticket_cache_log_name, simulated_time) != 0) {
+                DBG_PRINTF("%s", "Cannot replay compacted log");
+                ret = -1;
+            }
+            for (uint8_t i = 0; ret == 0 && i < 6; i++) {
+                ret = ticket_cache_test_check(cache, i, i != 3 && i != 5, simulated_time);
+            }
+        }
+    }
+
+#ifndef _WINDOWS
+    /* Two handles on the same segment share the log. Compaction triggered through one
+     * handle drops the expired entries, and the records written through the other handle
+     * after the compaction are not lost. */
+    if (ret == 0) {
+        picoquic_ticket_cache_t* shared[2] = { NULL, NULL };
+
+        picoquic_ticket_cache_delete(cache);
+        cache = NULL;
+        (void)shm_unlink(ticket_cache_shm_name);
+        (void)picoquic_file_delete(ticket_cache_log_name, NULL);
+        for (int i = 0; ret == 0 && i < 2; i++) {
+            if ((shared[i] = picoquic_ticket_cache_create(8, ticket_cache_shm_name)) == NULL ||
+                picoquic_ticket_cache_open_log(shared[i], ticket_cache_log_name, simulated_time) != 0) {
+                DBG_PRINTF("Cannot open shared ticket cache %d", i);
+                ret = -1;
+            }
+        }
+        if (ret == 0) {
+            ret = ticket_cache_test_put(shared[0], 0, simulated_time + 10, simulated_time);
+        }
+        /* Enough updates to trigger a compaction, after the expiry of key 0 */
+        simulated_time += 100;
+        for (int i = 0; ret == 0 && i < 64; i++) {
+            ret = ticket_cache_test_put(shared[1], (uint8_t)(1 + (i % 6)), simulated_time + 1000000, simulated_time);
+        }
+        if (ret == 0) {
+            ret = ticket_cache_test_put(shared[0], 7, simulated_time + 1000000, simulated_time);
+        }
+        for (int i = 0; i < 2; i++) {
+            if (shared[i] != NULL) {
+                picoquic_ticket_cache_delete(shared[i]);
+            }
+        }
+
+        /* The handle that created the segment unlinks it */
+        if (ret == 0) {
+            int fd = shm_open(ticket_cache_shm_name, O_RDWR, 0600);
+            if (fd >= 0) {
+                DBG_PRINTF("%s", "Shared ticket cache segment not unlinked");
+                close(fd);
+                ret = -1;
+            }
+        }
+
+        /* A segment left unsized by a creator that crashed is not attached, and does not block */
+        if (ret == 0) {
+            int fd = shm_open(ticket_cache_shm_name, O_RDWR | O_CREAT, 0600);
+            if (fd < 0) {
+                DBG_PRINTF("%s", "Cannot create the stale segment");
+                ret = -1;
+            }
+            else {
+                close(fd);
+                if ((shared[0] = picoquic_ticket_cache_create(8, ticket_cache_shm_name)) != NULL) {
+                    DBG_PRINTF("%s", "Attached to a segment that was never sized");
+                    picoquic_ticket_cache_delete(shared[0]);
+                    ret = -1;
+                }
+            }
+        }
+        (void)shm_unlink(ticket_cache_shm_name);
+
+        /* Replay at time 0, so that the expired key would be found if it was still logged */
+        if (ret == 0) {
+            if ((cache = picoquic_ticket_cache_create(64, NULL)) == NULL ||
+                picoquic_ticket_cache_open_log(cache, ticket_cache_log_name, 0) != 0) {
+                DBG_PRINTF("%s", "Cannot replay shared ticket cache log");
+                ret = -1;
+            }
+            for (uint8_t i = 0; ret == 0 && i < 8; i++) {
+                ret = ticket_cache_test_check(cache, i, i != 0, 0);
+            }
+        }
+    }
+#endif
+
+    /* Tickets issued by one server context are visible in another context sharing the cache,
+     * and client tickets can be retrieved from the cache. */
+    if (ret == 0) {
+        picoquic_quic_t* quic[2];
+        uint8_t ip_addr[4] = { 10, 0, 0, 1 };
+        uint8_t ticket[64];
+        picoquic_stored_ticket_t* stored = NULL;
+        picoquic_issued_ticket_t* issued = NULL;
+
+        for (int i = 0; i < 2; i++) {
+            quic[i] = picoquic_create(8, NULL, NULL, NULL, "test", NULL, NULL, NULL, NULL,
+                NULL, 0, &simulated_time, NULL, NULL, 0);
+            if (quic[i] == NULL) {
+                ret = -1;
+            }
+            else {
+                picoquic_set_ticket_cache(quic[i], cache);
+            }
+        }
+
+        if (ret == 0) {
+            ret = picoquic_remember_issued_ticket(quic[0], 0x123456789ull, 20000, 150000, ip_addr, sizeof(ip_addr));
+        }
+        if (ret == 0) {
+            issued = picoquic_retrieve_issued_ticket(quic[1], 0x123456789ull);
+            if (issued == NULL || issued->rtt != 20000 || issued->cwin != 150000 ||
+                issued->ip_addr_length != sizeof(ip_addr) || memcmp(issued->ip_addr, ip_addr, sizeof(ip_addr)) != 0) {
+                DBG_PRINTF("%s", "Issued ticket not shared between contexts");
+                ret = -1;
+            }
+        }
+
+        if (ret == 0 && (ret = create_test_ticket(1000, 3600, ticket, sizeof(ticket))) == 0) {
+            ret = picoquic_cache_client_ticket(cache, simulated_time, test_sni[0], (uint16_t)strlen(test_sni[0]),
+                test_alpn[0], (uint16_t)strlen(test_alpn[0]), test_version[0], ticket, sizeof(ticket), &test_tp);
+        }
+        if (ret == 0) {
+            stored = picoquic_get_cached_client_ticket(cache, simulated_time, test_sni[0], (uint16_t)strlen(test_sni[0]),
+                test_alpn[0], (uint16_t)strlen(test_alpn[0]), test_version[0], 0);
+            if (stored == NULL || stored->ticket_length != sizeof(ticket) ||
+                memcmp(stored->ticket, ticket, sizeof(ticket)) != 0 ||
+                stored->tp_0rtt[picoquic_tp_0rtt_max_data] != test_tp.initial_max_data) {
+                DBG_PRINTF("%s", "Client ticket not found in cache");
+                ret = -1;
+            }
+            else if (picoquic_get_cached_client_ticket(cache, simulated_time, test_sni[1], (uint16_t)strlen(test_sni[1]),
+                test_alpn[0], (uint16_t)strlen(test_alpn[0]), test_version[0], 0) != NULL) {
+                DBG_PRINTF("%s", "Unexpected client ticket for other SNI");
+                ret = -1;
+            }
+            if (stored != NULL) {
+                free(stored);
+            }
+        }
+
+        for (int i = 0; i < 2; i++) {
+            if (quic[i] != NULL) {
+                picoquic_free(quic[i]);
+            }
+        }
+    }
+
+    if (cache != NULL) {
+        picoquic_ticket_cache_delete(cache);
+    }
+
+    return ret;
+}
@@ -33,9 +33,14 @@
 #include <string.h>
 #include "picoquic_binlog.h"
 #include "csv.h"
+#include "coltrace.h"
 #include "qlog.h"
 #include "autoqlog.h"
 #include "picoquic_logger.h"
+#include "picoquic_unified_log.h"
+#include "picoquic_metrics.h"
+#include "picoquic_profiler.h"
+#include "picoquic_events.h"
 #include "performance_log.h"
 #include "picoquictest.h"
 
@@ -1189,7 +1194,7 @@ static int tls_api_one_sim_link_arrival(picoquictest_sim_link_t* sim_link, struc
             if (packet->length > 16) {
                 ret = picoquic_incoming_packet(quic, packet->bytes, (uint32_t)packet->length,
                     (struct sockaddr*) & packet->addr_from,
-                    (struct sockaddr*) & packet->addr_to, 0, recv_ecn, simulated_time);
+                    (struct sockaddr*) & packet->addr_to, 0, (packet->ecn_mark != 0) ? packet->ecn_mark : recv_ecn, simulated_time);
                 *was_active |= 1;
             }
         }
@@ -1211,8 +1216,15 @@ int tls_api_one_sim_round(picoquic_test_tls_api_ctx_t* test_ctx,
 {
     int ret = 0;
     picoquictest_sim_link_t* target_link = NULL;
+    picoquic_cnx_t* sending_cnx = NULL;
     int next_action = 0;
 
+    /* With an asynchronous crypto provider, complete the jobs in flight before
+     * choosing the next action, since simulated time does not run while the
+     * provider works. */
+    picoquic_crypto_provider_wait(test_ctx->qclient, *simulated_time);
+    picoquic_crypto_provider_wait(test_ctx->qserver, *simulated_time);
+
     if (test_ctx->qserver->pending_stateless_packet != NULL) {
         next_action = 1;
     }
@@ -1366,6 +1378,7 @@ int tls_api_one_sim_round(picoquic_test_tls_api_ctx_t* test_ctx,
                     else {
                         target_link = test_ctx->c_to_s_link;
                     }
+                    sending_cnx = test_ctx->cnx_client;
                 }
             }
             else if (next_action == 3) {
@@ -1393,6 +1406,7 @@ int tls_api_one_sim_round(picoquic_test_tls_api_ctx_t* test_ctx,
                     else {
                         target_link = test_ctx->s_to_c_link;
                     }
+                    sending_cnx = test_ctx->cnx_server;
                 }
             }
 
@@ -1446,6 +1460,9 @@ int tls_api_one_sim_round(picoquic_test_tls_api_ctx_t* test_ctx,
                                 packet->length = segment_size;
                             }
                             memcpy(packet->bytes, send_buffer, packet->length);
+                            if (target_link->ecn_mark_threshold > 0 && sending_cnx != NULL) {
+                                packet->ecn_mark = picoquic_get_ecn_codepoint(sending_cnx);
+                            }
                             picoquictest_sim_link_submit(target_link, packet, *simulated_time);
                             size_sent += segment_size;
                             send_buffer += segment_size;
@@ -3332,134 +3349,324 @@ int tls_retry_token_valid_test()
     return ret;
 }
 
-int tls_api_retry_test_one(int large_client_hello)
+/* Test of the stateless pre-filter:
+ * - an Initial without token gets a Retry without creating a server context,
+ * - the client accepts the Retry, and its next Initial passes the filter,
+ * - an unknown version gets a version negotiation,
+ * - responses are rate limited per source address,
+ * - in queue mode, responses are sent through picoquic_prepare_next_packet_ex,
+ * - short header packets with an unknown CID get a stateless reset.
+ */
+int stateless_prefilter_test()
 {
     uint64_t simulated_time = 0;
-    const uint64_t target_time = 230000ull;
-    uint64_t loss_mask = 0;
     picoquic_test_tls_api_ctx_t* test_ctx = NULL;
-    int ret = tls_api_init_ctx(&test_ctx, 0, PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN, &simulated_time, NULL, NULL, 0, 1, 0);
+    picoquic_prefilter_stats_t stats;
+    uint8_t packet[PICOQUIC_MAX_PACKET_SIZE];
+    uint8_t response[PICOQUIC_MAX_PACKET_SIZE];
+    size_t packet_length = 0;
+    size_t response_length = 0;
+    struct sockaddr_storage addr_to;
+    struct sockaddr_storage addr_from;
+    struct sockaddr_in flood_addr;
+    int ret = tls_api_init_ctx(&test_ctx, 0, PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN,
+        &simulated_time, NULL, NULL, 0, 0, 0);
 
     if (ret == 0) {
-        if (large_client_hello) {
-            test_ctx->cnx_client->test_large_chello = 1;
+        picoquic_set_cookie_mode(test_ctx->qserver, 1);
+        ret = picoquic_prepare_packet(test_ctx->cnx_client, simulated_time, packet, sizeof(packet), &packet_length,
+            &addr_to, &addr_from, NULL);
+        if (ret == 0 && picoquic_stateless_prefilter(test_ctx->qserver, packet, packet_length,
+            (struct sockaddr*)&test_ctx->client_addr, (struct sockaddr*)&test_ctx->server_addr, 0, simulated_time,
+            response, sizeof(response), &response_length) != PICOQUIC_PREFILTER_CONSUMED) {
+            DBG_PRINTF("%s", "First initial not consumed by the pre-filter\n");
+            ret = -1;
+        }
+        else if (response_length == 0 || test_ctx->qserver->cnx_list != NULL) {
+            DBG_PRINTF("Expected a retry and no context, got %zu bytes\n", response_length);
+            ret = -1;
         }
-        ret = picoquic_start_client_cnx(test_ctx->cnx_client);
     }
 
+    if (ret == 0) {
+        /* The client must accept the retry, and retry with a token */
+        (void)picoquic_incoming_packet(test_ctx->qclient, response, response_length,
+            (struct sockaddr*)&test_ctx->server_addr, (struct sockaddr*)&test_ctx->client_addr, 0, 0, simulated_time);
+        if (test_ctx->cnx_client->retry_token_length == 0) {
+            DBG_PRINTF("%s", "Client did not accept the retry\n");
+            ret = -1;
+        }
+        else {
+            simulated_time += 1000;
+            ret = picoquic_prepare_packet(test_ctx->cnx_client, simulated_time, packet, sizeof(packet), &packet_length,
+                &addr_to, &addr_from, NULL);
+        }
+        if (ret == 0 && picoquic_stateless_prefilter(test_ctx->qserver, packet, packet_length,
+            (struct sockaddr*)&test_ctx->client_addr, (struct sockaddr*)&test_ctx->server_addr, 0, simulated_time,
+            response, sizeof(response), &response_length) != PICOQUIC_PREFILTER_PASS) {
+            DBG_PRINTF("%s", "Initial with token not passed by the pre-filter\n");
+            ret = -1;
+        }
+        else if (ret == 0) {
+            (void)picoquic_incoming_packet(test_ctx->qserver, packet, packet_length,
+                (struct sockaddr*)&test_ctx->client_addr, (struct sockaddr*)&test_ctx->server_addr, 0, 0, simulated_time);
+            if (test_ctx->qserver->cnx_list == NULL) {
+                DBG_PRINTF("%s", "Token was not accepted by the server\n");
+                ret = -1;
+            }
+        }
+    }
 
     if (ret == 0) {
-        /* Set the server in HRR/Cookies mode */
-        picoquic_set_cookie_mode(test_ctx->qserver, 1);
-        /* Try the connection */
-        ret = tls_api_connection_loop(test_ctx, &loss_mask, 0, &simulated_time);
+        /* Unknown version, from a new address, then with a burst of 2 and 1 per second */
+        picoquic_set_test_address(&flood_addr, 0x0B0B0B0B, 4433);
+        memset(packet, 0, PICOQUIC_ENFORCED_INITIAL_MTU);
+        packet[0] = 0xC0;
+        picoformat_32(packet + 1, 0x1a2a3a4a);
+        packet[5] = 8;
+        memset(packet + 6, 0x55, 8);
+        packet[14] = 8;
+        memset(packet + 15, 0x66, 8);
+        packet_length = PICOQUIC_ENFORCED_INITIAL_MTU;
+
+        /* The per source limit is disabled by default */
+        for (int i = 0; ret == 0 && i < 64; i++) {
+            if (picoquic_stateless_prefilter(test_ctx->qserver, packet, packet_length,
+                (struct sockaddr*)&flood_addr, (struct sockaddr*)&test_ctx->server_addr, 0, simulated_time,
+                response, sizeof(response), &response_length) != PICOQUIC_PREFILTER_CONSUMED ||
+                response_length == 0) {
+                DBG_PRINTF("No response to unknown version without rate limit, round %d\n", i);
+                ret = -1;
+            }
+        }
+        picoquic_set_stateless_rate_limit(test_ctx->qserver, 1, 2);
+
+        for (int i = 0; ret == 0 && i < 3; i++) {
+            if (picoquic_stateless_prefilter(test_ctx->qserver, packet, packet_length,
+                (struct sockaddr*)&flood_addr, (struct sockaddr*)&test_ctx->server_addr, 0, simulated_time,
+                response, sizeof(response), &response_length) != PICOQUIC_PREFILTER_CONSUMED) {
+                DBG_PRINTF("Unknown version not consumed, round %d\n", i);
+                ret = -1;
+            }
+            else if ((i < 2) != (response_length > 0) || (i < 2 && PICOPARSE_32(response + 1) != 0)) {
+                DBG_PRINTF("Unexpected response to unknown version, round %d\n", i);
+                ret = -1;
+            }
+        }
     }
 
     if (ret == 0) {
-        ret = tls_api_attempt_to_close(test_ctx, &simulated_time);
+        /* Queue mode: the response is sent by the regular prepare loop. */
+        picoquic_set_stateless_rate_limit(test_ctx->qserver, 0, 0);
+        if (picoquic_stateless_prefilter(test_ctx->qserver, packet, packet_length,
+            (struct sockaddr*)&flood_addr, (struct sockaddr*)&test_ctx->server_addr, 0, simulated_time,
+            NULL, 0, NULL) != PICOQUIC_PREFILTER_CONSUMED || test_ctx->qserver->pending_stateless_packet == NULL) {
+            DBG_PRINTF("%s", "Version negotiation not queued\n");
+            ret = -1;
+        }
+        else {
+            struct sockaddr_storage q_addr_to;
+            struct sockaddr_storage q_addr_from;
+            picoquic_connection_id_t log_cid;
+            picoquic_cnx_t* last_cnx = NULL;
+            int if_index = 0;
+
+            ret = picoquic_prepare_next_packet_ex(test_ctx->qserver, simulated_time, response, sizeof(response),
+                &response_length, &q_addr_to, &q_addr_from, &if_index, &log_cid, &last_cnx, NULL);
+            if (ret == 0 && (response_length == 0 || PICOPARSE_32(response + 1) != 0 ||
+                picoquic_compare_addr((struct sockaddr*)&q_addr_to, (struct sockaddr*)&flood_addr) != 0)) {
+                DBG_PRINTF("%s", "Queued version negotiation not sent\n");
+                ret = -1;
+            }
+        }
     }
 
-    if (ret == 0 && simulated_time > target_time) {
-        DBG_PRINTF("Retry test completes in %llu microsec, more than %llu\n", simulated_time, target_time);
-        ret = -1;
+    if (ret == 0) {
+        /* Short header packet for an unknown connection */
+        packet[0] = 0x40;
+        packet_length = 128;
+        if (picoquic_stateless_prefilter(test_ctx->qserver, packet, packet_length,
+            (struct sockaddr*)&flood_addr, (struct sockaddr*)&test_ctx->server_addr, 0, simulated_time,
+            response, sizeof(response), &response_length) != PICOQUIC_PREFILTER_CONSUMED ||
+            response_length == 0 || response_length >= packet_length) {
+            DBG_PRINTF("%s", "Expected a stateless reset\n");
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        picoquic_get_prefilter_stats(test_ctx->qserver, &stats);
+        if (stats.nb_retry != 1 || stats.nb_version_negotiation != 67 || stats.nb_rate_limited != 1 ||
+            stats.nb_stateless_reset != 1 || stats.nb_passed == 0) {
+            DBG_PRINTF("Unexpected stats: retry %" PRIu64 ", vn %" PRIu64 ", limited %" PRIu64 ", reset %" PRIu64 "\n",
+                stats.nb_retry, stats.nb_version_negotiation, stats.nb_rate_limited, stats.nb_stateless_reset);
+            ret = -1;
+        }
     }
 
     if (test_ctx != NULL) {
         tls_api_delete_ctx(test_ctx);
-        test_ctx = NULL;
     }
 
     return ret;
 }
 
-int tls_api_retry_test()
-{
-    return tls_api_retry_test_one(0);
-}
-
-int tls_api_retry_large_test()
-{
-    return tls_api_retry_test_one(1);
-}
-/*
-* verify that a connection is correctly established
-* if the client does not initially provide a key share
-*/
-
-int tls_zero_share_test()
+/* Create a test context in which the client has a certificate and the
+ * server requires client authentication.
+ */
+static int tls_api_client_authentication_init(picoquic_test_tls_api_ctx_t** p_test_ctx, uint64_t* simulated_time)
 {
-    uint64_t simulated_time = 0;
-    uint64_t loss_mask = 0;
     picoquic_test_tls_api_ctx_t* test_ctx = NULL;
-    int ret = tls_api_init_ctx(&test_ctx, 0, PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN, &simulated_time, NULL, NULL, 1, 0, 0);
+    char test_server_cert_file[512];
+    char test_server_key_file[512];
+    char test_server_cert_store_file[512];
+    int ret = picoquic_get_input_path(test_server_cert_file, sizeof(test_server_cert_file), picoquic_solution_dir, PICOQUIC_TEST_FILE_SERVER_CERT);
 
     if (ret == 0) {
-        ret = tls_api_connection_loop(test_ctx, &loss_mask, 0, &simulated_time);
+        ret = picoquic_get_input_path(test_server_key_file, sizeof(test_server_key_file), picoquic_solution_dir, PICOQUIC_TEST_FILE_SERVER_KEY);
     }
 
     if (ret == 0) {
-        ret = tls_api_attempt_to_close(test_ctx, &simulated_time);
+        ret = picoquic_get_input_path(test_server_cert_store_file, sizeof(test_server_cert_store_file), picoquic_solution_dir, PICOQUIC_TEST_FILE_CERT_STORE);
     }
 
-    if (test_ctx != NULL) {
-        tls_api_delete_ctx(test_ctx);
-        test_ctx = NULL;
+    if (ret != 0) {
+        DBG_PRINTF("%s", "Cannot set the cert, key or store file names.\n");
+    }
+    else {
+        ret = tls_api_init_ctx(&test_ctx, 0, PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN, simulated_time, NULL, NULL, 0, 0, 0);
+    }
+
+    if (ret == 0 && test_ctx == NULL) {
+        ret = -1;
+    }
+
+    /* Delete the client context, and recreate with a certificate */
+    if (ret == 0)
+    {
+        if (test_ctx->qclient != NULL) {
+            picoquic_free(test_ctx->qclient);
+            test_ctx->cnx_client = NULL;
+        }
+
+        test_ctx->qclient = picoquic_create(8,
+            test_server_cert_file, test_server_key_file, test_server_cert_store_file,
+            NULL, test_api_callback, (void*)&test_ctx->client_callback, NULL, NULL, NULL,
+            *simulated_time, simulated_time, NULL, NULL, 0);
+
+        if (test_ctx->qclient == NULL) {
+            ret = -1;
+        }
+        else {
+            /* Enforce client only mode on the client side. */
+            picoquic_enforce_client_only(test_ctx->qclient, 1);
+        }
+    }
+
+    /* recreate the client connection */
+    if (ret == 0) {
+        test_ctx->cnx_client = picoquic_create_cnx(test_ctx->qclient, picoquic_null_connection_id,
+                                                   picoquic_null_connection_id,
+                                                   (struct sockaddr*)&test_ctx->server_addr, 0,
+                                                   0, PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN, 1);
+
+        if (test_ctx->cnx_client == NULL) {
+            ret = -1;
+        } else {
+            ret = picoquic_start_client_cnx(test_ctx->cnx_client);
+        }
+    }
+
+    if (ret == 0) {
+        picoquic_set_client_authentication(test_ctx->qserver, 1);
     }
 
+    *p_test_ctx = test_ctx;
+
     return ret;
 }
 
-
-/*
- * Test two successive connections from the same client.
+/* Asynchronous certificate signing: the server handshake is parked while
+ * the signing threads compute the signature, and resumes when the result
+ * is polled. The connection must complete as with inline signing, including
+ * when the server requires client authentication.
  */
-
-int tls_api_two_connections_test()
+static int async_sign_test_one(int client_authentication)
 {
     uint64_t simulated_time = 0;
     uint64_t loss_mask = 0;
     picoquic_test_tls_api_ctx_t* test_ctx = NULL;
-    int ret = tls_api_init_ctx(&test_ctx, 0, PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN, &simulated_time, NULL, NULL, 0, 0, 0);
+    int nb_trials = 0;
+    int nb_inactive = 0;
+    int nb_suspended = 0;
+    int ret = (client_authentication) ? tls_api_client_authentication_init(&test_ctx, &simulated_time) :
+        tls_api_init_ctx(&test_ctx, 0, PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN,
+        &simulated_time, NULL, NULL, 0, 0, 0);
 
     if (ret == 0) {
-        ret = tls_api_connection_loop(test_ctx, &loss_mask, 0, &simulated_time);
+        ret = picoquic_set_async_signing(test_ctx->qserver, 2, 4);
     }
 
     if (ret == 0) {
-        /* Verify that the connection is fully established */
-        uint64_t target_time = simulated_time + 2000000;
-
-        while (ret == 0 && TEST_CLIENT_READY && TEST_SERVER_READY && simulated_time < target_time) {
-            int was_active = 0;
-            ret = tls_api_one_sim_round(test_ctx, &simulated_time, target_time, &was_active);
-        }
+        test_ctx->c_to_s_link->loss_mask = &loss_mask;
+        test_ctx->s_to_c_link->loss_mask = &loss_mask;
+    }
 
-        /* Delete the client connection from the client context,
-         * without sending notification to the server */
-        while (test_ctx->qclient->cnx_list != NULL) {
-            picoquic_delete_cnx(test_ctx->qclient->cnx_list);
-        }
+    while (ret == 0 && nb_trials < 1024 && nb_inactive < 512 && (!TEST_CLIENT_READY || !TEST_SERVER_READY)) {
+        int was_active = 0;
+        nb_trials++;
 
-        /* Erase the server connection reference */
-        test_ctx->cnx_server = NULL;
+        if (test_ctx->cnx_server != NULL && test_ctx->cnx_server->is_signature_pending) {
+            /* Wait for the signing thread, polling every millisecond for at most 5000 polls.
+             * Simulated time advances with each poll, as it would in a packet loop. */
+            int nb_polls = 0;
 
-        /* Create a new connection in the client context */
+            nb_suspended++;
+            while (picoquic_poll_async_signatures(test_ctx->qserver, simulated_time) == 0) {
+                if (++nb_polls >= 5000) {
+                    DBG_PRINTF("Signature not completed after %d polls\n", nb_polls);
+                    ret = -1;
+                    break;
+                }
+#ifdef _WINDOWS
+                Sleep(1);
+#else
+                usleep(1000);
+#endif
+                simulated_time += 1000;
+            }
+            if (ret == 0 && test_ctx->cnx_server->is_signature_pending) {
+                DBG_PRINTF("%s", "Handshake still suspended after signature completion\n");
+                ret = -1;
+            }
+        }
 
-        test_ctx->cnx_client = picoquic_create_cnx(test_ctx->qclient,
-            picoquic_null_connection_id, picoquic_null_connection_id,
-            (struct sockaddr*)&test_ctx->server_addr, simulated_time, 0, PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN, 1);
+        if (ret == 0) {
+            ret = tls_api_one_sim_round(test_ctx, &simulated_time, 0, &was_active);
+        }
 
-        if (test_ctx->cnx_client == NULL) {
-            ret = -1;
+        if (was_active) {
+            nb_inactive = 0;
         }
         else {
-            ret = picoquic_start_client_cnx(test_ctx->cnx_client);
+            nb_inactive++;
         }
     }
 
-    /* Now, restart a connection in the same context */
-    if (ret == 0) {
-        ret = tls_api_connection_loop(test_ctx, &loss_mask, 0, &simulated_time);
+    if (ret == 0 && (!TEST_CLIENT_READY || !TEST_SERVER_READY)) {
+        DBG_PRINTF("Connection not established, client state %d, server state %d\n",
+            test_ctx->cnx_client->cnx_state, (test_ctx->cnx_server == NULL) ? -1 : (int)test_ctx->cnx_server->cnx_state);
+        ret = -1;
+    }
+
+    if (ret == 0 && nb_suspended != 1) {
+        DBG_PRINTF("Expected one suspended handshake, got %d\n", nb_suspended);
+        ret = -1;
+    }
+
+    if (ret == 0 && picoquic_has_pending_signatures(test_ctx->qserver)) {
+        DBG_PRINTF("%s", "Signature job not released\n");
+        ret = -1;
     }
 
     if (ret == 0) {
@@ -3468,75 +3675,300 @@ int tls_api_two_connections_test()
 
     if (test_ctx != NULL) {
         tls_api_delete_ctx(test_ctx);
-        test_ctx = NULL;
     }
 
     return ret;
 }
 
-int tls_api_client_first_loss_test()
-{
-    return tls_api_loss_test(1ull);
-}
-
-int tls_api_client_second_loss_test()
-{
-    return tls_api_loss_test(2ull);
-}
-
-int tls_api_server_first_loss_test()
-{
-    return tls_api_loss_test(14ull);
-}
-
-int tls_api_client_losses_test()
-{
-    return tls_api_loss_test(3ull);
-}
-
-int tls_api_server_losses_test()
+int async_sign_test()
 {
-    return tls_api_loss_test(6ull);
+    return async_sign_test_one(0);
 }
 
-/*
- * Do a simple test for all supported versions
- */
-int tls_api_multiple_versions_test()
+int async_sign_client_auth_test()
 {
-    int ret = 0;
-
-    for (size_t i = 1; ret == 0 && i < picoquic_nb_supported_versions; i++) {
-        ret = tls_api_one_scenario_test(test_scenario_q_and_r, sizeof(test_scenario_q_and_r), 0, 0, 0, 0,
-            picoquic_supported_versions[i].version, 0, NULL, NULL);
-    }
-
-    return ret;
+    return async_sign_test_one(1);
 }
 
-/*
- * Keep alive test.
+/* Delete the server connection after its signature is computed, but before
+ * the handshake is resumed. The completed job must be released with the
+ * connection, and the next poll must not resume it.
  */
-
-int keep_alive_test_impl(int keep_alive)
+int async_sign_delete_test()
 {
     uint64_t simulated_time = 0;
-    const uint64_t keep_alive_interval = 0; /* Will use the default value */
     uint64_t loss_mask = 0;
     picoquic_test_tls_api_ctx_t* test_ctx = NULL;
-    int ret = tls_api_init_ctx(&test_ctx, 0, PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN, &simulated_time, NULL, NULL, 0, 0, 0);
-    int was_active = 0;
-
-    if (ret == 0 && test_ctx == NULL) {
-        return PICOQUIC_ERROR_MEMORY;
-    }
-
-    /*
-     * setup the connections.
-     */
+    int nb_trials = 0;
+    int ret = tls_api_init_ctx(&test_ctx, 0, PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN,
+        &simulated_time, NULL, NULL, 0, 0, 0);
 
     if (ret == 0) {
-        ret = tls_api_connection_loop(test_ctx, &loss_mask, 0, &simulated_time);
+        ret = picoquic_set_async_signing(test_ctx->qserver, 1, 1);
+    }
+
+    if (ret == 0) {
+        test_ctx->c_to_s_link->loss_mask = &loss_mask;
+        test_ctx->s_to_c_link->loss_mask = &loss_mask;
+    }
+
+    while (ret == 0 && nb_trials < 1024 &&
+        (test_ctx->cnx_server == NULL || !test_ctx->cnx_server->is_signature_pending)) {
+        int was_active = 0;
+        nb_trials++;
+        ret = tls_api_one_sim_round(test_ctx, &simulated_time, 0, &was_active);
+    }
+
+    if (ret == 0 && (test_ctx->cnx_server == NULL || !test_ctx->cnx_server->is_signature_pending)) {
+        DBG_PRINTF("%s", "Server handshake not suspended\n");
+        ret = -1;
+    }
+
+    if (ret == 0) {
+        /* Wait for the signing thread to complete the job, without polling */
+        int nb_waits = 0;
+
+        while (picoquic_get_completed_signatures(test_ctx->qserver) == 0) {
+            if (++nb_waits >= 5000) {
+                DBG_PRINTF("Signature not completed after %d waits\n", nb_waits);
+                ret = -1;
+                break;
+            }
+#ifdef _WINDOWS
+            Sleep(1);
+#else
+            usleep(1000);
+#endif
+        }
+    }
+
+    if (ret == 0) {
+        picoquic_delete_cnx(test_ctx->cnx_server);
+        test_ctx->cnx_server = NULL;
+
+        if (picoquic_has_pending_signatures(test_ctx->qserver) ||
+            picoquic_get_completed_signatures(test_ctx->qserver) != 0) {
+            DBG_PRINTF("%s", "Completed signature job not released with the connection\n");
+            ret = -1;
+        }
+        else if (picoquic_poll_async_signatures(test_ctx->qserver, simulated_time) != 0) {
+            DBG_PRINTF("%s", "Signature of deleted connection resumed\n");
+            ret = -1;
+        }
+    }
+
+    if (test_ctx != NULL) {
+        tls_api_delete_ctx(test_ctx);
+    }
+
+    return ret;
+}
+
+int tls_api_retry_test_one(int large_client_hello)
+{
+    uint64_t simulated_time = 0;
+    const uint64_t target_time = 230000ull;
+    uint64_t loss_mask = 0;
+    picoquic_test_tls_api_ctx_t* test_ctx = NULL;
+    int ret = tls_api_init_ctx(&test_ctx, 0, PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN, &simulated_time, NULL, NULL, 0, 1, 0);
+
+    if (ret == 0) {
+        if (large_client_hello) {
+            test_ctx->cnx_client->test_large_chello = 1;
+        }
+        ret = picoquic_start_client_cnx(test_ctx->cnx_client);
+    }
+
+
+    if (ret == 0) {
+        /* Set the server in HRR/Cookies mode */
+        picoquic_set_cookie_mode(test_ctx->qserver, 1);
+        /* Try the connection */
+        ret = tls_api_connection_loop(test_ctx, &loss_mask, 0, &simulated_time);
+    }
+
+    if (ret == 0) {
+        ret = tls_api_attempt_to_close(test_ctx, &simulated_time);
+    }
+
+    if (ret == 0 && simulated_time > target_time) {
+        DBG_PRINTF("Retry test completes in %llu microsec, more than %llu\n", simulated_time, target_time);
+        ret = -1;
+    }
+
+    if (test_ctx != NULL) {
+        tls_api_delete_ctx(test_ctx);
+        test_ctx = NULL;
+    }
+
+    return ret;
+}
+
+int tls_api_retry_test()
+{
+    return tls_api_retry_test_one(0);
+}
+
+int tls_api_retry_large_test()
+{
+    return tls_api_retry_test_one(1);
+}
+/*
+* verify that a connection is correctly established
+* if the client does not initially provide a key share
+*/
+
+int tls_zero_share_test()
+{
+    uint64_t simulated_time = 0;
+    uint64_t loss_mask = 0;
+    picoquic_test_tls_api_ctx_t* test_ctx = NULL;
+    int ret = tls_api_init_ctx(&test_ctx, 0, PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN, &simulated_time, NULL, NULL, 1, 0, 0);
+
+    if (ret == 0) {
+        ret = tls_api_connection_loop(test_ctx, &loss_mask, 0, &simulated_time);
+    }
+
+    if (ret == 0) {
+        ret = tls_api_attempt_to_close(test_ctx, &simulated_time);
+    }
+
+    if (test_ctx != NULL) {
+        tls_api_delete_ctx(test_ctx);
+        test_ctx = NULL;
+    }
+
+    return ret;
+}
+
+
+/*
+ * Test two successive connections from the same client.
+ */
+
+int tls_api_two_connections_test()
+{
+    uint64_t simulated_time = 0;
+    uint64_t loss_mask = 0;
+    picoquic_test_tls_api_ctx_t* test_ctx = NULL;
+    int ret = tls_api_init_ctx(&test_ctx, 0, PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN, &simulated_time, NULL, NULL, 0, 0, 0);
+
+    if (ret == 0) {
+        ret = tls_api_connection_loop(test_ctx, &loss_mask, 0, &simulated_time);
+    }
+
+    if (ret == 0) {
+        /* Verify that the connection is fully established */
+        uint64_t target_time = simulated_time + 2000000;
+
+        while (ret == 0 && TEST_CLIENT_READY && TEST_SERVER_READY && simulated_time < target_time) {
+            int was_active = 0;
+            ret = tls_api_one_sim_round(test_ctx, &simulated_time, target_time, &was_active);
+        }
+
+        /* Delete the client connection from the client context,
+         * without sending notification to the server */
+        while (test_ctx->qclient->cnx_list != NULL) {
+            picoquic_delete_cnx(test_ctx->qclient->cnx_list);
+        }
+
+        /* Erase the server connection reference */
+        test_ctx->cnx_server = NULL;
+
+        /* Create a new connection in the client context */
+
+        test_ctx->cnx_client = picoquic_create_cnx(test_ctx->qclient,
+            picoquic_null_connection_id, picoquic_null_connection_id,
+            (struct sockaddr*)&test_ctx->server_addr, simulated_time, 0, PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN, 1);
+
+        if (test_ctx->cnx_client == NULL) {
+            ret = -1;
+        }
+        else {
+            ret = picoquic_start_client_cnx(test_ctx->cnx_client);
+        }
+    }
+
+    /* Now, restart a connection in the same context */
+    if (ret == 0) {
+        ret = tls_api_connection_loop(test_ctx, &loss_mask, 0, &simulated_time);
+    }
+
+    if (ret == 0) {
+        ret = tls_api_attempt_to_close(test_ctx, &simulated_time);
+    }
+
+    if (test_ctx != NULL) {
+        tls_api_delete_ctx(test_ctx);
+        test_ctx = NULL;
+    }
+
+    return ret;
+}
+
+int tls_api_client_first_loss_test()
+{
+    return tls_api_loss_test(1ull);
+}
+
+int tls_api_client_second_loss_test()
+{
+    return tls_api_loss_test(2ull);
+}
+
+int tls_api_server_first_loss_test()
+{
+    return tls_api_loss_test(14ull);
+}
+
+int tls_api_client_losses_test()
+{
+    return tls_api_loss_test(3ull);
+}
+
+int tls_api_server_losses_test()
+{
+    return tls_api_loss_test(6ull);
+}
+
+/*
+ * Do a simple test for all supported versions
+ */
+int tls_api_multiple_versions_test()
+{
+    int ret = 0;
+
+    for (size_t i = 1; ret == 0 && i < picoquic_nb_supported_versions; i++) {
+        ret = tls_api_one_scenario_test(test_scenario_q_and_r, sizeof(test_scenario_q_and_r), 0, 0, 0, 0,
+            picoquic_supported_versions[i].version, 0, NULL, NULL);
+    }
+
+    return ret;
+}
+
+/*
+ * Keep alive test.
+ */
+
+int keep_alive_test_impl(int keep_alive)
+{
+    uint64_t simulated_time = 0;
+    const uint64_t keep_alive_interval = 0; /* Will use the default value */
+    uint64_t loss_mask = 0;
+    picoquic_test_tls_api_ctx_t* test_ctx = NULL;
+    int ret = tls_api_init_ctx(&test_ctx, 0, PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN, &simulated_time, NULL, NULL, 0, 0, 0);
+    int was_active = 0;
+
+    if (ret == 0 && test_ctx == NULL) {
+        return PICOQUIC_ERROR_MEMORY;
+    }
+
+    /*
+     * setup the connections.
+     */
+
+    if (ret == 0) {
+        ret = tls_api_connection_loop(test_ctx, &loss_mask, 0, &simulated_time);
     }
 
     /*
@@ -4886,69 +5318,9 @@ int request_client_authentication_test()
     uint64_t simulated_time = 0;
     uint64_t loss_mask = 0;
     picoquic_test_tls_api_ctx_t* test_ctx = NULL;
-    char test_server_cert_file[512];
-    char test_server_key_file[512];
-    char test_server_cert_store_file[512];
-    int ret = picoquic_get_input_path(test_server_cert_file, sizeof(test_server_cert_file), picoquic_solution_dir, PICOQUIC_TEST_FILE_SERVER_CERT);
+    int ret = tls_api_client_authentication_init(&test_ctx, &simulated_time);
 
     if (ret == 0) {
-        ret = picoquic_get_input_path(test_server_key_file, sizeof(test_server_key_file), picoquic_solution_dir, PICOQUIC_TEST_FILE_SERVER_KEY);
-    }
-
-    if (ret == 0) {
-        ret = picoquic_get_input_path(test_server_cert_store_file, sizeof(test_server_cert_store_file), picoquic_solution_dir, PICOQUIC_TEST_FILE_CERT_STORE);
-    }
-
-    if (ret != 0) {
-        DBG_PRINTF("%s", "Cannot set the cert, key or store file names.\n");
-    }
-    else {
-        ret = tls_api_init_ctx(&test_ctx, 0, PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN, &simulated_time, NULL, NULL, 0, 0, 0);
-    }
-
-    if (ret == 0 && test_ctx == NULL) {
-        ret = -1;
-    }
-
-    /* Delete the client context, and recreate with a certificate */
-    if (ret == 0)
-    {
-        if (test_ctx->qclient != NULL) {
-            picoquic_free(test_ctx->qclient);
-            test_ctx->cnx_client = NULL;
-        }
-
-        test_ctx->qclient = picoquic_create(8,
-            test_server_cert_file, test_server_key_file, test_server_cert_store_file,
-            NULL, test_api_callback, (void*)&test_ctx->client_callback, NULL, NULL, NULL,
-            simulated_time, &simulated_time, NULL, NULL, 0);
-
-        if (test_ctx->qclient == NULL) {
-            ret = -1;
-        }
-        else {
-            /* Enforce client only mode on the client side. */
-            picoquic_enforce_client_only(test_ctx->qclient, 1);
-        }
-    }
-
-    /* recreate the client connection */
-    if (ret == 0) {
-        test_ctx->cnx_client = picoquic_create_cnx(test_ctx->qclient, picoquic_null_connection_id,
-                                                   picoquic_null_connection_id,
-                                                   (struct sockaddr*)&test_ctx->server_addr, 0,
-                                                   0, PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN, 1);
-
-        if (test_ctx->cnx_client == NULL) {
-            ret = -1;
-        } else {
-            ret = picoquic_start_client_cnx(test_ctx->cnx_client);
-        }
-    }
-
-    if (ret == 0) {
-        picoquic_set_client_authentication(test_ctx->qserver, 1);
-        
         /* Proceed with the connection loop. */
         ret = tls_api_connection_loop(test_ctx, &loss_mask, 0, &simulated_time);
     }
@@ -8045,7 +8417,7 @@ void qlog_trace_cid_fn(picoquic_quic_t* quic, picoquic_connection_id_t cnx_id_lo
     }
 }
 
-int qlog_trace_test_one(int auto_qlog, int keep_binlog, uint8_t recv_ecn)
+int qlog_trace_test_one(int auto_qlog, int keep_binlog, uint8_t recv_ecn, int async_binlog)
 {
     uint64_t simulated_time = 0;
     picoquic_test_tls_api_ctx_t* test_ctx = NULL;
@@ -8068,6 +8440,10 @@ int qlog_trace_test_one(int auto_qlog, int keep_binlog, uint8_t recv_ecn)
     (void)picoquic_file_delete(QLOG_TRACE_BIN, NULL);
     (void)picoquic_file_delete(qlog_target, NULL);
 
+    if (ret == 0 && async_binlog) {
+        ret = picoquic_set_binlog_async(test_ctx->qserver, 0x10000, picoquic_binlog_overflow_block);
+    }
+
     /* Set the logging policy on the server side, to store data in the
      * current working directory, and run a basic test scenario */
     if (ret == 0) {
@@ -8163,165 +8539,1166 @@ int qlog_trace_test_one(int auto_qlog, int keep_binlog, uint8_t recv_ecn)
 
 int qlog_trace_test()
 {
-    return qlog_trace_test_one(0, 1, 0);
+    return qlog_trace_test_one(0, 1, 0, 0);
 }
 
 int qlog_trace_only_test()
 {
-    return qlog_trace_test_one(1, 0, 0);
+    return qlog_trace_test_one(1, 0, 0, 0);
 }
 
 int qlog_trace_auto_test()
 {
-    return qlog_trace_test_one(1, 1, 0);
+    return qlog_trace_test_one(1, 1, 0, 0);
 }
 
 int qlog_trace_ecn_test()
 {
-    return qlog_trace_test_one(0, 1, 0x02);
+    return qlog_trace_test_one(0, 1, 0x02, 0);
+}
+
+/* The asynchronous writer shall produce the same logs. In blocking mode, no
+ * event is dropped, and the automatic qlog conversion waits for the log file
+ * to be complete. */
+int qlog_trace_async_test()
+{
+    int ret = qlog_trace_test_one(1, 1, 0, 1);
+
+    if (ret == 0) {
+        ret = qlog_trace_test_one(0, 1, 0, 1);
+    }
+
+    return ret;
 }
 
 /*
- * Test of the performance log production
+ * Test of the indexed conversion. The binary log is mapped and indexed, and
+ * the connection found in the index shall convert to the same qlog as the
+ * sequential reader. With a filter on congestion control events, only the
+ * cc updates and the connection start and end shall be delivered.
  */
+#define QLOG_INDEX_QLOG "qlog_index.qlog"
 
-#ifdef _WINDOWS
-#define PERF_TRACE_CLIENT_TEST_REF "picoquictest\\perf_trace_client_ref.txt"
-#define PERF_TRACE_SERVER_TEST_REF "picoquictest\\perf_trace_server_ref.txt"
-#else
-#define PERF_TRACE_CLIENT_TEST_REF "picoquictest/perf_trace_client_ref.txt"
-#define PERF_TRACE_SERVER_TEST_REF "picoquictest/perf_trace_server_ref.txt"
-#endif
-#define PERF_TRACE_CLIENT "perf_trace_client.csv"
-#define PERF_TRACE_SERVER "perf_trace_server.csv"
-
-int perflog_test()
+static int qlog_index_count_cb(bytestream* s, void* ptr)
 {
-    uint64_t simulated_time = 0;
-    uint64_t loss_mask = 0;
-    uint64_t target_time = 4000000;
-    picoquic_test_tls_api_ctx_t* test_ctx = NULL;
-    picoquic_connection_id_t initial_cid = { {0x9e, 0x8f, 0x08, 0x8a, 0x8c, 0xe0, 0, 0}, 8 };
-    size_t send_buffer_size = 0xFFFF;
-    const uint64_t latency_target = 35000;
-    const uint64_t picosec_per_byte = (1000000ull * 8) / 100;
-    int ret;
+    (*(uint64_t*)ptr)++;
+    return 0;
+}
 
-    (void)picoquic_file_delete(PERF_TRACE_CLIENT, NULL);
-    (void)picoquic_file_delete(PERF_TRACE_SERVER, NULL);
+int qlog_index_test()
+{
+    picoquic_connection_id_t initial_cid = { {1, 2, 3, 4, 5, 6, 7, 8}, 8 };
+    binlog_index_t* index = NULL;
+    binlog_cnx_index_t* cnx = NULL;
+    int ret = qlog_trace_test_one(0, 1, 0, 0);
 
-    ret = tls_api_init_ctx_ex2(&test_ctx, PICOQUIC_INTERNAL_TEST_VERSION_1,
-        PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN, &simulated_time, NULL, NULL, 0, 0, 0, &initial_cid, 8, 0, send_buffer_size);
+    if (ret == 0 && (index = binlog_index_open(QLOG_TRACE_BIN)) == NULL) {
+        DBG_PRINTF("Cannot index %s\n", QLOG_TRACE_BIN);
+        ret = -1;
+    }
 
-    if (ret == 0 && test_ctx == NULL) {
+    if (ret == 0 && (cnx = binlog_index_find(index, &initial_cid)) == NULL) {
+        DBG_PRINTF("%s", "Connection not found in the index\n");
         ret = -1;
     }
 
-    /* Require a performance trace of thee server side */
     if (ret == 0) {
-        picoquic_perflog_setup(test_ctx->qclient, PERF_TRACE_CLIENT);
-        picoquic_perflog_setup(test_ctx->qserver, PERF_TRACE_SERVER);
-        /* Set parameters to simulate random early drop */
-        test_ctx->c_to_s_link->microsec_latency = latency_target;
-        test_ctx->c_to_s_link->picosec_per_byte = picosec_per_byte;
-        test_ctx->s_to_c_link->microsec_latency = latency_target;
-        test_ctx->s_to_c_link->picosec_per_byte = picosec_per_byte;
-        /* Set the CC algorithm to selected value */
-        picoquic_set_default_congestion_algorithm(test_ctx->qserver, picoquic_bbr_algorithm);
+        FILE* f_txtlog = picoquic_file_open(QLOG_INDEX_QLOG, "w");
+
+        if (f_txtlog == NULL) {
+            ret = -1;
+        }
+        else {
+            ret = qlog_convert_index(index, cnx, NULL, f_txtlog);
+            (void)picoquic_file_close(f_txtlog);
+        }
     }
 
     if (ret == 0) {
-        ret = tls_api_connection_loop(test_ctx, &loss_mask, latency_target, &simulated_time);
+        char qlog_trace_test_ref[512];
+
+        ret = picoquic_get_input_path(qlog_trace_test_ref, sizeof(qlog_trace_test_ref), picoquic_solution_dir,
+            QLOG_TRACE_TEST_REF);
+        if (ret == 0) {
+            ret = picoquic_test_compare_text_files(QLOG_INDEX_QLOG, qlog_trace_test_ref);
+        }
     }
 
-    /* Prepare to send data */
     if (ret == 0) {
-        ret = test_api_init_send_recv_scenario(test_ctx, test_scenario_sustained2, sizeof(test_scenario_sustained2));
+        binlog_filter_t filter;
+        uint64_t nb_all = 0;
+        uint64_t nb_cc = 0;
+
+        binlog_filter_init(&filter);
+        filter.category_mask = BINLOG_CATEGORY_CC;
+        ret = binlog_index_read(index, cnx, NULL, qlog_index_count_cb, &nb_all);
+        if (ret == 0) {
+            ret = binlog_index_read(index, cnx, &filter, qlog_index_count_cb, &nb_cc);
+        }
+        if (ret == 0 && (nb_all != cnx->nb_events || nb_cc == 0 || nb_cc >= nb_all)) {
+            DBG_PRINTF("Unexpected event counts, all: %" PRIu64 "/%zu, cc: %" PRIu64 "\n",
+                nb_all, cnx->nb_events, nb_cc);
+            ret = -1;
+        }
     }
 
-    /* Try to complete the data sending loop */
-    if (ret == 0) {
-        ret = tls_api_data_sending_loop(test_ctx, &loss_mask, &simulated_time, 0);
+    if (index != NULL) {
+        binlog_index_close(index);
+    }
+
+    return ret;
+}
+
+/*
+ * Test of the columnar trace. The trace produced from the index shall be
+ * identical to the trace produced from the log file. The trace shall have
+ * a row per packet sent or lost, in time order, and the scan of the lost
+ * column shall find the single loss of the qlog trace scenario.
+ */
+#define COLTRACE_TEST_FILE "coltrace_test.coltrace"
+#define COLTRACE_TEST_FILE2 "coltrace_test2.coltrace"
+
+static int coltrace_test_count_cb(uint64_t row, uint64_t value, void* cbptr)
+{
+    (*(uint64_t*)cbptr)++;
+    return 0;
+}
+
+int coltrace_test()
+{
+    picoquic_connection_id_t initial_cid = { {1, 2, 3, 4, 5, 6, 7, 8}, 8 };
+    binlog_index_t* index = NULL;
+    binlog_cnx_index_t* cnx = NULL;
+    coltrace_reader_t* reader = NULL;
+    uint64_t* values = NULL;
+    size_t nb_values = 0;
+    int ret = qlog_trace_test_one(0, 1, 0, 0);
+
+    if (ret == 0 && ((index = binlog_index_open(QLOG_TRACE_BIN)) == NULL ||
+        (cnx = binlog_index_find(index, &initial_cid)) == NULL)) {
+        DBG_PRINTF("Cannot find the connection in %s\n", QLOG_TRACE_BIN);
+        ret = -1;
     }
 
-    /* verify that the transmission was complete */
     if (ret == 0) {
-        ret = tls_api_one_scenario_body_verify(test_ctx, &simulated_time, target_time);
+        FILE* f_trace = picoquic_file_open(COLTRACE_TEST_FILE, "wb");
+
+        if (f_trace == NULL) {
+            ret = -1;
+        }
+        else {
+            ret = coltrace_convert_index(index, cnx, NULL, f_trace);
+            (void)picoquic_file_close(f_trace);
+        }
     }
 
-    /* Free the resource, which will force writing the performance log files. */
+    if (ret == 0) {
+        uint64_t log_time = 0;
+        uint16_t flags;
+        FILE* f_binlog = picoquic_open_cc_log_file_for_read(QLOG_TRACE_BIN, &flags, &log_time);
+        FILE* f_trace = picoquic_file_open(COLTRACE_TEST_FILE2, "wb");
 
-    if (test_ctx != NULL) {
-        tls_api_delete_ctx(test_ctx);
-        test_ctx = NULL;
+        if (f_binlog == NULL || f_trace == NULL) {
+            ret = -1;
+        }
+        else {
+            ret = coltrace_convert(&initial_cid, f_binlog, f_trace);
+        }
+        (void)picoquic_file_close(f_binlog);
+        (void)picoquic_file_close(f_trace);
+
+        if (ret == 0) {
+            ret = picoquic_test_compare_binary_files(COLTRACE_TEST_FILE, COLTRACE_TEST_FILE2);
+        }
     }
 
-    /* Verify that the performance logs are as expected. */
-    for (int i = 0; ret == 0 && i < 2; i++) {
-        char perf_trace_test_ref[512];
+    if (ret == 0 && (reader = coltrace_reader_open(COLTRACE_TEST_FILE)) == NULL) {
+        ret = -1;
+    }
 
-        ret = picoquic_get_input_path(perf_trace_test_ref, sizeof(perf_trace_test_ref), picoquic_solution_dir,
-            (i)?PERF_TRACE_CLIENT_TEST_REF: PERF_TRACE_SERVER_TEST_REF);
+    if (ret == 0) {
+        ret = coltrace_read_column(reader, coltrace_column_by_name(reader, "time"), &values, &nb_values);
+        if (ret == 0 && nb_values == 0) {
+            DBG_PRINTF("%s", "No row in the columnar trace\n");
+            ret = -1;
+        }
+        for (size_t i = 1; ret == 0 && i < nb_values; i++) {
+            if (values[i] < values[i - 1]) {
+                DBG_PRINTF("Time goes back at row %zu\n", i);
+                ret = -1;
+            }
+        }
+        free(values);
+        values = NULL;
+    }
 
-        if (ret != 0) {
-            DBG_PRINTF("Cannot set the perf trace test ref file name for the %s.\n",
-                (i)?"client":"server");
+    if (ret == 0) {
+        uint64_t nb_cwin = 0;
+
+        ret = coltrace_scan_column(reader, coltrace_column_by_name(reader, "cwin"), 1, UINT64_MAX,
+            coltrace_test_count_cb, &nb_cwin);
+        if (ret == 0 && (nb_cwin == 0 || nb_cwin > nb_values)) {
+            DBG_PRINTF("Unexpected number of rows with cwin: %" PRIu64 "\n", nb_cwin);
+            ret = -1;
         }
-        else {
-            ret = picoquic_test_compare_text_files((i)?PERF_TRACE_CLIENT: PERF_TRACE_SERVER, perf_trace_test_ref);
+    }
+
+    if (ret == 0) {
+        uint64_t nb_lost = 0;
+
+        ret = coltrace_scan_column(reader, coltrace_column_by_name(reader, "lost"), 1, 1,
+            coltrace_test_count_cb, &nb_lost);
+        if (ret == 0 && nb_lost != 1) {
+            DBG_PRINTF("Expected 1 lost packet, got %" PRIu64 "\n", nb_lost);
+            ret = -1;
         }
     }
 
+    if (reader != NULL) {
+        coltrace_reader_close(reader);
+    }
+    if (index != NULL) {
+        binlog_index_close(index);
+    }
+
     return ret;
 }
 
-
 /*
- * Testing the flow controlled sending scenario, or "direct sending".
- * Data is sent through the "prepare to send" callback.
- * The "ready to send" test checks the normal operation.
- * The "ready to skip" test checks what happens if at some point the application
- * does not provide any data.
+ * Test of sampled and triggered logging. The server does not sample any
+ * connection, but keeps a flight recorder. The log file shall only be
+ * created when a trigger in the mask fires, and shall then be readable.
  */
+#define LOG_TRIGGER_BIN "1f1e020304050607.server.log"
+#define LOG_TRIGGER_QLOG "log_trigger_test.qlog"
 
-int ready_to_send_test_one(int test_option)
+int log_trigger_test()
 {
-    int ret = 0;
+    uint64_t simulated_time = 0;
+    uint64_t loss_mask = 0;
+    picoquic_test_tls_api_ctx_t* test_ctx = NULL;
+    picoquic_connection_id_t initial_cid = { {0x1f, 0x1e, 2, 3, 4, 5, 6, 7}, 8 };
+    int ret = tls_api_init_ctx_ex(&test_ctx, PICOQUIC_INTERNAL_TEST_VERSION_1, PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN, &simulated_time, NULL, NULL, 0, 1, 0, &initial_cid);
 
-    for (int i = 0; ret == 0 && i < 3; i++) {
-        uint64_t simulated_time = 0;
-        picoquic_test_tls_api_ctx_t* test_ctx = NULL;
+    if (ret == 0 && test_ctx == NULL) {
+        ret = -1;
+    }
 
-        ret = tls_api_one_scenario_init(&test_ctx, &simulated_time,
-            0, NULL, NULL);
+    (void)picoquic_file_delete(LOG_TRIGGER_BIN, NULL);
+    (void)picoquic_file_delete(LOG_TRIGGER_QLOG, NULL);
 
-        if (ret == 0) {
-            test_ctx->stream0_test_option = i;
-            ret = tls_api_one_scenario_body(test_ctx, &simulated_time,
-                test_scenario_q_and_r, sizeof(test_scenario_q_and_r), 1000000, 0, 0, 20000,
-                1200000);
-        }
+    if (ret == 0) {
+        picoquic_set_binlog(test_ctx->qserver, ".");
+        picoquic_set_log_sampling(test_ctx->qserver, 0);
+        picoquic_set_flight_recorder(test_ctx->qserver, 32,
+            picoquic_log_trigger_spurious_burst | picoquic_log_trigger_rto, 0);
+        ret = picoquic_start_client_cnx(test_ctx->cnx_client);
+    }
 
-        if (test_ctx != NULL) {
-            tls_api_delete_ctx(test_ctx);
-            test_ctx = NULL;
+    if (ret == 0) {
+        ret = tls_api_connection_loop(test_ctx, &loss_mask, 0, &simulated_time);
+    }
+
+    if (ret == 0 && (test_ctx->cnx_server == NULL || test_ctx->cnx_server->flight_recorder == NULL ||
+        test_ctx->cnx_server->f_binlog != NULL)) {
+        DBG_PRINTF("%s", "Server connection should only have a flight recorder.\n");
+        ret = -1;
+    }
+
+    /* Triggers not in the mask and isolated spurious retransmits are ignored */
+    if (ret == 0) {
+        picoquic_log_trigger(test_ctx->cnx_server, picoquic_log_trigger_idle_timeout, simulated_time);
+        for (int i = 1; ret == 0 && i < PICOQUIC_LOG_SPURIOUS_BURST; i++) {
+            picoquic_log_trigger(test_ctx->cnx_server, picoquic_log_trigger_spurious_burst, simulated_time);
         }
+        if (test_ctx->cnx_server->f_binlog != NULL) {
+            DBG_PRINTF("%s", "Log file created before trigger.\n");
+            ret = -1;
+        }
+    }
 
-        if (ret != 0) {
-            DBG_PRINTF("Ready to send variant %d fails\n", i);
+    if (ret == 0) {
+        picoquic_log_trigger(test_ctx->cnx_server, picoquic_log_trigger_spurious_burst, simulated_time);
+        if (test_ctx->cnx_server->f_binlog == NULL) {
+            DBG_PRINTF("%s", "Log file not created after trigger.\n");
+            ret = -1;
         }
     }
 
-    return ret;
-}
+    /* Check that sampling selects a fraction of connection IDs */
+    if (ret == 0) {
+        picoquic_connection_id_t saved_cid = test_ctx->cnx_client->initial_cnxid;
+        int nb_sampled = 0;
 
-int ready_to_send_test()
-{
-    int ret = ready_to_send_test_one(1);
-    return ret;
-}
+        picoquic_set_log_sampling(test_ctx->qclient, 4);
+        for (int i = 0; i < 256; i++) {
+            test_ctx->cnx_client->initial_cnxid.id[0] = (uint8_t)i;
+            nb_sampled += picoquic_log_is_sampled(test_ctx->cnx_client);
+        }
+        test_ctx->cnx_client->initial_cnxid = saved_cid;
+        if (nb_sampled < 32 || nb_sampled > 96) {
+            DBG_PRINTF("Sampled %d connections out of 256, expected about 64.\n", nb_sampled);
+            ret = -1;
+        }
+    }
 
-int ready_to_skip_test()
+    if (test_ctx != NULL) {
+        tls_api_delete_ctx(test_ctx);
+        test_ctx = NULL;
+    }
+
+    /* The triggered log must start with the new connection record, and convert */
+    if (ret == 0) {
+        uint64_t log_time = 0;
+        uint16_t flags;
+        FILE* f_binlog = picoquic_open_cc_log_file_for_read(LOG_TRIGGER_BIN, &flags, &log_time);
+        if (f_binlog == NULL) {
+            DBG_PRINTF("Cannot open %s.\n", LOG_TRIGGER_BIN);
+            ret = -1;
+        }
+        else {
+            ret = qlog_convert(&initial_cid, f_binlog, LOG_TRIGGER_BIN, LOG_TRIGGER_QLOG, NULL, flags);
+            picoquic_file_close(f_binlog);
+        }
+    }
+
+    return ret;
+}
+
+/*
+ * Test that the trigger sites in the stack dump the flight recorder. Each
+ * scenario enables a single trigger in the server mask, creates the
+ * condition that the stack detects, and checks that the resulting log
+ * file records that trigger.
+ */
+static test_api_stream_desc_t test_scenario_log_trigger[] = {
+    { 4, 0, 257, 4000000 }
+};
+
+static int log_trigger_file_contains(char const* file_name, char const* text)
+{
+    int found = 0;
+    char line[1024];
+    FILE* F = picoquic_file_open(file_name, "r");
+
+    if (F != NULL) {
+        while (!found && fgets(line, sizeof(line), F) != NULL) {
+            found = (strstr(line, text) != NULL);
+        }
+        picoquic_file_close(F);
+    }
+
+    return found;
+}
+
+static int log_trigger_site_test_one(picoquic_log_trigger_enum trigger, char const* trigger_name, uint8_t cid_id)
+{
+    uint64_t simulated_time = 0;
+    uint64_t loss_mask = 0;
+    uint64_t time_limit = 0;
+    picoquic_test_tls_api_ctx_t* test_ctx = NULL;
+    picoquic_connection_id_t initial_cid = { {0x1f, 0x1e, cid_id, 3, 4, 5, 6, 7}, 8 };
+    char bin_name[64];
+    char qlog_name[64];
+    char expected[64];
+    int was_active = 0;
+    int ret = tls_api_init_ctx_ex(&test_ctx, PICOQUIC_INTERNAL_TEST_VERSION_1, PICOQUIC_TEST_SNI,
+        (trigger == picoquic_log_trigger_handshake_failure) ? PICOQUIC_TEST_WRONG_ALPN : PICOQUIC_TEST_ALPN,
+        &simulated_time, NULL, NULL, 0, 1, 0, &initial_cid);
+
+    if (ret == 0 && test_ctx == NULL) {
+        ret = -1;
+    }
+
+    if (ret == 0) {
+        (void)picoquic_print_connection_id_hexa(bin_name, sizeof(bin_name) - 12, &initial_cid);
+        (void)picoquic_sprintf(bin_name + strlen(bin_name), 12, NULL, ".server.log");
+        (void)picoquic_sprintf(qlog_name, sizeof(qlog_name), NULL, "log_trigger_%s.qlog", trigger_name);
+        (void)picoquic_sprintf(expected, sizeof(expected), NULL, "Log trigger: %s", trigger_name);
+        (void)picoquic_file_delete(bin_name, NULL);
+        (void)picoquic_file_delete(qlog_name, NULL);
+
+        picoquic_set_binlog(test_ctx->qserver, ".");
+        picoquic_set_log_sampling(test_ctx->qserver, 0);
+        /* With an unreachable minimum, any one second window in which the
+         * transfer was cwin limited fires the low throughput trigger. */
+        picoquic_set_flight_recorder(test_ctx->qserver, 32, trigger,
+            (trigger == picoquic_log_trigger_low_throughput) ? UINT64_MAX : 0);
+        if (trigger == picoquic_log_trigger_handshake_failure) {
+            free((void*)test_ctx->qserver->default_alpn);
+            test_ctx->qserver->default_alpn = picoquic_string_duplicate(PICOQUIC_TEST_ALPN);
+        }
+        ret = picoquic_start_client_cnx(test_ctx->cnx_client);
+    }
+
+    if (ret == 0) {
+        ret = tls_api_connection_loop(test_ctx, &loss_mask, 0, &simulated_time);
+    }
+
+    if (ret == 0 && trigger != picoquic_log_trigger_handshake_failure) {
+        if (test_ctx->cnx_server == NULL || test_ctx->cnx_server->cnx_state != picoquic_state_ready ||
+            test_ctx->cnx_server->f_binlog != NULL) {
+            DBG_PRINTF("Server not ready, or log already created before %s scenario.\n", trigger_name);
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        switch (trigger) {
+        case picoquic_log_trigger_rto:
+            /* Start a transfer, then lose everything so the server retransmits on timer */
+            ret = test_api_init_send_recv_scenario(test_ctx, test_scenario_log_trigger, sizeof(test_scenario_log_trigger));
+            for (int i = 0; ret == 0 && i < 64; i++) {
+                ret = tls_api_one_sim_round(test_ctx, &simulated_time, 0, &was_active);
+            }
+            loss_mask = UINT64_MAX;
+            time_limit = simulated_time + 10000000;
+            break;
+        case picoquic_log_trigger_idle_timeout:
+            /* No traffic, wait until the server idle timer expires */
+            time_limit = simulated_time + 300000000;
+            break;
+        case picoquic_log_trigger_low_throughput:
+            ret = test_api_init_send_recv_scenario(test_ctx, test_scenario_log_trigger, sizeof(test_scenario_log_trigger));
+            time_limit = simulated_time + 20000000;
+            break;
+        default:
+            break;
+        }
+    }
+
+    for (int nb_rounds = 0; ret == 0 && simulated_time < time_limit && nb_rounds < 100000 &&
+        test_ctx->cnx_server != NULL && test_ctx->cnx_server->f_binlog == NULL; nb_rounds++) {
+        ret = tls_api_one_sim_round(test_ctx, &simulated_time, time_limit, &was_active);
+    }
+
+    if (test_ctx != NULL) {
+        tls_api_delete_ctx(test_ctx);
+        test_ctx = NULL;
+    }
+
+    /* The log must exist, convert, and record the expected trigger */
+    if (ret == 0) {
+        uint64_t log_time = 0;
+        uint16_t flags;
+        FILE* f_binlog = picoquic_open_cc_log_file_for_read(bin_name, &flags, &log_time);
+        if (f_binlog == NULL) {
+            DBG_PRINTF("No log file %s after %s scenario.\n", bin_name, trigger_name);
+            ret = -1;
+        }
+        else {
+            ret = qlog_convert(&initial_cid, f_binlog, bin_name, qlog_name, NULL, flags);
+            picoquic_file_close(f_binlog);
+        }
+    }
+
+    if (ret == 0 && !log_trigger_file_contains(qlog_name, expected)) {
+        DBG_PRINTF("Trigger %s not found in %s.\n", trigger_name, qlog_name);
+        ret = -1;
+    }
+
+    return ret;
+}
+
+int log_trigger_rto_test()
+{
+    return log_trigger_site_test_one(picoquic_log_trigger_rto, "rto", 0x10);
+}
+
+int log_trigger_idle_test()
+{
+    return log_trigger_site_test_one(picoquic_log_trigger_idle_timeout, "idle_timeout", 0x11);
+}
+
+int log_trigger_handshake_test()
+{
+    return log_trigger_site_test_one(picoquic_log_trigger_handshake_failure, "handshake_failure", 0x12);
+}
+
+int log_trigger_throughput_test()
+{
+    return log_trigger_site_test_one(picoquic_log_trigger_low_throughput, "low_throughput", 0x13);
+}
+
+/*
+ * Test of the live metrics. The histogram buckets shall cover all values
+ * without gaps, and a basic scenario shall update the counters of both
+ * client and server. On Posix systems, the server metrics are published in
+ * a named segment, and read back as an external reader would.
+ */
+#define METRICS_TEST_SEGMENT "/picoquic_metrics_test"
+
+int metrics_test()
+{
+    uint64_t simulated_time = 0;
+    uint64_t loss_mask = 0;
+    picoquic_test_tls_api_ctx_t* test_ctx = NULL;
+    int ret = 0;
+
+    for (uint64_t v = 0; ret == 0 && v < 0x10000; v++) {
+        unsigned int i = picoquic_metrics_bucket_index(v);
+        if (v < picoquic_metrics_bucket_value(i) || v >= picoquic_metrics_bucket_value(i + 1)) {
+            DBG_PRINTF("Value %" PRIu64 " not in bucket %u\n", v, i);
+            ret = -1;
+        }
+    }
+    if (ret == 0 && picoquic_metrics_bucket_index(UINT64_MAX) != PICOQUIC_METRICS_NB_BUCKETS - 1) {
+        DBG_PRINTF("%s", "Largest value not in last bucket.\n");
+        ret = -1;
+    }
+
+    if (ret == 0) {
+        ret = tls_api_init_ctx(&test_ctx, PICOQUIC_INTERNAL_TEST_VERSION_1, PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN,
+            &simulated_time, NULL, NULL, 0, 1, 0);
+        if (ret == 0 && test_ctx == NULL) {
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+#ifdef _WINDOWS
+        ret = picoquic_metrics_enable(test_ctx->qserver, NULL);
+#else
+        ret = picoquic_metrics_enable(test_ctx->qserver, METRICS_TEST_SEGMENT);
+#endif
+        if (ret == 0) {
+            ret = picoquic_metrics_enable(test_ctx->qclient, NULL);
+        }
+    }
+
+    if (ret == 0) {
+        ret = picoquic_start_client_cnx(test_ctx->cnx_client);
+    }
+
+    if (ret == 0) {
+        ret = tls_api_connection_loop(test_ctx, &loss_mask, 0, &simulated_time);
+    }
+
+    if (ret == 0) {
+        ret = tls_api_one_scenario_body(test_ctx, &simulated_time,
+            test_scenario_q_and_r, sizeof(test_scenario_q_and_r), 0, 0, 0, 20000, 1000000);
+    }
+
+    if (ret == 0) {
+        picoquic_metrics_segment_t* client_metrics = picoquic_metrics_get_segment(test_ctx->qclient);
+        picoquic_metrics_segment_t* server_metrics = picoquic_metrics_get_segment(test_ctx->qserver);
+
+        if (client_metrics->counters[picoquic_metric_handshakes_completed] != 1 ||
+            server_metrics->counters[picoquic_metric_handshakes_completed] != 1) {
+            DBG_PRINTF("%s", "Expected one handshake on client and server.\n");
+            ret = -1;
+        }
+        else if (server_metrics->counters[picoquic_metric_packets_in] == 0 ||
+            server_metrics->counters[picoquic_metric_bytes_in] == 0 ||
+            server_metrics->counters[picoquic_metric_bytes_in] > client_metrics->counters[picoquic_metric_bytes_out]) {
+            DBG_PRINTF("%s", "Server received bytes do not match client sent bytes.\n");
+            ret = -1;
+        }
+        else if (server_metrics->histograms[picoquic_metric_rtt_usec].count == 0 ||
+            server_metrics->histograms[picoquic_metric_handshake_usec].count != 1 ||
+            server_metrics->histograms[picoquic_metric_send_loop_cycles].count == 0) {
+            DBG_PRINTF("%s", "Histograms not updated.\n");
+            ret = -1;
+        }
+        else if (server_metrics->gauges[picoquic_metric_connections] != 1) {
+            DBG_PRINTF("%s", "Expected one server connection.\n");
+            ret = -1;
+        }
+#ifndef _WINDOWS
+        else {
+            picoquic_metrics_segment_t const* reader = picoquic_metrics_open_segment(METRICS_TEST_SEGMENT);
+
+            if (reader == NULL) {
+                DBG_PRINTF("Cannot open %s.\n", METRICS_TEST_SEGMENT);
+                ret = -1;
+            }
+            else {
+                if (reader == server_metrics ||
+                    memcmp(reader->counters, server_metrics->counters, sizeof(server_metrics->counters)) != 0) {
+                    DBG_PRINTF("%s", "Reader does not see the server counters.\n");
+                    ret = -1;
+                }
+                picoquic_metrics_close_segment(reader);
+            }
+        }
+#endif
+    }
+
+    if (test_ctx != NULL) {
+        tls_api_delete_ctx(test_ctx);
+        test_ctx = NULL;
+    }
+
+#ifndef _WINDOWS
+    /* The segment is removed when the context is freed */
+    if (ret == 0) {
+        picoquic_metrics_segment_t const* reader = picoquic_metrics_open_segment(METRICS_TEST_SEGMENT);
+        if (reader != NULL) {
+            DBG_PRINTF("%s", "Metrics segment not removed.\n");
+            picoquic_metrics_close_segment(reader);
+            ret = -1;
+        }
+    }
+#endif
+
+    return ret;
+}
+
+/*
+ * Test of the hot path profiler. If the stack was not compiled with
+ * PICOQUIC_WITH_PROFILER, verify that enabling the profiler fails.
+ * Otherwise, verify that the stages are recorded and that the
+ * breakdown can be printed.
+ */
+
+int profiler_test()
+{
+    uint64_t simulated_time = 0;
+    uint64_t loss_mask = 0;
+    picoquic_test_tls_api_ctx_t* test_ctx = NULL;
+    int is_compiled = picoquic_profiler_is_compiled();
+    int ret = tls_api_init_ctx(&test_ctx, PICOQUIC_INTERNAL_TEST_VERSION_1, PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN,
+        &simulated_time, NULL, NULL, 0, 1, 0);
+
+    if (ret == 0 && test_ctx == NULL) {
+        ret = -1;
+    }
+
+    if (ret == 0) {
+        int enable_ret = picoquic_profiler_enable(test_ctx->qserver);
+
+        if (is_compiled) {
+            ret = enable_ret;
+        }
+        else if (enable_ret == 0 || picoquic_profiler_get(test_ctx->qserver) != NULL) {
+            DBG_PRINTF("%s", "Profiler enabled without PICOQUIC_WITH_PROFILER.\n");
+            ret = -1;
+        }
+    }
+
+    if (ret == 0 && is_compiled) {
+        ret = picoquic_start_client_cnx(test_ctx->cnx_client);
+    }
+
+    if (ret == 0 && is_compiled) {
+        ret = tls_api_connection_loop(test_ctx, &loss_mask, 0, &simulated_time);
+    }
+
+    if (ret == 0 && is_compiled) {
+        ret = tls_api_one_scenario_body(test_ctx, &simulated_time,
+            test_scenario_q_and_r, sizeof(test_scenario_q_and_r), 0, 0, 0, 20000, 1000000);
+    }
+
+    if (ret == 0 && is_compiled) {
+        picoquic_profiler_t const* profiler = picoquic_profiler_get(test_ctx->qserver);
+
+        if (profiler->nb_packets_in == 0 ||
+            profiler->stages[picoquic_profile_incoming_packet].count != profiler->nb_packets_in) {
+            DBG_PRINTF("%s", "Incoming packets not profiled.\n");
+            ret = -1;
+        }
+        else if (profiler->stages[picoquic_profile_incoming_segment].count < profiler->nb_packets_in ||
+            profiler->stages[picoquic_profile_decode_frames].count == 0 ||
+            profiler->stages[picoquic_profile_prepare_packet_ready].count == 0 ||
+            profiler->stages[picoquic_profile_protect_packet].count == 0) {
+            DBG_PRINTF("%s", "Some stages are not profiled.\n");
+            ret = -1;
+        }
+        else if (profiler->stages[picoquic_profile_incoming_segment].sum > profiler->stages[picoquic_profile_incoming_packet].sum) {
+            DBG_PRINTF("%s", "Nested stage takes more cycles than the enclosing stage.\n");
+            ret = -1;
+        }
+        else {
+            FILE* F = picoquic_file_open("profiler_test.txt", "w");
+            if (F == NULL) {
+                ret = -1;
+            }
+            else {
+                picoquic_profiler_print(F, test_ctx->qserver);
+                (void)picoquic_file_close(F);
+            }
+        }
+    }
+
+    if (ret == 0 && is_compiled) {
+        picoquic_profiler_reset(test_ctx->qserver);
+        if (picoquic_profiler_get(test_ctx->qserver)->stages[picoquic_profile_incoming_packet].count != 0) {
+            DBG_PRINTF("%s", "Profiler not reset.\n");
+            ret = -1;
+        }
+    }
+
+    if (test_ctx != NULL) {
+        tls_api_delete_ctx(test_ctx);
+        test_ctx = NULL;
+    }
+
+    return ret;
+}
+
+/*
+ * Test of the event channel. All events are counted, the text is limited
+ * to the configured number of lines per period, and the number of lines
+ * suppressed is reported when the next period starts. The counters are
+ * published in the metrics segment.
+ */
+#define EVENTS_TEST_FILE "events_test.txt"
+
+int events_test()
+{
+    int ret = 0;
+    uint64_t current_time = 0;
+    picoquic_quic_t* quic = picoquic_create(8, NULL, NULL, NULL, PICOQUIC_TEST_ALPN, NULL, NULL,
+        NULL, NULL, NULL, current_time, &current_time, NULL, NULL, 0);
+    FILE* F = picoquic_file_open(EVENTS_TEST_FILE, "w");
+
+    if (quic == NULL || F == NULL) {
+        ret = -1;
+    }
+
+    if (ret == 0) {
+        picoquic_connection_id_t cid = { {1, 2, 3, 4, 5, 6, 7, 8}, 8 };
+
+        picoquic_events_set_text(quic, F, 2);
+        for (int i = 0; i < 5; i++) {
+            picoquic_event_signal(quic, picoquic_event_icmp_received, NULL, current_time, "ICMP %d", i);
+        }
+        picoquic_event_signal(quic, picoquic_event_cnx_closed, &cid, current_time, "Closed");
+        picoquic_event_count(quic, picoquic_event_tx_dropped, 32);
+        picoquic_event_text(quic, picoquic_event_tx_dropped, NULL, current_time, "%d packets not sent", 32);
+        current_time += PICOQUIC_EVENT_TEXT_PERIOD;
+        picoquic_event_signal(quic, picoquic_event_icmp_received, NULL, current_time, "ICMP %d", 5);
+
+        if (picoquic_events_get_count(quic, picoquic_event_icmp_received) != 6 ||
+            picoquic_events_get_count(quic, picoquic_event_cnx_closed) != 1 ||
+            picoquic_events_get_count(quic, picoquic_event_tx_dropped) != 32 ||
+            picoquic_events_get_count(quic, picoquic_event_arp_received) != 0) {
+            DBG_PRINTF("%s", "Unexpected event counts\n");
+            ret = -1;
+        }
+    }
+
+    if (F != NULL) {
+        F = picoquic_file_close(F);
+    }
+
+    if (ret == 0) {
+        char const* expected[] = {
+            "icmp_received: ICMP 0\n",
+            "icmp_received: ICMP 1\n",
+            "cnx_closed 0102030405060708: Closed\n",
+            "tx_dropped: 32 packets not sent\n",
+            "icmp_received: 3 messages suppressed\n",
+            "icmp_received: ICMP 5\n"
+        };
+        char line[256];
+        size_t nb_lines = 0;
+
+        F = picoquic_file_open(EVENTS_TEST_FILE, "r");
+        if (F == NULL) {
+            ret = -1;
+        }
+        while (ret == 0 && fgets(line, sizeof(line), F) != NULL) {
+            if (nb_lines >= sizeof(expected) / sizeof(char const*) || strcmp(line, expected[nb_lines]) != 0) {
+                DBG_PRINTF("Unexpected event line %zu: %s", nb_lines, line);
+                ret = -1;
+            }
+            nb_lines++;
+        }
+        if (ret == 0 && nb_lines != sizeof(expected) / sizeof(char const*)) {
+            DBG_PRINTF("Expected %zu event lines, got %zu\n", sizeof(expected) / sizeof(char const*), nb_lines);
+            ret = -1;
+        }
+        if (F != NULL) {
+            F = picoquic_file_close(F);
+        }
+    }
+
+    if (ret == 0) {
+        ret = picoquic_metrics_enable(quic, NULL);
+        if (ret == 0) {
+            picoquic_metrics_publish(quic, current_time);
+            if (picoquic_metrics_get_segment(quic)->events[picoquic_event_icmp_received] != 6) {
+                DBG_PRINTF("%s", "Event counters not published\n");
+                ret = -1;
+            }
+        }
+    }
+
+    if (quic != NULL) {
+        picoquic_free(quic);
+    }
+
+    return ret;
+}
+
+/*
+ * Test of the performance log production
+ */
+
+#ifdef _WINDOWS
+#define PERF_TRACE_CLIENT_TEST_REF "picoquictest\\perf_trace_client_ref.txt"
+#define PERF_TRACE_SERVER_TEST_REF "picoquictest\\perf_trace_server_ref.txt"
+#else
+#define PERF_TRACE_CLIENT_TEST_REF "picoquictest/perf_trace_client_ref.txt"
+#define PERF_TRACE_SERVER_TEST_REF "picoquictest/perf_trace_server_ref.txt"
+#endif
+#define PERF_TRACE_CLIENT "perf_trace_client.csv"
+#define PERF_TRACE_SERVER "perf_trace_server.csv"
+
+int perflog_test()
+{
+    uint64_t simulated_time = 0;
+    uint64_t loss_mask = 0;
+    uint64_t target_time = 4000000;
+    picoquic_test_tls_api_ctx_t* test_ctx = NULL;
+    picoquic_connection_id_t initial_cid = { {0x9e, 0x8f, 0x08, 0x8a, 0x8c, 0xe0, 0, 0}, 8 };
+    size_t send_buffer_size = 0xFFFF;
+    const uint64_t latency_target = 35000;
+    const uint64_t picosec_per_byte = (1000000ull * 8) / 100;
+    int ret;
+
+    (void)picoquic_file_delete(PERF_TRACE_CLIENT, NULL);
+    (void)picoquic_file_delete(PERF_TRACE_SERVER, NULL);
+
+    ret = tls_api_init_ctx_ex2(&test_ctx, PICOQUIC_INTERNAL_TEST_VERSION_1,
+        PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN, &simulated_time, NULL, NULL, 0, 0, 0, &initial_cid, 8, 0, send_buffer_size);
+
+    if (ret == 0 && test_ctx == NULL) {
+        ret = -1;
+    }
+
+    /* Require a performance trace of thee server side */
+    if (ret == 0) {
+        picoquic_perflog_setup(test_ctx->qclient, PERF_TRACE_CLIENT);
+        picoquic_perflog_setup(test_ctx->qserver, PERF_TRACE_SERVER);
+        /* Set parameters to simulate random early drop */
+        test_ctx->c_to_s_link->microsec_latency = latency_target;
+        test_ctx->c_to_s_link->picosec_per_byte = picosec_per_byte;
+        test_ctx->s_to_c_link->microsec_latency = latency_target;
+        test_ctx->s_to_c_link->picosec_per_byte = picosec_per_byte;
+        /* Set the CC algorithm to selected value */
+        picoquic_set_default_congestion_algorithm(test_ctx->qserver, picoquic_bbr_algorithm);
+    }
+
+    if (ret == 0) {
+        ret = tls_api_connection_loop(test_ctx, &loss_mask, latency_target, &simulated_time);
+    }
+
+    /* Prepare to send data */
+    if (ret == 0) {
+        ret = test_api_init_send_recv_scenario(test_ctx, test_scenario_sustained2, sizeof(test_scenario_sustained2));
+    }
+
+    /* Try to complete the data sending loop */
+    if (ret == 0) {
+        ret = tls_api_data_sending_loop(test_ctx, &loss_mask, &simulated_time, 0);
+    }
+
+    /* verify that the transmission was complete */
+    if (ret == 0) {
+        ret = tls_api_one_scenario_body_verify(test_ctx, &simulated_time, target_time);
+    }
+
+    /* Free the resource, which will force writing the performance log files. */
+
+    if (test_ctx != NULL) {
+        tls_api_delete_ctx(test_ctx);
+        test_ctx = NULL;
+    }
+
+    /* Verify that the performance logs are as expected. */
+    for (int i = 0; ret == 0 && i < 2; i++) {
+        char perf_trace_test_ref[512];
+
+        ret = picoquic_get_input_path(perf_trace_test_ref, sizeof(perf_trace_test_ref), picoquic_solution_dir,
+            (i)?PERF_TRACE_CLIENT_TEST_REF: PERF_TRACE_SERVER_TEST_REF);
+
+        if (ret != 0) {
+            DBG_PRINTF("Cannot set the perf trace test ref file name for the %s.\n",
+                (i)?"client":"server");
+        }
+        else {
+            ret = picoquic_test_compare_text_files((i)?PERF_TRACE_CLIENT: PERF_TRACE_SERVER, perf_trace_test_ref);
+        }
+    }
+
+    return ret;
+}
+
+
+/*
+ * Test of the accounting of the time spent in each limiting state of the sender.
+ * The sum of all states must match the duration of the connection, the
+ * server must spend time sending, and the client, which only receives,
+ * must spend time waiting for the application. The server
+ * also writes a version 2 performance log, with the time columns.
+ */
+#define PERF_TRACE_LIMIT_TIME "perf_trace_limit_time.csv"
+
+static int limit_time_check(picoquic_cnx_t* cnx, uint64_t current_time)
+{
+    int ret = 0;
+    uint64_t total = 0;
+
+    for (int i = 0; i < picoquic_limit_max; i++) {
+        total += picoquic_get_limit_time(cnx, (picoquic_limit_state_enum)i, current_time);
+    }
+
+    if (total != current_time - picoquic_get_cnx_start_time(cnx)) {
+        DBG_PRINTF("Limit times add to %" PRIu64 ", expected %" PRIu64, total,
+            current_time - picoquic_get_cnx_start_time(cnx));
+        ret = -1;
+    }
+    else if (picoquic_get_limit_time(cnx, picoquic_limit_handshake, current_time) == 0) {
+        DBG_PRINTF("%s", "No time spent in handshake");
+        ret = -1;
+    }
+    else if (cnx->client_mode) {
+        if (picoquic_get_limit_time(cnx, picoquic_limit_application, current_time) == 0) {
+            DBG_PRINTF("%s", "Client never app limited");
+            ret = -1;
+        }
+    }
+    else if (picoquic_get_limit_time(cnx, picoquic_limit_none, current_time) == 0 ||
+        picoquic_get_limit_time(cnx, picoquic_limit_cwin, current_time) +
+        picoquic_get_limit_time(cnx, picoquic_limit_pacing, current_time) == 0) {
+        DBG_PRINTF("Server not limited %" PRIu64 ", cwin %" PRIu64 ", pacing %" PRIu64,
+            picoquic_get_limit_time(cnx, picoquic_limit_none, current_time),
+            picoquic_get_limit_time(cnx, picoquic_limit_cwin, current_time),
+            picoquic_get_limit_time(cnx, picoquic_limit_pacing, current_time));
+        ret = -1;
+    }
+    return ret;
+}
+
+static int limit_time_check_perflog(char const* perflog_file_name)
+{
+    int ret = 0;
+    int nb_lines = 0;
+    FILE* F = picoquic_file_open(perflog_file_name, "r");
+
+    if (F == NULL) {
+        DBG_PRINTF("Cannot open %s", perflog_file_name);
+        ret = -1;
+    }
+    else {
+        char line[2048];
+
+        while (ret == 0 && fgets(line, sizeof(line), F) != NULL) {
+            int nb_fields = 1;
+            for (size_t i = 0; line[i] != 0; i++) {
+                nb_fields += (line[i] == ',');
+            }
+            if (nb_fields != 11 + PICOQUIC_PERF_LOG_MAX_ITEMS) {
+                DBG_PRINTF("Line %d has %d fields instead of %d", nb_lines, nb_fields, 11 + PICOQUIC_PERF_LOG_MAX_ITEMS);
+                ret = -1;
+            }
+            else if (nb_lines == 0 && strstr(line, ", t_closing") == NULL) {
+                DBG_PRINTF("%s", "No time columns in the header");
+                ret = -1;
+            }
+            else if (nb_lines > 0 && strncmp(line, "2, ", 3) != 0) {
+                DBG_PRINTF("Line %d is not version 2", nb_lines);
+                ret = -1;
+            }
+            nb_lines++;
+        }
+        (void)picoquic_file_close(F);
+        if (ret == 0 && nb_lines != 2) {
+            DBG_PRINTF("Found %d lines in %s instead of 2", nb_lines, perflog_file_name);
+            ret = -1;
+        }
+    }
+    return ret;
+}
+
+int limit_time_test()
+{
+    uint64_t simulated_time = 0;
+    uint64_t loss_mask = 0;
+    const uint64_t latency_target = 35000;
+    picoquic_test_tls_api_ctx_t* test_ctx = NULL;
+    int ret;
+
+    (void)picoquic_file_delete(PERF_TRACE_LIMIT_TIME, NULL);
+
+    ret = tls_api_init_ctx_ex2(&test_ctx, PICOQUIC_INTERNAL_TEST_VERSION_1,
+        PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN, &simulated_time, NULL, NULL, 0, 0, 0, NULL, 8, 0, 0xFFFF);
+
+    if (ret == 0 && test_ctx == NULL) {
+        ret = -1;
+    }
+
+    if (ret == 0) {
+        ret = picoquic_perflog_setup_ex(test_ctx->qserver, PERF_TRACE_LIMIT_TIME, 1);
+    }
+
+    if (ret == 0) {
+        test_ctx->c_to_s_link->microsec_latency = latency_target;
+        test_ctx->c_to_s_link->picosec_per_byte = (1000000ull * 8) / 100;
+        test_ctx->s_to_c_link->microsec_latency = latency_target;
+        test_ctx->s_to_c_link->picosec_per_byte = (1000000ull * 8) / 100;
+        ret = tls_api_connection_loop(test_ctx, &loss_mask, latency_target, &simulated_time);
+    }
+
+    if (ret == 0) {
+        ret = test_api_init_send_recv_scenario(test_ctx, test_scenario_sustained2, sizeof(test_scenario_sustained2));
+    }
+
+    if (ret == 0) {
+        ret = tls_api_data_sending_loop(test_ctx, &loss_mask, &simulated_time, 0);
+    }
+
+    if (ret == 0) {
+        ret = limit_time_check(test_ctx->cnx_client, simulated_time);
+    }
+
+    if (ret == 0) {
+        ret = limit_time_check(test_ctx->cnx_server, simulated_time);
+    }
+
+    if (test_ctx != NULL) {
+        tls_api_delete_ctx(test_ctx);
+        test_ctx = NULL;
+    }
+
+    if (ret == 0) {
+        ret = limit_time_check_perflog(PERF_TRACE_LIMIT_TIME);
+    }
+
+    return ret;
+}
+
+/*
+ * Test of the flow control limiting states. The client sets a small
+ * connection or stream flow control window, so the server spends
+ * time blocked by flow control while sending a long stream.
+ */
+static int limit_time_flow_control_test_one(int stream_limited)
+{
+    uint64_t simulated_time = 0;
+    uint64_t loss_mask = 0;
+    uint64_t total = 0;
+    picoquic_test_tls_api_ctx_t* test_ctx = NULL;
+    picoquic_tp_t client_parameters;
+    picoquic_limit_state_enum expected_state = (stream_limited) ?
+        picoquic_limit_stream_flow_control : picoquic_limit_flow_control;
+    int ret = 0;
+
+    memset(&client_parameters, 0, sizeof(picoquic_tp_t));
+    picoquic_init_transport_parameters(&client_parameters, 1);
+    if (stream_limited) {
+        client_parameters.initial_max_stream_data_bidi_local = 4096;
+    }
+    else {
+        client_parameters.initial_max_data = 40000;
+    }
+
+    ret = tls_api_one_scenario_init_ex(&test_ctx, &simulated_time, PICOQUIC_INTERNAL_TEST_VERSION_1, &client_parameters,
+        NULL, NULL, 0);
+
+    if (ret == 0 && test_ctx == NULL) {
+        ret = -1;
+    }
+
+    if (ret == 0) {
+        /* Keep the connection window at its initial value */
+        test_ctx->cnx_client->is_flow_control_limited = !stream_limited;
+        ret = picoquic_start_client_cnx(test_ctx->cnx_client);
+    }
+
+    if (ret == 0) {
+        ret = tls_api_connection_loop(test_ctx, &loss_mask, 0, &simulated_time);
+    }
+
+    if (ret == 0) {
+        ret = test_api_init_send_recv_scenario(test_ctx, test_scenario_very_long, sizeof(test_scenario_very_long));
+    }
+
+    if (ret == 0) {
+        ret = tls_api_data_sending_loop(test_ctx, &loss_mask, &simulated_time, 0);
+    }
+
+    if (ret == 0) {
+        for (int i = 0; i < picoquic_limit_max; i++) {
+            total += picoquic_get_limit_time(test_ctx->cnx_server, (picoquic_limit_state_enum)i, simulated_time);
+        }
+        if (total != simulated_time - picoquic_get_cnx_start_time(test_ctx->cnx_server)) {
+            DBG_PRINTF("Limit times add to %" PRIu64 ", expected %" PRIu64, total,
+                simulated_time - picoquic_get_cnx_start_time(test_ctx->cnx_server));
+            ret = -1;
+        }
+        else if (picoquic_get_limit_time(test_ctx->cnx_server, expected_state, simulated_time) == 0) {
+            DBG_PRINTF("Server never limited by %s flow control", (stream_limited) ? "stream" : "connection");
+            ret = -1;
+        }
+    }
+
+    if (test_ctx != NULL) {
+        tls_api_delete_ctx(test_ctx);
+        test_ctx = NULL;
+    }
+
+    return ret;
+}
+
+int limit_time_flow_control_test()
+{
+    return limit_time_flow_control_test_one(0);
+}
+
+int limit_time_stream_flow_control_test()
+{
+    return limit_time_flow_control_test_one(1);
+}
+
+/*
+ * Testing the flow controlled sending scenario, or "direct sending".
+ * Data is sent through the "prepare to send" callback.
+ * The "ready to send" test checks the normal operation.
+ * The "ready to skip" test checks what happens if at some point the application
+ * does not provide any data.
+ */
+
+int ready_to_send_test_one(int test_option)
+{
+    int ret = 0;
+
+    for (int i = 0; ret == 0 && i < 3; i++) {
+        uint64_t simulated_time = 0;
+        picoquic_test_tls_api_ctx_t* test_ctx = NULL;
+
+        ret = tls_api_one_scenario_init(&test_ctx, &simulated_time,
+            0, NULL, NULL);
+
+        if (ret == 0) {
+            test_ctx->stream0_test_option = i;
+            ret = tls_api_one_scenario_body(test_ctx, &simulated_time,
+                test_scenario_q_and_r, sizeof(test_scenario_q_and_r), 1000000, 0, 0, 20000,
+                1200000);
+        }
+
+        if (test_ctx != NULL) {
+            tls_api_delete_ctx(test_ctx);
+            test_ctx = NULL;
+        }
+
+        if (ret != 0) {
+            DBG_PRINTF("Ready to send variant %d fails\n", i);
+        }
+    }
+
+    return ret;
+}
+
+int ready_to_send_test()
+{
+    int ret = ready_to_send_test_one(1);
+    return ret;
+}
+
+int ready_to_skip_test()
 {
     int ret = ready_to_send_test_one(3);
     return ret;
@@ -8333,45 +9710,376 @@ int ready_to_zero_test()
     return ret;
 }
 
-int ready_to_zfin_test()
+int ready_to_zfin_test()
+{
+    int ret = ready_to_send_test_one(2);
+    return ret;
+}
+
+static int congestion_control_test(picoquic_congestion_algorithm_t * ccalgo, uint64_t max_completion_time, uint64_t jitter, uint8_t jitter_id)
+{
+    uint64_t simulated_time = 0;
+    picoquic_test_tls_api_ctx_t* test_ctx = NULL;
+    picoquic_connection_id_t initial_cid = { {0xcc, 0xcc, 0, 0, 0, 0, 0, 0}, 8 };
+    int ret;
+
+    initial_cid.id[2] = ccalgo->congestion_algorithm_number;
+    initial_cid.id[3] = jitter_id;
+    
+    ret = tls_api_init_ctx_ex(&test_ctx, PICOQUIC_INTERNAL_TEST_VERSION_1, PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN, &simulated_time, NULL, NULL, 0, 1, 0, &initial_cid);
+
+    if (ret == 0 && test_ctx == NULL) {
+        ret = -1;
+    }
+
+    /* Set the congestion algorithm to specified value. Also, request a packet trace */
+    if (ret == 0) {
+
+        picoquic_set_default_congestion_algorithm(test_ctx->qserver, ccalgo);
+        picoquic_set_congestion_algorithm(test_ctx->cnx_client, ccalgo);
+
+        test_ctx->c_to_s_link->jitter = jitter;
+        test_ctx->s_to_c_link->jitter = jitter;
+
+        picoquic_set_binlog(test_ctx->qserver, ".");
+
+        ret = tls_api_one_scenario_body(test_ctx, &simulated_time,
+            test_scenario_sustained, sizeof(test_scenario_sustained), 0, 0, 0, 20000 + 2*jitter, max_completion_time);
+    }
+
+    /* Free the resource, which will close the log file.
+     */
+
+    if (test_ctx != NULL) {
+        tls_api_delete_ctx(test_ctx);
+        test_ctx = NULL;
+    }
+
+    return ret;
+}
+
+int cubic_test() 
+{
+    return congestion_control_test(picoquic_cubic_algorithm, 3600000, 0, 0);
+}
+
+int cubic_jitter_test()
+{
+    return congestion_control_test(picoquic_cubic_algorithm, 3600000, 5000, 5);
+}
+
+int fastcc_test()
+{
+    return congestion_control_test(picoquic_fastcc_algorithm, 3700000, 0, 0);
+}
+
+int fastcc_jitter_test()
+{
+    return congestion_control_test(picoquic_fastcc_algorithm, 4050000, 5000, 5);
+}
+
+int bbr_test()
+{
+    return congestion_control_test(picoquic_bbr_algorithm, 3600000, 0, 0);
+}
+
+int bbr_jitter_test()
+{
+    return congestion_control_test(picoquic_bbr_algorithm, 3650000, 5000, 5);
+}
+
+int bbr3_test()
+{
+    return congestion_control_test(picoquic_bbr3_algorithm, 3600000, 0, 0);
+}
+
+int bbr3_jitter_test()
+{
+    return congestion_control_test(picoquic_bbr3_algorithm, 3700000, 5000, 5);
+}
+
+/* Shallow buffer test: 10 Mbps link, 10 ms latency, and a drop tail queue
+ * holding only 5 ms of data, i.e. a quarter of the BDP. Measure the completion
+ * time, the number of retransmissions and the average queuing delay.
+ */
+static int bbr3_shallow_one(picoquic_congestion_algorithm_t* cc_algo, uint64_t* completion_time,
+    uint64_t* nb_retransmissions, uint64_t* average_queue_delay)
+{
+    uint64_t simulated_time = 0;
+    uint64_t loss_mask = 0;
+    const uint64_t latency = 10000;
+    const uint64_t queue_delay_max = 5000;
+    const uint64_t picosec_per_byte = (1000000ull * 8) / 10;
+    picoquic_test_tls_api_ctx_t* test_ctx = NULL;
+    picoquic_connection_id_t initial_cid = { {0xb3, 0x5a, 0, 0, 0, 0, 0, 0}, 8 };
+    int ret;
+
+    initial_cid.id[2] = cc_algo->congestion_algorithm_number;
+
+    ret = tls_api_init_ctx_ex(&test_ctx, PICOQUIC_INTERNAL_TEST_VERSION_1,
+        PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN, &simulated_time, NULL, NULL, 0, 0, 0, &initial_cid);
+
+    if (ret == 0 && test_ctx == NULL) {
+        ret = -1;
+    }
+
+    if (ret == 0) {
+        test_ctx->c_to_s_link->microsec_latency = latency;
+        test_ctx->c_to_s_link->queue_delay_max = queue_delay_max;
+        test_ctx->c_to_s_link->picosec_per_byte = picosec_per_byte;
+        test_ctx->s_to_c_link->microsec_latency = latency;
+        test_ctx->s_to_c_link->queue_delay_max = queue_delay_max;
+        test_ctx->s_to_c_link->picosec_per_byte = picosec_per_byte;
+        picoquic_set_default_congestion_algorithm(test_ctx->qserver, cc_algo);
+        picoquic_set_congestion_algorithm(test_ctx->cnx_client, cc_algo);
+        picoquic_set_binlog(test_ctx->qserver, ".");
+
+        ret = tls_api_connection_loop(test_ctx, &loss_mask, 2 * latency, &simulated_time);
+    }
+
+    if (ret == 0) {
+        ret = test_api_init_send_recv_scenario(test_ctx, test_scenario_sustained, sizeof(test_scenario_sustained));
+    }
+
+    if (ret == 0) {
+        ret = tls_api_data_sending_loop(test_ctx, &loss_mask, &simulated_time, 0);
+    }
+
+    if (ret == 0) {
+        *completion_time = simulated_time - test_ctx->cnx_client->start_time;
+        *nb_retransmissions = (test_ctx->cnx_server == NULL) ? UINT64_MAX : test_ctx->cnx_server->nb_retransmission_total;
+        *average_queue_delay = (test_ctx->s_to_c_link->packets_sent == 0) ? 0 :
+            test_ctx->s_to_c_link->queue_delay_total / test_ctx->s_to_c_link->packets_sent;
+        ret = tls_api_one_scenario_body_verify(test_ctx, &simulated_time, 10000000);
+    }
+
+    if (test_ctx != NULL) {
+        tls_api_delete_ctx(test_ctx);
+        test_ctx = NULL;
+    }
+
+    return ret;
+}
+
+/* On the shallow buffer link, BBRv3 should complete in time with fewer
+ * retransmissions than BBRv1, and a shorter average queue than Cubic.
+ */
+int bbr3_shallow_test()
+{
+    picoquic_congestion_algorithm_t* algo_list[3] = {
+        picoquic_bbr3_algorithm,
+        picoquic_bbr_algorithm,
+        picoquic_cubic_algorithm
+    };
+    uint64_t completion_time[3] = { 0, 0, 0 };
+    uint64_t nb_retransmissions[3] = { 0, 0, 0 };
+    uint64_t average_queue_delay[3] = { 0, 0, 0 };
+    const uint64_t bbr3_max_completion_time = 4500000;
+    int ret = 0;
+
+    for (int i = 0; i < 3 && ret == 0; i++) {
+        ret = bbr3_shallow_one(algo_list[i], &completion_time[i], &nb_retransmissions[i], &average_queue_delay[i]);
+        if (ret != 0) {
+            DBG_PRINTF("Shallow buffer test fails for CC=%s", algo_list[i]->congestion_algorithm_id);
+        }
+        else {
+            DBG_PRINTF("Shallow buffer, CC=%s, time=%" PRIu64 ", retransmissions=%" PRIu64 ", queue=%" PRIu64,
+                algo_list[i]->congestion_algorithm_id, completion_time[i], nb_retransmissions[i], average_queue_delay[i]);
+        }
+    }
+
+    if (ret == 0 && completion_time[0] > bbr3_max_completion_time) {
+        DBG_PRINTF("BBRv3 completes in %" PRIu64 ", expected less than %" PRIu64, completion_time[0], bbr3_max_completion_time);
+        ret = -1;
+    }
+
+    if (ret == 0 && nb_retransmissions[0] > nb_retransmissions[1]) {
+        DBG_PRINTF("BBRv3 retransmits %" PRIu64 " packets, BBRv1 only %" PRIu64, nb_retransmissions[0], nb_retransmissions[1]);
+        ret = -1;
+    }
+
+    if (ret == 0 && average_queue_delay[0] > average_queue_delay[2]) {
+        DBG_PRINTF("BBRv3 average queue %" PRIu64 "us, Cubic only %" PRIu64 "us", average_queue_delay[0], average_queue_delay[2]);
+        ret = -1;
+    }
+
+    return ret;
+}
+
+/* Aggregated ACK event test. Wrap Cubic in two test algorithms, one using the
+ * per packet notifications and one using the aggregated ACK event, and count
+ * the calls made on the server side. The aggregated version shall need fewer
+ * calls, and report exactly the bytes delivered on the path.
+ */
+typedef struct st_cc_ack_event_count_t {
+    uint64_t nb_notify;
+    uint64_t nb_ack_events;
+    uint64_t bytes_acknowledged;
+} cc_ack_event_count_t;
+
+static cc_ack_event_count_t cc_ack_event_count;
+
+static void cc_ack_event_test_notify(picoquic_cnx_t* cnx, picoquic_path_t* path_x,
+    picoquic_congestion_notification_t notification, uint64_t rtt_measurement, uint64_t one_way_delay,
+    uint64_t nb_bytes_acknowledged, uint64_t lost_packet_number, uint64_t current_time)
+{
+    if (!cnx->client_mode) {
+        cc_ack_event_count.nb_notify++;
+        if (notification == picoquic_congestion_notification_acknowledgement) {
+            cc_ack_event_count.bytes_acknowledged += nb_bytes_acknowledged;
+        }
+    }
+    picoquic_cubic_algorithm->alg_notify(cnx, path_x, notification, rtt_measurement, one_way_delay,
+        nb_bytes_acknowledged, lost_packet_number, current_time);
+}
+
+static void cc_ack_event_test_notify_ack(picoquic_cnx_t* cnx, picoquic_path_t* path_x,
+    picoquic_per_ack_state_t const* ack_state, uint64_t current_time)
+{
+    if (!cnx->client_mode) {
+        cc_ack_event_count.nb_ack_events++;
+        cc_ack_event_count.bytes_acknowledged += ack_state->nb_bytes_acknowledged;
+    }
+    picoquic_cubic_algorithm->alg_notify_ack(cnx, path_x, ack_state, current_time);
+}
+
+static int cc_ack_event_one(picoquic_congestion_algorithm_t* cc_algo, cc_ack_event_count_t* count)
+{
+    uint64_t simulated_time = 0;
+    uint64_t loss_mask = 0;
+    picoquic_test_tls_api_ctx_t* test_ctx = NULL;
+    picoquic_connection_id_t initial_cid = { {0xac, 0xe0, 0, 0, 0, 0, 0, 0}, 8 };
+    int ret;
+
+    initial_cid.id[2] = (cc_algo->alg_notify_ack == NULL) ? 0 : 1;
+    memset(&cc_ack_event_count, 0, sizeof(cc_ack_event_count));
+
+    ret = tls_api_init_ctx_ex(&test_ctx, PICOQUIC_INTERNAL_TEST_VERSION_1,
+        PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN, &simulated_time, NULL, NULL, 0, 0, 0, &initial_cid);
+
+    if (ret == 0 && test_ctx == NULL) {
+        ret = -1;
+    }
+
+    if (ret == 0) {
+        picoquic_set_default_congestion_algorithm(test_ctx->qserver, cc_algo);
+        picoquic_set_congestion_algorithm(test_ctx->cnx_client, cc_algo);
+
+        ret = tls_api_connection_loop(test_ctx, &loss_mask, 0, &simulated_time);
+    }
+
+    if (ret == 0) {
+        ret = test_api_init_send_recv_scenario(test_ctx, test_scenario_sustained, sizeof(test_scenario_sustained));
+    }
+
+    if (ret == 0) {
+        ret = tls_api_data_sending_loop(test_ctx, &loss_mask, &simulated_time, 0);
+    }
+
+    if (ret == 0) {
+        ret = tls_api_one_scenario_body_verify(test_ctx, &simulated_time, 4000000);
+    }
+
+    if (ret == 0) {
+        *count = cc_ack_event_count;
+        if (test_ctx->cnx_server == NULL) {
+            ret = -1;
+        }
+        else if (cc_algo->alg_notify_ack != NULL &&
+            count->bytes_acknowledged != test_ctx->cnx_server->path[0]->delivered) {
+            DBG_PRINTF("ACK events report %" PRIu64 " bytes, %" PRIu64 " delivered",
+                count->bytes_acknowledged, test_ctx->cnx_server->path[0]->delivered);
+            ret = -1;
+        }
+    }
+
+    if (test_ctx != NULL) {
+        tls_api_delete_ctx(test_ctx);
+        test_ctx = NULL;
+    }
+
+    return ret;
+}
+
+int cc_ack_event_test()
 {
-    int ret = ready_to_send_test_one(2);
+    picoquic_congestion_algorithm_t per_packet_algo = {
+        "cubic_per_packet", PICOQUIC_CC_ALGO_NUMBER_CUBIC,
+        NULL, cc_ack_event_test_notify, NULL, NULL, 0, NULL };
+    picoquic_congestion_algorithm_t aggregated_algo;
+    cc_ack_event_count_t count[2];
+    int ret;
+
+    per_packet_algo.alg_init = picoquic_cubic_algorithm->alg_init;
+    per_packet_algo.alg_delete = picoquic_cubic_algorithm->alg_delete;
+    per_packet_algo.alg_observe = picoquic_cubic_algorithm->alg_observe;
+    aggregated_algo = per_packet_algo;
+    aggregated_algo.congestion_algorithm_id = "cubic_aggregated";
+    aggregated_algo.alg_notify_ack = cc_ack_event_test_notify_ack;
+    memset(count, 0, sizeof(count));
+
+    ret = cc_ack_event_one(&per_packet_algo, &count[0]);
+
+    if (ret == 0) {
+        ret = cc_ack_event_one(&aggregated_algo, &count[1]);
+    }
+
+    if (ret == 0) {
+        uint64_t per_packet_calls = count[0].nb_notify;
+        uint64_t aggregated_calls = count[1].nb_notify + count[1].nb_ack_events;
+
+        DBG_PRINTF("CC calls, per packet: %" PRIu64 ", aggregated: %" PRIu64, per_packet_calls, aggregated_calls);
+        if (count[1].nb_ack_events == 0 || aggregated_calls >= per_packet_calls) {
+            ret = -1;
+        }
+    }
+
     return ret;
 }
 
-static int congestion_control_test(picoquic_congestion_algorithm_t * ccalgo, uint64_t max_completion_time, uint64_t jitter, uint8_t jitter_id)
+/* Prague test: the bottleneck marks ECT packets CE when the queue delay exceeds
+ * 1 ms, as an L4S AQM would. Verify that the data is sent with ECT(1), that
+ * CE marks are reported back to the sender, and that the transfer completes
+ * in time despite the frequent marks.
+ */
+int prague_test()
 {
     uint64_t simulated_time = 0;
     picoquic_test_tls_api_ctx_t* test_ctx = NULL;
-    picoquic_connection_id_t initial_cid = { {0xcc, 0xcc, 0, 0, 0, 0, 0, 0}, 8 };
-    int ret;
-
-    initial_cid.id[2] = ccalgo->congestion_algorithm_number;
-    initial_cid.id[3] = jitter_id;
-    
-    ret = tls_api_init_ctx_ex(&test_ctx, PICOQUIC_INTERNAL_TEST_VERSION_1, PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN, &simulated_time, NULL, NULL, 0, 1, 0, &initial_cid);
+    picoquic_connection_id_t initial_cid = { {0xcc, 0xcc, PICOQUIC_CC_ALGO_NUMBER_PRAGUE, 0x4c, 0, 0, 0, 0}, 8 };
+    int ret = tls_api_init_ctx_ex(&test_ctx, PICOQUIC_INTERNAL_TEST_VERSION_1, PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN, &simulated_time, NULL, NULL, 0, 1, 0, &initial_cid);
 
     if (ret == 0 && test_ctx == NULL) {
         ret = -1;
     }
 
-    /* Set the congestion algorithm to specified value. Also, request a packet trace */
     if (ret == 0) {
+        picoquic_set_default_congestion_algorithm(test_ctx->qserver, picoquic_prague_algorithm);
+        picoquic_set_congestion_algorithm(test_ctx->cnx_client, picoquic_prague_algorithm);
 
-        picoquic_set_default_congestion_algorithm(test_ctx->qserver, ccalgo);
-        picoquic_set_congestion_algorithm(test_ctx->cnx_client, ccalgo);
-
-        test_ctx->c_to_s_link->jitter = jitter;
-        test_ctx->s_to_c_link->jitter = jitter;
+        test_ctx->c_to_s_link->ecn_mark_threshold = 1000;
+        test_ctx->s_to_c_link->ecn_mark_threshold = 1000;
 
         picoquic_set_binlog(test_ctx->qserver, ".");
 
         ret = tls_api_one_scenario_body(test_ctx, &simulated_time,
-            test_scenario_sustained, sizeof(test_scenario_sustained), 0, 0, 0, 20000 + 2*jitter, max_completion_time);
+            test_scenario_sustained, sizeof(test_scenario_sustained), 0, 0, 0, 20000, 4000000);
     }
 
-    /* Free the resource, which will close the log file.
-     */
+    if (ret == 0) {
+        picoquic_ack_context_t* ack_ctx = &test_ctx->cnx_client->ack_ctx[picoquic_packet_context_application];
+
+        if (ack_ctx->ecn_ect1_total_local == 0 || ack_ctx->ecn_ect0_total_local != 0) {
+            DBG_PRINTF("Expected ECT(1) marks only, got ect0=%" PRIu64 ", ect1=%" PRIu64,
+                ack_ctx->ecn_ect0_total_local, ack_ctx->ecn_ect1_total_local);
+            ret = -1;
+        }
+        else if (test_ctx->s_to_c_link->packets_ce_marked == 0 || ack_ctx->ecn_ce_total_local == 0) {
+            DBG_PRINTF("Expected CE marks, link marked %" PRIu64 ", client received %" PRIu64,
+                test_ctx->s_to_c_link->packets_ce_marked, ack_ctx->ecn_ce_total_local);
+            ret = -1;
+        }
+    }
 
     if (test_ctx != NULL) {
         tls_api_delete_ctx(test_ctx);
@@ -8381,36 +10089,6 @@ static int congestion_control_test(picoquic_congestion_algorithm_t * ccalgo, uin
     return ret;
 }
 
-int cubic_test() 
-{
-    return congestion_control_test(picoquic_cubic_algorithm, 3600000, 0, 0);
-}
-
-int cubic_jitter_test()
-{
-    return congestion_control_test(picoquic_cubic_algorithm, 3600000, 5000, 5);
-}
-
-int fastcc_test()
-{
-    return congestion_control_test(picoquic_fastcc_algorithm, 3700000, 0, 0);
-}
-
-int fastcc_jitter_test()
-{
-    return congestion_control_test(picoquic_fastcc_algorithm, 4050000, 5000, 5);
-}
-
-int bbr_test()
-{
-    return congestion_control_test(picoquic_bbr_algorithm, 3600000, 0, 0);
-}
-
-int bbr_jitter_test()
-{
-    return congestion_control_test(picoquic_bbr_algorithm, 3650000, 5000, 5);
-}
-
 int bbr_long_test()
 {
     uint64_t simulated_time = 0;
@@ -8688,6 +10366,181 @@ int bbr_asym400_test()
     return ret;
 }
 
+/* ACK frequency autotuning benchmark.
+ * Download 10MB on a 100 Mbps link with 40 ms RTT, with and without autotuning,
+ * with a deep buffer and with a buffer of a quarter of the BDP, which causes
+ * congestion losses. Report the number of ACKs per MB, counted as the packets
+ * sent by the client, and the throughput. Autotuning shall reduce the number of
+ * ACKs without making the transfer noticeably slower.
+ */
+static int ack_autotune_one(int is_autotune, uint64_t queue_delay_max, uint64_t* nb_acks, uint64_t* completion_time)
+{
+    uint64_t simulated_time = 0;
+    uint64_t loss_mask = 0;
+    const uint64_t latency = 20000;
+    const uint64_t picosec_per_byte = (1000000ull * 8) / 100;
+    picoquic_test_tls_api_ctx_t* test_ctx = NULL;
+    picoquic_connection_id_t initial_cid = { {0xac, 0xa7, 0, 0, 0, 0, 0, 0}, 8 };
+    int ret;
+
+    initial_cid.id[2] = (uint8_t)is_autotune;
+    initial_cid.id[3] = (uint8_t)(queue_delay_max / 1000);
+
+    ret = tls_api_init_ctx_ex(&test_ctx, PICOQUIC_INTERNAL_TEST_VERSION_1,
+        PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN, &simulated_time, NULL, NULL, 0, 0, 0, &initial_cid);
+
+    if (ret == 0 && test_ctx == NULL) {
+        ret = -1;
+    }
+
+    if (ret == 0) {
+        test_ctx->c_to_s_link->microsec_latency = latency;
+        test_ctx->c_to_s_link->picosec_per_byte = picosec_per_byte;
+        test_ctx->s_to_c_link->microsec_latency = latency;
+        test_ctx->s_to_c_link->picosec_per_byte = picosec_per_byte;
+        test_ctx->s_to_c_link->queue_delay_max = queue_delay_max;
+        picoquic_set_default_ack_autotune(test_ctx->qserver, is_autotune, 0);
+
+        ret = tls_api_connection_loop(test_ctx, &loss_mask, 2 * latency, &simulated_time);
+    }
+
+    if (ret == 0) {
+        ret = test_api_init_send_recv_scenario(test_ctx, test_scenario_10mb, sizeof(test_scenario_10mb));
+    }
+
+    if (ret == 0) {
+        uint64_t acks_before = test_ctx->c_to_s_link->packets_sent;
+
+        ret = tls_api_data_sending_loop(test_ctx, &loss_mask, &simulated_time, 0);
+        *nb_acks = test_ctx->c_to_s_link->packets_sent - acks_before;
+        *completion_time = simulated_time - test_ctx->cnx_client->start_time;
+    }
+
+    if (ret == 0) {
+        ret = tls_api_one_scenario_body_verify(test_ctx, &simulated_time, 4000000);
+    }
+
+    if (test_ctx != NULL) {
+        tls_api_delete_ctx(test_ctx);
+        test_ctx = NULL;
+    }
+
+    return ret;
+}
+
+int ack_autotune_test()
+{
+    const uint64_t queue_delay_max[2] = { 0, 10000 };
+    const uint64_t nb_bytes = 10000000;
+    int ret = 0;
+
+    for (int q = 0; q < 2 && ret == 0; q++) {
+        uint64_t nb_acks[2] = { 0, 0 };
+        uint64_t completion_time[2] = { 0, 0 };
+
+        for (int is_autotune = 0; is_autotune < 2 && ret == 0; is_autotune++) {
+            ret = ack_autotune_one(is_autotune, queue_delay_max[q], &nb_acks[is_autotune], &completion_time[is_autotune]);
+            if (ret == 0) {
+                DBG_PRINTF("Queue max %" PRIu64 "us, autotune %d: %" PRIu64 " ACKs per MB, %" PRIu64 " kbps",
+                    queue_delay_max[q], is_autotune, (nb_acks[is_autotune] * 1000000) / nb_bytes,
+                    (nb_bytes * 8000) / completion_time[is_autotune]);
+            }
+            else {
+                DBG_PRINTF("ACK autotune test fails, queue max %" PRIu64 "us, autotune %d", queue_delay_max[q], is_autotune);
+            }
+        }
+
+        if (ret == 0 && nb_acks[1] >= nb_acks[0]) {
+            DBG_PRINTF("Autotune sends %" PRIu64 " ACKs, default %" PRIu64, nb_acks[1], nb_acks[0]);
+            ret = -1;
+        }
+
+        if (ret == 0 && completion_time[1] > completion_time[0] + completion_time[0] / 10) {
+            DBG_PRINTF("Autotune completes in %" PRIu64 "us, default %" PRIu64 "us", completion_time[1], completion_time[0]);
+            ret = -1;
+        }
+    }
+
+    return ret;
+}
+
+/* Loss detection timers. Send 10 MB over a 100 Mbps link, without losses and then
+ * with a loss pattern. In both cases, some of the loss detection calls on the server
+ * shall be answered from the cached timer, and the transfer shall complete.
+ */
+int loss_timer_test()
+{
+    const uint64_t loss_masks[2] = { 0, 0x2012 };
+    const uint64_t latency = 10000;
+    const uint64_t picosec_per_byte = (1000000ull * 8) / 100;
+    int ret = 0;
+
+    for (int i = 0; i < 2 && ret == 0; i++) {
+        uint64_t simulated_time = 0;
+        uint64_t loss_mask = 0;
+        picoquic_test_tls_api_ctx_t* test_ctx = NULL;
+        picoquic_connection_id_t initial_cid = { {0x10, 0x55, 0x71, 0, 0, 0, 0, 0}, 8 };
+
+        initial_cid.id[3] = (uint8_t)i;
+        ret = tls_api_init_ctx_ex(&test_ctx, PICOQUIC_INTERNAL_TEST_VERSION_1,
+            PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN, &simulated_time, NULL, NULL, 0, 0, 0, &initial_cid);
+
+        if (ret == 0 && test_ctx == NULL) {
+            ret = -1;
+        }
+
+        if (ret == 0) {
+            test_ctx->c_to_s_link->microsec_latency = latency;
+            test_ctx->c_to_s_link->picosec_per_byte = picosec_per_byte;
+            test_ctx->s_to_c_link->microsec_latency = latency;
+            test_ctx->s_to_c_link->picosec_per_byte = picosec_per_byte;
+
+            ret = tls_api_connection_loop(test_ctx, &loss_mask, 2 * latency, &simulated_time);
+        }
+
+        if (ret == 0) {
+            ret = test_api_init_send_recv_scenario(test_ctx, test_scenario_10mb, sizeof(test_scenario_10mb));
+        }
+
+        if (ret == 0) {
+            loss_mask = loss_masks[i];
+            ret = tls_api_data_sending_loop(test_ctx, &loss_mask, &simulated_time, 0);
+        }
+
+        if (ret == 0) {
+            ret = tls_api_one_scenario_body_verify(test_ctx, &simulated_time, 2000000);
+        }
+
+        if (ret == 0) {
+            picoquic_cnx_t* cnx = test_ctx->cnx_server;
+
+            if (cnx == NULL) {
+                DBG_PRINTF("%s", "Server connection not found");
+                ret = -1;
+            }
+            else {
+                DBG_PRINTF("Loss mask 0x%" PRIx64 ": %" PRIu64 " loss checks, %" PRIu64 " skipped, %" PRIu64 " retransmissions",
+                    loss_masks[i], cnx->nb_loss_checks, cnx->nb_loss_checks_skipped, cnx->nb_retransmission_total);
+                if (cnx->nb_loss_checks_skipped == 0) {
+                    DBG_PRINTF("%s", "No loss check skipped");
+                    ret = -1;
+                }
+                else if (loss_masks[i] != 0 && cnx->nb_retransmission_total == 0) {
+                    DBG_PRINTF("%s", "No loss detected");
+                    ret = -1;
+                }
+            }
+        }
+
+        if (test_ctx != NULL) {
+            tls_api_delete_ctx(test_ctx);
+            test_ctx = NULL;
+        }
+    }
+
+    return ret;
+}
+
 /* Set the CID length to specified value */
 int set_cid_length_in_context(picoquic_test_tls_api_ctx_t* test_ctx, uint8_t length, int delayed_init)
 {
@@ -10396,6 +12249,136 @@ int pacing_test()
     return ret;
 }
 
+/*
+ * Test the pacing wheel: connections scheduled within the wheel horizon and
+ * beyond it must be served in wake time order, never early, and at most one
+ * slot late. Deleted connections must leave the wheel.
+ */
+#define PACING_WHEEL_TEST_NB_CNX 32
+#define PACING_WHEEL_TEST_SLOT 16
+
+int pacing_wheel_test()
+{
+    int ret = 0;
+    uint64_t current_time = 0;
+    uint64_t last_wake_time = 0;
+    picoquic_quic_t* quic = NULL;
+    picoquic_cnx_t* cnx[PACING_WHEEL_TEST_NB_CNX];
+    struct sockaddr_in saddr;
+    picoquic_pacing_wheel_stats_t stats;
+    int nb_served = 0;
+    int nb_in_tree = 0;
+    const int deleted_index = 5;
+
+    memset(cnx, 0, sizeof(cnx));
+    memset(&saddr, 0, sizeof(struct sockaddr_in));
+    saddr.sin_family = AF_INET;
+    saddr.sin_port = 1000;
+
+    quic = picoquic_create(PACING_WHEEL_TEST_NB_CNX, NULL, NULL, NULL, NULL, NULL,
+        NULL, NULL, NULL, NULL, current_time,
+        &current_time, NULL, NULL, 0);
+
+    if (quic == NULL) {
+        DBG_PRINTF("%s", "Cannot create QUIC context\n");
+        ret = -1;
+    }
+    else {
+        /* 128 slots of 16us, the horizon is 2048us */
+        ret = picoquic_enable_pacing_wheel(quic, PACING_WHEEL_TEST_SLOT, 100);
+    }
+
+    for (int i = 0; ret == 0 && i < PACING_WHEEL_TEST_NB_CNX; i++) {
+        cnx[i] = picoquic_create_cnx(quic,
+            picoquic_null_connection_id, picoquic_null_connection_id, (struct sockaddr*)&saddr,
+            current_time, 0, "test-sni", "test-alpn", 1);
+        if (cnx[i] == NULL) {
+            DBG_PRINTF("Cannot create connection %d\n", i);
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        /* Wake times from 1000 to 3294us, the last ones beyond the horizon */
+        for (int i = 0; i < PACING_WHEEL_TEST_NB_CNX; i++) {
+            picoquic_reinsert_by_wake_time(quic, cnx[i], 1000 + 74 * (uint64_t)i);
+            if (!cnx[i]->is_in_pacing_wheel) {
+                nb_in_tree++;
+            }
+        }
+        if (nb_in_tree == 0 || nb_in_tree == PACING_WHEEL_TEST_NB_CNX) {
+            DBG_PRINTF("Expected connections in wheel and tree, got %d in tree\n", nb_in_tree);
+            ret = -1;
+        }
+        else {
+            picoquic_delete_cnx(cnx[deleted_index]);
+            cnx[deleted_index] = NULL;
+        }
+    }
+
+    while (ret == 0 && nb_served < PACING_WHEEL_TEST_NB_CNX - 1) {
+        uint64_t next_time = picoquic_get_next_wake_time(quic, current_time);
+        picoquic_cnx_t* next_cnx;
+
+        if (next_time == UINT64_MAX) {
+            DBG_PRINTF("No connection to wake after %d served\n", nb_served);
+            ret = -1;
+            break;
+        }
+        if (next_time > current_time) {
+            current_time = next_time;
+        }
+        next_cnx = picoquic_get_earliest_cnx_to_wake(quic, current_time);
+        if (next_cnx == NULL || next_cnx->next_wake_time > current_time) {
+            DBG_PRINTF("Connection not due at %" PRIu64 "\n", current_time);
+            ret = -1;
+        }
+        else if (current_time - next_cnx->next_wake_time >= PACING_WHEEL_TEST_SLOT ||
+            next_cnx->next_wake_time < last_wake_time) {
+            DBG_PRINTF("Connection scheduled at %" PRIu64 " served at %" PRIu64 "\n",
+                next_cnx->next_wake_time, current_time);
+            ret = -1;
+        }
+        else {
+            last_wake_time = next_cnx->next_wake_time;
+            picoquic_pacing_wheel_departure(quic->pacing_wheel, next_cnx->next_wake_time, current_time);
+            picoquic_reinsert_by_wake_time(quic, next_cnx, UINT64_MAX);
+            nb_served++;
+        }
+    }
+
+    if (ret == 0) {
+        picoquic_get_pacing_wheel_stats(quic, &stats);
+        if (stats.nb_departures != (uint64_t)nb_served || stats.nb_early != 0 ||
+            stats.lateness_max >= PACING_WHEEL_TEST_SLOT || stats.lateness_histogram[0] != (uint64_t)nb_served ||
+            stats.nb_scheduled < (uint64_t)(PACING_WHEEL_TEST_NB_CNX - nb_in_tree)) {
+            DBG_PRINTF("Unexpected stats: departures %" PRIu64 ", early %" PRIu64 ", max lateness %" PRIu64 "\n",
+                stats.nb_departures, stats.nb_early, stats.lateness_max);
+            ret = -1;
+        }
+        else if (quic->pacing_wheel->nb_cnx != 0) {
+            DBG_PRINTF("%zu connections left in the wheel\n", quic->pacing_wheel->nb_cnx);
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        /* Disabling the wheel returns the connections to the wake tree */
+        picoquic_reinsert_by_wake_time(quic, cnx[0], current_time + 100);
+        ret = picoquic_enable_pacing_wheel(quic, 0, 0);
+        if (ret == 0 && (cnx[0]->is_in_pacing_wheel || picoquic_get_earliest_cnx_to_wake(quic, current_time) != cnx[0])) {
+            DBG_PRINTF("%s", "Connection not returned to the wake tree\n");
+            ret = -1;
+        }
+    }
+
+    if (quic != NULL) {
+        picoquic_free(quic);
+    }
+
+    return ret;
+}
+
 /*
  * Test connection establishment with ChaCha20
  */